@@ -0,0 +1,96 @@
+// ================================================================================================
+// Compute shader for the clustered light assignment (froxel grid of the camera)
+//
+// Supports:
+// - Point and spot lights (culled by their bounding spheres)
+// - Exponential depth slices (the first one covers [near plane, min slice depth])
+//
+// Other info:
+// - CSBuildClusters: one thread per cluster, lights are loaded in batches into the groupshared memory (in the cluster view space)
+//   and tested against the cluster's view space AABB; the light list of a cluster is at (cluster * MAX_LIGHTS_PER_CLUSTER) in the indices
+// - CPU reference is in ER_ClusteredLighting (BuildClustersReference(), GetClusterAABB()), keep both in sync
+// ================================================================================================
+
+#define CLUSTERED_LIGHTING_NO_SHADING
+#include "ClusteredLighting.hlsli"
+
+#define THREAD_GROUP_SIZE 64 // same as CLUSTERED_LIGHTING_THREAD_GROUP_SIZE
+
+cbuffer ClusteredLightCullingCBuffer : register(b0)
+{
+    ClusteredLightingParams Params;
+}
+
+StructuredBuffer<ClusteredLight> Lights : register(t0);
+
+RWStructuredBuffer<uint2> ClustersGrid : register(u0); // (offset, count)
+RWStructuredBuffer<uint> ClustersLightIndices : register(u1);
+
+groupshared float4 LightsSpheres[THREAD_GROUP_SIZE]; // view space center, radius
+
+float GetSliceDepth(uint slice)
+{
+    if (slice == 0)
+        return Params.DepthParams.z;
+    if (slice >= Params.GridSize.z)
+        return Params.DepthParams.w;
+    return exp((float(slice) - Params.DepthParams.y) / Params.DepthParams.x);
+}
+
+bool IsSphereInCluster(float4 sphere, float3 aabbMin, float3 aabbMax)
+{
+    float3 d = max(aabbMin - sphere.xyz, 0.0f) + max(sphere.xyz - aabbMax, 0.0f);
+    return dot(d, d) <= sphere.w * sphere.w;
+}
+
+[numthreads(THREAD_GROUP_SIZE, 1, 1)]
+void CSBuildClusters(uint3 DTid : SV_DispatchThreadID, uint GI : SV_GroupIndex)
+{
+    uint clustersCount = Params.GridSize.x * Params.GridSize.y * Params.GridSize.z;
+    uint clusterIndex = DTid.x;
+    bool isValidCluster = clusterIndex < clustersCount;
+    
+    uint x = clusterIndex % Params.GridSize.x;
+    uint y = (clusterIndex / Params.GridSize.x) % Params.GridSize.y;
+    uint z = clusterIndex / (Params.GridSize.x * Params.GridSize.y);
+    
+    float nearDepth = GetSliceDepth(z);
+    float farDepth = GetSliceDepth(z + 1);
+    
+    // tile's NDC rectangle (tile rows go from the top of the screen)
+    float2 ndcMin = float2(-1.0f + 2.0f * float(x) / float(Params.GridSize.x), 1.0f - 2.0f * float(y + 1) / float(Params.GridSize.y));
+    float2 ndcMax = float2(-1.0f + 2.0f * float(x + 1) / float(Params.GridSize.x), 1.0f - 2.0f * float(y) / float(Params.GridSize.y));
+    
+    float3 aabbMin = float3(min(ndcMin * nearDepth, ndcMin * farDepth) / Params.ProjectionParams.zw, nearDepth);
+    float3 aabbMax = float3(max(ndcMax * nearDepth, ndcMax * farDepth) / Params.ProjectionParams.zw, farDepth);
+    
+    uint offset = clusterIndex * CLUSTERED_LIGHTING_MAX_LIGHTS_PER_CLUSTER;
+    uint count = 0;
+    
+    // all threads go through the batches (barriers), invalid clusters just do not write
+    uint lightsCount = Params.GridSize.w;
+    for (uint batchStart = 0; batchStart < lightsCount; batchStart += THREAD_GROUP_SIZE)
+    {
+        uint lightIndex = batchStart + GI;
+        if (lightIndex < lightsCount)
+        {
+            ClusteredLight light = Lights[lightIndex];
+            LightsSpheres[GI] = float4(mul(float4(light.Position, 1.0f), Params.View).xyz, light.Radius);
+        }
+        GroupMemoryBarrierWithGroupSync();
+        
+        uint batchCount = min(THREAD_GROUP_SIZE, lightsCount - batchStart);
+        for (uint i = 0; i < batchCount; i++)
+        {
+            if (isValidCluster && count < CLUSTERED_LIGHTING_MAX_LIGHTS_PER_CLUSTER && IsSphereInCluster(LightsSpheres[i], aabbMin, aabbMax))
+            {
+                ClustersLightIndices[offset + count] = batchStart + i;
+                count++;
+            }
+        }
+        GroupMemoryBarrierWithGroupSync();
+    }
+    
+    if (isValidCluster)
+        ClustersGrid[clusterIndex] = uint2(offset, count);
+}
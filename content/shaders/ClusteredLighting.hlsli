@@ -0,0 +1,86 @@
+// ================================================================================================
+// Clustered lighting of the local (point/spot) lights: cluster lookup and shading of the cluster's lights.
+// Clusters are built by ClusteredLightCulling.hlsl (or on the CPU) in ER_ClusteredLighting, keep the math in sync.
+//
+// Expects the lighting functions from Lighting.hlsli to be included before this file
+// (define CLUSTERED_LIGHTING_NO_SHADING before the include to get the data structures only).
+// ================================================================================================
+
+#define CLUSTERED_LIGHTING_MAX_LIGHTS_PER_CLUSTER 128 // same as CLUSTERED_LIGHTING_MAX_LIGHTS_PER_CLUSTER
+
+// same as ER_ClusteredLight
+struct ClusteredLight
+{
+    float3 Position;
+    float Radius;
+    float3 Color; // premultiplied by the intensity
+    float SpotCosOuter; // -2 for point lights
+    float3 Direction;
+    float SpotCosInner;
+};
+
+// same as ClusteredLightingParams in ER_ClusteredLighting.h
+struct ClusteredLightingParams
+{
+    float4x4 View; // world -> cluster view space (+z is the depth)
+    uint4 GridSize; // x,y,z - clusters, w - lights count
+    float4 DepthParams; // x - slice scale, y - slice bias, z - near plane, w - far plane
+    float4 ProjectionParams; // x,y - clusters per pixel, z,w - [0][0] and [1][1] of the projection
+};
+
+uint GetClusterSlice(float viewDepth, ClusteredLightingParams params)
+{
+    float slice = floor(log(max(viewDepth, params.DepthParams.z)) * params.DepthParams.x + params.DepthParams.y);
+    return (uint) clamp(slice, 0.0f, float(params.GridSize.z - 1));
+}
+
+// pixel - screen position (as SV_Position: pixel centers at .5)
+uint GetClusterIndex(float2 pixel, float3 positionWS, ClusteredLightingParams params)
+{
+    float viewDepth = mul(float4(positionWS, 1.0f), params.View).z;
+    uint x = min((uint) (max(pixel.x, 0.0f) * params.ProjectionParams.x), params.GridSize.x - 1);
+    uint y = min((uint) (max(pixel.y, 0.0f) * params.ProjectionParams.y), params.GridSize.y - 1);
+    uint z = GetClusterSlice(viewDepth, params);
+    return (z * params.GridSize.y + y) * params.GridSize.x + x;
+}
+
+// windowed inverse square falloff (reaches 0 at the radius) + cone falloff for spot lights
+float GetClusteredLightAttenuation(ClusteredLight light, float3 toLight, float distance)
+{
+    float distanceRatio = distance / light.Radius;
+    float window = saturate(1.0f - distanceRatio * distanceRatio * distanceRatio * distanceRatio);
+    float attenuation = window * window / (distance * distance + 1.0f);
+    
+    if (light.SpotCosOuter > -1.5f)
+        attenuation *= saturate((dot(-toLight, light.Direction) - light.SpotCosOuter) / max(light.SpotCosInner - light.SpotCosOuter, 0.0001f));
+    
+    return attenuation;
+}
+
+#ifndef CLUSTERED_LIGHTING_NO_SHADING
+// Direct lighting (PBR) of all lights in the cluster (unshadowed)
+float3 ClusteredLightingPBR(StructuredBuffer<ClusteredLight> lights, StructuredBuffer<uint2> clustersGrid, StructuredBuffer<uint> clustersLightIndices,
+    float2 pixel, ClusteredLightingParams params, float3 normalWS, float3 diffuseAlbedo, float3 positionWS, float roughness, float3 F0, float metallic, float3 camPos)
+{
+    float3 lighting = float3(0.0, 0.0, 0.0);
+    if (params.GridSize.w == 0)
+        return lighting;
+    
+    uint2 cluster = clustersGrid[GetClusterIndex(pixel, positionWS, params)]; // (offset, count)
+    for (uint i = 0; i < cluster.y; i++)
+    {
+        ClusteredLight light = lights[clustersLightIndices[cluster.x + i]];
+        
+        float3 toLight = light.Position - positionWS;
+        float distance = length(toLight);
+        if (distance >= light.Radius)
+            continue;
+        toLight /= max(distance, 0.0001f);
+        
+        float attenuation = GetClusteredLightAttenuation(light, toLight, distance);
+        if (attenuation > 0.0f)
+            lighting += DirectLightingPBR(normalWS, float4(light.Color * attenuation, 1.0f), toLight, diffuseAlbedo, positionWS, roughness, F0, metallic, camPos);
+    }
+    return lighting;
+}
+#endif
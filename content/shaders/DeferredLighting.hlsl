@@ -4,10 +4,9 @@
 // Supports:
 // - Cascaded Shadow Mapping
 // - PBR with Image Based Lighting (via light probes)
+// - Point/spot lights (clustered, unshadowed)
 //
 // TODO:
-// - move to "Tiled/Clustered Deferred"
-// - add support for point/spot lights
 // - add support for ambient occlusion
 //
 // Written by Gen Afanasev for 'EveryRay Rendering Engine', 2017-2022
@@ -15,6 +14,7 @@
 
 #include "Lighting.hlsli"
 #include "Common.hlsli"
+#include "ClusteredLighting.hlsli"
 
 SamplerState SamplerLinear : register(s0);
 SamplerComparisonState CascadedPcfShadowMapSampler : register(s1);
@@ -29,6 +29,10 @@ Texture2D<float4> GbufferExtra2Texture : register(t4); // [global diffuse probe
 
 Texture2D<float> CascadedShadowTextures[NUM_OF_SHADOW_CASCADES] : register(t5);
 
+StructuredBuffer<ClusteredLight> ClusteredLights : register(t18);
+StructuredBuffer<uint2> ClustersGrid : register(t19); // (offset, count)
+StructuredBuffer<uint> ClustersLightIndices : register(t20);
+
 cbuffer DeferredLightingCBuffer : register(b0)
 {
     float4x4 ShadowMatrices[NUM_OF_SHADOW_CASCADES];
@@ -45,6 +49,7 @@ cbuffer DeferredLightingCBuffer : register(b0)
     float SSSWidth;
     float SSSDirectionLightMaxPlane;
     float SSSAvailable;
+    ClusteredLightingParams ClusteredLighting;
 }
 
 cbuffer LightProbesCBuffer : register(b1)
@@ -102,6 +107,11 @@ void CSMain(uint3 Gid : SV_GroupID, uint3 GTid : SV_GroupThreadID, uint3 DTid :
     else
         directLighting = DirectLightingPBR(normalWS, SunColor, SunDirection.xyz, diffuseAlbedo.rgb, worldPos.rgb, roughness, F0, metalness, CameraPosition.xyz);
     
+    float3 localLighting = float3(0.0, 0.0, 0.0);
+    if (!isFoliage)
+        localLighting = ClusteredLightingPBR(ClusteredLights, ClustersGrid, ClustersLightIndices, float2(inPos) + 0.5f, ClusteredLighting,
+            normalWS, diffuseAlbedo.rgb, worldPos.rgb, roughness, F0, metalness, CameraPosition.xyz);
+    
     if (useSSS)
     {
         directLighting += SunColor.rgb * diffuseAlbedo.rgb * 
@@ -139,6 +149,6 @@ void CSMain(uint3 Gid : SV_GroupID, uint3 GTid : SV_GroupThreadID, uint3 DTid :
     
     float shadow = Deferred_GetShadow(worldPos, ShadowMatrices, ShadowCascadeDistances, ShadowTexelSize.x, CascadedShadowTextures, CascadedPcfShadowMapSampler);
     
-    float3 color = (directLighting * shadow) + indirectLighting;
+    float3 color = (directLighting * shadow) + localLighting + indirectLighting;
     OutputTexture[inPos] += float4(color, 1.0f);
 }
\ No newline at end of file
@@ -6,11 +6,10 @@
 // - PBR with Image Based Lighting (via light probes)
 // - Parallax-Occlusion Mapping
 // - Instancing
+// - Point/spot lights (clustered, unshadowed)
 //
 // TODO:
-// - move to "Forward+"
 // - add support for proper transparency (+BRDF)
-// - add support for point/spot lights
 // - add support for ambient occlusion
 //
 // Info: also used for rendering into light probes cubemaps (with different entry points for PS)
@@ -20,6 +19,7 @@
 
 #include "Lighting.hlsli"
 #include "Common.hlsli"
+#include "ClusteredLighting.hlsli"
 
 Texture2D<float4> AlbedoTexture : register(t0);
 Texture2D<float4> NormalTexture : register(t1);
@@ -28,6 +28,10 @@ Texture2D<float4> RoughnessTexture : register(t3);
 Texture2D<float4> HeightTexture : register(t4);
 Texture2D<float> CascadedShadowTextures[NUM_OF_SHADOW_CASCADES] : register(t5);
 
+StructuredBuffer<ClusteredLight> ClusteredLights : register(t18);
+StructuredBuffer<uint2> ClustersGrid : register(t19); // (offset, count)
+StructuredBuffer<uint> ClustersLightIndices : register(t20);
+
 SamplerState SamplerLinear : register(s0);
 SamplerComparisonState CascadedPcfShadowMapSampler : register(s1);
 
@@ -40,6 +44,7 @@ cbuffer ForwardLightingCBuffer : register(b0)
     float4 SunDirection;
     float4 SunColor;
     float4 CameraPosition;
+    ClusteredLightingParams ClusteredLighting;
 }
 
 cbuffer ObjectCBuffer : register(b1)
@@ -280,7 +285,7 @@ int GetPOMRayStepsCount(float3 worldPos, float3 normal)
     return numLayers;
 }
 
-float3 GetFinalColor(VS_OUTPUT vsOutput, bool IBL, int forcedCascadeShadowIndex = -1, bool isFakeAmbient = false)
+float3 GetFinalColor(VS_OUTPUT vsOutput, bool IBL, int forcedCascadeShadowIndex = -1, bool isFakeAmbient = false, bool clusteredLights = false)
 {
     float3x3 TBN = float3x3(vsOutput.Tangent, cross(vsOutput.Normal, vsOutput.Tangent), vsOutput.Normal);
     float2 texCoord = vsOutput.UV;
@@ -324,6 +329,11 @@ float3 GetFinalColor(VS_OUTPUT vsOutput, bool IBL, int forcedCascadeShadowIndex
 
     float3 directLighting = DirectLightingPBR(normalWS, SunColor, SunDirection.xyz, diffuseAlbedo.rgb, vsOutput.WorldPos, roughness, F0, metalness, CameraPosition.xyz);
     
+    float3 localLighting = float3(0, 0, 0);
+    if (clusteredLights)
+        localLighting = ClusteredLightingPBR(ClusteredLights, ClustersGrid, ClustersLightIndices, vsOutput.Position.xy, ClusteredLighting,
+            normalWS, diffuseAlbedo.rgb, vsOutput.WorldPos, roughness, F0, metalness, CameraPosition.xyz);
+    
     float3 indirectLighting = float3(0, 0, 0);
     if (isFakeAmbient)
         indirectLighting = float3(0.02f, 0.02f, 0.02f) * diffuseAlbedo;
@@ -361,13 +371,13 @@ float3 GetFinalColor(VS_OUTPUT vsOutput, bool IBL, int forcedCascadeShadowIndex
     else // standard 3 cascades or forced cascade
         shadow = Forward_GetShadow(ShadowCascadeDistances, shadowCoords, ShadowTexelSize.r, CascadedShadowTextures, CascadedPcfShadowMapSampler, vsOutput.Position.w, forcedCascadeShadowIndex);
     
-    float3 color = (directLighting * shadow * POMSelfShadow) + indirectLighting;
+    float3 color = (directLighting * shadow * POMSelfShadow) + localLighting + indirectLighting;
     return color;
 }
 
 float3 PSMain(VS_OUTPUT vsOutput) : SV_Target0
 {
-    return GetFinalColor(vsOutput, true);
+    return GetFinalColor(vsOutput, true, -1, false, true);
 }
 float3 PSMain_DiffuseProbes(VS_OUTPUT vsOutput) : SV_Target0
 {
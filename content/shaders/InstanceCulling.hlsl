@@ -0,0 +1,117 @@
+// ================================================================================================
+// Compute shaders for GPU-driven culling and LOD selection of instanced objects
+//
+// Supports:
+// - Frustum culling of instances (world AABB vs frustum planes)
+// - LOD selection by the distance to the camera (instances beyond the last LOD are culled)
+// - Indirect draw arguments for every mesh of every LOD
+//
+// Other info:
+// - CSCullInstances: one thread per instance, visible instances are appended to their LOD's bucket
+// - CSBuildIndirectArgs: one thread per LOD, writes the bucket size to the args of every mesh of the LOD and resets the counter
+// - CPU reference is in ER_GPUInstanceCuller (CullAndSelectLOD(), CullReference()), keep both in sync
+// ================================================================================================
+
+#define THREAD_GROUP_SIZE 64 // same as GPU_INSTANCE_CULLING_THREAD_GROUP_SIZE
+#define MAX_LOD 3
+#define DRAW_ARGS_UINT_COUNT 5 // IndexCountPerInstance, InstanceCount, StartIndexLocation, BaseVertexLocation, StartInstanceLocation
+
+cbuffer InstanceCullingCBuffer : register(b0)
+{
+    float4 FrustumPlanes[6];
+    float4 CameraPosition;
+    float4 LocalAABBMin;
+    float4 LocalAABBMax;
+    float4 LODDistancesSqr;
+    uint4 LODArgsOffsets;
+    uint4 LODMeshesCounts;
+    uint4 Counts; // x - instances, y - LODs, z - instances per LOD bucket
+}
+
+struct InstanceData
+{
+    row_major float4x4 World;
+};
+
+StructuredBuffer<InstanceData> Instances : register(t0);
+RWStructuredBuffer<InstanceData> CulledInstances : register(u0);
+RWBuffer<uint> LODCounters : register(u1);
+RWBuffer<uint> IndirectArgs : register(u2);
+
+bool IsAABBCulled(float3 aabbMin, float3 aabbMax)
+{
+    [unroll]
+    for (int planeID = 0; planeID < 6; planeID++)
+    {
+        float3 nearestCorner = float3(
+            FrustumPlanes[planeID].x > 0.0 ? aabbMin.x : aabbMax.x,
+            FrustumPlanes[planeID].y > 0.0 ? aabbMin.y : aabbMax.y,
+            FrustumPlanes[planeID].z > 0.0 ? aabbMin.z : aabbMax.z);
+        if (dot(FrustumPlanes[planeID].xyz, nearestCorner) + FrustumPlanes[planeID].w > 0.0)
+            return true;
+    }
+    return false;
+}
+
+int SelectLOD(float3 position)
+{
+    float3 toCamera = CameraPosition.xyz - position;
+    float distanceSqr = dot(toCamera, toCamera);
+
+    [unroll]
+    for (int lod = 0; lod < MAX_LOD; lod++)
+    {
+        if (lod < (int)Counts.y && distanceSqr <= LODDistancesSqr[lod])
+            return lod;
+    }
+    return -1;
+}
+
+[numthreads(THREAD_GROUP_SIZE, 1, 1)]
+void CSCullInstances(uint3 DTid : SV_DispatchThreadID)
+{
+    uint index = DTid.x;
+    if (index >= Counts.x)
+        return;
+
+    InstanceData instance = Instances[index];
+
+    float3 aabbMin = float3(1.#INF, 1.#INF, 1.#INF);
+    float3 aabbMax = -aabbMin;
+    [unroll]
+    for (int i = 0; i < 8; i++)
+    {
+        float4 corner = float4(
+            (i & 1) ? LocalAABBMax.x : LocalAABBMin.x,
+            (i & 2) ? LocalAABBMax.y : LocalAABBMin.y,
+            (i & 4) ? LocalAABBMax.z : LocalAABBMin.z, 1.0);
+        float3 worldCorner = mul(corner, instance.World).xyz;
+        aabbMin = min(aabbMin, worldCorner);
+        aabbMax = max(aabbMax, worldCorner);
+    }
+
+    if (IsAABBCulled(aabbMin, aabbMax))
+        return;
+
+    int lod = SelectLOD(instance.World[3].xyz);
+    if (lod < 0)
+        return;
+
+    uint slot;
+    InterlockedAdd(LODCounters[lod], 1, slot);
+    CulledInstances[lod * Counts.z + slot] = instance;
+}
+
+[numthreads(MAX_LOD, 1, 1)]
+void CSBuildIndirectArgs(uint3 DTid : SV_DispatchThreadID)
+{
+    uint lod = DTid.x;
+    if (lod >= Counts.y)
+        return;
+
+    uint instanceCount = LODCounters[lod];
+    for (uint mesh = 0; mesh < LODMeshesCounts[lod]; mesh++)
+        IndirectArgs[(LODArgsOffsets[lod] + mesh) * DRAW_ARGS_UINT_COUNT + 1] = instanceCount;
+
+    LODCounters[lod] = 0;
+}
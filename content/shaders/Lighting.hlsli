@@ -412,6 +412,7 @@ float3 GetDiffuseIrradiance(float3 worldPos, float3 normal, float3 camPos, bool
     int diffuseProbesCellIndex = GetLightProbesCellIndex(worldPos, probesInfo.diffuseProbeCellsCount, probesInfo.sceneLightProbeBounds.xyz, probesInfo.distanceBetweenDiffuseProbes);
     if (diffuseProbesCellIndex != -1)
     {
+        int firstExistingProbe = -1;
         for (int i = 0; i < NUM_OF_PROBES_PER_CELL; i++)
         {
             cellProbesExistanceFlags[i] = false;
@@ -427,9 +428,17 @@ float3 GetDiffuseIrradiance(float3 worldPos, float3 normal, float3 camPos, bool
         
                 cellProbesSamples[i] = GetDiffuseIrradianceFromSphericalHarmonics(normal, SH);
                 cellProbesPositions[i] = probesInfo.DiffuseProbesPositionsArray[currentIndex];
+                if (firstExistingProbe == -1)
+                    firstExistingProbe = i;
             }
         }
         
+        // sparse grids can skip probes: no probes - global probe, no first (corner) probe - restore its position from another probe (slot bits are Y, X, Z offsets)
+        if (firstExistingProbe == -1)
+            return probesInfo.globalIrradianceDiffuseProbeTexture.SampleLevel(linearSampler, normal, 0).rgb;
+        cellProbesPositions[0] = cellProbesPositions[firstExistingProbe] - probesInfo.distanceBetweenDiffuseProbes *
+            float3((firstExistingProbe >> 1) & 1, (firstExistingProbe >> 2) & 1, firstExistingProbe & 1);
+        
         finalSum = GetTrilinearInterpolationFromNeighbourProbes(worldPos, probesInfo.distanceBetweenDiffuseProbes);
     }
     else
@@ -86,6 +86,7 @@ using namespace DirectX;
 #endif
 
 #define NUM_SHADOW_CASCADES 3
+#define NUM_VOXEL_GI_CASCADES 2
 #define MAX_LOD 3
 
 template <typename T>
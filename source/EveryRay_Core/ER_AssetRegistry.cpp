@@ -0,0 +1,666 @@
+#include "stdafx.h"
+#include <algorithm>
+
+#include "ER_AssetRegistry.h"
+#include "ER_Core.h"
+#include "ER_Model.h"
+#include "ER_Mesh.h"
+#include "ER_RenderingObject.h"
+#include "ER_VertexDeclarations.h"
+#include "ER_Utility.h"
+#include "ER_Settings.h"
+#include "ER_JobSystem.h"
+
+namespace EveryRay_Core
+{
+	RTTI_DEFINITIONS(ER_AssetRegistry)
+
+	namespace
+	{
+		template<typename T>
+		void AccumulateBytes(const std::vector<T>& collection, UINT64& bytes)
+		{
+			bytes += sizeof(T) * collection.size();
+		}
+
+		// registry paths come from narrow strings (json, aiString), so this is lossless
+		std::string ToNarrowString(const std::wstring& path)
+		{
+			std::string result(path.size(), '\0');
+			for (size_t i = 0; i < path.size(); i++)
+				result[i] = static_cast<char>(path[i]);
+			return result;
+		}
+
+		std::string FormatMegabytes(UINT64 bytes)
+		{
+			char buffer[32];
+			sprintf_s(buffer, "%.2f MB", static_cast<double>(bytes) / (1024.0 * 1024.0));
+			return std::string(buffer);
+		}
+
+		// approximate (4 bytes per texel + mip chain)
+		UINT64 GetTextureBytes(ER_RHI_GPUTexture* aTexture)
+		{
+			return static_cast<UINT64>(aTexture->GetWidth()) * aTexture->GetHeight() * 4 * ((aTexture->GetMips() > 1) ? 4 : 3) / 3;
+		}
+
+		bool IsFileExisting(const std::wstring& path)
+		{
+			const DWORD attributes = GetFileAttributesW(path.c_str());
+			return attributes != INVALID_FILE_ATTRIBUTES && !(attributes & FILE_ATTRIBUTE_DIRECTORY);
+		}
+
+		// called from the job system's threads
+		bool ReadTextureFile(const std::wstring& path, std::vector<UINT8>& outData)
+		{
+			FILE* file = nullptr;
+			if (_wfopen_s(&file, path.c_str(), L"rb") != 0 || !file)
+				return false;
+
+			fseek(file, 0, SEEK_END);
+			const long size = ftell(file);
+			fseek(file, 0, SEEK_SET);
+			if (size > 0)
+			{
+				outData.resize(static_cast<size_t>(size));
+				if (fread(outData.data(), 1, outData.size(), file) != outData.size())
+					outData.clear();
+			}
+			fclose(file);
+			return !outData.empty();
+		}
+	}
+
+	ER_AssetRegistry::ER_AssetRegistry(ER_Core& game)
+		: ER_CoreComponent(game)
+	{
+		mJobSystem = (ER_JobSystem*)game.GetServices().FindService(ER_JobSystem::TypeIdClass());
+		mTextureBudgetBytes = GetTextureBudgetForQuality(ER_Settings::TexturesQuality);
+	}
+
+	ER_AssetRegistry::~ER_AssetRegistry()
+	{
+		// assets that are still referenced at shutdown (i.e., the level was not unloaded)
+		for (auto& model : mModels)
+			DeletePointerCollection(model.second->RenderBuffers);
+		mModels.clear();
+
+		while (!mTextures.empty())
+			DeleteTextureAsset(mTextures.begin());
+		mTexturesByResource.clear();
+		DeleteRetiredTextures(true);
+	}
+
+	std::string ER_AssetRegistry::GetCanonicalPath(const std::string& path)
+	{
+		char buffer[MAX_PATH];
+		DWORD length = GetFullPathNameA(path.c_str(), MAX_PATH, buffer, nullptr);
+		std::string result = (length > 0 && length < MAX_PATH) ? std::string(buffer, length) : path;
+		std::replace(result.begin(), result.end(), '/', '\\');
+		std::transform(result.begin(), result.end(), result.begin(), [](char c) { return static_cast<char>(::tolower(static_cast<unsigned char>(c))); });
+		return result;
+	}
+
+	std::wstring ER_AssetRegistry::GetCanonicalPath(const std::wstring& path)
+	{
+		wchar_t buffer[MAX_PATH];
+		DWORD length = GetFullPathNameW(path.c_str(), MAX_PATH, buffer, nullptr);
+		std::wstring result = (length > 0 && length < MAX_PATH) ? std::wstring(buffer, length) : path;
+		std::replace(result.begin(), result.end(), L'/', L'\\');
+		std::transform(result.begin(), result.end(), result.begin(), ::towlower);
+		return result;
+	}
+
+	ER_ModelAsset* ER_AssetRegistry::AcquireModel(const std::string& path, bool flipUVs)
+	{
+		const std::string key = GetCanonicalPath(path) + (flipUVs ? "|flipUVs" : "");
+
+		ER_ModelAsset* asset = nullptr;
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			std::unique_ptr<ER_ModelAsset>& entry = mModels[key];
+			if (!entry)
+			{
+				entry.reset(new ER_ModelAsset());
+				entry->Path = key;
+			}
+			asset = entry.get();
+			asset->RefCount++;
+			mModelRequests++;
+		}
+
+		// only the first thread loads the model, others wait for it here
+		std::call_once(asset->ModelLoadedFlag, [&]() { LoadModel(*asset, path, flipUVs); });
+		return asset;
+	}
+
+	void ER_AssetRegistry::LoadModel(ER_ModelAsset& aAsset, const std::string& path, bool flipUVs)
+	{
+		aAsset.Model.reset(new ER_Model(*mCore, path, flipUVs));
+
+		UINT64 bytes = 0;
+		for (const ER_Mesh& mesh : aAsset.Model->Meshes())
+		{
+			AccumulateBytes(mesh.Vertices(), bytes);
+			AccumulateBytes(mesh.Normals(), bytes);
+			AccumulateBytes(mesh.Tangents(), bytes);
+			AccumulateBytes(mesh.BiNormals(), bytes);
+			for (const auto& uvs : mesh.TextureCoordinates())
+				AccumulateBytes(uvs, bytes);
+			for (const auto& colors : mesh.VertexColors())
+				AccumulateBytes(colors, bytes);
+			AccumulateBytes(mesh.Indices(), bytes);
+		}
+		aAsset.CPUBytes = bytes;
+	}
+
+	void ER_AssetRegistry::ReleaseModel(ER_ModelAsset* aAsset)
+	{
+		if (!aAsset)
+			return;
+
+		std::lock_guard<std::mutex> lock(mMutex);
+		assert(aAsset->RefCount > 0);
+		if (--aAsset->RefCount > 0)
+			return;
+
+		auto it = mModels.find(aAsset->Path);
+		assert(it != mModels.end());
+		DeletePointerCollection(it->second->RenderBuffers);
+		mModels.erase(it);
+		ResetRequestCountersIfEmpty();
+	}
+
+	const std::vector<RenderBufferData*>& ER_AssetRegistry::GetRenderBuffers(ER_ModelAsset* aAsset)
+	{
+		assert(aAsset && aAsset->Model);
+		std::call_once(aAsset->RenderBuffersCreatedFlag, [&]() { CreateRenderBuffers(*aAsset); });
+		return aAsset->RenderBuffers;
+	}
+
+	void ER_AssetRegistry::CreateRenderBuffers(ER_ModelAsset& aAsset)
+	{
+		ER_RHI* rhi = mCore->GetRHI();
+
+		UINT64 bytes = 0;
+		for (size_t i = 0; i < aAsset.Model->Meshes().size(); i++)
+		{
+			const ER_Mesh& mesh = aAsset.Model->GetMesh(static_cast<int>(i));
+			const std::string name = aAsset.Model->GetFileName() + ", mesh: " + std::to_string(i);
+
+			RenderBufferData* buffers = new RenderBufferData();
+			buffers->VertexBuffer = rhi->CreateGPUBuffer("ER_RHI_GPUBuffer: ER_AssetRegistry - Vertex Buffer: " + name);
+			mesh.CreateVertexBuffer_PositionUvNormalTangent(buffers->VertexBuffer);
+			buffers->IndexBuffer = rhi->CreateGPUBuffer("ER_RHI_GPUBuffer: ER_AssetRegistry - Index Buffer: " + name);
+			mesh.CreateIndexBuffer(buffers->IndexBuffer);
+			buffers->IndicesCount = static_cast<UINT>(mesh.Indices().size());
+			buffers->Stride = sizeof(VertexPositionTextureNormalTangent);
+			buffers->Offset = 0;
+
+			bytes += buffers->VertexBuffer->GetSize() + buffers->IndexBuffer->GetSize();
+			aAsset.RenderBuffers.push_back(buffers);
+		}
+		aAsset.GPUBytes = bytes;
+	}
+
+	void ER_AssetRegistry::AcquireTexture(const std::wstring& path, bool isPlaceholder, ER_RHI_GPUTexture** aUser)
+	{
+		assert(aUser && !*aUser);
+		const std::wstring key = GetCanonicalPath(path);
+
+		ER_TextureAsset* asset = nullptr;
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			std::unique_ptr<ER_TextureAsset>& entry = mTextures[key];
+			if (!entry)
+			{
+				entry.reset(new ER_TextureAsset());
+				entry->Path = key;
+			}
+			asset = entry.get();
+			asset->PendingUsers++;
+			mTextureRequests++;
+		}
+
+		std::call_once(asset->TextureLoadedFlag, [&]() { LoadTexture(*asset, path, isPlaceholder); });
+
+		std::lock_guard<std::mutex> lock(mMutex);
+		asset->PendingUsers--;
+		asset->Users.push_back(aUser);
+		*aUser = asset->Texture;
+	}
+
+	// Finds the residency levels of the texture: quality postfixes from the lowest (i.e., "_lq", then "_mq", then "_hq") and then the original path.
+	// Only the lowest one is loaded here, the rest is streamed in UpdateTextureStreaming().
+	void ER_AssetRegistry::LoadTexture(ER_TextureAsset& aAsset, const std::wstring& path, bool isPlaceholder)
+	{
+		ER_RHI* rhi = mCore->GetRHI();
+
+		const int extensionSymbolCount = 4; // .png, .dds, etc.
+		const wchar_t* postfixQuality[RenderingObjectTextureQuality::OBJECT_TEXTURE_COUNT] =
+		{
+			 L"_lq",
+			 L"_mq",
+			 L"_hq"
+		};
+
+		std::vector<std::wstring> levelPaths;
+		for (int i = 0; i < RenderingObjectTextureQuality::OBJECT_TEXTURE_COUNT; i++)
+		{
+			std::wstring possiblePath = path;
+			possiblePath.insert(path.length() - extensionSymbolCount, std::wstring(postfixQuality[i]));
+			if (IsFileExisting(possiblePath))
+				levelPaths.push_back(possiblePath);
+		}
+		if (levelPaths.empty() || IsFileExisting(path)) // the texture does not have postfixes (or we will load the fallback)
+			levelPaths.push_back(path);
+
+		ER_RHI_GPUTexture* texture = rhi->CreateGPUTexture(L"");
+		texture->CreateGPUTextureResource(rhi, levelPaths[0], true);
+
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			aAsset.LevelPaths = levelPaths;
+			aAsset.Texture = aAsset.TailTexture = texture;
+			aAsset.TailGPUBytes = GetTextureBytes(texture);
+			aAsset.IsPlaceholder = isPlaceholder;
+			aAsset.IsLoaded = true;
+			mTexturesByResource[texture] = &aAsset;
+		}
+
+		if (!isPlaceholder)
+		{
+			const std::wstring key = aAsset.Path;
+			rhi->GenerateMipsWithTextureReplacement(&aAsset.TailTexture,
+				[this, key](ER_RHI_GPUTexture** aNewTextureWithMips)
+				{
+					ReplaceTextureWithMipped(key, aNewTextureWithMips);
+				}
+			);
+		}
+	}
+
+	void ER_AssetRegistry::ReplaceTextureWithMipped(const std::wstring& key, ER_RHI_GPUTexture** aNewTexture)
+	{
+		assert(*aNewTexture);
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		auto it = mTextures.find(key);
+		if (it == mTextures.end()) // all users released the texture before the mips were ready
+		{
+			DeleteObject(*aNewTexture);
+			return;
+		}
+
+		ER_TextureAsset& asset = *it->second;
+		const bool isTailCurrent = (asset.Texture == asset.TailTexture);
+		mTexturesByResource.erase(asset.TailTexture);
+		DeleteObject(asset.TailTexture);
+
+		asset.TailTexture = *aNewTexture;
+		asset.TailGPUBytes = asset.TailGPUBytes * 4 / 3;
+		mTexturesByResource[asset.TailTexture] = &asset;
+		if (isTailCurrent) // otherwise a streamed level is in use and the tail is swapped in when it gets dropped
+		{
+			asset.Texture = asset.TailTexture;
+			for (ER_RHI_GPUTexture** user : asset.Users)
+				*user = asset.Texture;
+		}
+	}
+
+	void ER_AssetRegistry::ReleaseTexture(ER_RHI_GPUTexture** aUser)
+	{
+		if (!aUser || !*aUser)
+			return;
+
+		std::lock_guard<std::mutex> lock(mMutex);
+		auto resourceIt = mTexturesByResource.find(*aUser);
+		assert(resourceIt != mTexturesByResource.end());
+		*aUser = nullptr;
+		if (resourceIt == mTexturesByResource.end())
+			return;
+
+		ER_TextureAsset* asset = resourceIt->second;
+		asset->Users.erase(std::remove(asset->Users.begin(), asset->Users.end(), aUser), asset->Users.end());
+		if (asset->Users.empty() && asset->PendingUsers == 0)
+		{
+			DeleteTextureAsset(mTextures.find(asset->Path));
+			ResetRequestCountersIfEmpty();
+		}
+	}
+
+	// so that the statistics are per level (all assets are released when the level is unloaded)
+	void ER_AssetRegistry::ResetRequestCountersIfEmpty()
+	{
+		if (mModels.empty() && mTextures.empty())
+		{
+			mModelRequests = 0;
+			mTextureRequests = 0;
+			mStreamingStats = ER_TextureStreamingStats();
+		}
+	}
+
+	// the textures can still be used by the GPU in the frames in flight (level unloads wait for the GPU, so the objects can be deleted right away)
+	void ER_AssetRegistry::DeleteTextureAsset(std::unordered_map<std::wstring, std::unique_ptr<ER_TextureAsset>>::iterator it)
+	{
+		assert(it != mTextures.end());
+		ER_TextureAsset& asset = *it->second;
+		if (asset.Texture != asset.TailTexture)
+		{
+			mTexturesByResource.erase(asset.Texture);
+			DeleteObject(asset.Texture);
+		}
+		mTexturesByResource.erase(asset.TailTexture);
+		DeleteObject(asset.TailTexture);
+		mTextures.erase(it); // a read in flight keeps its own data alive
+	}
+
+	UINT64 ER_AssetRegistry::GetTextureBudgetForQuality(int quality)
+	{
+		const UINT64 budgetsMB[RenderingObjectTextureQuality::OBJECT_TEXTURE_COUNT] = { 256, 512, 1024 };
+		quality = std::max(0, std::min(quality, RenderingObjectTextureQuality::OBJECT_TEXTURE_COUNT - 1));
+		return budgetsMB[quality] * 1024 * 1024;
+	}
+
+	// Called by the users of the texture every frame it is visible: max screen size and min distance of the frame are kept
+	void ER_AssetRegistry::RequestTextureStreaming(ER_RHI_GPUTexture* aTexture, float aScreenSize, float aDistance)
+	{
+		if (!aTexture)
+			return;
+
+		std::lock_guard<std::mutex> lock(mMutex);
+		auto it = mTexturesByResource.find(aTexture);
+		if (it == mTexturesByResource.end())
+			return;
+
+		ER_TextureAsset& asset = *it->second;
+		if (asset.LastRequestFrame != mStreamingFrameIndex)
+		{
+			asset.LastRequestFrame = mStreamingFrameIndex;
+			asset.RequestedScreenSize = 0.0f;
+			asset.RequestedDistance = FLT_MAX;
+		}
+		asset.RequestedScreenSize = std::max(asset.RequestedScreenSize, aScreenSize);
+		asset.RequestedDistance = std::min(asset.RequestedDistance, aDistance);
+	}
+
+	// Lowest level that covers the requested screen size (every level is expected to double the resolution of the previous one)
+	int ER_AssetRegistry::GetDesiredTextureLevel(const ER_TextureAsset& aAsset) const
+	{
+		if (aAsset.LastRequestFrame == 0 || mStreamingFrameIndex - aAsset.LastRequestFrame > ER_TEXTURE_STREAMING_UNUSED_FRAMES)
+			return 0;
+
+		const int maxLevel = static_cast<int>(aAsset.LevelPaths.size()) - 1;
+		const float tailSize = static_cast<float>(std::max(aAsset.TailTexture->GetWidth(), aAsset.TailTexture->GetHeight()));
+		int level = 0;
+		while (level < maxLevel && tailSize * static_cast<float>(1 << level) < aAsset.RequestedScreenSize)
+			level++;
+		return level;
+	}
+
+	UINT64 ER_AssetRegistry::EstimateTextureLevelBytes(const ER_TextureAsset& aAsset, int level) const
+	{
+		return (level > 0) ? (aAsset.TailGPUBytes << (2 * level)) : 0;
+	}
+
+	void ER_AssetRegistry::StartTextureRead(ER_TextureAsset& aAsset, int level)
+	{
+		assert(!aAsset.PendingRead);
+		assert(level > 0 && level < static_cast<int>(aAsset.LevelPaths.size()));
+
+		std::shared_ptr<ER_TextureStreamingRead> read = std::make_shared<ER_TextureStreamingRead>();
+		read->Level = level;
+		read->Path = aAsset.LevelPaths[level];
+		aAsset.PendingRead = read;
+
+		if (mJobSystem)
+			mJobSystem->Execute([read]() { read->IsSuccessful = ReadTextureFile(read->Path, read->Data); }, read->PendingJobs);
+		else
+			read->IsSuccessful = ReadTextureFile(read->Path, read->Data);
+	}
+
+	// Creates the GPU texture from the finished read (the upload is recorded into the current command list)
+	bool ER_AssetRegistry::FinishTextureRead(ER_TextureAsset& aAsset)
+	{
+		std::shared_ptr<ER_TextureStreamingRead> read = aAsset.PendingRead;
+		aAsset.PendingRead.reset();
+		assert(read && read->PendingJobs == 0);
+
+		ER_RHI* rhi = mCore->GetRHI();
+		ER_RHI_GPUTexture* texture = nullptr;
+		bool loadStatus = false;
+		if (read->IsSuccessful)
+		{
+			texture = rhi->CreateGPUTexture(L"");
+			texture->CreateGPUTextureResource(rhi, read->Data.data(), static_cast<UINT64>(read->Data.size()), &loadStatus);
+		}
+		mStreamingStats.ReadBytes += read->Data.size();
+
+		if (!loadStatus)
+		{
+			DeleteObject(texture);
+			mStreamingStats.FailedReadsCount++;
+			aAsset.LevelPaths.resize(read->Level); // we won't try this level (and the ones above) again
+			std::string message = "[ER Logger][ER_AssetRegistry] Failed to stream texture: " + ToNarrowString(read->Path) + "\n";
+			ER_OUTPUT_LOG(ER_Utility::ToWideString(message).c_str());
+			return false;
+		}
+
+		ER_RHI_GPUTexture* mippedTexture = rhi->GenerateMipsIntoNewTexture(texture);
+		if (mippedTexture)
+		{
+			RetireTexture(texture);
+			texture = mippedTexture;
+		}
+
+		SetStreamedTexture(aAsset, texture, read->Level);
+		mStreamingStats.StreamedInCount++;
+		return true;
+	}
+
+	// nullptr drops the streamed level (the tail is used again)
+	void ER_AssetRegistry::SetStreamedTexture(ER_TextureAsset& aAsset, ER_RHI_GPUTexture* aTexture, int level)
+	{
+		if (aAsset.Texture != aAsset.TailTexture)
+		{
+			mTexturesByResource.erase(aAsset.Texture);
+			RetireTexture(aAsset.Texture);
+		}
+
+		aAsset.Texture = aTexture ? aTexture : aAsset.TailTexture;
+		aAsset.ResidentLevel = aTexture ? level : 0;
+		aAsset.StreamedGPUBytes = aTexture ? GetTextureBytes(aTexture) : 0;
+		if (aTexture)
+			mTexturesByResource[aTexture] = &aAsset;
+
+		for (ER_RHI_GPUTexture** user : aAsset.Users)
+			*user = aAsset.Texture;
+	}
+
+	void ER_AssetRegistry::RetireTexture(ER_RHI_GPUTexture* aTexture)
+	{
+		if (aTexture)
+			mRetiredTextures.push_back(std::make_pair(aTexture, mStreamingFrameIndex));
+	}
+
+	void ER_AssetRegistry::DeleteRetiredTextures(bool all)
+	{
+		auto it = std::remove_if(mRetiredTextures.begin(), mRetiredTextures.end(),
+			[&](std::pair<ER_RHI_GPUTexture*, UINT64>& retired)
+			{
+				if (!all && mStreamingFrameIndex - retired.second < ER_TEXTURE_STREAMING_RETIRE_FRAMES)
+					return false;
+				DeleteObject(retired.first);
+				return true;
+			});
+		mRetiredTextures.erase(it, mRetiredTextures.end());
+	}
+
+	// Main thread, once per frame after all RequestTextureStreaming() calls (GPU textures are created here, so the uploads go into the current command list):
+	// 1) creates GPU textures from the finished reads (limited per frame),
+	// 2) drops the levels that are not needed anymore and, if we are over the budget, the farthest streamed levels,
+	// 3) starts the reads of the most needed levels (largest on screen first, then nearest) while they fit into the budget.
+	void ER_AssetRegistry::UpdateTextureStreaming()
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		DeleteRetiredTextures(false);
+
+		struct StreamingCandidate
+		{
+			ER_TextureAsset* Asset;
+			int DesiredLevel;
+		};
+		std::vector<StreamingCandidate> candidates;
+
+		UINT creationsCount = 0;
+		UINT readsInFlight = 0;
+		UINT64 committedBytes = 0; // resident + reads in flight
+		for (auto& texture : mTextures)
+		{
+			ER_TextureAsset& asset = *texture.second;
+			if (!asset.IsLoaded)
+				continue;
+
+			if (asset.PendingRead && asset.PendingRead->PendingJobs == 0 && creationsCount < ER_TEXTURE_STREAMING_MAX_CREATIONS_PER_FRAME)
+			{
+				FinishTextureRead(asset);
+				creationsCount++;
+			}
+
+			committedBytes += asset.GetGPUBytes();
+			if (asset.PendingRead)
+			{
+				readsInFlight++;
+				committedBytes += EstimateTextureLevelBytes(asset, asset.PendingRead->Level);
+				continue;
+			}
+
+			if (asset.IsPlaceholder || asset.LevelPaths.size() < 2)
+				continue;
+
+			const int desiredLevel = GetDesiredTextureLevel(asset);
+			if (desiredLevel == 0 && asset.ResidentLevel > 0)
+			{
+				committedBytes -= asset.StreamedGPUBytes;
+				SetStreamedTexture(asset, nullptr, 0);
+				mStreamingStats.DroppedCount++;
+			}
+			else if (desiredLevel != asset.ResidentLevel)
+				candidates.push_back({ &asset, desiredLevel });
+		}
+
+		// over the budget (i.e., it was lowered): drop the farthest streamed levels
+		if (committedBytes > mTextureBudgetBytes)
+		{
+			std::vector<ER_TextureAsset*> streamed;
+			for (auto& texture : mTextures)
+				if (texture.second->ResidentLevel > 0)
+					streamed.push_back(texture.second.get());
+			std::sort(streamed.begin(), streamed.end(), [](const ER_TextureAsset* a, const ER_TextureAsset* b)
+				{
+					return a->RequestedDistance > b->RequestedDistance;
+				});
+			for (ER_TextureAsset* asset : streamed)
+			{
+				if (committedBytes <= mTextureBudgetBytes)
+					break;
+				committedBytes -= asset->StreamedGPUBytes;
+				SetStreamedTexture(*asset, nullptr, 0);
+				mStreamingStats.DroppedCount++;
+			}
+			candidates.clear(); // no new reads until we are back under the budget
+		}
+
+		std::sort(candidates.begin(), candidates.end(), [](const StreamingCandidate& a, const StreamingCandidate& b)
+			{
+				if (a.Asset->RequestedScreenSize != b.Asset->RequestedScreenSize)
+					return a.Asset->RequestedScreenSize > b.Asset->RequestedScreenSize;
+				return a.Asset->RequestedDistance < b.Asset->RequestedDistance;
+			});
+		for (StreamingCandidate& candidate : candidates)
+		{
+			if (readsInFlight >= ER_TEXTURE_STREAMING_MAX_READS_IN_FLIGHT)
+				break;
+
+			// the current level stays resident until the new one is ready
+			const UINT64 levelBytes = EstimateTextureLevelBytes(*candidate.Asset, candidate.DesiredLevel);
+			if (committedBytes + levelBytes > mTextureBudgetBytes)
+				continue;
+
+			StartTextureRead(*candidate.Asset, candidate.DesiredLevel);
+			committedBytes += levelBytes;
+			readsInFlight++;
+		}
+
+		mStreamingStats.ReadsInFlight = readsInFlight;
+		mStreamingStats.ResidentBytes = 0;
+		for (auto& texture : mTextures)
+			mStreamingStats.ResidentBytes += texture.second->GetGPUBytes();
+
+		mStreamingFrameIndex++;
+	}
+
+	void ER_AssetRegistry::ShowStatisticsImGui()
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		UINT64 totalModelsCPUBytes = 0, totalModelsGPUBytes = 0, totalTexturesBytes = 0;
+		for (auto& model : mModels)
+		{
+			totalModelsCPUBytes += model.second->CPUBytes;
+			totalModelsGPUBytes += model.second->GPUBytes;
+		}
+		for (auto& texture : mTextures)
+			totalTexturesBytes += texture.second->GetGPUBytes();
+
+		ImGui::Text("Models: %d (requested: %d), CPU: %s, GPU: %s", static_cast<int>(mModels.size()), mModelRequests,
+			FormatMegabytes(totalModelsCPUBytes).c_str(), FormatMegabytes(totalModelsGPUBytes).c_str());
+		ImGui::Text("Textures: %d (requested: %d), GPU (approx.): %s", static_cast<int>(mTextures.size()), mTextureRequests,
+			FormatMegabytes(totalTexturesBytes).c_str());
+
+		int budgetMB = static_cast<int>(mTextureBudgetBytes / (1024 * 1024));
+		if (ImGui::SliderInt("Texture streaming budget (MB)", &budgetMB, 64, 4096))
+			mTextureBudgetBytes = static_cast<UINT64>(budgetMB) * 1024 * 1024;
+		ImGui::Text("Texture streaming: streamed in: %d, dropped: %d, failed: %d, reads in flight: %d, read: %s", mStreamingStats.StreamedInCount,
+			mStreamingStats.DroppedCount, mStreamingStats.FailedReadsCount, mStreamingStats.ReadsInFlight, FormatMegabytes(mStreamingStats.ReadBytes).c_str());
+
+		if (ImGui::TreeNode("Models"))
+		{
+			for (auto& model : mModels)
+				ImGui::Text("[x%d] CPU: %s, GPU: %s - %s", model.second->RefCount,
+					FormatMegabytes(model.second->CPUBytes).c_str(), FormatMegabytes(model.second->GPUBytes).c_str(), model.first.c_str());
+			ImGui::TreePop();
+		}
+		if (ImGui::TreeNode("Textures"))
+		{
+			for (auto& texture : mTextures)
+			{
+				ImGui::Text("[x%d] GPU: %s, level: %d/%d - %s", static_cast<int>(texture.second->Users.size()),
+					FormatMegabytes(texture.second->GetGPUBytes()).c_str(), texture.second->ResidentLevel,
+					std::max(static_cast<int>(texture.second->LevelPaths.size()) - 1, 0), ToNarrowString(texture.first).c_str());
+			}
+			ImGui::TreePop();
+		}
+	}
+
+	void ER_AssetRegistry::LogStatistics()
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		std::string message = "[ER Logger][ER_AssetRegistry] Models: " + std::to_string(mModels.size()) + " (requested: " + std::to_string(mModelRequests) + ")\n";
+		for (auto& model : mModels)
+			message += "    [x" + std::to_string(model.second->RefCount) + "] CPU: " + FormatMegabytes(model.second->CPUBytes) +
+				", GPU: " + FormatMegabytes(model.second->GPUBytes) + " - " + model.first + "\n";
+		ER_OUTPUT_LOG(ER_Utility::ToWideString(message).c_str());
+
+		message = "[ER Logger][ER_AssetRegistry] Textures: " + std::to_string(mTextures.size()) + " (requested: " + std::to_string(mTextureRequests) + ")" +
+			", streaming budget: " + FormatMegabytes(mTextureBudgetBytes) + ", streamed in: " + std::to_string(mStreamingStats.StreamedInCount) +
+			", dropped: " + std::to_string(mStreamingStats.DroppedCount) + ", failed: " + std::to_string(mStreamingStats.FailedReadsCount) + "\n";
+		for (auto& texture : mTextures)
+			message += "    [x" + std::to_string(texture.second->Users.size()) + "] GPU (approx.): " + FormatMegabytes(texture.second->GetGPUBytes()) +
+				", level: " + std::to_string(texture.second->ResidentLevel) + " - " + ToNarrowString(texture.first) + "\n";
+		ER_OUTPUT_LOG(ER_Utility::ToWideString(message).c_str());
+	}
+}
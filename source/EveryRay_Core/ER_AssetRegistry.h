@@ -0,0 +1,146 @@
+#pragma once
+#include "Common.h"
+#include "ER_CoreComponent.h"
+
+#include "RHI/ER_RHI.h"
+
+#include <atomic>
+
+#define ER_TEXTURE_STREAMING_MAX_READS_IN_FLIGHT 4 // file reads on the job system
+#define ER_TEXTURE_STREAMING_MAX_CREATIONS_PER_FRAME 2 // GPU textures created from the finished reads (decoding happens on the main thread)
+#define ER_TEXTURE_STREAMING_RETIRE_FRAMES 3 // replaced textures are deleted after this many frames (the GPU can still read them)
+#define ER_TEXTURE_STREAMING_UNUSED_FRAMES 120 // streamed levels of textures that were not requested for this many frames are dropped
+
+namespace EveryRay_Core
+{
+	class ER_Model;
+	class ER_JobSystem;
+	struct RenderBufferData;
+
+	// Immutable data of one model file shared between all rendering objects (and their LODs) that reference it:
+	// CPU meshes (ER_Model) and GPU vertex/index buffers (created on the first request)
+	struct ER_ModelAsset
+	{
+		std::string Path; // canonical path (key in the registry)
+		std::unique_ptr<ER_Model> Model;
+		std::vector<RenderBufferData*> RenderBuffers; // per mesh (PositionUvNormalTangent layout)
+		UINT RefCount = 0;
+		UINT64 CPUBytes = 0; // mesh data
+		UINT64 GPUBytes = 0; // vertex + index buffers
+
+		std::once_flag ModelLoadedFlag;
+		std::once_flag RenderBuffersCreatedFlag;
+	};
+
+	// Read of one residency level of a texture on the job system (file I/O only, the GPU texture is created on the main thread).
+	// Shared with the job, so the asset (or the registry) can go away while the read is in flight.
+	struct ER_TextureStreamingRead
+	{
+		int Level = 0;
+		std::wstring Path;
+		std::vector<UINT8> Data;
+		bool IsSuccessful = false;
+		std::atomic<int> PendingJobs { 0 }; // ER_JobCounter
+	};
+
+	// Residency levels of a texture are its files on disk: quality variants ("_lq", "_mq", "_hq" postfixes) and then the original path.
+	// The lowest level ("mip tail") is loaded on acquire and always stays resident; one higher level at a time is streamed in/out at runtime.
+	struct ER_TextureAsset
+	{
+		std::wstring Path; // canonical path (key in the registry)
+		std::vector<std::wstring> LevelPaths; // lowest first
+		ER_RHI_GPUTexture* Texture = nullptr; // current one (tail or streamed), written into all users
+		ER_RHI_GPUTexture* TailTexture = nullptr;
+		std::vector<ER_RHI_GPUTexture**> Users; // pointers that reference the texture (patched when the texture gets replaced with its mipped or streamed version)
+		UINT PendingUsers = 0; // threads that are acquiring the texture right now (keeps the asset alive)
+		UINT64 TailGPUBytes = 0; // approximate (4 bytes per texel + mip chain)
+		UINT64 StreamedGPUBytes = 0; // 0 if only the tail is resident
+		int ResidentLevel = 0; // of 'Texture'
+		bool IsLoaded = false; // tail is ready (streaming skips the asset before that)
+		bool IsPlaceholder = false; // never streamed
+
+		// streaming requests of the last frame the texture was requested in (see RequestTextureStreaming())
+		float RequestedScreenSize = 0.0f; // max over all users, in pixels
+		float RequestedDistance = FLT_MAX; // min over all users
+		UINT64 LastRequestFrame = 0;
+		std::shared_ptr<ER_TextureStreamingRead> PendingRead;
+
+		std::once_flag TextureLoadedFlag;
+
+		UINT64 GetGPUBytes() const { return TailGPUBytes + StreamedGPUBytes; }
+	};
+
+	struct ER_TextureStreamingStats
+	{
+		UINT StreamedInCount = 0;
+		UINT DroppedCount = 0; // streamed levels that were dropped (budget or unused)
+		UINT FailedReadsCount = 0;
+		UINT ReadsInFlight = 0;
+		UINT64 ReadBytes = 0;
+		UINT64 ResidentBytes = 0; // all textures of the registry
+	};
+
+	// Reference-counted registry of models and textures keyed by canonical paths, so that the same file is loaded once per level
+	// no matter how many rendering objects (or LODs) use it. Available as a core service (ER_CoreServicesContainer).
+	// Acquire*() are thread-safe (scene objects are loaded in parallel), loading happens outside of the registry lock.
+	class ER_AssetRegistry : public ER_CoreComponent
+	{
+		RTTI_DECLARATIONS(ER_AssetRegistry, ER_CoreComponent)
+
+	public:
+		ER_AssetRegistry(ER_Core& game);
+		~ER_AssetRegistry();
+
+		ER_ModelAsset* AcquireModel(const std::string& path, bool flipUVs = true);
+		void ReleaseModel(ER_ModelAsset* aAsset);
+		const std::vector<RenderBufferData*>& GetRenderBuffers(ER_ModelAsset* aAsset);
+
+		// Loads the lowest residency level of the texture and writes it into 'aUser' (higher levels are streamed later);
+		// 'aUser' must stay valid until ReleaseTexture() as it gets patched after the mips generation and on every streaming change.
+		void AcquireTexture(const std::wstring& path, bool isPlaceholder, ER_RHI_GPUTexture** aUser);
+		void ReleaseTexture(ER_RHI_GPUTexture** aUser);
+
+		// Texture streaming (main thread): users report how large (in pixels) and how far their textures are every frame,
+		// then UpdateTextureStreaming() picks residency levels within the budget (nearest/largest first) and swaps the finished ones
+		void RequestTextureStreaming(ER_RHI_GPUTexture* aTexture, float aScreenSize, float aDistance);
+		void UpdateTextureStreaming();
+		void SetTextureBudget(UINT64 aBytes) { mTextureBudgetBytes = aBytes; }
+		UINT64 GetTextureBudget() const { return mTextureBudgetBytes; }
+		static UINT64 GetTextureBudgetForQuality(int quality); // see RenderingObjectTextureQuality
+
+		void ShowStatisticsImGui();
+		void LogStatistics();
+
+		static std::string GetCanonicalPath(const std::string& path);
+		static std::wstring GetCanonicalPath(const std::wstring& path);
+	private:
+		void LoadModel(ER_ModelAsset& aAsset, const std::string& path, bool flipUVs);
+		void CreateRenderBuffers(ER_ModelAsset& aAsset);
+		void LoadTexture(ER_TextureAsset& aAsset, const std::wstring& path, bool isPlaceholder);
+		void ReplaceTextureWithMipped(const std::wstring& key, ER_RHI_GPUTexture** aNewTexture);
+		void ResetRequestCountersIfEmpty();
+		void DeleteTextureAsset(std::unordered_map<std::wstring, std::unique_ptr<ER_TextureAsset>>::iterator it);
+
+		int GetDesiredTextureLevel(const ER_TextureAsset& aAsset) const;
+		UINT64 EstimateTextureLevelBytes(const ER_TextureAsset& aAsset, int level) const;
+		void StartTextureRead(ER_TextureAsset& aAsset, int level);
+		bool FinishTextureRead(ER_TextureAsset& aAsset); // returns true if a GPU texture was created
+		void SetStreamedTexture(ER_TextureAsset& aAsset, ER_RHI_GPUTexture* aTexture, int level);
+		void RetireTexture(ER_RHI_GPUTexture* aTexture);
+		void DeleteRetiredTextures(bool all);
+
+		std::unordered_map<std::string, std::unique_ptr<ER_ModelAsset>> mModels;
+		std::unordered_map<std::wstring, std::unique_ptr<ER_TextureAsset>> mTextures;
+		std::unordered_map<ER_RHI_GPUTexture*, ER_TextureAsset*> mTexturesByResource;
+		std::mutex mMutex;
+
+		UINT mModelRequests = 0;
+		UINT mTextureRequests = 0;
+
+		ER_JobSystem* mJobSystem = nullptr;
+		std::vector<std::pair<ER_RHI_GPUTexture*, UINT64>> mRetiredTextures; // with the frame they were retired in
+		UINT64 mTextureBudgetBytes = 0;
+		UINT64 mStreamingFrameIndex = 1;
+		ER_TextureStreamingStats mStreamingStats;
+	};
+}
@@ -1,11 +1,94 @@
 #include "ER_CPUProfiler.h"
 #include "ER_Utility.h"
 
+#include <algorithm>
+#include <iomanip>
+
 namespace EveryRay_Core {
-	
-	ER_CPUProfiler::ER_CPUProfiler()
+
+	namespace
+	{
+		const char* sFrameScopeName = "Frame";
+
+		// Keeps the buffer of the thread alive until the thread exits (then it is retired and removed by the profiler)
+		struct ThreadRegistration
+		{
+			ER_CPUProfiler* Owner = nullptr;
+			std::shared_ptr<ER_CPUProfilerThreadBuffer> Buffer;
+
+			~ThreadRegistration()
+			{
+				if (Buffer)
+					Buffer->mIsRetired.store(true, std::memory_order_release);
+			}
+		};
+		thread_local ThreadRegistration tThreadRegistration;
+
+		std::string EscapeJson(const std::string& text)
+		{
+			std::string result;
+			for (char c : text)
+			{
+				if (c == '"' || c == '\\')
+					result += '\\';
+				result += c;
+			}
+			return result;
+		}
+	}
+
+	static_assert((ER_CPU_PROFILER_THREAD_BUFFER_SIZE & (ER_CPU_PROFILER_THREAD_BUFFER_SIZE - 1)) == 0, "ER_CPU_PROFILER_THREAD_BUFFER_SIZE must be a power of 2");
+
+	bool ER_CPUProfilerThreadBuffer::Push(const ER_CPUProfilerEvent& aEvent)
 	{
+		const UINT head = mHead.load(std::memory_order_relaxed);
+		const UINT next = (head + 1) & (ER_CPU_PROFILER_THREAD_BUFFER_SIZE - 1);
+		if (next == mTail.load(std::memory_order_acquire)) // full (the consumer is late), drop the event
+		{
+			mDroppedEvents.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+
+		mEvents[head] = aEvent;
+		mHead.store(next, std::memory_order_release);
+		return true;
+	}
+
+	template<typename Func>
+	void ER_CPUProfilerThreadBuffer::Drain(Func aFunc)
+	{
+		UINT tail = mTail.load(std::memory_order_relaxed);
+		const UINT head = mHead.load(std::memory_order_acquire);
+		while (tail != head)
+		{
+			aFunc(mEvents[tail]);
+			tail = (tail + 1) & (ER_CPU_PROFILER_THREAD_BUFFER_SIZE - 1);
+		}
+		mTail.store(tail, std::memory_order_release);
+	}
+
+	void ER_CPUProfilerScopeStats::GetMinAvgMax(double& minMs, double& avgMs, double& maxMs) const
+	{
+		minMs = avgMs = maxMs = 0.0;
+		if (SamplesCount == 0)
+			return;
+
+		minMs = Samples[0];
+		maxMs = Samples[0];
+		double sum = 0.0;
+		for (UINT i = 0; i < SamplesCount; i++)
+		{
+			minMs = std::min(minMs, Samples[i]);
+			maxMs = std::max(maxMs, Samples[i]);
+			sum += Samples[i];
+		}
+		avgMs = sum / SamplesCount;
+	}
 
+	ER_CPUProfiler::ER_CPUProfiler()
+		: mEpoch(std::chrono::high_resolution_clock::now())
+	{
+		SetCurrentThreadName("Main thread"); // the profiler is created by ER_Core on the main thread
 	}
 
 	ER_CPUProfiler::~ER_CPUProfiler()
@@ -32,9 +115,235 @@ namespace EveryRay_Core {
 		else
 		{
 			std::chrono::duration<double> finalTime = endTimer - it->second;
-			std::string message = "[ER Logger][ER_CPUProfiler] CPU time of <" + aEventName + "> is " + std::to_string(finalTime.count()) + "s\n";
+			LogCPUTime(aEventName, finalTime.count());
+		}
+	}
+
+	void ER_CPUProfiler::LogCPUTime(const std::string& aEventName, double aTimeInSeconds)
+	{
+		std::string message = "[ER Logger][ER_CPUProfiler] CPU time of <" + aEventName + "> is " + std::to_string(aTimeInSeconds) + "s\n";
+		ER_OUTPUT_LOG(ER_Utility::ToWideString(message).c_str());
+	}
+
+	INT64 ER_CPUProfiler::Now() const
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - mEpoch).count();
+	}
+
+	// Main thread (EndFrame())
+	UINT64 ER_CPUProfiler::GetScopeNameHash(const char* aName)
+	{
+		auto it = mScopesNamesHashes.find(aName);
+		if (it == mScopesNamesHashes.end())
+			it = mScopesNamesHashes.emplace(aName, ER_Utility::HashFNV1a(aName, strlen(aName))).first;
+		return it->second;
+	}
+
+	ER_CPUProfilerThreadBuffer* ER_CPUProfiler::GetCurrentThreadBuffer()
+	{
+		if (tThreadRegistration.Owner != this)
+		{
+			std::lock_guard<std::mutex> lock(mThreadBuffersMutex);
+			const UINT index = mNextThreadIndex++;
+			const std::string name = "Thread " + std::to_string(index);
+
+			if (tThreadRegistration.Buffer)
+				tThreadRegistration.Buffer->mIsRetired.store(true, std::memory_order_release);
+			tThreadRegistration.Owner = this;
+			tThreadRegistration.Buffer = std::make_shared<ER_CPUProfilerThreadBuffer>(index, name);
+			mThreadBuffers.push_back(tThreadRegistration.Buffer);
+			mThreadNames[index] = name;
+		}
+		return tThreadRegistration.Buffer.get();
+	}
+
+	void ER_CPUProfiler::SetCurrentThreadName(const std::string& name)
+	{
+		ER_CPUProfilerThreadBuffer* buffer = GetCurrentThreadBuffer();
+
+		std::lock_guard<std::mutex> lock(mThreadBuffersMutex);
+		buffer->SetName(name);
+		mThreadNames[buffer->GetIndex()] = name;
+	}
+
+	INT64 ER_CPUProfiler::BeginScope()
+	{
+		GetCurrentThreadBuffer()->mDepth++;
+		return Now();
+	}
+
+	void ER_CPUProfiler::EndScope(const char* aName, INT64 aStart)
+	{
+		ER_CPUProfilerThreadBuffer* buffer = GetCurrentThreadBuffer();
+		assert(buffer->mDepth > 0);
+		buffer->mDepth--;
+
+		ER_CPUProfilerEvent scopeEvent;
+		scopeEvent.Name = aName;
+		scopeEvent.Start = aStart;
+		scopeEvent.End = Now();
+		scopeEvent.Depth = buffer->mDepth;
+		scopeEvent.ThreadIndex = buffer->GetIndex();
+		buffer->Push(scopeEvent);
+	}
+
+	void ER_CPUProfiler::BeginFrame()
+	{
+		mCurrentFrameStart = Now();
+		GetCurrentThreadBuffer()->mDepth++; // main thread's scopes are nested in the frame
+	}
+
+	void ER_CPUProfiler::EndFrame()
+	{
+		EndScope(sFrameScopeName, mCurrentFrameStart);
+
+		FrameRecord& frame = mFrames[mFrameIndex % ER_CPU_PROFILER_HISTORY_FRAMES];
+		frame.Start = mCurrentFrameStart;
+		frame.End = Now();
+		CollectEvents(frame);
+		mFrameIndex++;
+
+		// per-frame sums of every scope that was hit in this frame
+		for (const ER_CPUProfilerEvent& scopeEvent : frame.Events)
+		{
+			const UINT64 nameHash = GetScopeNameHash(scopeEvent.Name);
+			auto it = mScopesStats.find(nameHash);
+			if (it == mScopesStats.end())
+			{
+				it = mScopesStats.emplace(nameHash, ER_CPUProfilerScopeStats()).first;
+				it->second.Name = scopeEvent.Name;
+				mScopesOrder.push_back(nameHash);
+			}
+
+			ER_CPUProfilerScopeStats& stats = it->second;
+			const double durationMs = static_cast<double>(scopeEvent.End - scopeEvent.Start) / 1000000.0;
+			if (stats.LastFrameIndex != mFrameIndex)
+			{
+				stats.LastFrameIndex = mFrameIndex;
+				stats.CallsInLastFrame = 0;
+				stats.Samples[stats.NextSample] = 0.0;
+				stats.NextSample = (stats.NextSample + 1) % ER_CPU_PROFILER_HISTORY_FRAMES;
+				stats.SamplesCount = std::min(stats.SamplesCount + 1, static_cast<UINT>(ER_CPU_PROFILER_HISTORY_FRAMES));
+			}
+			stats.Samples[(stats.NextSample + ER_CPU_PROFILER_HISTORY_FRAMES - 1) % ER_CPU_PROFILER_HISTORY_FRAMES] += durationMs;
+			stats.CallsInLastFrame++;
+			stats.Depth = scopeEvent.Depth;
+			stats.ThreadIndex = scopeEvent.ThreadIndex;
+		}
+
+		const double frameMs = static_cast<double>(frame.End - frame.Start) / 1000000.0;
+		if (mExportTraceOnSpike && frameMs > mSpikeThresholdMs && mFrameIndex > mLastSpikeExportFrame + ER_CPU_PROFILER_HISTORY_FRAMES)
+		{
+			mLastSpikeExportFrame = mFrameIndex;
+			const std::string path = ER_Utility::GetFilePath(std::string(ER_CPU_PROFILER_TRACE_DIRECTORY) + "spike_frame_" + std::to_string(mFrameIndex) + ".json");
+			ExportChromeTrace(path);
+		}
+	}
+
+	// Moves finished scopes of all threads into the frame (events from worker threads that finish after EndFrame() go to the next frame)
+	void ER_CPUProfiler::CollectEvents(FrameRecord& aFrame)
+	{
+		aFrame.Events.clear();
+
+		std::lock_guard<std::mutex> lock(mThreadBuffersMutex);
+		for (auto it = mThreadBuffers.begin(); it != mThreadBuffers.end();)
+		{
+			ER_CPUProfilerThreadBuffer& buffer = **it;
+			const bool isRetired = buffer.mIsRetired.load(std::memory_order_acquire); // before draining, so that we don't lose the last events
+			buffer.Drain([&aFrame](const ER_CPUProfilerEvent& aEvent) { aFrame.Events.push_back(aEvent); });
+
+			const UINT dropped = buffer.mDroppedEvents.exchange(0, std::memory_order_relaxed);
+			if (dropped > 0)
+			{
+				std::string message = "[ER Logger][ER_CPUProfiler] Dropped " + std::to_string(dropped) + " scopes of <" + buffer.GetName() + ">, bump ER_CPU_PROFILER_THREAD_BUFFER_SIZE\n";
+				ER_OUTPUT_LOG(ER_Utility::ToWideString(message).c_str());
+			}
+
+			if (isRetired)
+				it = mThreadBuffers.erase(it);
+			else
+				++it;
+		}
+	}
+
+	bool ER_CPUProfiler::ExportChromeTrace(const std::string& path)
+	{
+		std::string directory;
+		ER_Utility::GetDirectory(path, directory);
+		ER_Utility::CreateDirectories(directory);
+
+		std::ofstream file(path.c_str(), std::ios::trunc);
+		if (!file.is_open())
+		{
+			std::string message = "[ER Logger][ER_CPUProfiler] Could not open file for writing: " + path + "\n";
 			ER_OUTPUT_LOG(ER_Utility::ToWideString(message).c_str());
+			return false;
+		}
+
+		// Trace Event Format: complete ("X") events with microsecond timestamps + thread names as metadata ("M") events
+		file << std::fixed << std::setprecision(3);
+		file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+		bool isFirst = true;
+		{
+			std::lock_guard<std::mutex> lock(mThreadBuffersMutex);
+			for (const auto& threadName : mThreadNames)
+			{
+				file << (isFirst ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << threadName.first <<
+					",\"args\":{\"name\":\"" << EscapeJson(threadName.second) << "\"}}";
+				isFirst = false;
+			}
+		}
+
+		const UINT64 framesCount = std::min(mFrameIndex, static_cast<UINT64>(ER_CPU_PROFILER_HISTORY_FRAMES));
+		for (UINT64 frameIndex = mFrameIndex - framesCount; frameIndex < mFrameIndex; frameIndex++)
+		{
+			for (const ER_CPUProfilerEvent& scopeEvent : mFrames[frameIndex % ER_CPU_PROFILER_HISTORY_FRAMES].Events)
+			{
+				file << (isFirst ? "" : ",\n") << "{\"name\":\"" << EscapeJson(scopeEvent.Name) << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << scopeEvent.ThreadIndex <<
+					",\"ts\":" << scopeEvent.Start / 1000.0 << ",\"dur\":" << (scopeEvent.End - scopeEvent.Start) / 1000.0 << "}";
+				isFirst = false;
+			}
 		}
+		file << "\n]}\n";
+		file.close();
+
+		if (file.fail())
+		{
+			std::string message = "[ER Logger][ER_CPUProfiler] Could not write Chrome trace: " + path + "\n";
+			ER_OUTPUT_LOG(ER_Utility::ToWideString(message).c_str());
+			return false;
+		}
+
+		std::string message = "[ER Logger][ER_CPUProfiler] Exported Chrome trace of the last " + std::to_string(framesCount) + " frames: " + path + "\n";
+		ER_OUTPUT_LOG(ER_Utility::ToWideString(message).c_str());
+		return true;
 	}
 
-}
\ No newline at end of file
+	void ER_CPUProfiler::ShowScopesImGui()
+	{
+		bool isEnabled = mIsEnabled;
+		if (ImGui::Checkbox("Record CPU scopes", &isEnabled))
+			mIsEnabled = isEnabled;
+
+		if (ImGui::Button("Export Chrome trace (last frames)"))
+			ExportChromeTrace(ER_Utility::GetFilePath(std::string(ER_CPU_PROFILER_TRACE_DIRECTORY) + "frame_" + std::to_string(mFrameIndex) + ".json"));
+		ImGui::Checkbox("Export Chrome trace on frame spikes", &mExportTraceOnSpike);
+		ImGui::SliderFloat("Spike threshold (ms)", &mSpikeThresholdMs, 1.0f, 200.0f);
+
+		ImGui::Text("Scope (min/avg/max ms over the last %d frames, calls in last frame)", ER_CPU_PROFILER_HISTORY_FRAMES);
+		std::string threadName;
+		for (UINT64 nameHash : mScopesOrder)
+		{
+			const ER_CPUProfilerScopeStats& stats = mScopesStats[nameHash];
+			double minMs, avgMs, maxMs;
+			stats.GetMinAvgMax(minMs, avgMs, maxMs);
+
+			{
+				std::lock_guard<std::mutex> lock(mThreadBuffersMutex);
+				threadName = mThreadNames[stats.ThreadIndex];
+			}
+			ImGui::Text("%*s%s [%s]: %.3f / %.3f / %.3f (x%d)", static_cast<int>(stats.Depth * 2), "", stats.Name, threadName.c_str(),
+				minMs, avgMs, maxMs, stats.CallsInLastFrame);
+		}
+	}
+}
@@ -1,11 +1,78 @@
 #pragma once
 #include "Common.h"
 #include <chrono>
+#include <atomic>
+
+#define ER_CPU_PROFILER_ENABLED 1
+#define ER_CPU_PROFILER_THREAD_BUFFER_SIZE 4096 // max # of scopes per thread per frame (power of 2)
+#define ER_CPU_PROFILER_HISTORY_FRAMES 64 // # of frames for rolling statistics and trace export
+#define ER_CPU_PROFILER_TRACE_DIRECTORY "content\\cache\\profiler\\"
+
+#define ER_CPU_PROFILER_CONCAT_IMPL(a, b) a##b
+#define ER_CPU_PROFILER_CONCAT(a, b) ER_CPU_PROFILER_CONCAT_IMPL(a, b)
+#if ER_CPU_PROFILER_ENABLED
+// Profiles the enclosing scope; 'name' must be a string literal (or live as long as the profiler)
+#define ER_CPU_PROFILE_SCOPE(profiler, name) EveryRay_Core::ER_CPUProfileScope ER_CPU_PROFILER_CONCAT(cpuProfileScope, __LINE__)(profiler, name)
+#else
+#define ER_CPU_PROFILE_SCOPE(profiler, name)
+#endif
 
 namespace EveryRay_Core
 {
 	typedef std::chrono::high_resolution_clock::time_point TimePoint;
 
+	struct ER_CPUProfilerEvent
+	{
+		const char* Name = nullptr;
+		INT64 Start = 0; // ns since the profiler's creation
+		INT64 End = 0;
+		UINT Depth = 0; // nesting level on its thread
+		UINT ThreadIndex = 0;
+	};
+
+	// Single-producer (owning thread) / single-consumer (main thread in EndFrame()) lock-free ring of finished scopes
+	class ER_CPUProfilerThreadBuffer
+	{
+	public:
+		ER_CPUProfilerThreadBuffer(UINT index, const std::string& name) : mIndex(index), mName(name) {}
+
+		bool Push(const ER_CPUProfilerEvent& aEvent);
+		template<typename Func> void Drain(Func aFunc);
+
+		UINT GetIndex() const { return mIndex; }
+		const std::string& GetName() const { return mName; }
+		void SetName(const std::string& name) { mName = name; }
+
+		UINT mDepth = 0; // accessed only by the owning thread
+		std::atomic<bool> mIsRetired { false }; // the owning thread has exited
+		std::atomic<UINT> mDroppedEvents { 0 };
+	private:
+		ER_CPUProfilerEvent mEvents[ER_CPU_PROFILER_THREAD_BUFFER_SIZE];
+		std::atomic<UINT> mHead { 0 }; // written by the producer
+		std::atomic<UINT> mTail { 0 }; // written by the consumer
+		UINT mIndex;
+		std::string mName;
+	};
+
+	// Rolling (last ER_CPU_PROFILER_HISTORY_FRAMES frames where the scope was hit) statistics of one scope
+	struct ER_CPUProfilerScopeStats
+	{
+		const char* Name = nullptr;
+		UINT Depth = 0; // of the latest occurrence
+		UINT ThreadIndex = 0; // of the latest occurrence
+		UINT CallsInLastFrame = 0;
+		double Samples[ER_CPU_PROFILER_HISTORY_FRAMES] = {}; // ms per frame (summed over calls)
+		UINT SamplesCount = 0;
+		UINT NextSample = 0;
+		UINT64 LastFrameIndex = 0;
+
+		void GetMinAvgMax(double& minMs, double& avgMs, double& maxMs) const;
+	};
+
+	// CPU profiler with two modes:
+	// - Begin/EndCPUTime(): one-shot timings that are written to the log (i.e., loading);
+	// - ER_CPU_PROFILE_SCOPE(): hierarchical per-frame scopes from any thread, which are collected in EndFrame() into
+	//   rolling min/avg/max statistics and a history of the last frames that can be exported as a Chrome trace (chrome://tracing).
 	class ER_CPUProfiler
 	{
 	public:
@@ -14,8 +81,80 @@ namespace EveryRay_Core
 
 		void BeginCPUTime(const std::string& aEventName, bool toLog = true);
 		void EndCPUTime(const std::string& aEventName);
+		void LogCPUTime(const std::string& aEventName, double aTimeInSeconds); // for events measured elsewhere (i.e., accumulated over threads)
+
+		// Frame boundaries (main thread)
+		void BeginFrame();
+		void EndFrame();
+
+		// Scope markers (any thread); use ER_CPU_PROFILE_SCOPE() instead of calling these directly
+		INT64 BeginScope();
+		void EndScope(const char* aName, INT64 aStart);
+
+		void SetCurrentThreadName(const std::string& name);
 
+		bool ExportChromeTrace(const std::string& path);
+		void ShowScopesImGui();
+
+		void SetEnabled(bool value) { mIsEnabled = value; }
+		bool IsEnabled() const { return mIsEnabled; }
 	private:
+		struct FrameRecord
+		{
+			INT64 Start = 0;
+			INT64 End = 0;
+			std::vector<ER_CPUProfilerEvent> Events;
+		};
+
+		INT64 Now() const;
+		UINT64 GetScopeNameHash(const char* aName);
+		ER_CPUProfilerThreadBuffer* GetCurrentThreadBuffer();
+		void CollectEvents(FrameRecord& aFrame);
+
 		std::map<std::string, TimePoint> mEventsCPUTime;
+
+		TimePoint mEpoch;
+		std::atomic<bool> mIsEnabled { true };
+		std::vector<std::shared_ptr<ER_CPUProfilerThreadBuffer>> mThreadBuffers;
+		std::map<UINT, std::string> mThreadNames; // of all threads that ever recorded (retired ones too; for the trace export)
+		std::mutex mThreadBuffersMutex;
+		UINT mNextThreadIndex = 0;
+
+		FrameRecord mFrames[ER_CPU_PROFILER_HISTORY_FRAMES];
+		UINT64 mFrameIndex = 0; // # of finished frames
+		INT64 mCurrentFrameStart = 0;
+		// keyed by the content of the name: the same literal can have different addresses (i.e., in different translation units)
+		std::unordered_map<UINT64, ER_CPUProfilerScopeStats> mScopesStats;
+		std::unordered_map<const char*, UINT64> mScopesNamesHashes; // every name address is hashed only once
+		std::vector<UINT64> mScopesOrder; // first-seen order (for display)
+
+		float mSpikeThresholdMs = 33.3f;
+		bool mExportTraceOnSpike = false;
+		UINT64 mLastSpikeExportFrame = 0;
+	};
+
+	class ER_CPUProfileScope
+	{
+	public:
+		ER_CPUProfileScope(ER_CPUProfiler* aProfiler, const char* aName)
+			: mProfiler(aProfiler), mName(aName)
+		{
+			if (mProfiler && mProfiler->IsEnabled())
+				mStart = mProfiler->BeginScope();
+			else
+				mProfiler = nullptr;
+		}
+		~ER_CPUProfileScope()
+		{
+			if (mProfiler)
+				mProfiler->EndScope(mName, mStart);
+		}
+	private:
+		ER_CPUProfileScope(const ER_CPUProfileScope& rhs);
+		ER_CPUProfileScope& operator=(const ER_CPUProfileScope& rhs);
+
+		ER_CPUProfiler* mProfiler;
+		const char* mName;
+		INT64 mStart = 0;
 	};
-}
\ No newline at end of file
+}
@@ -0,0 +1,604 @@
+#include "stdafx.h"
+#include <algorithm>
+#include <chrono>
+
+#include "ER_ClusteredLighting.h"
+#include "ER_Core.h"
+#include "ER_Camera.h"
+#include "ER_Frustum.h"
+#include "ER_PointLight.h"
+#include "ER_SpotLight.h"
+#include "ER_Utility.h"
+#include "ER_CoreException.h"
+
+#define CLUSTERED_LIGHTING_ROOT_DESCRIPTOR_TABLE_SRV_INDEX 0
+#define CLUSTERED_LIGHTING_ROOT_DESCRIPTOR_TABLE_UAV_INDEX 1
+#define CLUSTERED_LIGHTING_ROOT_DESCRIPTOR_TABLE_CBV_INDEX 2
+
+namespace EveryRay_Core
+{
+	using namespace ClusteredLightingCBufferData;
+
+	ER_ClusteredLighting::ER_ClusteredLighting(ER_Core& aCore)
+		: mCore(aCore)
+	{
+		ER_RHI* rhi = mCore.GetRHI();
+		assert(rhi);
+
+		mIsGPUBuild = IsGPUBuildSupported(rhi);
+		if (mIsGPUBuild)
+		{
+			mBuildClustersCS = rhi->CreateGPUShader();
+			mBuildClustersCS->CompileShader(rhi, "content\\shaders\\ClusteredLightCulling.hlsl", "CSBuildClusters", ER_COMPUTE);
+
+			mRootSignature = rhi->CreateRootSignature(3, 0);
+			if (mRootSignature)
+			{
+				mRootSignature->InitDescriptorTable(rhi, CLUSTERED_LIGHTING_ROOT_DESCRIPTOR_TABLE_SRV_INDEX, { ER_RHI_DESCRIPTOR_RANGE_TYPE::ER_RHI_DESCRIPTOR_RANGE_TYPE_SRV }, { 0 }, { 1 });
+				mRootSignature->InitDescriptorTable(rhi, CLUSTERED_LIGHTING_ROOT_DESCRIPTOR_TABLE_UAV_INDEX, { ER_RHI_DESCRIPTOR_RANGE_TYPE::ER_RHI_DESCRIPTOR_RANGE_TYPE_UAV }, { 0 }, { 2 });
+				mRootSignature->InitDescriptorTable(rhi, CLUSTERED_LIGHTING_ROOT_DESCRIPTOR_TABLE_CBV_INDEX, { ER_RHI_DESCRIPTOR_RANGE_TYPE::ER_RHI_DESCRIPTOR_RANGE_TYPE_CBV }, { 0 }, { 1 });
+				mRootSignature->Finalize(rhi, "ER_RHI_GPURootSignature: Clustered Lighting - Build Clusters Pass");
+			}
+
+			mCullingCB.Initialize(rhi, "ER_RHI_GPUBuffer: Clustered Lighting - Build Clusters CB");
+		}
+
+		mLightsBuffer = rhi->CreateGPUBuffer("ER_RHI_GPUBuffer: Clustered Lighting - Lights");
+		mLightsBuffer->CreateGPUBufferResource(rhi, nullptr, CLUSTERED_LIGHTING_MAX_LIGHTS, sizeof(ER_ClusteredLight), true, ER_BIND_SHADER_RESOURCE, 0, ER_RESOURCE_MISC_BUFFER_STRUCTURED);
+
+		// written by the compute pass or uploaded from the CPU build
+		const bool isDynamic = !mIsGPUBuild;
+		const ER_RHI_BIND_FLAG bindFlags = mIsGPUBuild ? (ER_BIND_SHADER_RESOURCE | ER_BIND_UNORDERED_ACCESS) : ER_BIND_SHADER_RESOURCE;
+		mClustersGridBuffer = rhi->CreateGPUBuffer("ER_RHI_GPUBuffer: Clustered Lighting - Clusters Grid");
+		mClustersGridBuffer->CreateGPUBufferResource(rhi, nullptr, CLUSTERED_LIGHTING_CLUSTERS_COUNT, sizeof(XMUINT2), isDynamic, bindFlags, 0, ER_RESOURCE_MISC_BUFFER_STRUCTURED);
+
+		mClustersLightIndicesBuffer = rhi->CreateGPUBuffer("ER_RHI_GPUBuffer: Clustered Lighting - Clusters Light Indices");
+		mClustersLightIndicesBuffer->CreateGPUBufferResource(rhi, nullptr, CLUSTERED_LIGHTING_CLUSTERS_COUNT * CLUSTERED_LIGHTING_MAX_LIGHTS_PER_CLUSTER, sizeof(UINT), isDynamic, bindFlags, 0,
+			ER_RESOURCE_MISC_BUFFER_STRUCTURED);
+
+		mVisibleLights.reserve(CLUSTERED_LIGHTING_MAX_LIGHTS);
+		ZeroMemory(&mShaderParams, sizeof(mShaderParams));
+		mStats.IsBuiltOnGPU = mIsGPUBuild;
+	}
+
+	ER_ClusteredLighting::~ER_ClusteredLighting()
+	{
+		DeleteObject(mBuildClustersCS);
+		DeleteObject(mRootSignature);
+		DeleteObject(mLightsBuffer);
+		DeleteObject(mClustersGridBuffer);
+		DeleteObject(mClustersLightIndicesBuffer);
+		mCullingCB.Release();
+	}
+
+	bool ER_ClusteredLighting::IsGPUBuildSupported(ER_RHI* aRHI)
+	{
+		return aRHI && aRHI->GetAPI() == ER_GRAPHICS_API::DX11;
+	}
+
+	void ER_ClusteredLighting::Update(const ER_Camera& aCamera, const std::vector<ER_PointLight*>& aLights)
+	{
+		ER_CPU_PROFILE_SCOPE(mCore.CPUProfiler(), "ER_ClusteredLighting::Update");
+
+		// lights outside of the frustum would not touch any cluster, so they are not uploaded at all
+		mVisibleLights.clear();
+		const ER_Frustum frustum = aCamera.GetFrustum();
+		for (const ER_PointLight* light : aLights)
+		{
+			if (mVisibleLights.size() >= CLUSTERED_LIGHTING_MAX_LIGHTS)
+				break;
+
+			const XMVECTOR center = light->PositionVector();
+			bool isCulled = false;
+			for (int planeID = 0; planeID < 6 && !isCulled; planeID++)
+				isCulled = XMVectorGetX(XMPlaneDotCoord(XMLoadFloat4(&frustum.Planes()[planeID]), center)) > light->Radius();
+			if (!isCulled)
+				mVisibleLights.push_back(GetClusteredLight(light));
+		}
+
+		const UINT visibleLightsCount = static_cast<UINT>(mVisibleLights.size());
+		mShaderParams = GetParams(aCamera.ViewMatrix(), aCamera.ProjectionMatrix(), aCamera.NearPlaneDistance(), aCamera.FarPlaneDistance(),
+			static_cast<UINT>(mCore.ScreenWidth()), static_cast<UINT>(mCore.ScreenHeight()), visibleLightsCount);
+
+		mStats.SceneLightsCount = static_cast<UINT>(aLights.size());
+		mStats.VisibleLightsCount = visibleLightsCount;
+		if (!mIsGPUBuild)
+		{
+			BuildClusters(mShaderParams, mVisibleLights.data(), mClustersGrid, mClustersLightIndices, mScratch);
+
+			mStats.LightIndicesCount = static_cast<UINT>(mClustersLightIndices.size());
+			mStats.MaxLightsPerCluster = 0;
+			for (const XMUINT2& cluster : mClustersGrid)
+				mStats.MaxLightsPerCluster = std::max(mStats.MaxLightsPerCluster, cluster.y);
+		}
+	}
+
+	void ER_ClusteredLighting::Build(ER_RHI* aRHI)
+	{
+		if (!mVisibleLights.empty())
+			aRHI->UpdateBuffer(mLightsBuffer, mVisibleLights.data(), static_cast<int>(mVisibleLights.size() * sizeof(ER_ClusteredLight)));
+
+		if (!mIsGPUBuild)
+		{
+			aRHI->UpdateBuffer(mClustersGridBuffer, mClustersGrid.data(), static_cast<int>(mClustersGrid.size() * sizeof(XMUINT2)));
+			if (!mClustersLightIndices.empty())
+				aRHI->UpdateBuffer(mClustersLightIndicesBuffer, mClustersLightIndices.data(), static_cast<int>(mClustersLightIndices.size() * sizeof(UINT)));
+			return;
+		}
+
+		// dispatched even without lights, so that the counts of the clusters are reset
+		mCullingCB.Data.Params = mShaderParams;
+		mCullingCB.ApplyChanges(aRHI);
+
+		aRHI->SetRootSignature(mRootSignature, true);
+		aRHI->SetConstantBuffers(ER_COMPUTE, { mCullingCB.Buffer() }, 0, mRootSignature, CLUSTERED_LIGHTING_ROOT_DESCRIPTOR_TABLE_CBV_INDEX, true);
+		aRHI->SetShaderResources(ER_COMPUTE, { mLightsBuffer }, 0, mRootSignature, CLUSTERED_LIGHTING_ROOT_DESCRIPTOR_TABLE_SRV_INDEX, true);
+		aRHI->SetUnorderedAccessResources(ER_COMPUTE, { mClustersGridBuffer, mClustersLightIndicesBuffer }, 0, mRootSignature, CLUSTERED_LIGHTING_ROOT_DESCRIPTOR_TABLE_UAV_INDEX, true);
+		if (!aRHI->IsPSOReady(mBuildClustersPassPSOName, true))
+		{
+			aRHI->InitializePSO(mBuildClustersPassPSOName, true);
+			aRHI->SetRootSignatureToPSO(mBuildClustersPassPSOName, mRootSignature, true);
+			aRHI->SetShader(mBuildClustersCS);
+			aRHI->FinalizePSO(mBuildClustersPassPSOName, true);
+		}
+		aRHI->SetPSO(mBuildClustersPassPSOName, true);
+		aRHI->Dispatch(ER_DivideByMultiple(CLUSTERED_LIGHTING_CLUSTERS_COUNT, CLUSTERED_LIGHTING_THREAD_GROUP_SIZE), 1, 1);
+		aRHI->UnsetPSO();
+		aRHI->UnbindResourcesFromShader(ER_COMPUTE);
+	}
+
+	ER_ClusteredLight ER_ClusteredLighting::GetClusteredLight(const ER_PointLight* aLight)
+	{
+		ER_ClusteredLight light;
+		XMStoreFloat3(&light.Position, aLight->PositionVector());
+		light.Radius = aLight->Radius();
+		const XMFLOAT4& color = aLight->GetColor();
+		light.Color = XMFLOAT3(color.x * color.w, color.y * color.w, color.z * color.w);
+
+		const ER_SpotLight* spotLight = aLight->As<ER_SpotLight>();
+		if (spotLight)
+		{
+			light.Direction = spotLight->Direction();
+			light.SpotCosOuter = cosf(XMConvertToRadians(spotLight->OuterAngle()));
+			light.SpotCosInner = cosf(XMConvertToRadians(spotLight->InnerAngle()));
+		}
+		else
+		{
+			light.Direction = XMFLOAT3(0.0f, 0.0f, 1.0f);
+			light.SpotCosOuter = -2.0f;
+			light.SpotCosInner = -1.0f;
+		}
+		return light;
+	}
+
+	ClusteredLightingParams ER_ClusteredLighting::GetParams(const XMMATRIX& aView, const XMMATRIX& aProjection, float aNearPlane, float aFarPlane,
+		UINT aScreenWidth, UINT aScreenHeight, UINT aLightsCount)
+	{
+		assert(aNearPlane > 0.0f && aFarPlane > aNearPlane);
+		assert(aScreenWidth > 0 && aScreenHeight > 0);
+
+		XMFLOAT4X4 projection;
+		XMStoreFloat4x4(&projection, aProjection);
+
+		ClusteredLightingParams params;
+		ZeroMemory(&params, sizeof(params));
+
+		// right handed projections look down -z: flip it, so that the depth is always +z
+		const float handedness = (projection._34 < 0.0f) ? -1.0f : 1.0f;
+		params.View = XMMatrixTranspose(aView * XMMatrixScaling(1.0f, 1.0f, handedness));
+		params.GridSize = XMUINT4(CLUSTERED_LIGHTING_GRID_SIZE_X, CLUSTERED_LIGHTING_GRID_SIZE_Y, CLUSTERED_LIGHTING_GRID_SIZE_Z, aLightsCount);
+
+		// slice 0 - [near; firstSliceDepth], slices 1..Z-1 - exponential in [firstSliceDepth; far] (tiny near planes would waste most of the slices otherwise)
+		const float firstSliceDepth = std::min(std::max(aNearPlane, CLUSTERED_LIGHTING_MIN_SLICE_DEPTH), aFarPlane * 0.5f);
+		const float sliceScale = static_cast<float>(CLUSTERED_LIGHTING_GRID_SIZE_Z - 1) / logf(aFarPlane / firstSliceDepth);
+		params.DepthParams = XMFLOAT4(sliceScale, 1.0f - logf(firstSliceDepth) * sliceScale, aNearPlane, aFarPlane);
+		params.ProjectionParams = XMFLOAT4(
+			static_cast<float>(CLUSTERED_LIGHTING_GRID_SIZE_X) / static_cast<float>(aScreenWidth),
+			static_cast<float>(CLUSTERED_LIGHTING_GRID_SIZE_Y) / static_cast<float>(aScreenHeight),
+			projection._11, projection._22);
+		return params;
+	}
+
+	float ER_ClusteredLighting::GetSliceDepth(const ClusteredLightingParams& aParams, UINT aSlice)
+	{
+		if (aSlice == 0)
+			return aParams.DepthParams.z;
+		if (aSlice >= CLUSTERED_LIGHTING_GRID_SIZE_Z)
+			return aParams.DepthParams.w;
+		return expf((static_cast<float>(aSlice) - aParams.DepthParams.y) / aParams.DepthParams.x);
+	}
+
+	UINT ER_ClusteredLighting::GetSlice(const ClusteredLightingParams& aParams, float aDepth)
+	{
+		const float slice = floorf(logf(std::max(aDepth, aParams.DepthParams.z)) * aParams.DepthParams.x + aParams.DepthParams.y);
+		return static_cast<UINT>(std::min(std::max(slice, 0.0f), static_cast<float>(CLUSTERED_LIGHTING_GRID_SIZE_Z - 1)));
+	}
+
+	ER_AABB ER_ClusteredLighting::GetClusterAABB(const ClusteredLightingParams& aParams, UINT aX, UINT aY, UINT aZ)
+	{
+		const float nearDepth = GetSliceDepth(aParams, aZ);
+		const float farDepth = GetSliceDepth(aParams, aZ + 1);
+
+		// tile's NDC rectangle (tile rows go from the top of the screen)
+		const float ndcMinX = -1.0f + 2.0f * static_cast<float>(aX) / CLUSTERED_LIGHTING_GRID_SIZE_X;
+		const float ndcMaxX = -1.0f + 2.0f * static_cast<float>(aX + 1) / CLUSTERED_LIGHTING_GRID_SIZE_X;
+		const float ndcMaxY = 1.0f - 2.0f * static_cast<float>(aY) / CLUSTERED_LIGHTING_GRID_SIZE_Y;
+		const float ndcMinY = 1.0f - 2.0f * static_cast<float>(aY + 1) / CLUSTERED_LIGHTING_GRID_SIZE_Y;
+
+		// view = ndc * depth / projection scale, the extremes are at the near or at the far depth of the slice
+		ER_AABB aabb;
+		aabb.first.x = std::min(ndcMinX * nearDepth, ndcMinX * farDepth) / aParams.ProjectionParams.z;
+		aabb.second.x = std::max(ndcMaxX * nearDepth, ndcMaxX * farDepth) / aParams.ProjectionParams.z;
+		aabb.first.y = std::min(ndcMinY * nearDepth, ndcMinY * farDepth) / aParams.ProjectionParams.w;
+		aabb.second.y = std::max(ndcMaxY * nearDepth, ndcMaxY * farDepth) / aParams.ProjectionParams.w;
+		aabb.first.z = nearDepth;
+		aabb.second.z = farDepth;
+		return aabb;
+	}
+
+	XMFLOAT3 ER_ClusteredLighting::GetViewSpacePosition(const ClusteredLightingParams& aParams, const XMFLOAT3& aPosition)
+	{
+		XMFLOAT3 viewPosition;
+		XMStoreFloat3(&viewPosition, XMVector3Transform(XMLoadFloat3(&aPosition), XMMatrixTranspose(aParams.View)));
+		return viewPosition;
+	}
+
+	bool ER_ClusteredLighting::IsSphereInCluster(const XMFLOAT3& aCenter, float aRadius, const ER_AABB& aClusterAABB)
+	{
+		const float dx = std::max(aClusterAABB.first.x - aCenter.x, 0.0f) + std::max(aCenter.x - aClusterAABB.second.x, 0.0f);
+		const float dy = std::max(aClusterAABB.first.y - aCenter.y, 0.0f) + std::max(aCenter.y - aClusterAABB.second.y, 0.0f);
+		const float dz = std::max(aClusterAABB.first.z - aCenter.z, 0.0f) + std::max(aCenter.z - aClusterAABB.second.z, 0.0f);
+		return dx * dx + dy * dy + dz * dz <= aRadius * aRadius;
+	}
+
+	UINT ER_ClusteredLighting::GetClusterIndex(const ClusteredLightingParams& aParams, const XMFLOAT3& aViewPosition)
+	{
+		assert(aViewPosition.z > 0.0f);
+
+		// pixel of the position -> tile (as SV_Position in the shaders)
+		const float ndcX = aViewPosition.x * aParams.ProjectionParams.z / aViewPosition.z;
+		const float ndcY = aViewPosition.y * aParams.ProjectionParams.w / aViewPosition.z;
+		const float pixelX = (ndcX * 0.5f + 0.5f) * CLUSTERED_LIGHTING_GRID_SIZE_X / aParams.ProjectionParams.x;
+		const float pixelY = (0.5f - ndcY * 0.5f) * CLUSTERED_LIGHTING_GRID_SIZE_Y / aParams.ProjectionParams.y;
+		const UINT x = static_cast<UINT>(std::min(std::max(pixelX * aParams.ProjectionParams.x, 0.0f), static_cast<float>(CLUSTERED_LIGHTING_GRID_SIZE_X - 1)));
+		const UINT y = static_cast<UINT>(std::min(std::max(pixelY * aParams.ProjectionParams.y, 0.0f), static_cast<float>(CLUSTERED_LIGHTING_GRID_SIZE_Y - 1)));
+		return GetClusterIndex(x, y, GetSlice(aParams, aViewPosition.z));
+	}
+
+	void ER_ClusteredLighting::BuildClustersReference(const ClusteredLightingParams& aParams, const ER_ClusteredLight* aLights,
+		std::vector<XMUINT2>& outGrid, std::vector<UINT>& outLightIndices)
+	{
+		const UINT lightsCount = aParams.GridSize.w;
+
+		outGrid.assign(CLUSTERED_LIGHTING_CLUSTERS_COUNT, XMUINT2(0, 0));
+		outLightIndices.clear();
+		for (UINT z = 0; z < CLUSTERED_LIGHTING_GRID_SIZE_Z; z++)
+		{
+			for (UINT y = 0; y < CLUSTERED_LIGHTING_GRID_SIZE_Y; y++)
+			{
+				for (UINT x = 0; x < CLUSTERED_LIGHTING_GRID_SIZE_X; x++)
+				{
+					const ER_AABB aabb = GetClusterAABB(aParams, x, y, z);
+					XMUINT2& cluster = outGrid[GetClusterIndex(x, y, z)];
+					cluster.x = static_cast<UINT>(outLightIndices.size());
+					for (UINT lightIndex = 0; lightIndex < lightsCount && cluster.y < CLUSTERED_LIGHTING_MAX_LIGHTS_PER_CLUSTER; lightIndex++)
+					{
+						if (IsSphereInCluster(GetViewSpacePosition(aParams, aLights[lightIndex].Position), aLights[lightIndex].Radius, aabb))
+						{
+							outLightIndices.push_back(lightIndex);
+							cluster.y++;
+						}
+					}
+				}
+			}
+		}
+	}
+
+	void ER_ClusteredLighting::BuildClusters(const ClusteredLightingParams& aParams, const ER_ClusteredLight* aLights,
+		std::vector<XMUINT2>& outGrid, std::vector<UINT>& outLightIndices, ER_ClusteredLightingScratch& aScratch)
+	{
+		const UINT lightsCount = aParams.GridSize.w;
+
+		aScratch.ClustersAABBs.resize(CLUSTERED_LIGHTING_CLUSTERS_COUNT);
+		for (UINT z = 0; z < CLUSTERED_LIGHTING_GRID_SIZE_Z; z++)
+			for (UINT y = 0; y < CLUSTERED_LIGHTING_GRID_SIZE_Y; y++)
+				for (UINT x = 0; x < CLUSTERED_LIGHTING_GRID_SIZE_X; x++)
+					aScratch.ClustersAABBs[GetClusterIndex(x, y, z)] = GetClusterAABB(aParams, x, y, z);
+
+		aScratch.LightsViewSpaceSpheres.resize(lightsCount);
+		for (UINT lightIndex = 0; lightIndex < lightsCount; lightIndex++)
+		{
+			const XMFLOAT3 center = GetViewSpacePosition(aParams, aLights[lightIndex].Position);
+			aScratch.LightsViewSpaceSpheres[lightIndex] = XMFLOAT4(center.x, center.y, center.z, aLights[lightIndex].Radius);
+		}
+
+		// (cluster, light) pairs in the ascending order of the lights. Every axis of the sphere vs AABB distance is a term of IsSphereInCluster()'s sum,
+		// so the slices/columns/rows that fail on one axis would fail the full test as well (the results are exactly the reference's ones).
+		auto isAxisOverlapped = [](float aMin, float aMax, float aCenter, float aRadius)
+		{
+			const float d = std::max(aMin - aCenter, 0.0f) + std::max(aCenter - aMax, 0.0f);
+			return d * d <= aRadius * aRadius;
+		};
+		aScratch.ClusterLightPairs.clear();
+		for (UINT lightIndex = 0; lightIndex < lightsCount; lightIndex++)
+		{
+			const XMFLOAT4& sphere = aScratch.LightsViewSpaceSpheres[lightIndex];
+			const XMFLOAT3 center = XMFLOAT3(sphere.x, sphere.y, sphere.z);
+			for (UINT z = 0; z < CLUSTERED_LIGHTING_GRID_SIZE_Z; z++)
+			{
+				const ER_AABB& sliceAABB = aScratch.ClustersAABBs[GetClusterIndex(0, 0, z)];
+				if (!isAxisOverlapped(sliceAABB.first.z, sliceAABB.second.z, center.z, sphere.w))
+				{
+					if (sliceAABB.first.z > center.z) // slices are sorted by depth, the next ones are even farther
+						break;
+					continue;
+				}
+
+				UINT columns[CLUSTERED_LIGHTING_GRID_SIZE_X];
+				UINT columnsCount = 0;
+				for (UINT x = 0; x < CLUSTERED_LIGHTING_GRID_SIZE_X; x++)
+				{
+					const ER_AABB& columnAABB = aScratch.ClustersAABBs[GetClusterIndex(x, 0, z)];
+					if (isAxisOverlapped(columnAABB.first.x, columnAABB.second.x, center.x, sphere.w))
+						columns[columnsCount++] = x;
+				}
+				if (columnsCount == 0)
+					continue;
+
+				for (UINT y = 0; y < CLUSTERED_LIGHTING_GRID_SIZE_Y; y++)
+				{
+					const ER_AABB& rowAABB = aScratch.ClustersAABBs[GetClusterIndex(0, y, z)];
+					if (!isAxisOverlapped(rowAABB.first.y, rowAABB.second.y, center.y, sphere.w))
+						continue;
+
+					for (UINT i = 0; i < columnsCount; i++)
+					{
+						const UINT clusterIndex = GetClusterIndex(columns[i], y, z);
+						if (IsSphereInCluster(center, sphere.w, aScratch.ClustersAABBs[clusterIndex]))
+							aScratch.ClusterLightPairs.push_back(XMUINT2(clusterIndex, lightIndex));
+					}
+				}
+			}
+		}
+
+		// counting sort of the pairs into the lists of the clusters
+		outGrid.assign(CLUSTERED_LIGHTING_CLUSTERS_COUNT, XMUINT2(0, 0));
+		for (const XMUINT2& pair : aScratch.ClusterLightPairs)
+			outGrid[pair.x].y++;
+
+		UINT offset = 0;
+		for (XMUINT2& cluster : outGrid)
+		{
+			cluster.x = offset;
+			offset += std::min(cluster.y, static_cast<UINT>(CLUSTERED_LIGHTING_MAX_LIGHTS_PER_CLUSTER));
+			cluster.y = 0;
+		}
+
+		outLightIndices.resize(offset);
+		for (const XMUINT2& pair : aScratch.ClusterLightPairs)
+		{
+			XMUINT2& cluster = outGrid[pair.x];
+			if (cluster.y < CLUSTERED_LIGHTING_MAX_LIGHTS_PER_CLUSTER)
+				outLightIndices[cluster.x + cluster.y++] = pair.y;
+		}
+	}
+
+	// Test/benchmark scenes: camera at the origin looking down -z (right handed, as ER_Camera by default)
+	static ClusteredLightingParams GetTestParams(UINT aLightsCount, bool aLeftHanded = false)
+	{
+		const float fov = XM_PIDIV4;
+		const float aspectRatio = 16.0f / 9.0f;
+		const float nearPlane = 0.1f;
+		const float farPlane = 500.0f;
+		const XMMATRIX view = aLeftHanded ?
+			XMMatrixLookToLH(XMVectorZero(), XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f)) :
+			XMMatrixLookToRH(XMVectorZero(), XMVectorSet(0.0f, 0.0f, -1.0f, 0.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+		const XMMATRIX projection = aLeftHanded ?
+			XMMatrixPerspectiveFovLH(fov, aspectRatio, nearPlane, farPlane) :
+			XMMatrixPerspectiveFovRH(fov, aspectRatio, nearPlane, farPlane);
+		return ER_ClusteredLighting::GetParams(view, projection, nearPlane, farPlane, 1920, 1080, aLightsCount);
+	}
+
+	static std::vector<ER_ClusteredLight> GetTestLights(UINT aLightsCount, float aMinRadius, float aMaxRadius)
+	{
+		std::vector<ER_ClusteredLight> lights(aLightsCount);
+		for (ER_ClusteredLight& light : lights)
+		{
+			// some of them are behind the camera or outside of the frustum
+			light.Position = XMFLOAT3(ER_Utility::RandomFloat(-150.0f, 150.0f), ER_Utility::RandomFloat(-40.0f, 60.0f), ER_Utility::RandomFloat(-520.0f, 10.0f));
+			light.Radius = ER_Utility::RandomFloat(aMinRadius, aMaxRadius);
+			light.Color = XMFLOAT3(1.0f, 1.0f, 1.0f);
+			light.Direction = XMFLOAT3(0.0f, 0.0f, 1.0f);
+			light.SpotCosOuter = -2.0f;
+			light.SpotCosInner = -1.0f;
+		}
+		return lights;
+	}
+
+	static bool IsLightInClusterList(const std::vector<XMUINT2>& aGrid, const std::vector<UINT>& aLightIndices, UINT aClusterIndex, UINT aLightIndex)
+	{
+		const XMUINT2& cluster = aGrid[aClusterIndex];
+		return std::find(aLightIndices.begin() + cluster.x, aLightIndices.begin() + cluster.x + cluster.y, aLightIndex) != aLightIndices.begin() + cluster.x + cluster.y;
+	}
+
+	bool ER_ClusteredLighting::RunTests()
+	{
+		UINT passedCount = 0;
+		UINT failedCount = 0;
+		auto check = [&](bool aCondition, const std::string& aName)
+		{
+			if (aCondition)
+				passedCount++;
+			else
+			{
+				failedCount++;
+				ER_OUTPUT_LOG(ER_Utility::ToWideString("[ER Logger][ER_ClusteredLighting] Test FAILED: " + aName + "\n").c_str());
+			}
+		};
+
+		ER_ClusteredLightingScratch scratch;
+		std::vector<XMUINT2> grid;
+		std::vector<UINT> lightIndices;
+
+		// slices: continuous from the near to the far plane, depth -> slice is consistent with the slices' depths
+		{
+			const ClusteredLightingParams params = GetTestParams(0);
+			bool isContinuous = GetSliceDepth(params, 0) == params.DepthParams.z && GetSliceDepth(params, CLUSTERED_LIGHTING_GRID_SIZE_Z) == params.DepthParams.w;
+			bool isConsistent = true;
+			for (UINT z = 0; z < CLUSTERED_LIGHTING_GRID_SIZE_Z; z++)
+			{
+				isContinuous = isContinuous && GetSliceDepth(params, z) < GetSliceDepth(params, z + 1);
+				const float middleDepth = 0.5f * (GetSliceDepth(params, z) + GetSliceDepth(params, z + 1));
+				isConsistent = isConsistent && GetSlice(params, middleDepth) == z;
+			}
+			check(isContinuous, "slices cover [near; far] in the ascending order");
+			check(isConsistent, "depth -> slice matches the slices' depths");
+		}
+
+		// a single light in the middle of the screen: in the cluster of its center, not in the far away clusters
+		{
+			ClusteredLightingParams params = GetTestParams(1);
+			std::vector<ER_ClusteredLight> lights = GetTestLights(1, 1.0f, 1.0f);
+			lights[0].Position = XMFLOAT3(0.3f, 0.2f, -10.0f);
+			lights[0].Radius = 0.5f;
+
+			BuildClusters(params, lights.data(), grid, lightIndices, scratch);
+			const UINT centerCluster = GetClusterIndex(params, GetViewSpacePosition(params, lights[0].Position));
+			check(IsLightInClusterList(grid, lightIndices, centerCluster, 0), "light is in the cluster of its center");
+			check(grid[GetClusterIndex(0, 0, 0)].y == 0 && grid[GetClusterIndex(CLUSTERED_LIGHTING_GRID_SIZE_X - 1, CLUSTERED_LIGHTING_GRID_SIZE_Y - 1, CLUSTERED_LIGHTING_GRID_SIZE_Z - 1)].y == 0,
+				"light is not in the far away clusters");
+
+			// same scene with a left handed camera (looking down +z)
+			ClusteredLightingParams paramsLH = GetTestParams(1, true);
+			std::vector<ER_ClusteredLight> lightsLH = lights;
+			lightsLH[0].Position.z = -lightsLH[0].Position.z;
+			std::vector<XMUINT2> gridLH;
+			std::vector<UINT> lightIndicesLH;
+			BuildClusters(paramsLH, lightsLH.data(), gridLH, lightIndicesLH, scratch);
+			bool isSame = true;
+			for (UINT i = 0; i < CLUSTERED_LIGHTING_CLUSTERS_COUNT; i++)
+				isSame = isSame && (grid[i].y == gridLH[i].y);
+			check(isSame, "left and right handed cameras give the same clusters");
+		}
+
+		// lights behind the camera and beyond the far plane are in no cluster, a light around the camera is in the first slice
+		{
+			ClusteredLightingParams params = GetTestParams(3);
+			std::vector<ER_ClusteredLight> lights = GetTestLights(3, 1.0f, 1.0f);
+			lights[0].Position = XMFLOAT3(0.0f, 0.0f, 5.0f);
+			lights[1].Position = XMFLOAT3(0.0f, 0.0f, -510.0f);
+			lights[2].Position = XMFLOAT3(0.0f, 0.0f, 0.0f);
+
+			BuildClusters(params, lights.data(), grid, lightIndices, scratch);
+			bool isLight0Found = false;
+			bool isLight1Found = false;
+			for (UINT i = 0; i < CLUSTERED_LIGHTING_CLUSTERS_COUNT; i++)
+			{
+				isLight0Found = isLight0Found || IsLightInClusterList(grid, lightIndices, i, 0);
+				isLight1Found = isLight1Found || IsLightInClusterList(grid, lightIndices, i, 1);
+			}
+			check(!isLight0Found, "light behind the camera is culled");
+			check(!isLight1Found, "light beyond the far plane is culled");
+			check(IsLightInClusterList(grid, lightIndices, GetClusterIndex(CLUSTERED_LIGHTING_GRID_SIZE_X / 2, CLUSTERED_LIGHTING_GRID_SIZE_Y / 2, 0), 2), "light around the camera is in the first slice");
+		}
+
+		// lists are capped and keep the first lights
+		{
+			const UINT lightsCount = CLUSTERED_LIGHTING_MAX_LIGHTS_PER_CLUSTER + 50;
+			ClusteredLightingParams params = GetTestParams(lightsCount);
+			std::vector<ER_ClusteredLight> lights = GetTestLights(lightsCount, 2.0f, 2.0f);
+			for (ER_ClusteredLight& light : lights)
+				light.Position = XMFLOAT3(0.0f, 0.0f, -20.0f);
+
+			BuildClusters(params, lights.data(), grid, lightIndices, scratch);
+			const UINT clusterIndex = GetClusterIndex(params, GetViewSpacePosition(params, lights[0].Position));
+			bool isFirstLights = grid[clusterIndex].y == CLUSTERED_LIGHTING_MAX_LIGHTS_PER_CLUSTER;
+			for (UINT i = 0; i < grid[clusterIndex].y; i++)
+				isFirstLights = isFirstLights && lightIndices[grid[clusterIndex].x + i] == i;
+			check(isFirstLights, "lists are capped by MAX_LIGHTS_PER_CLUSTER and keep the first lights");
+		}
+
+		// random scenes: the CPU build matches the reference, and every point of a light inside of the frustum finds that light in its cluster
+		for (UINT scene = 0; scene < 4; scene++)
+		{
+			const UINT lightsCount = 64 + scene * 200;
+			ClusteredLightingParams params = GetTestParams(lightsCount);
+			std::vector<ER_ClusteredLight> lights = GetTestLights(lightsCount, 0.5f, 15.0f);
+
+			std::vector<XMUINT2> referenceGrid;
+			std::vector<UINT> referenceLightIndices;
+			BuildClustersReference(params, lights.data(), referenceGrid, referenceLightIndices);
+			BuildClusters(params, lights.data(), grid, lightIndices, scratch);
+
+			bool isSame = grid.size() == referenceGrid.size() && lightIndices == referenceLightIndices;
+			for (UINT i = 0; isSame && i < CLUSTERED_LIGHTING_CLUSTERS_COUNT; i++)
+				isSame = grid[i].x == referenceGrid[i].x && grid[i].y == referenceGrid[i].y;
+			check(isSame, "CPU build matches the reference (scene " + std::to_string(scene) + ")");
+
+			bool isConservative = true;
+			for (UINT lightIndex = 0; lightIndex < lightsCount; lightIndex++)
+			{
+				const XMFLOAT3 center = GetViewSpacePosition(params, lights[lightIndex].Position);
+				for (int sample = 0; sample < 16; sample++)
+				{
+					XMFLOAT3 point;
+					XMStoreFloat3(&point, XMLoadFloat3(&center) + XMVector3Normalize(XMVectorSet(ER_Utility::RandomFloat(-1.0f, 1.0f), ER_Utility::RandomFloat(-1.0f, 1.0f),
+						ER_Utility::RandomFloat(-1.0f, 1.0f), 0.0f)) * ER_Utility::RandomFloat(0.0f, 0.99f) * lights[lightIndex].Radius);
+
+					const float ndcX = point.x * params.ProjectionParams.z / point.z;
+					const float ndcY = point.y * params.ProjectionParams.w / point.z;
+					if (point.z <= params.DepthParams.z || point.z >= params.DepthParams.w || fabs(ndcX) >= 1.0f || fabs(ndcY) >= 1.0f)
+						continue;
+
+					const UINT clusterIndex = GetClusterIndex(params, point);
+					if (grid[clusterIndex].y < CLUSTERED_LIGHTING_MAX_LIGHTS_PER_CLUSTER)
+						isConservative = isConservative && IsLightInClusterList(grid, lightIndices, clusterIndex, lightIndex);
+				}
+			}
+			check(isConservative, "points of the lights find the lights in their clusters (scene " + std::to_string(scene) + ")");
+		}
+
+		std::string message = "[ER Logger][ER_ClusteredLighting] Tests: " + std::to_string(passedCount) + " passed, " + std::to_string(failedCount) + " failed\n";
+		ER_OUTPUT_LOG(ER_Utility::ToWideString(message).c_str());
+		return failedCount == 0;
+	}
+
+	void ER_ClusteredLighting::RunBenchmark()
+	{
+		const UINT lightsCounts[] = { 16, 64, 256, 1024, CLUSTERED_LIGHTING_MAX_LIGHTS };
+		const UINT runsCount = 10;
+
+		ER_ClusteredLightingScratch scratch;
+		std::vector<XMUINT2> grid, referenceGrid;
+		std::vector<UINT> lightIndices, referenceLightIndices;
+		for (UINT lightsCount : lightsCounts)
+		{
+			const ClusteredLightingParams params = GetTestParams(lightsCount);
+			const std::vector<ER_ClusteredLight> lights = GetTestLights(lightsCount, 1.0f, 10.0f);
+
+			auto startReference = std::chrono::high_resolution_clock::now();
+			BuildClustersReference(params, lights.data(), referenceGrid, referenceLightIndices);
+			auto endReference = std::chrono::high_resolution_clock::now();
+
+			auto start = std::chrono::high_resolution_clock::now();
+			for (UINT run = 0; run < runsCount; run++)
+				BuildClusters(params, lights.data(), grid, lightIndices, scratch);
+			auto end = std::chrono::high_resolution_clock::now();
+
+			bool isSame = lightIndices == referenceLightIndices;
+			UINT maxLightsPerCluster = 0;
+			for (UINT i = 0; i < CLUSTERED_LIGHTING_CLUSTERS_COUNT; i++)
+			{
+				isSame = isSame && grid[i].x == referenceGrid[i].x && grid[i].y == referenceGrid[i].y;
+				maxLightsPerCluster = std::max(maxLightsPerCluster, grid[i].y);
+			}
+
+			std::chrono::duration<double, std::milli> referenceTime = endReference - startReference;
+			std::chrono::duration<double, std::milli> buildTime = end - start;
+			std::string message = "[ER Logger][ER_ClusteredLighting] Benchmark for " + std::to_string(lightsCount) + " lights (" + std::to_string(CLUSTERED_LIGHTING_CLUSTERS_COUNT) +
+				" clusters): reference " + std::to_string(referenceTime.count()) + " ms, CPU build " + std::to_string(buildTime.count() / runsCount) + " ms, " +
+				std::to_string(lightIndices.size()) + " light indices, max. " + std::to_string(maxLightsPerCluster) + " lights per cluster, matches reference: " + (isSame ? "yes" : "NO") + "\n";
+			ER_OUTPUT_LOG(ER_Utility::ToWideString(message).c_str());
+		}
+	}
+}
@@ -0,0 +1,137 @@
+#pragma once
+#include "Common.h"
+#include "RHI/ER_RHI.h"
+
+// froxel grid (same in ClusteredLighting.hlsli and ClusteredLightCulling.hlsl)
+#define CLUSTERED_LIGHTING_GRID_SIZE_X 16
+#define CLUSTERED_LIGHTING_GRID_SIZE_Y 9
+#define CLUSTERED_LIGHTING_GRID_SIZE_Z 24
+#define CLUSTERED_LIGHTING_CLUSTERS_COUNT (CLUSTERED_LIGHTING_GRID_SIZE_X * CLUSTERED_LIGHTING_GRID_SIZE_Y * CLUSTERED_LIGHTING_GRID_SIZE_Z)
+#define CLUSTERED_LIGHTING_MAX_LIGHTS 4096 // visible lights per frame (the rest is dropped)
+#define CLUSTERED_LIGHTING_MAX_LIGHTS_PER_CLUSTER 128 // same as in ClusteredLighting.hlsli
+#define CLUSTERED_LIGHTING_THREAD_GROUP_SIZE 64 // same as in ClusteredLightCulling.hlsl
+#define CLUSTERED_LIGHTING_MIN_SLICE_DEPTH 0.5f // first slice covers [near plane, this], the others are exponential up to the far plane
+
+namespace EveryRay_Core
+{
+	class ER_Core;
+	class ER_Camera;
+	class ER_PointLight;
+
+	namespace ClusteredLightingCBufferData
+	{
+		// Appended to the CBs of the lighting passes and used by the cluster building pass
+		struct ER_ALIGN16 ClusteredLightingParams
+		{
+			XMMATRIX View; // world -> cluster view space (+z is the depth for both left and right handed cameras), transposed
+			XMUINT4 GridSize; // x,y,z - clusters, w - lights count
+			XMFLOAT4 DepthParams; // x - slice scale, y - slice bias (slice = log(depth) * x + y), z - near plane, w - far plane
+			XMFLOAT4 ProjectionParams; // x,y - clusters per pixel, z,w - [0][0] and [1][1] of the projection
+		};
+		struct ER_ALIGN_GPU_BUFFER ClusteredLightCullingCB
+		{
+			ClusteredLightingParams Params;
+		};
+	}
+
+	// GPU light (same as in ClusteredLighting.hlsli)
+	struct ER_ClusteredLight
+	{
+		XMFLOAT3 Position;
+		float Radius;
+		XMFLOAT3 Color; // premultiplied by the intensity
+		float SpotCosOuter; // -2 for point lights (no cone falloff)
+		XMFLOAT3 Direction;
+		float SpotCosInner;
+	};
+
+	// Scratch memory of the CPU build (kept between the calls to avoid allocations)
+	struct ER_ClusteredLightingScratch
+	{
+		std::vector<ER_AABB> ClustersAABBs;
+		std::vector<XMFLOAT4> LightsViewSpaceSpheres;
+		std::vector<XMUINT2> ClusterLightPairs; // (cluster, light)
+	};
+
+	struct ER_ClusteredLightingStats
+	{
+		UINT SceneLightsCount = 0;
+		UINT VisibleLightsCount = 0; // after the frustum culling (lights in the GPU list)
+		UINT LightIndicesCount = 0; // CPU build only
+		UINT MaxLightsPerCluster = 0; // CPU build only
+		bool IsBuiltOnGPU = false;
+	};
+
+	// Clustered light assignment for the point and spot lights of the scene ("Clustered Deferred and Forward Shading" by O.Olsson et al.):
+	// the view frustum is split into a froxel grid (screen tiles x exponential depth slices) and every cluster gets a list of the lights
+	// whose bounding spheres touch its view space AABB. Deferred and forward lighting then only shade the lights of the pixel's cluster.
+	// Clusters are built by a compute pass (ClusteredLightCulling.hlsl) or on the CPU (BuildClusters()) where the pass is not supported.
+	// The CPU reference (BuildClustersReference()) uses the same math as the shader, BuildClusters() gives the same results as the reference.
+	class ER_ClusteredLighting
+	{
+	public:
+		ER_ClusteredLighting(ER_Core& aCore);
+		~ER_ClusteredLighting();
+
+		static bool IsGPUBuildSupported(ER_RHI* aRHI); // DX12 uses the CPU build (the clusters' buffers would need state transitions between the passes)
+
+		// Main thread: frustum culled light list and the grid of the current camera (+ CPU build if the GPU one is not supported)
+		void Update(const ER_Camera& aCamera, const std::vector<ER_PointLight*>& aLights);
+		// Before the lighting passes: uploads the light list and builds (or uploads) the clusters
+		void Build(ER_RHI* aRHI);
+
+		const ClusteredLightingCBufferData::ClusteredLightingParams& GetShaderParams() const { return mShaderParams; }
+		ER_RHI_GPUBuffer* GetLightsBuffer() const { return mLightsBuffer; }
+		ER_RHI_GPUBuffer* GetClustersGridBuffer() const { return mClustersGridBuffer; } // (offset, count) in the light indices per cluster
+		ER_RHI_GPUBuffer* GetClustersLightIndicesBuffer() const { return mClustersLightIndicesBuffer; }
+		const ER_ClusteredLightingStats& GetStats() const { return mStats; }
+
+		static ER_ClusteredLight GetClusteredLight(const ER_PointLight* aLight);
+		static ClusteredLightingCBufferData::ClusteredLightingParams GetParams(const XMMATRIX& aView, const XMMATRIX& aProjection, float aNearPlane, float aFarPlane,
+			UINT aScreenWidth, UINT aScreenHeight, UINT aLightsCount);
+
+		static UINT GetClusterIndex(UINT aX, UINT aY, UINT aZ) { return (aZ * CLUSTERED_LIGHTING_GRID_SIZE_Y + aY) * CLUSTERED_LIGHTING_GRID_SIZE_X + aX; }
+		// Depth of the slice's near boundary (aSlice == GRID_SIZE_Z - far plane)
+		static float GetSliceDepth(const ClusteredLightingCBufferData::ClusteredLightingParams& aParams, UINT aSlice);
+		static UINT GetSlice(const ClusteredLightingCBufferData::ClusteredLightingParams& aParams, float aDepth);
+		// Cluster's AABB in the cluster view space
+		static ER_AABB GetClusterAABB(const ClusteredLightingCBufferData::ClusteredLightingParams& aParams, UINT aX, UINT aY, UINT aZ);
+		static XMFLOAT3 GetViewSpacePosition(const ClusteredLightingCBufferData::ClusteredLightingParams& aParams, const XMFLOAT3& aPosition);
+		static bool IsSphereInCluster(const XMFLOAT3& aCenter, float aRadius, const ER_AABB& aClusterAABB);
+		// Cluster of a view space position inside of the frustum (as the lighting shaders find the cluster of a pixel)
+		static UINT GetClusterIndex(const ClusteredLightingCBufferData::ClusteredLightingParams& aParams, const XMFLOAT3& aViewPosition);
+
+		// CPU reference of the shader: every cluster against every light (lights of a cluster are in the ascending order and capped by MAX_LIGHTS_PER_CLUSTER).
+		// outGrid - (offset, count) per cluster, outLightIndices - compacted lists of all clusters
+		static void BuildClustersReference(const ClusteredLightingCBufferData::ClusteredLightingParams& aParams, const ER_ClusteredLight* aLights,
+			std::vector<XMUINT2>& outGrid, std::vector<UINT>& outLightIndices);
+		// Same results as the reference, but every light only visits the slices/tiles that its sphere overlaps (counting sort into the lists)
+		static void BuildClusters(const ClusteredLightingCBufferData::ClusteredLightingParams& aParams, const ER_ClusteredLight* aLights,
+			std::vector<XMUINT2>& outGrid, std::vector<UINT>& outLightIndices, ER_ClusteredLightingScratch& aScratch);
+
+		// Checks of the CPU path on hand-made cases + random scenes against the reference (output in log). Returns false if something has failed.
+		static bool RunTests();
+		// CPU build vs reference for different light counts (output in log)
+		static void RunBenchmark();
+	private:
+		ER_Core& mCore;
+
+		ER_RHI_GPUShader* mBuildClustersCS = nullptr;
+		ER_RHI_GPURootSignature* mRootSignature = nullptr;
+		std::string mBuildClustersPassPSOName = "ER_RHI_GPUPipelineStateObject: Clustered Lighting - Build Clusters Pass";
+		ER_RHI_GPUConstantBuffer<ClusteredLightingCBufferData::ClusteredLightCullingCB> mCullingCB;
+
+		ER_RHI_GPUBuffer* mLightsBuffer = nullptr;
+		ER_RHI_GPUBuffer* mClustersGridBuffer = nullptr;
+		ER_RHI_GPUBuffer* mClustersLightIndicesBuffer = nullptr;
+
+		std::vector<ER_ClusteredLight> mVisibleLights;
+		std::vector<XMUINT2> mClustersGrid; // CPU build
+		std::vector<UINT> mClustersLightIndices; // CPU build
+		ER_ClusteredLightingScratch mScratch; // CPU build
+
+		ClusteredLightingCBufferData::ClusteredLightingParams mShaderParams;
+		ER_ClusteredLightingStats mStats;
+		bool mIsGPUBuild = false;
+	};
+}
@@ -8,6 +8,8 @@
 #include "ER_RenderingObject.h"
 #include "ER_Utility.h"
 #include "ER_Scene.h"
+#include "ER_Camera.h"
+#include "ER_Ray.h"
 
 namespace EveryRay_Core
 {
@@ -67,11 +69,14 @@ namespace EveryRay_Core
 				if (object.second->IsAvailableInEditor())
 				{
 					editorObjectsNames[objectIndex] = object.first.c_str();
+					editorObjects[objectIndex] = object.second;
 					objectIndex++;
 				}
 			}
 			objectsSize = objectIndex;
 
+			PickObject(objectsSize);
+
 			ImGui::PushItemWidth(-1);
 			if (ImGui::Button("Deselect")) {
 				selectedObjectIndex = -1;
@@ -80,18 +85,7 @@ namespace EveryRay_Core
 
 			for (size_t i = 0; i < objectsSize; i++)
 			{
-				if (i == selectedObjectIndex)
-				{
-					auto renderingObject = mScene->FindRenderingObjectByName(editorObjectsNames[selectedObjectIndex]);
-					if (renderingObject)
-						renderingObject->SetSelected(true);
-				}
-				else
-				{
-					auto renderingObject = mScene->FindRenderingObjectByName(editorObjectsNames[i]);
-					if (renderingObject)
-						renderingObject->SetSelected(false);
-				}
+				editorObjects[i]->SetSelected(i == selectedObjectIndex);
 			}
 
 			ImGui::End();
@@ -99,4 +93,39 @@ namespace EveryRay_Core
 
 	}
 
+	// Left click in the viewport (not over ImGui windows or the gizmo) selects the closest editor object (or instance) under the cursor
+	void ER_Editor::PickObject(int aEditorObjectsCount)
+	{
+		ImGuiIO& io = ImGui::GetIO();
+		if (!ImGui::IsMouseClicked(0) || io.WantCaptureMouse || ImGuizmo::IsOver() || ImGuizmo::IsUsing())
+			return;
+
+		ER_Camera* camera = (ER_Camera*)mCore->GetServices().FindService(ER_Camera::TypeIdClass());
+		if (!camera)
+			return;
+
+		const XMMATRIX view = camera->ViewMatrix();
+		const XMMATRIX projection = camera->ProjectionMatrix();
+		const XMVECTOR nearPoint = XMVector3Unproject(XMVectorSet(io.MousePos.x, io.MousePos.y, 0.0f, 1.0f),
+			0.0f, 0.0f, io.DisplaySize.x, io.DisplaySize.y, 0.0f, 1.0f, projection, view, XMMatrixIdentity());
+		const XMVECTOR farPoint = XMVector3Unproject(XMVectorSet(io.MousePos.x, io.MousePos.y, 1.0f, 1.0f),
+			0.0f, 0.0f, io.DisplaySize.x, io.DisplaySize.y, 0.0f, 1.0f, projection, view, XMMatrixIdentity());
+		ER_Ray ray(nearPoint, XMVector3Normalize(XMVectorSubtract(farPoint, nearPoint)));
+
+		ER_SceneRayHit hit = mScene->GetBVH().RayCast(ray, FLT_MAX, [](ER_RenderingObject* object) { return object->IsAvailableInEditor(); });
+		if (!hit.Object)
+			return;
+
+		for (int i = 0; i < aEditorObjectsCount; i++)
+		{
+			if (editorObjects[i] == hit.Object)
+			{
+				selectedObjectIndex = i;
+				if (hit.InstanceIndex >= 0)
+					hit.Object->SetEditorSelectedInstance(hit.InstanceIndex);
+				break;
+			}
+		}
+	}
+
 }
\ No newline at end of file
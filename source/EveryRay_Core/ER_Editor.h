@@ -31,7 +31,10 @@ namespace EveryRay_Core
 		ER_Editor(const ER_Editor& rhs);
 		ER_Editor& operator=(const ER_Editor& rhs);
 
+		void PickObject(int aEditorObjectsCount);
+
 		const char* editorObjectsNames[MAX_OBJECTS_COUNT];
+		ER_RenderingObject* editorObjects[MAX_OBJECTS_COUNT]; // same order as editorObjectsNames
 
 		bool mUseCustomSkyboxColor = true;
 		float bottomColorSky[4] = {217.0f / 255.0f, 217.0f / 255.0f, 218.0f / 255.0f, 1.0f};
@@ -397,7 +397,7 @@ namespace EveryRay_Core
 		rhi->SetConstantBuffers(ER_PIXEL,    { mFoliageConstantBuffer.Buffer() }, 0, rs, FOLIAGE_PASS_ROOT_DESCRIPTOR_TABLE_CBV_INDEX);
 		rhi->SetSamplers(ER_PIXEL, { ER_RHI_SAMPLER_STATE::ER_TRILINEAR_WRAP, ER_RHI_SAMPLER_STATE::ER_SHADOW_SS });
 
-		std::vector<ER_RHI_GPUResource*> resources(1 + NUM_SHADOW_CASCADES);
+		ER_RHI_GPUResource* resources[1 + NUM_SHADOW_CASCADES] = {};
 		resources[0] = mAlbedoTexture;
 		if (worldShadowMapper)
 		{
@@ -423,8 +423,11 @@ namespace EveryRay_Core
 
 		bool isVoxelizationRenderPass = renderPass == FOLIAGE_VOXELIZATION;
 		std::string& psoName = isVoxelizationRenderPass ? mFoliageVoxelizationPassPSOName : mFoliageGBufferPassPSOName;
+		ER_RHI_PSO_HANDLE& psoHandle = isVoxelizationRenderPass ? mFoliageVoxelizationPassPSOHandle : mFoliageGBufferPassPSOHandle;
+		if (psoHandle == ER_RHI_INVALID_PSO_HANDLE)
+			psoHandle = rhi->GetPSOHandle(psoName);
 
-		if (!rhi->IsPSOReady(psoName))
+		if (psoHandle == ER_RHI_INVALID_PSO_HANDLE)
 		{
 			rhi->InitializePSO(psoName);
 			rhi->SetBlendState(ER_ALPHA_TO_COVERAGE, blendFactor, 0xffffffff);
@@ -445,9 +448,9 @@ namespace EveryRay_Core
 				rhi->SetShader(mPS_GBuffer);
 				rhi->SetRenderTargetFormats(aGbufferTextures, aDepthTarget);
 			}
-			rhi->FinalizePSO(psoName);
+			psoHandle = rhi->FinalizePSO(psoName);
 		}
-		rhi->SetPSO(psoName);
+		rhi->SetPSO(psoHandle);
 		PrepareRendering(gameTime, worldShadowMapper, rs);
 		rhi->DrawIndexedInstanced(mVerticesCount, mPatchesCountToRender, 0, 0, 0);
 		rhi->UnsetPSO();
@@ -599,7 +602,7 @@ namespace EveryRay_Core
 			mPatchesBufferGPU[i].worldMatrix = XMMatrixScaling(mPatchesBufferCPU[i].scale, mPatchesBufferCPU[i].scale, mPatchesBufferCPU[i].scale) * translationMatrix;
 		}
 
-		rhi->UpdateBuffer(mInstanceBuffer, (void*)mPatchesBufferGPU, (sizeof(GPUFoliageInstanceData) * mPatchesCount), mIsPlacedOnTerrain /* otherwise we won't have placed foliage in some frames */);
+		rhi->UpdateBuffer(mInstanceBuffer, (void*)mPatchesBufferGPU, (sizeof(GPUFoliageInstanceData) * mPatchesCount), true); // only on (re)placement, so it has to stay valid in the next frames
 	}
 
 	void ER_Foliage::UpdateBuffersCPU()
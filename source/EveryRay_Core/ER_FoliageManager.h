@@ -153,6 +153,9 @@ namespace EveryRay_Core
 
 		ER_RHI_GPUShader* mPS_Voxelization = nullptr;
 		std::string mFoliageVoxelizationPassPSOName = "ER_RHI_GPUPipelineStateObject: Foliage - Voxelization Pass";
+		// all foliage shares the PSOs above: handles are fetched by name once per foliage (see ER_Foliage::Draw())
+		ER_RHI_PSO_HANDLE mFoliageGBufferPassPSOHandle = ER_RHI_INVALID_PSO_HANDLE;
+		ER_RHI_PSO_HANDLE mFoliageVoxelizationPassPSOHandle = ER_RHI_INVALID_PSO_HANDLE;
 
 		ER_RHI_GPUConstantBuffer<FoliageCBufferData::FoliageCB> mFoliageConstantBuffer;
 
@@ -0,0 +1,313 @@
+#include "stdafx.h"
+#include <immintrin.h>
+
+#include "ER_FrustumCuller.h"
+#include "ER_Frustum.h"
+#include "ER_Utility.h"
+
+namespace EveryRay_Core
+{
+	ER_FrustumCuller::ER_FrustumCuller()
+	{
+	}
+
+	ER_FrustumCuller::~ER_FrustumCuller()
+	{
+		Release();
+	}
+
+	void ER_FrustumCuller::Release()
+	{
+		if (mMinX) { _aligned_free(mMinX); mMinX = nullptr; }
+		if (mMinY) { _aligned_free(mMinY); mMinY = nullptr; }
+		if (mMinZ) { _aligned_free(mMinZ); mMinZ = nullptr; }
+		if (mMaxX) { _aligned_free(mMaxX); mMaxX = nullptr; }
+		if (mMaxY) { _aligned_free(mMaxY); mMaxY = nullptr; }
+		if (mMaxZ) { _aligned_free(mMaxZ); mMaxZ = nullptr; }
+		DeleteObjects(mCullingFlags);
+		DeleteObjects(mVisibleIndices);
+
+		mCount = 0;
+		mCapacity = 0;
+	}
+
+	void ER_FrustumCuller::Resize(UINT count)
+	{
+		const UINT capacity = ER_DivideByMultiple(count, ER_FRUSTUM_CULLER_BATCH_WIDTH) * ER_FRUSTUM_CULLER_BATCH_WIDTH;
+		if (capacity <= mCapacity)
+		{
+			mCount = count;
+			SetPaddingCulled();
+			return;
+		}
+
+		Release();
+
+		const size_t sizeInBytes = capacity * sizeof(float);
+		mMinX = (float*)_aligned_malloc(sizeInBytes, 32);
+		mMinY = (float*)_aligned_malloc(sizeInBytes, 32);
+		mMinZ = (float*)_aligned_malloc(sizeInBytes, 32);
+		mMaxX = (float*)_aligned_malloc(sizeInBytes, 32);
+		mMaxY = (float*)_aligned_malloc(sizeInBytes, 32);
+		mMaxZ = (float*)_aligned_malloc(sizeInBytes, 32);
+		assert(mMinX && mMinY && mMinZ && mMaxX && mMaxY && mMaxZ);
+
+		// elements after mCount are never reported (we only go through [0, mCount) when writing results), but let's keep them initialized
+		memset(mMinX, 0, sizeInBytes);
+		memset(mMinY, 0, sizeInBytes);
+		memset(mMinZ, 0, sizeInBytes);
+		memset(mMaxX, 0, sizeInBytes);
+		memset(mMaxY, 0, sizeInBytes);
+		memset(mMaxZ, 0, sizeInBytes);
+
+		mCullingFlags = new UINT8[capacity];
+		memset(mCullingFlags, 0, capacity * sizeof(UINT8));
+		mVisibleIndices = new UINT[capacity];
+
+		mCount = count;
+		mCapacity = capacity;
+		SetPaddingCulled();
+	}
+
+	// Lanes of the last batch after mCount (i.e., after Resize() has shrunk the count) get an inverted "infinite" box,
+	// so they are culled by every plane even if they were to be reported.
+	void ER_FrustumCuller::SetPaddingCulled()
+	{
+		const UINT paddedCount = ER_DivideByMultiple(mCount, ER_FRUSTUM_CULLER_BATCH_WIDTH) * ER_FRUSTUM_CULLER_BATCH_WIDTH;
+		for (UINT index = mCount; index < paddedCount; index++)
+		{
+			mMinX[index] = mMinY[index] = mMinZ[index] = FLT_MAX;
+			mMaxX[index] = mMaxY[index] = mMaxZ[index] = -FLT_MAX;
+			mCullingFlags[index] = 1;
+		}
+	}
+
+	void ER_FrustumCuller::SetAABB(UINT index, const ER_AABB& aabb)
+	{
+		assert(index < mCount);
+
+		mMinX[index] = aabb.first.x;
+		mMinY[index] = aabb.first.y;
+		mMinZ[index] = aabb.first.z;
+		mMaxX[index] = aabb.second.x;
+		mMaxY[index] = aabb.second.y;
+		mMaxZ[index] = aabb.second.z;
+	}
+
+	// Same logic as the scalar path: for every plane we only test the "nearest" AABB vertex (min/max is picked by the sign of the plane normal);
+	// if that vertex is in front of any (outward-facing) plane, the box is culled.
+	// The vertex selection only depends on the plane, so we can pick the SoA streams once per plane and then process a full batch of boxes.
+	UINT ER_FrustumCuller::Cull(const ER_Frustum& frustum)
+	{
+		return CullInternal(frustum, mVisibleIndices, mCullingFlags);
+	}
+
+	UINT ER_FrustumCuller::Cull(const ER_Frustum& frustum, UINT* aVisibleIndices) const
+	{
+		assert(aVisibleIndices || mCount == 0);
+		return CullInternal(frustum, aVisibleIndices, nullptr);
+	}
+
+	UINT ER_FrustumCuller::CullInternal(const ER_Frustum& frustum, UINT* aVisibleIndices, UINT8* aCullingFlags) const
+	{
+		if (mCount == 0)
+			return 0;
+
+		const XMFLOAT4* planes = frustum.Planes();
+
+		const float* planeX[6];
+		const float* planeY[6];
+		const float* planeZ[6];
+		for (int planeID = 0; planeID < 6; planeID++)
+		{
+			planeX[planeID] = (planes[planeID].x > 0.0f) ? mMinX : mMaxX;
+			planeY[planeID] = (planes[planeID].y > 0.0f) ? mMinY : mMaxY;
+			planeZ[planeID] = (planes[planeID].z > 0.0f) ? mMinZ : mMaxZ;
+		}
+
+		// only the batches that hold [0, mCount); the capacity can be bigger after Resize() has shrunk the count
+		const UINT paddedCount = ER_DivideByMultiple(mCount, ER_FRUSTUM_CULLER_BATCH_WIDTH) * ER_FRUSTUM_CULLER_BATCH_WIDTH;
+		UINT visibleCount = 0;
+
+#if defined(__AVX__)
+		const int allCulledMask = 0xFF;
+		__m256 planeNX[6], planeNY[6], planeNZ[6], planeW[6];
+		for (int planeID = 0; planeID < 6; planeID++)
+		{
+			planeNX[planeID] = _mm256_set1_ps(planes[planeID].x);
+			planeNY[planeID] = _mm256_set1_ps(planes[planeID].y);
+			planeNZ[planeID] = _mm256_set1_ps(planes[planeID].z);
+			planeW[planeID] = _mm256_set1_ps(planes[planeID].w);
+		}
+		const __m256 zero = _mm256_setzero_ps();
+
+		for (UINT i = 0; i < paddedCount; i += ER_FRUSTUM_CULLER_BATCH_WIDTH)
+		{
+			__m256 outside = zero;
+			for (int planeID = 0; planeID < 6; planeID++)
+			{
+				__m256 distance = _mm256_add_ps(
+					_mm256_add_ps(_mm256_mul_ps(planeNX[planeID], _mm256_load_ps(planeX[planeID] + i)), _mm256_mul_ps(planeNY[planeID], _mm256_load_ps(planeY[planeID] + i))),
+					_mm256_add_ps(_mm256_mul_ps(planeNZ[planeID], _mm256_load_ps(planeZ[planeID] + i)), planeW[planeID]));
+				outside = _mm256_or_ps(outside, _mm256_cmp_ps(distance, zero, _CMP_GT_OQ));
+				if (_mm256_movemask_ps(outside) == allCulledMask)
+					break;
+			}
+			const int culledMask = _mm256_movemask_ps(outside);
+#else
+		const int allCulledMask = 0xF;
+		__m128 planeNX[6], planeNY[6], planeNZ[6], planeW[6];
+		for (int planeID = 0; planeID < 6; planeID++)
+		{
+			planeNX[planeID] = _mm_set1_ps(planes[planeID].x);
+			planeNY[planeID] = _mm_set1_ps(planes[planeID].y);
+			planeNZ[planeID] = _mm_set1_ps(planes[planeID].z);
+			planeW[planeID] = _mm_set1_ps(planes[planeID].w);
+		}
+		const __m128 zero = _mm_setzero_ps();
+
+		for (UINT i = 0; i < paddedCount; i += ER_FRUSTUM_CULLER_BATCH_WIDTH)
+		{
+			__m128 outside = zero;
+			for (int planeID = 0; planeID < 6; planeID++)
+			{
+				__m128 distance = _mm_add_ps(
+					_mm_add_ps(_mm_mul_ps(planeNX[planeID], _mm_load_ps(planeX[planeID] + i)), _mm_mul_ps(planeNY[planeID], _mm_load_ps(planeY[planeID] + i))),
+					_mm_add_ps(_mm_mul_ps(planeNZ[planeID], _mm_load_ps(planeZ[planeID] + i)), planeW[planeID]));
+				outside = _mm_or_ps(outside, _mm_cmpgt_ps(distance, zero));
+				if (_mm_movemask_ps(outside) == allCulledMask)
+					break;
+			}
+			const int culledMask = _mm_movemask_ps(outside);
+#endif
+			const UINT laneCount = std::min((UINT)ER_FRUSTUM_CULLER_BATCH_WIDTH, mCount - i);
+			for (UINT lane = 0; lane < laneCount; lane++)
+			{
+				const UINT8 culled = (culledMask >> lane) & 1;
+				if (aCullingFlags)
+					aCullingFlags[i + lane] = culled;
+				aVisibleIndices[visibleCount] = i + lane;
+				visibleCount += (1 - culled); // branchless compaction
+			}
+		}
+
+		return visibleCount;
+	}
+
+	bool ER_FrustumCuller::IsAABBCulled(const ER_Frustum& frustum, const ER_AABB& aabb)
+	{
+		bool culled = false;
+		// start a loop through all frustum planes
+		for (int planeID = 0; planeID < 6; ++planeID)
+		{
+			XMVECTOR planeNormal = XMVectorSet(frustum.Planes()[planeID].x, frustum.Planes()[planeID].y, frustum.Planes()[planeID].z, 0.0f);
+			float planeConstant = frustum.Planes()[planeID].w;
+
+			XMFLOAT3 axisVert;
+
+			// x-axis
+			if (frustum.Planes()[planeID].x > 0.0f)
+				axisVert.x = aabb.first.x;
+			else
+				axisVert.x = aabb.second.x;
+
+			// y-axis
+			if (frustum.Planes()[planeID].y > 0.0f)
+				axisVert.y = aabb.first.y;
+			else
+				axisVert.y = aabb.second.y;
+
+			// z-axis
+			if (frustum.Planes()[planeID].z > 0.0f)
+				axisVert.z = aabb.first.z;
+			else
+				axisVert.z = aabb.second.z;
+
+			if (XMVectorGetX(XMVector3Dot(planeNormal, XMLoadFloat3(&axisVert))) + planeConstant > 0.0f)
+			{
+				culled = true;
+				// Skip remaining planes to check and move on
+				break;
+			}
+		}
+		return culled;
+	}
+
+	void ER_FrustumCuller::RunBenchmark(const ER_Frustum& frustum)
+	{
+		const UINT testCounts[] = { 1000, 20000, 200000 };
+		const int iterations = 50;
+
+		// scatter boxes in a volume around the frustum, so that we get a mix of visible and culled ones
+		XMFLOAT3 volumeMin = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+		XMFLOAT3 volumeMax = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		for (int i = 0; i < 8; i++)
+		{
+			volumeMin.x = std::min(volumeMin.x, frustum.Corners()[i].x);
+			volumeMin.y = std::min(volumeMin.y, frustum.Corners()[i].y);
+			volumeMin.z = std::min(volumeMin.z, frustum.Corners()[i].z);
+			volumeMax.x = std::max(volumeMax.x, frustum.Corners()[i].x);
+			volumeMax.y = std::max(volumeMax.y, frustum.Corners()[i].y);
+			volumeMax.z = std::max(volumeMax.z, frustum.Corners()[i].z);
+		}
+
+		for (UINT count : testCounts)
+		{
+			std::vector<ER_AABB> aabbs(count);
+			std::vector<XMFLOAT4X4> payload(count);
+			std::vector<XMFLOAT4X4> compactedPayload(count);
+			std::vector<bool> scalarFlags(count);
+
+			ER_FrustumCuller culler;
+			culler.Resize(count);
+
+			for (UINT i = 0; i < count; i++)
+			{
+				XMFLOAT3 center = XMFLOAT3(
+					ER_Utility::RandomFloat(volumeMin.x, volumeMax.x),
+					ER_Utility::RandomFloat(volumeMin.y, volumeMax.y),
+					ER_Utility::RandomFloat(volumeMin.z, volumeMax.z));
+				float extent = ER_Utility::RandomFloat(0.5f, 5.0f);
+				aabbs[i] = ER_AABB(XMFLOAT3(center.x - extent, center.y - extent, center.z - extent), XMFLOAT3(center.x + extent, center.y + extent, center.z + extent));
+				XMStoreFloat4x4(&payload[i], XMMatrixTranslation(center.x, center.y, center.z));
+				culler.SetAABB(i, aabbs[i]);
+			}
+
+			// scalar path (same as the old ER_RenderingObject::PerformCPUFrustumCull(): per-box test + push_back into a fresh vector)
+			UINT scalarVisibleCount = 0;
+			auto startScalar = std::chrono::high_resolution_clock::now();
+			for (int iteration = 0; iteration < iterations; iteration++)
+			{
+				std::vector<XMFLOAT4X4> visible;
+				for (UINT i = 0; i < count; i++)
+				{
+					scalarFlags[i] = IsAABBCulled(frustum, aabbs[i]);
+					if (!scalarFlags[i])
+						visible.push_back(payload[i]);
+				}
+				scalarVisibleCount = static_cast<UINT>(visible.size());
+			}
+			auto endScalar = std::chrono::high_resolution_clock::now();
+
+			// batch path
+			UINT batchVisibleCount = 0;
+			auto startBatch = std::chrono::high_resolution_clock::now();
+			for (int iteration = 0; iteration < iterations; iteration++)
+			{
+				batchVisibleCount = culler.Cull(frustum);
+				culler.Compact(payload.data(), compactedPayload.data(), batchVisibleCount);
+			}
+			auto endBatch = std::chrono::high_resolution_clock::now();
+
+			assert(scalarVisibleCount == batchVisibleCount);
+
+			std::chrono::duration<double, std::milli> scalarTime = (endScalar - startScalar) / iterations;
+			std::chrono::duration<double, std::milli> batchTime = (endBatch - startBatch) / iterations;
+
+			std::string message = "[ER Logger][ER_FrustumCuller] Benchmark for " + std::to_string(count) + " AABBs (" + std::to_string(batchVisibleCount) + " visible): scalar " +
+				std::to_string(scalarTime.count()) + "ms, batch (width " + std::to_string(ER_FRUSTUM_CULLER_BATCH_WIDTH) + ") " + std::to_string(batchTime.count()) + "ms, speedup x" +
+				std::to_string(scalarTime.count() / std::max(batchTime.count(), 0.000001)) + "\n";
+			ER_OUTPUT_LOG(ER_Utility::ToWideString(message).c_str());
+		}
+	}
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include "Common.h"
+
+// Width of one culling batch (how many AABBs are tested per SIMD iteration)
+#if defined(__AVX__)
+#define ER_FRUSTUM_CULLER_BATCH_WIDTH 8
+#else
+#define ER_FRUSTUM_CULLER_BATCH_WIDTH 4
+#endif
+
+namespace EveryRay_Core
+{
+	class ER_Frustum;
+
+	// Batch frustum culler for big collections of AABBs (i.e., instances of ER_RenderingObject).
+	// AABBs are stored in structure-of-arrays form (separate min/max streams per axis), so that we can test
+	// 4 (SSE) or 8 (AVX) boxes against a frustum plane per iteration. All storage is preallocated in Resize(),
+	// so culling itself does not allocate.
+	class ER_FrustumCuller
+	{
+	public:
+		ER_FrustumCuller();
+		~ER_FrustumCuller();
+
+		void Resize(UINT count);
+		UINT GetCount() const { return mCount; }
+
+		void SetAABB(UINT index, const ER_AABB& aabb);
+
+		// Tests all stored AABBs against the frustum.
+		// Writes culling flags (1 - culled, 0 - visible) for every AABB and indices of visible AABBs into a preallocated buffer.
+		// Returns the amount of visible AABBs.
+		UINT Cull(const ER_Frustum& frustum);
+		// Same as Cull(), but only writes indices of visible AABBs into aVisibleIndices (at least GetCount() elements); own culling flags and indices stay untouched,
+		// so the same AABBs can be tested against extra frustums (i.e., shadow cascades) without losing the main results.
+		UINT Cull(const ER_Frustum& frustum, UINT* aVisibleIndices) const;
+
+		// Copies elements of visible AABBs from aSource into aDestination (both must have at least GetCount() elements).
+		template<typename T>
+		void Compact(const T* aSource, T* aDestination, UINT visibleCount) const
+		{
+			Compact(aSource, aDestination, mVisibleIndices, visibleCount);
+		}
+		template<typename T>
+		static void Compact(const T* aSource, T* aDestination, const UINT* aVisibleIndices, UINT visibleCount)
+		{
+			for (UINT i = 0; i < visibleCount; i++)
+				aDestination[i] = aSource[aVisibleIndices[i]];
+		}
+
+		bool IsCulled(UINT index) const { assert(index < mCount); return mCullingFlags[index] != 0; }
+		const UINT* GetVisibleIndices() const { return mVisibleIndices; }
+
+		// Scalar reference path (one box vs. six planes)
+		static bool IsAABBCulled(const ER_Frustum& frustum, const ER_AABB& aabb);
+
+		// CPU micro-benchmark: compares the scalar path with the batch path on 1k, 20k and 200k random AABBs.
+		// Results are written to the log.
+		static void RunBenchmark(const ER_Frustum& frustum);
+	private:
+		ER_FrustumCuller(const ER_FrustumCuller& rhs);
+		ER_FrustumCuller& operator=(const ER_FrustumCuller& rhs);
+
+		void Release();
+		void SetPaddingCulled();
+		UINT CullInternal(const ER_Frustum& frustum, UINT* aVisibleIndices, UINT8* aCullingFlags) const;
+
+		float* mMinX = nullptr;
+		float* mMinY = nullptr;
+		float* mMinZ = nullptr;
+		float* mMaxX = nullptr;
+		float* mMaxY = nullptr;
+		float* mMaxZ = nullptr;
+		UINT8* mCullingFlags = nullptr;
+		UINT* mVisibleIndices = nullptr;
+
+		UINT mCount = 0;
+		UINT mCapacity = 0; // padded to ER_FRUSTUM_CULLER_BATCH_WIDTH
+	};
+}
@@ -104,11 +104,12 @@ namespace EveryRay_Core {
 				continue;
 
 			const std::string& psoName = renderingObject->IsInstanced() ? psoNameInstanced : psoNameNonInstanced;
+			ER_RHI_PSO_HANDLE& psoHandle = renderingObject->IsInstanced() ? mPSOHandleInstanced : mPSOHandleNonInstanced;
 			auto materialInfo = renderingObject->GetMaterials().find(ER_MaterialHelper::gbufferMaterialName);
 			if (materialInfo != renderingObject->GetMaterials().end())
 			{
 				ER_GBufferMaterial* material = static_cast<ER_GBufferMaterial*>(materialInfo->second);
-				if (!rhi->IsPSOReady(psoName))
+				if (psoHandle == ER_RHI_INVALID_PSO_HANDLE)
 				{
 					rhi->InitializePSO(psoName);
 					material->PrepareShaders();
@@ -118,9 +119,9 @@ namespace EveryRay_Core {
 					rhi->SetRenderTargetFormats({ mAlbedoBuffer, mNormalBuffer, mPositionsBuffer, mExtraBuffer, mExtra2Buffer }, mDepthBuffer);
 					rhi->SetRootSignatureToPSO(psoName, mRootSignature);
 					rhi->SetTopologyTypeToPSO(psoName, ER_RHI_PRIMITIVE_TYPE::ER_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-					rhi->FinalizePSO(psoName);
+					psoHandle = rhi->FinalizePSO(psoName);
 				}
-				rhi->SetPSO(psoName);
+				rhi->SetPSO(psoHandle);
 				for (int meshIndex = 0; meshIndex < renderingObject->GetMeshCount(); meshIndex++)
 				{
 					material->PrepareForRendering(materialSystems, renderingObject, meshIndex, mRootSignature);
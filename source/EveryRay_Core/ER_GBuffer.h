@@ -31,6 +31,8 @@ namespace EveryRay_Core
 
 	private:
 		ER_RHI_GPURootSignature* mRootSignature = nullptr;
+		ER_RHI_PSO_HANDLE mPSOHandleNonInstanced = ER_RHI_INVALID_PSO_HANDLE;
+		ER_RHI_PSO_HANDLE mPSOHandleInstanced = ER_RHI_INVALID_PSO_HANDLE;
 
 		ER_RHI_GPUTexture* mDepthBuffer = nullptr;
 		ER_RHI_GPUTexture* mAlbedoBuffer= nullptr;
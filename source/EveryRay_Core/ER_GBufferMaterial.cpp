@@ -81,13 +81,15 @@ namespace EveryRay_Core
 		rhi->SetConstantBuffers(ER_VERTEX, { mConstantBuffer.Buffer() }, 0, rs, GBUFFER_MAT_ROOT_DESCRIPTOR_TABLE_CBV_INDEX);
 		rhi->SetConstantBuffers(ER_PIXEL, { mConstantBuffer.Buffer() }, 0, rs, GBUFFER_MAT_ROOT_DESCRIPTOR_TABLE_CBV_INDEX);
 
-		std::vector<ER_RHI_GPUResource*> resources;
-		resources.push_back(aObj->GetTextureData(meshIndex).AlbedoMap);	
-		resources.push_back(aObj->GetTextureData(meshIndex).NormalMap);
-		resources.push_back(aObj->GetTextureData(meshIndex).RoughnessMap);
-		resources.push_back(aObj->GetTextureData(meshIndex).MetallicMap);
-		resources.push_back(aObj->GetTextureData(meshIndex).HeightMap);	
-		resources.push_back(aObj->GetTextureData(meshIndex).ReflectionMaskMap);
+		ER_RHI_GPUResource* resources[] =
+		{
+			aObj->GetTextureData(meshIndex).AlbedoMap,
+			aObj->GetTextureData(meshIndex).NormalMap,
+			aObj->GetTextureData(meshIndex).RoughnessMap,
+			aObj->GetTextureData(meshIndex).MetallicMap,
+			aObj->GetTextureData(meshIndex).HeightMap,
+			aObj->GetTextureData(meshIndex).ReflectionMaskMap
+		};
 
 		rhi->SetShaderResources(ER_PIXEL, resources, 0, rs, GBUFFER_MAT_ROOT_DESCRIPTOR_TABLE_SRV_INDEX);
 		rhi->SetSamplers(ER_PIXEL, { ER_RHI_SAMPLER_STATE::ER_TRILINEAR_WRAP }, 0, rs);
@@ -0,0 +1,310 @@
+#include "stdafx.h"
+#include <algorithm>
+
+#include "ER_GPUInstanceCuller.h"
+#include "ER_RenderingObject.h"
+#include "ER_Frustum.h"
+#include "ER_Utility.h"
+#include "ER_CoreException.h"
+
+#define GPU_INSTANCE_CULLING_ROOT_DESCRIPTOR_TABLE_SRV_INDEX 0
+#define GPU_INSTANCE_CULLING_ROOT_DESCRIPTOR_TABLE_UAV_INDEX 1
+#define GPU_INSTANCE_CULLING_ROOT_DESCRIPTOR_TABLE_CBV_INDEX 2
+
+namespace EveryRay_Core
+{
+	ER_GPUCulledInstances::~ER_GPUCulledInstances()
+	{
+		DeleteObject(Instances);
+		DeleteObject(CulledInstances);
+		DeleteObject(CulledInstancesVertexBuffer);
+		DeleteObject(LODCounters);
+		DeleteObject(IndirectArgs);
+		CullingCB.Release();
+	}
+
+	ER_GPUInstanceCuller::ER_GPUInstanceCuller(ER_RHI* aRHI)
+	{
+		assert(aRHI);
+
+		mCullInstancesCS = aRHI->CreateGPUShader();
+		mCullInstancesCS->CompileShader(aRHI, "content\\shaders\\InstanceCulling.hlsl", "CSCullInstances", ER_COMPUTE);
+
+		mBuildIndirectArgsCS = aRHI->CreateGPUShader();
+		mBuildIndirectArgsCS->CompileShader(aRHI, "content\\shaders\\InstanceCulling.hlsl", "CSBuildIndirectArgs", ER_COMPUTE);
+
+		mRootSignature = aRHI->CreateRootSignature(3, 0);
+		if (mRootSignature)
+		{
+			mRootSignature->InitDescriptorTable(aRHI, GPU_INSTANCE_CULLING_ROOT_DESCRIPTOR_TABLE_SRV_INDEX, { ER_RHI_DESCRIPTOR_RANGE_TYPE::ER_RHI_DESCRIPTOR_RANGE_TYPE_SRV }, { 0 }, { 1 });
+			mRootSignature->InitDescriptorTable(aRHI, GPU_INSTANCE_CULLING_ROOT_DESCRIPTOR_TABLE_UAV_INDEX, { ER_RHI_DESCRIPTOR_RANGE_TYPE::ER_RHI_DESCRIPTOR_RANGE_TYPE_UAV }, { 0 }, { 3 });
+			mRootSignature->InitDescriptorTable(aRHI, GPU_INSTANCE_CULLING_ROOT_DESCRIPTOR_TABLE_CBV_INDEX, { ER_RHI_DESCRIPTOR_RANGE_TYPE::ER_RHI_DESCRIPTOR_RANGE_TYPE_CBV }, { 0 }, { 1 });
+			mRootSignature->Finalize(aRHI, "ER_RHI_GPURootSignature: GPU Instance Culler Pass");
+		}
+	}
+
+	ER_GPUInstanceCuller::~ER_GPUInstanceCuller()
+	{
+		DeleteObject(mCullInstancesCS);
+		DeleteObject(mBuildIndirectArgsCS);
+		DeleteObject(mRootSignature);
+	}
+
+	bool ER_GPUInstanceCuller::IsSupported(ER_RHI* aRHI)
+	{
+		return aRHI && aRHI->GetAPI() == ER_GRAPHICS_API::DX11;
+	}
+
+	ER_GPUCulledInstances* ER_GPUInstanceCuller::CreateCulledInstances(ER_RHI* aRHI, const std::string& aName, UINT aInstanceCount, const std::vector<std::vector<UINT>>& aLODMeshesIndexCounts)
+	{
+		assert(aInstanceCount > 0);
+		assert(aLODMeshesIndexCounts.size() > 0 && aLODMeshesIndexCounts.size() <= MAX_LOD);
+
+		const UINT lodCount = static_cast<UINT>(aLODMeshesIndexCounts.size());
+		ER_GPUCulledInstances* culledInstances = new ER_GPUCulledInstances();
+		culledInstances->InstanceCount = aInstanceCount;
+
+		// every LOD bucket can hold all instances; meshes of a LOD read their bucket with StartInstanceLocation
+		std::vector<ER_RHI_DRAW_INDEXED_INSTANCED_ARGS> args;
+		for (UINT lod = 0; lod < lodCount; lod++)
+		{
+			culledInstances->LODArgsOffsets[lod] = static_cast<UINT>(args.size());
+			culledInstances->LODMeshesCounts[lod] = static_cast<UINT>(aLODMeshesIndexCounts[lod].size());
+			for (UINT indexCount : aLODMeshesIndexCounts[lod])
+				args.push_back({ indexCount, 0, 0, 0, lod * aInstanceCount });
+		}
+
+		culledInstances->Instances = aRHI->CreateGPUBuffer("ER_RHI_GPUBuffer: GPU Culled Instances - Instances: " + aName);
+		culledInstances->Instances->CreateGPUBufferResource(aRHI, nullptr, aInstanceCount, sizeof(InstancedData), true, ER_BIND_SHADER_RESOURCE, 0, ER_RESOURCE_MISC_BUFFER_STRUCTURED);
+
+		culledInstances->CulledInstances = aRHI->CreateGPUBuffer("ER_RHI_GPUBuffer: GPU Culled Instances - Culled Instances: " + aName);
+		culledInstances->CulledInstances->CreateGPUBufferResource(aRHI, nullptr, lodCount * aInstanceCount, sizeof(InstancedData), false, ER_BIND_UNORDERED_ACCESS, 0, ER_RESOURCE_MISC_BUFFER_STRUCTURED);
+
+		culledInstances->CulledInstancesVertexBuffer = aRHI->CreateGPUBuffer("ER_RHI_GPUBuffer: GPU Culled Instances - Instance Buffer: " + aName);
+		culledInstances->CulledInstancesVertexBuffer->CreateGPUBufferResource(aRHI, nullptr, lodCount * aInstanceCount, sizeof(InstancedData), false, ER_BIND_VERTEX_BUFFER);
+
+		std::vector<UINT> counters(MAX_LOD, 0);
+		culledInstances->LODCounters = aRHI->CreateGPUBuffer("ER_RHI_GPUBuffer: GPU Culled Instances - LOD Counters: " + aName);
+		culledInstances->LODCounters->CreateGPUBufferResource(aRHI, counters.data(), MAX_LOD, sizeof(UINT), false, ER_BIND_UNORDERED_ACCESS, 0, ER_RESOURCE_MISC_NONE, ER_FORMAT_R32_UINT);
+
+		culledInstances->IndirectArgs = aRHI->CreateGPUBuffer("ER_RHI_GPUBuffer: GPU Culled Instances - Indirect Args: " + aName);
+		culledInstances->IndirectArgs->CreateGPUBufferResource(aRHI, args.data(), static_cast<UINT>(args.size() * sizeof(ER_RHI_DRAW_INDEXED_INSTANCED_ARGS) / sizeof(UINT)), sizeof(UINT), false,
+			ER_BIND_UNORDERED_ACCESS, 0, ER_RESOURCE_MISC_DRAWINDIRECT_ARGS, ER_FORMAT_R32_UINT);
+
+		culledInstances->CullingCB.Initialize(aRHI, "ER_RHI_GPUBuffer: GPU Culled Instances CB: " + aName);
+		return culledInstances;
+	}
+
+	void ER_GPUInstanceCuller::Cull(ER_RHI* aRHI, ER_GPUCulledInstances& aCulledInstances, const GPUInstanceCullingCBufferData::InstanceCullingCB& aParams)
+	{
+		assert(aParams.Counts.x <= aCulledInstances.InstanceCount);
+
+		aCulledInstances.CullingCB.Data = aParams;
+		aCulledInstances.CullingCB.Data.LODArgsOffsets = XMUINT4(aCulledInstances.LODArgsOffsets[0], aCulledInstances.LODArgsOffsets[1], aCulledInstances.LODArgsOffsets[2], 0);
+		aCulledInstances.CullingCB.Data.LODMeshesCounts = XMUINT4(aCulledInstances.LODMeshesCounts[0], aCulledInstances.LODMeshesCounts[1], aCulledInstances.LODMeshesCounts[2], 0);
+		aCulledInstances.CullingCB.Data.Counts.z = aCulledInstances.InstanceCount;
+		aCulledInstances.CullingCB.ApplyChanges(aRHI);
+
+		aRHI->SetRootSignature(mRootSignature, true);
+		aRHI->SetConstantBuffers(ER_COMPUTE, { aCulledInstances.CullingCB.Buffer() }, 0, mRootSignature, GPU_INSTANCE_CULLING_ROOT_DESCRIPTOR_TABLE_CBV_INDEX, true);
+		aRHI->SetShaderResources(ER_COMPUTE, { aCulledInstances.Instances }, 0, mRootSignature, GPU_INSTANCE_CULLING_ROOT_DESCRIPTOR_TABLE_SRV_INDEX, true);
+		aRHI->SetUnorderedAccessResources(ER_COMPUTE, { aCulledInstances.CulledInstances, aCulledInstances.LODCounters, aCulledInstances.IndirectArgs }, 0,
+			mRootSignature, GPU_INSTANCE_CULLING_ROOT_DESCRIPTOR_TABLE_UAV_INDEX, true);
+
+		// cull + append to LOD buckets
+		if (!aRHI->IsPSOReady(mCullInstancesPassPSOName, true))
+		{
+			aRHI->InitializePSO(mCullInstancesPassPSOName, true);
+			aRHI->SetRootSignatureToPSO(mCullInstancesPassPSOName, mRootSignature, true);
+			aRHI->SetShader(mCullInstancesCS);
+			aRHI->FinalizePSO(mCullInstancesPassPSOName, true);
+		}
+		aRHI->SetPSO(mCullInstancesPassPSOName, true);
+		aRHI->Dispatch(ER_DivideByMultiple(aParams.Counts.x, GPU_INSTANCE_CULLING_THREAD_GROUP_SIZE), 1, 1);
+		aRHI->UnsetPSO();
+
+		// bucket sizes -> instance counts of the indirect args (+ counters reset for the next frame)
+		if (!aRHI->IsPSOReady(mBuildIndirectArgsPassPSOName, true))
+		{
+			aRHI->InitializePSO(mBuildIndirectArgsPassPSOName, true);
+			aRHI->SetRootSignatureToPSO(mBuildIndirectArgsPassPSOName, mRootSignature, true);
+			aRHI->SetShader(mBuildIndirectArgsCS);
+			aRHI->FinalizePSO(mBuildIndirectArgsPassPSOName, true);
+		}
+		aRHI->SetPSO(mBuildIndirectArgsPassPSOName, true);
+		aRHI->Dispatch(1, 1, 1);
+		aRHI->UnsetPSO();
+		aRHI->UnbindResourcesFromShader(ER_COMPUTE);
+
+		aRHI->CopyBuffer(aCulledInstances.CulledInstancesVertexBuffer, aCulledInstances.CulledInstances, aRHI->GetCurrentGraphicsCommandListIndex());
+		aCulledInstances.IsCulled = true;
+	}
+
+	bool ER_GPUInstanceCuller::ValidateCull(ER_RHI* aRHI, ER_GPUCulledInstances& aCulledInstances, const GPUInstanceCullingCBufferData::InstanceCullingCB& aParams, const InstancedData* aInstances,
+		const std::string& aName)
+	{
+		assert(aRHI && aInstances);
+		if (!aCulledInstances.IsCulled)
+			return false;
+
+		const UINT lodCount = aParams.Counts.y;
+		const UINT bucketSize = aCulledInstances.InstanceCount;
+		const UINT argsCount = aCulledInstances.LODArgsOffsets[lodCount - 1] + aCulledInstances.LODMeshesCounts[lodCount - 1];
+
+		// staging copies of the culled instances and of the indirect args (as in ER_Terrain::ReadbackPlacedPositions())
+		ER_RHI_GPUBuffer* culledInstancesReadback = aRHI->CreateGPUBuffer("ER_RHI_GPUBuffer: GPU Culled Instances - Culled Instances Readback: " + aName);
+		culledInstancesReadback->CreateGPUBufferResource(aRHI, nullptr, lodCount * bucketSize, sizeof(InstancedData), false, ER_BIND_NONE, 0x10000L | 0x20000L /*legacy from DX11*/, ER_RESOURCE_MISC_BUFFER_STRUCTURED);
+		ER_RHI_GPUBuffer* indirectArgsReadback = aRHI->CreateGPUBuffer("ER_RHI_GPUBuffer: GPU Culled Instances - Indirect Args Readback: " + aName);
+		indirectArgsReadback->CreateGPUBufferResource(aRHI, nullptr, static_cast<UINT>(argsCount * sizeof(ER_RHI_DRAW_INDEXED_INSTANCED_ARGS) / sizeof(UINT)), sizeof(UINT), false,
+			ER_BIND_NONE, 0x10000L | 0x20000L /*legacy from DX11*/, ER_RESOURCE_MISC_NONE, ER_FORMAT_R32_UINT);
+
+		aRHI->CopyBuffer(culledInstancesReadback, aCulledInstances.CulledInstances, aRHI->GetCurrentGraphicsCommandListIndex());
+		aRHI->CopyBuffer(indirectArgsReadback, aCulledInstances.IndirectArgs, aRHI->GetCurrentGraphicsCommandListIndex());
+
+		std::vector<InstancedData> referenceInstances[MAX_LOD];
+		CullReference(aParams, aInstances, referenceInstances);
+
+		// the GPU appends in an arbitrary order, so both buckets are sorted before the comparison
+		auto isLess = [](const InstancedData& a, const InstancedData& b) { return memcmp(&a, &b, sizeof(InstancedData)) < 0; };
+
+		std::vector<UINT> gpuCounts(lodCount, 0);
+		std::vector<InstancedData> gpuInstances;
+		bool isMatching = true;
+		{
+			void* argsData = nullptr;
+			aRHI->BeginBufferRead(indirectArgsReadback, &argsData);
+			const ER_RHI_DRAW_INDEXED_INSTANCED_ARGS* args = reinterpret_cast<const ER_RHI_DRAW_INDEXED_INSTANCED_ARGS*>(argsData);
+			for (UINT lod = 0; lod < lodCount; lod++)
+			{
+				gpuCounts[lod] = args[aCulledInstances.LODArgsOffsets[lod]].InstanceCount;
+				for (UINT mesh = 0; mesh < aCulledInstances.LODMeshesCounts[lod]; mesh++)
+					isMatching = isMatching && args[aCulledInstances.LODArgsOffsets[lod] + mesh].InstanceCount == gpuCounts[lod]; // all meshes of a LOD draw the same instances
+			}
+			aRHI->EndBufferRead(indirectArgsReadback);
+		}
+		{
+			void* instancesData = nullptr;
+			aRHI->BeginBufferRead(culledInstancesReadback, &instancesData);
+			const InstancedData* instances = reinterpret_cast<const InstancedData*>(instancesData);
+			for (UINT lod = 0; lod < lodCount; lod++)
+			{
+				std::vector<InstancedData>& referenceBucket = referenceInstances[lod];
+				if (gpuCounts[lod] != referenceBucket.size() || gpuCounts[lod] > bucketSize)
+				{
+					isMatching = false;
+					continue;
+				}
+
+				gpuInstances.assign(instances + lod * bucketSize, instances + lod * bucketSize + gpuCounts[lod]);
+				std::sort(gpuInstances.begin(), gpuInstances.end(), isLess);
+				std::sort(referenceBucket.begin(), referenceBucket.end(), isLess);
+				isMatching = isMatching && (gpuInstances.empty() || memcmp(gpuInstances.data(), referenceBucket.data(), gpuInstances.size() * sizeof(InstancedData)) == 0);
+			}
+			aRHI->EndBufferRead(culledInstancesReadback);
+		}
+
+		DeleteObject(culledInstancesReadback);
+		DeleteObject(indirectArgsReadback);
+
+		std::string message = "[ER Logger][ER_GPUInstanceCuller] Validation of " + aName + (isMatching ? ": GPU matches the CPU reference" : ": GPU DIFFERS from the CPU reference") + ", visible instances per LOD (GPU/CPU):";
+		for (UINT lod = 0; lod < lodCount; lod++)
+			message += " " + std::to_string(gpuCounts[lod]) + "/" + std::to_string(referenceInstances[lod].size());
+		ER_OUTPUT_LOG(ER_Utility::ToWideString(message + "\n").c_str());
+		return isMatching;
+	}
+
+	GPUInstanceCullingCBufferData::InstanceCullingCB ER_GPUInstanceCuller::GetCullingParams(const ER_Frustum& aFrustum, const XMFLOAT3& aCameraPosition, const ER_AABB& aLocalAABB,
+		UINT aInstanceCount, UINT aLODCount)
+	{
+		assert(aLODCount > 0 && aLODCount <= MAX_LOD);
+
+		GPUInstanceCullingCBufferData::InstanceCullingCB params;
+		ZeroMemory(&params, sizeof(params));
+		for (int i = 0; i < 6; i++)
+			params.FrustumPlanes[i] = aFrustum.Planes()[i];
+		params.CameraPosition = XMFLOAT4(aCameraPosition.x, aCameraPosition.y, aCameraPosition.z, 1.0f);
+		params.LocalAABBMin = XMFLOAT4(aLocalAABB.first.x, aLocalAABB.first.y, aLocalAABB.first.z, 1.0f);
+		params.LocalAABBMax = XMFLOAT4(aLocalAABB.second.x, aLocalAABB.second.y, aLocalAABB.second.z, 1.0f);
+		params.LODDistancesSqr = XMFLOAT4(
+			ER_Utility::DistancesLOD[0] * ER_Utility::DistancesLOD[0],
+			ER_Utility::DistancesLOD[1] * ER_Utility::DistancesLOD[1],
+			ER_Utility::DistancesLOD[2] * ER_Utility::DistancesLOD[2], 0.0f);
+		// objects without LODs are not culled by distance (same as the CPU path, which skips UpdateLODs() for them)
+		if (aLODCount == 1)
+			params.LODDistancesSqr.x = FLT_MAX;
+		params.Counts = XMUINT4(aInstanceCount, aLODCount, aInstanceCount, 0);
+		return params;
+	}
+
+	int ER_GPUInstanceCuller::SelectLOD(const XMFLOAT3& aCameraPosition, const XMFLOAT3& aPosition, int aLODCount)
+	{
+		const float distanceToCameraSqr =
+			(aCameraPosition.x - aPosition.x) * (aCameraPosition.x - aPosition.x) +
+			(aCameraPosition.y - aPosition.y) * (aCameraPosition.y - aPosition.y) +
+			(aCameraPosition.z - aPosition.z) * (aCameraPosition.z - aPosition.z);
+
+		for (int lod = 0; lod < aLODCount; lod++)
+		{
+			if (distanceToCameraSqr <= ER_Utility::DistancesLOD[lod] * ER_Utility::DistancesLOD[lod])
+				return lod;
+		}
+		return -1;
+	}
+
+	int ER_GPUInstanceCuller::CullAndSelectLOD(const GPUInstanceCullingCBufferData::InstanceCullingCB& aParams, const XMFLOAT4X4& aWorld)
+	{
+		// world AABB of the instance (as in ER_RenderingObject::UpdateAABB())
+		const XMMATRIX world = XMLoadFloat4x4(&aWorld);
+		XMVECTOR minVertex = XMVectorReplicate(FLT_MAX);
+		XMVECTOR maxVertex = XMVectorReplicate(-FLT_MAX);
+		for (int i = 0; i < 8; i++)
+		{
+			const XMVECTOR corner = XMVectorSet(
+				(i & 1) ? aParams.LocalAABBMax.x : aParams.LocalAABBMin.x,
+				(i & 2) ? aParams.LocalAABBMax.y : aParams.LocalAABBMin.y,
+				(i & 4) ? aParams.LocalAABBMax.z : aParams.LocalAABBMin.z, 1.0f);
+			const XMVECTOR worldCorner = XMVector3Transform(corner, world);
+			minVertex = XMVectorMin(minVertex, worldCorner);
+			maxVertex = XMVectorMax(maxVertex, worldCorner);
+		}
+		XMFLOAT3 aabbMin, aabbMax;
+		XMStoreFloat3(&aabbMin, minVertex);
+		XMStoreFloat3(&aabbMax, maxVertex);
+
+		// the box is culled if its nearest corner is in front of some (outward facing) plane, as in ER_FrustumCuller::IsAABBCulled()
+		for (int planeID = 0; planeID < 6; planeID++)
+		{
+			const XMFLOAT4& plane = aParams.FrustumPlanes[planeID];
+			const float x = plane.x > 0.0f ? aabbMin.x : aabbMax.x;
+			const float y = plane.y > 0.0f ? aabbMin.y : aabbMax.y;
+			const float z = plane.z > 0.0f ? aabbMin.z : aabbMax.z;
+			if (plane.x * x + plane.y * y + plane.z * z + plane.w > 0.0f)
+				return -1;
+		}
+
+		const float distanceToCameraSqr =
+			(aParams.CameraPosition.x - aWorld._41) * (aParams.CameraPosition.x - aWorld._41) +
+			(aParams.CameraPosition.y - aWorld._42) * (aParams.CameraPosition.y - aWorld._42) +
+			(aParams.CameraPosition.z - aWorld._43) * (aParams.CameraPosition.z - aWorld._43);
+		const float lodDistancesSqr[MAX_LOD] = { aParams.LODDistancesSqr.x, aParams.LODDistancesSqr.y, aParams.LODDistancesSqr.z };
+		for (int lod = 0; lod < static_cast<int>(aParams.Counts.y); lod++)
+		{
+			if (distanceToCameraSqr <= lodDistancesSqr[lod])
+				return lod;
+		}
+		return -1;
+	}
+
+	void ER_GPUInstanceCuller::CullReference(const GPUInstanceCullingCBufferData::InstanceCullingCB& aParams, const InstancedData* aInstances, std::vector<InstancedData>* outLODsInstances)
+	{
+		for (UINT lod = 0; lod < aParams.Counts.y; lod++)
+			outLODsInstances[lod].clear();
+
+		for (UINT i = 0; i < aParams.Counts.x; i++)
+		{
+			const int lod = CullAndSelectLOD(aParams, aInstances[i].World);
+			if (lod != -1)
+				outLODsInstances[lod].push_back(aInstances[i]);
+		}
+	}
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include "Common.h"
+#include "RHI/ER_RHI.h"
+
+#define GPU_INSTANCE_CULLING_THREAD_GROUP_SIZE 64 // same as in InstanceCulling.hlsl
+
+namespace EveryRay_Core
+{
+	class ER_Frustum;
+	struct InstancedData;
+
+	namespace GPUInstanceCullingCBufferData
+	{
+		struct ER_ALIGN_GPU_BUFFER InstanceCullingCB
+		{
+			XMFLOAT4 FrustumPlanes[6];
+			XMFLOAT4 CameraPosition;
+			XMFLOAT4 LocalAABBMin;
+			XMFLOAT4 LocalAABBMax;
+			XMFLOAT4 LODDistancesSqr; // instances beyond the last LOD's distance are culled
+			XMUINT4 LODArgsOffsets; // first indirect args entry of every LOD
+			XMUINT4 LODMeshesCounts; // LODArgsOffsets/LODMeshesCounts are filled by ER_GPUInstanceCuller::Cull()
+			XMUINT4 Counts; // x - instances, y - LODs, z - instances per LOD bucket
+		};
+	}
+
+	// GPU resources of one instanced object (created by ER_GPUInstanceCuller::CreateCulledInstances())
+	struct ER_GPUCulledInstances
+	{
+		ER_RHI_GPUBuffer* Instances = nullptr; // all instances (persistent, only re-uploaded when they change)
+		ER_RHI_GPUBuffer* CulledInstances = nullptr; // visible instances bucketed by LOD (LODCount * InstanceCount), written by the cull pass
+		ER_RHI_GPUBuffer* CulledInstancesVertexBuffer = nullptr; // copy of CulledInstances for the input assembler (structured buffers can't be vertex buffers)
+		ER_RHI_GPUBuffer* LODCounters = nullptr; // append counters of the LOD buckets
+		ER_RHI_GPUBuffer* IndirectArgs = nullptr; // ER_RHI_DRAW_INDEXED_INSTANCED_ARGS per mesh per LOD
+		ER_RHI_GPUConstantBuffer<GPUInstanceCullingCBufferData::InstanceCullingCB> CullingCB;
+		UINT LODArgsOffsets[MAX_LOD] = {};
+		UINT LODMeshesCounts[MAX_LOD] = {};
+		UINT InstanceCount = 0;
+		bool IsCulled = false; // at least one cull pass was dispatched
+
+		~ER_GPUCulledInstances();
+		UINT GetArgsOffset(int lod, int meshIndex) const { return (LODArgsOffsets[lod] + meshIndex) * sizeof(ER_RHI_DRAW_INDEXED_INSTANCED_ARGS); }
+	};
+
+	// GPU-driven culling and LOD selection for instanced objects (main camera):
+	// instances are culled against the frustum and appended to LOD buckets in a compute pass, then every mesh of every LOD
+	// is drawn with DrawIndexedInstancedIndirect() from arguments that the GPU wrote (no per-frame CPU culling or instance uploads).
+	// The CPU reference (CullAndSelectLOD(), CullReference()) uses the same math as the shader and as the CPU path of ER_RenderingObject.
+	class ER_GPUInstanceCuller
+	{
+	public:
+		ER_GPUInstanceCuller(ER_RHI* aRHI);
+		~ER_GPUInstanceCuller();
+
+		static bool IsSupported(ER_RHI* aRHI); // DX12 stays on the CPU culling path (the culled instances' copy would need state transitions)
+
+		// aLODMeshesIndexCounts - index counts of every mesh of every LOD
+		ER_GPUCulledInstances* CreateCulledInstances(ER_RHI* aRHI, const std::string& aName, UINT aInstanceCount, const std::vector<std::vector<UINT>>& aLODMeshesIndexCounts);
+		void Cull(ER_RHI* aRHI, ER_GPUCulledInstances& aCulledInstances, const GPUInstanceCullingCBufferData::InstanceCullingCB& aParams);
+		// Reads the results of the last Cull() back (stall) and compares them with CullReference() for the same instances and params (output in log).
+		// Returns false if the LOD buckets differ.
+		bool ValidateCull(ER_RHI* aRHI, ER_GPUCulledInstances& aCulledInstances, const GPUInstanceCullingCBufferData::InstanceCullingCB& aParams, const InstancedData* aInstances,
+			const std::string& aName);
+
+		static GPUInstanceCullingCBufferData::InstanceCullingCB GetCullingParams(const ER_Frustum& aFrustum, const XMFLOAT3& aCameraPosition, const ER_AABB& aLocalAABB,
+			UINT aInstanceCount, UINT aLODCount);
+
+		// CPU reference of the shader: LOD of the instance or -1 if it is culled
+		static int CullAndSelectLOD(const GPUInstanceCullingCBufferData::InstanceCullingCB& aParams, const XMFLOAT4X4& aWorld);
+		// CPU reference of the whole pass: visible instances bucketed by LOD (in the order of aInstances, the GPU's order within a bucket is arbitrary)
+		static void CullReference(const GPUInstanceCullingCBufferData::InstanceCullingCB& aParams, const InstancedData* aInstances, std::vector<InstancedData>* outLODsInstances);
+		// LOD by the distance from the camera to the instance (-1 - farther than the last LOD), shared with ER_RenderingObject::UpdateLODs()
+		static int SelectLOD(const XMFLOAT3& aCameraPosition, const XMFLOAT3& aPosition, int aLODCount);
+	private:
+		ER_RHI_GPUShader* mCullInstancesCS = nullptr;
+		ER_RHI_GPUShader* mBuildIndirectArgsCS = nullptr;
+		ER_RHI_GPURootSignature* mRootSignature = nullptr;
+		std::string mCullInstancesPassPSOName = "ER_RHI_GPUPipelineStateObject: GPU Instance Culler - Cull Instances Pass";
+		std::string mBuildIndirectArgsPassPSOName = "ER_RHI_GPUPipelineStateObject: GPU Instance Culler - Build Indirect Args Pass";
+	};
+}
@@ -1,5 +1,6 @@
 #include "stdafx.h"
 #include <stdio.h>
+#include <algorithm>
 
 #include "ER_Illumination.h"
 #include "ER_CoreTime.h"
@@ -26,6 +27,8 @@
 #include "ER_RenderingObject.h"
 #include "ER_Skybox.h"
 #include "ER_VolumetricFog.h"
+#include "ER_SphericalHarmonics.h"
+#include "ER_JobSystem.h"
 
 static float clearColorBlack[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
 
@@ -119,6 +122,7 @@ namespace EveryRay_Core {
 		DeleteObject(mVoxelizationDebugRS);
 		DeleteObject(mForwardLightingRS);
 		DeleteObject(mDebugProbesRenderRS);
+		DeleteObject(mClusteredLighting);
 
 		mVoxelizationDebugConstantBuffer.Release();
 		mVoxelConeTracingMainConstantBuffer.Release();
@@ -211,6 +215,8 @@ namespace EveryRay_Core {
 			mLightProbesConstantBuffer.Initialize(rhi, "ER_RHI_GPUBuffer: Light Probes CB");
 		}
 
+		mClusteredLighting = new ER_ClusteredLighting(*mCore);
+
 		//RTs and gizmos
 		{
 			if (mCurrentGIQuality != GIQuality::GI_LOW)
@@ -303,7 +309,7 @@ namespace EveryRay_Core {
 			{
 				mDeferredLightingRS->InitStaticSampler(rhi, 0, ER_RHI_SAMPLER_STATE::ER_TRILINEAR_WRAP, ER_RHI_SHADER_VISIBILITY_ALL);
 				mDeferredLightingRS->InitStaticSampler(rhi, 1, ER_RHI_SAMPLER_STATE::ER_SHADOW_SS, ER_RHI_SHADER_VISIBILITY_ALL);
-				mDeferredLightingRS->InitDescriptorTable(rhi, DEFERRED_LIGHTING_PASS_ROOT_DESCRIPTOR_TABLE_SRV_INDEX, { ER_RHI_DESCRIPTOR_RANGE_TYPE::ER_RHI_DESCRIPTOR_RANGE_TYPE_SRV }, { 0 }, { 18 }, ER_RHI_SHADER_VISIBILITY_ALL);
+				mDeferredLightingRS->InitDescriptorTable(rhi, DEFERRED_LIGHTING_PASS_ROOT_DESCRIPTOR_TABLE_SRV_INDEX, { ER_RHI_DESCRIPTOR_RANGE_TYPE::ER_RHI_DESCRIPTOR_RANGE_TYPE_SRV }, { 0 }, { 21 }, ER_RHI_SHADER_VISIBILITY_ALL);
 				mDeferredLightingRS->InitDescriptorTable(rhi, DEFERRED_LIGHTING_PASS_ROOT_DESCRIPTOR_TABLE_UAV_INDEX, { ER_RHI_DESCRIPTOR_RANGE_TYPE::ER_RHI_DESCRIPTOR_RANGE_TYPE_UAV }, { 0 }, { 1 }, ER_RHI_SHADER_VISIBILITY_ALL);
 				mDeferredLightingRS->InitDescriptorTable(rhi, DEFERRED_LIGHTING_PASS_ROOT_DESCRIPTOR_TABLE_CBV_INDEX, { ER_RHI_DESCRIPTOR_RANGE_TYPE::ER_RHI_DESCRIPTOR_RANGE_TYPE_CBV }, { 0 }, { 2 }, ER_RHI_SHADER_VISIBILITY_ALL);
 				mDeferredLightingRS->Finalize(rhi, "ER_RHI_GPURootSignature: Deferred Lighting Pass");
@@ -314,7 +320,7 @@ namespace EveryRay_Core {
 			{
 				mForwardLightingRS->InitStaticSampler(rhi, 0, ER_RHI_SAMPLER_STATE::ER_TRILINEAR_WRAP, ER_RHI_SHADER_VISIBILITY_PIXEL);
 				mForwardLightingRS->InitStaticSampler(rhi, 1, ER_RHI_SAMPLER_STATE::ER_SHADOW_SS, ER_RHI_SHADER_VISIBILITY_PIXEL);
-				mForwardLightingRS->InitDescriptorTable(rhi, FORWARD_LIGHTING_PASS_ROOT_DESCRIPTOR_TABLE_SRV_INDEX, { ER_RHI_DESCRIPTOR_RANGE_TYPE::ER_RHI_DESCRIPTOR_RANGE_TYPE_SRV }, { 0 }, { 18 }, ER_RHI_SHADER_VISIBILITY_PIXEL);
+				mForwardLightingRS->InitDescriptorTable(rhi, FORWARD_LIGHTING_PASS_ROOT_DESCRIPTOR_TABLE_SRV_INDEX, { ER_RHI_DESCRIPTOR_RANGE_TYPE::ER_RHI_DESCRIPTOR_RANGE_TYPE_SRV }, { 0 }, { 21 }, ER_RHI_SHADER_VISIBILITY_PIXEL);
 				mForwardLightingRS->InitDescriptorTable(rhi, FORWARD_LIGHTING_PASS_ROOT_DESCRIPTOR_TABLE_CBV_INDEX, { ER_RHI_DESCRIPTOR_RANGE_TYPE::ER_RHI_DESCRIPTOR_RANGE_TYPE_CBV }, { 0 }, { 3 }, ER_RHI_SHADER_VISIBILITY_ALL);
 				mForwardLightingRS->Finalize(rhi, "ER_RHI_GPURootSignature: Forward Lighting Pass", true);
 			}
@@ -370,6 +376,10 @@ namespace EveryRay_Core {
 		}
 		rhi->EndEventTag();
 
+		rhi->BeginEventTag("EveryRay: Clustered Lighting - Build Clusters");
+		mClusteredLighting->Build(rhi);
+		rhi->EndEventTag();
+
 		rhi->BeginEventTag("EveryRay: Deferred Lighting");
 		DrawDeferredLighting(gbuffer, mLocalIlluminationRT);
 		rhi->EndEventTag();
@@ -427,20 +437,17 @@ namespace EveryRay_Core {
 
 				std::string materialName = ER_MaterialHelper::voxelizationMaterialName + "_" + std::to_string(cascade);
 				const std::string& psoName = voxelizationPSONames[cascade];
+				ER_RHI_PSO_HANDLE& psoHandle = mVoxelizationPSOHandles[cascade];
 
-				for (auto& obj : mVoxelizationObjects[cascade])
+				for (ER_RenderingObject* renderingObject : mVoxelizationObjects[cascade])
 				{
-					if (!obj.second->IsInVoxelization())
-						continue;
-
-					ER_RenderingObject* renderingObject = obj.second;
 					auto materialInfo = renderingObject->GetMaterials().find(materialName);
 					if (materialInfo != renderingObject->GetMaterials().end())
 					{
 						ER_Material* material = materialInfo->second;
-						for (int meshIndex = 0; meshIndex < obj.second->GetMeshCount(); meshIndex++)
+						for (int meshIndex = 0; meshIndex < renderingObject->GetMeshCount(); meshIndex++)
 						{
-							if (!rhi->IsPSOReady(psoName))
+							if (psoHandle == ER_RHI_INVALID_PSO_HANDLE)
 							{
 								rhi->InitializePSO(psoName);
 								material->PrepareShaders();
@@ -448,12 +455,12 @@ namespace EveryRay_Core {
 								rhi->SetRootSignatureToPSO(psoName, mVoxelizationRS);
 								rhi->SetTopologyTypeToPSO(psoName, ER_RHI_PRIMITIVE_TYPE::ER_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 								rhi->SetRenderTargetFormats({});
-								rhi->FinalizePSO(psoName);
+								psoHandle = rhi->FinalizePSO(psoName);
 							}
-							rhi->SetPSO(psoName);
+							rhi->SetPSO(psoHandle);
 							static_cast<ER_VoxelizationMaterial*>(material)->PrepareForRendering(materialSystems, renderingObject, meshIndex,
 								mWorldVoxelScales[cascade], voxelCascadesSizes[cascade], mVoxelCameraPositions[cascade], mVoxelizationRS);
-							renderingObject->Draw(materialName, true, meshIndex);
+							renderingObject->DrawVoxelCascade(materialName, meshIndex, cascade);
 							rhi->UnsetPSO();
 						}
 					}
@@ -560,7 +567,7 @@ namespace EveryRay_Core {
 			}
 			rhi->SetPSO(mVCTMainPSOName, true);
 			rhi->SetSamplers(ER_COMPUTE, { ER_RHI_SAMPLER_STATE::ER_TRILINEAR_WRAP });
-			std::vector<ER_RHI_GPUResource*> resources(4 + NUM_VOXEL_GI_CASCADES);
+			ER_RHI_GPUResource* resources[4 + NUM_VOXEL_GI_CASCADES] = {};
 			resources[0] = gbuffer->GetAlbedo();
 			resources[1] = gbuffer->GetNormals();
 			resources[2] = gbuffer->GetPositions();
@@ -686,6 +693,10 @@ namespace EveryRay_Core {
 			}
 		}
 
+		// cascades are moved before the AABBs are computed, so CPUCullObjectsAgainstVoxelCascades() culls against the positions that are voxelized
+		mClusteredLighting->Update(mCamera, scene->GetLocalLights());
+
+		UpdateVoxelCameraPosition();
 		for (int cascade = 0; cascade < NUM_VOXEL_GI_CASCADES; cascade++)
 		{
 			mWorldVoxelCascadesAABBs[cascade] = mLocalVoxelCascadesAABBs[cascade];
@@ -695,10 +706,11 @@ namespace EveryRay_Core {
 			mWorldVoxelCascadesAABBs[cascade].second.x += mVoxelCameraPositions[cascade].x;
 			mWorldVoxelCascadesAABBs[cascade].second.y += mVoxelCameraPositions[cascade].y;
 			mWorldVoxelCascadesAABBs[cascade].second.z += mVoxelCameraPositions[cascade].z;
+
+			if (mIsVCTVoxelCameraPositionsUpdated[cascade] && mDebugVoxelZonesGizmos[cascade])
+				mDebugVoxelZonesGizmos[cascade]->Update(mWorldVoxelCascadesAABBs[cascade]);
 		}
 
-		CPUCullObjectsAgainstVoxelCascades(scene);
-		UpdateVoxelCameraPosition();
 		UpdateImGui();
 	}
 
@@ -737,8 +749,30 @@ namespace EveryRay_Core {
 				ImGui::Checkbox("DEBUG - Hide culled probes", &mProbesManager->mDebugDiscardCulledProbes);
 				ImGui::Checkbox("DEBUG - Diffuse probes", &mDrawDiffuseProbes);
 				ImGui::Checkbox("DEBUG - Specular probes", &mDrawSpecularProbes);
+				ImGui::Separator();
+				if (ImGui::Button("Run CPU spherical harmonics tests (output in log)"))
+					ER_SphericalHarmonics::RunTests((ER_JobSystem*)mCore->GetServices().FindService(ER_JobSystem::TypeIdClass()));
+				if (ImGui::Button("Run CPU spherical harmonics benchmark (output in log)"))
+					ER_SphericalHarmonics::RunBenchmark((ER_JobSystem*)mCore->GetServices().FindService(ER_JobSystem::TypeIdClass()));
+				if (mProbesManager->AreGlobalProbesReady() && ImGui::Button("Validate CPU spherical harmonics of the global probe vs. GPU (output in log)"))
+					ER_LightProbe::ValidateSphericalHarmonics(mCore->GetRHI(), mProbesManager->GetGlobalDiffuseProbe()->GetCubemapTexture());
+				if (mCore->GetRHI()->GetAPI() == ER_GRAPHICS_API::DX11 && ImGui::Button("Rebake probes near changed objects"))
+					mProbesManager->RebakeChangedLocalProbes();
 			}
 		}
+		if (ImGui::CollapsingHeader("Local Lights - Clustered"))
+		{
+			const ER_ClusteredLightingStats& stats = mClusteredLighting->GetStats();
+			ImGui::Text("Clusters build: %s", stats.IsBuiltOnGPU ? "GPU" : "CPU");
+			ImGui::Text("Lights (visible/scene): %u/%u", stats.VisibleLightsCount, stats.SceneLightsCount);
+			if (!stats.IsBuiltOnGPU)
+				ImGui::Text("Light indices: %u, max per cluster: %u", stats.LightIndicesCount, stats.MaxLightsPerCluster);
+			ImGui::Separator();
+			if (ImGui::Button("Run clustered lighting tests (output in log)"))
+				ER_ClusteredLighting::RunTests();
+			if (ImGui::Button("Run clustered lighting benchmark (output in log)"))
+				ER_ClusteredLighting::RunBenchmark();
+		}
 		ImGui::End();
 	}
 
@@ -767,13 +801,10 @@ namespace EveryRay_Core {
 				mCamera.Position().x > voxelGridBoundsMax.x || mCamera.Position().y > voxelGridBoundsMax.y || mCamera.Position().z > voxelGridBoundsMax.z)
 			{
 				mVoxelCameraPositions[i] = XMFLOAT4(mCamera.Position().x, mCamera.Position().y, mCamera.Position().z, 1.0f);
-				mIsVCTVoxelCameraPositionsUpdated = true;
-
-				if (mDebugVoxelZonesGizmos[i])
-					mDebugVoxelZonesGizmos[i]->Update(mWorldVoxelCascadesAABBs[i]);
+				mIsVCTVoxelCameraPositionsUpdated[i] = true;
 			}
 			else
-				mIsVCTVoxelCameraPositionsUpdated = false;
+				mIsVCTVoxelCameraPositionsUpdated[i] = false;
 		}
 	}
 
@@ -801,6 +832,7 @@ namespace EveryRay_Core {
 			mDeferredLightingConstantBuffer.Data.SSSWidth = mSSSWidth;
 			mDeferredLightingConstantBuffer.Data.SSSDirectionLightMaxPlane = mSSSDirectionalLightPlaneScale;
 			mDeferredLightingConstantBuffer.Data.SSSAvailable = (mIsSSS && !mIsSSSCulled) ? 1.0f : -1.0f;
+			mDeferredLightingConstantBuffer.Data.ClusteredLighting = mClusteredLighting->GetShaderParams();
 			mDeferredLightingConstantBuffer.ApplyChanges(rhi);
 
 			if (mProbesManager->IsEnabled())
@@ -833,7 +865,7 @@ namespace EveryRay_Core {
 				else
 					rhi->SetConstantBuffers(ER_COMPUTE, { mDeferredLightingConstantBuffer.Buffer() }, 0, mDeferredLightingRS, DEFERRED_LIGHTING_PASS_ROOT_DESCRIPTOR_TABLE_CBV_INDEX, true);
 
-				std::vector<ER_RHI_GPUResource*> resources(18);
+				ER_RHI_GPUResource* resources[21] = {};
 				resources[0] = gbuffer->GetAlbedo();
 				resources[1] = gbuffer->GetNormals();
 				resources[2] = gbuffer->GetPositions();
@@ -851,6 +883,9 @@ namespace EveryRay_Core {
 				resources[15] = mProbesManager->IsEnabled() ? mProbesManager->GetSpecularProbesTexArrayIndicesBuffer() : nullptr;
 				resources[16] = mProbesManager->IsEnabled() ? mProbesManager->GetSpecularProbesPositionsBuffer() : nullptr;
 				resources[17] = mProbesManager->GetIntegrationMap();
+				resources[18] = mClusteredLighting->GetLightsBuffer();
+				resources[19] = mClusteredLighting->GetClustersGridBuffer();
+				resources[20] = mClusteredLighting->GetClustersLightIndicesBuffer();
 				rhi->SetShaderResources(ER_COMPUTE, resources, 0, mDeferredLightingRS, DEFERRED_LIGHTING_PASS_ROOT_DESCRIPTOR_TABLE_SRV_INDEX, true);
 			}
 
@@ -894,7 +929,8 @@ namespace EveryRay_Core {
 		auto rhi = mCore->GetRHI();
 
 		std::string& psoName = aObj->IsInstanced() ? mForwardLightingInstancingPSOName : mForwardLightingPSOName;
-		if (!rhi->IsPSOReady(psoName))
+		ER_RHI_PSO_HANDLE& psoHandle = aObj->IsInstanced() ? mForwardLightingInstancingPSOHandle : mForwardLightingPSOHandle;
+		if (psoHandle == ER_RHI_INVALID_PSO_HANDLE)
 		{
 			rhi->InitializePSO(psoName);
 			rhi->SetInputLayout(aObj->IsInstanced() ? mForwardLightingRenderingObjectInputLayout_Instancing : mForwardLightingRenderingObjectInputLayout);
@@ -906,9 +942,9 @@ namespace EveryRay_Core {
 			rhi->SetRenderTargetFormats({ mLocalIlluminationRT }, mGbuffer->GetDepth());
 			rhi->SetTopologyTypeToPSO(psoName, ER_RHI_PRIMITIVE_TYPE::ER_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 			rhi->SetRootSignatureToPSO(psoName, mForwardLightingRS);
-			rhi->FinalizePSO(psoName);
+			psoHandle = rhi->FinalizePSO(psoName);
 		}
-		rhi->SetPSO(psoName);
+		rhi->SetPSO(psoHandle);
 		rhi->SetSamplers(ER_PIXEL, { ER_RHI_SAMPLER_STATE::ER_TRILINEAR_WRAP, ER_RHI_SAMPLER_STATE::ER_SHADOW_SS });
 	}
 
@@ -928,6 +964,7 @@ namespace EveryRay_Core {
 			mForwardLightingConstantBuffer.Data.SunDirection = XMFLOAT4{ -mDirectionalLight.Direction().x, -mDirectionalLight.Direction().y, -mDirectionalLight.Direction().z, 1.0f };
 			mForwardLightingConstantBuffer.Data.SunColor = XMFLOAT4{ mDirectionalLight.GetDirectionalLightColor().x, mDirectionalLight.GetDirectionalLightColor().y, mDirectionalLight.GetDirectionalLightColor().z, mDirectionalLight.GetDirectionalLightIntensity() };
 			mForwardLightingConstantBuffer.Data.CameraPosition = XMFLOAT4{ mCamera.Position().x,mCamera.Position().y,mCamera.Position().z, 1.0f };
+			mForwardLightingConstantBuffer.Data.ClusteredLighting = mClusteredLighting->GetShaderParams();
 			mForwardLightingConstantBuffer.ApplyChanges(rhi);
 
 			if (mProbesManager->IsEnabled())
@@ -950,7 +987,7 @@ namespace EveryRay_Core {
 
 			if (mProbesManager->AreGlobalProbesReady())
 			{
-				std::vector<ER_RHI_GPUResource*> resources(18);
+				ER_RHI_GPUResource* resources[21] = {};
 				resources[0] = aObj->GetTextureData(meshIndex).AlbedoMap;
 				resources[1] = aObj->GetTextureData(meshIndex).NormalMap;
 				resources[2] = aObj->GetTextureData(meshIndex).MetallicMap;
@@ -968,6 +1005,9 @@ namespace EveryRay_Core {
 				resources[15] = mProbesManager->IsEnabled() ? mProbesManager->GetSpecularProbesTexArrayIndicesBuffer() : nullptr;
 				resources[16] = mProbesManager->IsEnabled() ? mProbesManager->GetSpecularProbesPositionsBuffer() : nullptr;
 				resources[17] = mProbesManager->GetIntegrationMap();
+				resources[18] = mClusteredLighting->GetLightsBuffer();
+				resources[19] = mClusteredLighting->GetClustersGridBuffer();
+				resources[20] = mClusteredLighting->GetClustersLightIndicesBuffer();
 				rhi->SetShaderResources(ER_PIXEL, resources, 0, mForwardLightingRS, FORWARD_LIGHTING_PASS_ROOT_DESCRIPTOR_TABLE_SRV_INDEX);
 			}
 
@@ -980,44 +1020,66 @@ namespace EveryRay_Core {
 		return mGbuffer->GetDepth();
 	}
 
+	// Voxel cascades are culled in parallel (one job per cascade), candidates come from the scene BVH. Every cascade gets a flat list of objects
+	// (instanced objects cull their instances into their own list for that cascade, which is uploaded only when it changes).
+	// Cascades are re-voxelized every frame: voxels are lit with a shadow cascade that follows the main camera and with casters outside of the cascade.
 	void ER_Illumination::CPUCullObjectsAgainstVoxelCascades(const ER_Scene* scene)
 	{
 		if (mCurrentGIQuality == GIQuality::GI_LOW)
 			return;
 
-		//TODO add instancing support
-		//TODO fix repetition checks when the object AABB is bigger than the lower cascade (i.e. sponza)
+		ER_CPU_PROFILE_SCOPE(mCore->CPUProfiler(), "ER_Illumination::CPUCullObjectsAgainstVoxelCascades");
+
 		//TODO add optimization for culling objects by checking its volume size in second+ cascades
 		//TODO add indirect drawing support (GPU cull)
-		//TODO add multithreading per cascade
-		for (int cascade = 0; cascade < NUM_VOXEL_GI_CASCADES; cascade++)
+		auto cullCascade = [this, scene](int cascade)
 		{
-			for (auto& objectInfo : scene->objects)
+			const ER_AABB& cascadeAABB = mWorldVoxelCascadesAABBs[cascade];
+
+			std::vector<ER_RenderingObject*>& candidates = mTempVoxelCascadeQueryResults[cascade];
+			candidates.clear();
+			scene->GetBVH().QueryAABB(cascadeAABB, candidates);
+
+			std::vector<ER_RenderingObject*>& objects = mVoxelizationObjects[cascade];
+			objects.clear();
+			for (ER_RenderingObject* object : candidates)
 			{
-				if (!objectInfo.second->IsInVoxelization())
+				if (!object->IsInVoxelization() || !object->IsRendered())
 					continue;
 
-				auto aabbObj = objectInfo.second->GetLocalAABB();
-				XMFLOAT3 position;
-				ER_MatrixHelper::GetTranslation(objectInfo.second->GetTransformationMatrix(), position);
-				aabbObj.first.x += position.x;
-				aabbObj.first.y += position.y;
-				aabbObj.first.z += position.z;
-				aabbObj.second.x += position.x;
-				aabbObj.second.y += position.y;
-				aabbObj.second.z += position.z;
-
-				bool isColliding =
-					(aabbObj.first.x <= mWorldVoxelCascadesAABBs[cascade].second.x && aabbObj.second.x >= mWorldVoxelCascadesAABBs[cascade].first.x) &&
-					(aabbObj.first.y <= mWorldVoxelCascadesAABBs[cascade].second.y && aabbObj.second.y >= mWorldVoxelCascadesAABBs[cascade].first.y) &&
-					(aabbObj.first.z <= mWorldVoxelCascadesAABBs[cascade].second.z && aabbObj.second.z >= mWorldVoxelCascadesAABBs[cascade].first.z);
-
-				auto it = mVoxelizationObjects[cascade].find(objectInfo.first);
-				if (isColliding && (it == mVoxelizationObjects[cascade].end()))
-					mVoxelizationObjects[cascade].insert(objectInfo);
-				else if (!isColliding && (it != mVoxelizationObjects[cascade].end()))
-					mVoxelizationObjects[cascade].erase(it);
+				if (object->IsInstanced())
+				{
+					object->CullInstancesAgainstVoxelCascade(cascade, cascadeAABB);
+					if (object->GetVoxelCascadeInstanceCount(cascade) == 0)
+						continue;
+				}
+				else
+				{
+					// BVH leaves are enlarged, so we test the exact world AABB (rotation and scale included)
+					const ER_AABB& aabb = object->GetGlobalAABB();
+					if (aabb.first.x > cascadeAABB.second.x || aabb.second.x < cascadeAABB.first.x ||
+						aabb.first.y > cascadeAABB.second.y || aabb.second.y < cascadeAABB.first.y ||
+						aabb.first.z > cascadeAABB.second.z || aabb.second.z < cascadeAABB.first.z)
+						continue;
+				}
+
+				objects.push_back(object);
 			}
+		};
+
+		ER_JobSystem* jobSystem = (ER_JobSystem*)mCore->GetServices().FindService(ER_JobSystem::TypeIdClass());
+		if (jobSystem)
+		{
+			jobSystem->ParallelFor(NUM_VOXEL_GI_CASCADES, 1, [&cullCascade](UINT begin, UINT end)
+			{
+				for (UINT cascade = begin; cascade < end; cascade++)
+					cullCascade(static_cast<int>(cascade));
+			});
+		}
+		else
+		{
+			for (int cascade = 0; cascade < NUM_VOXEL_GI_CASCADES; cascade++)
+				cullCascade(cascade);
 		}
 	}
 }
\ No newline at end of file
@@ -2,10 +2,10 @@
 #include "Common.h"
 #include "ER_CoreComponent.h"
 #include "ER_LightProbesManager.h"
+#include "ER_ClusteredLighting.h"
 
 #include "RHI/ER_RHI.h"
 
-#define NUM_VOXEL_GI_CASCADES 2
 #define NUM_VOXEL_GI_TEX_MIPS 6
 
 namespace EveryRay_Core
@@ -78,6 +78,7 @@ namespace EveryRay_Core
 			float SSSWidth;
 			float SSSDirectionLightMaxPlane;
 			float SSSAvailable;
+			ClusteredLightingCBufferData::ClusteredLightingParams ClusteredLighting;
 		};
 		struct ER_ALIGN_GPU_BUFFER ForwardLightingCB
 		{
@@ -88,6 +89,7 @@ namespace EveryRay_Core
 			XMFLOAT4 SunDirection;
 			XMFLOAT4 SunColor;
 			XMFLOAT4 CameraPosition;
+			ClusteredLightingCBufferData::ClusteredLightingParams ClusteredLighting;
 		};
 		struct ER_ALIGN_GPU_BUFFER LightProbesCB
 		{
@@ -115,6 +117,8 @@ namespace EveryRay_Core
 		void DrawDebugProbes(ER_RHI_GPUTexture* aRenderTarget, ER_RHI_GPUTexture* aDepth);
 
 		void Update(const ER_CoreTime& gameTime, const ER_Scene* scene);
+		// After the objects' UpdateCPU() and ER_Scene::UpdateSpatialIndex() (uses the scene BVH and the world AABBs of the current frame)
+		void CPUCullObjectsAgainstVoxelCascades(const ER_Scene* scene);
 		void Config() { mShowDebug = !mShowDebug; }
 
 		void SetShadowMap(ER_RHI_GPUTexture* tex) { mShadowMap = tex; }
@@ -147,8 +151,6 @@ namespace EveryRay_Core
 		void UpdateImGui();
 		void UpdateVoxelCameraPosition();
 
-		void CPUCullObjectsAgainstVoxelCascades(const ER_Scene* scene);
-
 		ER_Camera& mCamera;
 		const ER_DirectionalLight& mDirectionalLight;
 		const ER_ShadowMapper& mShadowMapper;
@@ -159,7 +161,9 @@ namespace EveryRay_Core
 		ER_GBuffer* mGbuffer = nullptr;
 
 		using RenderingObjectInfo = std::map<std::string, ER_RenderingObject*>;
-		RenderingObjectInfo mVoxelizationObjects[NUM_VOXEL_GI_CASCADES];
+		// results of CPUCullObjectsAgainstVoxelCascades() (instanced objects also keep their per cascade instance lists)
+		std::vector<ER_RenderingObject*> mVoxelizationObjects[NUM_VOXEL_GI_CASCADES];
+		std::vector<ER_RenderingObject*> mTempVoxelCascadeQueryResults[NUM_VOXEL_GI_CASCADES];
 
 		ER_RHI_GPUConstantBuffer<IlluminationCBufferData::VoxelizationDebugCB> mVoxelizationDebugConstantBuffer;
 		ER_RHI_GPUConstantBuffer<IlluminationCBufferData::VoxelConeTracingMainCB> mVoxelConeTracingMainConstantBuffer;
@@ -185,6 +189,7 @@ namespace EveryRay_Core
 		ER_RHI_GPUShader* mVCTVoxelizationDebugPS = nullptr;
 		std::string mVoxelizationDebugPSOName = "ER_RHI_GPUPipelineStateObject: VCT GI - Voxelization Pass Debug";
 		ER_RHI_GPURootSignature* mVoxelizationRS = nullptr;
+		ER_RHI_PSO_HANDLE mVoxelizationPSOHandles[NUM_VOXEL_GI_CASCADES] = { ER_RHI_INVALID_PSO_HANDLE, ER_RHI_INVALID_PSO_HANDLE };
 		ER_RHI_GPURootSignature* mVoxelizationDebugRS = nullptr;
 
 		ER_RHI_GPUShader* mVCTMainCS = nullptr;
@@ -208,6 +213,8 @@ namespace EveryRay_Core
 		ER_RHI_GPUShader* mForwardLightingPS = nullptr;
 		std::string mForwardLightingPSOName = "ER_RHI_GPUPipelineStateObject: Forward Lighting Pass";
 		std::string mForwardLightingInstancingPSOName = "ER_RHI_GPUPipelineStateObject: Forward Lighting (Instancing) Pass";
+		ER_RHI_PSO_HANDLE mForwardLightingPSOHandle = ER_RHI_INVALID_PSO_HANDLE;
+		ER_RHI_PSO_HANDLE mForwardLightingInstancingPSOHandle = ER_RHI_INVALID_PSO_HANDLE;
 		ER_RHI_GPURootSignature* mForwardLightingRS = nullptr;
 
 		ER_RHI_GPUShader* mForwardLightingDiffuseProbesPS = nullptr;
@@ -221,6 +228,8 @@ namespace EveryRay_Core
 
 		ER_RHI_GPURootSignature* mDebugProbesRenderRS = nullptr;
 
+		ER_ClusteredLighting* mClusteredLighting = nullptr; // point/spot lights of the scene
+
 		//VCT GI
 		XMFLOAT4 mVoxelCameraPositions[NUM_VOXEL_GI_CASCADES];
 		ER_AABB mLocalVoxelCascadesAABBs[NUM_VOXEL_GI_CASCADES]; // constant, must not change after initialization
@@ -236,7 +245,7 @@ namespace EveryRay_Core
 		float mVCTVoxelSampleOffset = 0.0f;
 		float mVCTGIPower = 1.0f;
 		float mVCTDownscaleFactor = 0.5f; // % from full-res RT
-		bool mIsVCTVoxelCameraPositionsUpdated = true;
+		bool mIsVCTVoxelCameraPositionsUpdated[NUM_VOXEL_GI_CASCADES] = { true, true };
 		bool mShowVCTVoxelizationOnly = false;
 		bool mShowVCTAmbientOcclusionOnly = false;
 		bool mDrawVCTVoxelZonesGizmos = false;
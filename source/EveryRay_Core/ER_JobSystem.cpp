@@ -0,0 +1,214 @@
+#include "stdafx.h"
+
+#include "ER_JobSystem.h"
+#include "ER_Core.h"
+#include "ER_Utility.h"
+
+namespace EveryRay_Core
+{
+	RTTI_DEFINITIONS(ER_JobSystem)
+
+	void ER_JobQueue::Push(ER_Job&& aJob)
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mJobs.push_back(std::move(aJob));
+	}
+
+	bool ER_JobQueue::Pop(ER_Job& aOutJob)
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		if (mJobs.empty())
+			return false;
+
+		aOutJob = std::move(mJobs.back());
+		mJobs.pop_back();
+		return true;
+	}
+
+	bool ER_JobQueue::Steal(ER_JobQueue& aVictim, ER_Job& aOutJob)
+	{
+		std::lock_guard<std::mutex> lock(aVictim.mMutex);
+		if (aVictim.mJobs.empty())
+			return false;
+
+		aOutJob = std::move(aVictim.mJobs.front());
+		aVictim.mJobs.pop_front();
+		return true;
+	}
+
+	ER_JobSystem::ER_JobSystem(ER_Core& game, UINT workerCount)
+		: ER_CoreComponent(game)
+		, mOwnerThreadId(std::this_thread::get_id())
+	{
+		StartWorkers(workerCount == 0 ? GetMaxWorkerCount() : workerCount);
+	}
+
+	ER_JobSystem::~ER_JobSystem()
+	{
+		StopWorkers();
+	}
+
+	UINT ER_JobSystem::GetMaxWorkerCount()
+	{
+		UINT hardwareThreads = std::thread::hardware_concurrency();
+		return (hardwareThreads > 1) ? hardwareThreads - 1 : 1; // main thread is also working, when waiting
+	}
+
+	void ER_JobSystem::StartWorkers(UINT count)
+	{
+		assert(!mIsRunning);
+		assert(count > 0);
+
+		mQueues.clear();
+		for (UINT i = 0; i < count + 1; i++)
+			mQueues.push_back(std::make_unique<ER_JobQueue>());
+
+		mIsRunning = true;
+		for (UINT i = 0; i < count; i++)
+			mWorkers.emplace_back(&ER_JobSystem::WorkerLoop, this, i);
+
+		std::string message = "[ER Logger][ER_JobSystem] Started " + std::to_string(count) + " worker threads.\n";
+		ER_OUTPUT_LOG(ER_Utility::ToWideString(message).c_str());
+	}
+
+	void ER_JobSystem::StopWorkers()
+	{
+		assert(std::this_thread::get_id() == mOwnerThreadId);
+
+		// finish everything that was scheduled before shutting down
+		while (mPendingJobs > 0)
+			TryExecuteJob(-1);
+
+		{
+			std::lock_guard<std::mutex> lock(mWakeMutex);
+			mIsRunning = false;
+		}
+		mWakeCondition.notify_all();
+
+		for (auto& worker : mWorkers)
+		{
+			if (worker.joinable())
+				worker.join();
+		}
+		mWorkers.clear();
+
+		// jobs that were scheduled by other jobs while the workers were stopping
+		while (mPendingJobs > 0)
+			TryExecuteJob(-1);
+
+		assert(mExecuteCallsCount == 0);
+		mQueues.clear();
+	}
+
+	void ER_JobSystem::SetWorkerCount(UINT count)
+	{
+		assert(std::this_thread::get_id() == mOwnerThreadId);
+
+		count = std::max(1u, std::min(count, GetMaxWorkerCount()));
+		if (count == GetWorkerCount())
+			return;
+
+		StopWorkers();
+		StartWorkers(count);
+	}
+
+	void ER_JobSystem::RunJob(ER_Job& aJob)
+	{
+		aJob.Task();
+		if (aJob.Counter)
+			aJob.Counter->fetch_sub(1);
+	}
+
+	// Executes one job from own queue (or steals one from others). Main thread uses index -1 (its queue is the last one).
+	bool ER_JobSystem::TryExecuteJob(int workerIndex)
+	{
+		const UINT queueCount = static_cast<UINT>(mQueues.size());
+		const UINT ownQueueIndex = (workerIndex < 0) ? queueCount - 1 : static_cast<UINT>(workerIndex);
+
+		ER_Job job;
+		bool found = mQueues[ownQueueIndex]->Pop(job);
+		for (UINT i = 1; i < queueCount && !found; i++)
+		{
+			UINT victimIndex = (ownQueueIndex + i) % queueCount;
+			found = mQueues[ownQueueIndex]->Steal(*mQueues[victimIndex], job);
+		}
+
+		if (!found)
+			return false;
+
+		mPendingJobs.fetch_sub(1);
+		RunJob(job);
+		return true;
+	}
+
+	void ER_JobSystem::WorkerLoop(UINT workerIndex)
+	{
+		mCore->CPUProfiler()->SetCurrentThreadName("Job worker " + std::to_string(workerIndex));
+		while (mIsRunning)
+		{
+			if (TryExecuteJob(workerIndex))
+				continue;
+
+			std::unique_lock<std::mutex> lock(mWakeMutex);
+			mWakeCondition.wait(lock, [this]() { return !mIsRunning || mPendingJobs > 0; });
+		}
+	}
+
+	void ER_JobSystem::Execute(const std::function<void()>& aTask, ER_JobCounter& aCounter)
+	{
+		mExecuteCallsCount.fetch_add(1);
+		aCounter.fetch_add(1);
+
+		ER_Job job;
+		job.Task = aTask;
+		job.Counter = &aCounter;
+
+		// counted before it is pushed, so that a worker that pops it right away never takes the counter below zero
+		{
+			std::lock_guard<std::mutex> lock(mWakeMutex);
+			mPendingJobs.fetch_add(1);
+		}
+
+		// distribute jobs between worker queues (idle workers will steal the rest)
+		UINT queueIndex = mNextQueue.fetch_add(1) % static_cast<UINT>(mQueues.size());
+		mQueues[queueIndex]->Push(std::move(job));
+
+		mWakeCondition.notify_one();
+		mExecuteCallsCount.fetch_sub(1);
+	}
+
+	void ER_JobSystem::Wait(ER_JobCounter& aCounter)
+	{
+		// help the workers instead of blocking
+		while (aCounter > 0)
+		{
+			if (!TryExecuteJob(-1))
+				std::this_thread::yield();
+		}
+	}
+
+	void ER_JobSystem::ParallelFor(UINT count, UINT batchSize, const std::function<void(UINT begin, UINT end)>& aTask)
+	{
+		if (count == 0)
+			return;
+
+		batchSize = std::max(1u, batchSize);
+		if (count <= batchSize)
+		{
+			aTask(0, count);
+			return;
+		}
+
+		ER_JobCounter counter { 0 };
+		for (UINT begin = 0; begin < count; begin += batchSize)
+		{
+			UINT end = std::min(begin + batchSize, count);
+			Execute([this, &aTask, begin, end]()
+			{
+				ER_CPU_PROFILE_SCOPE(mCore->CPUProfiler(), "ER_JobSystem::ParallelFor (batch)");
+				aTask(begin, end);
+			}, counter);
+		}
+		Wait(counter);
+	}
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include "Common.h"
+#include "ER_CoreComponent.h"
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <condition_variable>
+
+namespace EveryRay_Core
+{
+	// Counter of unfinished jobs (decremented when a job is done); used for waiting on a group of jobs
+	using ER_JobCounter = std::atomic<int>;
+
+	struct ER_Job
+	{
+		std::function<void()> Task;
+		ER_JobCounter* Counter = nullptr;
+	};
+
+	// Per-worker job queue: the owner pushes/pops from the back, other workers steal from the front
+	class ER_JobQueue
+	{
+	public:
+		void Push(ER_Job&& aJob);
+		bool Pop(ER_Job& aOutJob);
+		bool Steal(ER_JobQueue& aVictim, ER_Job& aOutJob);
+	private:
+		std::deque<ER_Job> mJobs;
+		std::mutex mMutex;
+	};
+
+	// Work-stealing job system for CPU-side per-frame work (culling, LODs, etc.).
+	// Available as a core service (ER_CoreServicesContainer); the calling thread always participates in the work while waiting.
+	class ER_JobSystem : public ER_CoreComponent
+	{
+		RTTI_DECLARATIONS(ER_JobSystem, ER_CoreComponent)
+
+	public:
+		ER_JobSystem(ER_Core& game, UINT workerCount = 0 /* 0 - (hardware threads - 1) */);
+		~ER_JobSystem();
+
+		// Can be called from any thread (e.g., asset registry and shader cache requests), but not while SetWorkerCount() runs
+		void Execute(const std::function<void()>& aTask, ER_JobCounter& aCounter);
+		void Wait(ER_JobCounter& aCounter);
+
+		// Splits [0, count) into batches of 'batchSize' and runs them in parallel; returns when all batches are processed
+		void ParallelFor(UINT count, UINT batchSize, const std::function<void(UINT begin, UINT end)>& aTask);
+
+		// Main thread only (the one that created the job system) and with no concurrent Execute() calls: the queues are rebuilt
+		void SetWorkerCount(UINT count);
+		UINT GetWorkerCount() const { return static_cast<UINT>(mWorkers.size()); }
+		static UINT GetMaxWorkerCount();
+	private:
+		void StartWorkers(UINT count);
+		void StopWorkers();
+		void WorkerLoop(UINT workerIndex);
+		bool TryExecuteJob(int workerIndex);
+		static void RunJob(ER_Job& aJob);
+
+		std::vector<std::thread> mWorkers;
+		std::vector<std::unique_ptr<ER_JobQueue>> mQueues; // one per worker + one for the main thread (last)
+
+		std::mutex mWakeMutex;
+		std::condition_variable mWakeCondition;
+		std::atomic<int> mPendingJobs { 0 };
+		std::atomic<UINT> mNextQueue { 0 };
+		std::atomic<bool> mIsRunning { false };
+
+		std::thread::id mOwnerThreadId;
+		std::atomic<int> mExecuteCallsCount { 0 }; // Execute() calls in flight (to assert that the queues are not rebuilt under them)
+	};
+}
@@ -18,6 +18,7 @@
 #include "ER_QuadRenderer.h"
 #include "ER_RenderToLightProbeMaterial.h"
 #include "ER_MaterialsCallbacks.h"
+#include "ER_SphericalHarmonics.h"
 
 #define DIFFUSE_PROBE 0
 #define SPECULAR_PROBE 1
@@ -106,21 +107,82 @@ namespace EveryRay_Core
 			(mPosition.z > aMax.z || mPosition.z < aMin.z);
 	}
 
-	void ER_LightProbe::StoreSphericalHarmonicsFromCubemap(ER_Core& game, ER_RHI_GPUTexture* aTextureConvoluted)
+	// Projects the read back cubemap on the CPU and compares it with the CPU reference and with the RHI's projection (DX11: DirectX::SHProjectCubeMap()), if it has one
+	bool ER_LightProbe::ValidateSphericalHarmonics(ER_RHI* aRHI, ER_RHI_GPUTexture* aCubemap)
 	{
-		if (game.GetRHI()->GetAPI() != ER_GRAPHICS_API::DX11)
-			throw ER_CoreException("Storing SH from cubemap is only available on DX11 at the moment.");
+		assert(aRHI);
+		if (!aCubemap)
+			return false;
+
+		std::vector<XMFLOAT4> cubemapTexels;
+		const UINT size = aCubemap->GetWidth();
+		if (!aRHI->ReadGPUTextureToCPU(aCubemap, 0, cubemapTexels) || cubemapTexels.size() != CUBEMAP_FACES_COUNT * size * size)
+		{
+			ER_OUTPUT_LOG(L"[ER Logger][ER_LightProbe] Could not read the cubemap back from the GPU, spherical harmonics are not validated \n");
+			return false;
+		}
+
+		XMFLOAT3 coefficients[SPHERICAL_HARMONICS_COEF_COUNT];
+		XMFLOAT3 referenceCoefficients[SPHERICAL_HARMONICS_COEF_COUNT];
+		const ER_SHCubemap cubemap(cubemapTexels.data(), size);
+		if (!ER_SphericalHarmonics::ProjectCubemap(SPHERICAL_HARMONICS_ORDER, cubemap, coefficients) ||
+			!ER_SphericalHarmonics::ProjectCubemapReference(SPHERICAL_HARMONICS_ORDER, cubemap, referenceCoefficients))
+			return false;
+
+		float rgbCoefficients[3][SPHERICAL_HARMONICS_COEF_COUNT] = {};
+		const bool isProjectedByRHI = aRHI->ProjectCubemapToSH(aCubemap, SPHERICAL_HARMONICS_ORDER + 1, rgbCoefficients[0], rgbCoefficients[1], rgbCoefficients[2]);
+
+		float maxValue = 1.0f;
+		float maxReferenceError = 0.0f;
+		float maxRHIError = 0.0f;
+		for (int i = 0; i < SPHERICAL_HARMONICS_COEF_COUNT; i++)
+		{
+			maxValue = std::max(maxValue, std::max(fabs(referenceCoefficients[i].x), std::max(fabs(referenceCoefficients[i].y), fabs(referenceCoefficients[i].z))));
+			maxReferenceError = std::max(maxReferenceError, fabs(coefficients[i].x - referenceCoefficients[i].x));
+			maxReferenceError = std::max(maxReferenceError, fabs(coefficients[i].y - referenceCoefficients[i].y));
+			maxReferenceError = std::max(maxReferenceError, fabs(coefficients[i].z - referenceCoefficients[i].z));
+			if (isProjectedByRHI)
+			{
+				maxRHIError = std::max(maxRHIError, fabs(coefficients[i].x - rgbCoefficients[0][i]));
+				maxRHIError = std::max(maxRHIError, fabs(coefficients[i].y - rgbCoefficients[1][i]));
+				maxRHIError = std::max(maxRHIError, fabs(coefficients[i].z - rgbCoefficients[2][i]));
+			}
+		}
+
+		const float tolerance = 0.001f * maxValue;
+		std::string message = "[ER Logger][ER_LightProbe] CPU spherical harmonics of a " + std::to_string(size) + "x" + std::to_string(size) + " cubemap: max. error vs. the CPU reference " +
+			std::to_string(maxReferenceError) + (isProjectedByRHI ? ", vs. the RHI's projection " + std::to_string(maxRHIError) : ", the RHI has no projection") +
+			" (tolerance " + std::to_string(tolerance) + ")\n";
+		ER_OUTPUT_LOG(ER_Utility::ToWideString(message).c_str());
 
+		return maxReferenceError <= tolerance && maxRHIError <= tolerance;
+	}
+
+	// CPU projection (ER_SphericalHarmonics) of the read back cubemap; RHIs that can not read textures back use their own projection (if any)
+	void ER_LightProbe::StoreSphericalHarmonicsFromCubemap(ER_Core& game, ER_RHI_GPUTexture* aTextureConvoluted)
+	{
 		assert(aTextureConvoluted);
 
 		ER_RHI* rhi = game.GetRHI();
 
-		float rgbCoefficients[3][9] = { 
-			0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f,
-			0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f,
-			0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f
-		};
-		if (!rhi->ProjectCubemapToSH(aTextureConvoluted, SPHERICAL_HARMONICS_ORDER + 1, &rgbCoefficients[0][0], &rgbCoefficients[1][0], &rgbCoefficients[2][0]))
+		XMFLOAT3 coefficients[SPHERICAL_HARMONICS_COEF_COUNT];
+		bool isProjected = false;
+
+		std::vector<XMFLOAT4> cubemapTexels;
+		const UINT size = aTextureConvoluted->GetWidth();
+		if (rhi->ReadGPUTextureToCPU(aTextureConvoluted, 0, cubemapTexels) && cubemapTexels.size() == CUBEMAP_FACES_COUNT * size * size)
+		{
+			isProjected = ER_SphericalHarmonics::ProjectCubemap(SPHERICAL_HARMONICS_ORDER, ER_SHCubemap(cubemapTexels.data(), size), coefficients);
+		}
+		else
+		{
+			float rgbCoefficients[3][SPHERICAL_HARMONICS_COEF_COUNT] = {};
+			isProjected = rhi->ProjectCubemapToSH(aTextureConvoluted, SPHERICAL_HARMONICS_ORDER + 1, rgbCoefficients[0], rgbCoefficients[1], rgbCoefficients[2]);
+			for (int i = 0; i < SPHERICAL_HARMONICS_COEF_COUNT; i++)
+				coefficients[i] = XMFLOAT3(rgbCoefficients[0][i], rgbCoefficients[1][i], rgbCoefficients[2][i]);
+		}
+
+		if (!isProjected)
 		{
 			ER_OUTPUT_LOG(L"[ER Logger][ER_LightProbe] Could not project a cubemap to spherical harmonics. Storing empty coefficients... \n");
 			for (int i = 0; i < SPHERICAL_HARMONICS_COEF_COUNT; i++)
@@ -129,7 +191,7 @@ namespace EveryRay_Core
 		else
 		{
 			for (int i = 0; i < SPHERICAL_HARMONICS_COEF_COUNT; i++)
-				mSphericalHarmonicsRGB[i] = XMFLOAT3(rgbCoefficients[0][i], rgbCoefficients[1][i], rgbCoefficients[2][i]);
+				mSphericalHarmonicsRGB[i] = coefficients[i];
 		}
 	}
 
@@ -450,6 +512,21 @@ namespace EveryRay_Core
 		return mIsProbeLoadedFromDisk;
 	}
 
+	bool ER_LightProbe::LoadProbeFromMemory(ER_Core& game, const UINT8* aDDSData, UINT64 aDDSDataSize)
+	{
+		assert(mCubemapTexture && mProbeType == SPECULAR_PROBE);
+		mCubemapTexture->CreateGPUTextureResource(game.GetRHI(), aDDSData, aDDSDataSize, &mIsProbeLoadedFromDisk);
+		return mIsProbeLoadedFromDisk;
+	}
+
+	void ER_LightProbe::SetSphericalHarmonics(const XMFLOAT3* aCoefficients)
+	{
+		assert(aCoefficients && mProbeType == DIFFUSE_PROBE);
+		for (int i = 0; i < SPHERICAL_HARMONICS_COEF_COUNT; i++)
+			mSphericalHarmonicsRGB[i] = aCoefficients[i];
+		mIsProbeLoadedFromDisk = true;
+	}
+
 	std::wstring ER_LightProbe::GetConstructedProbeName(const std::wstring& levelPath, bool inSphericalHarmonics)
 	{
 		std::wstring fileName = levelPath;
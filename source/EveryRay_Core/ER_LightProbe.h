@@ -33,7 +33,10 @@ namespace EveryRay_Core
 		void UpdateProbe(const ER_CoreTime& gameTime);
 
 		bool LoadProbeFromDisk(ER_Core& game, const std::wstring& levelPath);
+		bool LoadProbeFromMemory(ER_Core& game, const UINT8* aDDSData, UINT64 aDDSDataSize); // cubemap payload from the probes archive (thread-safe on DX11)
 		bool IsLoadedFromDisk() { return mIsProbeLoadedFromDisk; }
+		void Invalidate() { mIsProbeLoadedFromDisk = false; } // the next Compute() rebakes the probe (current data is used until then)
+		std::wstring GetConstructedProbeName(const std::wstring& levelPath, bool inSphericalHarmonics = false);
 		
 		ER_RHI_GPUTexture* GetCubemapTexture() const { return mCubemapTexture; }
 
@@ -41,6 +44,7 @@ namespace EveryRay_Core
 		void SetShaderInfoForConvolution(ER_RHI_GPUShader* ps)	{ mConvolutionPS = ps; }
 
 		const std::vector<XMFLOAT3>& GetSphericalHarmonics() { return mSphericalHarmonicsRGB; }
+		void SetSphericalHarmonics(const XMFLOAT3* aCoefficients); // from the probes archive
 
 		void SetPosition(const XMFLOAT3& pos);
 		const XMFLOAT3& GetPosition() { return mPosition; }
@@ -49,12 +53,14 @@ namespace EveryRay_Core
 
 		void CPUCullAgainstProbeBoundingVolume(const XMFLOAT3& aMin, const XMFLOAT3& aMax);
 		bool IsCulled() { return mIsCulled; }
+
+		// CPU projection of the read back cubemap vs. the CPU reference and the RHI's projection (output in log). Returns false if they differ or the cubemap can't be read back.
+		static bool ValidateSphericalHarmonics(ER_RHI* aRHI, ER_RHI_GPUTexture* aCubemap);
 	private:
 		void StoreSphericalHarmonicsFromCubemap(ER_Core& game, ER_RHI_GPUTexture* aTextureConvoluted);
 		void SaveProbeOnDisk(ER_Core& game, const std::wstring& levelPath, ER_RHI_GPUTexture* aTextureConvoluted);
 		void DrawGeometryToProbe(ER_Core& game, ER_RHI_GPUTexture* aTextureNonConvoluted, ER_RHI_GPUTexture** aDepthBuffers, const LightProbeRenderingObjectsInfo& objectsToRender, ER_Skybox* skybox);
 		void ConvoluteProbe(ER_Core& game, ER_QuadRenderer* quadRenderer, ER_RHI_GPUTexture* aTextureNonConvoluted, ER_RHI_GPUTexture* aTextureConvoluted);
-		std::wstring GetConstructedProbeName(const std::wstring& levelPath, bool inSphericalHarmonics = false);
 
 		int mProbeType;
 
@@ -0,0 +1,216 @@
+#include "stdafx.h"
+#include <fstream>
+
+#include "ER_LightProbesArchive.h"
+#include "ER_Utility.h"
+
+#define ER_LIGHT_PROBES_ARCHIVE_PAYLOAD_ALIGNMENT 16
+
+namespace EveryRay_Core
+{
+	bool ER_LightProbesArchiveGrid::IsMatching(const ER_LightProbesArchiveGrid& other) const
+	{
+		const float epsilon = 0.001f;
+		return CountX == other.CountX && CountY == other.CountY && CountZ == other.CountZ &&
+			ProbesCount == other.ProbesCount && ProbesLayoutHash == other.ProbesLayoutHash && fabs(Spacing - other.Spacing) < epsilon &&
+			fabs(MinBounds.x - other.MinBounds.x) < epsilon && fabs(MinBounds.y - other.MinBounds.y) < epsilon && fabs(MinBounds.z - other.MinBounds.z) < epsilon &&
+			fabs(MaxBounds.x - other.MaxBounds.x) < epsilon && fabs(MaxBounds.y - other.MaxBounds.y) < epsilon && fabs(MaxBounds.z - other.MaxBounds.z) < epsilon;
+	}
+
+	ER_LightProbesArchive::ER_LightProbesArchive()
+	{
+	}
+
+	ER_LightProbesArchive::~ER_LightProbesArchive()
+	{
+		Close();
+	}
+
+	bool ER_LightProbesArchive::Open(const std::wstring& path)
+	{
+		Close();
+		if (!mFile.Open(path))
+			return false;
+
+		const UINT8* data = mFile.GetData();
+		const UINT64 size = mFile.GetSize();
+		if (size < sizeof(ER_LightProbesArchiveHeader))
+		{
+			Close();
+			return false;
+		}
+		memcpy(&mHeader, data, sizeof(ER_LightProbesArchiveHeader));
+		if (mHeader.Magic != ER_LIGHT_PROBES_ARCHIVE_MAGIC || mHeader.Version != ER_LIGHT_PROBES_ARCHIVE_VERSION)
+		{
+			Close();
+			return false;
+		}
+
+		// counts come from the file: each block is checked separately, so that a corrupted count cannot wrap the offsets around
+		const UINT64 shOffset = sizeof(ER_LightProbesArchiveHeader);
+		const UINT64 shCoefficientsCount = static_cast<UINT64>(mHeader.DiffuseGrid.GetCount()) * mHeader.SphericalHarmonicsCoefficientsCount; // 32 bit * 32 bit
+		if (shCoefficientsCount > (size - shOffset) / sizeof(XMFLOAT3))
+		{
+			Close();
+			return false;
+		}
+		const UINT64 entriesOffset = shOffset + shCoefficientsCount * sizeof(XMFLOAT3);
+		if (mHeader.SpecularGrid.GetCount() > (size - entriesOffset) / sizeof(ER_LightProbesArchiveEntry))
+		{
+			Close();
+			return false;
+		}
+		const UINT64 payloadsOffset = entriesOffset + static_cast<UINT64>(mHeader.SpecularGrid.GetCount()) * sizeof(ER_LightProbesArchiveEntry);
+		mSphericalHarmonics = reinterpret_cast<const XMFLOAT3*>(data + shOffset);
+		mSpecularEntries = reinterpret_cast<const ER_LightProbesArchiveEntry*>(data + entriesOffset);
+
+		// payloads must be after the entries table and inside of the file
+		for (UINT i = 0; i < mHeader.SpecularGrid.GetCount(); i++)
+		{
+			if (!ER_Utility::IsRangeInFile(mSpecularEntries[i].Offset, mSpecularEntries[i].Size, payloadsOffset, size))
+			{
+				Close();
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void ER_LightProbesArchive::Close()
+	{
+		mFile.Close();
+		mHeader = ER_LightProbesArchiveHeader();
+		mSphericalHarmonics = nullptr;
+		mSpecularEntries = nullptr;
+	}
+
+	bool ER_LightProbesArchive::GetSpecularPayload(UINT index, const UINT8*& outData, UINT64& outSize) const
+	{
+		if (!IsOpen() || index >= mHeader.SpecularGrid.GetCount() || mSpecularEntries[index].Size == 0)
+			return false;
+
+		outData = mFile.GetData() + mSpecularEntries[index].Offset;
+		outSize = mSpecularEntries[index].Size;
+		return true;
+	}
+
+	bool ER_LightProbesArchive::Write(const std::wstring& path, const ER_LightProbesArchiveHeader& header, const XMFLOAT3* sphericalHarmonics, const std::vector<std::wstring>& specularProbesPaths)
+	{
+		assert(sphericalHarmonics || header.DiffuseGrid.GetCount() == 0);
+		assert(specularProbesPaths.size() == header.SpecularGrid.GetCount());
+
+		// the archive is written to a temp file first, so a failed bake never leaves a half-written archive behind
+		const std::wstring tempPath = path + L".tmp";
+		std::ofstream file(tempPath.c_str(), std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+			return false;
+
+		const UINT64 shSize = static_cast<UINT64>(header.DiffuseGrid.GetCount()) * header.SphericalHarmonicsCoefficientsCount * sizeof(XMFLOAT3);
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(sphericalHarmonics), static_cast<std::streamsize>(shSize));
+
+		std::vector<ER_LightProbesArchiveEntry> entries(specularProbesPaths.size());
+		const std::streamoff entriesOffset = file.tellp();
+		file.write(reinterpret_cast<const char*>(entries.data()), static_cast<std::streamsize>(entries.size() * sizeof(ER_LightProbesArchiveEntry)));
+
+		std::vector<char> payload;
+		for (size_t i = 0; i < specularProbesPaths.size(); i++)
+		{
+			std::ifstream payloadFile(specularProbesPaths[i].c_str(), std::ios::binary | std::ios::ate);
+			const std::streamoff payloadSize = payloadFile.is_open() ? static_cast<std::streamoff>(payloadFile.tellg()) : -1;
+			if (payloadSize >= 0)
+			{
+				payload.resize(static_cast<size_t>(payloadSize));
+				payloadFile.seekg(0);
+				payloadFile.read(payload.data(), payload.size());
+			}
+			if (payloadSize < 0 || !payloadFile)
+			{
+				file.close();
+				DeleteFileW(tempPath.c_str());
+				return false;
+			}
+
+			static const char padding[ER_LIGHT_PROBES_ARCHIVE_PAYLOAD_ALIGNMENT] = {};
+			const UINT64 offset = static_cast<UINT64>(file.tellp());
+			const UINT64 alignedOffset = (offset + ER_LIGHT_PROBES_ARCHIVE_PAYLOAD_ALIGNMENT - 1) & ~static_cast<UINT64>(ER_LIGHT_PROBES_ARCHIVE_PAYLOAD_ALIGNMENT - 1);
+			file.write(padding, static_cast<std::streamsize>(alignedOffset - offset));
+
+			entries[i].Offset = alignedOffset;
+			entries[i].Size = payload.size();
+			file.write(payload.data(), payload.size());
+		}
+
+		file.seekp(entriesOffset);
+		file.write(reinterpret_cast<const char*>(entries.data()), static_cast<std::streamsize>(entries.size() * sizeof(ER_LightProbesArchiveEntry)));
+		const bool isWritten = file.good();
+		file.close();
+
+		// replaces the previous file in one step, so a crash never leaves the level without it
+		if (!isWritten || !MoveFileExW(tempPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING))
+		{
+			DeleteFileW(tempPath.c_str());
+			return false;
+		}
+		return true;
+	}
+
+	struct ER_LightProbesBakeDependenciesHeader
+	{
+		UINT32 Magic = ER_LIGHT_PROBES_DEPENDENCIES_MAGIC;
+		UINT32 Version = ER_LIGHT_PROBES_DEPENDENCIES_VERSION;
+		UINT32 ObjectsCount = 0;
+		UINT32 Reserved = 0;
+	};
+
+	bool ER_LightProbesBakeDependencies::Read(const std::wstring& path, std::vector<ER_LightProbesBakeObject>& outObjects)
+	{
+		outObjects.clear();
+
+		ER_MappedFile file;
+		if (!file.Open(path))
+			return false;
+
+		const UINT8* data = file.GetData();
+		const UINT64 size = file.GetSize();
+		if (size < sizeof(ER_LightProbesBakeDependenciesHeader))
+			return false;
+
+		ER_LightProbesBakeDependenciesHeader header;
+		memcpy(&header, data, sizeof(ER_LightProbesBakeDependenciesHeader));
+		if (header.Magic != ER_LIGHT_PROBES_DEPENDENCIES_MAGIC || header.Version != ER_LIGHT_PROBES_DEPENDENCIES_VERSION)
+			return false;
+
+		const UINT64 objectsSize = static_cast<UINT64>(header.ObjectsCount) * sizeof(ER_LightProbesBakeObject);
+		if (sizeof(ER_LightProbesBakeDependenciesHeader) + objectsSize > size)
+			return false;
+
+		outObjects.resize(header.ObjectsCount);
+		if (header.ObjectsCount > 0)
+			memcpy(outObjects.data(), data + sizeof(ER_LightProbesBakeDependenciesHeader), static_cast<size_t>(objectsSize));
+		return true;
+	}
+
+	bool ER_LightProbesBakeDependencies::Write(const std::wstring& path, const std::vector<ER_LightProbesBakeObject>& objects)
+	{
+		const std::wstring tempPath = path + L".tmp";
+		std::ofstream file(tempPath.c_str(), std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+			return false;
+
+		ER_LightProbesBakeDependenciesHeader header;
+		header.ObjectsCount = static_cast<UINT32>(objects.size());
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(objects.data()), static_cast<std::streamsize>(objects.size() * sizeof(ER_LightProbesBakeObject)));
+		const bool isWritten = file.good();
+		file.close();
+
+		// replaces the previous file in one step, so a crash never leaves the level without it
+		if (!isWritten || !MoveFileExW(tempPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING))
+		{
+			DeleteFileW(tempPath.c_str());
+			return false;
+		}
+		return true;
+	}
+}
@@ -0,0 +1,96 @@
+#pragma once
+#include "Common.h"
+#include "ER_MappedFile.h"
+
+#define ER_LIGHT_PROBES_ARCHIVE_MAGIC 0x42525045 // "EPRB"
+#define ER_LIGHT_PROBES_ARCHIVE_VERSION 2
+#define ER_LIGHT_PROBES_ARCHIVE_FILE_NAME L"light_probes.erprobes"
+
+#define ER_LIGHT_PROBES_DEPENDENCIES_MAGIC 0x44525045 // "EPRD"
+#define ER_LIGHT_PROBES_DEPENDENCIES_VERSION 2
+#define ER_LIGHT_PROBES_DEPENDENCIES_FILE_NAME L"light_probes.erdeps"
+
+namespace EveryRay_Core
+{
+	// Grid of one probe type at bake time (the archive is only used if it matches the grid of the loaded scene)
+	struct ER_LightProbesArchiveGrid
+	{
+		XMFLOAT3 MinBounds = { 0, 0, 0 };
+		XMFLOAT3 MaxBounds = { 0, 0, 0 };
+		float Spacing = 0.0f;
+		UINT32 CountX = 0;
+		UINT32 CountY = 0;
+		UINT32 CountZ = 0;
+		UINT32 ProbesCount = 0; // == CountX * CountY * CountZ, unless the grid is sparse
+		UINT32 ProbesLayoutHash = 0; // of the grid indices of the probes (sparse grids)
+
+		UINT32 GetCount() const { return ProbesCount; }
+		bool IsMatching(const ER_LightProbesArchiveGrid& other) const;
+	};
+
+	struct ER_LightProbesArchiveHeader
+	{
+		UINT32 Magic = ER_LIGHT_PROBES_ARCHIVE_MAGIC;
+		UINT32 Version = ER_LIGHT_PROBES_ARCHIVE_VERSION;
+		ER_LightProbesArchiveGrid DiffuseGrid;
+		ER_LightProbesArchiveGrid SpecularGrid;
+		UINT32 SphericalHarmonicsCoefficientsCount = 0; // per diffuse probe
+		UINT32 SpecularProbeSize = 0; // cubemap dimension
+	};
+
+	// Location of a specular probe's payload (DDS cubemap with mips) in the archive
+	struct ER_LightProbesArchiveEntry
+	{
+		UINT64 Offset = 0;
+		UINT64 Size = 0;
+	};
+
+	// Packed bake of the level's local light probes (instead of a text file per diffuse probe and a DDS per specular probe).
+	// Layout: [header] [SH block: XMFLOAT3 per coefficient per diffuse probe, in the same order as the GPU buffer] [specular entries] [specular payloads]
+	// The file is memory-mapped while it is open, so the SH block and the payloads are read in place.
+	class ER_LightProbesArchive
+	{
+	public:
+		ER_LightProbesArchive();
+		~ER_LightProbesArchive();
+
+		// Returns false on a missing, corrupted or outdated archive
+		bool Open(const std::wstring& path);
+		void Close();
+		bool IsOpen() const { return mFile.IsOpen(); }
+
+		const ER_LightProbesArchiveHeader& GetHeader() const { return mHeader; }
+		const XMFLOAT3* GetSphericalHarmonics() const { return mSphericalHarmonics; }
+		bool GetSpecularPayload(UINT index, const UINT8*& outData, UINT64& outSize) const;
+
+		// Specular payloads are copied from the probes' DDS files (as saved by the bake)
+		static bool Write(const std::wstring& path, const ER_LightProbesArchiveHeader& header, const XMFLOAT3* sphericalHarmonics, const std::vector<std::wstring>& specularProbesPaths);
+	private:
+		ER_LightProbesArchive(const ER_LightProbesArchive& rhs);
+		ER_LightProbesArchive& operator=(const ER_LightProbesArchive& rhs);
+
+		ER_MappedFile mFile;
+		ER_LightProbesArchiveHeader mHeader;
+		const XMFLOAT3* mSphericalHarmonics = nullptr;
+		const ER_LightProbesArchiveEntry* mSpecularEntries = nullptr;
+	};
+
+	// State of an object (one record per instance for instanced objects) that was rendered into the probes of the bake
+	struct ER_LightProbesBakeObject
+	{
+		UINT64 NameHash = 0; // object's name (+ world transform for instances, so that adding or removing one does not shift the others)
+		UINT64 ContentHash = 0; // local AABB + world transform + model + materials + custom textures
+		XMFLOAT3 MinBounds = { 0, 0, 0 }; // world space
+		XMFLOAT3 MaxBounds = { 0, 0, 0 };
+	};
+
+	// Objects of the level at bake time, stored next to the bake.
+	// Probes near the objects that were changed, added or removed since then are rebaked, the rest of the bake is kept.
+	class ER_LightProbesBakeDependencies
+	{
+	public:
+		// Returns false on a missing, corrupted or outdated file
+		static bool Read(const std::wstring& path, std::vector<ER_LightProbesBakeObject>& outObjects);
+		static bool Write(const std::wstring& path, const std::vector<ER_LightProbesBakeObject>& objects);
+	};
+}
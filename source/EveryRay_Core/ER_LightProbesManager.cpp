@@ -14,9 +14,26 @@
 #include "ER_QuadRenderer.h"
 #include "ER_DebugLightProbeMaterial.h"
 #include "ER_MaterialsCallbacks.h"
+#include "ER_JobSystem.h"
 
 namespace EveryRay_Core
 {
+	static ER_AABB GetWorldAABB(const ER_AABB& aLocalAABB, const XMMATRIX& aTransform)
+	{
+		XMFLOAT3 minVertex = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+		XMFLOAT3 maxVertex = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		for (int i = 0; i < 8; i++)
+		{
+			XMFLOAT3 corner = XMFLOAT3(
+				(i & 1) ? aLocalAABB.second.x : aLocalAABB.first.x,
+				(i & 2) ? aLocalAABB.second.y : aLocalAABB.first.y,
+				(i & 4) ? aLocalAABB.second.z : aLocalAABB.first.z);
+			XMStoreFloat3(&corner, XMVector3Transform(XMLoadFloat3(&corner), aTransform));
+			minVertex = XMFLOAT3(std::min(minVertex.x, corner.x), std::min(minVertex.y, corner.y), std::min(minVertex.z, corner.z));
+			maxVertex = XMFLOAT3(std::max(maxVertex.x, corner.x), std::max(maxVertex.y, corner.y), std::max(maxVertex.z, corner.z));
+		}
+		return ER_AABB(minVertex, maxVertex);
+	}
 
 	ER_LightProbesManager::ER_LightProbesManager(ER_Core& game, ER_Camera& camera, ER_Scene* scene, ER_DirectionalLight* light, ER_ShadowMapper* shadowMapper)
 		: mMainCamera(camera)
@@ -77,11 +94,23 @@ namespace EveryRay_Core
 		if (mDistanceBetweenDiffuseProbes <= 0.0f || mDistanceBetweenSpecularProbes <= 0.0f)
 			throw ER_CoreException("Loaded level has incorrect distances between probes (either diffuse or specular or both). Did you forget to assign them in the level file?");
 
+		mIsSparse = scene->IsLightProbesSparse();
+		if (mIsSparse)
+			CollectSparseProbesObjectsAABBs(scene);
+
 		mSpecularProbesVolumeSize = MAX_CUBEMAPS_IN_VOLUME_PER_AXIS * mDistanceBetweenSpecularProbes * 0.5f;
 		mMaxSpecularProbesInVolumeCount = MAX_CUBEMAPS_IN_VOLUME_PER_AXIS * MAX_CUBEMAPS_IN_VOLUME_PER_AXIS * MAX_CUBEMAPS_IN_VOLUME_PER_AXIS;
 
+		game.CPUProfiler()->BeginCPUTime("Light probes manager: diffuse probes setup");
 		SetupDiffuseProbes(game, camera, scene, light, shadowMapper);
+		game.CPUProfiler()->EndCPUTime("Light probes manager: diffuse probes setup");
+
+		game.CPUProfiler()->BeginCPUTime("Light probes manager: specular probes setup");
 		SetupSpecularProbes(game, camera, scene, light, shadowMapper);
+		game.CPUProfiler()->EndCPUTime("Light probes manager: specular probes setup");
+
+		mSparseObjectsAABBs.clear();
+		mSparseSolidObjectsAABBs.clear();
 	}
 
 	ER_LightProbesManager::~ER_LightProbesManager()
@@ -148,9 +177,8 @@ namespace EveryRay_Core
 		mDiffuseProbesCountX = (maxBounds.x - minBounds.x) / mDistanceBetweenDiffuseProbes + 1;
 		mDiffuseProbesCountY = (maxBounds.y - minBounds.y) / mDistanceBetweenDiffuseProbes + 1;
 		mDiffuseProbesCountZ = (maxBounds.z - minBounds.z) / mDistanceBetweenDiffuseProbes + 1;
-		mDiffuseProbesCountTotal = mDiffuseProbesCountX * mDiffuseProbesCountY * mDiffuseProbesCountZ;
-		assert(mDiffuseProbesCountTotal);
-		mDiffuseProbes.reserve(mDiffuseProbesCountTotal);
+		const int diffuseProbesGridCount = mDiffuseProbesCountX * mDiffuseProbesCountY * mDiffuseProbesCountZ;
+		assert(diffuseProbesGridCount);
 
 		// cells setup
 		mDiffuseProbesCellsCountX = (mDiffuseProbesCountX - 1);
@@ -162,9 +190,6 @@ namespace EveryRay_Core
 		assert(mDiffuseProbesCellsCountTotal);
 
 		float probeCellPositionOffset = static_cast<float>(mDistanceBetweenDiffuseProbes) / 2.0f;
-		mDiffuseProbesCellBounds = {
-			XMFLOAT3(-probeCellPositionOffset, -probeCellPositionOffset, -probeCellPositionOffset),
-			XMFLOAT3(probeCellPositionOffset, probeCellPositionOffset, probeCellPositionOffset) };
 		{
 			for (int cellsY = 0; cellsY < mDiffuseProbesCellsCountY; cellsY++)
 			{
@@ -180,15 +205,17 @@ namespace EveryRay_Core
 						int index = cellsY * (mDiffuseProbesCellsCountX * mDiffuseProbesCellsCountZ) + cellsX * mDiffuseProbesCellsCountZ + cellsZ;
 						mDiffuseProbesCells[index].index = index;
 						mDiffuseProbesCells[index].position = pos;
+						mDiffuseProbesCells[index].lightProbeIndices.assign(PROBE_COUNT_PER_CELL, -1); // -1 - skipped probe (sparse grids)
 					}
 				}
 			}
 		}
 
-		// simple 3D grid distribution of probes
-		for (size_t i = 0; i < mDiffuseProbesCountTotal; i++)
-			mDiffuseProbes.emplace_back(core, light, shadowMapper, DIFFUSE_PROBE_SIZE, DIFFUSE_PROBE, i);
-
+		// simple 3D grid distribution of probes (sparse grids keep only the probes near the objects)
+		std::vector<XMFLOAT3> diffuseProbesPositions;
+		std::vector<int> diffuseProbesGridIndices;
+		diffuseProbesPositions.reserve(diffuseProbesGridCount);
+		diffuseProbesGridIndices.reserve(diffuseProbesGridCount);
 		for (int probesY = 0; probesY < mDiffuseProbesCountY; probesY++)
 		{
 			for (int probesX = 0; probesX < mDiffuseProbesCountX; probesX++)
@@ -199,13 +226,33 @@ namespace EveryRay_Core
 						minBounds.x + probesX * mDistanceBetweenDiffuseProbes,
 						minBounds.y + probesY * mDistanceBetweenDiffuseProbes,
 						minBounds.z + probesZ * mDistanceBetweenDiffuseProbes);
-					int index = probesY * (mDiffuseProbesCountX * mDiffuseProbesCountZ) + probesX * mDiffuseProbesCountZ + probesZ;
-					mDiffuseProbes[index].SetPosition(pos);
-					mDiffuseProbes[index].SetShaderInfoForConvolution(mConvolutionPS);
-					AddProbeToCells(mDiffuseProbes[index], DIFFUSE_PROBE, minBounds, maxBounds);
+					if (mIsSparse && !IsSparseProbeNeeded(pos, mDistanceBetweenDiffuseProbes))
+						continue;
+
+					AddProbeToCells(static_cast<int>(diffuseProbesPositions.size()), DIFFUSE_PROBE, probesX, probesY, probesZ);
+					diffuseProbesPositions.push_back(pos);
+					diffuseProbesGridIndices.push_back(probesY * (mDiffuseProbesCountX * mDiffuseProbesCountZ) + probesX * mDiffuseProbesCountZ + probesZ);
 				}
 			}
 		}
+		if (diffuseProbesPositions.empty())
+			throw ER_CoreException("ER_LightProbesManager: Sparse diffuse probes grid has no probes (no objects in the probes volume?)");
+
+		mDiffuseProbesCountTotal = static_cast<int>(diffuseProbesPositions.size());
+		mDiffuseProbesLayoutHash = static_cast<UINT32>(ER_Utility::HashFNV1a(diffuseProbesGridIndices.data(), diffuseProbesGridIndices.size() * sizeof(int)));
+		mDiffuseProbes.reserve(mDiffuseProbesCountTotal);
+		for (int i = 0; i < mDiffuseProbesCountTotal; i++)
+		{
+			mDiffuseProbes.emplace_back(core, light, shadowMapper, DIFFUSE_PROBE_SIZE, DIFFUSE_PROBE, i);
+			mDiffuseProbes[i].SetPosition(diffuseProbesPositions[i]);
+			mDiffuseProbes[i].SetShaderInfoForConvolution(mConvolutionPS);
+		}
+
+		{
+			std::string message = "[ER Logger][ER_LightProbesManager] Diffuse probes: " + std::to_string(mDiffuseProbesCountTotal) + " of " + std::to_string(diffuseProbesGridCount) +
+				(mIsSparse ? " grid probes (sparse)\n" : " grid probes\n");
+			ER_OUTPUT_LOG(ER_Utility::ToWideString(message).c_str());
+		}
 
 		// all probes positions GPU buffer
 		XMFLOAT3* diffuseProbesPositionsCPUBuffer = new XMFLOAT3[mDiffuseProbesCountTotal];
@@ -221,10 +268,7 @@ namespace EveryRay_Core
 		{
 			for (int indices = 0; indices < PROBE_COUNT_PER_CELL; indices++)
 			{
-				if (indices >= mDiffuseProbesCells[probeIndex].lightProbeIndices.size())
-					diffuseProbeCellsIndicesCPUBuffer[probeIndex * PROBE_COUNT_PER_CELL + indices] = -1;
-				else
-					diffuseProbeCellsIndicesCPUBuffer[probeIndex * PROBE_COUNT_PER_CELL + indices] = mDiffuseProbesCells[probeIndex].lightProbeIndices[indices];
+				diffuseProbeCellsIndicesCPUBuffer[probeIndex * PROBE_COUNT_PER_CELL + indices] = mDiffuseProbesCells[probeIndex].lightProbeIndices[indices];
 			}
 		}
 		mDiffuseProbesCellsIndicesGPUBuffer = rhi->CreateGPUBuffer("ER_RHI_GPUBuffer: diffuse probes cells indices buffer");
@@ -233,7 +277,7 @@ namespace EveryRay_Core
 		
 		std::string name = "Debug diffuse lightprobes ";
 		scene->objects.emplace_back(name, new ER_RenderingObject(name, scene->objects.size(), core, camera,
-				std::unique_ptr<ER_Model>(new ER_Model(core, ER_Utility::GetFilePath("content\\models\\sphere_lowpoly.fbx"), true)), false, true));
+				ER_Utility::GetFilePath("content\\models\\sphere_lowpoly.fbx"), false, true));
 
 		MaterialShaderEntries shaderEntries;
 		shaderEntries.vertexEntry += "_instancing";
@@ -270,9 +314,8 @@ namespace EveryRay_Core
 		mSpecularProbesCountX = (maxBounds.x - minBounds.x) / mDistanceBetweenSpecularProbes + 1;
 		mSpecularProbesCountY = (maxBounds.y - minBounds.y) / mDistanceBetweenSpecularProbes + 1;
 		mSpecularProbesCountZ = (maxBounds.z - minBounds.z) / mDistanceBetweenSpecularProbes + 1;
-		mSpecularProbesCountTotal = mSpecularProbesCountX * mSpecularProbesCountY * mSpecularProbesCountZ;
-		assert(mSpecularProbesCountTotal);
-		mSpecularProbes.reserve(mSpecularProbesCountTotal);
+		const int specularProbesGridCount = mSpecularProbesCountX * mSpecularProbesCountY * mSpecularProbesCountZ;
+		assert(specularProbesGridCount);
 
 		// cells setup
 		mSpecularProbesCellsCountX = (mSpecularProbesCountX - 1);
@@ -283,9 +326,6 @@ namespace EveryRay_Core
 		assert(mSpecularProbesCellsCountTotal);
 
 		float probeCellPositionOffset = static_cast<float>(mDistanceBetweenSpecularProbes) / 2.0f;
-		mSpecularProbesCellBounds = {
-			XMFLOAT3(-probeCellPositionOffset, -probeCellPositionOffset, -probeCellPositionOffset),
-			XMFLOAT3(probeCellPositionOffset, probeCellPositionOffset, probeCellPositionOffset) };
 		
 		for (int cellsY = 0; cellsY < mSpecularProbesCellsCountY; cellsY++)
 		{
@@ -301,14 +341,16 @@ namespace EveryRay_Core
 					int index = cellsY * (mSpecularProbesCellsCountX * mSpecularProbesCellsCountZ) + cellsX * mSpecularProbesCellsCountZ + cellsZ;
 					mSpecularProbesCells[index].index = index;
 					mSpecularProbesCells[index].position = pos;
+					mSpecularProbesCells[index].lightProbeIndices.assign(PROBE_COUNT_PER_CELL, -1); // -1 - skipped probe (sparse grids)
 				}
 			}
 		}
 
-		// simple 3D grid distribution of probes
-		for (size_t i = 0; i < mSpecularProbesCountTotal; i++)
-			mSpecularProbes.emplace_back(game, light, shadowMapper, SPECULAR_PROBE_SIZE, SPECULAR_PROBE, i);
-
+		// simple 3D grid distribution of probes (sparse grids keep only the probes near the objects)
+		std::vector<XMFLOAT3> specularProbesPositions;
+		std::vector<int> specularProbesGridIndices;
+		specularProbesPositions.reserve(specularProbesGridCount);
+		specularProbesGridIndices.reserve(specularProbesGridCount);
 		for (int probesY = 0; probesY < mSpecularProbesCountY; probesY++)
 		{
 			for (int probesX = 0; probesX < mSpecularProbesCountX; probesX++)
@@ -319,14 +361,33 @@ namespace EveryRay_Core
 						minBounds.x + probesX * mDistanceBetweenSpecularProbes,
 						minBounds.y + probesY * mDistanceBetweenSpecularProbes,
 						minBounds.z + probesZ * mDistanceBetweenSpecularProbes);
-					int index = probesY * (mSpecularProbesCountX * mSpecularProbesCountZ) + probesX * mSpecularProbesCountZ + probesZ;
-					//mSpecularProbes[index]->SetIndex(index);
-					mSpecularProbes[index].SetPosition(pos);
-					mSpecularProbes[index].SetShaderInfoForConvolution(mConvolutionPS);
-					AddProbeToCells(mSpecularProbes[index], SPECULAR_PROBE, minBounds, maxBounds);
+					if (mIsSparse && !IsSparseProbeNeeded(pos, mDistanceBetweenSpecularProbes))
+						continue;
+
+					AddProbeToCells(static_cast<int>(specularProbesPositions.size()), SPECULAR_PROBE, probesX, probesY, probesZ);
+					specularProbesPositions.push_back(pos);
+					specularProbesGridIndices.push_back(probesY * (mSpecularProbesCountX * mSpecularProbesCountZ) + probesX * mSpecularProbesCountZ + probesZ);
 				}
 			}
 		}
+		if (specularProbesPositions.empty())
+			throw ER_CoreException("ER_LightProbesManager: Sparse specular probes grid has no probes (no objects in the probes volume?)");
+
+		mSpecularProbesCountTotal = static_cast<int>(specularProbesPositions.size());
+		mSpecularProbesLayoutHash = static_cast<UINT32>(ER_Utility::HashFNV1a(specularProbesGridIndices.data(), specularProbesGridIndices.size() * sizeof(int)));
+		mSpecularProbes.reserve(mSpecularProbesCountTotal);
+		for (int i = 0; i < mSpecularProbesCountTotal; i++)
+		{
+			mSpecularProbes.emplace_back(game, light, shadowMapper, SPECULAR_PROBE_SIZE, SPECULAR_PROBE, i);
+			mSpecularProbes[i].SetPosition(specularProbesPositions[i]);
+			mSpecularProbes[i].SetShaderInfoForConvolution(mConvolutionPS);
+		}
+
+		{
+			std::string message = "[ER Logger][ER_LightProbesManager] Specular probes: " + std::to_string(mSpecularProbesCountTotal) + " of " + std::to_string(specularProbesGridCount) +
+				(mIsSparse ? " grid probes (sparse)\n" : " grid probes\n");
+			ER_OUTPUT_LOG(ER_Utility::ToWideString(message).c_str());
+		}
 
 		// all probes positions GPU buffer
 		XMFLOAT3* specularProbesPositionsCPUBuffer = new XMFLOAT3[mSpecularProbesCountTotal];
@@ -342,10 +403,7 @@ namespace EveryRay_Core
 		{
 			for (int indices = 0; indices < PROBE_COUNT_PER_CELL; indices++)
 			{
-				if (indices >= mSpecularProbesCells[probeIndex].lightProbeIndices.size())
-					specularProbeCellsIndicesCPUBuffer[probeIndex * PROBE_COUNT_PER_CELL + indices] = -1;
-				else
-					specularProbeCellsIndicesCPUBuffer[probeIndex * PROBE_COUNT_PER_CELL + indices] = mSpecularProbesCells[probeIndex].lightProbeIndices[indices];
+				specularProbeCellsIndicesCPUBuffer[probeIndex * PROBE_COUNT_PER_CELL + indices] = mSpecularProbesCells[probeIndex].lightProbeIndices[indices];
 			}
 		}
 		mSpecularProbesCellsIndicesGPUBuffer = rhi->CreateGPUBuffer("ER_RHI_GPUBuffer: specular probes cells indices buffer");
@@ -358,7 +416,7 @@ namespace EveryRay_Core
 
 		std::string name = "Debug specular lightprobes ";
 		scene->objects.emplace_back(name, new ER_RenderingObject(name, scene->objects.size(), game, camera,
-				std::unique_ptr<ER_Model>(new ER_Model(game, ER_Utility::GetFilePath("content\\models\\sphere_lowpoly.fbx"), true)), false, true));
+				ER_Utility::GetFilePath("content\\models\\sphere_lowpoly.fbx"), false, true));
 		
 		MaterialShaderEntries shaderEntries;
 		shaderEntries.vertexEntry += "_instancing";
@@ -380,33 +438,95 @@ namespace EveryRay_Core
 		mSpecularCubemapArrayRT->CreateGPUTextureResource(rhi, SPECULAR_PROBE_SIZE, SPECULAR_PROBE_SIZE, 1, ER_FORMAT_R8G8B8A8_UNORM, ER_BIND_SHADER_RESOURCE, SPECULAR_PROBE_MIP_COUNT, -1, CUBEMAP_FACES_COUNT, true, mMaxSpecularProbesInVolumeCount);
 	}
 
-	void ER_LightProbesManager::AddProbeToCells(ER_LightProbe& aProbe, ER_ProbeType aType, const XMFLOAT3& minBounds, const XMFLOAT3& maxBounds)
+	// Analytic O(1) assignment: a probe at grid (x, y, z) is a corner of up to 8 cells ([x - 1, x] * [y - 1, y] * [z - 1, z]).
+	// Slots in a cell are in the probes' grid order (Y, X, Z), i.e., slot = (dy << 2) | (dx << 1) | dz, as the shaders interpolate them.
+	void ER_LightProbesManager::AddProbeToCells(int aProbeIndex, ER_ProbeType aType, int aGridX, int aGridY, int aGridZ)
 	{
-		int index = aProbe.GetIndex();
-		if (aType == DIFFUSE_PROBE)
+		std::vector<ER_LightProbeCell>& cells = (aType == DIFFUSE_PROBE) ? mDiffuseProbesCells : mSpecularProbesCells;
+		const int cellsCountX = (aType == DIFFUSE_PROBE) ? mDiffuseProbesCellsCountX : mSpecularProbesCellsCountX;
+		const int cellsCountY = (aType == DIFFUSE_PROBE) ? mDiffuseProbesCellsCountY : mSpecularProbesCellsCountY;
+		const int cellsCountZ = (aType == DIFFUSE_PROBE) ? mDiffuseProbesCellsCountZ : mSpecularProbesCellsCountZ;
+
+		for (int dy = 0; dy < 2; dy++)
 		{
-			// brute force O(cells * probes)
-			for (auto& cell : mDiffuseProbesCells)
+			const int cellY = aGridY - dy;
+			if (cellY < 0 || cellY >= cellsCountY)
+				continue;
+			for (int dx = 0; dx < 2; dx++)
 			{
-				if (IsProbeInCell(aProbe, cell, mDiffuseProbesCellBounds))
-					cell.lightProbeIndices.push_back(index);
+				const int cellX = aGridX - dx;
+				if (cellX < 0 || cellX >= cellsCountX)
+					continue;
+				for (int dz = 0; dz < 2; dz++)
+				{
+					const int cellZ = aGridZ - dz;
+					if (cellZ < 0 || cellZ >= cellsCountZ)
+						continue;
 
-				if (cell.lightProbeIndices.size() > PROBE_COUNT_PER_CELL)
-					throw ER_CoreException("Too many diffuse probes per cell!");
+					const int cellIndex = cellY * (cellsCountX * cellsCountZ) + cellX * cellsCountZ + cellZ;
+					cells[cellIndex].lightProbeIndices[(dy << 2) | (dx << 1) | dz] = aProbeIndex;
+				}
 			}
 		}
-		else
+	}
+
+	// Objects that are rendered into probes (their world AABBs are computed here, as objects are not updated before the probes setup)
+	void ER_LightProbesManager::CollectSparseProbesObjectsAABBs(ER_Scene* scene)
+	{
+		const XMFLOAT3 volumeSize = XMFLOAT3(
+			mSceneProbesMaxBounds.x - mSceneProbesMinBounds.x,
+			mSceneProbesMaxBounds.y - mSceneProbesMinBounds.y,
+			mSceneProbesMaxBounds.z - mSceneProbesMinBounds.z);
+
+		auto addAABB = [&](const ER_AABB& aLocalAABB, const XMMATRIX& aTransform)
 		{
-			// brute force O(cells * probes)
-			for (auto& cell : mSpecularProbesCells)
-			{
-				if (IsProbeInCell(aProbe, cell, mSpecularProbesCellBounds))
-					cell.lightProbeIndices.push_back(index);
+			const ER_AABB aabb = GetWorldAABB(aLocalAABB, aTransform);
+			mSparseObjectsAABBs.push_back(aabb);
+
+			// objects as big as the volume on some axis (terrain-like meshes, level shells, etc.) are not considered solid
+			if (aabb.second.x - aabb.first.x < volumeSize.x && aabb.second.y - aabb.first.y < volumeSize.y && aabb.second.z - aabb.first.z < volumeSize.z)
+				mSparseSolidObjectsAABBs.push_back(aabb);
+		};
 
-				if (cell.lightProbeIndices.size() > PROBE_COUNT_PER_CELL)
-					throw ER_CoreException("Too many specular probes per cell!");
+		for (auto& object : scene->objects)
+		{
+			ER_RenderingObject* renderingObject = object.second;
+			if (!renderingObject || !renderingObject->IsInLightProbe())
+				continue;
+
+			if (renderingObject->IsInstanced())
+			{
+				for (const auto& instance : renderingObject->GetInstancesData())
+					addAABB(renderingObject->GetLocalAABB(), XMLoadFloat4x4(&instance.World));
 			}
+			else
+				addAABB(renderingObject->GetLocalAABB(), renderingObject->GetTransformationMatrix());
+		}
+	}
+
+	// A probe is needed if some object is closer than the distance between probes (i.e., it can be seen in the probe's cells)
+	// and it is not inside a solid object (deeper than the distance between probes, so that probes on the surface are kept)
+	bool ER_LightProbesManager::IsSparseProbeNeeded(const XMFLOAT3& aPos, float aDistanceBetweenProbes)
+	{
+		auto isInside = [&aPos](const ER_AABB& aabb, float aMargin)
+		{
+			return	aPos.x >= aabb.first.x - aMargin && aPos.x <= aabb.second.x + aMargin &&
+					aPos.y >= aabb.first.y - aMargin && aPos.y <= aabb.second.y + aMargin &&
+					aPos.z >= aabb.first.z - aMargin && aPos.z <= aabb.second.z + aMargin;
+		};
+
+		for (const auto& aabb : mSparseSolidObjectsAABBs)
+		{
+			if (isInside(aabb, -aDistanceBetweenProbes))
+				return false;
+		}
+
+		for (const auto& aabb : mSparseObjectsAABBs)
+		{
+			if (isInside(aabb, aDistanceBetweenProbes))
+				return true;
 		}
+		return false;
 	}
 
 	// Fast uniform-grid searching approach (WARNING: can not do multiple indices per pos. (i.e., when pos. is on the edge of several cells))
@@ -479,26 +599,6 @@ namespace EveryRay_Core
 			return XMFLOAT4(mSpecularProbesCellsCountX, mSpecularProbesCellsCountY, mSpecularProbesCellsCountZ, mSpecularProbesCellsCountTotal);
 	}
 
-	bool ER_LightProbesManager::IsProbeInCell(ER_LightProbe& aProbe, ER_LightProbeCell& aCell, ER_AABB& aCellBounds)
-	{
-		XMFLOAT3 pos = aProbe.GetPosition();
-		float epsilon = 0.00001f;
-
-		XMFLOAT3 maxBounds = XMFLOAT3(
-			aCellBounds.second.x + aCell.position.x,
-			aCellBounds.second.y + aCell.position.y,
-			aCellBounds.second.z + aCell.position.z);
-
-		XMFLOAT3 minBounds = XMFLOAT3(
-			aCellBounds.first.x + aCell.position.x,
-			aCellBounds.first.y + aCell.position.y,
-			aCellBounds.first.z + aCell.position.z);
-
-		return	(pos.x <= (maxBounds.x + epsilon) && pos.x >= (minBounds.x - epsilon)) &&
-				(pos.y <= (maxBounds.y + epsilon) && pos.y >= (minBounds.y - epsilon)) &&
-				(pos.z <= (maxBounds.z + epsilon) && pos.z >= (minBounds.z - epsilon));
-	}
-
 	void ER_LightProbesManager::ComputeOrLoadGlobalProbes(ER_Core& game, ProbesRenderingObjectsInfo& aObjects, ER_Skybox* skybox)
 	{
 		assert(skybox);
@@ -540,9 +640,200 @@ namespace EveryRay_Core
 		}
 	}
 
+	// One record per object (per instance for instanced objects) that is rendered into the probes
+	void ER_LightProbesManager::CollectBakeObjects(const ProbesRenderingObjectsInfo& aObjects, std::vector<ER_LightProbesBakeObject>& outObjects)
+	{
+		outObjects.clear();
+
+		auto addObject = [&](UINT64 aNameHash, UINT64 aAppearanceHash, const ER_AABB& aLocalAABB, const XMFLOAT4X4& aTransform)
+		{
+			const ER_AABB aabb = GetWorldAABB(aLocalAABB, XMLoadFloat4x4(&aTransform));
+
+			ER_LightProbesBakeObject object;
+			object.NameHash = aNameHash;
+			object.ContentHash = ER_Utility::HashFNV1a(&aLocalAABB.first, sizeof(XMFLOAT3), aAppearanceHash);
+			object.ContentHash = ER_Utility::HashFNV1a(&aLocalAABB.second, sizeof(XMFLOAT3), object.ContentHash);
+			object.ContentHash = ER_Utility::HashFNV1a(&aTransform, sizeof(XMFLOAT4X4), object.ContentHash);
+			object.MinBounds = aabb.first;
+			object.MaxBounds = aabb.second;
+			outObjects.push_back(object);
+		};
+
+		auto hashStrings = [](const std::vector<std::string>& aStrings, UINT64 aHash)
+		{
+			for (const auto& string : aStrings)
+				aHash = ER_Utility::HashFNV1a(string.c_str(), string.size() + 1, aHash); // with the terminator, so that {"ab", ""} and {"a", "b"} differ
+			return aHash;
+		};
+
+		std::unordered_map<UINT64, UINT32> instancesOccurrences;
+		for (auto& object : aObjects)
+		{
+			ER_RenderingObject* renderingObject = object.second;
+			if (!renderingObject || !renderingObject->IsInLightProbe())
+				continue;
+
+			// what the probes see of the object besides its placement
+			const std::string& modelPath = renderingObject->GetModelPath();
+			UINT64 appearanceHash = ER_Utility::HashFNV1a(modelPath.data(), modelPath.size());
+			for (const auto& material : renderingObject->GetMaterials())
+				appearanceHash = ER_Utility::HashFNV1a(material.first.c_str(), material.first.size() + 1, appearanceHash);
+			appearanceHash = hashStrings(renderingObject->mCustomAlbedoTextures, appearanceHash);
+			appearanceHash = hashStrings(renderingObject->mCustomNormalTextures, appearanceHash);
+			appearanceHash = hashStrings(renderingObject->mCustomRoughnessTextures, appearanceHash);
+			appearanceHash = hashStrings(renderingObject->mCustomMetalnessTextures, appearanceHash);
+			appearanceHash = hashStrings(renderingObject->mCustomHeightTextures, appearanceHash);
+			appearanceHash = hashStrings(renderingObject->mCustomReflectionMaskTextures, appearanceHash);
+
+			const UINT64 nameHash = ER_Utility::HashFNV1a(object.first.data(), object.first.size());
+			if (renderingObject->IsInstanced())
+			{
+				// Instances are identified by their transform, not by their index: inserting or removing one must not mark all the following ones as changed.
+				// A moved instance is then a removed + an added one (same probes to rebake). Instances with equal transforms are told apart by their occurrence.
+				instancesOccurrences.clear();
+				for (const auto& instance : renderingObject->GetInstancesData())
+				{
+					UINT64 instanceHash = ER_Utility::HashFNV1a(&instance.World, sizeof(XMFLOAT4X4), nameHash);
+					const UINT32 occurrence = instancesOccurrences[instanceHash]++;
+					if (occurrence > 0)
+						instanceHash = ER_Utility::HashFNV1a(&occurrence, sizeof(UINT32), instanceHash);
+					addObject(instanceHash, appearanceHash, renderingObject->GetLocalAABB(), instance.World);
+				}
+			}
+			else
+			{
+				XMFLOAT4X4 transform;
+				XMStoreFloat4x4(&transform, renderingObject->GetTransformationMatrix());
+				addObject(nameHash, appearanceHash, renderingObject->GetLocalAABB(), transform);
+			}
+		}
+	}
+
+	// Probes that see a changed, added or removed object: the ones within PROBES_REBAKE_DISTANCE_IN_CELLS of its old or new bounds.
+	// Farther probes are considered unaffected (their contribution of the object is small); returns the number of changed probes.
+	int ER_LightProbesManager::FindChangedProbes(const std::vector<ER_LightProbesBakeObject>& aBakedObjects, const std::vector<ER_LightProbesBakeObject>& aObjects,
+		std::vector<bool>& outChangedDiffuseProbes, std::vector<bool>& outChangedSpecularProbes)
+	{
+		outChangedDiffuseProbes.assign(mDiffuseProbes.size(), false);
+		outChangedSpecularProbes.assign(mSpecularProbes.size(), false);
+
+		std::vector<ER_AABB> changedAABBs;
+		std::unordered_map<UINT64, const ER_LightProbesBakeObject*> bakedObjects;
+		bakedObjects.reserve(aBakedObjects.size());
+		for (const auto& bakedObject : aBakedObjects)
+			bakedObjects[bakedObject.NameHash] = &bakedObject;
+
+		for (const auto& object : aObjects)
+		{
+			auto bakedObject = bakedObjects.find(object.NameHash);
+			if (bakedObject != bakedObjects.end())
+			{
+				if (bakedObject->second->ContentHash != object.ContentHash)
+				{
+					changedAABBs.push_back(ER_AABB(bakedObject->second->MinBounds, bakedObject->second->MaxBounds));
+					changedAABBs.push_back(ER_AABB(object.MinBounds, object.MaxBounds));
+				}
+				bakedObjects.erase(bakedObject);
+			}
+			else
+				changedAABBs.push_back(ER_AABB(object.MinBounds, object.MaxBounds)); // added
+		}
+		for (const auto& bakedObject : bakedObjects)
+			changedAABBs.push_back(ER_AABB(bakedObject.second->MinBounds, bakedObject.second->MaxBounds)); // removed
+
+		if (changedAABBs.empty())
+			return 0;
+
+		auto isChanged = [&changedAABBs](const XMFLOAT3& aPos, float aDistance)
+		{
+			for (const auto& aabb : changedAABBs)
+			{
+				if (aPos.x >= aabb.first.x - aDistance && aPos.x <= aabb.second.x + aDistance &&
+					aPos.y >= aabb.first.y - aDistance && aPos.y <= aabb.second.y + aDistance &&
+					aPos.z >= aabb.first.z - aDistance && aPos.z <= aabb.second.z + aDistance)
+					return true;
+			}
+			return false;
+		};
+
+		int changedProbesCount = 0;
+		for (int i = 0; i < static_cast<int>(mDiffuseProbes.size()); i++)
+		{
+			outChangedDiffuseProbes[i] = isChanged(mDiffuseProbes[i].GetPosition(), mDistanceBetweenDiffuseProbes * PROBES_REBAKE_DISTANCE_IN_CELLS);
+			changedProbesCount += outChangedDiffuseProbes[i] ? 1 : 0;
+		}
+		for (int i = 0; i < static_cast<int>(mSpecularProbes.size()); i++)
+		{
+			outChangedSpecularProbes[i] = isChanged(mSpecularProbes[i].GetPosition(), mDistanceBetweenSpecularProbes * PROBES_REBAKE_DISTANCE_IN_CELLS);
+			changedProbesCount += outChangedSpecularProbes[i] ? 1 : 0;
+		}
+		return changedProbesCount;
+	}
+
+	void ER_LightProbesManager::RebakeChangedLocalProbes()
+	{
+		if (!mAreLocalProbesLoaded)
+			return;
+
+		mDiffuseProbesReady = false;
+		mSpecularProbesReady = false;
+	}
+
 	void ER_LightProbesManager::ComputeOrLoadLocalProbes(ER_Core& game, ProbesRenderingObjectsInfo& aObjects, ER_Skybox* skybox)
 	{
 		ER_RHI* rhi = game.GetRHI();
+		const bool isFullLoad = !mDiffuseProbesReady && !mSpecularProbesReady;
+
+		// incremental rebake: only the probes near the objects that changed since the bake are recomputed
+		const std::wstring dependenciesPath = mLevelPath + ER_LIGHT_PROBES_DEPENDENCIES_FILE_NAME;
+		std::vector<ER_LightProbesBakeObject> bakeObjects;
+		CollectBakeObjects(aObjects, bakeObjects);
+		if (!mHasBakedObjects)
+			mHasBakedObjects = ER_LightProbesBakeDependencies::Read(dependenciesPath, mBakedObjects); // no file - the bake is trusted as is
+
+		std::vector<bool> changedDiffuseProbes(mDiffuseProbes.size(), false);
+		std::vector<bool> changedSpecularProbes(mSpecularProbes.size(), false);
+		int changedProbesCount = mHasBakedObjects ? FindChangedProbes(mBakedObjects, bakeObjects, changedDiffuseProbes, changedSpecularProbes) : 0;
+		bool isBakeOutdated = false;
+		if (changedProbesCount > 0 && rhi->GetAPI() != ER_GRAPHICS_API::DX11)
+		{
+			std::string message = "[ER Logger][ER_LightProbesManager] " + std::to_string(changedProbesCount) + " local probes are outdated, but computing the probes is only possible on DX11 at the moment. Using the old bake...\n";
+			ER_OUTPUT_LOG(ER_Utility::ToWideString(message).c_str());
+			changedDiffuseProbes.assign(mDiffuseProbes.size(), false);
+			changedSpecularProbes.assign(mSpecularProbes.size(), false);
+			changedProbesCount = 0;
+			isBakeOutdated = true;
+		}
+		else if (changedProbesCount > 0)
+		{
+			std::string message = "[ER Logger][ER_LightProbesManager] Objects changed since the bake, rebaking " +
+				std::to_string(std::count(changedDiffuseProbes.begin(), changedDiffuseProbes.end(), true)) + " of " + std::to_string(mDiffuseProbesCountTotal) + " diffuse and " +
+				std::to_string(std::count(changedSpecularProbes.begin(), changedSpecularProbes.end(), true)) + " of " + std::to_string(mSpecularProbesCountTotal) + " specular probes\n";
+			ER_OUTPUT_LOG(ER_Utility::ToWideString(message).c_str());
+		}
+
+		if (isFullLoad && changedProbesCount == 0)
+		{
+			// rebake request without changes: the loaded probes are still valid
+			if (mAreLocalProbesLoaded)
+			{
+				mDiffuseProbesReady = true;
+				mSpecularProbesReady = true;
+				return;
+			}
+
+			// fast path: the whole bake from one memory-mapped archive
+			if (LoadLocalProbesFromArchive(game))
+			{
+				mAreLocalProbesLoaded = true;
+				if (!mHasBakedObjects && !isBakeOutdated)
+				{
+					mHasBakedObjects = ER_LightProbesBakeDependencies::Write(dependenciesPath, bakeObjects);
+					mBakedObjects = bakeObjects;
+				}
+				return;
+			}
+		}
 
 		int numThreads = std::thread::hardware_concurrency();
 		if (game.GetRHI()->GetAPI() != ER_GRAPHICS_API::DX11)
@@ -553,6 +844,11 @@ namespace EveryRay_Core
 		if (!mDiffuseProbesReady)
 		{
 			std::wstring diffuseProbesPath = mLevelPath + L"diffuse_probes\\";
+			for (int i = 0; i < static_cast<int>(mDiffuseProbes.size()); i++)
+			{
+				if (changedDiffuseProbes[i])
+					mDiffuseProbes[i].Invalidate();
+			}
 			
 			std::vector<std::thread> threads;
 			threads.reserve(numThreads);
@@ -565,7 +861,10 @@ namespace EveryRay_Core
 				{ 
 					int endRange = (i < numThreads - 1) ? (i + 1) * probesPerThread : mDiffuseProbes.size();
 					for (int j = i * probesPerThread; j < endRange; j++)
-						mDiffuseProbes[j].LoadProbeFromDisk(game, diffuseProbesPath);
+					{
+						if (!mDiffuseProbes[j].IsLoadedFromDisk() && !changedDiffuseProbes[j])
+							mDiffuseProbes[j].LoadProbeFromDisk(game, diffuseProbesPath);
+					}
 				}));
 			}
 			for (auto& t : threads) t.join();
@@ -597,15 +896,18 @@ namespace EveryRay_Core
 				for (int i = 0; i < SPHERICAL_HARMONICS_COEF_COUNT; i++)
 					shCPUBuffer[probeIndex * SPHERICAL_HARMONICS_COEF_COUNT + i] = sh[i];
 			}
-			mDiffuseProbesSphericalHarmonicsGPUBuffer = rhi->CreateGPUBuffer("ER_RHI_GPUBuffer: diffuse probes SH buffer");
-			mDiffuseProbesSphericalHarmonicsGPUBuffer->CreateGPUBufferResource(rhi, shCPUBuffer, mDiffuseProbesCountTotal* SPHERICAL_HARMONICS_COEF_COUNT, sizeof(XMFLOAT3),
-				false, ER_BIND_SHADER_RESOURCE, 0, ER_RESOURCE_MISC_BUFFER_STRUCTURED);
+			CreateDiffuseProbesSphericalHarmonicsBuffer(rhi, shCPUBuffer);
 			DeleteObjects(shCPUBuffer);
 		}
 
 		if (!mSpecularProbesReady)
 		{
 			std::wstring specularProbesPath = mLevelPath + L"specular_probes\\";
+			for (int i = 0; i < static_cast<int>(mSpecularProbes.size()); i++)
+			{
+				if (changedSpecularProbes[i])
+					mSpecularProbes[i].Invalidate();
+			}
 
 			std::vector<std::thread> threads;
 			int numThreads = std::thread::hardware_concurrency();
@@ -622,7 +924,10 @@ namespace EveryRay_Core
 				{
 					int endRange = (i < numThreads - 1) ? (i + 1) * probesPerThread : mSpecularProbes.size();
 					for (int j = i * probesPerThread; j < endRange; j++)
-						mSpecularProbes[j].LoadProbeFromDisk(game, specularProbesPath);
+					{
+						if (!mSpecularProbes[j].IsLoadedFromDisk() && !changedSpecularProbes[j])
+							mSpecularProbes[j].LoadProbeFromDisk(game, specularProbesPath);
+					}
 				}));
 			}
 			for (auto& t : threads) t.join();
@@ -644,6 +949,151 @@ namespace EveryRay_Core
 			}
 			mSpecularProbesReady = true;
 		}
+
+		// next loads will use the archive (probes' files are kept as the bake's output and the fallback)
+		if (isFullLoad)
+			SaveLocalProbesToArchive(game);
+		mAreLocalProbesLoaded = true;
+
+		if (!isBakeOutdated)
+		{
+			if (!ER_LightProbesBakeDependencies::Write(dependenciesPath, bakeObjects))
+			{
+				std::wstring message = L"[ER Logger][ER_LightProbesManager] Could not save light probes bake dependencies: " + dependenciesPath + L"\n";
+				ER_OUTPUT_LOG(message.c_str());
+			}
+			mBakedObjects = bakeObjects;
+			mHasBakedObjects = true;
+		}
+	}
+
+	void ER_LightProbesManager::CreateDiffuseProbesSphericalHarmonicsBuffer(ER_RHI* rhi, const XMFLOAT3* aCoefficients)
+	{
+		DeleteObject(mDiffuseProbesSphericalHarmonicsGPUBuffer);
+		mDiffuseProbesSphericalHarmonicsGPUBuffer = rhi->CreateGPUBuffer("ER_RHI_GPUBuffer: diffuse probes SH buffer");
+		mDiffuseProbesSphericalHarmonicsGPUBuffer->CreateGPUBufferResource(rhi, const_cast<XMFLOAT3*>(aCoefficients), mDiffuseProbesCountTotal * SPHERICAL_HARMONICS_COEF_COUNT, sizeof(XMFLOAT3),
+			false, ER_BIND_SHADER_RESOURCE, 0, ER_RESOURCE_MISC_BUFFER_STRUCTURED);
+	}
+
+	ER_LightProbesArchiveHeader ER_LightProbesManager::GetProbesArchiveHeader()
+	{
+		ER_LightProbesArchiveHeader header;
+		header.DiffuseGrid.MinBounds = mSceneProbesMinBounds;
+		header.DiffuseGrid.MaxBounds = mSceneProbesMaxBounds;
+		header.DiffuseGrid.Spacing = mDistanceBetweenDiffuseProbes;
+		header.DiffuseGrid.CountX = mDiffuseProbesCountX;
+		header.DiffuseGrid.CountY = mDiffuseProbesCountY;
+		header.DiffuseGrid.CountZ = mDiffuseProbesCountZ;
+		header.DiffuseGrid.ProbesCount = mDiffuseProbesCountTotal;
+		header.DiffuseGrid.ProbesLayoutHash = mDiffuseProbesLayoutHash;
+		header.SpecularGrid.MinBounds = mSceneProbesMinBounds;
+		header.SpecularGrid.MaxBounds = mSceneProbesMaxBounds;
+		header.SpecularGrid.Spacing = mDistanceBetweenSpecularProbes;
+		header.SpecularGrid.CountX = mSpecularProbesCountX;
+		header.SpecularGrid.CountY = mSpecularProbesCountY;
+		header.SpecularGrid.CountZ = mSpecularProbesCountZ;
+		header.SpecularGrid.ProbesCount = mSpecularProbesCountTotal;
+		header.SpecularGrid.ProbesLayoutHash = mSpecularProbesLayoutHash;
+		header.SphericalHarmonicsCoefficientsCount = SPHERICAL_HARMONICS_COEF_COUNT;
+		header.SpecularProbeSize = SPECULAR_PROBE_SIZE;
+		return header;
+	}
+
+	// One memory-mapped read: the SH block goes straight to the GPU buffer, specular cubemaps are created from the payloads in parallel
+	bool ER_LightProbesManager::LoadLocalProbesFromArchive(ER_Core& game)
+	{
+		ER_RHI* rhi = game.GetRHI();
+		const std::wstring archivePath = mLevelPath + ER_LIGHT_PROBES_ARCHIVE_FILE_NAME;
+
+		ER_LightProbesArchive archive;
+		if (!archive.Open(archivePath))
+		{
+			std::wstring message = L"[ER Logger][ER_LightProbesManager] Could not open light probes archive: " + archivePath + L". Loading probes one by one... \n";
+			ER_OUTPUT_LOG(message.c_str());
+			return false;
+		}
+
+		const ER_LightProbesArchiveHeader& header = archive.GetHeader();
+		const ER_LightProbesArchiveHeader expectedHeader = GetProbesArchiveHeader();
+		if (!header.DiffuseGrid.IsMatching(expectedHeader.DiffuseGrid) || !header.SpecularGrid.IsMatching(expectedHeader.SpecularGrid) ||
+			header.SphericalHarmonicsCoefficientsCount != expectedHeader.SphericalHarmonicsCoefficientsCount || header.SpecularProbeSize != expectedHeader.SpecularProbeSize ||
+			header.DiffuseGrid.GetCount() != mDiffuseProbes.size() || header.SpecularGrid.GetCount() != mSpecularProbes.size())
+		{
+			std::wstring message = L"[ER Logger][ER_LightProbesManager] Light probes archive does not match the scene's probes grid: " + archivePath + L". Loading probes one by one... \n";
+			ER_OUTPUT_LOG(message.c_str());
+			return false;
+		}
+
+		// DX11 device is free-threaded (cubemaps are created without the immediate context); other APIs record uploads on one command list
+		std::atomic<int> failedSpecularProbes { 0 };
+		auto loadSpecularProbes = [&](UINT begin, UINT end)
+		{
+			for (UINT i = begin; i < end; i++)
+			{
+				const UINT8* payload = nullptr;
+				UINT64 payloadSize = 0;
+				if (!archive.GetSpecularPayload(i, payload, payloadSize) || !mSpecularProbes[i].LoadProbeFromMemory(game, payload, payloadSize))
+					failedSpecularProbes++;
+			}
+		};
+		ER_JobSystem* jobSystem = (ER_JobSystem*)game.GetServices().FindService(ER_JobSystem::TypeIdClass());
+		if (jobSystem && rhi->GetAPI() == ER_GRAPHICS_API::DX11)
+			jobSystem->ParallelFor(static_cast<UINT>(mSpecularProbes.size()), 4, loadSpecularProbes);
+		else
+			loadSpecularProbes(0, static_cast<UINT>(mSpecularProbes.size()));
+
+		// probes loaded above keep their cubemaps and are skipped by the per-file path (IsLoadedFromDisk()), failed ones are loaded or rebaked
+		// into the same textures (the RHI releases the previous resources of a texture before loading into it), so nothing is created twice
+		if (failedSpecularProbes > 0)
+		{
+			std::wstring message = L"[ER Logger][ER_LightProbesManager] Corrupt specular probes in the light probes archive: " + archivePath + L". Loading probes one by one... \n";
+			ER_OUTPUT_LOG(message.c_str());
+			return false;
+		}
+
+		const XMFLOAT3* sphericalHarmonics = archive.GetSphericalHarmonics();
+		for (int probeIndex = 0; probeIndex < mDiffuseProbesCountTotal; probeIndex++)
+			mDiffuseProbes[probeIndex].SetSphericalHarmonics(sphericalHarmonics + probeIndex * SPHERICAL_HARMONICS_COEF_COUNT);
+
+		mDiffuseProbesReady = true;
+		UpdateProbesByType(game, DIFFUSE_PROBE);
+		CreateDiffuseProbesSphericalHarmonicsBuffer(rhi, sphericalHarmonics);
+
+		mSpecularProbesReady = true;
+
+		std::string message = "[ER Logger][ER_LightProbesManager] Loaded " + std::to_string(mDiffuseProbes.size()) + " diffuse and " + std::to_string(mSpecularProbes.size()) +
+			" specular probes from the light probes archive.\n";
+		ER_OUTPUT_LOG(ER_Utility::ToWideString(message).c_str());
+		return true;
+	}
+
+	void ER_LightProbesManager::SaveLocalProbesToArchive(ER_Core& game)
+	{
+		const std::wstring archivePath = mLevelPath + ER_LIGHT_PROBES_ARCHIVE_FILE_NAME;
+
+		std::vector<XMFLOAT3> sphericalHarmonics(mDiffuseProbesCountTotal * SPHERICAL_HARMONICS_COEF_COUNT);
+		for (int probeIndex = 0; probeIndex < mDiffuseProbesCountTotal; probeIndex++)
+		{
+			const std::vector<XMFLOAT3>& sh = mDiffuseProbes[probeIndex].GetSphericalHarmonics();
+			for (int i = 0; i < SPHERICAL_HARMONICS_COEF_COUNT; i++)
+				sphericalHarmonics[probeIndex * SPHERICAL_HARMONICS_COEF_COUNT + i] = sh[i];
+		}
+
+		std::vector<std::wstring> specularProbesPaths;
+		specularProbesPaths.reserve(mSpecularProbes.size());
+		for (auto& probe : mSpecularProbes)
+			specularProbesPaths.push_back(probe.GetConstructedProbeName(mLevelPath + L"specular_probes\\"));
+
+		if (ER_LightProbesArchive::Write(archivePath, GetProbesArchiveHeader(), sphericalHarmonics.data(), specularProbesPaths))
+		{
+			std::wstring message = L"[ER Logger][ER_LightProbesManager] Saved light probes archive: " + archivePath + L"\n";
+			ER_OUTPUT_LOG(message.c_str());
+		}
+		else
+		{
+			std::wstring message = L"[ER Logger][ER_LightProbesManager] Could not save light probes archive: " + archivePath + L"\n";
+			ER_OUTPUT_LOG(message.c_str());
+		}
 	}
 
 	void ER_LightProbesManager::DrawDebugProbes(ER_RHI* rhi, ER_RHI_GPUTexture* aRenderTarget, ER_RHI_GPUTexture* aDepth, ER_ProbeType aType, ER_RHI_GPURootSignature* rs)
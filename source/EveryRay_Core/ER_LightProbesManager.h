@@ -12,9 +12,12 @@
 #define SPHERICAL_HARMONICS_ORDER 2
 #define SPHERICAL_HARMONICS_COEF_COUNT (SPHERICAL_HARMONICS_ORDER + 1) * (SPHERICAL_HARMONICS_ORDER + 1)
 
+#define PROBES_REBAKE_DISTANCE_IN_CELLS 2.0f // probes closer than that (in distances between probes) to a changed object get rebaked
+
 #include "Common.h"
 #include "ER_RenderingObject.h"
 #include "ER_LightProbe.h"
+#include "ER_LightProbesArchive.h"
 #include "RHI/ER_RHI.h"
 
 namespace EveryRay_Core
@@ -53,6 +56,8 @@ namespace EveryRay_Core
 		void SetLevelPath(const std::wstring& aPath) { mLevelPath = aPath; };
 		void ComputeOrLoadLocalProbes(ER_Core& game, ProbesRenderingObjectsInfo& aObjects, ER_Skybox* skybox = nullptr);
 		void ComputeOrLoadGlobalProbes(ER_Core& game, ProbesRenderingObjectsInfo& aObjects, ER_Skybox* skybox);
+		// Local probes near the objects that changed since the bake (i.e., moved in the editor) are rebaked in the next ComputeOrLoadLocalProbes() (DX11 only)
+		void RebakeChangedLocalProbes();
 		void DrawDebugProbes(ER_RHI* rhi, ER_RHI_GPUTexture* aRenderTarget, ER_RHI_GPUTexture* aDepth, ER_ProbeType aType, ER_RHI_GPURootSignature* rs);
 		void UpdateProbes(ER_Core& game);
 		int GetCellIndex(const XMFLOAT3& pos, ER_ProbeType aType);
@@ -87,9 +92,17 @@ namespace EveryRay_Core
 		void SetupGlobalSpecularProbe(ER_Core& game, ER_Camera& camera, ER_Scene* scene, ER_DirectionalLight* light, ER_ShadowMapper* shadowMapper);
 		void SetupDiffuseProbes(ER_Core& game, ER_Camera& camera, ER_Scene* scene, ER_DirectionalLight* light, ER_ShadowMapper* shadowMapper);
 		void SetupSpecularProbes(ER_Core& game, ER_Camera& camera, ER_Scene* scene, ER_DirectionalLight* light, ER_ShadowMapper* shadowMapper);
-		void AddProbeToCells(ER_LightProbe& aProbe, ER_ProbeType aType, const XMFLOAT3& minBounds, const XMFLOAT3& maxBounds);
-		bool IsProbeInCell(ER_LightProbe& aProbe, ER_LightProbeCell& aCell, ER_AABB& aCellBounds);
+		void AddProbeToCells(int aProbeIndex, ER_ProbeType aType, int aGridX, int aGridY, int aGridZ);
+		void CollectSparseProbesObjectsAABBs(ER_Scene* scene);
+		bool IsSparseProbeNeeded(const XMFLOAT3& aPos, float aDistanceBetweenProbes);
+		void CollectBakeObjects(const ProbesRenderingObjectsInfo& aObjects, std::vector<ER_LightProbesBakeObject>& outObjects);
+		int FindChangedProbes(const std::vector<ER_LightProbesBakeObject>& aBakedObjects, const std::vector<ER_LightProbesBakeObject>& aObjects,
+			std::vector<bool>& outChangedDiffuseProbes, std::vector<bool>& outChangedSpecularProbes);
 		void UpdateProbesByType(ER_Core& game, ER_ProbeType aType);
+		void CreateDiffuseProbesSphericalHarmonicsBuffer(ER_RHI* rhi, const XMFLOAT3* aCoefficients);
+		ER_LightProbesArchiveHeader GetProbesArchiveHeader();
+		bool LoadLocalProbesFromArchive(ER_Core& game);
+		void SaveLocalProbesToArchive(ER_Core& game);
 		
 		ER_QuadRenderer* mQuadRenderer = nullptr;
 		ER_Camera& mMainCamera;
@@ -101,6 +114,12 @@ namespace EveryRay_Core
 		XMFLOAT3 mSceneProbesMinBounds;
 		XMFLOAT3 mSceneProbesMaxBounds;
 
+		// Sparse grids: probes in empty space (no object nearby) and inside solid objects are skipped,
+		// probes are stored compactly and cells have -1 in place of the skipped probes
+		bool mIsSparse = false;
+		std::vector<ER_AABB> mSparseObjectsAABBs; // world space AABBs of the objects that are rendered into probes
+		std::vector<ER_AABB> mSparseSolidObjectsAABBs; // ...of them, the ones that are smaller than the probes volume
+
 		// Diffuse probes members
 		std::vector<ER_LightProbe> mDiffuseProbes;
 		ER_RenderingObject* mDiffuseProbeRenderingObject = nullptr;
@@ -112,8 +131,7 @@ namespace EveryRay_Core
 		ER_RHI_GPUTexture* mTempDiffuseCubemapFacesConvolutedRT = nullptr;
 		ER_RHI_GPUTexture* mTempDiffuseCubemapDepthBuffers[CUBEMAP_FACES_COUNT] = { nullptr };
 		std::vector<ER_LightProbeCell> mDiffuseProbesCells;
-		ER_AABB mDiffuseProbesCellBounds;
-		int mDiffuseProbesCountTotal = 0;
+		int mDiffuseProbesCountTotal = 0; // # of probes (less than X * Y * Z in sparse grids)
 		int mDiffuseProbesCountX = 0;
 		int mDiffuseProbesCountY = 0;
 		int mDiffuseProbesCountZ = 0;
@@ -121,6 +139,7 @@ namespace EveryRay_Core
 		int mDiffuseProbesCellsCountY = 0;
 		int mDiffuseProbesCellsCountZ = 0;
 		int mDiffuseProbesCellsCountTotal = 0;
+		UINT32 mDiffuseProbesLayoutHash = 0;
 		bool mDiffuseProbesReady = false;
 		ER_LightProbe* mGlobalDiffuseProbe = nullptr;
 		bool mGlobalDiffuseProbeReady = false;
@@ -139,9 +158,8 @@ namespace EveryRay_Core
 		ER_RHI_GPUTexture* mTempSpecularCubemapDepthBuffers[CUBEMAP_FACES_COUNT] = { nullptr };
 		ER_RHI_GPUTexture* mSpecularCubemapArrayRT = nullptr;
 		std::vector<ER_LightProbeCell> mSpecularProbesCells;
-		ER_AABB mSpecularProbesCellBounds;
 		std::vector<int> mNonCulledSpecularProbesIndices;
-		int mSpecularProbesCountTotal = 0;
+		int mSpecularProbesCountTotal = 0; // # of probes (less than X * Y * Z in sparse grids)
 		int mSpecularProbesCountX = 0;
 		int mSpecularProbesCountY = 0;
 		int mSpecularProbesCountZ = 0;
@@ -149,6 +167,7 @@ namespace EveryRay_Core
 		int mSpecularProbesCellsCountY = 0;
 		int mSpecularProbesCellsCountZ = 0;
 		int mSpecularProbesCellsCountTotal = 0;
+		UINT32 mSpecularProbesLayoutHash = 0;
 		int mNonCulledSpecularProbesCount = 0;
 		bool mSpecularProbesReady = false;
 		ER_LightProbe* mGlobalSpecularProbe = nullptr;
@@ -157,6 +176,11 @@ namespace EveryRay_Core
 		float mSpecularProbesVolumeSize = 0.0f;
 		int mMaxSpecularProbesInVolumeCount = 0;
 
+		// Incremental rebakes: objects that the loaded bake was made with (see ER_LightProbesBakeDependencies)
+		std::vector<ER_LightProbesBakeObject> mBakedObjects;
+		bool mHasBakedObjects = false;
+		bool mAreLocalProbesLoaded = false;
+
 		std::wstring mLevelPath;
 		bool mEnabled = true;
 	};
@@ -0,0 +1,63 @@
+#include "stdafx.h"
+
+#include "ER_MappedFile.h"
+
+namespace EveryRay_Core
+{
+	ER_MappedFile::ER_MappedFile()
+	{
+	}
+
+	ER_MappedFile::~ER_MappedFile()
+	{
+		Close();
+	}
+
+	bool ER_MappedFile::Open(const std::wstring& path)
+	{
+		Close();
+
+		mFile = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (mFile == INVALID_HANDLE_VALUE)
+			return false;
+
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(mFile, &fileSize) || fileSize.QuadPart == 0)
+		{
+			Close();
+			return false;
+		}
+		mSize = static_cast<UINT64>(fileSize.QuadPart);
+
+		mMapping = CreateFileMappingW(mFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!mMapping)
+		{
+			Close();
+			return false;
+		}
+
+		mData = static_cast<const UINT8*>(MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0));
+		if (!mData)
+		{
+			Close();
+			return false;
+		}
+
+		return true;
+	}
+
+	void ER_MappedFile::Close()
+	{
+		if (mData)
+			UnmapViewOfFile(mData);
+		if (mMapping)
+			CloseHandle(mMapping);
+		if (mFile != INVALID_HANDLE_VALUE)
+			CloseHandle(mFile);
+
+		mData = nullptr;
+		mMapping = nullptr;
+		mFile = INVALID_HANDLE_VALUE;
+		mSize = 0;
+	}
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include "Common.h"
+
+namespace EveryRay_Core
+{
+	// Read-only memory-mapped file (used for cooked/binary assets, so that we can read them without extra copies)
+	class ER_MappedFile
+	{
+	public:
+		ER_MappedFile();
+		~ER_MappedFile();
+
+		bool Open(const std::wstring& path);
+		void Close();
+
+		bool IsOpen() const { return mData != nullptr; }
+		const UINT8* GetData() const { return mData; }
+		UINT64 GetSize() const { return mSize; }
+	private:
+		ER_MappedFile(const ER_MappedFile& rhs);
+		ER_MappedFile& operator=(const ER_MappedFile& rhs);
+
+		HANDLE mFile = INVALID_HANDLE_VALUE;
+		HANDLE mMapping = nullptr;
+		const UINT8* mData = nullptr;
+		UINT64 mSize = 0;
+	};
+}
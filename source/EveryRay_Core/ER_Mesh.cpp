@@ -6,6 +6,7 @@
 #include "ER_Core.h"
 #include "ER_CoreException.h"
 #include "ER_VertexDeclarations.h"
+#include "ER_MeshCache.h"
 
 #include "assimp\scene.h"
 
@@ -86,6 +87,54 @@ namespace EveryRay_Core
 		}
 	}
 
+	// Mesh from the ER_MeshCache (already triangulated and flipped): de-interleaves cached vertices into the same streams as above
+	ER_Mesh::ER_Mesh(ER_Model& model, ER_ModelMaterial& material, const ER_MeshCacheMeshView& mesh) : mModel(model), mMaterial(material), mName(mesh.Name), mVertices(), mNormals(), mTangents(), mBiNormals(), mTextureCoordinates(), mVertexColors(), mFaceCount(mesh.FaceCount), mIndices()
+	{
+		const bool hasNormals = (mesh.Attributes & ER_MESH_CACHE_NORMALS) != 0;
+		const bool hasTangents = (mesh.Attributes & ER_MESH_CACHE_TANGENTS) != 0;
+
+		mVertices.resize(mesh.VertexCount);
+		if (hasNormals)
+			mNormals.resize(mesh.VertexCount);
+		if (hasTangents)
+		{
+			mTangents.resize(mesh.VertexCount);
+			mBiNormals.resize(mesh.VertexCount);
+		}
+		mTextureCoordinates.resize(mesh.UVChannelCount);
+		if (mesh.UVChannelCount > 0)
+			mTextureCoordinates[0].resize(mesh.VertexCount);
+
+		for (UINT i = 0; i < mesh.VertexCount; i++)
+		{
+			const ER_MeshCacheVertex& vertex = mesh.Vertices[i];
+			mVertices[i] = vertex.Position;
+			if (hasNormals)
+				mNormals[i] = vertex.Normal;
+			if (hasTangents)
+			{
+				mTangents[i] = vertex.Tangent;
+				mBiNormals[i] = vertex.BiNormal;
+			}
+			if (mesh.UVChannelCount > 0)
+				mTextureCoordinates[0][i] = vertex.UV;
+		}
+
+		for (UINT channel = 1; channel < mesh.UVChannelCount; channel++)
+		{
+			const XMFLOAT3* channelUVs = mesh.ExtraUVs + static_cast<size_t>(channel - 1) * mesh.VertexCount;
+			mTextureCoordinates[channel].assign(channelUVs, channelUVs + mesh.VertexCount);
+		}
+
+		for (UINT channel = 0; channel < mesh.ColorChannelCount; channel++)
+		{
+			const XMFLOAT4* channelColors = mesh.Colors + static_cast<size_t>(channel) * mesh.VertexCount;
+			mVertexColors.push_back(std::vector<XMFLOAT4>(channelColors, channelColors + mesh.VertexCount));
+		}
+
+		mIndices.assign(mesh.Indices, mesh.Indices + mesh.IndexCount);
+	}
+
 	/*ER_Mesh::ER_Mesh(Model & model, ER_ModelMaterial * material)
 	{
 	}*/
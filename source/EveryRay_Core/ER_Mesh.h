@@ -9,11 +9,13 @@ namespace EveryRay_Core
 {
 	class ER_Model;
 	class ER_ModelMaterial;
+	struct ER_MeshCacheMeshView;
 
 	class ER_Mesh
 	{
 	public:
 		ER_Mesh(ER_Model& model, ER_ModelMaterial& material, aiMesh& mesh);
+		ER_Mesh(ER_Model& model, ER_ModelMaterial& material, const ER_MeshCacheMeshView& mesh);
 		~ER_Mesh();
 
 		ER_Model& GetModel();
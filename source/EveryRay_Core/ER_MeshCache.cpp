@@ -0,0 +1,349 @@
+#include "stdafx.h"
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+
+#include "ER_MeshCache.h"
+#include "ER_Model.h"
+#include "ER_Mesh.h"
+#include "ER_ModelMaterial.h"
+#include "ER_Utility.h"
+
+namespace EveryRay_Core
+{
+	namespace
+	{
+		// Bounds-checked cursor over the memory-mapped cache file
+		class CacheReader
+		{
+		public:
+			CacheReader(const UINT8* data, UINT64 size) : mData(data), mSize(size) {}
+
+			template<typename T>
+			const T* ReadArray(UINT64 count)
+			{
+				const UINT64 bytes = sizeof(T) * count;
+				if (!mIsValid || mOffset + bytes > mSize)
+				{
+					mIsValid = false;
+					return nullptr;
+				}
+				const T* result = reinterpret_cast<const T*>(mData + mOffset);
+				mOffset += ER_BitmaskAlign(static_cast<UINT>(bytes), 4);
+				return result;
+			}
+
+			template<typename T>
+			bool Read(T& value)
+			{
+				const T* result = ReadArray<T>(1);
+				if (result)
+					value = *result;
+				return result != nullptr;
+			}
+
+			bool ReadString(std::string& value)
+			{
+				UINT32 length = 0;
+				if (!Read(length))
+					return false;
+				const char* chars = ReadArray<char>(length);
+				if (!chars)
+					return false;
+				value.assign(chars, length);
+				return true;
+			}
+
+			bool IsValid() const { return mIsValid; }
+		private:
+			const UINT8* mData;
+			UINT64 mSize;
+			UINT64 mOffset = 0;
+			bool mIsValid = true;
+		};
+
+		class CacheWriter
+		{
+		public:
+			CacheWriter(std::ofstream& file) : mFile(file) {}
+
+			void WriteArray(const void* data, UINT64 bytes)
+			{
+				static const char padding[4] = {};
+				if (bytes > 0)
+					mFile.write(static_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+				mFile.write(padding, static_cast<std::streamsize>(ER_BitmaskAlign(static_cast<UINT>(bytes), 4) - bytes));
+			}
+
+			template<typename T>
+			void Write(const T& value) { WriteArray(&value, sizeof(T)); }
+
+			void WriteString(const std::string& value)
+			{
+				Write(static_cast<UINT32>(value.size()));
+				WriteArray(value.data(), value.size());
+			}
+		private:
+			std::ofstream& mFile;
+		};
+
+		// "mtllib" statements of an .obj file (Assimp reads the rest of the line as one file name, relative to the model's directory)
+		void GetOBJMaterialLibraries(const UINT8* data, UINT64 size, std::vector<std::string>& outNames)
+		{
+			const char* text = reinterpret_cast<const char*>(data);
+			UINT64 lineStart = 0;
+			while (lineStart < size)
+			{
+				UINT64 lineEnd = lineStart;
+				while (lineEnd < size && text[lineEnd] != '\n' && text[lineEnd] != '\r')
+					lineEnd++;
+
+				UINT64 i = lineStart;
+				while (i < lineEnd && (text[i] == ' ' || text[i] == '\t'))
+					i++;
+				if (lineEnd - i > 7 && strncmp(text + i, "mtllib", 6) == 0 && (text[i + 6] == ' ' || text[i + 6] == '\t'))
+				{
+					UINT64 nameStart = i + 7;
+					UINT64 nameEnd = lineEnd;
+					while (nameStart < nameEnd && (text[nameStart] == ' ' || text[nameStart] == '\t'))
+						nameStart++;
+					while (nameEnd > nameStart && (text[nameEnd - 1] == ' ' || text[nameEnd - 1] == '\t'))
+						nameEnd--;
+					if (nameEnd > nameStart)
+						outNames.push_back(std::string(text + nameStart, static_cast<size_t>(nameEnd - nameStart)));
+				}
+				lineStart = lineEnd + 1;
+			}
+		}
+	}
+
+	ER_MeshCache::ER_MeshCache()
+	{
+	}
+
+	ER_MeshCache::~ER_MeshCache()
+	{
+		Close();
+	}
+
+	UINT64 ER_MeshCache::ComputeSourceHash(const std::string& modelPath, UINT importFlags)
+	{
+		ER_MappedFile sourceFile;
+		if (!sourceFile.Open(ER_Utility::ToWideString(modelPath)))
+			return 0;
+
+		const UINT32 version = ER_MESH_CACHE_VERSION;
+		UINT64 hash = ER_Utility::HashFNV1a(sourceFile.GetData(), static_cast<size_t>(sourceFile.GetSize()));
+		hash = ER_Utility::HashFNV1a(&importFlags, sizeof(importFlags), hash);
+		hash = ER_Utility::HashFNV1a(&version, sizeof(version), hash);
+
+		// materials (texture paths) of .obj models come from external .mtl files, so their content is a part of the key too
+		// (a missing library is hashed by its name, so that adding it later invalidates the cache file)
+		const size_t extensionPos = modelPath.find_last_of('.');
+		std::string extension = (extensionPos == std::string::npos) ? "" : modelPath.substr(extensionPos + 1);
+		std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+		if (extension == "obj")
+		{
+			std::vector<std::string> materialLibraries;
+			GetOBJMaterialLibraries(sourceFile.GetData(), sourceFile.GetSize(), materialLibraries);
+
+			const size_t directoryPos = modelPath.find_last_of("\\/");
+			const std::string directory = (directoryPos == std::string::npos) ? "" : modelPath.substr(0, directoryPos + 1);
+			for (const std::string& library : materialLibraries)
+			{
+				hash = ER_Utility::HashFNV1a(library.data(), library.size(), hash);
+
+				ER_MappedFile libraryFile;
+				if (libraryFile.Open(ER_Utility::ToWideString(directory + library)))
+					hash = ER_Utility::HashFNV1a(libraryFile.GetData(), static_cast<size_t>(libraryFile.GetSize()), hash);
+			}
+		}
+		return hash;
+	}
+
+	std::string ER_MeshCache::GetCachePath(UINT64 sourceHash)
+	{
+		std::stringstream fileName;
+		fileName << std::hex << std::setw(16) << std::setfill('0') << sourceHash;
+		return ER_Utility::GetFilePath(std::string(ER_MESH_CACHE_DIRECTORY) + fileName.str() + ER_MESH_CACHE_EXTENSION);
+	}
+
+	bool ER_MeshCache::Open(const std::string& cachePath, UINT64 expectedSourceHash)
+	{
+		Close();
+		if (expectedSourceHash == 0 || !mFile.Open(ER_Utility::ToWideString(cachePath)))
+			return false;
+
+		CacheReader reader(mFile.GetData(), mFile.GetSize());
+		if (!reader.Read(mHeader) || mHeader.Magic != ER_MESH_CACHE_MAGIC || mHeader.Version != ER_MESH_CACHE_VERSION || mHeader.SourceHash != expectedSourceHash)
+		{
+			Close();
+			return false;
+		}
+
+		mMaterials.resize(mHeader.MaterialCount);
+		for (auto& material : mMaterials)
+		{
+			UINT32 textureTypesCount = 0;
+			reader.ReadString(material.Name);
+			reader.Read(textureTypesCount);
+			for (UINT32 i = 0; i < textureTypesCount && reader.IsValid(); i++)
+			{
+				UINT32 textureType = 0, texturesCount = 0;
+				reader.Read(textureType);
+				reader.Read(texturesCount);
+
+				std::vector<std::wstring>& textures = material.Textures[static_cast<TextureType>(textureType)];
+				for (UINT32 textureIndex = 0; textureIndex < texturesCount && reader.IsValid(); textureIndex++)
+				{
+					std::string path;
+					reader.ReadString(path);
+					textures.push_back(ER_Utility::ToWideString(path));
+				}
+			}
+		}
+
+		mMeshes.resize(mHeader.MeshCount);
+		for (auto& mesh : mMeshes)
+		{
+			reader.ReadString(mesh.Name);
+			reader.Read(mesh.MaterialIndex);
+			reader.Read(mesh.Attributes);
+			reader.Read(mesh.VertexCount);
+			reader.Read(mesh.IndexCount);
+			reader.Read(mesh.FaceCount);
+			reader.Read(mesh.UVChannelCount);
+			reader.Read(mesh.ColorChannelCount);
+			if (!reader.IsValid() || mesh.MaterialIndex >= mHeader.MaterialCount)
+			{
+				Close();
+				return false;
+			}
+
+			mesh.Vertices = reader.ReadArray<ER_MeshCacheVertex>(mesh.VertexCount);
+			if (mesh.UVChannelCount > 1)
+				mesh.ExtraUVs = reader.ReadArray<XMFLOAT3>(static_cast<UINT64>(mesh.UVChannelCount - 1) * mesh.VertexCount);
+			if (mesh.ColorChannelCount > 0)
+				mesh.Colors = reader.ReadArray<XMFLOAT4>(static_cast<UINT64>(mesh.ColorChannelCount) * mesh.VertexCount);
+			mesh.Indices = reader.ReadArray<UINT>(mesh.IndexCount);
+		}
+
+		if (!reader.IsValid())
+		{
+			std::string message = "[ER Logger][ER_MeshCache] Corrupted mesh cache file (will be rebuilt): " + cachePath + "\n";
+			ER_OUTPUT_LOG(ER_Utility::ToWideString(message).c_str());
+			Close();
+			return false;
+		}
+		return true;
+	}
+
+	void ER_MeshCache::Close()
+	{
+		mMeshes.clear();
+		mMaterials.clear();
+		mHeader = ER_MeshCacheHeader();
+		mFile.Close();
+	}
+
+	bool ER_MeshCache::Write(const std::string& cachePath, UINT64 sourceHash, const ER_Model& model, const ER_AABB& aabb, const std::vector<UINT>& meshesMaterialIndices)
+	{
+		if (sourceHash == 0)
+			return false;
+		assert(meshesMaterialIndices.size() == model.Meshes().size());
+
+		std::string directory;
+		ER_Utility::GetDirectory(cachePath, directory);
+		ER_Utility::CreateDirectories(directory);
+
+		// models can be loaded from several threads at the same time (i.e., LODs), so we write into a unique temp file and then rename it
+		std::stringstream tempPath;
+		tempPath << cachePath << "." << std::this_thread::get_id() << ".tmp";
+		{
+			std::ofstream file(tempPath.str().c_str(), std::ios::binary | std::ios::trunc);
+			if (!file.is_open())
+				return false;
+			CacheWriter writer(file);
+
+			ER_MeshCacheHeader header;
+			header.SourceHash = sourceHash;
+			header.MaterialCount = static_cast<UINT32>(model.Materials().size());
+			header.MeshCount = static_cast<UINT32>(model.Meshes().size());
+			header.AABBMin = aabb.first;
+			header.AABBMax = aabb.second;
+			writer.Write(header);
+
+			for (const ER_ModelMaterial& material : model.Materials())
+			{
+				writer.WriteString(material.Name());
+				writer.Write(static_cast<UINT32>(material.Textures().size()));
+				for (const auto& textures : material.Textures())
+				{
+					writer.Write(static_cast<UINT32>(textures.first));
+					writer.Write(static_cast<UINT32>(textures.second.size()));
+					for (const std::wstring& path : textures.second)
+					{
+						// paths come from narrow aiString (see ER_ModelMaterial), so this is lossless
+						std::string narrowPath(path.size(), '\0');
+						for (size_t i = 0; i < path.size(); i++)
+							narrowPath[i] = static_cast<char>(path[i]);
+						writer.WriteString(narrowPath);
+					}
+				}
+			}
+
+			std::vector<ER_MeshCacheVertex> vertices;
+			for (size_t meshIndex = 0; meshIndex < model.Meshes().size(); meshIndex++)
+			{
+				const ER_Mesh& mesh = model.Meshes()[meshIndex];
+				const UINT vertexCount = static_cast<UINT>(mesh.Vertices().size());
+				const UINT uvChannelCount = static_cast<UINT>(mesh.TextureCoordinates().size());
+				const UINT colorChannelCount = static_cast<UINT>(mesh.VertexColors().size());
+				const bool hasNormals = mesh.Normals().size() == vertexCount;
+				const bool hasTangents = mesh.Tangents().size() == vertexCount && mesh.BiNormals().size() == vertexCount;
+
+				writer.WriteString(mesh.Name());
+				writer.Write(static_cast<UINT32>(meshesMaterialIndices[meshIndex]));
+				writer.Write(static_cast<UINT32>((hasNormals ? ER_MESH_CACHE_NORMALS : 0) | (hasTangents ? ER_MESH_CACHE_TANGENTS : 0)));
+				writer.Write(static_cast<UINT32>(vertexCount));
+				writer.Write(static_cast<UINT32>(mesh.Indices().size()));
+				writer.Write(static_cast<UINT32>(mesh.FaceCount()));
+				writer.Write(static_cast<UINT32>(uvChannelCount));
+				writer.Write(static_cast<UINT32>(colorChannelCount));
+
+				const XMFLOAT3 zero(0.0f, 0.0f, 0.0f);
+				vertices.resize(vertexCount);
+				for (UINT i = 0; i < vertexCount; i++)
+				{
+					vertices[i].Position = mesh.Vertices()[i];
+					vertices[i].Normal = hasNormals ? mesh.Normals()[i] : zero;
+					vertices[i].Tangent = hasTangents ? mesh.Tangents()[i] : zero;
+					vertices[i].BiNormal = hasTangents ? mesh.BiNormals()[i] : zero;
+					vertices[i].UV = (uvChannelCount > 0) ? mesh.TextureCoordinates()[0][i] : zero;
+				}
+				writer.WriteArray(vertices.data(), sizeof(ER_MeshCacheVertex) * vertices.size());
+
+				for (UINT channel = 1; channel < uvChannelCount; channel++)
+					writer.WriteArray(mesh.TextureCoordinates()[channel].data(), sizeof(XMFLOAT3) * vertexCount);
+				for (UINT channel = 0; channel < colorChannelCount; channel++)
+					writer.WriteArray(mesh.VertexColors()[channel].data(), sizeof(XMFLOAT4) * vertexCount);
+				writer.WriteArray(mesh.Indices().data(), sizeof(UINT) * mesh.Indices().size());
+			}
+
+			if (file.fail())
+			{
+				file.close();
+				DeleteFileA(tempPath.str().c_str());
+				return false;
+			}
+		}
+
+		if (!MoveFileExA(tempPath.str().c_str(), cachePath.c_str(), MOVEFILE_REPLACE_EXISTING))
+		{
+			DeleteFileA(tempPath.str().c_str());
+			return false;
+		}
+		return true;
+	}
+}
@@ -0,0 +1,95 @@
+#pragma once
+#include "Common.h"
+#include "ER_MappedFile.h"
+#include "ER_ModelMaterial.h"
+
+#define ER_MESH_CACHE_MAGIC 0x48534D45 // "EMSH"
+#define ER_MESH_CACHE_VERSION 1
+#define ER_MESH_CACHE_DIRECTORY "content\\cache\\meshes\\"
+#define ER_MESH_CACHE_EXTENSION ".ermesh"
+
+namespace EveryRay_Core
+{
+	class ER_Model;
+
+	// Interleaved vertex of the cached mesh (first UV channel only, others are stored in a separate stream)
+	struct ER_MeshCacheVertex
+	{
+		XMFLOAT3 Position;
+		XMFLOAT3 Normal;
+		XMFLOAT3 Tangent;
+		XMFLOAT3 BiNormal;
+		XMFLOAT3 UV;
+	};
+
+	enum ER_MeshCacheAttributes
+	{
+		ER_MESH_CACHE_NORMALS = 0x1,
+		ER_MESH_CACHE_TANGENTS = 0x2 // + binormals
+	};
+
+	struct ER_MeshCacheHeader
+	{
+		UINT32 Magic = ER_MESH_CACHE_MAGIC;
+		UINT32 Version = ER_MESH_CACHE_VERSION;
+		UINT64 SourceHash = 0; // content hash of the source model (+ .mtl libraries) + import flags
+		UINT32 MaterialCount = 0;
+		UINT32 MeshCount = 0;
+		XMFLOAT3 AABBMin = { 0, 0, 0 };
+		XMFLOAT3 AABBMax = { 0, 0, 0 };
+	};
+
+	// Non-owning view of one cached mesh (points into the memory-mapped cache file)
+	struct ER_MeshCacheMeshView
+	{
+		std::string Name;
+		UINT MaterialIndex = 0;
+		UINT Attributes = 0; // ER_MeshCacheAttributes
+		UINT VertexCount = 0;
+		UINT IndexCount = 0;
+		UINT FaceCount = 0;
+		UINT UVChannelCount = 0;
+		UINT ColorChannelCount = 0;
+		const ER_MeshCacheVertex* Vertices = nullptr;
+		const XMFLOAT3* ExtraUVs = nullptr; // (UVChannelCount - 1) * VertexCount
+		const XMFLOAT4* Colors = nullptr; // ColorChannelCount * VertexCount
+		const UINT* Indices = nullptr;
+	};
+
+	struct ER_MeshCacheMaterialData
+	{
+		std::string Name;
+		std::map<TextureType, std::vector<std::wstring>> Textures;
+	};
+
+	// On-disk cache of imported models (already triangulated, with flipped winding/UVs), so that warm loads skip Assimp.
+	// Files are content-addressed: <ER_MESH_CACHE_DIRECTORY><hash of the source file (+ its .mtl libraries for .obj) + import flags>.ermesh
+	// Layout: [header] [materials: name, texture paths] [meshes: description, interleaved vertices, extra UVs, colors, indices]
+	class ER_MeshCache
+	{
+	public:
+		static UINT64 ComputeSourceHash(const std::string& modelPath, UINT importFlags);
+		static std::string GetCachePath(UINT64 sourceHash);
+
+		// Reads the whole cache file at once (memory-mapped); returns false on a miss or a corrupted/outdated file
+		bool Open(const std::string& cachePath, UINT64 expectedSourceHash);
+		void Close();
+
+		const ER_MeshCacheHeader& GetHeader() const { return mHeader; }
+		const std::vector<ER_MeshCacheMaterialData>& GetMaterials() const { return mMaterials; }
+		const std::vector<ER_MeshCacheMeshView>& GetMeshes() const { return mMeshes; }
+
+		static bool Write(const std::string& cachePath, UINT64 sourceHash, const ER_Model& model, const ER_AABB& aabb, const std::vector<UINT>& meshesMaterialIndices);
+
+		ER_MeshCache();
+		~ER_MeshCache();
+	private:
+		ER_MeshCache(const ER_MeshCache& rhs);
+		ER_MeshCache& operator=(const ER_MeshCache& rhs);
+
+		ER_MappedFile mFile;
+		ER_MeshCacheHeader mHeader;
+		std::vector<ER_MeshCacheMaterialData> mMaterials;
+		std::vector<ER_MeshCacheMeshView> mMeshes;
+	};
+}
@@ -1,10 +1,13 @@
 #include "stdafx.h"
+#include <atomic>
 
 #include "ER_Model.h"
 #include "ER_Mesh.h"
 #include "ER_ModelMaterial.h"
 #include "ER_Core.h"
 #include "ER_CoreException.h"
+#include "ER_MeshCache.h"
+#include "ER_Utility.h"
 
 #include "assimp\Importer.hpp"
 #include "assimp\scene.h"
@@ -12,10 +15,15 @@
 
 namespace EveryRay_Core
 {
+	static std::atomic<UINT> sColdLoadsCount { 0 };
+	static std::atomic<UINT> sWarmLoadsCount { 0 };
+	static std::atomic<long long> sColdLoadsTimeMicroseconds { 0 };
+	static std::atomic<long long> sWarmLoadsTimeMicroseconds { 0 };
+
 	ER_Model::ER_Model(ER_Core& game, const std::string& filename, bool flipUVs)
 		: mCore(game), mMeshes(), mMaterials()
 	{
-		Assimp::Importer importer;
+		auto startTimer = std::chrono::high_resolution_clock::now();
 
 		UINT flags = aiProcess_Triangulate /*| aiProcess_JoinIdenticalVertices*/ | aiProcess_SortByPType | aiProcess_FlipWindingOrder;
 		if (flipUVs)
@@ -23,7 +31,49 @@ namespace EveryRay_Core
 			flags |= aiProcess_FlipUVs;
 		}
 
-		const aiScene* scene = importer.ReadFile(filename, flags);
+		// warm load: already imported & flipped data from the mesh cache; cold load: Assimp import + writing to the mesh cache
+		const UINT64 sourceHash = ER_MeshCache::ComputeSourceHash(filename, flags);
+		const std::string cachePath = ER_MeshCache::GetCachePath(sourceHash);
+		{
+			ER_MeshCache cache;
+			mIsLoadedFromCache = cache.Open(cachePath, sourceHash);
+			if (mIsLoadedFromCache)
+				LoadFromCache(cache);
+		}
+
+		if (!mIsLoadedFromCache)
+		{
+			std::vector<UINT> meshesMaterialIndices;
+			LoadWithAssimp(filename, flags, meshesMaterialIndices);
+			ComputeAABB();
+
+			if (!ER_MeshCache::Write(cachePath, sourceHash, *this, mAABB, meshesMaterialIndices))
+			{
+				std::string message = "[ER Logger][ER_Model] Could not write mesh cache for model: " + filename + "\n";
+				ER_OUTPUT_LOG(ER_Utility::ToWideString(message).c_str());
+			}
+		}
+
+		mFilename = filename;
+
+		long long loadTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - startTimer).count();
+		if (mIsLoadedFromCache)
+		{
+			sWarmLoadsCount++;
+			sWarmLoadsTimeMicroseconds += loadTime;
+		}
+		else
+		{
+			sColdLoadsCount++;
+			sColdLoadsTimeMicroseconds += loadTime;
+		}
+	}
+
+	void ER_Model::LoadWithAssimp(const std::string& filename, UINT importFlags, std::vector<UINT>& meshesMaterialIndices)
+	{
+		Assimp::Importer importer;
+
+		const aiScene* scene = importer.ReadFile(filename, importFlags);
 		
 		if (scene == nullptr)
 		{
@@ -32,6 +82,7 @@ namespace EveryRay_Core
 
 		if (scene->HasMaterials())
 		{
+			mMaterials.reserve(scene->mNumMaterials);
 			for (UINT i = 0; i < scene->mNumMaterials; i++)
 				mMaterials.push_back(ER_ModelMaterial(*this, scene->mMaterials[i]));
 		}
@@ -39,10 +90,40 @@ namespace EveryRay_Core
 		if (scene->HasMeshes())
 		{
 			for (UINT i = 0; i < scene->mNumMeshes; i++)
+			{
 				mMeshes.push_back(ER_Mesh(*this, mMaterials[scene->mMeshes[i]->mMaterialIndex], *(scene->mMeshes[i])));
+				meshesMaterialIndices.push_back(scene->mMeshes[i]->mMaterialIndex);
+			}
 		}
+	}
 
-		mFilename = filename;
+	void ER_Model::LoadFromCache(const ER_MeshCache& cache)
+	{
+		mMaterials.reserve(cache.GetMaterials().size());
+		for (const ER_MeshCacheMaterialData& material : cache.GetMaterials())
+			mMaterials.push_back(ER_ModelMaterial(*this, material.Name, material.Textures));
+
+		mMeshes.reserve(cache.GetMeshes().size());
+		for (const ER_MeshCacheMeshView& mesh : cache.GetMeshes())
+			mMeshes.push_back(ER_Mesh(*this, mMaterials[mesh.MaterialIndex], mesh));
+
+		mAABB = { cache.GetHeader().AABBMin, cache.GetHeader().AABBMax };
+	}
+
+	void ER_Model::ResetLoadStatistics()
+	{
+		sColdLoadsCount = 0;
+		sWarmLoadsCount = 0;
+		sColdLoadsTimeMicroseconds = 0;
+		sWarmLoadsTimeMicroseconds = 0;
+	}
+
+	void ER_Model::GetLoadStatistics(UINT& coldLoads, double& coldLoadsTime, UINT& warmLoads, double& warmLoadsTime)
+	{
+		coldLoads = sColdLoadsCount;
+		warmLoads = sWarmLoadsCount;
+		coldLoadsTime = static_cast<double>(sColdLoadsTimeMicroseconds) / 1000000.0;
+		warmLoadsTime = static_cast<double>(sWarmLoadsTimeMicroseconds) / 1000000.0;
 	}
 
 	ER_Model::~ER_Model()
@@ -79,30 +160,33 @@ namespace EveryRay_Core
 		return mMaterials;
 	}
 
+	// AABB is computed once on load (or read from the mesh cache)
 	const ER_AABB& ER_Model::GenerateAABB()
 	{
-		std::vector<XMFLOAT3> vertices;
-
-		for (ER_Mesh& mesh : mMeshes)
-			vertices.insert(vertices.end(), mesh.Vertices().begin(), mesh.Vertices().end());
+		return mAABB;
+	}
 
+	void ER_Model::ComputeAABB()
+	{
 		XMFLOAT3 minVertex = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
 		XMFLOAT3 maxVertex = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
 
-		for (UINT i = 0; i < vertices.size(); i++)
+		for (const ER_Mesh& mesh : mMeshes)
 		{
-			//Get the smallest vertex 
-			minVertex.x = std::min(minVertex.x, vertices[i].x);    // Find smallest x value in model
-			minVertex.y = std::min(minVertex.y, vertices[i].y);    // Find smallest y value in model
-			minVertex.z = std::min(minVertex.z, vertices[i].z);    // Find smallest z value in model
-
-			//Get the largest vertex 
-			maxVertex.x = std::max(maxVertex.x, vertices[i].x);    // Find largest x value in model
-			maxVertex.y = std::max(maxVertex.y, vertices[i].y);    // Find largest y value in model
-			maxVertex.z = std::max(maxVertex.z, vertices[i].z);    // Find largest z value in model
+			for (const XMFLOAT3& vertex : mesh.Vertices())
+			{
+				//Get the smallest vertex 
+				minVertex.x = std::min(minVertex.x, vertex.x);    // Find smallest x value in model
+				minVertex.y = std::min(minVertex.y, vertex.y);    // Find smallest y value in model
+				minVertex.z = std::min(minVertex.z, vertex.z);    // Find smallest z value in model
+
+				//Get the largest vertex 
+				maxVertex.x = std::max(maxVertex.x, vertex.x);    // Find largest x value in model
+				maxVertex.y = std::max(maxVertex.y, vertex.y);    // Find largest y value in model
+				maxVertex.z = std::max(maxVertex.z, vertex.z);    // Find largest z value in model
+			}
 		}
 
 		mAABB = { minVertex, maxVertex };
-		return mAABB;
 	}
 }
\ No newline at end of file
@@ -7,6 +7,7 @@ namespace EveryRay_Core
 	class ER_Core;
 	class ER_Mesh;
 	class ER_ModelMaterial;
+	class ER_MeshCache;
 
 	class ER_Model
 	{
@@ -24,15 +25,24 @@ namespace EveryRay_Core
 		const std::string& GetFileName() { return mFilename; }
 		const char* GetFileNameChar() { return mFilename.c_str(); }
 		const ER_AABB& GenerateAABB();
+		bool IsLoadedFromCache() const { return mIsLoadedFromCache; }
 
+		// Accumulated loading times of all models (cold - imported with Assimp, warm - loaded from ER_MeshCache); thread-safe
+		static void ResetLoadStatistics();
+		static void GetLoadStatistics(UINT& coldLoads, double& coldLoadsTime, UINT& warmLoads, double& warmLoadsTime);
 	private:
 		ER_Model(const ER_Model& rhs);
 		ER_Model& operator=(const ER_Model& rhs);
 
+		void LoadWithAssimp(const std::string& filename, UINT importFlags, std::vector<UINT>& meshesMaterialIndices);
+		void LoadFromCache(const ER_MeshCache& cache);
+		void ComputeAABB();
+
 		ER_Core& mCore;
 		ER_AABB mAABB;
 		std::vector<ER_Mesh> mMeshes;
 		std::vector<ER_ModelMaterial> mMaterials;
 		std::string mFilename;
+		bool mIsLoadedFromCache = false;
 	};
 }
\ No newline at end of file
@@ -16,6 +16,12 @@ namespace EveryRay_Core
 		InitializeTextureTypeMappings();
 	}
 
+	ER_ModelMaterial::ER_ModelMaterial(ER_Model& model, const std::string& name, const std::map<TextureType, std::vector<std::wstring>>& textures)
+		: mModel(model), mName(name), mTextures(textures)
+	{
+		InitializeTextureTypeMappings();
+	}
+
 	ER_ModelMaterial::ER_ModelMaterial(ER_Model& model, aiMaterial* material)
 		: mModel(model), mTextures()
 	{
@@ -27,6 +27,7 @@ namespace EveryRay_Core
 	public:
 		ER_ModelMaterial(ER_Model& model, aiMaterial* material);
 		ER_ModelMaterial(ER_Model& model);
+		ER_ModelMaterial(ER_Model& model, const std::string& name, const std::map<TextureType, std::vector<std::wstring>>& textures);
 		~ER_ModelMaterial();
 
 		ER_Model& GetModel();
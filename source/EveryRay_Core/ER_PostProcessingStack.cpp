@@ -40,15 +40,6 @@ namespace EveryRay_Core {
 
 	ER_PostProcessingStack::~ER_PostProcessingStack()
 	{
-		DeleteObject(mTonemappingRT);
-		DeleteObject(mSSRRT);
-		DeleteObject(mSSSRT);
-		DeleteObject(mColorGradingRT);
-		DeleteObject(mVignetteRT);
-		DeleteObject(mFXAART);
-		DeleteObject(mLinearFogRT);
-		DeleteObject(mVolumetricFogRT);
-
 		DeleteObject(mTonemappingPS);
 		DeleteObject(mSSRPS);
 		DeleteObject(mSSSPS);
@@ -97,10 +88,6 @@ namespace EveryRay_Core {
 			
 			mLinearFogConstantBuffer.Initialize(rhi, "ER_RHI_GPUBuffer: Linear Fog CB");
 
-			mLinearFogRT = rhi->CreateGPUTexture(L"ER_RHI_GPUTexture: Linear Fog RT");
-			mLinearFogRT->CreateGPUTextureResource(rhi, static_cast<UINT>(mCore.ScreenWidth()), static_cast<UINT>(mCore.ScreenHeight()), 1u,
-				ER_FORMAT_R11G11B10_FLOAT, ER_BIND_SHADER_RESOURCE | ER_BIND_RENDER_TARGET, 1);
-
 			mLinearFogRS = rhi->CreateRootSignature(2, 1);
 			if (mLinearFogRS)
 			{
@@ -111,10 +98,6 @@ namespace EveryRay_Core {
 			}
 		}
 
-		mVolumetricFogRT = rhi->CreateGPUTexture(L"ER_RHI_GPUTexture: Volumetric Fog RT");
-		mVolumetricFogRT->CreateGPUTextureResource(rhi, static_cast<UINT>(mCore.ScreenWidth()), static_cast<UINT>(mCore.ScreenHeight()), 1u,
-			ER_FORMAT_R11G11B10_FLOAT, ER_BIND_SHADER_RESOURCE | ER_BIND_RENDER_TARGET, 1);
-
 		//SSR
 		{
 			mUseSSR = pSSR;
@@ -124,10 +107,6 @@ namespace EveryRay_Core {
 
 			mSSRConstantBuffer.Initialize(rhi, "ER_RHI_GPUBuffer: SSR CB");
 			
-			mSSRRT = rhi->CreateGPUTexture(L"ER_RHI_GPUTexture: SSR RT");
-			mSSRRT->CreateGPUTextureResource(rhi, static_cast<UINT>(mCore.ScreenWidth()), static_cast<UINT>(mCore.ScreenHeight()), 1u,
-				ER_FORMAT_R11G11B10_FLOAT, ER_BIND_SHADER_RESOURCE | ER_BIND_RENDER_TARGET, 1);
-
 			mSSRRS = rhi->CreateRootSignature(2, 1);
 			if (mSSRRS)
 			{
@@ -147,10 +126,6 @@ namespace EveryRay_Core {
 
 			mSSSConstantBuffer.Initialize(rhi, "ER_RHI_GPUBuffer: SSS CB");
 
-			mSSSRT = rhi->CreateGPUTexture(L"ER_RHI_GPUTexture: SSS RT");
-			mSSSRT->CreateGPUTextureResource(rhi, static_cast<UINT>(mCore.ScreenWidth()), static_cast<UINT>(mCore.ScreenHeight()), 1u,
-				ER_FORMAT_R11G11B10_FLOAT, ER_BIND_SHADER_RESOURCE | ER_BIND_RENDER_TARGET, 1);
-
 			mSSSRS = rhi->CreateRootSignature(2, 1);
 			if (mSSSRS)
 			{
@@ -168,10 +143,6 @@ namespace EveryRay_Core {
 			mTonemappingPS = rhi->CreateGPUShader();
 			mTonemappingPS->CompileShader(rhi, "content\\shaders\\Tonemap.hlsl", "PSMain", ER_PIXEL);
 
-			mTonemappingRT = rhi->CreateGPUTexture(L"ER_RHI_GPUTexture: Tonemapping RT");
-			mTonemappingRT->CreateGPUTextureResource(rhi, static_cast<UINT>(mCore.ScreenWidth()), static_cast<UINT>(mCore.ScreenHeight()), 1u,
-				ER_FORMAT_R11G11B10_FLOAT, ER_BIND_SHADER_RESOURCE | ER_BIND_RENDER_TARGET, 1);
-
 			mTonemapRS = rhi->CreateRootSignature(1, 1);
 			if (mTonemapRS)
 			{
@@ -195,10 +166,6 @@ namespace EveryRay_Core {
 			mColorGradingPS = rhi->CreateGPUShader();
 			mColorGradingPS->CompileShader(rhi, "content\\shaders\\ColorGrading.hlsl", "PSMain", ER_PIXEL);
 
-			mColorGradingRT = rhi->CreateGPUTexture(L"ER_RHI_GPUTexture: Color Grading RT");
-			mColorGradingRT->CreateGPUTextureResource(rhi, static_cast<UINT>(mCore.ScreenWidth()), static_cast<UINT>(mCore.ScreenHeight()), 1u,
-				ER_FORMAT_R11G11B10_FLOAT, ER_BIND_SHADER_RESOURCE | ER_BIND_RENDER_TARGET, 1);
-
 			mColorGradingRS = rhi->CreateRootSignature(1, 0);
 			if (mColorGradingRS)
 			{
@@ -216,10 +183,6 @@ namespace EveryRay_Core {
 
 			mVignetteConstantBuffer.Initialize(rhi, "ER_RHI_GPUBuffer: Vignette CB");
 			
-			mVignetteRT = rhi->CreateGPUTexture(L"ER_RHI_GPUTexture: Vignette RT");
-			mVignetteRT->CreateGPUTextureResource(rhi, static_cast<UINT>(mCore.ScreenWidth()), static_cast<UINT>(mCore.ScreenHeight()), 1u,
-				ER_FORMAT_R11G11B10_FLOAT, ER_BIND_SHADER_RESOURCE | ER_BIND_RENDER_TARGET, 1);
-
 			mVignetteRS = rhi->CreateRootSignature(2, 1);
 			if (mVignetteRS)
 			{
@@ -239,10 +202,6 @@ namespace EveryRay_Core {
 
 			mFXAAConstantBuffer.Initialize(rhi, "ER_RHI_GPUBuffer: FXAA CB");
 
-			mFXAART = rhi->CreateGPUTexture(L"ER_RHI_GPUTexture: FXAA RT");
-			mFXAART->CreateGPUTextureResource(rhi, static_cast<UINT>(mCore.ScreenWidth()), static_cast<UINT>(mCore.ScreenHeight()), 1u,
-				ER_FORMAT_R11G11B10_FLOAT, ER_BIND_SHADER_RESOURCE | ER_BIND_RENDER_TARGET, 1);
-
 			mFXAARS = rhi->CreateRootSignature(2, 1);
 			if (mFXAARS)
 			{
@@ -335,55 +294,6 @@ namespace EveryRay_Core {
 		ImGui::End();
 	}
 	
-	void ER_PostProcessingStack::Begin(ER_RHI_GPUTexture* aInitialRT, ER_RHI_GPUTexture* aDepthTarget)
-	{
-		assert(aInitialRT && aDepthTarget);
-		mRenderTargetBeforePostProcessingPasses = aInitialRT;
-		mDepthTarget = aDepthTarget;
-
-		auto rhi = mCore.GetRHI();
-		rhi->SetRenderTargets({ aInitialRT }, aDepthTarget);
-	}
-
-	void ER_PostProcessingStack::End(ER_RHI_GPUTexture* aResolveRT)
-	{
-		auto rhi = mCore.GetRHI();
-		rhi->UnbindRenderTargets();
-
-		rhi->SetMainRenderTargets();
-
-		rhi->SetTopologyType(ER_RHI_PRIMITIVE_TYPE::ER_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-		rhi->SetRootSignature(mFinalResolveRS);
-
-		//final resolve to main RT (pre-UI)
-		{
-			ER_QuadRenderer* quad = (ER_QuadRenderer*)mCore.GetServices().FindService(ER_QuadRenderer::TypeIdClass());
-			assert(quad);
-			assert(mRenderTargetBeforeResolve);
-
-			if (!rhi->IsPSOReady(mFinalResolvePassPSOName))
-			{
-				rhi->InitializePSO(mFinalResolvePassPSOName);
-				rhi->SetShader(mFinalResolvePS);
-				rhi->SetMainRenderTargetFormats();
-				rhi->SetBlendState(ER_NO_BLEND);
-				rhi->SetDepthStencilState(ER_DEPTH_ONLY_WRITE_COMPARISON_LESS_EQUAL);
-				rhi->SetRasterizerState(ER_NO_CULLING);
-				rhi->SetTopologyTypeToPSO(mFinalResolvePassPSOName, ER_RHI_PRIMITIVE_TYPE::ER_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-				rhi->SetRootSignatureToPSO(mFinalResolvePassPSOName, mFinalResolveRS);
-				quad->PrepareDraw(rhi);
-				rhi->FinalizePSO(mFinalResolvePassPSOName);
-			}
-			rhi->SetPSO(mFinalResolvePassPSOName);
-			rhi->SetSamplers(ER_PIXEL, { ER_RHI_SAMPLER_STATE::ER_TRILINEAR_WRAP });
-			rhi->SetShaderResources(ER_PIXEL, { aResolveRT ? aResolveRT : mRenderTargetBeforeResolve }, 0, mFinalResolveRS, FINALRESOLVE_PASS_ROOT_DESCRIPTOR_TABLE_SRV_INDEX);
-			quad->Draw(rhi);
-			rhi->UnsetPSO();
-		}
-
-		rhi->UnbindResourcesFromShader(ER_PIXEL);
-	}
-
 	void ER_PostProcessingStack::PrepareDrawingTonemapping(ER_RHI_GPUTexture* aInputTexture)
 	{
 		assert(aInputTexture);
@@ -485,272 +395,393 @@ namespace EveryRay_Core {
 		rhi->SetConstantBuffers(ER_PIXEL, { mFXAAConstantBuffer.Buffer() }, 0, mFXAARS, FXAA_PASS_ROOT_DESCRIPTOR_TABLE_CBV_INDEX);
 	}
 
-	void ER_PostProcessingStack::DrawEffects(const ER_CoreTime& gameTime, ER_QuadRenderer* quad, ER_GBuffer* gbuffer, ER_VolumetricClouds* aVolumetricClouds, ER_VolumetricFog* aVolumetricFog)
+	void ER_PostProcessingStack::AddPasses(ER_RenderGraph& aGraph, ER_RHI_GPUTexture* aInitialRT, ER_RHI_GPUTexture* aDepthTarget, const ER_CoreTime& gameTime, ER_QuadRenderer* quad, ER_GBuffer* gbuffer,
+		ER_VolumetricClouds* aVolumetricClouds, ER_VolumetricFog* aVolumetricFog)
 	{
+		assert(aInitialRT && aDepthTarget);
 		assert(quad);
 		assert(gbuffer);
-		auto rhi = mCore.GetRHI();
+		mDepthTarget = aDepthTarget;
 
-		mRenderTargetBeforeResolve = mRenderTargetBeforePostProcessingPasses;
-		rhi->SetTopologyType(ER_RHI_PRIMITIVE_TYPE::ER_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+		ER_RenderGraphTextureDesc effectRTDesc;
+		effectRTDesc.Width = static_cast<UINT>(mCore.ScreenWidth());
+		effectRTDesc.Height = static_cast<UINT>(mCore.ScreenHeight());
+		effectRTDesc.Format = ER_FORMAT_R11G11B10_FLOAT;
+		effectRTDesc.BindFlags = ER_BIND_SHADER_RESOURCE | ER_BIND_RENDER_TARGET;
 
-		// Linear fog
-		if (mUseLinearFog)
-		{
-			rhi->BeginEventTag("EveryRay: Post Processing (Linear Fog)");
+		const ER_RenderGraphResource depth = aGraph.ImportTexture("GBuffer Depth", aDepthTarget);
+		const ER_RenderGraphResource normals = aGraph.ImportTexture("GBuffer Normals", gbuffer->GetNormals());
+		const ER_RenderGraphResource positions = aGraph.ImportTexture("GBuffer Positions", gbuffer->GetPositions());
+		const ER_RenderGraphResource extra = aGraph.ImportTexture("GBuffer Extra", gbuffer->GetExtraBuffer());
+		const ER_RenderGraphResource extra2 = aGraph.ImportTexture("GBuffer Extra2", gbuffer->GetExtra2Buffer());
 
-			rhi->SetRenderTargets({ mLinearFogRT });
-			rhi->SetRootSignature(mLinearFogRS);
-			if (!rhi->IsPSOReady(mLinearFogPassPSOName))
-			{
-				rhi->InitializePSO(mLinearFogPassPSOName);
-				rhi->SetShader(mLinearFogPS);
-				rhi->SetRenderTargetFormats({ mLinearFogRT });
-				rhi->SetBlendState(ER_NO_BLEND);
-				rhi->SetRasterizerState(ER_NO_CULLING);
-				rhi->SetRootSignatureToPSO(mLinearFogPassPSOName, mLinearFogRS);
-				rhi->SetTopologyTypeToPSO(mLinearFogPassPSOName, ER_RHI_PRIMITIVE_TYPE::ER_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-				quad->PrepareDraw(rhi);
-				rhi->FinalizePSO(mLinearFogPassPSOName);
-			}
-			rhi->SetPSO(mLinearFogPassPSOName);
-			PrepareDrawingLinearFog(mRenderTargetBeforeResolve);
-			quad->Draw(rhi);
-			rhi->UnsetPSO();
-			
-			rhi->UnbindRenderTargets();
+		//[WARNING] Set from last enabled post processing effect
+		ER_RenderGraphResource renderTargetBeforeResolve = aGraph.ImportTexture("Post Processing Input", aInitialRT);
 
-			//[WARNING] Set from last post processing effect
-			mRenderTargetBeforeResolve = mLinearFogRT;
+		// Linear fog
+		{
+			const ER_RenderGraphResource input = renderTargetBeforeResolve;
+			const ER_RenderGraphResource output = aGraph.CreateTexture("Linear Fog RT", effectRTDesc);
+			aGraph.AddPass("Post Processing (Linear Fog)",
+				[=](ER_RenderGraphBuilder& builder)
+				{
+					builder.Read(input);
+					builder.Read(depth);
+					builder.Write(output);
+				},
+				[=](ER_RHI* rhi, const ER_RenderGraph& graph)
+				{
+					ER_RHI_GPUTexture* outputRT = graph.GetTexture(output);
+					rhi->SetTopologyType(ER_RHI_PRIMITIVE_TYPE::ER_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+					rhi->SetRenderTargets({ outputRT });
+					rhi->SetRootSignature(mLinearFogRS);
+					if (!rhi->IsPSOReady(mLinearFogPassPSOName))
+					{
+						rhi->InitializePSO(mLinearFogPassPSOName);
+						rhi->SetShader(mLinearFogPS);
+						rhi->SetRenderTargetFormats({ outputRT });
+						rhi->SetBlendState(ER_NO_BLEND);
+						rhi->SetRasterizerState(ER_NO_CULLING);
+						rhi->SetRootSignatureToPSO(mLinearFogPassPSOName, mLinearFogRS);
+						rhi->SetTopologyTypeToPSO(mLinearFogPassPSOName, ER_RHI_PRIMITIVE_TYPE::ER_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+						quad->PrepareDraw(rhi);
+						rhi->FinalizePSO(mLinearFogPassPSOName);
+					}
+					rhi->SetPSO(mLinearFogPassPSOName);
+					PrepareDrawingLinearFog(graph.GetTexture(input));
+					quad->Draw(rhi);
+					rhi->UnsetPSO();
 
-			rhi->EndEventTag();
+					rhi->UnbindRenderTargets();
+				});
+			if (mUseLinearFog)
+				renderTargetBeforeResolve = output;
 		}
 
 		// SSS
-		if (mUseSSS)
 		{
-			rhi->BeginEventTag("EveryRay: Post Processing (SSS)");
-
-			ER_Illumination* illumination = mCore.GetLevel()->mIllumination;
-			if (illumination->IsSSSBlurring())
-			{
-				rhi->SetRenderTargets({ mSSSRT });
-				rhi->SetRootSignature(mSSSRS);
-				if (!rhi->IsPSOReady(mSSSPassPSOName))
-				{
-					rhi->InitializePSO(mSSSPassPSOName);
-					rhi->SetShader(mSSSPS);
-					rhi->SetRenderTargetFormats({ mSSSRT });
-					rhi->SetBlendState(ER_NO_BLEND);
-					rhi->SetRasterizerState(ER_NO_CULLING);
-					rhi->SetRootSignatureToPSO(mSSSPassPSOName, mSSSRS);
-					rhi->SetTopologyTypeToPSO(mSSSPassPSOName, ER_RHI_PRIMITIVE_TYPE::ER_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-					quad->PrepareDraw(rhi);
-					rhi->FinalizePSO(mSSSPassPSOName);
-				}
-				rhi->SetPSO(mSSSPassPSOName);
-
-				//vertical
+			const ER_RenderGraphResource input = renderTargetBeforeResolve;
+			const ER_RenderGraphResource output = aGraph.CreateTexture("SSS RT", effectRTDesc);
+			aGraph.AddPass("Post Processing (SSS)",
+				[=](ER_RenderGraphBuilder& builder)
 				{
-					PrepareDrawingSSS(gameTime, mRenderTargetBeforeResolve, gbuffer, true);
-					quad->Draw(rhi, false);
-				}
-				//horizontal
+					builder.Read(input);
+					builder.Read(depth);
+					builder.Read(extra2);
+					builder.Write(output);
+				},
+				[=, &gameTime](ER_RHI* rhi, const ER_RenderGraph& graph)
 				{
-					PrepareDrawingSSS(gameTime, mRenderTargetBeforeResolve, gbuffer, false);
-					quad->Draw(rhi);
-				}
-				rhi->UnsetPSO();
-
-				rhi->UnbindRenderTargets();
-				//[WARNING] Set from last post processing effect
-				mRenderTargetBeforeResolve = mSSSRT;
-			}
-
-			rhi->EndEventTag();
+					ER_RHI_GPUTexture* outputRT = graph.GetTexture(output);
+					ER_RHI_GPUTexture* inputRT = graph.GetTexture(input);
+					rhi->SetTopologyType(ER_RHI_PRIMITIVE_TYPE::ER_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+					rhi->SetRenderTargets({ outputRT });
+					rhi->SetRootSignature(mSSSRS);
+					if (!rhi->IsPSOReady(mSSSPassPSOName))
+					{
+						rhi->InitializePSO(mSSSPassPSOName);
+						rhi->SetShader(mSSSPS);
+						rhi->SetRenderTargetFormats({ outputRT });
+						rhi->SetBlendState(ER_NO_BLEND);
+						rhi->SetRasterizerState(ER_NO_CULLING);
+						rhi->SetRootSignatureToPSO(mSSSPassPSOName, mSSSRS);
+						rhi->SetTopologyTypeToPSO(mSSSPassPSOName, ER_RHI_PRIMITIVE_TYPE::ER_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+						quad->PrepareDraw(rhi);
+						rhi->FinalizePSO(mSSSPassPSOName);
+					}
+					rhi->SetPSO(mSSSPassPSOName);
+
+					//vertical
+					{
+						PrepareDrawingSSS(gameTime, inputRT, gbuffer, true);
+						quad->Draw(rhi, false);
+					}
+					//horizontal
+					{
+						PrepareDrawingSSS(gameTime, inputRT, gbuffer, false);
+						quad->Draw(rhi);
+					}
+					rhi->UnsetPSO();
+
+					rhi->UnbindRenderTargets();
+				});
+			ER_Illumination* illumination = mCore.GetLevel()->mIllumination;
+			if (mUseSSS && illumination->IsSSSBlurring())
+				renderTargetBeforeResolve = output;
 		}
 
 		// SSR
-		if (mUseSSR)
 		{
-			rhi->BeginEventTag("EveryRay: Post Processing (SSR)");
-
-			rhi->SetRenderTargets({ mSSRRT });
-			rhi->SetRootSignature(mSSRRS);
-			if (!rhi->IsPSOReady(mSSRPassPSOName))
-			{
-				rhi->InitializePSO(mSSRPassPSOName);
-				rhi->SetShader(mSSRPS);
-				rhi->SetRenderTargetFormats({ mSSRRT });
-				rhi->SetBlendState(ER_NO_BLEND);
-				rhi->SetRasterizerState(ER_NO_CULLING);
-				rhi->SetRootSignatureToPSO(mSSRPassPSOName, mSSRRS);
-				rhi->SetTopologyTypeToPSO(mSSRPassPSOName, ER_RHI_PRIMITIVE_TYPE::ER_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-				quad->PrepareDraw(rhi);
-				rhi->FinalizePSO(mSSRPassPSOName);
-			}
-			rhi->SetPSO(mSSRPassPSOName);
-			PrepareDrawingSSR(gameTime, mRenderTargetBeforeResolve, gbuffer);
-			quad->Draw(rhi);
-			rhi->UnsetPSO();
-
-			rhi->UnbindRenderTargets();
-
-			//[WARNING] Set from last post processing effect
-			mRenderTargetBeforeResolve = mSSRRT;
+			const ER_RenderGraphResource input = renderTargetBeforeResolve;
+			const ER_RenderGraphResource output = aGraph.CreateTexture("SSR RT", effectRTDesc);
+			aGraph.AddPass("Post Processing (SSR)",
+				[=](ER_RenderGraphBuilder& builder)
+				{
+					builder.Read(input);
+					builder.Read(normals);
+					builder.Read(extra);
+					builder.Read(depth);
+					builder.Write(output);
+				},
+				[=, &gameTime](ER_RHI* rhi, const ER_RenderGraph& graph)
+				{
+					ER_RHI_GPUTexture* outputRT = graph.GetTexture(output);
+					rhi->SetTopologyType(ER_RHI_PRIMITIVE_TYPE::ER_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+					rhi->SetRenderTargets({ outputRT });
+					rhi->SetRootSignature(mSSRRS);
+					if (!rhi->IsPSOReady(mSSRPassPSOName))
+					{
+						rhi->InitializePSO(mSSRPassPSOName);
+						rhi->SetShader(mSSRPS);
+						rhi->SetRenderTargetFormats({ outputRT });
+						rhi->SetBlendState(ER_NO_BLEND);
+						rhi->SetRasterizerState(ER_NO_CULLING);
+						rhi->SetRootSignatureToPSO(mSSRPassPSOName, mSSRRS);
+						rhi->SetTopologyTypeToPSO(mSSRPassPSOName, ER_RHI_PRIMITIVE_TYPE::ER_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+						quad->PrepareDraw(rhi);
+						rhi->FinalizePSO(mSSRPassPSOName);
+					}
+					rhi->SetPSO(mSSRPassPSOName);
+					PrepareDrawingSSR(gameTime, graph.GetTexture(input), gbuffer);
+					quad->Draw(rhi);
+					rhi->UnsetPSO();
 
-			rhi->EndEventTag();
+					rhi->UnbindRenderTargets();
+				});
+			if (mUseSSR)
+				renderTargetBeforeResolve = output;
 		}
 
-		rhi->BeginEventTag("EveryRay: Post Processing (Volumetric Clouds - Composite)");
+		// Composite with volumetric clouds (if enabled): blends into the current RT, so the pass is only added when it does something
+		if (aVolumetricClouds && aVolumetricClouds->IsEnabled())
 		{
-			// Composite with volumetric clouds (if enabled)
-			if (aVolumetricClouds && aVolumetricClouds->IsEnabled())
-				aVolumetricClouds->Composite(mRenderTargetBeforeResolve);
+			const ER_RenderGraphResource target = renderTargetBeforeResolve;
+			aGraph.AddPass("Post Processing (Volumetric Clouds - Composite)",
+				[=](ER_RenderGraphBuilder& builder)
+				{
+					builder.Write(target);
+				},
+				[=](ER_RHI* rhi, const ER_RenderGraph& graph)
+				{
+					aVolumetricClouds->Composite(graph.GetTexture(target));
+				});
 		}
-		rhi->EndEventTag();
 
 		// Composite with volumetric fog (if enabled)
-		rhi->BeginEventTag("EveryRay: Post Processing (Volumetric Fog - Composite)");
+		if (aVolumetricFog)
 		{
-			if (aVolumetricFog && aVolumetricFog->IsEnabled())
-			{
-				rhi->SetRenderTargets({ mVolumetricFogRT });
-				aVolumetricFog->Composite(mVolumetricFogRT, mRenderTargetBeforeResolve, gbuffer->GetPositions());
-				rhi->UnbindRenderTargets();
-
-				//[WARNING] Set from last post processing effect
-				mRenderTargetBeforeResolve = mVolumetricFogRT;
-			}
+			const ER_RenderGraphResource input = renderTargetBeforeResolve;
+			const ER_RenderGraphResource output = aGraph.CreateTexture("Volumetric Fog RT", effectRTDesc);
+			aGraph.AddPass("Post Processing (Volumetric Fog - Composite)",
+				[=](ER_RenderGraphBuilder& builder)
+				{
+					builder.Read(input);
+					builder.Read(positions);
+					builder.Write(output);
+				},
+				[=](ER_RHI* rhi, const ER_RenderGraph& graph)
+				{
+					ER_RHI_GPUTexture* outputRT = graph.GetTexture(output);
+					rhi->SetRenderTargets({ outputRT });
+					aVolumetricFog->Composite(outputRT, graph.GetTexture(input), gbuffer->GetPositions());
+					rhi->UnbindRenderTargets();
+				});
+			if (aVolumetricFog->IsEnabled())
+				renderTargetBeforeResolve = output;
 		}
-		rhi->EndEventTag();
 
 		// Tonemap
-		if (mUseTonemap)
 		{
-			rhi->BeginEventTag("EveryRay: Post Processing (Tonemap)");
-
-			rhi->SetRenderTargets({ mTonemappingRT });
-			rhi->SetRootSignature(mTonemapRS);
-			if (!rhi->IsPSOReady(mTonemapPassPSOName))
-			{
-				rhi->InitializePSO(mTonemapPassPSOName);
-				rhi->SetShader(mTonemappingPS);
-				rhi->SetBlendState(ER_NO_BLEND);
-				rhi->SetRasterizerState(ER_NO_CULLING);
-				rhi->SetRenderTargetFormats({ mTonemappingRT });
-				rhi->SetRootSignatureToPSO(mTonemapPassPSOName, mTonemapRS);
-				rhi->SetTopologyTypeToPSO(mTonemapPassPSOName, ER_RHI_PRIMITIVE_TYPE::ER_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-				quad->PrepareDraw(rhi);
-				rhi->FinalizePSO(mTonemapPassPSOName);
-			}
-			rhi->SetPSO(mTonemapPassPSOName);
-			PrepareDrawingTonemapping(mRenderTargetBeforeResolve);
-			quad->Draw(rhi);
-			rhi->UnsetPSO();
-
-			rhi->UnbindRenderTargets();
-
-			//[WARNING] Set from last post processing effect
-			mRenderTargetBeforeResolve = mTonemappingRT;
+			const ER_RenderGraphResource input = renderTargetBeforeResolve;
+			const ER_RenderGraphResource output = aGraph.CreateTexture("Tonemapping RT", effectRTDesc);
+			aGraph.AddPass("Post Processing (Tonemap)",
+				[=](ER_RenderGraphBuilder& builder)
+				{
+					builder.Read(input);
+					builder.Write(output);
+				},
+				[=](ER_RHI* rhi, const ER_RenderGraph& graph)
+				{
+					ER_RHI_GPUTexture* outputRT = graph.GetTexture(output);
+					rhi->SetTopologyType(ER_RHI_PRIMITIVE_TYPE::ER_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+					rhi->SetRenderTargets({ outputRT });
+					rhi->SetRootSignature(mTonemapRS);
+					if (!rhi->IsPSOReady(mTonemapPassPSOName))
+					{
+						rhi->InitializePSO(mTonemapPassPSOName);
+						rhi->SetShader(mTonemappingPS);
+						rhi->SetBlendState(ER_NO_BLEND);
+						rhi->SetRasterizerState(ER_NO_CULLING);
+						rhi->SetRenderTargetFormats({ outputRT });
+						rhi->SetRootSignatureToPSO(mTonemapPassPSOName, mTonemapRS);
+						rhi->SetTopologyTypeToPSO(mTonemapPassPSOName, ER_RHI_PRIMITIVE_TYPE::ER_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+						quad->PrepareDraw(rhi);
+						rhi->FinalizePSO(mTonemapPassPSOName);
+					}
+					rhi->SetPSO(mTonemapPassPSOName);
+					PrepareDrawingTonemapping(graph.GetTexture(input));
+					quad->Draw(rhi);
+					rhi->UnsetPSO();
 
-			rhi->EndEventTag();
+					rhi->UnbindRenderTargets();
+				});
+			if (mUseTonemap)
+				renderTargetBeforeResolve = output;
 		}
 
 		// Color grading
-		if (mUseColorGrading)
 		{
-			rhi->BeginEventTag("EveryRay: Post Processing (Color Grading)");
-
-			rhi->SetRenderTargets({ mColorGradingRT });
-			rhi->SetRootSignature(mColorGradingRS);
-			if (!rhi->IsPSOReady(mColorGradingPassPSOName))
-			{
-				rhi->InitializePSO(mColorGradingPassPSOName);
-				rhi->SetShader(mColorGradingPS);
-				rhi->SetRenderTargetFormats({ mColorGradingRT });
-				rhi->SetBlendState(ER_NO_BLEND);
-				rhi->SetRasterizerState(ER_NO_CULLING);
-				rhi->SetRootSignatureToPSO(mColorGradingPassPSOName, mColorGradingRS);
-				rhi->SetTopologyTypeToPSO(mColorGradingPassPSOName, ER_RHI_PRIMITIVE_TYPE::ER_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-				quad->PrepareDraw(rhi);
-				rhi->FinalizePSO(mColorGradingPassPSOName);
-			}
-			rhi->SetPSO(mColorGradingPassPSOName);
-			PrepareDrawingColorGrading(mRenderTargetBeforeResolve);
-			quad->Draw(rhi);
-			rhi->UnsetPSO();
-
-			rhi->UnbindRenderTargets();
-
-			//[WARNING] Set from last post processing effect
-			mRenderTargetBeforeResolve = mColorGradingRT;
+			const ER_RenderGraphResource input = renderTargetBeforeResolve;
+			const ER_RenderGraphResource output = aGraph.CreateTexture("Color Grading RT", effectRTDesc);
+			aGraph.AddPass("Post Processing (Color Grading)",
+				[=](ER_RenderGraphBuilder& builder)
+				{
+					builder.Read(input);
+					builder.Write(output);
+				},
+				[=](ER_RHI* rhi, const ER_RenderGraph& graph)
+				{
+					ER_RHI_GPUTexture* outputRT = graph.GetTexture(output);
+					rhi->SetTopologyType(ER_RHI_PRIMITIVE_TYPE::ER_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+					rhi->SetRenderTargets({ outputRT });
+					rhi->SetRootSignature(mColorGradingRS);
+					if (!rhi->IsPSOReady(mColorGradingPassPSOName))
+					{
+						rhi->InitializePSO(mColorGradingPassPSOName);
+						rhi->SetShader(mColorGradingPS);
+						rhi->SetRenderTargetFormats({ outputRT });
+						rhi->SetBlendState(ER_NO_BLEND);
+						rhi->SetRasterizerState(ER_NO_CULLING);
+						rhi->SetRootSignatureToPSO(mColorGradingPassPSOName, mColorGradingRS);
+						rhi->SetTopologyTypeToPSO(mColorGradingPassPSOName, ER_RHI_PRIMITIVE_TYPE::ER_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+						quad->PrepareDraw(rhi);
+						rhi->FinalizePSO(mColorGradingPassPSOName);
+					}
+					rhi->SetPSO(mColorGradingPassPSOName);
+					PrepareDrawingColorGrading(graph.GetTexture(input));
+					quad->Draw(rhi);
+					rhi->UnsetPSO();
 
-			rhi->EndEventTag();
+					rhi->UnbindRenderTargets();
+				});
+			if (mUseColorGrading)
+				renderTargetBeforeResolve = output;
 		}
 
 		// Vignette
-		if (mUseVignette)
 		{
-			rhi->BeginEventTag("EveryRay: Post Processing (Vignette)");
-
-			rhi->SetRenderTargets({ mVignetteRT });
-			rhi->SetRootSignature(mVignetteRS);
-			if (!rhi->IsPSOReady(mVignettePassPSOName))
-			{
-				rhi->InitializePSO(mVignettePassPSOName);
-				rhi->SetShader(mVignettePS);
-				rhi->SetBlendState(ER_NO_BLEND);
-				rhi->SetRasterizerState(ER_NO_CULLING);
-				rhi->SetRenderTargetFormats({ mVignetteRT });
-				rhi->SetRootSignatureToPSO(mVignettePassPSOName, mVignetteRS);
-				rhi->SetTopologyTypeToPSO(mVignettePassPSOName, ER_RHI_PRIMITIVE_TYPE::ER_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-				quad->PrepareDraw(rhi);
-				rhi->FinalizePSO(mVignettePassPSOName);
-			}
-			rhi->SetPSO(mVignettePassPSOName);
-			PrepareDrawingVignette(mRenderTargetBeforeResolve);
-			quad->Draw(rhi);
-			rhi->UnsetPSO();
-
-			rhi->UnbindRenderTargets();
-
-			//[WARNING] Set from last post processing effect
-			mRenderTargetBeforeResolve = mVignetteRT;
+			const ER_RenderGraphResource input = renderTargetBeforeResolve;
+			const ER_RenderGraphResource output = aGraph.CreateTexture("Vignette RT", effectRTDesc);
+			aGraph.AddPass("Post Processing (Vignette)",
+				[=](ER_RenderGraphBuilder& builder)
+				{
+					builder.Read(input);
+					builder.Write(output);
+				},
+				[=](ER_RHI* rhi, const ER_RenderGraph& graph)
+				{
+					ER_RHI_GPUTexture* outputRT = graph.GetTexture(output);
+					rhi->SetTopologyType(ER_RHI_PRIMITIVE_TYPE::ER_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+					rhi->SetRenderTargets({ outputRT });
+					rhi->SetRootSignature(mVignetteRS);
+					if (!rhi->IsPSOReady(mVignettePassPSOName))
+					{
+						rhi->InitializePSO(mVignettePassPSOName);
+						rhi->SetShader(mVignettePS);
+						rhi->SetBlendState(ER_NO_BLEND);
+						rhi->SetRasterizerState(ER_NO_CULLING);
+						rhi->SetRenderTargetFormats({ outputRT });
+						rhi->SetRootSignatureToPSO(mVignettePassPSOName, mVignetteRS);
+						rhi->SetTopologyTypeToPSO(mVignettePassPSOName, ER_RHI_PRIMITIVE_TYPE::ER_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+						quad->PrepareDraw(rhi);
+						rhi->FinalizePSO(mVignettePassPSOName);
+					}
+					rhi->SetPSO(mVignettePassPSOName);
+					PrepareDrawingVignette(graph.GetTexture(input));
+					quad->Draw(rhi);
+					rhi->UnsetPSO();
 
-			rhi->EndEventTag();
+					rhi->UnbindRenderTargets();
+				});
+			if (mUseVignette)
+				renderTargetBeforeResolve = output;
 		}
 
 		// FXAA
-		if (mUseFXAA)
 		{
-			rhi->BeginEventTag("EveryRay: Post Processing (FXAA)");
-
-			rhi->SetRenderTargets({ mFXAART });
-			rhi->SetRootSignature(mFXAARS);
-			if (!rhi->IsPSOReady(mFXAAPassPSOName))
-			{
-				rhi->InitializePSO(mFXAAPassPSOName);
-				rhi->SetShader(mFXAAPS);
-				rhi->SetBlendState(ER_NO_BLEND);
-				rhi->SetRasterizerState(ER_NO_CULLING);
-				rhi->SetRenderTargetFormats({ mFXAART });
-				rhi->SetRootSignatureToPSO(mFXAAPassPSOName, mFXAARS);
-				rhi->SetTopologyTypeToPSO(mFXAAPassPSOName, ER_RHI_PRIMITIVE_TYPE::ER_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-				quad->PrepareDraw(rhi);
-				rhi->FinalizePSO(mFXAAPassPSOName);
-			}
-			rhi->SetPSO(mFXAAPassPSOName);
-			PrepareDrawingFXAA(mRenderTargetBeforeResolve);
-			quad->Draw(rhi);
-			rhi->UnsetPSO();
+			const ER_RenderGraphResource input = renderTargetBeforeResolve;
+			const ER_RenderGraphResource output = aGraph.CreateTexture("FXAA RT", effectRTDesc);
+			aGraph.AddPass("Post Processing (FXAA)",
+				[=](ER_RenderGraphBuilder& builder)
+				{
+					builder.Read(input);
+					builder.Write(output);
+				},
+				[=](ER_RHI* rhi, const ER_RenderGraph& graph)
+				{
+					ER_RHI_GPUTexture* outputRT = graph.GetTexture(output);
+					rhi->SetTopologyType(ER_RHI_PRIMITIVE_TYPE::ER_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+					rhi->SetRenderTargets({ outputRT });
+					rhi->SetRootSignature(mFXAARS);
+					if (!rhi->IsPSOReady(mFXAAPassPSOName))
+					{
+						rhi->InitializePSO(mFXAAPassPSOName);
+						rhi->SetShader(mFXAAPS);
+						rhi->SetBlendState(ER_NO_BLEND);
+						rhi->SetRasterizerState(ER_NO_CULLING);
+						rhi->SetRenderTargetFormats({ outputRT });
+						rhi->SetRootSignatureToPSO(mFXAAPassPSOName, mFXAARS);
+						rhi->SetTopologyTypeToPSO(mFXAAPassPSOName, ER_RHI_PRIMITIVE_TYPE::ER_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+						quad->PrepareDraw(rhi);
+						rhi->FinalizePSO(mFXAAPassPSOName);
+					}
+					rhi->SetPSO(mFXAAPassPSOName);
+					PrepareDrawingFXAA(graph.GetTexture(input));
+					quad->Draw(rhi);
+					rhi->UnsetPSO();
 
-			rhi->UnbindRenderTargets();
+					rhi->UnbindRenderTargets();
+				});
+			if (mUseFXAA)
+				renderTargetBeforeResolve = output;
+		}
 
-			//[WARNING] Set from last post processing effect 
-			mRenderTargetBeforeResolve = mFXAART;
+		//final resolve to main RT (pre-UI)
+		{
+			const ER_RenderGraphResource input = renderTargetBeforeResolve;
+			aGraph.AddPass("Post Processing (Final Resolve)",
+				[=](ER_RenderGraphBuilder& builder)
+				{
+					builder.Read(input);
+					builder.SetSideEffect();
+				},
+				[=](ER_RHI* rhi, const ER_RenderGraph& graph)
+				{
+					rhi->SetMainRenderTargets();
+
+					rhi->SetTopologyType(ER_RHI_PRIMITIVE_TYPE::ER_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+					rhi->SetRootSignature(mFinalResolveRS);
+					if (!rhi->IsPSOReady(mFinalResolvePassPSOName))
+					{
+						rhi->InitializePSO(mFinalResolvePassPSOName);
+						rhi->SetShader(mFinalResolvePS);
+						rhi->SetMainRenderTargetFormats();
+						rhi->SetBlendState(ER_NO_BLEND);
+						rhi->SetDepthStencilState(ER_DEPTH_ONLY_WRITE_COMPARISON_LESS_EQUAL);
+						rhi->SetRasterizerState(ER_NO_CULLING);
+						rhi->SetTopologyTypeToPSO(mFinalResolvePassPSOName, ER_RHI_PRIMITIVE_TYPE::ER_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+						rhi->SetRootSignatureToPSO(mFinalResolvePassPSOName, mFinalResolveRS);
+						quad->PrepareDraw(rhi);
+						rhi->FinalizePSO(mFinalResolvePassPSOName);
+					}
+					rhi->SetPSO(mFinalResolvePassPSOName);
+					rhi->SetSamplers(ER_PIXEL, { ER_RHI_SAMPLER_STATE::ER_TRILINEAR_WRAP });
+					rhi->SetShaderResources(ER_PIXEL, { graph.GetTexture(input) }, 0, mFinalResolveRS, FINALRESOLVE_PASS_ROOT_DESCRIPTOR_TABLE_SRV_INDEX);
+					quad->Draw(rhi);
+					rhi->UnsetPSO();
 
-			rhi->EndEventTag();
+					rhi->UnbindResourcesFromShader(ER_PIXEL);
+				});
+		}
 		}
-	}
 }
\ No newline at end of file
@@ -0,0 +1,578 @@
+#include "stdafx.h"
+#include <algorithm>
+
+#include "ER_RenderGraph.h"
+#include "ER_Utility.h"
+
+namespace EveryRay_Core
+{
+	namespace
+	{
+		const char* GetResourceStateName(ER_RHI_RESOURCE_STATE aState)
+		{
+			switch (aState)
+			{
+			case ER_RESOURCE_STATE_COMMON:								return "COMMON";
+			case ER_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER:			return "VERTEX_AND_CONSTANT_BUFFER";
+			case ER_RESOURCE_STATE_INDEX_BUFFER:						return "INDEX_BUFFER";
+			case ER_RESOURCE_STATE_RENDER_TARGET:						return "RENDER_TARGET";
+			case ER_RESOURCE_STATE_UNORDERED_ACCESS:					return "UNORDERED_ACCESS";
+			case ER_RESOURCE_STATE_DEPTH_WRITE:							return "DEPTH_WRITE";
+			case ER_RESOURCE_STATE_DEPTH_READ:							return "DEPTH_READ";
+			case ER_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE:			return "NON_PIXEL_SHADER_RESOURCE";
+			case ER_RESOURCE_STATE_PIXEL_SHADER_RESOURCE:				return "PIXEL_SHADER_RESOURCE";
+			case ER_RESOURCE_STATE_INDIRECT_ARGUMENT:					return "INDIRECT_ARGUMENT";
+			case ER_RESOURCE_STATE_COPY_DEST:							return "COPY_DEST";
+			case ER_RESOURCE_STATE_COPY_SOURCE:							return "COPY_SOURCE";
+			case ER_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE:	return "RAYTRACING_ACCELERATION_STRUCTURE";
+			case ER_RESOURCE_STATE_GENERIC_READ:						return "GENERIC_READ";
+			case ER_RESOURCE_STATE_PRESENT:								return "PRESENT";
+			default:													return "UNKNOWN";
+			}
+		}
+	}
+
+	void ER_RenderGraphBuilder::Read(ER_RenderGraphResource aResource, ER_RHI_RESOURCE_STATE aState)
+	{
+		mGraph.AddAccess(mPassIndex, aResource, aState, false);
+	}
+
+	void ER_RenderGraphBuilder::Write(ER_RenderGraphResource aResource, ER_RHI_RESOURCE_STATE aState)
+	{
+		mGraph.AddAccess(mPassIndex, aResource, aState, true);
+	}
+
+	void ER_RenderGraphBuilder::SetSideEffect()
+	{
+		mGraph.mPasses[mPassIndex].HasSideEffect = true;
+	}
+
+	ER_RenderGraph::ER_RenderGraph()
+	{
+	}
+
+	ER_RenderGraph::~ER_RenderGraph()
+	{
+		ReleasePool();
+	}
+
+	// Passes and resources are not cleared, only their counters: their strings and vectors keep the capacity for the next frame
+	void ER_RenderGraph::Reset()
+	{
+		for (UINT i = 0; i < mPassesCount; i++)
+			mPasses[i].Execute.Reset(); // do not keep the captures of the previous frame alive
+		mPassesCount = 0;
+		mResourcesCount = 0;
+		mBarriers.clear();
+		mStats = ER_RenderGraphStats();
+		mIsCompiled = false;
+		mFrameIndex++;
+
+		// retire the pooled textures that have not been used for a while (i.e., after a resolution change or an effect was disabled);
+		// resource handles only live for one frame, so pool indices can be shifted here
+		for (auto it = mPool.begin(); it != mPool.end();)
+		{
+			if (it->LastUsedFrame + ER_RENDER_GRAPH_POOL_RETIRE_FRAMES < mFrameIndex)
+			{
+				DeleteObject(it->Texture);
+				it = mPool.erase(it);
+			}
+			else
+				++it;
+		}
+	}
+
+	ER_RenderGraphResource ER_RenderGraph::ImportTexture(const char* aName, ER_RHI_GPUTexture* aTexture)
+	{
+		assert(aTexture);
+		assert(!mIsCompiled);
+
+		// the same texture can be imported by several systems, it must map to one resource to keep its state consistent
+		for (int i = 0; i < static_cast<int>(mResourcesCount); i++)
+		{
+			if (mResources[i].ImportedTexture == aTexture)
+				return i;
+		}
+
+		const ER_RenderGraphResource resourceIndex = AddResource(aName);
+		mResources[resourceIndex].ImportedTexture = aTexture;
+		return resourceIndex;
+	}
+
+	ER_RenderGraphResource ER_RenderGraph::CreateTexture(const char* aName, const ER_RenderGraphTextureDesc& aDesc)
+	{
+		assert(aDesc.Width > 0 && aDesc.Height > 0 && aDesc.Format != ER_FORMAT_UNKNOWN);
+		assert(!mIsCompiled);
+
+		const ER_RenderGraphResource resourceIndex = AddResource(aName);
+		mResources[resourceIndex].Desc = aDesc;
+		return resourceIndex;
+	}
+
+	void ER_RenderGraph::MarkOutput(ER_RenderGraphResource aResource)
+	{
+		assert(aResource >= 0 && aResource < static_cast<int>(mResourcesCount));
+		mResources[aResource].IsOutput = true;
+	}
+
+	int ER_RenderGraph::BeginPass(const char* aName)
+	{
+		assert(aName);
+		assert(!mIsCompiled);
+
+		if (mPassesCount == mPasses.size())
+			mPasses.emplace_back();
+
+		Pass& pass = mPasses[mPassesCount];
+		pass.Name.assign(aName);
+		pass.EventName.assign("EveryRay: ").append(aName);
+		pass.Accesses.clear();
+		pass.HasSideEffect = false;
+		pass.IsCulled = false;
+		pass.BarriersStart = 0;
+		pass.BarriersCount = 0;
+		return static_cast<int>(mPassesCount++);
+	}
+
+	ER_RenderGraphResource ER_RenderGraph::AddResource(const char* aName)
+	{
+		assert(aName);
+
+		if (mResourcesCount == mResources.size())
+			mResources.emplace_back();
+
+		Resource& resource = mResources[mResourcesCount];
+		resource.Name.assign(aName);
+		resource.Desc = ER_RenderGraphTextureDesc();
+		resource.ImportedTexture = nullptr;
+		resource.PhysicalIndex = -1;
+		resource.FirstPass = -1;
+		resource.LastPass = -1;
+		resource.IsOutput = false;
+		return static_cast<ER_RenderGraphResource>(mResourcesCount++);
+	}
+
+	void ER_RenderGraph::AddAccess(int aPassIndex, ER_RenderGraphResource aResource, ER_RHI_RESOURCE_STATE aState, bool aIsWrite)
+	{
+		assert(aResource >= 0 && aResource < static_cast<int>(mResourcesCount));
+
+		Pass& pass = mPasses[aPassIndex];
+		for (Access& access : pass.Accesses)
+		{
+			if (access.Resource != aResource)
+				continue;
+
+			// read + write of the same resource in one pass: the pass starts in the state of the write
+			if (aIsWrite)
+				access.State = aState;
+			access.IsRead |= !aIsWrite;
+			access.IsWrite |= aIsWrite;
+			return;
+		}
+
+		pass.Accesses.push_back({ aResource, aState, !aIsWrite, aIsWrite });
+	}
+
+	void ER_RenderGraph::Compile()
+	{
+		assert(!mIsCompiled);
+
+		CullPasses();
+		ComputeLifetimes();
+		AliasTransientTextures();
+		ComputeBarriers();
+
+		mStats.PassesCount = mPassesCount;
+		for (UINT i = 0; i < mPassesCount; i++)
+		{
+			if (mPasses[i].IsCulled)
+				mStats.CulledPassesCount++;
+			else if (mPasses[i].BarriersCount > 0)
+				mStats.BarrierBatchesCount++;
+		}
+		for (UINT i = 0; i < mResourcesCount; i++)
+		{
+			if (!mResources[i].ImportedTexture && mResources[i].FirstPass >= 0)
+				mStats.TransientTexturesCount++;
+		}
+		for (const PhysicalTexture& physical : mPool)
+		{
+			if (physical.LastPass >= 0)
+				mStats.PhysicalTexturesCount++;
+		}
+		mStats.BarriersCount = static_cast<UINT>(mBarriers.size());
+
+		mIsCompiled = true;
+	}
+
+	// Walks the passes backwards: a pass is live if it has a side effect or writes a resource that a later live pass reads (or an output).
+	// Writes do not "consume" the resource, because a pass can write only a part of it (i.e., blending), so the earlier writers stay live.
+	void ER_RenderGraph::CullPasses()
+	{
+		std::vector<bool>& isNeeded = mTempNeededResources;
+		isNeeded.assign(mResourcesCount, false);
+		for (UINT i = 0; i < mResourcesCount; i++)
+			isNeeded[i] = mResources[i].IsOutput;
+
+		for (int passIndex = static_cast<int>(mPassesCount) - 1; passIndex >= 0; passIndex--)
+		{
+			Pass& pass = mPasses[passIndex];
+
+			bool isLive = pass.HasSideEffect;
+			for (const Access& access : pass.Accesses)
+			{
+				if (access.IsWrite && isNeeded[access.Resource])
+					isLive = true;
+			}
+
+			pass.IsCulled = !isLive;
+			if (!isLive)
+				continue;
+
+			for (const Access& access : pass.Accesses)
+			{
+				if (access.IsRead)
+					isNeeded[access.Resource] = true;
+			}
+		}
+	}
+
+	void ER_RenderGraph::ComputeLifetimes()
+	{
+		for (int passIndex = 0; passIndex < static_cast<int>(mPassesCount); passIndex++)
+		{
+			if (mPasses[passIndex].IsCulled)
+				continue;
+
+			for (const Access& access : mPasses[passIndex].Accesses)
+			{
+				Resource& resource = mResources[access.Resource];
+				if (resource.FirstPass < 0)
+					resource.FirstPass = passIndex;
+				resource.LastPass = passIndex;
+			}
+		}
+	}
+
+	// Transient textures are assigned to pooled physical textures in the order of their first use: a physical texture is reused
+	// if it has the same description and its previous lifetime in this frame has ended before the new one begins.
+	// The pool is not touched by the RHI here, missing textures are created in Execute().
+	void ER_RenderGraph::AliasTransientTextures()
+	{
+		for (PhysicalTexture& physical : mPool)
+			physical.LastPass = -1;
+
+		std::vector<int>& transients = mTempTransientResources;
+		transients.clear();
+		for (int i = 0; i < static_cast<int>(mResourcesCount); i++)
+		{
+			if (!mResources[i].ImportedTexture && mResources[i].FirstPass >= 0)
+				transients.push_back(i);
+		}
+		std::stable_sort(transients.begin(), transients.end(), [this](int a, int b) { return mResources[a].FirstPass < mResources[b].FirstPass; });
+
+		for (int resourceIndex : transients)
+		{
+			Resource& resource = mResources[resourceIndex];
+
+			int physicalIndex = -1;
+			for (int i = 0; i < static_cast<int>(mPool.size()); i++)
+			{
+				if (mPool[i].LastPass < resource.FirstPass && mPool[i].Desc == resource.Desc)
+				{
+					physicalIndex = i;
+					break;
+				}
+			}
+			if (physicalIndex < 0)
+			{
+				PhysicalTexture physical;
+				physical.Desc = resource.Desc;
+				mPool.push_back(physical);
+				physicalIndex = static_cast<int>(mPool.size() - 1);
+			}
+
+			mPool[physicalIndex].LastPass = resource.LastPass;
+			mPool[physicalIndex].LastUsedFrame = mFrameIndex;
+			resource.PhysicalIndex = physicalIndex;
+		}
+	}
+
+	// Simulates the states of the resources through the live passes. The state at the beginning of the frame is unknown
+	// (imported textures are also used outside of the graph), so the first access always gets a barrier (the RHI skips it if it is a no-op).
+	// Aliased transient textures share the state of their physical texture.
+	void ER_RenderGraph::ComputeBarriers()
+	{
+		const int unknownState = -1;
+		std::vector<int>& importedStates = mTempImportedStates;
+		std::vector<int>& physicalStates = mTempPhysicalStates;
+		importedStates.assign(mResourcesCount, unknownState);
+		physicalStates.assign(mPool.size(), unknownState);
+
+		for (UINT passIndex = 0; passIndex < mPassesCount; passIndex++)
+		{
+			Pass& pass = mPasses[passIndex];
+			pass.BarriersStart = static_cast<UINT>(mBarriers.size());
+			pass.BarriersCount = 0;
+			if (pass.IsCulled)
+				continue;
+
+			for (const Access& access : pass.Accesses)
+			{
+				const Resource& resource = mResources[access.Resource];
+				int& currentState = resource.ImportedTexture ? importedStates[access.Resource] : physicalStates[resource.PhysicalIndex];
+				if (currentState == static_cast<int>(access.State))
+					continue;
+
+				currentState = static_cast<int>(access.State);
+				mBarriers.push_back({ access.Resource, access.State });
+				pass.BarriersCount++;
+			}
+		}
+	}
+
+	void ER_RenderGraph::Execute(ER_RHI* aRHI)
+	{
+		assert(aRHI);
+		assert(mIsCompiled);
+
+		for (int i = 0; i < static_cast<int>(mPool.size()); i++)
+		{
+			PhysicalTexture& physical = mPool[i];
+			if (physical.Texture || physical.LastPass < 0)
+				continue;
+
+			physical.Texture = aRHI->CreateGPUTexture(L"ER_RHI_GPUTexture: Render Graph Transient #" + std::to_wstring(i));
+			physical.Texture->CreateGPUTextureResource(aRHI, physical.Desc.Width, physical.Desc.Height, 1u, physical.Desc.Format, physical.Desc.BindFlags, physical.Desc.Mips);
+		}
+
+		for (UINT passIndex = 0; passIndex < mPassesCount; passIndex++)
+		{
+			Pass& pass = mPasses[passIndex];
+			if (pass.IsCulled)
+				continue;
+
+			aRHI->BeginEventTag(pass.EventName);
+
+			if (pass.BarriersCount > 0)
+			{
+				mBarrierResources.clear();
+				mBarrierStates.clear();
+				for (UINT i = pass.BarriersStart; i < pass.BarriersStart + pass.BarriersCount; i++)
+				{
+					mBarrierResources.push_back(GetTexture(mBarriers[i].Resource));
+					mBarrierStates.push_back(mBarriers[i].State);
+				}
+				aRHI->TransitionResources(mBarrierResources, mBarrierStates);
+			}
+
+			if (pass.Execute.IsSet())
+				pass.Execute(aRHI, *this);
+
+			aRHI->EndEventTag();
+		}
+	}
+
+	ER_RHI_GPUTexture* ER_RenderGraph::GetTexture(ER_RenderGraphResource aResource) const
+	{
+		assert(aResource >= 0 && aResource < static_cast<int>(mResourcesCount));
+
+		const Resource& resource = mResources[aResource];
+		if (resource.ImportedTexture)
+			return resource.ImportedTexture;
+
+		assert(resource.PhysicalIndex >= 0); // transient texture of a culled pass or the graph is not compiled
+		return resource.PhysicalIndex >= 0 ? mPool[resource.PhysicalIndex].Texture : nullptr;
+	}
+
+	std::string ER_RenderGraph::DumpPlan() const
+	{
+		std::ostringstream plan;
+		plan << "[ER Render Graph] " << mStats.PassesCount << " passes (" << mStats.CulledPassesCount << " culled), "
+			<< mStats.TransientTexturesCount << " transient textures in " << mStats.PhysicalTexturesCount << " physical, "
+			<< mStats.BarriersCount << " barriers in " << mStats.BarrierBatchesCount << " batches\n";
+
+		if (!mIsCompiled)
+		{
+			plan << "  (not compiled)\n";
+			return plan.str();
+		}
+
+		for (int passIndex = 0; passIndex < static_cast<int>(mPassesCount); passIndex++)
+		{
+			const Pass& pass = mPasses[passIndex];
+			plan << "  #" << passIndex << " " << pass.Name;
+			if (pass.IsCulled)
+			{
+				plan << " [culled]\n";
+				continue;
+			}
+			plan << (pass.HasSideEffect ? " [side effect]\n" : "\n");
+
+			for (UINT i = pass.BarriersStart; i < pass.BarriersStart + pass.BarriersCount; i++)
+				plan << "      barrier: " << mResources[mBarriers[i].Resource].Name << " -> " << GetResourceStateName(mBarriers[i].State) << "\n";
+
+			for (const Access& access : pass.Accesses)
+			{
+				plan << "      " << (access.IsRead ? (access.IsWrite ? "read/write: " : "read: ") : "write: ") << mResources[access.Resource].Name;
+				if (!mResources[access.Resource].ImportedTexture)
+					plan << " (physical #" << mResources[access.Resource].PhysicalIndex << ")";
+				plan << "\n";
+			}
+		}
+
+		for (UINT i = 0; i < mResourcesCount; i++)
+		{
+			const Resource& resource = mResources[i];
+			if (resource.ImportedTexture)
+				continue;
+
+			plan << "  transient " << resource.Name << " " << resource.Desc.Width << "x" << resource.Desc.Height;
+			if (resource.FirstPass < 0)
+				plan << ": unused\n";
+			else
+				plan << ": passes #" << resource.FirstPass << "-#" << resource.LastPass << " -> physical #" << resource.PhysicalIndex << "\n";
+		}
+
+		return plan.str();
+	}
+
+	void ER_RenderGraph::ReleasePool()
+	{
+		for (PhysicalTexture& physical : mPool)
+			DeleteObject(physical.Texture);
+		mPool.clear();
+	}
+
+	bool ER_RenderGraph::RunTests()
+	{
+		UINT passedCount = 0;
+		UINT failedCount = 0;
+		auto check = [&](bool aCondition, const std::string& aName)
+		{
+			if (aCondition)
+				passedCount++;
+			else
+			{
+				failedCount++;
+				ER_OUTPUT_LOG(ER_Utility::ToWideString("[ER Logger][ER_RenderGraph] Test FAILED: " + aName + "\n").c_str());
+			}
+		};
+
+		// imported textures are never dereferenced by Compile(), so we only need unique addresses
+		UINT8 importedTexturesStorage[2];
+		ER_RHI_GPUTexture* depthTexture = reinterpret_cast<ER_RHI_GPUTexture*>(&importedTexturesStorage[0]);
+		ER_RHI_GPUTexture* finalTexture = reinterpret_cast<ER_RHI_GPUTexture*>(&importedTexturesStorage[1]);
+
+		ER_RenderGraphTextureDesc desc;
+		desc.Width = 64;
+		desc.Height = 64;
+		desc.Format = ER_FORMAT_R16G16B16A16_FLOAT;
+		desc.BindFlags = ER_BIND_SHADER_RESOURCE | ER_BIND_RENDER_TARGET;
+
+		ER_RenderGraph graph;
+		int executedCount = 0;
+		ER_RenderGraphResource depth, gbuffer, lighting, debug, bloom, finalTarget;
+		auto declareGraph = [&]()
+		{
+			depth = graph.ImportTexture("Depth", depthTexture);
+			finalTarget = graph.ImportTexture("Final", finalTexture);
+			gbuffer = graph.CreateTexture("GBuffer", desc);
+			lighting = graph.CreateTexture("Lighting", desc);
+			debug = graph.CreateTexture("Debug", desc);
+			bloom = graph.CreateTexture("Bloom", desc);
+			graph.MarkOutput(finalTarget);
+
+			auto execute = [&executedCount](ER_RHI*, const ER_RenderGraph&) { executedCount++; };
+			graph.AddPass("GBuffer", [&](ER_RenderGraphBuilder& builder)
+			{
+				builder.Write(depth, ER_RESOURCE_STATE_DEPTH_WRITE);
+				builder.Write(gbuffer);
+			}, execute);
+			graph.AddPass("Debug overlay", [&](ER_RenderGraphBuilder& builder) // "Debug" is never read: culled
+			{
+				builder.Read(gbuffer);
+				builder.Write(debug);
+			}, execute);
+			graph.AddPass("Lighting", [&](ER_RenderGraphBuilder& builder)
+			{
+				builder.Read(gbuffer);
+				builder.Read(depth, ER_RESOURCE_STATE_DEPTH_READ);
+				builder.Write(lighting);
+			}, execute);
+			graph.AddPass("Bloom", [&](ER_RenderGraphBuilder& builder)
+			{
+				builder.Read(lighting);
+				builder.Write(bloom);
+			}, execute);
+			graph.AddPass("Composite", [&](ER_RenderGraphBuilder& builder)
+			{
+				builder.Read(lighting);
+				builder.Read(bloom);
+				builder.Write(finalTarget);
+			}, execute);
+			graph.AddPass("Profiler", [&](ER_RenderGraphBuilder& builder)
+			{
+				builder.SetSideEffect();
+			}, execute);
+			graph.AddPass("Debug copy", [&](ER_RenderGraphBuilder& builder) // writes "Debug" after its last (culled) reader: culled
+			{
+				builder.Read(bloom);
+				builder.Write(debug);
+			}, execute);
+		};
+
+		// "GBuffer" (passes #0-#2) and "Bloom" (#3-#4) do not overlap and must share a physical texture, "Lighting" (#2-#4) overlaps both
+		auto checkGraph = [&](const std::string& aSuffix)
+		{
+			const ER_RenderGraphStats& stats = graph.GetStats();
+			check(stats.PassesCount == 7 && stats.CulledPassesCount == 2, "passes are culled " + aSuffix);
+			check(graph.mPasses[1].IsCulled && graph.mPasses[6].IsCulled, "passes without readers are culled " + aSuffix);
+			check(!graph.mPasses[0].IsCulled && !graph.mPasses[2].IsCulled && !graph.mPasses[3].IsCulled && !graph.mPasses[4].IsCulled,
+				"passes that lead to an output are live " + aSuffix);
+			check(!graph.mPasses[5].IsCulled, "passes with a side effect are live " + aSuffix);
+
+			check(stats.TransientTexturesCount == 3 && stats.PhysicalTexturesCount == 2, "transient textures are aliased " + aSuffix);
+			check(graph.mResources[gbuffer].PhysicalIndex >= 0 && graph.mResources[gbuffer].PhysicalIndex == graph.mResources[bloom].PhysicalIndex,
+				"non-overlapping lifetimes share a physical texture " + aSuffix);
+			check(graph.mResources[lighting].PhysicalIndex >= 0 && graph.mResources[lighting].PhysicalIndex != graph.mResources[gbuffer].PhysicalIndex,
+				"overlapping lifetimes do not share a physical texture " + aSuffix);
+			check(graph.mResources[debug].PhysicalIndex == -1, "textures of culled passes are not allocated " + aSuffix);
+
+			// #0: depth, gbuffer; #2: gbuffer, depth, lighting; #3: lighting, bloom (aliased with gbuffer); #4: bloom, final ("Lighting" is already readable)
+			check(stats.BarriersCount == 9 && stats.BarrierBatchesCount == 4, "barriers are batched per pass " + aSuffix);
+			check(graph.mPasses[4].BarriersCount == 2, "redundant barriers are skipped " + aSuffix);
+		};
+
+		declareGraph();
+		graph.Compile();
+		checkGraph("(first frame)");
+
+		for (UINT i = 0; i < graph.mPassesCount; i++)
+			graph.mPasses[i].Execute(nullptr, graph);
+		check(executedCount == 7, "execute callbacks are stored");
+
+		// the next frame reuses the storage of the passes, the resources and the pooled textures
+		const Pass* passesStorage = graph.mPasses.data();
+		const size_t poolSize = graph.mPool.size();
+		graph.Reset();
+		declareGraph();
+		graph.Compile();
+		checkGraph("(second frame)");
+		check(graph.mPasses.data() == passesStorage && graph.mPasses.size() == 7 && graph.mResources.size() == 6, "passes and resources are reused");
+		check(graph.mPool.size() == poolSize, "pooled textures are reused");
+
+		// smaller frame: the leftover storage of the previous frame must be ignored
+		graph.Reset();
+		const ER_RenderGraphResource onlyFinal = graph.ImportTexture("Final", finalTexture);
+		graph.MarkOutput(onlyFinal);
+		graph.AddPass("Clear", [&](ER_RenderGraphBuilder& builder) { builder.Write(onlyFinal); }, [](ER_RHI*, const ER_RenderGraph&) {});
+		graph.Compile();
+		check(graph.GetStats().PassesCount == 1 && graph.GetStats().CulledPassesCount == 0 && graph.GetStats().TransientTexturesCount == 0 &&
+			graph.GetStats().BarriersCount == 1, "smaller frame ignores the previous passes");
+
+		const std::string message = "[ER Logger][ER_RenderGraph] Tests: " + std::to_string(passedCount) + " passed, " + std::to_string(failedCount) + " failed\n";
+		ER_OUTPUT_LOG(ER_Utility::ToWideString(message).c_str());
+		return failedCount == 0;
+	}
+}
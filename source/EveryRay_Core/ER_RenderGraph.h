@@ -0,0 +1,242 @@
+#pragma once
+#include "Common.h"
+#include "RHI/ER_RHI.h"
+
+#include <new>
+#include <type_traits>
+
+#define ER_RENDER_GRAPH_INVALID_RESOURCE -1
+#define ER_RENDER_GRAPH_POOL_RETIRE_FRAMES 120 // pooled transient textures that were not used for this many frames are released
+#define ER_RENDER_GRAPH_EXECUTE_CALLBACK_SIZE 128 // max size of the captures of a pass' execute lambda (stored inside of the pass)
+
+namespace EveryRay_Core
+{
+	class ER_RenderGraph;
+
+	typedef int ER_RenderGraphResource; // index of a texture declared in the current frame's graph
+
+	struct ER_RenderGraphTextureDesc
+	{
+		UINT Width = 0;
+		UINT Height = 0;
+		ER_RHI_FORMAT Format = ER_FORMAT_UNKNOWN;
+		ER_RHI_BIND_FLAG BindFlags = ER_BIND_NONE;
+		UINT Mips = 1;
+
+		bool operator==(const ER_RenderGraphTextureDesc& aOther) const
+		{
+			return Width == aOther.Width && Height == aOther.Height && Format == aOther.Format && BindFlags == aOther.BindFlags && Mips == aOther.Mips;
+		}
+	};
+
+	// Results of the last ER_RenderGraph::Compile()
+	struct ER_RenderGraphStats
+	{
+		UINT PassesCount = 0;
+		UINT CulledPassesCount = 0;
+		UINT TransientTexturesCount = 0; // declared and used by live passes
+		UINT PhysicalTexturesCount = 0; // pooled textures backing them (after aliasing)
+		UINT BarriersCount = 0;
+		UINT BarrierBatchesCount = 0; // one TransitionResources() call per pass that needs barriers
+	};
+
+	// Passed to the setup callback of a pass: declares what the pass reads and writes and in which state it expects the resources
+	class ER_RenderGraphBuilder
+	{
+	public:
+		void Read(ER_RenderGraphResource aResource, ER_RHI_RESOURCE_STATE aState = ER_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+		void Write(ER_RenderGraphResource aResource, ER_RHI_RESOURCE_STATE aState = ER_RESOURCE_STATE_RENDER_TARGET);
+		void SetSideEffect(); // never culled (i.e., writes to the main RT or to resources that are not in the graph)
+	private:
+		friend class ER_RenderGraph;
+		ER_RenderGraphBuilder(ER_RenderGraph& aGraph, int aPassIndex) : mGraph(aGraph), mPassIndex(aPassIndex) {}
+
+		ER_RenderGraph& mGraph;
+		int mPassIndex;
+	};
+
+	// Type-erased execute callback of a pass, stored in place (unlike std::function, it never allocates, and the passes' storage is reused between frames)
+	class ER_RenderGraphExecuteCallback
+	{
+	public:
+		ER_RenderGraphExecuteCallback() {}
+		ER_RenderGraphExecuteCallback(ER_RenderGraphExecuteCallback&& aOther) noexcept { MoveFrom(aOther); }
+		ER_RenderGraphExecuteCallback& operator=(ER_RenderGraphExecuteCallback&& aOther) noexcept
+		{
+			if (this != &aOther)
+			{
+				Reset();
+				MoveFrom(aOther);
+			}
+			return *this;
+		}
+		~ER_RenderGraphExecuteCallback() { Reset(); }
+
+		template<typename Func>
+		void Set(Func&& aFunc)
+		{
+			typedef typename std::decay<Func>::type FuncType;
+			static_assert(sizeof(FuncType) <= ER_RENDER_GRAPH_EXECUTE_CALLBACK_SIZE, "Captures of the pass are too big, bump ER_RENDER_GRAPH_EXECUTE_CALLBACK_SIZE");
+			static_assert(alignof(FuncType) <= alignof(double), "Captures of the pass are over-aligned");
+
+			Reset();
+			new (mStorage) FuncType(std::forward<Func>(aFunc));
+			mInvoke = [](void* aStorage, ER_RHI* aRHI, const ER_RenderGraph& aGraph) { (*static_cast<FuncType*>(aStorage))(aRHI, aGraph); };
+			mMove = [](void* aDestination, void* aSource) { new (aDestination) FuncType(std::move(*static_cast<FuncType*>(aSource))); static_cast<FuncType*>(aSource)->~FuncType(); };
+			mDestroy = [](void* aStorage) { static_cast<FuncType*>(aStorage)->~FuncType(); };
+		}
+		void Reset()
+		{
+			if (mDestroy)
+				mDestroy(mStorage);
+			mInvoke = nullptr;
+			mMove = nullptr;
+			mDestroy = nullptr;
+		}
+
+		bool IsSet() const { return mInvoke != nullptr; }
+		void operator()(ER_RHI* aRHI, const ER_RenderGraph& aGraph) { mInvoke(mStorage, aRHI, aGraph); }
+	private:
+		ER_RenderGraphExecuteCallback(const ER_RenderGraphExecuteCallback& rhs);
+		ER_RenderGraphExecuteCallback& operator=(const ER_RenderGraphExecuteCallback& rhs);
+
+		void MoveFrom(ER_RenderGraphExecuteCallback& aOther)
+		{
+			if (aOther.mMove)
+				aOther.mMove(mStorage, aOther.mStorage);
+			mInvoke = aOther.mInvoke;
+			mMove = aOther.mMove;
+			mDestroy = aOther.mDestroy;
+			aOther.mInvoke = nullptr;
+			aOther.mMove = nullptr;
+			aOther.mDestroy = nullptr;
+		}
+
+		alignas(double) UINT8 mStorage[ER_RENDER_GRAPH_EXECUTE_CALLBACK_SIZE];
+		void(*mInvoke)(void*, ER_RHI*, const ER_RenderGraph&) = nullptr;
+		void(*mMove)(void*, void*) = nullptr;
+		void(*mDestroy)(void*) = nullptr;
+	};
+
+	// Declarative frame graph: systems add passes with their reads/writes, then the graph is compiled and executed in the order of declaration.
+	// Passes and resources of the previous frame are reused in place (names, accesses and callbacks keep their storage), so declaring
+	// a frame with the same shape as the previous one does not allocate.
+	// Compile() does not touch the RHI (can be run and dumped without a GPU):
+	//  - culls the passes whose writes are never read by a live pass (and are not outputs),
+	//  - computes the lifetimes of the transient textures and aliases the ones with non-overlapping lifetimes and the same description,
+	//  - computes the state transitions of every pass, which are then issued in one batched TransitionResources() call before the pass.
+	// Bind calls inside the passes still transition the resources, but they become no-ops for the states that the graph has already set.
+	class ER_RenderGraph
+	{
+	public:
+		ER_RenderGraph();
+		~ER_RenderGraph();
+
+		// Starts declaring a new frame (the pool of transient textures is kept)
+		void Reset();
+
+		// Names are copied into the reused storage of the graph (build dynamic names once, outside of the frame)
+		ER_RenderGraphResource ImportTexture(const char* aName, ER_RHI_GPUTexture* aTexture);
+		ER_RenderGraphResource CreateTexture(const char* aName, const ER_RenderGraphTextureDesc& aDesc);
+		// aSetup(ER_RenderGraphBuilder&) is called immediately, aExecute(ER_RHI*, const ER_RenderGraph&) is stored in the pass
+		template<typename SetupFunc, typename ExecuteFunc>
+		void AddPass(const char* aName, const SetupFunc& aSetup, ExecuteFunc&& aExecute)
+		{
+			const int passIndex = BeginPass(aName);
+			mPasses[passIndex].Execute.Set(std::forward<ExecuteFunc>(aExecute));
+
+			ER_RenderGraphBuilder builder(*this, passIndex);
+			aSetup(builder);
+		}
+		void MarkOutput(ER_RenderGraphResource aResource);
+
+		void Compile();
+		void Execute(ER_RHI* aRHI);
+
+		// Valid for imported textures at any time and for transient ones during Execute()
+		ER_RHI_GPUTexture* GetTexture(ER_RenderGraphResource aResource) const;
+
+		std::string DumpPlan() const;
+		const ER_RenderGraphStats& GetStats() const { return mStats; }
+
+		void ReleasePool();
+
+		// Compiles small known graphs (without the RHI) and checks the culled passes, the aliasing of the transient textures and the barriers.
+		// Results are written to the log.
+		static bool RunTests();
+	private:
+		friend class ER_RenderGraphBuilder;
+
+		struct Access
+		{
+			ER_RenderGraphResource Resource;
+			ER_RHI_RESOURCE_STATE State;
+			bool IsRead;
+			bool IsWrite;
+		};
+
+		struct Pass
+		{
+			std::string Name;
+			std::string EventName; // "EveryRay: " + Name
+			std::vector<Access> Accesses;
+			ER_RenderGraphExecuteCallback Execute;
+			bool HasSideEffect = false;
+			bool IsCulled = false;
+			UINT BarriersStart = 0;
+			UINT BarriersCount = 0;
+		};
+
+		struct Resource
+		{
+			std::string Name;
+			ER_RenderGraphTextureDesc Desc;
+			ER_RHI_GPUTexture* ImportedTexture = nullptr; // nullptr for transient textures
+			int PhysicalIndex = -1; // in mPool (transient textures only)
+			int FirstPass = -1; // lifetime (live passes only)
+			int LastPass = -1;
+			bool IsOutput = false;
+		};
+
+		struct PhysicalTexture
+		{
+			ER_RenderGraphTextureDesc Desc;
+			ER_RHI_GPUTexture* Texture = nullptr; // created in Execute()
+			int LastPass = -1; // end of the last lifetime assigned in the current frame
+			UINT64 LastUsedFrame = 0;
+		};
+
+		struct Barrier
+		{
+			ER_RenderGraphResource Resource;
+			ER_RHI_RESOURCE_STATE State;
+		};
+
+		int BeginPass(const char* aName);
+		ER_RenderGraphResource AddResource(const char* aName);
+		void AddAccess(int aPassIndex, ER_RenderGraphResource aResource, ER_RHI_RESOURCE_STATE aState, bool aIsWrite);
+		void CullPasses();
+		void ComputeLifetimes();
+		void AliasTransientTextures();
+		void ComputeBarriers();
+
+		std::vector<Pass> mPasses; // only the first mPassesCount are in the current frame, the rest is kept for reuse
+		std::vector<Resource> mResources; // only the first mResourcesCount are in the current frame
+		UINT mPassesCount = 0;
+		UINT mResourcesCount = 0;
+		std::vector<PhysicalTexture> mPool;
+		std::vector<Barrier> mBarriers; // all passes, ranges in Pass::BarriersStart/Count
+
+		// scratch of Compile() and Execute() (batched transitions)
+		std::vector<bool> mTempNeededResources;
+		std::vector<int> mTempTransientResources;
+		std::vector<int> mTempImportedStates;
+		std::vector<int> mTempPhysicalStates;
+		std::vector<ER_RHI_GPUResource*> mBarrierResources;
+		std::vector<ER_RHI_RESOURCE_STATE> mBarrierStates;
+
+		ER_RenderGraphStats mStats;
+		UINT64 mFrameIndex = 0;
+		bool mIsCompiled = false;
+	};
+}
@@ -50,6 +50,7 @@ namespace EveryRay_Core
 			ER_Material::CreatePixelShader("content\\shaders\\ForwardLighting.hlsl");
 
 		mConstantBuffer.Initialize(ER_Material::GetCore()->GetRHI(), "ER_RHI_GPUBuffer: RenderToLightProbeMaterial CB");
+		ZeroMemory(&mConstantBuffer.Data.ClusteredLighting, sizeof(mConstantBuffer.Data.ClusteredLighting));
 	}
 
 	ER_RenderToLightProbeMaterial::~ER_RenderToLightProbeMaterial()
@@ -79,14 +80,14 @@ namespace EveryRay_Core
 		rhi->SetConstantBuffers(ER_VERTEX, { mConstantBuffer.Buffer(), aObj->GetObjectsConstantBuffer().Buffer() }, 0, rs, RENDERTOLIGHTPROBE_MAT_ROOT_DESCRIPTOR_TABLE_CBV_INDEX);
 		rhi->SetConstantBuffers(ER_PIXEL,  { mConstantBuffer.Buffer(), aObj->GetObjectsConstantBuffer().Buffer() }, 0, rs, RENDERTOLIGHTPROBE_MAT_ROOT_DESCRIPTOR_TABLE_CBV_INDEX);
 
-		std::vector<ER_RHI_GPUResource*> resources;
-		resources.push_back(aObj->GetTextureData(meshIndex).AlbedoMap);
-		resources.push_back(aObj->GetTextureData(meshIndex).NormalMap);
-		resources.push_back(aObj->GetTextureData(meshIndex).MetallicMap);
-		resources.push_back(aObj->GetTextureData(meshIndex).RoughnessMap);
-		resources.push_back(aObj->GetTextureData(meshIndex).HeightMap);
+		ER_RHI_GPUResource* resources[5 + NUM_SHADOW_CASCADES] = {};
+		resources[0] = aObj->GetTextureData(meshIndex).AlbedoMap;
+		resources[1] = aObj->GetTextureData(meshIndex).NormalMap;
+		resources[2] = aObj->GetTextureData(meshIndex).MetallicMap;
+		resources[3] = aObj->GetTextureData(meshIndex).RoughnessMap;
+		resources[4] = aObj->GetTextureData(meshIndex).HeightMap;
 		for (int i = 0; i < NUM_SHADOW_CASCADES; i++)
-			resources.push_back(neededSystems.mShadowMapper->GetShadowTexture(i));
+			resources[5 + i] = neededSystems.mShadowMapper->GetShadowTexture(i);
 		rhi->SetShaderResources(ER_PIXEL, resources, 0, rs, RENDERTOLIGHTPROBE_MAT_ROOT_DESCRIPTOR_TABLE_SRV_INDEX);
 
 		rhi->SetSamplers(ER_PIXEL, { ER_RHI_SAMPLER_STATE::ER_TRILINEAR_WRAP, ER_RHI_SAMPLER_STATE::ER_SHADOW_SS });
@@ -1,5 +1,6 @@
 #pragma once
 #include "ER_Material.h"
+#include "ER_ClusteredLighting.h"
 
 #define RENDERTOLIGHTPROBE_MAT_ROOT_DESCRIPTOR_TABLE_SRV_INDEX 0
 #define RENDERTOLIGHTPROBE_MAT_ROOT_DESCRIPTOR_TABLE_CBV_INDEX 1
@@ -20,6 +21,7 @@ namespace EveryRay_Core
 			XMFLOAT4 SunDirection;
 			XMFLOAT4 SunColor;
 			XMFLOAT4 CameraPosition;
+			ClusteredLightingCBufferData::ClusteredLightingParams ClusteredLighting; // not used in the probes (lights count is 0)
 		};
 	}
 	class ER_RenderToLightProbeMaterial : public ER_Material
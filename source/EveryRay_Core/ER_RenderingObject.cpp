@@ -15,26 +15,31 @@
 #include "ER_Camera.h"
 #include "ER_MatrixHelper.h"
 #include "ER_Terrain.h"
-#include "ER_Settings.h"
+#include "ER_AssetRegistry.h"
+#include "ER_ShadowMapper.h"
+#include "ER_Frustum.h"
+#include "ER_GPUInstanceCuller.h"
 
 namespace EveryRay_Core
 {
 	static int currentSplatChannnel = (int)TerrainSplatChannels::NONE;
 
-	ER_RenderingObject::ER_RenderingObject(const std::string& pName, int index, ER_Core& pCore, ER_Camera& pCamera, std::unique_ptr<ER_Model> pModel, bool availableInEditor, bool isInstanced)
+	ER_RenderingObject::ER_RenderingObject(const std::string& pName, int index, ER_Core& pCore, ER_Camera& pCamera, const std::string& pModelPath, bool availableInEditor, bool isInstanced)
 		:
 		mCore(&pCore),
 		mCamera(pCamera),
-		mModel(std::move(pModel)),
 		mMeshesReflectionFactors(0),
 		mName(pName),
 		mDebugGizmoAABB(nullptr),
 		mAvailableInEditorMode(availableInEditor),
 		mTransformationMatrix(XMMatrixIdentity()),
 		mIsInstanced(isInstanced),
-		mIndexInScene(index),
-		mCurrentTextureQuality((RenderingObjectTextureQuality)ER_Settings::TexturesQuality)
+		mIndexInScene(index)
 	{
+		mAssetRegistry = (ER_AssetRegistry*)mCore->GetServices().FindService(ER_AssetRegistry::TypeIdClass());
+		assert(mAssetRegistry);
+
+		mModel = mAssetRegistry->AcquireModel(pModelPath);
 		if (!mModel)
 		{
 			std::string message = "Failed to create a RenderingObject from a model: ";
@@ -43,13 +48,10 @@ namespace EveryRay_Core
 		}
 
 		mMeshesCount.push_back(0); // main LOD
-		mMeshVertices.push_back({}); // main LOD
-		mMeshAllVertices.push_back({}); // main LOD
 
-		mMeshesCount[0] = mModel->Meshes().size();
+		mMeshesCount[0] = GetModel().Meshes().size();
 		for (size_t i = 0; i < mMeshesCount[0]; i++)
 		{
-			mMeshVertices[0].push_back(mModel->GetMesh(i).Vertices());
 			mMeshesTextureBuffers.push_back(TextureData());
 			mMeshesReflectionFactors.push_back(0.0f);
 
@@ -61,16 +63,8 @@ namespace EveryRay_Core
 			mCustomReflectionMaskTextures.push_back("");
 		}
 
-		for (size_t i = 0; i < mMeshVertices[0].size(); i++)
-		{
-			for (size_t j = 0; j < mMeshVertices[0][i].size(); j++)
-			{
-				mMeshAllVertices[0].push_back(mMeshVertices[0][i][j]);
-			}
-		}
-
 		LoadAssignedMeshTextures();
-		mLocalAABB = mModel->GenerateAABB();
+		mLocalAABB = GetModel().GenerateAABB();
 		mGlobalAABB = mLocalAABB;
 
 		if (mAvailableInEditorMode) {
@@ -92,20 +86,34 @@ namespace EveryRay_Core
 			DeleteObject(object.second);
 		mMaterials.clear();
 
-		for (int lodI = 0; lodI < GetLODCount(); lodI++)
+		DeletePointerCollection(mLODsInstanceBuffers);
+		DeleteObject(mGPUCulledInstances);
+		for (int cascade = 0; cascade < NUM_SHADOW_CASCADES; cascade++)
+			DeleteObject(mShadowCascadesInstanceBuffers[cascade]);
+		for (int cascade = 0; cascade < NUM_VOXEL_GI_CASCADES; cascade++)
+			DeleteObject(mVoxelCascadesInstanceBuffers[cascade]);
+		mMeshRenderBuffers.clear();
+
+		for (auto& textureData : mMeshesTextureBuffers)
 		{
-			for (int meshI = 0; meshI < GetMeshCount(lodI); meshI++)
-			{
-				DeleteObject(mMeshRenderBuffers[lodI][meshI]);
-			}
+			mAssetRegistry->ReleaseTexture(&textureData.AlbedoMap);
+			mAssetRegistry->ReleaseTexture(&textureData.NormalMap);
+			mAssetRegistry->ReleaseTexture(&textureData.SpecularMap);
+			mAssetRegistry->ReleaseTexture(&textureData.RoughnessMap);
+			mAssetRegistry->ReleaseTexture(&textureData.MetallicMap);
+			mAssetRegistry->ReleaseTexture(&textureData.HeightMap);
+			mAssetRegistry->ReleaseTexture(&textureData.ReflectionMaskMap);
+			mAssetRegistry->ReleaseTexture(&textureData.ExtraMap2);
+			mAssetRegistry->ReleaseTexture(&textureData.ExtraMap3);
 		}
-
-		for (auto& meshesInstanceBuffersLOD : mMeshesInstanceBuffers)
-			DeletePointerCollection(meshesInstanceBuffersLOD);
-		mMeshesInstanceBuffers.clear();
-
 		mMeshesTextureBuffers.clear();
 
+		for (auto& modelLOD : mModelLODs)
+			mAssetRegistry->ReleaseModel(modelLOD);
+		mModelLODs.clear();
+		mAssetRegistry->ReleaseModel(mModel);
+		mModel = nullptr;
+
 		DeleteObject(mDebugGizmoAABB);
 		DeleteObject(mInputPositionsOnTerrainBuffer);
 		DeleteObject(mOutputPositionsOnTerrainBuffer);
@@ -118,6 +126,10 @@ namespace EveryRay_Core
 	{
 		assert(pMaterial);
 		mMaterials.emplace(materialName, pMaterial);
+
+		// shadow map materials are loaded per cascade ("<name> <cascade index>")
+		if (materialName.compare(0, ER_MaterialHelper::shadowMapMaterialName.length(), ER_MaterialHelper::shadowMapMaterialName) == 0)
+			mIsShadowCaster = true;
 	}
 
 	void ER_RenderingObject::LoadAssignedMeshTextures()
@@ -125,7 +137,7 @@ namespace EveryRay_Core
 		auto pathBuilder = [&](std::wstring relativePath)
 		{
 			std::string fullPath;
-			ER_Utility::GetDirectory(mModel->GetFileName(), fullPath);
+			ER_Utility::GetDirectory(GetModel().GetFileName(), fullPath);
 			fullPath += "/";
 			std::wstring resultPath;
 			ER_Utility::ToWideString(fullPath, resultPath);
@@ -135,9 +147,9 @@ namespace EveryRay_Core
 
 		for (size_t i = 0; i < mMeshesCount[0]; i++)
 		{
-			if (mModel->GetMesh(i).GetMaterial().HasTexturesOfType(TextureType::TextureTypeDifffuse))
+			if (GetModel().GetMesh(i).GetMaterial().HasTexturesOfType(TextureType::TextureTypeDifffuse))
 			{
-				const std::vector<std::wstring>& texturesAlbedo = mModel->GetMesh(i).GetMaterial().GetTexturesByType(TextureType::TextureTypeDifffuse);
+				const std::vector<std::wstring>& texturesAlbedo = GetModel().GetMesh(i).GetMaterial().GetTexturesByType(TextureType::TextureTypeDifffuse);
 				if (texturesAlbedo.size() != 0)
 				{
 					std::wstring result = pathBuilder(texturesAlbedo.at(0));
@@ -149,9 +161,9 @@ namespace EveryRay_Core
 			else
 				LoadTexture(TextureType::TextureTypeDifffuse, ER_Utility::GetFilePath(L"content\\textures\\emptyDiffuseMap.png"), i, true);
 
-			if (mModel->GetMesh(i).GetMaterial().HasTexturesOfType(TextureType::TextureTypeNormalMap))
+			if (GetModel().GetMesh(i).GetMaterial().HasTexturesOfType(TextureType::TextureTypeNormalMap))
 			{
-				const std::vector<std::wstring>& texturesNormal = mModel->GetMesh(i).GetMaterial().GetTexturesByType(TextureType::TextureTypeNormalMap);
+				const std::vector<std::wstring>& texturesNormal = GetModel().GetMesh(i).GetMaterial().GetTexturesByType(TextureType::TextureTypeNormalMap);
 				if (texturesNormal.size() != 0)
 				{
 					std::wstring result = pathBuilder(texturesNormal.at(0));
@@ -163,9 +175,9 @@ namespace EveryRay_Core
 			else
 				LoadTexture(TextureType::TextureTypeNormalMap, ER_Utility::GetFilePath(L"content\\textures\\emptyNormalMap.jpg"), i, true);
 
-			if (mModel->GetMesh(i).GetMaterial().HasTexturesOfType(TextureType::TextureTypeSpecularMap))
+			if (GetModel().GetMesh(i).GetMaterial().HasTexturesOfType(TextureType::TextureTypeSpecularMap))
 			{
-				const std::vector<std::wstring>& texturesSpec = mModel->GetMesh(i).GetMaterial().GetTexturesByType(TextureType::TextureTypeSpecularMap);
+				const std::vector<std::wstring>& texturesSpec = GetModel().GetMesh(i).GetMaterial().GetTexturesByType(TextureType::TextureTypeSpecularMap);
 				if (texturesSpec.size() != 0)
 				{
 					std::wstring result = pathBuilder(texturesSpec.at(0));
@@ -177,9 +189,9 @@ namespace EveryRay_Core
 			else
 				LoadTexture(TextureType::TextureTypeSpecularMap, ER_Utility::GetFilePath(L"content\\textures\\emptyRoughnessMap.png"), i, true);
 
-			if (mModel->GetMesh(i).GetMaterial().HasTexturesOfType(TextureType::TextureTypeSpecularPowerMap))
+			if (GetModel().GetMesh(i).GetMaterial().HasTexturesOfType(TextureType::TextureTypeSpecularPowerMap))
 			{
-				const std::vector<std::wstring>& texturesMetallic = mModel->GetMesh(i).GetMaterial().GetTexturesByType(TextureType::TextureTypeSpecularPowerMap);
+				const std::vector<std::wstring>& texturesMetallic = GetModel().GetMesh(i).GetMaterial().GetTexturesByType(TextureType::TextureTypeSpecularPowerMap);
 				if (texturesMetallic.size() != 0)
 				{
 					std::wstring result = pathBuilder(texturesMetallic.at(0));
@@ -197,8 +209,6 @@ namespace EveryRay_Core
 	void ER_RenderingObject::LoadCustomMeshTextures(int meshIndex)
 	{
 		assert(meshIndex < mMeshesCount[0]);
-		std::string errorMessage = mModel->GetFileName() + " of mesh index: " + std::to_string(meshIndex);
-
 		if (!mCustomAlbedoTextures[meshIndex].empty())
 			if (mCustomAlbedoTextures[meshIndex].back() != '\\')
 				LoadTexture(TextureType::TextureTypeDifffuse, ER_Utility::GetFilePath(ER_Utility::ToWideString(mCustomAlbedoTextures[meshIndex])), meshIndex);
@@ -230,234 +240,50 @@ namespace EveryRay_Core
 	}
 	
 	// This is main method for loading textures before going to RHI
-	// It supports quality levels, format check and different types of textures
-	// TODO: remove the duplicated code
+	// It supports quality levels and format check (in ER_AssetRegistry, where the textures are shared between all objects)
 	void ER_RenderingObject::LoadTexture(TextureType type, const std::wstring& path, int meshIndex, bool isPlaceholder)
 	{
-		ER_RHI* rhi = mCore->GetRHI();
-
-		const int extensionSymbolCount = 4; // .png, .dds, etc.
-		const int texQualityCount = RenderingObjectTextureQuality::OBJECT_TEXTURE_COUNT;
-		assert((int)mCurrentTextureQuality < texQualityCount);
-
-		const wchar_t* postfixQuality[RenderingObjectTextureQuality::OBJECT_TEXTURE_COUNT] =
-		{
-			 L"_lq",
-			 L"_mq",
-			 L"_hq"
-		};
-
-		std::wstring possiblePaths[RenderingObjectTextureQuality::OBJECT_TEXTURE_COUNT];
-
-		for (int i = 0; i < (int)RenderingObjectTextureQuality::OBJECT_TEXTURE_COUNT; i++)
-		{
-			possiblePaths[i] = path;
-			possiblePaths[i].insert(path.length() - extensionSymbolCount, std::wstring(postfixQuality[i]));
-		}
-
-		const wchar_t* postfixDDS = L".dds";
-		const wchar_t* postfixDDS_Capital = L".DDS";
-		const wchar_t* postfixTGA = L".tga";
-		const wchar_t* postfixTGA_Capital = L".TGA";
-		bool ddsLoader = (path.substr(path.length() - extensionSymbolCount) == std::wstring(postfixDDS)) || (path.substr(path.length() - extensionSymbolCount) == std::wstring(postfixDDS_Capital));
-		bool tgaLoader = (path.substr(path.length() - extensionSymbolCount) == std::wstring(postfixTGA)) || (path.substr(path.length() - extensionSymbolCount) == std::wstring(postfixTGA_Capital));
-		std::string errorMessage = mModel->GetFileName() + " of mesh index: " + std::to_string(meshIndex);
-
-		bool loadStatus = false;
+		ER_RHI_GPUTexture** texture = nullptr;
 		switch (type)
 		{
 		case TextureType::TextureTypeDifffuse:
-		{
-			mMeshesTextureBuffers[meshIndex].AlbedoMap = rhi->CreateGPUTexture(L"");
-			//we start traversing through different texture quality levels unless we hit the first one
-			for (int i = (int)mCurrentTextureQuality; i >= 0; i--)
-			{
-				mMeshesTextureBuffers[meshIndex].AlbedoMap->CreateGPUTextureResource(rhi, possiblePaths[i], true, false, true, &loadStatus, true);
-				if (loadStatus) // success
-					break;
-
-				if (!loadStatus && i <= 0) // after we traversed all possible levels, lets load the original path (maybe the texture does not have postfix)
-					mMeshesTextureBuffers[meshIndex].AlbedoMap->CreateGPUTextureResource(rhi, path, true);
-			}
-			if (!isPlaceholder)
-			{
-				rhi->GenerateMipsWithTextureReplacement(&mMeshesTextureBuffers[meshIndex].AlbedoMap,
-					[this, meshIndex](ER_RHI_GPUTexture** aNewTextureWithMips)
-					{
-						assert(*aNewTextureWithMips);
-						DeleteObject(mMeshesTextureBuffers[meshIndex].AlbedoMap);
-						mMeshesTextureBuffers[meshIndex].AlbedoMap = *aNewTextureWithMips;
-					}
-				);
-			}
+			texture = &mMeshesTextureBuffers[meshIndex].AlbedoMap;
 			break;
-		}
 		case TextureType::TextureTypeNormalMap:
-		{
-			mMeshesTextureBuffers[meshIndex].NormalMap = rhi->CreateGPUTexture(L"");
-			//we start traversing through different texture quality levels unless we hit the first one
-			for (int i = (int)mCurrentTextureQuality; i >= 0; i--)
-			{
-				mMeshesTextureBuffers[meshIndex].NormalMap->CreateGPUTextureResource(rhi, possiblePaths[i], true, false, true, &loadStatus, true);
-				if (loadStatus) // success
-					break;
-
-				if (!loadStatus && i <= 0) // after we traversed all possible levels, lets load the original path (maybe the texture does not have postfix)
-					mMeshesTextureBuffers[meshIndex].NormalMap->CreateGPUTextureResource(rhi, path, true);
-			}
-			if (!isPlaceholder)
-			{
-				rhi->GenerateMipsWithTextureReplacement(&mMeshesTextureBuffers[meshIndex].NormalMap,
-					[this, meshIndex](ER_RHI_GPUTexture** aNewTextureWithMips)
-					{
-						assert(*aNewTextureWithMips);
-						DeleteObject(mMeshesTextureBuffers[meshIndex].NormalMap);
-						mMeshesTextureBuffers[meshIndex].NormalMap = *aNewTextureWithMips;
-					}
-				);
-			}
+			texture = &mMeshesTextureBuffers[meshIndex].NormalMap;
 			break;
-		}
 		case TextureType::TextureTypeSpecularPowerMap:
-		{
-			mMeshesTextureBuffers[meshIndex].MetallicMap = rhi->CreateGPUTexture(L"");
-			//we start traversing through different texture quality levels unless we hit the first one
-			for (int i = (int)mCurrentTextureQuality; i >= 0; i--)
-			{
-				mMeshesTextureBuffers[meshIndex].MetallicMap->CreateGPUTextureResource(rhi, possiblePaths[i], true, false, true, &loadStatus, true);
-				if (loadStatus) // success
-					break;
-
-				if (!loadStatus && i <= 0) // after we traversed all possible levels, lets load the original path (maybe the texture does not have postfix)
-					mMeshesTextureBuffers[meshIndex].MetallicMap->CreateGPUTextureResource(rhi, path, true);
-			}
-			if (!isPlaceholder)
-			{
-				rhi->GenerateMipsWithTextureReplacement(&mMeshesTextureBuffers[meshIndex].MetallicMap,
-					[this, meshIndex](ER_RHI_GPUTexture** aNewTextureWithMips)
-					{
-						assert(*aNewTextureWithMips);
-						DeleteObject(mMeshesTextureBuffers[meshIndex].MetallicMap);
-						mMeshesTextureBuffers[meshIndex].MetallicMap = *aNewTextureWithMips;
-					}
-				);
-			}
-			break;	
-		}
+			texture = &mMeshesTextureBuffers[meshIndex].MetallicMap;
+			break;
 		case TextureType::TextureTypeSpecularMap:
-		{
-			mMeshesTextureBuffers[meshIndex].RoughnessMap = rhi->CreateGPUTexture(L"");
-			//we start traversing through different texture quality levels unless we hit the first one
-			for (int i = (int)mCurrentTextureQuality; i >= 0; i--)
-			{
-				mMeshesTextureBuffers[meshIndex].RoughnessMap->CreateGPUTextureResource(rhi, possiblePaths[i], true, false, true, &loadStatus, true);
-				if (loadStatus) // success
-					break;
-
-				if (!loadStatus && i <= 0) // after we traversed all possible levels, lets load the original path (maybe the texture does not have postfix)
-					mMeshesTextureBuffers[meshIndex].RoughnessMap->CreateGPUTextureResource(rhi, path, true);
-			}
-			if (!isPlaceholder)
-			{
-				rhi->GenerateMipsWithTextureReplacement(&mMeshesTextureBuffers[meshIndex].RoughnessMap,
-					[this, meshIndex](ER_RHI_GPUTexture** aNewTextureWithMips)
-					{
-						assert(*aNewTextureWithMips);
-						DeleteObject(mMeshesTextureBuffers[meshIndex].RoughnessMap);
-						mMeshesTextureBuffers[meshIndex].RoughnessMap = *aNewTextureWithMips;
-					}
-				);
-			}
+			texture = &mMeshesTextureBuffers[meshIndex].RoughnessMap;
 			break;
-		}
 		case TextureType::TextureTypeHeightmap:
-		{
-			mMeshesTextureBuffers[meshIndex].HeightMap = rhi->CreateGPUTexture(L"");
-			//we start traversing through different texture quality levels unless we hit the first one
-			for (int i = (int)mCurrentTextureQuality; i >= 0; i--)
-			{
-				mMeshesTextureBuffers[meshIndex].HeightMap->CreateGPUTextureResource(rhi, possiblePaths[i], true, false, true, &loadStatus, true);
-				if (loadStatus) // success
-					break;
-
-				if (!loadStatus && i <= 0) // after we traversed all possible levels, lets load the original path (maybe the texture does not have postfix)
-					mMeshesTextureBuffers[meshIndex].HeightMap->CreateGPUTextureResource(rhi, path, true);
-			}
-			if (!isPlaceholder)
-			{
-				rhi->GenerateMipsWithTextureReplacement(&mMeshesTextureBuffers[meshIndex].HeightMap,
-					[this, meshIndex](ER_RHI_GPUTexture** aNewTextureWithMips)
-					{
-						assert(*aNewTextureWithMips);
-						DeleteObject(mMeshesTextureBuffers[meshIndex].HeightMap);
-						mMeshesTextureBuffers[meshIndex].HeightMap = *aNewTextureWithMips;
-					}
-				);
-			}
-			break;	
-		}
+			texture = &mMeshesTextureBuffers[meshIndex].HeightMap;
+			break;
 		case TextureType::TextureTypeLightMap:
-		{
-			mMeshesTextureBuffers[meshIndex].ReflectionMaskMap = rhi->CreateGPUTexture(L"");
-			//we start traversing through different texture quality levels unless we hit the first one
-			for (int i = (int)mCurrentTextureQuality; i >= 0; i--)
-			{
-				mMeshesTextureBuffers[meshIndex].ReflectionMaskMap->CreateGPUTextureResource(rhi, possiblePaths[i], true, false, true, &loadStatus, true);
-				if (loadStatus) // success
-					break;
-
-				if (!loadStatus && i <= 0) // after we traversed all possible levels, lets load the original path (maybe the texture does not have postfix)
-					mMeshesTextureBuffers[meshIndex].ReflectionMaskMap->CreateGPUTextureResource(rhi, path, true);
-			}
-			if (!isPlaceholder)
-			{
-				rhi->GenerateMipsWithTextureReplacement(&mMeshesTextureBuffers[meshIndex].ReflectionMaskMap,
-					[this, meshIndex](ER_RHI_GPUTexture** aNewTextureWithMips)
-					{
-						assert(*aNewTextureWithMips);
-						DeleteObject(mMeshesTextureBuffers[meshIndex].ReflectionMaskMap);
-						mMeshesTextureBuffers[meshIndex].ReflectionMaskMap = *aNewTextureWithMips;
-					}
-				);
-			}
+			texture = &mMeshesTextureBuffers[meshIndex].ReflectionMaskMap;
 			break;
+		default:
+			return;
 		}
-		}
+
+		// i.e., a custom texture replaces the one assigned in the model
+		mAssetRegistry->ReleaseTexture(texture);
+		mAssetRegistry->AcquireTexture(path, isPlaceholder, texture);
 	}
 
-	//TODO refactor (remove duplicated code)
 	void ER_RenderingObject::LoadRenderBuffers(int lod)
 	{
 		assert(lod < GetLODCount());
 		assert(mModel);
-		ER_RHI* rhi = mCore->GetRHI();
 
 		mMeshRenderBuffers.push_back({});
 		assert(mMeshRenderBuffers.size() - 1 == lod);
 
-		auto createIndexBuffer = [this, rhi](const ER_Mesh& aMesh, int meshIndex, int lod) {
-			mMeshRenderBuffers[lod][meshIndex]->IndexBuffer = rhi->CreateGPUBuffer("ER_RHI_GPUBuffer: ER_RenderingObject - Index Buffer: " + mName + ", lod: " + std::to_string(lod) + ", mesh: " + std::to_string(meshIndex));
-			aMesh.CreateIndexBuffer(mMeshRenderBuffers[lod][meshIndex]->IndexBuffer);
-			mMeshRenderBuffers[lod][meshIndex]->IndicesCount = aMesh.Indices().size();
-		};
-
-		{
-			for (size_t i = 0; i < mMeshesCount[lod]; i++)
-			{
-				mMeshRenderBuffers[lod].push_back(new RenderBufferData());
-				mMeshRenderBuffers[lod][i]->VertexBuffer = rhi->CreateGPUBuffer("ER_RHI_GPUBuffer: ER_RenderingObject - Vertex Buffer: " + mName + ", lod: " + std::to_string(lod) + ", mesh: " + std::to_string(i));
-				
-				if (lod == 0)
-					mModel->GetMesh(i).CreateVertexBuffer_PositionUvNormalTangent(mMeshRenderBuffers[lod][i]->VertexBuffer);
-				else
-					mModelLODs[lod - 1]->GetMesh(i).CreateVertexBuffer_PositionUvNormalTangent(mMeshRenderBuffers[lod][i]->VertexBuffer);
-
-				createIndexBuffer((lod == 0) ? mModel->GetMesh(i) : mModelLODs[lod - 1]->GetMesh(i), i, lod);
-
-				mMeshRenderBuffers[lod][i]->Stride = sizeof(VertexPositionTextureNormalTangent);
-				mMeshRenderBuffers[lod][i]->Offset = 0;
-			}
-		}
+		// vertex/index buffers are created once per model file and shared between all objects that use it
+		mMeshRenderBuffers[lod] = mAssetRegistry->GetRenderBuffers((lod == 0) ? mModel : mModelLODs[lod - 1]);
+		assert(mMeshRenderBuffers[lod].size() == mMeshesCount[lod]);
 	}
 	
 	void ER_RenderingObject::Draw(const std::string& materialName, bool toDepth, int meshIndex) {
@@ -506,11 +332,16 @@ namespace EveryRay_Core
 			if (isForwardPass && mCore->GetLevel()->mIllumination)
 				mCore->GetLevel()->mIllumination->PreparePipelineForForwardLighting(this);
 
+			// instance counts are only known on the GPU (written by ER_GPUInstanceCuller), so we draw with indirect args
+			bool isGPUCulled = mIsInstanced && IsUsingGPUCulling() && mGPUCulledInstances && mGPUCulledInstances->IsCulled;
+
 			bool isSpecificMesh = (meshIndex != -1);
 			for (int i = (isSpecificMesh) ? meshIndex : 0; i < ((isSpecificMesh) ? meshIndex + 1 : mMeshesCount[lod]); i++)
 			{
-				if (mIsInstanced)
-					rhi->SetVertexBuffers({ mMeshRenderBuffers[lod][i]->VertexBuffer, mMeshesInstanceBuffers[lod][i]->InstanceBuffer });
+				if (isGPUCulled)
+					rhi->SetVertexBuffers({ mMeshRenderBuffers[lod][i]->VertexBuffer, mGPUCulledInstances->CulledInstancesVertexBuffer });
+				else if (mIsInstanced)
+					rhi->SetVertexBuffers({ mMeshRenderBuffers[lod][i]->VertexBuffer, mLODsInstanceBuffers[lod]->InstanceBuffer });
 				else
 					rhi->SetVertexBuffers({ mMeshRenderBuffers[lod][i]->VertexBuffer });
 				rhi->SetIndexBuffer(mMeshRenderBuffers[lod][i]->IndexBuffer);
@@ -525,7 +356,9 @@ namespace EveryRay_Core
 				else if (isForwardPass && mCore->GetLevel()->mIllumination)
 					mCore->GetLevel()->mIllumination->PrepareResourcesForForwardLighting(this, i);
 
-				if (mIsInstanced)
+				if (isGPUCulled)
+					rhi->DrawIndexedInstancedIndirect(mGPUCulledInstances->IndirectArgs, mGPUCulledInstances->GetArgsOffset(lod, i));
+				else if (mIsInstanced)
 				{
 					if (mInstanceCountToRender[lod] > 0)
 						rhi->DrawIndexedInstanced(mMeshRenderBuffers[lod][i]->IndicesCount, mInstanceCountToRender[lod], 0, 0, 0);
@@ -538,6 +371,71 @@ namespace EveryRay_Core
 		}
 	}
 
+	void ER_RenderingObject::DrawShadowCascade(const std::string& materialName, int meshIndex, int cascadeIndex)
+	{
+		assert(cascadeIndex < NUM_SHADOW_CASCADES);
+
+		if (!mIsRendered || !IsInShadowCascade(cascadeIndex) || mMaterials.find(materialName) == mMaterials.end())
+			return;
+		if (!mIsInstanced && mCurrentLODIndex == -1)
+			return;
+
+		const int lod = GetLODCount() - 1; // lowest LOD is enough for shadow maps
+		if (meshIndex >= mMeshesCount[lod] || mMeshRenderBuffers[lod].size() == 0)
+			return;
+
+		ER_RHI* rhi = mCore->GetRHI();
+		if (mIsInstanced)
+		{
+			rhi->SetVertexBuffers({ mMeshRenderBuffers[lod][meshIndex]->VertexBuffer, mShadowCascadesInstanceBuffers[cascadeIndex]->InstanceBuffer });
+			rhi->SetIndexBuffer(mMeshRenderBuffers[lod][meshIndex]->IndexBuffer);
+			rhi->DrawIndexedInstanced(mMeshRenderBuffers[lod][meshIndex]->IndicesCount, mShadowCascadesInstanceCountToRender[cascadeIndex], 0, 0, 0);
+		}
+		else
+		{
+			rhi->SetVertexBuffers({ mMeshRenderBuffers[lod][meshIndex]->VertexBuffer });
+			rhi->SetIndexBuffer(mMeshRenderBuffers[lod][meshIndex]->IndexBuffer);
+			rhi->DrawIndexed(mMeshRenderBuffers[lod][meshIndex]->IndicesCount);
+		}
+	}
+
+	void ER_RenderingObject::DrawVoxelCascade(const std::string& materialName, int meshIndex, int cascadeIndex)
+	{
+		assert(cascadeIndex < NUM_VOXEL_GI_CASCADES);
+
+		if (!mIsRendered || mMaterials.find(materialName) == mMaterials.end())
+			return;
+		if (mIsInstanced && (!mVoxelCascadesInstanceBuffers[cascadeIndex] || mVoxelCascadesInstanceCountToRender[cascadeIndex] == 0))
+			return;
+
+		const int lod = 0; // meshes of other LODs may not match the textures of the main LOD, which the voxelization material samples
+		if (meshIndex >= mMeshesCount[lod] || mMeshRenderBuffers[lod].size() == 0)
+			return;
+
+		ER_RHI* rhi = mCore->GetRHI();
+		if (mIsInstanced)
+		{
+			rhi->SetVertexBuffers({ mMeshRenderBuffers[lod][meshIndex]->VertexBuffer, mVoxelCascadesInstanceBuffers[cascadeIndex]->InstanceBuffer });
+			rhi->SetIndexBuffer(mMeshRenderBuffers[lod][meshIndex]->IndexBuffer);
+			rhi->DrawIndexedInstanced(mMeshRenderBuffers[lod][meshIndex]->IndicesCount, mVoxelCascadesInstanceCountToRender[cascadeIndex], 0, 0, 0);
+		}
+		else
+		{
+			rhi->SetVertexBuffers({ mMeshRenderBuffers[lod][meshIndex]->VertexBuffer });
+			rhi->SetIndexBuffer(mMeshRenderBuffers[lod][meshIndex]->IndexBuffer);
+			rhi->DrawIndexed(mMeshRenderBuffers[lod][meshIndex]->IndicesCount);
+		}
+	}
+
+	bool ER_RenderingObject::IsInShadowCascade(int cascadeIndex)
+	{
+		assert(cascadeIndex < NUM_SHADOW_CASCADES);
+		if (mIsInstanced)
+			return mShadowCascadesInstanceBuffers[cascadeIndex] && mShadowCascadesInstanceCountToRender[cascadeIndex] > 0;
+		else
+			return mIsInShadowCascades[cascadeIndex];
+	}
+
 	void ER_RenderingObject::DrawAABB(ER_RHI_GPUTexture* aRenderTarget, ER_RHI_GPUTexture* aDepth, ER_RHI_GPURootSignature* rs)
 	{
 		if (mIsSelected && mAvailableInEditorMode && mEnableAABBDebug && ER_Utility::IsEditorMode)
@@ -581,20 +479,27 @@ namespace EveryRay_Core
 		mInstanceCountToRender.push_back(0);
 		assert(lod == mInstanceCountToRender.size() - 1);
 
-		mMeshesInstanceBuffers.push_back({});
-		assert(lod == mMeshesInstanceBuffers.size() - 1);
-
 		//adding extra instance data until we reach MAX_INSTANCE_COUNT 
 		for (int i = mInstanceData[lod].size(); i < MAX_INSTANCE_COUNT; i++)
 			AddInstanceData(XMMatrixIdentity(), lod);
 
-		//mMeshesInstanceBuffers.clear();
-		for (size_t i = 0; i < mMeshesCount[lod]; i++)
+		// all meshes of the LOD draw the same instances, so they share one instance buffer (one upload per LOD instead of one per mesh)
+		mLODsInstanceBuffers.push_back(new InstanceBufferData());
+		assert(lod == mLODsInstanceBuffers.size() - 1);
+		mLODsInstanceBuffers[lod]->InstanceBuffer = rhi->CreateGPUBuffer("ER_RHI_GPUBuffer: ER_RenderingObject - Instance Buffer: " + mName + ", lod: " + std::to_string(lod));
+		CreateInstanceBuffer(&mInstanceData[lod][0], MAX_INSTANCE_COUNT, mLODsInstanceBuffers[lod]->InstanceBuffer);
+		mLODsInstanceBuffers[lod]->Stride = sizeof(InstancedData);
+
+		// shadow cascades have their own (culled against the cascade) instance lists
+		if (lod == 0 && mIsShadowCaster)
 		{
-			mMeshesInstanceBuffers[lod].push_back(new InstanceBufferData());
-			mMeshesInstanceBuffers[lod][i]->InstanceBuffer = rhi->CreateGPUBuffer("ER_RHI_GPUBuffer: ER_RenderingObject - Instance Buffer: " + mName + ", lod: " + std::to_string(lod) + ", mesh: " + std::to_string(i));
-			CreateInstanceBuffer(&mInstanceData[lod][0], MAX_INSTANCE_COUNT, mMeshesInstanceBuffers[lod][i]->InstanceBuffer);
-			mMeshesInstanceBuffers[lod][i]->Stride = sizeof(InstancedData);
+			for (int cascade = 0; cascade < NUM_SHADOW_CASCADES; cascade++)
+			{
+				mShadowCascadesInstanceBuffers[cascade] = new InstanceBufferData();
+				mShadowCascadesInstanceBuffers[cascade]->InstanceBuffer = rhi->CreateGPUBuffer("ER_RHI_GPUBuffer: ER_RenderingObject - Shadow Instance Buffer: " + mName + ", cascade: " + std::to_string(cascade));
+				CreateInstanceBuffer(&mInstanceData[lod][0], MAX_INSTANCE_COUNT, mShadowCascadesInstanceBuffers[cascade]->InstanceBuffer);
+				mShadowCascadesInstanceBuffers[cascade]->Stride = sizeof(InstancedData);
+			}
 		}
 	}
 	// new instancing code
@@ -608,18 +513,21 @@ namespace EveryRay_Core
 	}
 
 	// new instancing code
-	void ER_RenderingObject::UpdateInstanceBuffer(std::vector<InstancedData>& instanceData, int lod)
+	void ER_RenderingObject::UpdateInstanceBuffer(std::vector<InstancedData>& instanceData, int lod, bool isUpdatedEveryFrame)
 	{
-		assert(lod < mMeshesInstanceBuffers.size());
+		assert(lod < mLODsInstanceBuffers.size());
 
-		for (size_t i = 0; i < mMeshesCount[lod]; i++)
-		{
-			//CreateInstanceBuffer(instanceData);
-			mInstanceCountToRender[lod] = instanceData.size();
+		mInstanceCountToRender[lod] = static_cast<UINT>(instanceData.size());
+		if (mInstanceCountToRender[lod] == 0)
+			return;
 
-			// dynamically update instance buffer
-			mCore->GetRHI()->UpdateBuffer(mMeshesInstanceBuffers[lod][i]->InstanceBuffer, mInstanceCountToRender[lod] == 0 ? nullptr : &instanceData[0], InstanceSize() * mInstanceCountToRender[lod]);
-		}
+		// dynamically update instance buffer (through the upload ring if it is rewritten every frame, otherwise into its own memory, so it stays valid)
+		if (isUpdatedEveryFrame)
+			mCore->GetRHI()->UpdateBufferTransient(mLODsInstanceBuffers[lod]->InstanceBuffer, &instanceData[0], InstanceSize() * mInstanceCountToRender[lod]);
+		else
+			mCore->GetRHI()->UpdateBuffer(mLODsInstanceBuffers[lod]->InstanceBuffer, &instanceData[0], InstanceSize() * mInstanceCountToRender[lod], true);
+		mInstanceBuffersUploadedBytes += InstanceSize() * mInstanceCountToRender[lod];
+		mInstanceBuffersUploadsCount++;
 	}
 
 	UINT ER_RenderingObject::InstanceSize() const
@@ -630,71 +538,128 @@ namespace EveryRay_Core
 	void ER_RenderingObject::PerformCPUFrustumCull(ER_Camera* camera)
 	{
 		auto frustum = camera->GetFrustum();
-		auto cullFunction = [frustum](ER_AABB& aabb) {
-			bool culled = false;
-			// start a loop through all frustum planes
-			for (int planeID = 0; planeID < 6; ++planeID)
-			{
-				XMVECTOR planeNormal = XMVectorSet(frustum.Planes()[planeID].x, frustum.Planes()[planeID].y, frustum.Planes()[planeID].z, 0.0f);
-				float planeConstant = frustum.Planes()[planeID].w;
 
-				XMFLOAT3 axisVert;
+		if (mIsInstanced)
+		{
+			const int currentLOD = 0; // no need to iterate through LODs (AABBs are shared between LODs, so culling results will be identical)
+			assert(mInstanceCuller.GetCount() == mInstanceCount);
 
-				// x-axis
-				if (frustum.Planes()[planeID].x > 0.0f)
-					axisVert.x = aabb.first.x;
-				else
-					axisVert.x = aabb.second.x;
+			// batch cull SoA AABBs and compact surviving instances into a preallocated buffer (resize() does not reallocate after the first frame)
+			UINT visibleCount = mInstanceCuller.Cull(frustum);
+			mTempPostCullingInstanceData.resize(mInstanceCount);
+			mInstanceCuller.Compact(mInstanceData[currentLOD].data(), mTempPostCullingInstanceData.data(), visibleCount);
+			mTempPostCullingInstanceData.resize(visibleCount); //we store a copy for future usages
 
-				// y-axis
-				if (frustum.Planes()[planeID].y > 0.0f)
-					axisVert.y = aabb.first.y;
-				else
-					axisVert.y = aabb.second.y;
+			//update every LOD group with new instance data after CPU frustum culling (uploaded later in UpdateGPU())
+			for (int lodIndex = 0; lodIndex < GetLODCount(); lodIndex++)
+				QueueInstanceBufferUpdate(&mTempPostCullingInstanceData, lodIndex);
+		}
+		else if (mSceneBVHProxy < 0) // otherwise culled by ER_Scene::CullObjects()
+			mIsCulled = ER_FrustumCuller::IsAABBCulled(frustum, mGlobalAABB);
+	}
 
-				// z-axis
-				if (frustum.Planes()[planeID].z > 0.0f)
-					axisVert.z = aabb.first.z;
-				else
-					axisVert.z = aabb.second.z;
+	bool ER_RenderingObject::IsUsingGPUCulling()
+	{
+		return mIsInstanced && ER_Utility::IsMainCameraGPUCulling && ER_GPUInstanceCuller::IsSupported(mCore->GetRHI());
+	}
 
+	// Main thread only (dispatches compute): culls all instances and buckets them by LOD on the GPU, DrawLOD() then uses indirect args.
+	// Instances are uploaded only when they change (editor, terrain placement, etc.), not every frame.
+	void ER_RenderingObject::PerformGPUFrustumCull(ER_GPUInstanceCuller* aCuller, ER_Camera* camera)
+	{
+		assert(aCuller && camera);
+		if (!IsUsingGPUCulling() || mInstanceCount == 0 || mMeshRenderBuffers.size() < static_cast<size_t>(GetLODCount()))
+			return;
 
-				if (XMVectorGetX(XMVector3Dot(planeNormal, XMLoadFloat3(&axisVert))) + planeConstant > 0.0f)
-				{
-					culled = true;
-					// Skip remaining planes to check and move on 
-					break;
-				}
+		auto rhi = mCore->GetRHI();
+
+		if (mGPUCulledInstances && mGPUCulledInstances->InstanceCount != mInstanceCount)
+			DeleteObject(mGPUCulledInstances);
+
+		if (!mGPUCulledInstances)
+		{
+			std::vector<std::vector<UINT>> lodMeshesIndexCounts(GetLODCount());
+			for (int lod = 0; lod < GetLODCount(); lod++)
+			{
+				for (int i = 0; i < mMeshesCount[lod]; i++)
+					lodMeshesIndexCounts[lod].push_back(mMeshRenderBuffers[lod][i]->IndicesCount);
 			}
-			return culled;
-		};
+			mGPUCulledInstances = aCuller->CreateCulledInstances(rhi, mName, mInstanceCount, lodMeshesIndexCounts);
+			mIsGPUInstanceDataDirty = true;
+		}
 
-		assert(mInstanceCullingFlags.size() == mInstanceCount);
+		if (mIsGPUInstanceDataDirty)
+		{
+			rhi->UpdateBuffer(mGPUCulledInstances->Instances, &mInstanceData[0][0], InstanceSize() * mInstanceCount);
+			mInstanceBuffersUploadedBytes += InstanceSize() * mInstanceCount;
+			mInstanceBuffersUploadsCount++;
+			mIsGPUInstanceDataDirty = false;
+		}
 
-		if (mIsInstanced)
+		const GPUInstanceCullingCBufferData::InstanceCullingCB params = ER_GPUInstanceCuller::GetCullingParams(camera->GetFrustum(), camera->Position(), mLocalAABB, mInstanceCount, GetLODCount());
+		aCuller->Cull(rhi, *mGPUCulledInstances, params);
+
+		if (mIsGPUCullingValidationRequested)
 		{
-			XMMATRIX instanceWorldMatrix = XMMatrixIdentity();
-			const int currentLOD = 0; // no need to iterate through LODs (AABBs are shared between LODs, so culling results will be identical)
+			aCuller->ValidateCull(rhi, *mGPUCulledInstances, params, &mInstanceData[0][0], mName);
+			mIsGPUCullingValidationRequested = false;
+		}
+	}
 
-			mTempPostCullingInstanceData.clear();
+	// Casters are culled against every cascade's light volume (not the main camera), so objects outside of the view still cast shadows 
+	// and objects that touch no cascade are skipped in ER_ShadowMapper::Draw()
+	void ER_RenderingObject::PerformShadowCastersCull(const ER_ShadowMapper& shadowMapper)
+	{
+		for (int cascade = 0; cascade < NUM_SHADOW_CASCADES; cascade++)
+		{
+			const ER_Frustum& frustum = shadowMapper.GetCasterCullingFrustum(cascade);
+
+			if (mIsInstanced)
 			{
-				std::vector<InstancedData> newInstanceData;
-				for (int instanceIndex = 0; instanceIndex < static_cast<int>(mInstanceCount); instanceIndex++)
+				if (!ER_Utility::IsShadowCastersCPUCulling)
 				{
-					instanceWorldMatrix = XMLoadFloat4x4(&(mInstanceData[currentLOD][instanceIndex].World));
-					mInstanceCullingFlags[instanceIndex] = cullFunction(mInstanceAABBs[instanceIndex]);
-					if (!mInstanceCullingFlags[instanceIndex])
-						newInstanceData.push_back(instanceWorldMatrix);
+					mPendingShadowInstanceBufferUpdates[cascade] = &mInstanceData[0];
+					continue;
 				}
-				mTempPostCullingInstanceData = newInstanceData; //we store a copy for future usages
 
-				//update every LOD group with new instance data after CPU frustum culling
-				for (int lodIndex = 0; lodIndex < GetLODCount(); lodIndex++)
-					UpdateInstanceBuffer(mTempPostCullingInstanceData, lodIndex);
+				// main camera's culling flags of mInstanceCuller stay untouched (visible indices go to a temp buffer)
+				mTempShadowCullingVisibleIndices.resize(mInstanceCount);
+				mTempPostShadowCullingInstanceData[cascade].resize(mInstanceCount);
+				UINT visibleCount = mInstanceCuller.Cull(frustum, mTempShadowCullingVisibleIndices.data());
+				ER_FrustumCuller::Compact(mInstanceData[0].data(), mTempPostShadowCullingInstanceData[cascade].data(), mTempShadowCullingVisibleIndices.data(), visibleCount);
+				mTempPostShadowCullingInstanceData[cascade].resize(visibleCount);
+
+				mPendingShadowInstanceBufferUpdates[cascade] = &mTempPostShadowCullingInstanceData[cascade];
 			}
+			else if (mSceneBVHProxy < 0) // otherwise culled by ER_Scene::CullObjects()
+				mIsInShadowCascades[cascade] = !ER_Utility::IsShadowCastersCPUCulling || !ER_FrustumCuller::IsAABBCulled(frustum, mGlobalAABB);
 		}
-		else
-			mIsCulled = cullFunction(mGlobalAABB);
+	}
+
+	// Instances are tested with their world AABBs (rotation and scale included); only this cascade's data is written, so cascades can run in parallel
+	bool ER_RenderingObject::CullInstancesAgainstVoxelCascade(int cascadeIndex, const ER_AABB& aCascadeAABB)
+	{
+		assert(mIsInstanced && cascadeIndex < NUM_VOXEL_GI_CASCADES);
+
+		std::vector<InstancedData>& instances = mTempVoxelCascadesInstanceData[cascadeIndex];
+		instances.clear();
+		for (int instanceIndex = 0; instanceIndex < static_cast<int>(mInstanceCount); instanceIndex++)
+		{
+			const ER_AABB& aabb = mInstanceAABBs[instanceIndex];
+			if (aabb.first.x <= aCascadeAABB.second.x && aabb.second.x >= aCascadeAABB.first.x &&
+				aabb.first.y <= aCascadeAABB.second.y && aabb.second.y >= aCascadeAABB.first.y &&
+				aabb.first.z <= aCascadeAABB.second.z && aabb.second.z >= aCascadeAABB.first.z)
+				instances.push_back(mInstanceData[0][instanceIndex]);
+		}
+
+		std::vector<InstancedData>& currentInstances = mVoxelCascadesInstanceData[cascadeIndex];
+		if (instances.size() == currentInstances.size() &&
+			(instances.empty() || memcmp(instances.data(), currentInstances.data(), instances.size() * sizeof(InstancedData)) == 0))
+			return false;
+
+		currentInstances.swap(instances);
+		mIsVoxelCascadeInstanceDataDirty[cascadeIndex] = true;
+		return true;
 	}
 
 	void ER_RenderingObject::StoreInstanceDataAfterTerrainPlacement()
@@ -717,6 +682,7 @@ namespace EveryRay_Core
 			}
 			UpdateInstanceBuffer(mInstanceData[lod], lod);
 		}
+		mIsGPUInstanceDataDirty = true;
 	}
 
 	// Placement on terrain based on object's properties defined in level file (instance count, terrain splat, object scale variation, etc.)
@@ -812,6 +778,13 @@ namespace EveryRay_Core
 		mIsTerrainPlacementFinished = true;
 	}
 	void ER_RenderingObject::Update(const ER_CoreTime& time)
+	{
+		UpdateCPU(time);
+		UpdateGPU(time);
+	}
+
+	// Thread-safe part of the update (only touches this object's data): can be called from ER_JobSystem's workers
+	void ER_RenderingObject::UpdateCPU(const ER_CoreTime& time)
 	{
 		ER_Camera* camera = (ER_Camera*)(mCore->GetServices().FindService(ER_Camera::TypeIdClass()));
 		assert(camera);
@@ -835,31 +808,171 @@ namespace EveryRay_Core
 
 			if (mIsInstanced)
 			{
+				// invalid (min > max) if there are no instances
+				mInstancesBoundsAABB = ER_AABB(XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX), XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX));
+
 				XMMATRIX instanceWorldMatrix = XMMatrixIdentity();
 				for (int instanceIndex = 0; instanceIndex < static_cast<int>(mInstanceCount); instanceIndex++)
 				{
 					instanceWorldMatrix = XMLoadFloat4x4(&(mInstanceData[0][instanceIndex].World));
 					mInstanceAABBs[instanceIndex] = mLocalAABB;
 					UpdateAABB(mInstanceAABBs[instanceIndex], instanceWorldMatrix);
+					mInstanceCuller.SetAABB(instanceIndex, mInstanceAABBs[instanceIndex]);
+
+					const ER_AABB& instanceAABB = mInstanceAABBs[instanceIndex];
+					mInstancesBoundsAABB.first = XMFLOAT3(std::min(mInstancesBoundsAABB.first.x, instanceAABB.first.x),
+						std::min(mInstancesBoundsAABB.first.y, instanceAABB.first.y), std::min(mInstancesBoundsAABB.first.z, instanceAABB.first.z));
+					mInstancesBoundsAABB.second = XMFLOAT3(std::max(mInstancesBoundsAABB.second.x, instanceAABB.second.x),
+						std::max(mInstancesBoundsAABB.second.y, instanceAABB.second.y), std::max(mInstancesBoundsAABB.second.z, instanceAABB.second.z));
 				}
 			}
 		}
 
-		if (ER_Utility::IsMainCameraCPUFrustumCulling && camera)
-			PerformCPUFrustumCull(camera);
-		else
+		// instanced objects on the GPU culling path are culled and lodded in PerformGPUFrustumCull() (main thread, before rendering)
+		bool isGPUCulled = IsUsingGPUCulling();
+		if (!isGPUCulled)
 		{
-			if (mIsInstanced)
+			if (ER_Utility::IsMainCameraCPUFrustumCulling && camera)
+				PerformCPUFrustumCull(camera);
+			else
 			{
-				//just updating transforms (that could be changed in a previous frame); this is not optimal (GPU buffer map() every frame...)
-				for (int lod = 0; lod < GetLODCount(); lod++)
-					UpdateInstanceBuffer(mInstanceData[lod], lod);
+				if (mIsInstanced)
+				{
+					//just updating transforms (that could be changed in a previous frame); this is not optimal (GPU buffer map() every frame...)
+					for (int lod = 0; lod < GetLODCount(); lod++)
+						QueueInstanceBufferUpdate(&mInstanceData[lod], lod);
+				}
 			}
+
+			// overrides queued culling results with per-LOD buckets, so every LOD's instance buffer is uploaded only once per frame
+			if (GetLODCount() > 1)
+				UpdateLODs();
 		}
 
-		if (GetLODCount() > 1)
-			UpdateLODs();
+		if (mIsShadowCaster && mCore->GetLevel() && mCore->GetLevel()->mShadowMapper)
+			PerformShadowCastersCull(*mCore->GetLevel()->mShadowMapper);
+	}
+
+	// Projected size (in pixels) and distance of the nearest visible bounding sphere (visible instances or the whole object) for texture streaming
+	void ER_RenderingObject::UpdateTextureStreamingMetrics(const ER_Camera& camera)
+	{
+		mTextureStreamingScreenSize = 0.0f;
+		mTextureStreamingDistance = FLT_MAX;
 
+		const XMVECTOR cameraPosition = XMLoadFloat3(&camera.Position());
+		const float pixelsPerUnit = static_cast<float>(mCore->ScreenHeight()) / (2.0f * tanf(camera.FieldOfView() * 0.5f)); // at distance 1
+		auto accumulate = [&](const ER_AABB& aabb)
+		{
+			const XMVECTOR aabbMin = XMLoadFloat3(&aabb.first);
+			const XMVECTOR aabbMax = XMLoadFloat3(&aabb.second);
+			const XMVECTOR center = XMVectorScale(XMVectorAdd(aabbMin, aabbMax), 0.5f);
+			const float radius = XMVectorGetX(XMVector3Length(XMVectorSubtract(aabbMax, center)));
+			const float distance = std::max(XMVectorGetX(XMVector3Length(XMVectorSubtract(center, cameraPosition))) - radius, camera.NearPlaneDistance());
+
+			mTextureStreamingScreenSize = std::max(mTextureStreamingScreenSize, 2.0f * radius * pixelsPerUnit / distance);
+			mTextureStreamingDistance = std::min(mTextureStreamingDistance, distance);
+		};
+
+		if (mIsInstanced)
+		{
+			// only instances that survived the main camera culling: reuse CPU culling results of this frame if we have them,
+			// otherwise (GPU culling path or disabled CPU culling) batch cull against the camera frustum into the temp buffer
+			const UINT* visibleIndices = nullptr;
+			UINT visibleCount = 0;
+			if (!IsUsingGPUCulling() && ER_Utility::IsMainCameraCPUFrustumCulling)
+			{
+				visibleIndices = mInstanceCuller.GetVisibleIndices();
+				visibleCount = static_cast<UINT>(mTempPostCullingInstanceData.size());
+			}
+			else
+			{
+				mTempStreamingVisibleIndices.resize(mInstanceCount);
+				visibleCount = mInstanceCuller.Cull(camera.GetFrustum(), mTempStreamingVisibleIndices.data());
+				visibleIndices = mTempStreamingVisibleIndices.data();
+			}
+
+			for (UINT i = 0; i < visibleCount; i++)
+				accumulate(mInstanceAABBs[visibleIndices[i]]);
+		}
+		else if (!mIsCulled)
+			accumulate(mGlobalAABB);
+	}
+
+	// Main thread: reports the metrics for all textures of the object (nothing is requested if the object is not visible).
+	// Metrics are computed here and not in UpdateCPU(), because non-instanced objects in the scene BVH get their culling results later (ER_Scene::CullObjects()).
+	void ER_RenderingObject::RequestTexturesStreaming(const ER_Camera& camera)
+	{
+		UpdateTextureStreamingMetrics(camera);
+		if (mTextureStreamingScreenSize <= 0.0f)
+			return;
+
+		for (TextureData& textures : mMeshesTextureBuffers)
+		{
+			ER_RHI_GPUTexture* maps[] = { textures.AlbedoMap, textures.NormalMap, textures.SpecularMap, textures.MetallicMap, textures.RoughnessMap,
+				textures.HeightMap, textures.ReflectionMaskMap, textures.ExtraMap2, textures.ExtraMap3 };
+			for (ER_RHI_GPUTexture* map : maps)
+				mAssetRegistry->RequestTextureStreaming(map, mTextureStreamingScreenSize, mTextureStreamingDistance);
+		}
+	}
+
+	// Main thread part of the update: batched instance buffer uploads (one per LOD group) + editor
+	void ER_RenderingObject::UpdateGPU(const ER_CoreTime& time)
+	{
+		mInstanceBuffersUploadedBytes = 0;
+		mInstanceBuffersUploadsCount = 0;
+
+		for (int lod = 0; lod < static_cast<int>(mPendingInstanceBufferUpdates.size()); lod++)
+		{
+			if (mPendingInstanceBufferUpdates[lod])
+			{
+				UpdateInstanceBuffer(*mPendingInstanceBufferUpdates[lod], lod, true); // queued in every UpdateCPU()
+				mPendingInstanceBufferUpdates[lod] = nullptr;
+			}
+		}
+
+		for (int cascade = 0; cascade < NUM_SHADOW_CASCADES; cascade++)
+		{
+			if (mPendingShadowInstanceBufferUpdates[cascade] && mShadowCascadesInstanceBuffers[cascade])
+			{
+				std::vector<InstancedData>& instanceData = *mPendingShadowInstanceBufferUpdates[cascade];
+				mShadowCascadesInstanceCountToRender[cascade] = static_cast<UINT>(instanceData.size());
+				if (mShadowCascadesInstanceCountToRender[cascade] > 0)
+				{
+					mCore->GetRHI()->UpdateBufferTransient(mShadowCascadesInstanceBuffers[cascade]->InstanceBuffer, &instanceData[0], InstanceSize() * mShadowCascadesInstanceCountToRender[cascade]);
+					mInstanceBuffersUploadedBytes += InstanceSize() * mShadowCascadesInstanceCountToRender[cascade];
+					mInstanceBuffersUploadsCount++;
+				}
+			}
+			else
+				mShadowCascadesInstanceCountToRender[cascade] = 0; // the ring data of the previous frame is gone
+			mPendingShadowInstanceBufferUpdates[cascade] = nullptr;
+		}
+
+		for (int cascade = 0; cascade < NUM_VOXEL_GI_CASCADES; cascade++)
+		{
+			if (!mIsVoxelCascadeInstanceDataDirty[cascade])
+				continue;
+			mIsVoxelCascadeInstanceDataDirty[cascade] = false;
+
+			std::vector<InstancedData>& instanceData = mVoxelCascadesInstanceData[cascade];
+			mVoxelCascadesInstanceCountToRender[cascade] = static_cast<UINT>(instanceData.size());
+			if (mVoxelCascadesInstanceCountToRender[cascade] == 0)
+				continue;
+
+			if (!mVoxelCascadesInstanceBuffers[cascade])
+			{
+				mVoxelCascadesInstanceBuffers[cascade] = new InstanceBufferData();
+				mVoxelCascadesInstanceBuffers[cascade]->InstanceBuffer = mCore->GetRHI()->CreateGPUBuffer("ER_RHI_GPUBuffer: ER_RenderingObject - Voxel Cascade Instance Buffer: " + mName + ", cascade: " + std::to_string(cascade));
+				CreateInstanceBuffer(&mInstanceData[0][0], MAX_INSTANCE_COUNT, mVoxelCascadesInstanceBuffers[cascade]->InstanceBuffer);
+				mVoxelCascadesInstanceBuffers[cascade]->Stride = sizeof(InstancedData);
+			}
+			// only uploaded when the list changes, so not through the upload ring
+			mCore->GetRHI()->UpdateBuffer(mVoxelCascadesInstanceBuffers[cascade]->InstanceBuffer, &instanceData[0], InstanceSize() * mVoxelCascadesInstanceCountToRender[cascade], true);
+			mInstanceBuffersUploadedBytes += InstanceSize() * mVoxelCascadesInstanceCountToRender[cascade];
+			mInstanceBuffersUploadsCount++;
+		}
+
+		bool editable = ER_Utility::IsEditorMode && mAvailableInEditorMode && mIsSelected;
 		if (editable)
 		{
 			UpdateGizmos();
@@ -869,6 +982,15 @@ namespace EveryRay_Core
 		}
 	}
 
+	void ER_RenderingObject::QueueInstanceBufferUpdate(std::vector<InstancedData>* instanceData, int lod)
+	{
+		assert(lod < GetLODCount());
+		if (mPendingInstanceBufferUpdates.size() < static_cast<size_t>(GetLODCount()))
+			mPendingInstanceBufferUpdates.resize(GetLODCount(), nullptr);
+
+		mPendingInstanceBufferUpdates[lod] = instanceData;
+	}
+
 	void ER_RenderingObject::UpdateAABB(ER_AABB& aabb, const XMMATRIX& transformMatrix)
 	{
 		// computing AABB from the non-axis aligned BB
@@ -925,6 +1047,7 @@ namespace EveryRay_Core
 		{
 			for (int lod = 0; lod < GetLODCount(); lod++)
 				mInstanceData[lod][mEditorSelectedInstancedObjectIndex].World = XMFLOAT4X4(mCurrentObjectTransformMatrix);
+			mIsGPUInstanceDataDirty = true;
 		}
 	}
 	
@@ -951,7 +1074,7 @@ namespace EveryRay_Core
 			if (mIsInstanced)
 			{
 				name = mInstancesNames[mEditorSelectedInstancedObjectIndex];
-				if (mInstanceCullingFlags[mEditorSelectedInstancedObjectIndex]) //showing info for main LOD only in editor
+				if (mInstanceCuller.IsCulled(mEditorSelectedInstancedObjectIndex)) //showing info for main LOD only in editor
 					name += " (Culled)";
 			}
 			else
@@ -968,7 +1091,7 @@ namespace EveryRay_Core
 			ImGui::Text(lodCountText.c_str());
 			for (int lodI = 0; lodI < GetLODCount(); lodI++)
 			{
-				std::string vertexCountText = "--> Vertex count LOD#" + std::to_string(lodI) + ": " + std::to_string(GetVertices(lodI).size());
+				std::string vertexCountText = "--> Vertex count LOD#" + std::to_string(lodI) + ": " + std::to_string(GetVertexCount(lodI));
 				ImGui::Text(vertexCountText.c_str());
 			}
 
@@ -989,6 +1112,8 @@ namespace EveryRay_Core
 			ImGui::Checkbox("Rendered", &mIsRendered);
 			ImGui::Checkbox("Show AABB", &mEnableAABBDebug);
 			ImGui::Checkbox("Show Wireframe", &mWireframeMode);
+			if (IsUsingGPUCulling() && ImGui::Button("Validate GPU culling vs. CPU reference (output in log)"))
+				mIsGPUCullingValidationRequested = true;
 			if (ImGui::Button("Move camera to"))
 			{
 				XMFLOAT3 newCameraPos;
@@ -1073,29 +1198,35 @@ namespace EveryRay_Core
 		ImGui::End();
 	}
 	
-	void ER_RenderingObject::LoadLOD(std::unique_ptr<ER_Model> pModel)
+	const std::string& ER_RenderingObject::GetModelPath() const
 	{
-		mMeshesCount.push_back(pModel->Meshes().size());
-		mModelLODs.push_back(std::move(pModel));
-		mMeshVertices.push_back({});
-		mMeshAllVertices.push_back({}); 
-
-		int lodIndex = mMeshesCount.size() - 1;
+		return mModel->Path;
+	}
 
-		for (size_t i = 0; i < mMeshesCount[lodIndex]; i++)
-			mMeshVertices[lodIndex].push_back(mModelLODs[lodIndex - 1]->GetMesh(i).Vertices());
+	void ER_RenderingObject::LoadLOD(const std::string& pModelPath)
+	{
+		mModelLODs.push_back(mAssetRegistry->AcquireModel(pModelPath));
 
-		for (size_t i = 0; i < mMeshVertices[lodIndex].size(); i++)
-		{
-			for (size_t j = 0; j < mMeshVertices[lodIndex][i].size(); j++)
-			{
-				mMeshAllVertices[lodIndex].push_back(mMeshVertices[lodIndex][i][j]);
-			}
-		}
+		int lodIndex = static_cast<int>(mModelLODs.size());
+		mMeshesCount.push_back(GetModel(lodIndex).Meshes().size());
 
 		LoadRenderBuffers(lodIndex);
 	}
 
+	ER_Model& ER_RenderingObject::GetModel(int lod) const
+	{
+		assert(lod < static_cast<int>(mModelLODs.size()) + 1);
+		return (lod == 0) ? *mModel->Model : *mModelLODs[lod - 1]->Model;
+	}
+
+	UINT ER_RenderingObject::GetVertexCount(int lod) const
+	{
+		UINT count = 0;
+		for (const ER_Mesh& mesh : GetModel(lod).Meshes())
+			count += static_cast<UINT>(mesh.Vertices().size());
+		return count;
+	}
+
 	void ER_RenderingObject::ResetInstanceData(int count, bool clear, int lod)
 	{
 		assert(lod < GetLODCount());
@@ -1110,23 +1241,37 @@ namespace EveryRay_Core
 				std::string instanceName = mName + " #" + std::to_string(i);
 				mInstancesNames.push_back(instanceName);
 				mInstanceAABBs.push_back(mLocalAABB);
-				mInstanceCullingFlags.push_back(false);
 			}
+			mInstanceCuller.Resize(mInstanceCount);
 		}
 
 		if (clear)
 			mInstanceData[lod].clear();
+		mIsGPUInstanceDataDirty = true;
 	}
 	void ER_RenderingObject::AddInstanceData(const XMMATRIX& worldMatrix, int lod)
 	{
 		if (lod == -1) {
 			for (int lod = 0; lod < GetLODCount(); lod++)
 				mInstanceData[lod].push_back(InstancedData(worldMatrix));
+			mIsGPUInstanceDataDirty = true;
 			return;
 		}
 
 		assert(lod < mInstanceData.size());
 		mInstanceData[lod].push_back(InstancedData(worldMatrix));
+		mIsGPUInstanceDataDirty = true;
+	}
+
+	void ER_RenderingObject::SetInstancesData(const XMFLOAT4X4* worldMatrices, UINT count, int lod)
+	{
+		static_assert(sizeof(InstancedData) == sizeof(XMFLOAT4X4), "InstancedData must only contain the world matrix for the bulk copy");
+		assert(lod < mInstanceData.size());
+
+		mInstanceData[lod].resize(count);
+		if (count > 0)
+			memcpy(mInstanceData[lod].data(), worldMatrices, sizeof(XMFLOAT4X4) * count);
+		mIsGPUInstanceDataDirty = true;
 	}
 
 	void ER_RenderingObject::UpdateLODs()
@@ -1137,37 +1282,25 @@ namespace EveryRay_Core
 			if (ER_Utility::IsMainCameraCPUFrustumCulling && mTempPostCullingInstanceData.size() == 0)
 				return;
 
-			mTempPostLoddingInstanceData.clear();
+			// reuse LOD buckets between frames (no reallocations after the first frames)
+			mTempPostLoddingInstanceData.resize(GetLODCount());
 			for (int lod = 0; lod < GetLODCount(); lod++)
-				mTempPostLoddingInstanceData.push_back({});
+				mTempPostLoddingInstanceData[lod].clear();
 
 			//traverse through original or culled instance data (sort of "read-only") to rebalance LOD's instance buffers
 			int length = (ER_Utility::IsMainCameraCPUFrustumCulling) ? static_cast<int>(mTempPostCullingInstanceData.size()) : static_cast<int>(mInstanceData[0].size());
 			for (int i = 0; i < length; i++)
 			{
-				XMFLOAT3 pos;
-				XMMATRIX mat = (ER_Utility::IsMainCameraCPUFrustumCulling) ? XMLoadFloat4x4(&mTempPostCullingInstanceData[i].World) : XMLoadFloat4x4(&mInstanceData[0][i].World);
-				ER_MatrixHelper::GetTranslation(mat, pos);
-
-				float distanceToCameraSqr =
-					(mCamera.Position().x - pos.x) * (mCamera.Position().x - pos.x) +
-					(mCamera.Position().y - pos.y) * (mCamera.Position().y - pos.y) +
-					(mCamera.Position().z - pos.z) * (mCamera.Position().z - pos.z);
-
-				//XMMATRIX newMat;
-				if (distanceToCameraSqr <= ER_Utility::DistancesLOD[0] * ER_Utility::DistancesLOD[0]) {
-					mTempPostLoddingInstanceData[0].push_back((ER_Utility::IsMainCameraCPUFrustumCulling) ? mTempPostCullingInstanceData[i].World : mInstanceData[0][i].World);
-				}
-				else if (ER_Utility::DistancesLOD[0] * ER_Utility::DistancesLOD[0] < distanceToCameraSqr && distanceToCameraSqr <= ER_Utility::DistancesLOD[1] * ER_Utility::DistancesLOD[1]) {
-					mTempPostLoddingInstanceData[1].push_back((ER_Utility::IsMainCameraCPUFrustumCulling) ? mTempPostCullingInstanceData[i].World : mInstanceData[0][i].World);
-				}
-				else if (ER_Utility::DistancesLOD[1] * ER_Utility::DistancesLOD[1] < distanceToCameraSqr && distanceToCameraSqr <= ER_Utility::DistancesLOD[2] * ER_Utility::DistancesLOD[2]) {
-					mTempPostLoddingInstanceData[2].push_back((ER_Utility::IsMainCameraCPUFrustumCulling) ? mTempPostCullingInstanceData[i].World : mInstanceData[0][i].World);
-				}
+				const InstancedData& instance = (ER_Utility::IsMainCameraCPUFrustumCulling) ? mTempPostCullingInstanceData[i] : mInstanceData[0][i];
+
+				// same LOD selection as on the GPU path (instances farther than the last LOD are not drawn)
+				int lod = ER_GPUInstanceCuller::SelectLOD(mCamera.Position(), XMFLOAT3(instance.World._41, instance.World._42, instance.World._43), GetLODCount());
+				if (lod != -1)
+					mTempPostLoddingInstanceData[lod].push_back(instance);
 			}
 
 			for (int i = 0; i < GetLODCount(); i++)
-				UpdateInstanceBuffer(mTempPostLoddingInstanceData[i], i);
+				QueueInstanceBufferUpdate(&mTempPostLoddingInstanceData[i], i);
 		}
 		else
 		{
@@ -3,6 +3,7 @@
 #include "Common.h"
 #include "ER_GenericEvent.h"
 #include "ER_ModelMaterial.h"
+#include "ER_FrustumCuller.h"
 
 #include "RHI\ER_RHI.h"
 
@@ -16,6 +17,11 @@ namespace EveryRay_Core
 	class ER_RenderableAABB;
 	class ER_Camera;
 	class ER_Model;
+	class ER_AssetRegistry;
+	class ER_ShadowMapper;
+	class ER_GPUInstanceCuller;
+	struct ER_GPUCulledInstances;
+	struct ER_ModelAsset;
 
 	enum RenderingObjectTextureQuality
 	{
@@ -66,6 +72,7 @@ namespace EveryRay_Core
 		float SkipIndirectProbeLighting;
 	};
 
+	// Textures are shared between objects and owned by ER_AssetRegistry
 	struct TextureData
 	{
 		ER_RHI_GPUTexture* AlbedoMap			= nullptr;
@@ -93,19 +100,6 @@ namespace EveryRay_Core
 			ExtraMap2(extra2),
 			ExtraMap3(extra3)
 		{}
-
-		~TextureData()
-		{
-			DeleteObject(AlbedoMap);
-			DeleteObject(NormalMap);
-			DeleteObject(SpecularMap);
-			DeleteObject(RoughnessMap);
-			DeleteObject(MetallicMap);
-			DeleteObject(HeightMap);
-			DeleteObject(ReflectionMaskMap);
-			DeleteObject(ExtraMap2);
-			DeleteObject(ExtraMap3);
-		}
 	};
 
 	struct InstancedData
@@ -142,7 +136,7 @@ namespace EveryRay_Core
 		using Delegate_MeshMaterialVariablesUpdate = std::function<void(int)>; // mesh index for input
 
 	public:
-		ER_RenderingObject(const std::string& pName, int index, ER_Core& pCore, ER_Camera& pCamera, std::unique_ptr<ER_Model> pModel, bool availableInEditor = false, bool isInstanced = false);
+		ER_RenderingObject(const std::string& pName, int index, ER_Core& pCore, ER_Camera& pCamera, const std::string& pModelPath, bool availableInEditor = false, bool isInstanced = false);
 		~ER_RenderingObject();
 
 		void LoadCustomMeshTextures(int meshIndex);
@@ -150,15 +144,23 @@ namespace EveryRay_Core
 		void LoadRenderBuffers(int lod = 0);
 		void Draw(const std::string& materialName, bool toDepth = false, int meshIndex = -1);
 		void DrawLOD(const std::string& materialName, bool toDepth, int meshIndex, int lod, bool skipCulling = false);
+		void DrawShadowCascade(const std::string& materialName, int meshIndex, int cascadeIndex); // lowest LOD with the results of PerformShadowCastersCull()
+		void DrawVoxelCascade(const std::string& materialName, int meshIndex, int cascadeIndex); // main LOD with the results of CullInstancesAgainstVoxelCascade() (not culled by the main camera)
 		void DrawAABB(ER_RHI_GPUTexture* aRenderTarget, ER_RHI_GPUTexture* aDepth, ER_RHI_GPURootSignature* rs);
 		void Update(const ER_CoreTime& time);
+		// Update() split into two phases (for the parallel scene update in ER_Sandbox):
+		// UpdateCPU() - AABBs, CPU frustum culling and LODs; does not touch RHI, so it can run on ER_JobSystem's workers;
+		// UpdateGPU() - uploads instance data prepared by UpdateCPU() and runs the editor logic; main thread only.
+		void UpdateCPU(const ER_CoreTime& time);
+		void UpdateGPU(const ER_CoreTime& time);
+		void RequestTexturesStreaming(const ER_Camera& camera); // main thread, after UpdateCPU() and ER_Scene::CullObjects() (see ER_AssetRegistry::UpdateTextureStreaming())
 
 		std::map<std::string, ER_Material*>& GetMaterials() { return mMaterials; }
 		
 		TextureData& GetTextureData(int meshIndex) { return mMeshesTextureBuffers[meshIndex]; }
 		
 		const int GetMeshCount(int lod = 0) const { return mMeshesCount[lod]; }
-		const std::vector<XMFLOAT3>& GetVertices(int lod = 0) { return mMeshAllVertices[lod]; }
+		UINT GetVertexCount(int lod = 0) const;
 		const UINT GetInstanceCount(int lod = 0) { return (mIsInstanced ? static_cast<UINT>(mInstanceData[lod].size()) : 0); }
 		std::vector<InstancedData>& GetInstancesData(int lod = 0) { return mInstanceData[lod]; }
 		
@@ -168,6 +170,7 @@ namespace EveryRay_Core
 		ER_AABB& GetLocalAABB() { return mLocalAABB; } //local space (no transforms)
 		ER_AABB& GetGlobalAABB() { return mGlobalAABB; } //world space (with transforms)
 		ER_AABB& GetInstanceAABB(int index) { return mInstanceAABBs[index]; } //world space (with transforms)
+		const ER_AABB& GetWorldBoundsAABB() { return mIsInstanced ? mInstancesBoundsAABB : mGlobalAABB; } //world space bounds of the whole object (all instances for instanced objects)
 
 		void SetTransformationMatrix(const XMMATRIX& mat);
 		void SetTranslation(float x, float y, float z);
@@ -175,21 +178,32 @@ namespace EveryRay_Core
 		void SetRotation(float x, float y, float z);
 
 		void LoadInstanceBuffers(int lod = 0);
-		void UpdateInstanceBuffer(std::vector<InstancedData>& instanceData, int lod = 0);
+		void UpdateInstanceBuffer(std::vector<InstancedData>& instanceData, int lod = 0, bool isUpdatedEveryFrame = false); // every frame: through the upload ring (data only lives until the end of the frame)
+		UINT64 GetInstanceBuffersUploadedBytes() const { return mInstanceBuffersUploadedBytes; } // per frame (instance buffers of all LODs and shadow cascades)
+		UINT GetInstanceBuffersUploadsCount() const { return mInstanceBuffersUploadsCount; }
 		void ResetInstanceData(int count, bool clear = false, int lod = 0);
 		void AddInstanceData(const XMMATRIX& worldMatrix, int lod = -1);
+		void SetInstancesData(const XMFLOAT4X4* worldMatrices, UINT count, int lod = 0); // bulk copy (i.e., from the cooked scene)
 		UINT InstanceSize() const;
 		
 		void PerformCPUFrustumCull(ER_Camera* camera);
+		void PerformGPUFrustumCull(ER_GPUInstanceCuller* aCuller, ER_Camera* camera); // instanced objects only (culling + LOD selection for the main camera)
+		bool IsUsingGPUCulling();
+		void PerformShadowCastersCull(const ER_ShadowMapper& shadowMapper);
+		// Instanced objects only: collects the instances that overlap the voxel GI cascade's world AABB (uploaded in UpdateGPU() if the list has changed).
+		// Safe to call from different threads for different cascades. Returns true if the list has changed.
+		bool CullInstancesAgainstVoxelCascade(int cascadeIndex, const ER_AABB& aCascadeAABB);
+		UINT GetVoxelCascadeInstanceCount(int cascadeIndex) const { return static_cast<UINT>(mVoxelCascadesInstanceData[cascadeIndex].size()); }
 
 		void Rename(const std::string& name) { mName = name; }
 		const std::string& GetName() { return mName; }
+		const std::string& GetModelPath() const;
 
 		int GetLODCount() {
 			return 1 + static_cast<int>(mModelLODs.size());
 		}
 		void UpdateLODs();
-		void LoadLOD(std::unique_ptr<ER_Model> pModel);
+		void LoadLOD(const std::string& pModelPath);
 		
 		float GetMinScale() { return mMinScale; }
 		void SetMinScale(float v) { mMinScale = v; }
@@ -199,6 +213,7 @@ namespace EveryRay_Core
 
 		bool IsSelected() { return mIsSelected; }
 		void SetSelected(bool val) { mIsSelected = val; }
+		void SetEditorSelectedInstance(int index) { if (index >= 0 && index < static_cast<int>(mInstanceCount)) mEditorSelectedInstancedObjectIndex = index; }
 
 		bool IsInstanced() { return mIsInstanced; }
 		bool IsAvailableInEditor() { return mAvailableInEditorMode; }
@@ -210,6 +225,15 @@ namespace EveryRay_Core
 		bool IsCulled() { return mIsCulled; }
 		void SetCulled(bool val) { mIsCulled = val; }
 
+		// shadow cascades flags (from the last PerformShadowCastersCull())
+		bool IsShadowCaster() { return mIsShadowCaster; }
+		bool IsInShadowCascade(int cascadeIndex);
+		void SetInShadowCascade(int cascadeIndex, bool val) { mIsInShadowCascades[cascadeIndex] = val; }
+
+		// leaf in ER_Scene's BVH (-1 if not in the BVH); non-instanced objects in the BVH are culled by ER_Scene::CullObjects(), not in UpdateCPU()
+		int GetSceneBVHProxy() { return mSceneBVHProxy; }
+		void SetSceneBVHProxy(int proxy) { mSceneBVHProxy = proxy; }
+
 		float GetCustomAlphaDiscard() { return mCustomAlphaDiscard; }
 		void SetCustomAlphaDiscard(float val) { mCustomAlphaDiscard = val; }
 
@@ -276,8 +300,11 @@ namespace EveryRay_Core
 		std::vector<std::string> mCustomReflectionMaskTextures;
 	private:
 		void UpdateAABB(ER_AABB& aabb, const XMMATRIX& transformMatrix);
+		void QueueInstanceBufferUpdate(std::vector<InstancedData>* instanceData, int lod);
 		void LoadAssignedMeshTextures();
 		void LoadTexture(TextureType type, const std::wstring& path, int meshIndex, bool isPlaceholder = false);
+		void UpdateTextureStreamingMetrics(const ER_Camera& camera);
+		ER_Model& GetModel(int lod = 0) const;
 		void CreateInstanceBuffer(InstancedData* instanceData, UINT instanceCount, ER_RHI_GPUBuffer* instanceBuffer);
 		
 		void UpdateGizmos();
@@ -286,6 +313,7 @@ namespace EveryRay_Core
 		
 		ER_Core* mCore = nullptr;
 		ER_Camera& mCamera;
+		ER_AssetRegistry* mAssetRegistry = nullptr;
 
 		std::map<std::string, ER_Material*>						mMaterials;
 
@@ -293,15 +321,13 @@ namespace EveryRay_Core
 
 		///****************************************************************************************************************************
 		// *** mesh/model data (buffers, textures, etc.) ***
-		std::vector<TextureData>								mMeshesTextureBuffers;
-		std::vector<std::vector<std::vector<XMFLOAT3>>>			mMeshVertices; // vertices per mesh, per LOD group
-		std::vector<std::vector<RenderBufferData*>>				mMeshRenderBuffers; // vertex/index buffers per mesh, per LOD group
-		std::vector<std::vector<InstanceBufferData*>>			mMeshesInstanceBuffers; // instance buffers per mesh, per LOD group
-		std::vector<std::vector<XMFLOAT3>>						mMeshAllVertices; // vertices of all meshes combined, per LOD group
+		std::vector<TextureData>								mMeshesTextureBuffers; // shared (owned by ER_AssetRegistry)
+		std::vector<std::vector<RenderBufferData*>>				mMeshRenderBuffers; // vertex/index buffers per mesh, per LOD group; shared (owned by ER_AssetRegistry)
+		std::vector<InstanceBufferData*>						mLODsInstanceBuffers; // instance buffer per LOD group (shared by all meshes of the LOD)
 		std::vector<float>										mMeshesReflectionFactors; 
 		std::vector<int>										mMeshesCount;
-		std::unique_ptr<ER_Model>								mModel;
-		std::vector<std::unique_ptr<ER_Model>>					mModelLODs;
+		ER_ModelAsset*											mModel = nullptr;
+		std::vector<ER_ModelAsset*>								mModelLODs;
 		// 
 		///****************************************************************************************************************************
 
@@ -310,12 +336,29 @@ namespace EveryRay_Core
 		UINT													mInstanceCount = 0;
 		std::vector<std::string>								mInstancesNames; // collection of names of instances (mName + index)
 		std::vector<ER_AABB>									mInstanceAABBs; // collection of AABBs for every instance (shared for LODs)
-		std::vector<bool>										mInstanceCullingFlags; // collection of culling flags for every instance (vector is lame here btw...)
+		ER_FrustumCuller										mInstanceCuller; // SoA copy of instance AABBs for batch CPU frustum culling (+ culling flags for every instance)
 		std::vector<InstancedData>								mTempPostCullingInstanceData; // temp instance data after CPU culling
 		std::vector<std::vector<InstancedData>>					mTempPostLoddingInstanceData; // temp instance data after lodding (per LOD group)
+		std::vector<std::vector<InstancedData>*>				mPendingInstanceBufferUpdates; // instance data to upload in UpdateGPU() (per LOD group, nullptr - no upload)
 		std::vector<UINT>										mInstanceCountToRender; //instance render count  (per LOD group)
 		std::vector<std::vector<InstancedData>>					mInstanceData; //original instance data  (per LOD group)
+		InstanceBufferData*										mShadowCascadesInstanceBuffers[NUM_SHADOW_CASCADES] = {}; // instance buffers per shadow cascade (lowest LOD, shared by its meshes)
+		std::vector<InstancedData>								mTempPostShadowCullingInstanceData[NUM_SHADOW_CASCADES]; // temp instance data after CPU culling against every shadow cascade
+		std::vector<UINT>										mTempShadowCullingVisibleIndices; // temp indices of instances visible in a shadow cascade
+		std::vector<UINT>										mTempStreamingVisibleIndices; // temp indices of instances visible in the main camera (texture streaming metrics when CPU culling did not run)
+		std::vector<InstancedData>*								mPendingShadowInstanceBufferUpdates[NUM_SHADOW_CASCADES] = {}; // instance data to upload in UpdateGPU() (per shadow cascade, nullptr - no upload)
+		UINT													mShadowCascadesInstanceCountToRender[NUM_SHADOW_CASCADES] = {}; //instance render count (per shadow cascade)
+		InstanceBufferData*										mVoxelCascadesInstanceBuffers[NUM_VOXEL_GI_CASCADES] = {}; // instance buffers per voxel GI cascade (main LOD, created on first upload)
+		std::vector<InstancedData>								mVoxelCascadesInstanceData[NUM_VOXEL_GI_CASCADES]; // instances inside of every voxel GI cascade
+		std::vector<InstancedData>								mTempVoxelCascadesInstanceData[NUM_VOXEL_GI_CASCADES];
+		UINT													mVoxelCascadesInstanceCountToRender[NUM_VOXEL_GI_CASCADES] = {}; //instance render count (per voxel GI cascade)
+		bool													mIsVoxelCascadeInstanceDataDirty[NUM_VOXEL_GI_CASCADES] = {}; // upload in UpdateGPU()
+		UINT64													mInstanceBuffersUploadedBytes = 0; // since the start of the last UpdateGPU()
+		UINT													mInstanceBuffersUploadsCount = 0;
 		XMFLOAT4*												mTempInstancesPositions = nullptr;
+		ER_GPUCulledInstances*									mGPUCulledInstances = nullptr; // resources of the GPU culling path (created on first use)
+		bool													mIsGPUInstanceDataDirty = true; // instances need to be re-uploaded for the GPU culling path
+		bool													mIsGPUCullingValidationRequested = false; // ER_GPUInstanceCuller::ValidateCull() after the next GPU cull (editor)
 		// 
 		///****************************************************************************************************************************
 
@@ -341,6 +384,7 @@ namespace EveryRay_Core
 
 		ER_AABB													mLocalAABB; //mesh space AABB
 		ER_AABB													mGlobalAABB; //world space AABB
+		ER_AABB													mInstancesBoundsAABB; //world space AABB of all instances (instanced objects only)
 		XMFLOAT3												mCurrentGlobalAABBVertices[8];
 		ER_RenderableAABB*										mDebugGizmoAABB;
 	
@@ -349,6 +393,7 @@ namespace EveryRay_Core
 		int														mIndexInScene = -1;
 		int														mCurrentLODIndex = 0; //only used for non-instanced object
 		int														mEditorSelectedInstancedObjectIndex = 0;
+		int														mSceneBVHProxy = -1;
 		bool													mEnableAABBDebug = true;
 		bool													mWireframeMode = false;
 		bool													mAvailableInEditorMode = false;
@@ -358,6 +403,8 @@ namespace EveryRay_Core
 		bool													mIsForwardShading = false;
 		bool													mIsPOM = false;
 		bool													mIsCulled = false; //only for non-instanced objects
+		bool													mIsInShadowCascades[NUM_SHADOW_CASCADES] = {}; //only for non-instanced objects
+		bool													mIsShadowCaster = false; //has shadow map materials
 		bool													mFoliageMask = false;
 		bool													mIsInLightProbe = false;
 		bool													mIsSeparableSubsurfaceScattering = false;
@@ -380,6 +427,7 @@ namespace EveryRay_Core
 			0.f, 0.f, 0.f, 1.f 
 		};
 
-		RenderingObjectTextureQuality							mCurrentTextureQuality = RenderingObjectTextureQuality::OBJECT_TEXTURE_LOW;
+		float													mTextureStreamingScreenSize = 0.0f; // pixels, 0 - not visible
+		float													mTextureStreamingDistance = FLT_MAX;
 	};
 }
\ No newline at end of file
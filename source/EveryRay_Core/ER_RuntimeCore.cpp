@@ -13,6 +13,15 @@
 #include "ER_Sandbox.h"
 #include "ER_Editor.h"
 #include "ER_QuadRenderer.h"
+#include "ER_FrustumCuller.h"
+#include "ER_SceneBVH.h"
+#include "ER_SphericalHarmonics.h"
+#include "ER_ClusteredLighting.h"
+#include "ER_RenderGraph.h"
+#include "ER_JobSystem.h"
+#include "ER_AssetRegistry.h"
+#include "RHI\ER_RHI_ShaderCache.h"
+#include "RHI\Null\ER_RHI_Null.h"
 
 #include "..\JsonCpp\include\json\json.h"
 
@@ -33,7 +42,9 @@ namespace EveryRay_Core
 		mGamepad(nullptr),
 		mShowProfiler(false),
 		mEditor(nullptr),
-		mQuadRenderer(nullptr)
+		mQuadRenderer(nullptr),
+		mJobSystem(nullptr),
+		mAssetRegistry(nullptr)
 	{
 		LoadGraphicsConfig();
 
@@ -91,6 +102,16 @@ namespace EveryRay_Core
 		mCoreEngineComponents.push_back(mQuadRenderer);
 		mServices.AddService(ER_QuadRenderer::TypeIdClass(), mQuadRenderer);
 
+		mJobSystem = new ER_JobSystem(*this);
+		mCoreEngineComponents.push_back(mJobSystem);
+		mServices.AddService(ER_JobSystem::TypeIdClass(), mJobSystem);
+		if (mRHI && mRHI->GetShaderCache())
+			mRHI->GetShaderCache()->SetJobSystem(mJobSystem); // shader misses are compiled in parallel from now on
+
+		mAssetRegistry = new ER_AssetRegistry(*this);
+		mCoreEngineComponents.push_back(mAssetRegistry);
+		mServices.AddService(ER_AssetRegistry::TypeIdClass(), mAssetRegistry);
+
 		#pragma region INITIALIZE_IMGUI
 
 		IMGUI_CHECKVERSION();
@@ -105,6 +126,15 @@ namespace EveryRay_Core
 
 		ER_Core::Initialize();
 		LoadGlobalLevelsConfig();
+		if (IsHeadless())
+		{
+			if (mScenesPaths.find(mHeadlessSceneName) == mScenesPaths.end())
+			{
+				std::string message = "Headless replay: scene was not found with this name: " + mHeadlessSceneName;
+				throw ER_CoreException(message.c_str());
+			}
+			mStartupSceneName = mHeadlessSceneName;
+		}
 		SetLevel(mStartupSceneName, true);
 	}
 
@@ -297,6 +327,9 @@ namespace EveryRay_Core
 			ImGui::SliderFloat("Camera Far Plane", &farPlaneDist, 150.0f, 200000.0f);
 			mCamera->SetFarPlaneDistance(farPlaneDist);
 			ImGui::Checkbox("CPU frustum culling", &ER_Utility::IsMainCameraCPUFrustumCulling);
+			if (mRHI && mRHI->GetAPI() == ER_GRAPHICS_API::DX11)
+				ImGui::Checkbox("GPU culling & LODs (instanced objects)", &ER_Utility::IsMainCameraGPUCulling);
+			ImGui::Checkbox("CPU shadow casters culling", &ER_Utility::IsShadowCastersCPUCulling);
 			ImGui::End();
 		}
 			
@@ -326,10 +359,29 @@ namespace EveryRay_Core
 				{
 					ImGui::TextColored(ImVec4(0.8f, 0.0f, 0.0f, 1), "Render: %f ms", mElapsedTimeRenderCPU.count() * 1000);
 					ImGui::TextColored(ImVec4(0.8f, 0.0f, 0.0f, 1), "Update: %f ms", mElapsedTimeUpdateCPU.count() * 1000);
+					if (ImGui::Button("Run CPU frustum culling benchmark (output in log)"))
+						ER_FrustumCuller::RunBenchmark(mCamera->GetFrustum());
+					if (ImGui::Button("Run scene BVH tests (output in log)"))
+						ER_SceneBVH::RunTests();
+
+					int workerCount = static_cast<int>(mJobSystem->GetWorkerCount());
+					if (ImGui::SliderInt("Job system worker threads", &workerCount, 1, static_cast<int>(ER_JobSystem::GetMaxWorkerCount())))
+						mJobSystem->SetWorkerCount(static_cast<UINT>(workerCount));
+					if (ImGui::Button("Run scene objects update benchmark (output in log)"))
+						mCurrentSandbox->RunObjectsUpdateBenchmark(*this, mCoreTime);
+
+					ImGui::Separator();
+					mCPUProfiler->ShowScopesImGui();
 				}
 				if (ImGui::CollapsingHeader("GPU Time"))
 				{
 				}
+				if (ImGui::CollapsingHeader("Assets (models, textures)"))
+				{
+					mAssetRegistry->ShowStatisticsImGui();
+					if (ImGui::Button("Log assets statistics"))
+						mAssetRegistry->LogStatistics();
+				}
 				ImGui::End();
 			}
 			ImGui::Separator();
@@ -356,6 +408,10 @@ namespace EveryRay_Core
 		DeleteObject(mQuadRenderer);
 		DeleteObject(mMouse);
 		DeleteObject(mCamera);
+		if (mRHI && mRHI->GetShaderCache())
+			mRHI->GetShaderCache()->SetJobSystem(nullptr);
+		DeleteObject(mJobSystem);
+		DeleteObject(mAssetRegistry);
 
 		//destroy imgui
 		{
@@ -397,6 +453,152 @@ namespace EveryRay_Core
 
 		auto endRenderTimer = std::chrono::high_resolution_clock::now();
 		mElapsedTimeRenderCPU = endRenderTimer - startRenderTimer;
+
+		if (IsHeadless())
+			UpdateHeadlessReplay();
+	}
+
+	void ER_RuntimeCore::SetHeadlessReplay(const std::string& aSceneName, UINT aFrameCount)
+	{
+		assert(aFrameCount > 0);
+		mHeadlessSceneName = aSceneName;
+		mHeadlessFrameCount = aFrameCount;
+		mHeadlessFrameTimesMs.reserve(aFrameCount);
+	}
+
+	void ER_RuntimeCore::UpdateHeadlessReplay()
+	{
+		mHeadlessFrameIndex++;
+		if (mHeadlessFrameIndex <= HEADLESS_REPLAY_WARMUP_FRAMES)
+		{
+			if (mHeadlessFrameIndex == HEADLESS_REPLAY_WARMUP_FRAMES && mRHI->GetAPI() == ER_GRAPHICS_API::NULL_RHI)
+				static_cast<ER_RHI_Null*>(mRHI)->ResetCounters();
+			return;
+		}
+
+		mHeadlessFrameTimesMs.push_back((mElapsedTimeUpdateCPU.count() + mElapsedTimeRenderCPU.count()) * 1000.0);
+		if (mHeadlessFrameTimesMs.size() == mHeadlessFrameCount)
+		{
+			FinishHeadlessReplay();
+			Exit();
+		}
 	}
-}
 
+	void ER_RuntimeCore::FinishHeadlessReplay()
+	{
+		assert(!mHeadlessFrameTimesMs.empty());
+
+		std::vector<double> sortedTimes(mHeadlessFrameTimesMs);
+		std::sort(sortedTimes.begin(), sortedTimes.end());
+		double totalTime = 0.0;
+		for (double time : sortedTimes)
+			totalTime += time;
+
+		const double minTime = sortedTimes.front();
+		const double maxTime = sortedTimes.back();
+		const double avgTime = totalTime / sortedTimes.size();
+		const double medianTime = sortedTimes[sortedTimes.size() / 2];
+		const double p95Time = sortedTimes[std::min(sortedTimes.size() - 1, sortedTimes.size() * 95 / 100)];
+
+		Json::Value root;
+		root["scene"] = mHeadlessSceneName;
+		root["frames"] = static_cast<Json::UInt>(sortedTimes.size());
+		root["cpu_frame_time_ms"]["min"] = minTime;
+		root["cpu_frame_time_ms"]["avg"] = avgTime;
+		root["cpu_frame_time_ms"]["median"] = medianTime;
+		root["cpu_frame_time_ms"]["p95"] = p95Time;
+		root["cpu_frame_time_ms"]["max"] = maxTime;
+
+		std::string message = "[ER Logger][ER_RuntimeCore] Headless replay of " + mHeadlessSceneName + " finished: " + std::to_string(sortedTimes.size()) +
+			" frames, CPU frame time (ms) min/avg/median/p95/max: " + std::to_string(minTime) + "/" + std::to_string(avgTime) + "/" + std::to_string(medianTime) + "/" +
+			std::to_string(p95Time) + "/" + std::to_string(maxTime) + "\n";
+		ER_OUTPUT_LOG(ER_Utility::ToWideString(message).c_str());
+
+		if (mRHI->GetAPI() == ER_GRAPHICS_API::NULL_RHI)
+		{
+			ER_RHI_Null* nullRHI = static_cast<ER_RHI_Null*>(mRHI);
+			nullRHI->LogStatistics();
+
+			// averages per frame
+			const ER_RHI_Null_CommandCounters& counters = nullRHI->GetTotalCounters();
+			const double frames = static_cast<double>(std::max<UINT64>(1, nullRHI->GetPresentedFrames()));
+			Json::Value& rhi = root["rhi_per_frame"];
+			rhi["draw_calls"] = counters.DrawCalls / frames;
+			rhi["drawn_instances"] = counters.DrawnInstances / frames;
+			rhi["drawn_vertices"] = counters.DrawnVertices / frames;
+			rhi["dispatches"] = counters.Dispatches / frames;
+			rhi["pso_changes"] = counters.PSOChanges / frames;
+			rhi["shader_changes"] = counters.ShaderChanges / frames;
+			rhi["state_changes"] = counters.StateChanges / frames;
+			rhi["redundant_state_changes"] = counters.RedundantStateChanges / frames;
+			rhi["render_target_changes"] = counters.RenderTargetChanges / frames;
+			rhi["resource_bind_calls"] = counters.ResourceBindCalls / frames;
+			rhi["bound_resources"] = counters.BoundResources / frames;
+			rhi["vertex_buffer_changes"] = counters.VertexBufferChanges / frames;
+			rhi["index_buffer_changes"] = counters.IndexBufferChanges / frames;
+			rhi["buffer_updates"] = counters.BufferUpdates / frames;
+			rhi["uploaded_bytes"] = counters.UploadedBytes / frames;
+			rhi["copies"] = counters.Copies / frames;
+			rhi["clears"] = counters.Clears / frames;
+			rhi["transitions"] = counters.Transitions / frames;
+
+			const ER_RHI_Null_AllocationCounters& allocations = nullRHI->GetAllocationCounters();
+			Json::Value& memory = root["rhi_allocations"];
+			memory["buffers"] = static_cast<Json::UInt64>(allocations.LiveBuffers.load());
+			memory["buffer_bytes"] = static_cast<Json::UInt64>(allocations.LiveBufferBytes.load());
+			memory["textures"] = static_cast<Json::UInt64>(allocations.LiveTextures.load());
+			memory["texture_bytes"] = static_cast<Json::UInt64>(allocations.LiveTextureBytes.load());
+			memory["peak_bytes"] = static_cast<Json::UInt64>(allocations.PeakBytes.load());
+			memory["psos"] = nullRHI->GetPSOCount();
+			memory["shaders"] = static_cast<Json::UInt64>(allocations.CreatedShaders.load());
+		}
+
+		if (mCurrentSandbox)
+		{
+			// plan of the last frame (compiled on the CPU, so it is the same for the null RHI)
+			const ER_RenderGraph& renderGraph = mCurrentSandbox->GetRenderGraph();
+			const ER_RenderGraphStats& graphStats = renderGraph.GetStats();
+			Json::Value& graph = root["render_graph"];
+			graph["passes"] = graphStats.PassesCount;
+			graph["culled_passes"] = graphStats.CulledPassesCount;
+			graph["transient_textures"] = graphStats.TransientTexturesCount;
+			graph["physical_textures"] = graphStats.PhysicalTexturesCount;
+			graph["barriers"] = graphStats.BarriersCount;
+			graph["barrier_batches"] = graphStats.BarrierBatchesCount;
+			graph["plan"] = renderGraph.DumpPlan();
+		}
+
+		mHeadlessTestsPassed = RunTests();
+		root["tests_passed"] = mHeadlessTestsPassed;
+
+		std::string path = ER_Utility::GetFilePath(std::string(ER_CPU_PROFILER_TRACE_DIRECTORY) + "headless_" + mHeadlessSceneName + ".json");
+		std::string directory;
+		ER_Utility::GetDirectory(path, directory);
+		ER_Utility::CreateDirectories(directory);
+
+		Json::StreamWriterBuilder builder;
+		std::unique_ptr<Json::StreamWriter> writer(builder.newStreamWriter());
+		std::ofstream file(path.c_str(), std::ios::trunc);
+		if (file.is_open())
+			writer->write(root, &file);
+		else
+		{
+			message = "[ER Logger][ER_RuntimeCore] Could not write headless replay report: " + path + "\n";
+			ER_OUTPUT_LOG(ER_Utility::ToWideString(message).c_str());
+		}
+	}
+
+	// All the engine's tests (the same ones that the ImGui buttons run), each one logs its results
+	bool ER_RuntimeCore::RunTests()
+	{
+		// every test runs, even after a failure
+		bool isPassed = ER_SceneBVH::RunTests();
+		isPassed = ER_SphericalHarmonics::RunTests(mJobSystem) && isPassed;
+		isPassed = ER_ClusteredLighting::RunTests() && isPassed;
+		isPassed = ER_RenderGraph::RunTests() && isPassed;
+
+		std::string message = std::string("[ER Logger][ER_RuntimeCore] Tests ") + (isPassed ? "passed" : "FAILED") + "\n";
+		ER_OUTPUT_LOG(ER_Utility::ToWideString(message).c_str());
+		return isPassed;
+	}
+}
@@ -1,5 +1,7 @@
 #pragma once
 #define MAX_SCENES_COUNT 25
+#define HEADLESS_REPLAY_WARMUP_FRAMES 2 // not measured (first frames initialize PSOs, upload data, etc.)
+#define HEADLESS_REPLAY_DEFAULT_FRAMES 300
 
 #include "ER_Core.h"
 #include "Common.h"
@@ -12,6 +14,8 @@ namespace EveryRay_Core
 	class ER_CameraFPS;
 	class ER_Editor;
 	class ER_QuadRenderer;
+	class ER_JobSystem;
+	class ER_AssetRegistry;
 	
 	enum GraphicsQualityPreset
 	{
@@ -33,6 +37,13 @@ namespace EveryRay_Core
 		virtual void Update(const ER_CoreTime& gameTime) override;
 		virtual void Draw(const ER_CoreTime& gameTime) override;	
 
+		// Replays the scene for a number of frames (normally with ER_RHI_Null and a hidden window), then writes the statistics
+		// (CPU frame time, draw calls, state changes, etc.) to the log and to a report file and exits. Call before Run().
+		void SetHeadlessReplay(const std::string& aSceneName, UINT aFrameCount = HEADLESS_REPLAY_DEFAULT_FRAMES);
+		bool IsHeadless() const { return mHeadlessFrameCount > 0; }
+		// False if any of the engine's tests (RunTests()) failed at the end of the headless replay (non-zero exit code)
+		bool HasHeadlessReplayPassed() const { return mHeadlessTestsPassed; }
+
 	protected:
 		virtual void Shutdown() override;
 	
@@ -41,6 +52,9 @@ namespace EveryRay_Core
 		void LoadGraphicsConfig();
 		void SetLevel(const std::string& aSceneName, bool isFirstLoad = false);
 		void UpdateImGui();
+		void UpdateHeadlessReplay();
+		void FinishHeadlessReplay();
+		bool RunTests();
 
 		static const XMVECTORF32 BackgroundColor;
 		static const XMVECTORF32 BackgroundColor2;
@@ -52,6 +66,8 @@ namespace EveryRay_Core
 		ER_CameraFPS* mCamera;
 		ER_Editor* mEditor;
 		ER_QuadRenderer* mQuadRenderer;
+		ER_JobSystem* mJobSystem;
+		ER_AssetRegistry* mAssetRegistry;
 
 		ER_RHI_Viewport mMainViewport;
 
@@ -71,5 +87,11 @@ namespace EveryRay_Core
 		bool mIsRHIReset = false;
 
 		GraphicsQualityPreset mCurrentGfxQuality;
+
+		std::string mHeadlessSceneName;
+		UINT mHeadlessFrameCount = 0;
+		UINT mHeadlessFrameIndex = 0;
+		std::vector<double> mHeadlessFrameTimesMs; // CPU (update + render)
+		bool mHeadlessTestsPassed = true;
 	};
 }
\ No newline at end of file
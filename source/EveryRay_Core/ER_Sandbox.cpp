@@ -21,13 +21,20 @@
 #include "ER_VolumetricFog.h"
 #include "ER_Illumination.h"
 #include "ER_LightProbesManager.h"
+#include "ER_RenderingObject.h"
+#include "ER_JobSystem.h"
+#include "ER_GPUInstanceCuller.h"
+#include "ER_AssetRegistry.h"
 
 #include "RHI/ER_RHI.h"
+#include "RHI/ER_RHI_ShaderCache.h"
 
 namespace EveryRay_Core {
 
 	ER_Sandbox::ER_Sandbox()
 	{
+		for (int i = 0; i < NUM_SHADOW_CASCADES; i++)
+			mShadowMapsGraphNames[i] = "Shadow Map #" + std::to_string(i);
 	}
 	ER_Sandbox::~ER_Sandbox()
 	{
@@ -52,6 +59,7 @@ namespace EveryRay_Core {
 		DeleteObject(mScene);
 		DeleteObject(mLightProbesManager);
 		DeleteObject(mTerrain);
+		DeleteObject(mGPUInstanceCuller);
 		game.CPUProfiler()->EndCPUTime("Destroying scene: " + mName);
 	}
 
@@ -62,6 +70,10 @@ namespace EveryRay_Core {
 		ER_RHI* rhi = game.GetRHI();
 		assert(rhi);
 
+		ER_RHI_ShaderCache* shaderCache = rhi->GetShaderCache();
+		if (shaderCache)
+			shaderCache->Reset(); // shaders edited since the last level load are re-hashed (and recompiled)
+
 		rhi->BeginGraphicsCommandList(rhi->GetPrepareGraphicsCommandListIndex()); // for texture loading etc. (everything before the first frame starts)
 		rhi->SetGPUDescriptorHeap(ER_RHI_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, true);
 
@@ -94,6 +106,11 @@ namespace EveryRay_Core {
         game.CPUProfiler()->EndCPUTime("Gbuffer init");
 #pragma endregion
 
+		#pragma region INIT_GPU_INSTANCE_CULLER
+		if (ER_GPUInstanceCuller::IsSupported(rhi))
+			mGPUInstanceCuller = new ER_GPUInstanceCuller(rhi);
+#pragma endregion
+
 		#pragma region INIT_CONTROLS
         mKeyboard = (ER_Keyboard*)game.GetServices().FindService(ER_Keyboard::TypeIdClass());
         assert(mKeyboard);
@@ -223,6 +240,27 @@ namespace EveryRay_Core {
 		game.CPUProfiler()->EndCPUTime("Material callbacks init");
 #pragma endregion
 
+		#pragma region WAIT_FOR_SHADERS
+		// systems above only request their shaders (misses are compiled on the job system) and wait on the first use,
+		// so the scopes above do not include compilation; it is reported here separately
+		if (shaderCache)
+		{
+			game.CPUProfiler()->BeginCPUTime("Shaders: waiting for compilation");
+			shaderCache->WaitForAll();
+			game.CPUProfiler()->EndCPUTime("Shaders: waiting for compilation");
+
+			const ER_RHI_ShaderCacheStats& stats = shaderCache->GetStats();
+			game.CPUProfiler()->LogCPUTime("Shaders: compilation (" + std::to_string(stats.CompiledCount) + " shaders, summed over threads)", stats.CompileTimeSeconds);
+			game.CPUProfiler()->LogCPUTime("Shaders: main thread blocked on compilation", stats.WaitTimeSeconds);
+
+			std::string message = "[ER Logger][ER_Sandbox] Shaders: " + std::to_string(stats.RequestsCount) + " requests, " +
+				std::to_string(stats.DiskHitsCount) + " loaded from disk cache, " + std::to_string(stats.CompiledCount) + " compiled, " +
+				std::to_string(stats.MemoryHitsCount + stats.CoalescedCount) + " shared (" + std::to_string(stats.CoalescedCount) + " while in flight), " +
+				std::to_string(stats.FailedCount) + " failed\n";
+			ER_OUTPUT_LOG(ER_Utility::ToWideString(message).c_str());
+		}
+#pragma endregion
+
 		rhi->EndGraphicsCommandList(rhi->GetPrepareGraphicsCommandListIndex());
 		rhi->ExecuteCommandLists(rhi->GetPrepareGraphicsCommandListIndex());
 
@@ -240,6 +278,7 @@ namespace EveryRay_Core {
 
 	void ER_Sandbox::Update(ER_Core& game, const ER_CoreTime& gameTime)
 	{
+		ER_CPU_PROFILE_SCOPE(game.CPUProfiler(), "ER_Sandbox::Update");
 		//TODO refactor to updates for elements of ER_CoreComponent type
 
 		//TODO refactor skybox updates
@@ -266,12 +305,99 @@ namespace EveryRay_Core {
 			((ER_Camera*)game.GetServices().FindService(ER_Camera::TypeIdClass()))->ViewMatrix4X4(),
 			((ER_Camera*)game.GetServices().FindService(ER_Camera::TypeIdClass()))->ProjectionMatrix4X4()); //TODO refactor to DebugRenderer
 
-		for (auto& object : mScene->objects)
-			object.second->Update(gameTime);
+		UpdateObjects(game, gameTime, static_cast<UINT>(mScene->objects.size()));
+		{
+			ER_CPU_PROFILE_SCOPE(game.CPUProfiler(), "ER_Sandbox::Update - Scene BVH");
+			ER_Camera* camera = (ER_Camera*)game.GetServices().FindService(ER_Camera::TypeIdClass());
+			mScene->UpdateSpatialIndex();
+			if (camera)
+				mScene->CullObjects(camera->GetFrustum(), mShadowMapper);
+		}
+		mIllumination->CPUCullObjectsAgainstVoxelCascades(mScene); // before UpdateGPU() (uploads the voxel cascades' instance lists)
+		{
+			ER_CPU_PROFILE_SCOPE(game.CPUProfiler(), "ER_Sandbox::Update - Objects (GPU)");
+			mInstanceBuffersUploadedBytes = 0;
+			mInstanceBuffersUploadsCount = 0;
+			ER_Camera* camera = (ER_Camera*)game.GetServices().FindService(ER_Camera::TypeIdClass());
+			for (auto& object : mScene->objects)
+			{
+				object.second->UpdateGPU(gameTime);
+				if (mGPUInstanceCuller && camera && object.second->IsInstanced())
+					object.second->PerformGPUFrustumCull(mGPUInstanceCuller, camera);
+				mInstanceBuffersUploadedBytes += object.second->GetInstanceBuffersUploadedBytes();
+				mInstanceBuffersUploadsCount += object.second->GetInstanceBuffersUploadsCount();
+				if (camera)
+					object.second->RequestTexturesStreaming(*camera);
+			}
+		}
+		{
+			ER_CPU_PROFILE_SCOPE(game.CPUProfiler(), "ER_Sandbox::Update - Texture streaming");
+			ER_AssetRegistry* assetRegistry = (ER_AssetRegistry*)game.GetServices().FindService(ER_AssetRegistry::TypeIdClass());
+			if (assetRegistry)
+				assetRegistry->UpdateTextureStreaming();
+		}
+		mUploadRingStats = game.GetRHI()->GetUploadRingStats();
+		mBindingStats = game.GetRHI()->GetBindingStats();
 
         UpdateImGui();
 	}
 
+	// CPU part of objects' update (culling, LODs, etc.) is independent per object, so we run it on the job system
+	void ER_Sandbox::UpdateObjects(ER_Core& game, const ER_CoreTime& gameTime, UINT objectsCount)
+	{
+		ER_CPU_PROFILE_SCOPE(game.CPUProfiler(), "ER_Sandbox::Update - Objects (CPU)");
+		assert(objectsCount <= mScene->objects.size());
+
+		ER_JobSystem* jobSystem = (ER_JobSystem*)game.GetServices().FindService(ER_JobSystem::TypeIdClass());
+		if (!jobSystem)
+		{
+			for (UINT i = 0; i < objectsCount; i++)
+				mScene->objects[i].second->UpdateCPU(gameTime);
+			return;
+		}
+
+		jobSystem->ParallelFor(objectsCount, OBJECTS_UPDATE_BATCH_SIZE, [this, &gameTime](UINT begin, UINT end)
+		{
+			for (UINT i = begin; i < end; i++)
+				mScene->objects[i].second->UpdateCPU(gameTime);
+		});
+	}
+
+	void ER_Sandbox::RunObjectsUpdateBenchmark(ER_Core& game, const ER_CoreTime& gameTime)
+	{
+		ER_JobSystem* jobSystem = (ER_JobSystem*)game.GetServices().FindService(ER_JobSystem::TypeIdClass());
+		assert(jobSystem);
+
+		const int iterations = 20;
+		const UINT totalObjectsCount = static_cast<UINT>(mScene->objects.size());
+		if (totalObjectsCount == 0)
+			return;
+		const UINT originalWorkerCount = jobSystem->GetWorkerCount();
+
+		std::string message = "[ER Logger][ER_Sandbox] Objects update benchmark (" + std::to_string(iterations) + " iterations, " + mName + "):\n";
+		ER_OUTPUT_LOG(ER_Utility::ToWideString(message).c_str());
+
+		for (UINT workerCount = 1; workerCount <= ER_JobSystem::GetMaxWorkerCount(); workerCount *= 2)
+		{
+			jobSystem->SetWorkerCount(workerCount);
+			const UINT objectsCounts[] = { std::max(1u, totalObjectsCount / 4), std::max(1u, totalObjectsCount / 2), totalObjectsCount };
+			for (UINT objectsCount : objectsCounts)
+			{
+				auto startTimer = std::chrono::high_resolution_clock::now();
+				for (int i = 0; i < iterations; i++)
+					UpdateObjects(game, gameTime, objectsCount);
+				auto endTimer = std::chrono::high_resolution_clock::now();
+
+				double updateTimeMs = std::chrono::duration<double, std::milli>(endTimer - startTimer).count() / iterations;
+				message = "[ER Logger][ER_Sandbox] Worker threads: " + std::to_string(workerCount) + ", objects: " + std::to_string(objectsCount) +
+					", update: " + std::to_string(updateTimeMs) + " ms\n";
+				ER_OUTPUT_LOG(ER_Utility::ToWideString(message).c_str());
+			}
+		}
+
+		jobSystem->SetWorkerCount(originalWorkerCount);
+	}
+
     void ER_Sandbox::UpdateImGui()
     {
         ImGui::Begin("Systems Config");
@@ -294,6 +420,23 @@ namespace EveryRay_Core {
 		if (ImGui::Button("Terrain"))
 			mTerrain->Config();
 
+		ImGui::Text("Instance buffers upload: %.1f KB/frame (%u uploads)", static_cast<float>(mInstanceBuffersUploadedBytes) / 1024.0f, mInstanceBuffersUploadsCount);
+		{
+			const ER_RHI_UploadRingStats& ringStats = mUploadRingStats;
+			ImGui::Text("Upload ring: %.1f / %.1f KB/frame (peak: %.1f KB, %u allocations, %u overflows)", static_cast<float>(ringStats.AllocatedBytes) / 1024.0f,
+				static_cast<float>(ringStats.CapacityBytes) / 1024.0f, static_cast<float>(ringStats.PeakAllocatedBytes) / 1024.0f, ringStats.AllocationsCount, ringStats.OverflowsCount);
+		}
+		ImGui::Text("RHI binds: %u issued, %u filtered as redundant", mBindingStats.IssuedBindsCount, mBindingStats.FilteredBindsCount);
+		{
+			const ER_RenderGraphStats& graphStats = mRenderGraph.GetStats();
+			ImGui::Text("Render graph: %u passes (%u culled), %u transient RTs in %u textures, %u barriers in %u batches", graphStats.PassesCount, graphStats.CulledPassesCount,
+				graphStats.TransientTexturesCount, graphStats.PhysicalTexturesCount, graphStats.BarriersCount, graphStats.BarrierBatchesCount);
+			if (ImGui::Button("Dump render graph plan (output in log)"))
+				mDumpRenderGraphPlan = true;
+			if (ImGui::Button("Run render graph tests (output in log)"))
+				ER_RenderGraph::RunTests();
+		}
+
 		if (ImGui::CollapsingHeader("Wind"))
 		{
 			ImGui::SliderFloat("Wind strength", &mWindStrength, 0.0f, 100.0f);
@@ -309,160 +452,249 @@ namespace EveryRay_Core {
 
 	void ER_Sandbox::Draw(ER_Core& game, const ER_CoreTime& gameTime)
 	{
+		ER_CPU_PROFILE_SCOPE(game.CPUProfiler(), "ER_Sandbox::Draw");
 		ER_RHI* rhi = game.GetRHI();
 		rhi->SetTopologyType(ER_RHI_PRIMITIVE_TYPE::ER_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-		
-		#pragma region DRAW_GBUFFER
-		rhi->BeginEventTag("EveryRay: GBuffer");
-		{
-			mGBuffer->Start();
 
-			rhi->BeginEventTag("EveryRay: GBuffer (objects)");
-			mGBuffer->Draw(mScene);
-			rhi->EndEventTag();
+		// The frame is declared as a render graph: passes are culled/ordered and their barriers are batched by the graph,
+		// transient RTs (post processing) are aliased. Systems that own their intermediate textures are passes with side effects.
+		mRenderGraph.Reset();
 
-			rhi->BeginEventTag("EveryRay: GBuffer (terrain)");
-			if (mTerrain)
-			{
-				mTerrain->Draw(TerrainRenderPass::TERRAIN_GBUFFER,
-					{ mGBuffer->GetAlbedo(), mGBuffer->GetNormals(), mGBuffer->GetPositions(), mGBuffer->GetExtraBuffer(), mGBuffer->GetExtra2Buffer() }, mGBuffer->GetDepth());
-			}
-			rhi->EndEventTag();
+		const ER_RenderGraphResource gbufferAlbedo = mRenderGraph.ImportTexture("GBuffer Albedo", mGBuffer->GetAlbedo());
+		const ER_RenderGraphResource gbufferNormals = mRenderGraph.ImportTexture("GBuffer Normals", mGBuffer->GetNormals());
+		const ER_RenderGraphResource gbufferPositions = mRenderGraph.ImportTexture("GBuffer Positions", mGBuffer->GetPositions());
+		const ER_RenderGraphResource gbufferExtra = mRenderGraph.ImportTexture("GBuffer Extra", mGBuffer->GetExtraBuffer());
+		const ER_RenderGraphResource gbufferExtra2 = mRenderGraph.ImportTexture("GBuffer Extra2", mGBuffer->GetExtra2Buffer());
+		const ER_RenderGraphResource gbufferDepth = mRenderGraph.ImportTexture("GBuffer Depth", mGBuffer->GetDepth());
+		const ER_RenderGraphResource gbufferTargets[] = { gbufferAlbedo, gbufferNormals, gbufferPositions, gbufferExtra, gbufferExtra2 };
+
+		ER_RenderGraphResource shadowMaps[NUM_SHADOW_CASCADES];
+		for (int i = 0; i < NUM_SHADOW_CASCADES; i++)
+			shadowMaps[i] = mRenderGraph.ImportTexture(mShadowMapsGraphNames[i].c_str(), mShadowMapper->GetShadowTexture(i));
+
+		const ER_RenderGraphResource localIllumination = mRenderGraph.ImportTexture("Local Illumination RT", mIllumination->GetLocalIlluminationRT());
+		const ER_RenderGraphResource finalIllumination = mRenderGraph.ImportTexture("Final Illumination RT", mIllumination->GetFinalIlluminationRT());
 
-			rhi->BeginEventTag("EveryRay: GBuffer (foliage)");
-			if (mFoliageSystem)
+		#pragma region DRAW_GBUFFER
+		mRenderGraph.AddPass("GBuffer",
+			[&](ER_RenderGraphBuilder& builder)
 			{
-				mFoliageSystem->Draw(gameTime, nullptr, FoliageRenderingPass::FOLIAGE_GBUFFER,
-					{ mGBuffer->GetAlbedo(), mGBuffer->GetNormals(), mGBuffer->GetPositions(), mGBuffer->GetExtraBuffer(), mGBuffer->GetExtra2Buffer() }, mGBuffer->GetDepth());
-			}
-			rhi->EndEventTag();
+				for (ER_RenderGraphResource target : gbufferTargets)
+					builder.Write(target);
+				builder.Write(gbufferDepth, ER_RESOURCE_STATE_DEPTH_WRITE);
+			},
+			[&](ER_RHI* rhi, const ER_RenderGraph& graph)
+			{
+				ER_CPU_PROFILE_SCOPE(game.CPUProfiler(), "ER_Sandbox::Draw - GBuffer");
+				mGBuffer->Start();
 
-			mGBuffer->End();
-		}
-		rhi->EndEventTag();
+				rhi->BeginEventTag("EveryRay: GBuffer (objects)");
+				mGBuffer->Draw(mScene);
+				rhi->EndEventTag();
+
+				rhi->BeginEventTag("EveryRay: GBuffer (terrain)");
+				if (mTerrain)
+				{
+					mTerrain->Draw(TerrainRenderPass::TERRAIN_GBUFFER,
+						{ mGBuffer->GetAlbedo(), mGBuffer->GetNormals(), mGBuffer->GetPositions(), mGBuffer->GetExtraBuffer(), mGBuffer->GetExtra2Buffer() }, mGBuffer->GetDepth());
+				}
+				rhi->EndEventTag();
+
+				rhi->BeginEventTag("EveryRay: GBuffer (foliage)");
+				if (mFoliageSystem)
+				{
+					mFoliageSystem->Draw(gameTime, nullptr, FoliageRenderingPass::FOLIAGE_GBUFFER,
+						{ mGBuffer->GetAlbedo(), mGBuffer->GetNormals(), mGBuffer->GetPositions(), mGBuffer->GetExtraBuffer(), mGBuffer->GetExtra2Buffer() }, mGBuffer->GetDepth());
+				}
+				rhi->EndEventTag();
+
+				mGBuffer->End();
+			});
 #pragma endregion
 		
 		#pragma region DRAW_SHADOWS
-		rhi->BeginEventTag("EveryRay: Shadow Maps");
-		{
-			mShadowMapper->Draw(mScene, mTerrain);
-		}
-		rhi->EndEventTag();
+		mRenderGraph.AddPass("Shadow Maps",
+			[&](ER_RenderGraphBuilder& builder)
+			{
+				for (ER_RenderGraphResource shadowMap : shadowMaps)
+					builder.Write(shadowMap, ER_RESOURCE_STATE_DEPTH_WRITE);
+			},
+			[&](ER_RHI* rhi, const ER_RenderGraph& graph)
+			{
+				ER_CPU_PROFILE_SCOPE(game.CPUProfiler(), "ER_Sandbox::Draw - Shadow Maps");
+				mShadowMapper->Draw(mScene, mTerrain);
+			});
 #pragma endregion
 		
 		#pragma region DRAW_GLOBAL_ILLUMINATION
-		rhi->BeginEventTag("EveryRay: Compute/load light probes");
-		{
-			// compute static GI (load probes if they exist on disk, otherwise - compute them)
+		mRenderGraph.AddPass("Compute/load light probes",
+			[&](ER_RenderGraphBuilder& builder)
+			{
+				builder.SetSideEffect(); // probes are stored in the light probes manager
+			},
+			[&](ER_RHI* rhi, const ER_RenderGraph& graph)
 			{
-				if (mScene->HasLightProbesSupport() && !mLightProbesManager->AreProbesReady())
+				ER_CPU_PROFILE_SCOPE(game.CPUProfiler(), "ER_Sandbox::Draw - Compute/load light probes");
+				// compute static GI (load probes if they exist on disk, otherwise - compute them)
 				{
-					game.CPUProfiler()->BeginCPUTime("Compute or load light probes");
-					mLightProbesManager->ComputeOrLoadLocalProbes(game, mScene->objects, mSkybox);
-					mLightProbesManager->ComputeOrLoadGlobalProbes(game, mScene->objects, mSkybox);
-					game.CPUProfiler()->EndCPUTime("Compute or load light probes");
+					if (mScene->HasLightProbesSupport() && !mLightProbesManager->AreProbesReady())
+					{
+						game.CPUProfiler()->BeginCPUTime("Compute or load light probes");
+						mLightProbesManager->ComputeOrLoadLocalProbes(game, mScene->objects, mSkybox);
+						mLightProbesManager->ComputeOrLoadGlobalProbes(game, mScene->objects, mSkybox);
+						game.CPUProfiler()->EndCPUTime("Compute or load light probes");
+					}
+					else if (!mLightProbesManager->IsEnabled() && !mLightProbesManager->AreGlobalProbesReady())
+						mLightProbesManager->ComputeOrLoadGlobalProbes(game, mScene->objects, mSkybox);
 				}
-				else if (!mLightProbesManager->IsEnabled() && !mLightProbesManager->AreGlobalProbesReady())
-					mLightProbesManager->ComputeOrLoadGlobalProbes(game, mScene->objects, mSkybox);
-			}
-		}
-		rhi->EndEventTag();
+			});
 
 		// compute dynamic GI
-		rhi->BeginEventTag("EveryRay: Dynamic Global Illumination");
-		{
-			mIllumination->DrawDynamicGlobalIllumination(mGBuffer, gameTime);
-		}
-		rhi->EndEventTag();
+		mRenderGraph.AddPass("Dynamic Global Illumination",
+			[&](ER_RenderGraphBuilder& builder)
+			{
+				for (ER_RenderGraphResource target : gbufferTargets)
+					builder.Read(target, ER_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+				for (ER_RenderGraphResource shadowMap : shadowMaps)
+					builder.Read(shadowMap, ER_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+				builder.SetSideEffect(); // voxel cascades and GI targets are owned by the illumination system
+			},
+			[&](ER_RHI* rhi, const ER_RenderGraph& graph)
+			{
+				ER_CPU_PROFILE_SCOPE(game.CPUProfiler(), "ER_Sandbox::Draw - Dynamic Global Illumination");
+				mIllumination->DrawDynamicGlobalIllumination(mGBuffer, gameTime);
+			});
 #pragma endregion
 
 		#pragma region DRAW_LOCAL_ILLUMINATION
-		rhi->BeginEventTag("EveryRay: Local Illumination");
-		{
-			mIllumination->DrawLocalIllumination(mGBuffer, mSkybox);
-			ER_RHI_GPUTexture* localRT = mIllumination->GetLocalIlluminationRT();
-
-			//Terrain rendering is now in deferred; uncomment code below if you want to render in forward
-			// rhi->BeginEventTag("EveryRay: Forward Lighting (terrain)");
-			// 
-			//#pragma region DRAW_TERRAIN_FORWARD
-			//if (mTerrain)
-			//	mTerrain->Draw(TerrainRenderPass::FORWARD, localRT, mShadowMapper, mLightProbesManager);
-			// rhi->EndEventTag();
-			//#pragma endregion
-		}
-		rhi->EndEventTag();
+		mRenderGraph.AddPass("Local Illumination",
+			[&](ER_RenderGraphBuilder& builder)
+			{
+				for (ER_RenderGraphResource target : gbufferTargets)
+					builder.Read(target, ER_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+				for (ER_RenderGraphResource shadowMap : shadowMaps)
+					builder.Read(shadowMap, ER_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+				builder.Write(gbufferDepth, ER_RESOURCE_STATE_DEPTH_WRITE); // skybox
+				builder.Write(localIllumination);
+			},
+			[&](ER_RHI* rhi, const ER_RenderGraph& graph)
+			{
+				ER_CPU_PROFILE_SCOPE(game.CPUProfiler(), "ER_Sandbox::Draw - Local Illumination");
+				mIllumination->DrawLocalIllumination(mGBuffer, mSkybox);
+
+				//Terrain rendering is now in deferred; uncomment code below if you want to render in forward
+				// rhi->BeginEventTag("EveryRay: Forward Lighting (terrain)");
+				// 
+				//#pragma region DRAW_TERRAIN_FORWARD
+				//if (mTerrain)
+				//	mTerrain->Draw(TerrainRenderPass::FORWARD, graph.GetTexture(localIllumination), mShadowMapper, mLightProbesManager);
+				// rhi->EndEventTag();
+				//#pragma endregion
+			});
 #pragma endregion
 
 		#pragma region DRAW_DEBUG_GIZMOS
 		// TODO: consider moving all debug gizmos to a separate debug renderer system
 		if (ER_Utility::IsEditorMode)
 		{
-			rhi->BeginEventTag("EveryRay: Debug gizmos");
-			{
-				ER_RHI_GPUTexture* localRT = mIllumination->GetLocalIlluminationRT();
-
-				mIllumination->DrawDebugProbes(localRT, mGBuffer->GetDepth());
-
-				rhi->SetTopologyType(ER_RHI_PRIMITIVE_TYPE::ER_PRIMITIVE_TOPOLOGY_LINELIST);
-				ER_RHI_GPURootSignature* debugGizmoRootSignature = mScene->GetStandardMaterialRootSignature(ER_MaterialHelper::basicColorMaterialName);
-				rhi->SetRootSignature(debugGizmoRootSignature);
+			mRenderGraph.AddPass("Debug gizmos",
+				[&](ER_RenderGraphBuilder& builder)
 				{
-					mIllumination->DrawDebugGizmos(localRT, mGBuffer->GetDepth(), debugGizmoRootSignature);
-					mDirectionalLight->DrawProxyModel(localRT, mGBuffer->GetDepth(), gameTime, debugGizmoRootSignature);
-					if (mTerrain)
-						mTerrain->DrawDebugGizmos(localRT, mGBuffer->GetDepth(), debugGizmoRootSignature);
-					if (mFoliageSystem)
-						mFoliageSystem->DrawDebugGizmos(localRT, mGBuffer->GetDepth(), debugGizmoRootSignature);
-					for (auto& it = mScene->objects.begin(); it != mScene->objects.end(); it++)
-						it->second->DrawAABB(localRT, mGBuffer->GetDepth(), debugGizmoRootSignature);
-				}
-				rhi->SetTopologyType(ER_RHI_PRIMITIVE_TYPE::ER_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-			}
-			rhi->EndEventTag();
+					builder.Write(localIllumination);
+					builder.Write(gbufferDepth, ER_RESOURCE_STATE_DEPTH_WRITE);
+				},
+				[&](ER_RHI* rhi, const ER_RenderGraph& graph)
+				{
+					ER_CPU_PROFILE_SCOPE(game.CPUProfiler(), "ER_Sandbox::Draw - Debug gizmos");
+					ER_RHI_GPUTexture* localRT = graph.GetTexture(localIllumination);
+					ER_RHI_GPUTexture* depth = graph.GetTexture(gbufferDepth);
+
+					mIllumination->DrawDebugProbes(localRT, depth);
+
+					rhi->SetTopologyType(ER_RHI_PRIMITIVE_TYPE::ER_PRIMITIVE_TOPOLOGY_LINELIST);
+					ER_RHI_GPURootSignature* debugGizmoRootSignature = mScene->GetStandardMaterialRootSignature(ER_MaterialHelper::basicColorMaterialName);
+					rhi->SetRootSignature(debugGizmoRootSignature);
+					{
+						mIllumination->DrawDebugGizmos(localRT, depth, debugGizmoRootSignature);
+						mDirectionalLight->DrawProxyModel(localRT, depth, gameTime, debugGizmoRootSignature);
+						if (mTerrain)
+							mTerrain->DrawDebugGizmos(localRT, depth, debugGizmoRootSignature);
+						if (mFoliageSystem)
+							mFoliageSystem->DrawDebugGizmos(localRT, depth, debugGizmoRootSignature);
+						for (auto& it = mScene->objects.begin(); it != mScene->objects.end(); it++)
+							it->second->DrawAABB(localRT, depth, debugGizmoRootSignature);
+					}
+					rhi->SetTopologyType(ER_RHI_PRIMITIVE_TYPE::ER_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+				});
 		}
 #pragma endregion
 		
 		// combine the results of local and global illumination
-		rhi->BeginEventTag("EveryRay: Composite Illumination");
-		{
-			mIllumination->CompositeTotalIllumination();
-		}
-		rhi->EndEventTag();
+		mRenderGraph.AddPass("Composite Illumination",
+			[&](ER_RenderGraphBuilder& builder)
+			{
+				builder.Read(localIllumination, ER_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+				builder.Write(finalIllumination, ER_RESOURCE_STATE_UNORDERED_ACCESS);
+			},
+			[&](ER_RHI* rhi, const ER_RenderGraph& graph)
+			{
+				ER_CPU_PROFILE_SCOPE(game.CPUProfiler(), "ER_Sandbox::Draw - Composite Illumination");
+				mIllumination->CompositeTotalIllumination();
+			});
 
 		#pragma region DRAW_VOLUMETRIC_FOG
-		rhi->BeginEventTag("EveryRay: Volumetric Fog");
-		{
-			mVolumetricFog->Draw();
-		}
-		rhi->EndEventTag();
+		mRenderGraph.AddPass("Volumetric Fog",
+			[&](ER_RenderGraphBuilder& builder)
+			{
+				for (ER_RenderGraphResource shadowMap : shadowMaps)
+					builder.Read(shadowMap, ER_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+				builder.SetSideEffect(); // fog volumes are owned by the volumetric fog system
+			},
+			[&](ER_RHI* rhi, const ER_RenderGraph& graph)
+			{
+				ER_CPU_PROFILE_SCOPE(game.CPUProfiler(), "ER_Sandbox::Draw - Volumetric Fog");
+				mVolumetricFog->Draw();
+			});
 #pragma endregion
 
 		#pragma region DRAW_VOLUMETRIC_CLOUDS
-		rhi->BeginEventTag("EveryRay: Volumetric Clouds");
-		{
-			mVolumetricClouds->Draw(gameTime);
-		}
-		rhi->EndEventTag();
+		mRenderGraph.AddPass("Volumetric Clouds",
+			[&](ER_RenderGraphBuilder& builder)
+			{
+				builder.SetSideEffect(); // clouds targets are owned by the volumetric clouds system
+			},
+			[&](ER_RHI* rhi, const ER_RenderGraph& graph)
+			{
+				ER_CPU_PROFILE_SCOPE(game.CPUProfiler(), "ER_Sandbox::Draw - Volumetric Clouds");
+				mVolumetricClouds->Draw(gameTime);
+			});
 #pragma endregion	
 
 		#pragma region DRAW_POSTPROCESSING
-		rhi->BeginEventTag("EveryRay: Post Processing");
 		{
 			auto quad = (ER_QuadRenderer*)game.GetServices().FindService(ER_QuadRenderer::TypeIdClass());
-			mPostProcessingStack->Begin(mIllumination->GetFinalIlluminationRT(), mGBuffer->GetDepth());
-			mPostProcessingStack->DrawEffects(gameTime, quad, mGBuffer, mVolumetricClouds, mVolumetricFog);
-			mPostProcessingStack->End();
+			mPostProcessingStack->AddPasses(mRenderGraph, mIllumination->GetFinalIlluminationRT(), mGBuffer->GetDepth(), gameTime, quad, mGBuffer, mVolumetricClouds, mVolumetricFog);
 		}
-		rhi->EndEventTag();
 #pragma endregion
 
+		{
+			ER_CPU_PROFILE_SCOPE(game.CPUProfiler(), "ER_Sandbox::Draw - Compile render graph");
+			mRenderGraph.Compile();
+		}
+		if (mDumpRenderGraphPlan)
+		{
+			ER_OUTPUT_LOG(ER_Utility::ToWideString(mRenderGraph.DumpPlan()).c_str());
+			mDumpRenderGraphPlan = false;
+		}
+		mRenderGraph.Execute(rhi);
+
 		// reset back to main RT before UI rendering
 		rhi->SetMainRenderTargets();
 
 		#pragma region DRAW_IMGUI
 		rhi->BeginEventTag("EveryRay: ImGui");
 		{
+			ER_CPU_PROFILE_SCOPE(game.CPUProfiler(), "ER_Sandbox::Draw - ImGui");
 			rhi->SetGPUDescriptorHeapImGui(rhi->GetCurrentGraphicsCommandListIndex());
 
 			ImGui::Render();
@@ -1,5 +1,9 @@
 #pragma once
 #include "Common.h"
+#include "RHI/ER_RHI.h"
+#include "ER_RenderGraph.h"
+
+#define OBJECTS_UPDATE_BATCH_SIZE 4 // amount of scene objects updated by one job
 
 namespace EveryRay_Core
 {
@@ -21,6 +25,7 @@ namespace EveryRay_Core
     class ER_LightProbesManager;
     class ER_PostProcessingStack;
     class ER_QuadRenderer;
+	class ER_GPUInstanceCuller;
 
 	class ER_Sandbox
 	{
@@ -33,6 +38,12 @@ namespace EveryRay_Core
 		virtual void Update(ER_Core& game, const ER_CoreTime& time);
 		virtual void Draw(ER_Core& game, const ER_CoreTime& time);
 
+		// Measures CPU update time of scene objects (ER_RenderingObject::UpdateCPU) for different object and worker thread counts.
+		// Results are written to the log.
+		void RunObjectsUpdateBenchmark(ER_Core& game, const ER_CoreTime& time);
+
+		const ER_RenderGraph& GetRenderGraph() const { return mRenderGraph; }
+
         ER_Scene* mScene = nullptr;
 		ER_Editor* mEditor = nullptr;
         ER_Keyboard* mKeyboard = nullptr;
@@ -48,8 +59,10 @@ namespace EveryRay_Core
         ER_Terrain* mTerrain = nullptr;
         ER_PostProcessingStack* mPostProcessingStack = nullptr;
         ER_QuadRenderer* mQuadRenderer = nullptr;
+		ER_GPUInstanceCuller* mGPUInstanceCuller = nullptr;
     private:
         void UpdateImGui();
+		void UpdateObjects(ER_Core& game, const ER_CoreTime& time, UINT objectsCount);
         std::string mName;
 
         XMMATRIX mDefaultSunRotationMatrix;
@@ -57,6 +70,15 @@ namespace EveryRay_Core
 		float mWindStrength = 1.0f;
 		float mWindFrequency = 1.0f;
 		float mWindGustDistance = 1.0f;
+
+		UINT64 mInstanceBuffersUploadedBytes = 0; // all objects, per frame
+		UINT mInstanceBuffersUploadsCount = 0;
+		ER_RHI_UploadRingStats mUploadRingStats; // of the last frame
+		ER_RHI_BindingStats mBindingStats; // of the last frame
+
+		ER_RenderGraph mRenderGraph; // rebuilt every frame in Draw()
+		std::string mShadowMapsGraphNames[NUM_SHADOW_CASCADES]; // built once, not in Draw()
+		bool mDumpRenderGraphPlan = false;
 	};
 
 }
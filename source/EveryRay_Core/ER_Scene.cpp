@@ -17,6 +17,11 @@
 #include "ER_FoliageManager.h"
 #include "ER_DirectionalLight.h"
 #include "ER_Terrain.h"
+#include "ER_AssetRegistry.h"
+#include "ER_ShadowMapper.h"
+#include "ER_Frustum.h"
+#include "ER_PointLight.h"
+#include "ER_SpotLight.h"
 
 #if defined(DEBUG) || defined(_DEBUG)  
 	#define MULTITHREADED_SCENE_LOAD 0
@@ -34,10 +39,31 @@ namespace EveryRay_Core
 			ER_OUTPUT_LOG(msg.c_str());
 		}
 
+		ER_Model::ResetLoadStatistics();
+
 		Json::Reader reader;
-		std::ifstream scene(path.c_str(), std::ifstream::binary);
+		std::vector<char> sceneText;
+		ER_Utility::LoadBinaryFile(ER_Utility::ToWideString(path), sceneText);
+		mSceneSourceHash = ER_Utility::HashFNV1a(sceneText.data(), sceneText.size());
+
+		// warm load: the settings and the instance transforms come from the cooked scene, so the instance arrays (most of the *.json) are never parsed;
+		// cold load: the whole *.json is parsed and cooked after loading
+		const std::string cookedScenePath = ER_SceneCooker::GetCookedScenePath(path);
+		bool isCookedSceneValid = mCookedScene.Open(cookedScenePath, mSceneSourceHash);
+		if (isCookedSceneValid)
+		{
+			isCookedSceneValid = mCookedScene.ParseSettings(root) && root["rendering_objects"].size() == mCookedScene.GetObjectCount();
+			if (!isCookedSceneValid)
+				mCookedScene.Close();
+		}
+		mIsRootWithoutInstancesTransforms = isCookedSceneValid;
+		if (!isCookedSceneValid)
+		{
+			std::wstring msg = L"[ER Logger][ER_Scene] Cooked scene is missing or outdated, loading the scene from json: " + ER_Utility::ToWideString(cookedScenePath) + L'\n';
+			ER_OUTPUT_LOG(msg.c_str());
+		}
 
-		if (!reader.parse(scene, root)) {
+		if (!isCookedSceneValid && !reader.parse(sceneText.data(), sceneText.data() + sceneText.size(), root)) {
 			throw ER_CoreException(reader.getFormattedErrorMessages().c_str());
 		}
 		else {
@@ -95,6 +121,12 @@ namespace EveryRay_Core
 						mTerrainTileScale = root["terrain_tile_scale"].asFloat();
 					if (root.isMember("terrain_tile_resolution"))
 						mTerrainTileResolution = root["terrain_tile_resolution"].asInt();
+					if (root.isMember("terrain_streaming"))
+						mIsTerrainStreaming = root["terrain_streaming"].asBool();
+					if (root.isMember("terrain_streaming_budget_mb"))
+						mTerrainStreamingBudgetMB = root["terrain_streaming_budget_mb"].asFloat();
+					if (root.isMember("terrain_streaming_distance"))
+						mTerrainStreamingDistance = root["terrain_streaming_distance"].asFloat();
 					std::string fieldName = "terrain_texture_splat_layer";
 					std::wstring result = L"";
 
@@ -140,6 +172,8 @@ namespace EveryRay_Core
 				mLightProbesDiffuseDistance = root["light_probes_diffuse_distance"].asFloat();
 			if (root.isMember("light_probes_specular_distance"))
 				mLightProbesSpecularDistance = root["light_probes_specular_distance"].asFloat();
+			if (root.isMember("light_probes_sparse"))
+				mLightProbesSparse = root["light_probes_sparse"].asBool();
 			}
 
 			if (root.isMember("foliage_zones"))
@@ -151,18 +185,21 @@ namespace EveryRay_Core
 			else
 				mHasVolumetricFog = false;
 
+			LoadLocalLights();
+
 			// add rendering objects to scene
 			unsigned int numRenderingObjects = root["rendering_objects"].size();
 			for (Json::Value::ArrayIndex i = 0; i != numRenderingObjects; i++) {
 				objects.emplace_back(
 					root["rendering_objects"][i]["name"].asString(), 
 					new ER_RenderingObject(root["rendering_objects"][i]["name"].asString(), i, *mCore, mCamera, 
-						std::unique_ptr<ER_Model>(new ER_Model(*mCore, ER_Utility::GetFilePath(root["rendering_objects"][i]["model_path"].asString()), true)),
+						ER_Utility::GetFilePath(root["rendering_objects"][i]["model_path"].asString()),
 						true, root["rendering_objects"][i]["instanced"].asBool())
 				);
 			}
 			std::partition(objects.begin(), objects.end(), [](const ER_SceneObject& obj) {	return obj.second->IsInstanced(); });
 			assert(numRenderingObjects == objects.size());
+			UpdateObjectsNamesIndex(); // before the loading threads (they only read the index)
 
 #if MULTITHREADED_SCENE_LOAD
 			int numThreads = std::thread::hardware_concurrency();
@@ -183,6 +220,7 @@ namespace EveryRay_Core
 			{
 				threads.push_back(std::thread([&, numThreads, numRenderingObjects, objectsPerThread, i]
 				{
+					mCore->CPUProfiler()->SetCurrentThreadName("Scene load " + std::to_string(i));
 					int endRange = (i < numThreads - 1) ? (i + 1) * objectsPerThread : numRenderingObjects;
 
 					for (int j = i * objectsPerThread; j < endRange; j++)
@@ -195,8 +233,27 @@ namespace EveryRay_Core
 			}
 			for (auto& t : threads) t.join();
 
+			// instance transforms are read from the cooked (binary) scene if it is up-to-date with the *.json, otherwise we cook it after loading
 			for (auto& obj : objects)
 				LoadRenderingObjectInstancedData(obj.second);
+
+			mCookedScene.Close();
+			if (!isCookedSceneValid)
+				ER_SceneCooker::WriteCookedScene(cookedScenePath, root, mSceneSourceHash);
+
+			// models loading times: cold - imported by Assimp (+ written to the mesh cache), warm - loaded from the mesh cache
+			{
+				UINT coldLoads = 0, warmLoads = 0;
+				double coldLoadsTime = 0.0, warmLoadsTime = 0.0;
+				ER_Model::GetLoadStatistics(coldLoads, coldLoadsTime, warmLoads, warmLoadsTime);
+				mCore->CPUProfiler()->LogCPUTime("Models cold load (" + std::to_string(coldLoads) + " models, summed over threads)", coldLoadsTime);
+				mCore->CPUProfiler()->LogCPUTime("Models warm load (" + std::to_string(warmLoads) + " models, summed over threads)", warmLoadsTime);
+			}
+
+			// what the level's models & textures cost (shared between objects)
+			ER_AssetRegistry* assetRegistry = (ER_AssetRegistry*)mCore->GetServices().FindService(ER_AssetRegistry::TypeIdClass());
+			if (assetRegistry)
+				assetRegistry->LogStatistics();
 		}
 
 		{
@@ -221,6 +278,9 @@ namespace EveryRay_Core
 
 	ER_Scene::~ER_Scene()
 	{
+		mBVH.Clear();
+		mObjectsByName.clear();
+
 		for (auto& object : objects)
 		{
 			object.second->MeshMaterialVariablesUpdateEvent->RemoveAllListeners();
@@ -228,6 +288,8 @@ namespace EveryRay_Core
 		}
 		objects.clear();
 
+		DeletePointerCollection(mLocalLights);
+
 		for (auto& rs : mStandardMaterialsRootSignatures)
 		{
 			DeleteObject(rs.second);
@@ -239,6 +301,7 @@ namespace EveryRay_Core
 	{
 		if (!aObject)
 			return;
+		ER_CPU_PROFILE_SCOPE(mCore->CPUProfiler(), "ER_Scene::LoadRenderingObjectData");
 
 		int i = aObject->GetIndexInScene();
 		bool isInstanced = aObject->IsInstanced();
@@ -443,7 +506,7 @@ namespace EveryRay_Core
 			if (hasLODs) {
 				for (Json::Value::ArrayIndex lod = 1 /* 0 is main model loaded before */; lod != root["rendering_objects"][i]["model_lods"].size(); lod++) {
 					std::string path = root["rendering_objects"][i]["model_lods"][lod]["path"].asString();
-					aObject->LoadLOD(std::unique_ptr<ER_Model>(new ER_Model(*mCore, ER_Utility::GetFilePath(path), true)));
+					aObject->LoadLOD(ER_Utility::GetFilePath(path));
 				}
 			}
 		}
@@ -472,23 +535,7 @@ namespace EveryRay_Core
 							aObject->AddInstanceData(XMMatrixIdentity(), lod);
 					}
 					else
-					{
-						if (root["rendering_objects"][i].isMember("instances_transforms")) {
-							aObject->ResetInstanceData(root["rendering_objects"][i]["instances_transforms"].size(), true, lod);
-							for (Json::Value::ArrayIndex instance = 0; instance != root["rendering_objects"][i]["instances_transforms"].size(); instance++) {
-								float matrix[16];
-								for (Json::Value::ArrayIndex matC = 0; matC != root["rendering_objects"][i]["instances_transforms"][instance]["transform"].size(); matC++) {
-									matrix[matC] = root["rendering_objects"][i]["instances_transforms"][instance]["transform"][matC].asFloat();
-								}
-								XMFLOAT4X4 worldTransform(matrix);
-								aObject->AddInstanceData(XMMatrixTranspose(XMLoadFloat4x4(&worldTransform)), lod);
-							}
-						}
-						else {
-							aObject->ResetInstanceData(1, true, lod);
-							aObject->AddInstanceData(aObject->GetTransformationMatrix(), lod);
-						}
-					}
+						LoadRenderingObjectInstancesTransforms(aObject, lod);
 					aObject->UpdateInstanceBuffer(aObject->GetInstancesData(), lod);
 				}
 			}
@@ -503,32 +550,73 @@ namespace EveryRay_Core
 						aObject->AddInstanceData(XMMatrixIdentity());
 				}
 				else
-				{
-					if (root["rendering_objects"][i].isMember("instances_transforms")) {
-						aObject->ResetInstanceData(root["rendering_objects"][i]["instances_transforms"].size(), true);
-						for (Json::Value::ArrayIndex instance = 0; instance != root["rendering_objects"][i]["instances_transforms"].size(); instance++) {
-							float matrix[16];
-							for (Json::Value::ArrayIndex matC = 0; matC != root["rendering_objects"][i]["instances_transforms"][instance]["transform"].size(); matC++) {
-								matrix[matC] = root["rendering_objects"][i]["instances_transforms"][instance]["transform"][matC].asFloat();
-							}
-							XMFLOAT4X4 worldTransform(matrix);
-							aObject->AddInstanceData(XMMatrixTranspose(XMLoadFloat4x4(&worldTransform)));
-						}
-					}
-					else {
-						aObject->ResetInstanceData(1, true);
-						aObject->AddInstanceData(aObject->GetTransformationMatrix());
-					}
-				}
+					LoadRenderingObjectInstancesTransforms(aObject, 0);
 				aObject->UpdateInstanceBuffer(aObject->GetInstancesData());
 			}
 		}
 	}
 
+	// [WARNING] NOT THREAD-SAFE!
+	void ER_Scene::LoadRenderingObjectInstancesTransforms(ER_RenderingObject* aObject, int lod)
+	{
+		int i = aObject->GetIndexInScene();
+
+		// fast path: copy the whole block of matrices from the memory-mapped cooked scene
+		UINT cookedInstanceCount = 0;
+		const XMFLOAT4X4* cookedTransforms = mCookedScene.GetInstancesTransforms(i, aObject->GetName(), cookedInstanceCount);
+		if (cookedTransforms)
+		{
+			aObject->ResetInstanceData(cookedInstanceCount, true, lod);
+			aObject->SetInstancesData(cookedTransforms, cookedInstanceCount, lod);
+			return;
+		}
+
+		if (root["rendering_objects"][i].isMember("instances_transforms")) {
+			const Json::Value& instancesTransforms = root["rendering_objects"][i]["instances_transforms"];
+			aObject->ResetInstanceData(instancesTransforms.size(), true, lod);
+			for (Json::Value::ArrayIndex instance = 0; instance != instancesTransforms.size(); instance++) {
+				float matrix[16];
+				for (Json::Value::ArrayIndex matC = 0; matC != instancesTransforms[instance]["transform"].size(); matC++) {
+					matrix[matC] = instancesTransforms[instance]["transform"][matC].asFloat();
+				}
+				XMFLOAT4X4 worldTransform(matrix);
+				aObject->AddInstanceData(XMMatrixTranspose(XMLoadFloat4x4(&worldTransform)), lod);
+			}
+		}
+		else {
+			aObject->ResetInstanceData(1, true, lod);
+			aObject->AddInstanceData(aObject->GetTransformationMatrix(), lod);
+		}
+	}
+
+	// Warm loads only parse the settings of the cooked scene, so before writing the *.json back we need its instance arrays
+	void ER_Scene::RestoreInstancesTransforms()
+	{
+		if (!mIsRootWithoutInstancesTransforms)
+			return;
+
+		Json::Reader reader;
+		Json::Value sourceRoot;
+		std::vector<char> sceneText;
+		ER_Utility::LoadBinaryFile(ER_Utility::ToWideString(mScenePath), sceneText);
+		if (!reader.parse(sceneText.data(), sceneText.data() + sceneText.size(), sourceRoot))
+			throw ER_CoreException(reader.getFormattedErrorMessages().c_str());
+		if (sourceRoot["rendering_objects"].size() != root["rendering_objects"].size())
+			throw ER_CoreException("Can't save to scene json file! Rendering objects of the scene json file have been changed after loading...");
+
+		for (Json::Value::ArrayIndex i = 0; i != root["rendering_objects"].size(); i++)
+		{
+			if (sourceRoot["rendering_objects"][i].isMember("instances_transforms"))
+				root["rendering_objects"][i]["instances_transforms"] = sourceRoot["rendering_objects"][i]["instances_transforms"];
+		}
+		mIsRootWithoutInstancesTransforms = false;
+	}
+
 	void ER_Scene::SaveFoliageZonesTransforms(const std::vector<ER_Foliage*>& foliageZones)
 	{
 		if (mScenePath.empty())
 			throw ER_CoreException("Can't save to scene json file! Empty scene name...");
+		RestoreInstancesTransforms();
 
 		if (root.isMember("foliage_zones")) {
 			assert(foliageZones.size() == root["foliage_zones"].size());
@@ -553,10 +641,11 @@ namespace EveryRay_Core
 		writer->write(root, &file_id);
 	}
 
-	void ER_Scene::SaveRenderingObjectsTransforms()
+	void ER_Scene::SaveRenderingObjectsTransforms(bool toJson, bool toCooked)
 	{
 		if (mScenePath.empty())
 			throw ER_CoreException("Can't save to scene json file! Empty scene name...");
+		RestoreInstancesTransforms();
 
 		// store world transform
 		for (Json::Value::ArrayIndex i = 0; i != root["rendering_objects"].size(); i++) {
@@ -616,12 +705,26 @@ namespace EveryRay_Core
 			}
 		}
 
-		Json::StreamWriterBuilder builder;
-		std::unique_ptr<Json::StreamWriter> writer(builder.newStreamWriter());
+		if (toJson)
+		{
+			Json::StreamWriterBuilder builder;
+			std::unique_ptr<Json::StreamWriter> writer(builder.newStreamWriter());
 
-		std::ofstream file_id;
-		file_id.open(mScenePath.c_str());
-		writer->write(root, &file_id);
+			{
+				std::ofstream file_id;
+				file_id.open(mScenePath.c_str());
+				writer->write(root, &file_id);
+			}
+
+			// rehash what was actually written (text mode may change line endings)
+			std::vector<char> sceneText;
+			ER_Utility::LoadBinaryFile(ER_Utility::ToWideString(mScenePath), sceneText);
+			mSceneSourceHash = ER_Utility::HashFNV1a(sceneText.data(), sceneText.size());
+		}
+
+		// without 'toJson' the cooked scene stays bound to the *.json on disk (its transforms are used until that *.json is changed)
+		if (toCooked)
+			ER_SceneCooker::WriteCookedScene(ER_SceneCooker::GetCookedScenePath(mScenePath), root, mSceneSourceHash);
 	}
 
 	// We cant do reflection in C++, that is why we check every materials name and create a material out of it (and root-signature if needed)
@@ -649,44 +752,98 @@ namespace EveryRay_Core
 		return material;
 	}
 
+	void ER_Scene::LoadLocalLights()
+	{
+		auto readVector = [](const Json::Value& aValue, XMFLOAT3& aOutVector)
+		{
+			float vec3[3] = { aOutVector.x, aOutVector.y, aOutVector.z };
+			for (Json::Value::ArrayIndex i = 0; i != aValue.size() && i < 3; i++)
+				vec3[i] = aValue[i].asFloat();
+			aOutVector = XMFLOAT3(vec3[0], vec3[1], vec3[2]);
+		};
+		auto loadLight = [&](const Json::Value& aLightValue, ER_PointLight* aLight)
+		{
+			XMFLOAT3 position = { 0.0f, 0.0f, 0.0f };
+			if (aLightValue.isMember("position"))
+				readVector(aLightValue["position"], position);
+			aLight->SetPosition(position);
+
+			if (aLightValue.isMember("radius"))
+				aLight->SetRadius(aLightValue["radius"].asFloat());
+
+			XMFLOAT3 color = { 1.0f, 1.0f, 1.0f };
+			if (aLightValue.isMember("color"))
+				readVector(aLightValue["color"], color);
+			XMFLOAT4 colorAndIntensity = XMFLOAT4(color.x, color.y, color.z, aLightValue.isMember("intensity") ? aLightValue["intensity"].asFloat() : 1.0f);
+			aLight->SetColor(colorAndIntensity);
+
+			mLocalLights.push_back(aLight);
+		};
+
+		if (root.isMember("point_lights"))
+		{
+			for (Json::Value::ArrayIndex i = 0; i != root["point_lights"].size(); i++)
+				loadLight(root["point_lights"][i], new ER_PointLight(*mCore));
+		}
+
+		if (root.isMember("spot_lights"))
+		{
+			for (Json::Value::ArrayIndex i = 0; i != root["spot_lights"].size(); i++)
+			{
+				const Json::Value& lightValue = root["spot_lights"][i];
+				ER_SpotLight* spotLight = new ER_SpotLight(*mCore);
+
+				XMFLOAT3 direction = spotLight->Direction();
+				if (lightValue.isMember("direction"))
+					readVector(lightValue["direction"], direction);
+				spotLight->SetDirection(direction);
+				spotLight->SetAngles(
+					lightValue.isMember("inner_angle") ? lightValue["inner_angle"].asFloat() : ER_SpotLight::DefaultInnerAngle,
+					lightValue.isMember("outer_angle") ? lightValue["outer_angle"].asFloat() : ER_SpotLight::DefaultOuterAngle);
+
+				loadLight(lightValue, spotLight);
+			}
+		}
+
+		if (!mLocalLights.empty())
+		{
+			std::wstring msg = L"[ER Logger][ER_Scene] Loaded " + std::to_wstring(mLocalLights.size()) + L" point/spot lights\n";
+			ER_OUTPUT_LOG(msg.c_str());
+		}
+	}
+
 	void ER_Scene::LoadFoliageZones(std::vector<ER_Foliage*>& foliageZones, ER_DirectionalLight& light)
 	{
-		Json::Reader reader;
-		std::ifstream scene(mScenePath.c_str(), std::ifstream::binary);
+		// the scene's json has already been parsed in the constructor (re-parsing it here would also bring back the instance arrays on warm loads)
 		ER_Core* core = GetCore();
 		assert(core);
 
-		if (!reader.parse(scene, root)) {
-			throw ER_CoreException(reader.getFormattedErrorMessages().c_str());
-		}
-		else {
-			if (root.isMember("foliage_zones")) {
-				for (Json::Value::ArrayIndex i = 0; i != root["foliage_zones"].size(); i++)
-				{
-					float vec3[3];
-					for (Json::Value::ArrayIndex ia = 0; ia != root["foliage_zones"][i]["position"].size(); ia++)
-						vec3[ia] = root["foliage_zones"][i]["position"][ia].asFloat();
-
-					bool placedOnTerrain = false;
-					if (root["foliage_zones"][i].isMember("placed_on_terrain"))
-						placedOnTerrain = root["foliage_zones"][i]["placed_on_terrain"].asBool();
-					
-					TerrainSplatChannels terrainChannel = TerrainSplatChannels::NONE;
-					if (root["foliage_zones"][i].isMember("placed_splat_channel"))
-						terrainChannel = (TerrainSplatChannels)(root["foliage_zones"][i]["placed_splat_channel"].asInt());
-
-					foliageZones.push_back(new ER_Foliage(*core, mCamera, light,
-						root["foliage_zones"][i]["patch_count"].asInt(),
-						ER_Utility::GetFilePath(root["foliage_zones"][i]["texture_path"].asString()),
-						root["foliage_zones"][i]["average_scale"].asFloat(),
-						root["foliage_zones"][i]["distribution_radius"].asFloat(),
-						XMFLOAT3(vec3[0], vec3[1], vec3[2]),
-						(FoliageBillboardType)root["foliage_zones"][i]["type"].asInt(), placedOnTerrain, terrainChannel));
-				}
+		if (root.isMember("foliage_zones")) {
+			for (Json::Value::ArrayIndex i = 0; i != root["foliage_zones"].size(); i++)
+			{
+				float vec3[3];
+				for (Json::Value::ArrayIndex ia = 0; ia != root["foliage_zones"][i]["position"].size(); ia++)
+					vec3[ia] = root["foliage_zones"][i]["position"][ia].asFloat();
+
+				bool placedOnTerrain = false;
+				if (root["foliage_zones"][i].isMember("placed_on_terrain"))
+					placedOnTerrain = root["foliage_zones"][i]["placed_on_terrain"].asBool();
+				
+				TerrainSplatChannels terrainChannel = TerrainSplatChannels::NONE;
+				if (root["foliage_zones"][i].isMember("placed_splat_channel"))
+					terrainChannel = (TerrainSplatChannels)(root["foliage_zones"][i]["placed_splat_channel"].asInt());
+
+				foliageZones.push_back(new ER_Foliage(*core, mCamera, light,
+					root["foliage_zones"][i]["patch_count"].asInt(),
+					ER_Utility::GetFilePath(root["foliage_zones"][i]["texture_path"].asString()),
+					root["foliage_zones"][i]["average_scale"].asFloat(),
+					root["foliage_zones"][i]["distribution_radius"].asFloat(),
+					XMFLOAT3(vec3[0], vec3[1], vec3[2]),
+					(FoliageBillboardType)root["foliage_zones"][i]["type"].asInt(), placedOnTerrain, terrainChannel));
 			}
-			else
-				mHasFoliage = false;
 		}
+		else
+			mHasFoliage = false;
 	}
 
 	ER_RHI_GPURootSignature* ER_Scene::GetStandardMaterialRootSignature(const std::string& materialName)
@@ -700,17 +857,84 @@ namespace EveryRay_Core
 			return nullptr;
 	}
 
+	void ER_Scene::UpdateObjectsNamesIndex()
+	{
+		for (; mIndexedObjectsCount < objects.size(); mIndexedObjectsCount++)
+			mObjectsByName.emplace(objects[mIndexedObjectsCount].first, objects[mIndexedObjectsCount].second); // first object with the name wins (as with the old linear search)
+	}
+
 	ER_RenderingObject* ER_Scene::FindRenderingObjectByName(const std::string& aName)
+	{
+		UpdateObjectsNamesIndex();
+
+		auto it = mObjectsByName.find(aName);
+		return (it != mObjectsByName.end()) ? it->second : nullptr;
+	}
+
+	void ER_Scene::UpdateSpatialIndex()
 	{
 		for (auto& sceneObj : objects)
 		{
-			if (sceneObj.first == aName)
-				return sceneObj.second;
+			ER_RenderingObject* object = sceneObj.second;
+			const ER_AABB& bounds = object->GetWorldBoundsAABB();
+			const bool isValid = bounds.first.x <= bounds.second.x && bounds.first.y <= bounds.second.y && bounds.first.z <= bounds.second.z;
+
+			const int proxy = object->GetSceneBVHProxy();
+			if (!isValid)
+			{
+				// i.e., instanced object without instances
+				if (proxy >= 0)
+				{
+					mBVH.DestroyProxy(proxy);
+					object->SetSceneBVHProxy(-1);
+				}
+				continue;
+			}
+
+			if (proxy < 0)
+				object->SetSceneBVHProxy(mBVH.CreateProxy(object, bounds));
 			else
+				mBVH.MoveProxy(proxy, bounds);
+		}
+	}
+
+	void ER_Scene::CullObjects(const ER_Frustum& aCameraFrustum, const ER_ShadowMapper* aShadowMapper)
+	{
+		for (auto& sceneObj : objects)
+		{
+			ER_RenderingObject* object = sceneObj.second;
+			if (object->IsInstanced() || object->GetSceneBVHProxy() < 0)
 				continue;
+
+			object->SetCulled(ER_Utility::IsMainCameraCPUFrustumCulling);
+			for (int cascade = 0; cascade < NUM_SHADOW_CASCADES; cascade++)
+				object->SetInShadowCascade(cascade, !ER_Utility::IsShadowCastersCPUCulling);
+		}
+
+		if (ER_Utility::IsMainCameraCPUFrustumCulling)
+		{
+			mTempQueryResults.clear();
+			mBVH.QueryFrustum(aCameraFrustum, mTempQueryResults);
+			for (ER_RenderingObject* object : mTempQueryResults)
+			{
+				if (!object->IsInstanced())
+					object->SetCulled(false);
+			}
 		}
 
-		return nullptr;
+		if (ER_Utility::IsShadowCastersCPUCulling && aShadowMapper)
+		{
+			for (int cascade = 0; cascade < NUM_SHADOW_CASCADES; cascade++)
+			{
+				mTempQueryResults.clear();
+				mBVH.QueryFrustum(aShadowMapper->GetCasterCullingFrustum(cascade), mTempQueryResults);
+				for (ER_RenderingObject* object : mTempQueryResults)
+				{
+					if (!object->IsInstanced() && object->IsShadowCaster())
+						object->SetInShadowCascade(cascade, true);
+				}
+			}
+		}
 	}
 
 }
\ No newline at end of file
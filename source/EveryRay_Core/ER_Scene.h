@@ -4,6 +4,8 @@
 #include "ER_Camera.h"
 #include "ER_ModelMaterial.h"
 #include "ER_Material.h"
+#include "ER_SceneCooker.h"
+#include "ER_SceneBVH.h"
 
 #include "..\JsonCpp\include\json\json.h"
 
@@ -12,6 +14,9 @@ namespace EveryRay_Core
 	class ER_RenderingObject;
 	class ER_DirectionalLight;
 	class ER_Foliage;
+	class ER_ShadowMapper;
+	class ER_Frustum;
+	class ER_PointLight;
 	using ER_SceneObject = std::pair<std::string, ER_RenderingObject*>;
 
 	class ER_Scene : public ER_CoreComponent
@@ -20,7 +25,7 @@ namespace EveryRay_Core
 		ER_Scene(ER_Core& pCore, ER_Camera& pCamera, const std::string& path);
 		~ER_Scene();
 
-		void SaveRenderingObjectsTransforms();
+		void SaveRenderingObjectsTransforms(bool toJson = true, bool toCooked = true);
 		void SaveFoliageZonesTransforms(const std::vector<ER_Foliage*>& foliageZones);
 
 		ER_Material* GetMaterialByName(const std::string& matName, const MaterialShaderEntries& entries, bool instanced);
@@ -31,6 +36,7 @@ namespace EveryRay_Core
 		const XMFLOAT3& GetLightProbesVolumeMaxBounds() const { return mLightProbesVolumeMaxBounds; }
 		float GetLightProbesDiffuseDistance() { return mLightProbesDiffuseDistance; }
 		float GetLightProbesSpecularDistance() { return mLightProbesSpecularDistance; }
+		bool IsLightProbesSparse() { return mLightProbesSparse; }
 		
 		bool HasFoliage() { return mHasFoliage; }
 		void LoadFoliageZones(std::vector<ER_Foliage*>& foliageZones, ER_DirectionalLight& light);
@@ -40,13 +46,26 @@ namespace EveryRay_Core
 		int GetTerrainTileResolution() { return mTerrainTileResolution; }
 		float GetTerrainTileScale() { return mTerrainTileScale; }
 		const std::wstring& GetTerrainSplatLayerTextureName(int index) { return mTerrainSplatLayersTextureNames[index]; }
+		bool IsTerrainStreaming() { return mIsTerrainStreaming; }
+		float GetTerrainStreamingBudgetMB() { return mTerrainStreamingBudgetMB; }
+		float GetTerrainStreamingDistance() { return mTerrainStreamingDistance; }
 
 		bool HasVolumetricFog() { return mHasVolumetricFog; }
 
+		// point and spot lights (ER_SpotLight) of the scene, the color's alpha is the intensity
+		const std::vector<ER_PointLight*>& GetLocalLights() const { return mLocalLights; }
+
 		ER_RHI_GPURootSignature* GetStandardMaterialRootSignature(const std::string& materialName);
 		
+		// O(1) (hash index); objects appended to 'objects' after loading are indexed on the next call
 		ER_RenderingObject* FindRenderingObjectByName(const std::string& aName);
 
+		// Main thread, after the objects' UpdateCPU(): moves the BVH leaves of the objects whose world bounds have changed
+		void UpdateSpatialIndex();
+		// Main camera and shadow cascades culling of the non-instanced objects that are in the BVH (instanced ones are culled per instance)
+		void CullObjects(const ER_Frustum& aCameraFrustum, const ER_ShadowMapper* aShadowMapper);
+		const ER_SceneBVH& GetBVH() const { return mBVH; }
+
 		std::vector<ER_SceneObject> objects;
 
 		//TODO remove to private and make public methods
@@ -60,15 +79,31 @@ namespace EveryRay_Core
 	private:
 		void LoadRenderingObjectData(ER_RenderingObject* aObject);
 		void LoadRenderingObjectInstancedData(ER_RenderingObject* aObject);
+		void LoadRenderingObjectInstancesTransforms(ER_RenderingObject* aObject, int lod);
+		void RestoreInstancesTransforms();
+
+		void UpdateObjectsNamesIndex();
+		void LoadLocalLights();
 
 		std::map<std::string, ER_RHI_GPURootSignature*> mStandardMaterialsRootSignatures;
 
+		std::unordered_map<std::string, ER_RenderingObject*> mObjectsByName;
+		size_t mIndexedObjectsCount = 0; // objects[0..mIndexedObjectsCount) are in mObjectsByName
+
+		ER_SceneBVH mBVH;
+		std::vector<ER_RenderingObject*> mTempQueryResults;
+
 		Json::Value root;
 		ER_Camera& mCamera;
 		std::string mScenePath;
+		UINT64 mSceneSourceHash = 0; // hash of the scene's *.json text (for validation of the cooked scene)
+		ER_CookedScene mCookedScene; // memory-mapped cooked instance transforms (only open during loading)
+		bool mIsRootWithoutInstancesTransforms = false; // 'root' was parsed from the settings of the cooked scene (warm load)
 		
 		bool mHasVolumetricFog = false;
 
+		std::vector<ER_PointLight*> mLocalLights;
+
 		bool mHasFoliage = false;
 
 		bool mHasTerrain = false;
@@ -76,11 +111,15 @@ namespace EveryRay_Core
 		int mTerrainTileResolution = 0;
 		float mTerrainTileScale = 1.0f;
 		std::wstring mTerrainSplatLayersTextureNames[4];
+		bool mIsTerrainStreaming = false;
+		float mTerrainStreamingBudgetMB = 256.0f; // CPU + GPU memory of resident tiles
+		float mTerrainStreamingDistance = -1.0f; // from the camera to a tile's edge (-1 - one tile size)
 
 		bool mHasLightProbes = true;
 		XMFLOAT3 mLightProbesVolumeMinBounds = { 0,0,0 };
 		XMFLOAT3 mLightProbesVolumeMaxBounds = { 0,0,0 };
 		float mLightProbesDiffuseDistance = -1.0f;
 		float mLightProbesSpecularDistance = -1.0f;
+		bool mLightProbesSparse = false; // skip probes in empty space and inside solid objects (by the objects' AABBs)
 	};
 }
\ No newline at end of file
@@ -0,0 +1,697 @@
+#include "stdafx.h"
+#include <algorithm>
+
+#include "ER_SceneBVH.h"
+#include "ER_RenderingObject.h"
+#include "ER_FrustumCuller.h"
+#include "ER_Frustum.h"
+#include "ER_Ray.h"
+#include "ER_Utility.h"
+
+namespace EveryRay_Core
+{
+	namespace
+	{
+		ER_AABB Union(const ER_AABB& a, const ER_AABB& b)
+		{
+			return ER_AABB(
+				XMFLOAT3(std::min(a.first.x, b.first.x), std::min(a.first.y, b.first.y), std::min(a.first.z, b.first.z)),
+				XMFLOAT3(std::max(a.second.x, b.second.x), std::max(a.second.y, b.second.y), std::max(a.second.z, b.second.z)));
+		}
+
+		float SurfaceArea(const ER_AABB& a)
+		{
+			const float x = a.second.x - a.first.x;
+			const float y = a.second.y - a.first.y;
+			const float z = a.second.z - a.first.z;
+			return 2.0f * (x * y + y * z + z * x);
+		}
+
+		bool Contains(const ER_AABB& aOuter, const ER_AABB& aInner)
+		{
+			return aOuter.first.x <= aInner.first.x && aOuter.first.y <= aInner.first.y && aOuter.first.z <= aInner.first.z &&
+				aInner.second.x <= aOuter.second.x && aInner.second.y <= aOuter.second.y && aInner.second.z <= aOuter.second.z;
+		}
+
+		bool Overlaps(const ER_AABB& a, const ER_AABB& b)
+		{
+			return a.first.x <= b.second.x && a.second.x >= b.first.x &&
+				a.first.y <= b.second.y && a.second.y >= b.first.y &&
+				a.first.z <= b.second.z && a.second.z >= b.first.z;
+		}
+
+		bool IsEqual(const ER_AABB& a, const ER_AABB& b)
+		{
+			return a.first.x == b.first.x && a.first.y == b.first.y && a.first.z == b.first.z &&
+				a.second.x == b.second.x && a.second.y == b.second.y && a.second.z == b.second.z;
+		}
+
+		ER_AABB Enlarge(const ER_AABB& a, float aMargin)
+		{
+			return ER_AABB(
+				XMFLOAT3(a.first.x - aMargin, a.first.y - aMargin, a.first.z - aMargin),
+				XMFLOAT3(a.second.x + aMargin, a.second.y + aMargin, a.second.z + aMargin));
+		}
+
+		// Slab test; returns the entry and exit distances along the ray (entry is negative if the ray starts inside)
+		bool IntersectRayAABB(const float aOrigin[3], const float aDirection[3], const ER_AABB& aBox, float aMaxDistance, float& aOutEnter, float& aOutExit)
+		{
+			const float boxMin[3] = { aBox.first.x, aBox.first.y, aBox.first.z };
+			const float boxMax[3] = { aBox.second.x, aBox.second.y, aBox.second.z };
+
+			float enter = -FLT_MAX;
+			float exit = FLT_MAX;
+			for (int axis = 0; axis < 3; axis++)
+			{
+				if (fabsf(aDirection[axis]) < 1e-8f)
+				{
+					// parallel to the slab
+					if (aOrigin[axis] < boxMin[axis] || aOrigin[axis] > boxMax[axis])
+						return false;
+					continue;
+				}
+
+				const float invDirection = 1.0f / aDirection[axis];
+				float t1 = (boxMin[axis] - aOrigin[axis]) * invDirection;
+				float t2 = (boxMax[axis] - aOrigin[axis]) * invDirection;
+				if (t1 > t2)
+					std::swap(t1, t2);
+
+				enter = std::max(enter, t1);
+				exit = std::min(exit, t2);
+				if (enter > exit)
+					return false;
+			}
+
+			if (exit < 0.0f || enter > aMaxDistance)
+				return false;
+
+			aOutEnter = enter;
+			aOutExit = exit;
+			return true;
+		}
+
+		// distance used for picking: entry point or, if the ray starts inside of the box, exit point
+		float GetRayHitDistance(float aEnter, float aExit)
+		{
+			return (aEnter >= 0.0f) ? aEnter : aExit;
+		}
+	}
+
+	ER_SceneBVH::ER_SceneBVH()
+	{
+	}
+
+	ER_SceneBVH::~ER_SceneBVH()
+	{
+	}
+
+	int ER_SceneBVH::AllocateNode()
+	{
+		if (mFreeList == ER_SCENE_BVH_NULL_NODE)
+		{
+			mNodes.push_back(Node());
+			mFreeList = static_cast<int>(mNodes.size() - 1);
+			mNodes[mFreeList].Parent = ER_SCENE_BVH_NULL_NODE;
+		}
+
+		const int nodeIndex = mFreeList;
+		Node& node = mNodes[nodeIndex];
+		mFreeList = node.Parent;
+		node = Node();
+		node.Height = 0;
+		return nodeIndex;
+	}
+
+	void ER_SceneBVH::FreeNode(int aNode)
+	{
+		assert(aNode >= 0 && aNode < static_cast<int>(mNodes.size()));
+		mNodes[aNode] = Node();
+		mNodes[aNode].Parent = mFreeList;
+		mFreeList = aNode;
+	}
+
+	int ER_SceneBVH::CreateProxy(ER_RenderingObject* aObject, const ER_AABB& aAABB)
+	{
+		assert(aObject);
+		assert(aAABB.first.x <= aAABB.second.x && aAABB.first.y <= aAABB.second.y && aAABB.first.z <= aAABB.second.z);
+
+		const int leaf = AllocateNode();
+		mNodes[leaf].Box = Enlarge(aAABB, ER_SCENE_BVH_AABB_MARGIN);
+		mNodes[leaf].Object = aObject;
+		InsertLeaf(leaf);
+		mProxiesCount++;
+		return leaf;
+	}
+
+	void ER_SceneBVH::DestroyProxy(int aProxy)
+	{
+		assert(aProxy >= 0 && aProxy < static_cast<int>(mNodes.size()) && mNodes[aProxy].IsLeaf());
+		RemoveLeaf(aProxy);
+		FreeNode(aProxy);
+		mProxiesCount--;
+	}
+
+	bool ER_SceneBVH::MoveProxy(int aProxy, const ER_AABB& aAABB)
+	{
+		assert(aProxy >= 0 && aProxy < static_cast<int>(mNodes.size()) && mNodes[aProxy].IsLeaf());
+
+		Node& leaf = mNodes[aProxy];
+		if (Contains(leaf.Box, aAABB))
+			return false;
+
+		const bool isSmallMove = Overlaps(leaf.Box, aAABB);
+		leaf.Box = Enlarge(aAABB, ER_SCENE_BVH_AABB_MARGIN);
+		if (isSmallMove)
+			RefitAncestors(leaf.Parent, false);
+		else
+		{
+			RemoveLeaf(aProxy);
+			InsertLeaf(aProxy);
+		}
+		return true;
+	}
+
+	void ER_SceneBVH::Clear()
+	{
+		mNodes.clear();
+		mRoot = ER_SCENE_BVH_NULL_NODE;
+		mFreeList = ER_SCENE_BVH_NULL_NODE;
+		mProxiesCount = 0;
+	}
+
+	// Walks up from aNode and recomputes the boxes and heights; without balancing it stops as soon as a box does not change
+	void ER_SceneBVH::RefitAncestors(int aNode, bool aBalance)
+	{
+		int index = aNode;
+		while (index != ER_SCENE_BVH_NULL_NODE)
+		{
+			if (aBalance)
+				index = Balance(index);
+
+			Node& node = mNodes[index];
+			const Node& child1 = mNodes[node.Child1];
+			const Node& child2 = mNodes[node.Child2];
+
+			const ER_AABB box = Union(child1.Box, child2.Box);
+			if (!aBalance && IsEqual(box, node.Box))
+				break;
+
+			node.Box = box;
+			node.Height = 1 + std::max(child1.Height, child2.Height);
+			index = node.Parent;
+		}
+	}
+
+	// Finds the sibling with the lowest surface area cost (cost of the new parent + increase of the ancestors' areas)
+	void ER_SceneBVH::InsertLeaf(int aLeaf)
+	{
+		if (mRoot == ER_SCENE_BVH_NULL_NODE)
+		{
+			mRoot = aLeaf;
+			mNodes[mRoot].Parent = ER_SCENE_BVH_NULL_NODE;
+			return;
+		}
+
+		const ER_AABB leafBox = mNodes[aLeaf].Box;
+		int index = mRoot;
+		while (!mNodes[index].IsLeaf())
+		{
+			const Node& node = mNodes[index];
+			const float area = SurfaceArea(node.Box);
+			const float combinedArea = SurfaceArea(Union(node.Box, leafBox));
+
+			// cost of creating a new parent for this node and the new leaf
+			const float cost = 2.0f * combinedArea;
+			// minimum cost of pushing the leaf further down the tree
+			const float inheritanceCost = 2.0f * (combinedArea - area);
+
+			auto getChildCost = [&](int child)
+			{
+				const float childCombinedArea = SurfaceArea(Union(mNodes[child].Box, leafBox));
+				if (mNodes[child].IsLeaf())
+					return childCombinedArea + inheritanceCost;
+				else
+					return (childCombinedArea - SurfaceArea(mNodes[child].Box)) + inheritanceCost;
+			};
+			const float cost1 = getChildCost(node.Child1);
+			const float cost2 = getChildCost(node.Child2);
+
+			if (cost < cost1 && cost < cost2)
+				break;
+
+			index = (cost1 < cost2) ? node.Child1 : node.Child2;
+		}
+		const int sibling = index;
+
+		const int oldParent = mNodes[sibling].Parent;
+		const int newParent = AllocateNode();
+		mNodes[newParent].Parent = oldParent;
+		mNodes[newParent].Box = Union(leafBox, mNodes[sibling].Box);
+		mNodes[newParent].Height = mNodes[sibling].Height + 1;
+		mNodes[newParent].Child1 = sibling;
+		mNodes[newParent].Child2 = aLeaf;
+		mNodes[sibling].Parent = newParent;
+		mNodes[aLeaf].Parent = newParent;
+
+		if (oldParent != ER_SCENE_BVH_NULL_NODE)
+		{
+			if (mNodes[oldParent].Child1 == sibling)
+				mNodes[oldParent].Child1 = newParent;
+			else
+				mNodes[oldParent].Child2 = newParent;
+		}
+		else
+			mRoot = newParent;
+
+		RefitAncestors(mNodes[aLeaf].Parent, true);
+	}
+
+	void ER_SceneBVH::RemoveLeaf(int aLeaf)
+	{
+		if (aLeaf == mRoot)
+		{
+			mRoot = ER_SCENE_BVH_NULL_NODE;
+			return;
+		}
+
+		const int parent = mNodes[aLeaf].Parent;
+		const int grandParent = mNodes[parent].Parent;
+		const int sibling = (mNodes[parent].Child1 == aLeaf) ? mNodes[parent].Child2 : mNodes[parent].Child1;
+
+		if (grandParent != ER_SCENE_BVH_NULL_NODE)
+		{
+			// replace the parent with the sibling
+			if (mNodes[grandParent].Child1 == parent)
+				mNodes[grandParent].Child1 = sibling;
+			else
+				mNodes[grandParent].Child2 = sibling;
+			mNodes[sibling].Parent = grandParent;
+			FreeNode(parent);
+
+			RefitAncestors(grandParent, true);
+		}
+		else
+		{
+			mRoot = sibling;
+			mNodes[sibling].Parent = ER_SCENE_BVH_NULL_NODE;
+			FreeNode(parent);
+		}
+		mNodes[aLeaf].Parent = ER_SCENE_BVH_NULL_NODE;
+	}
+
+	// If one child of aNode is more than one level higher than the other one, rotates it up (AVL-style).
+	// Returns the index of the node that replaced aNode in the tree.
+	int ER_SceneBVH::Balance(int aNode)
+	{
+		const int iA = aNode;
+		Node& A = mNodes[iA];
+		if (A.IsLeaf() || A.Height < 2)
+			return iA;
+
+		const int iB = A.Child1;
+		const int iC = A.Child2;
+		Node& B = mNodes[iB];
+		Node& C = mNodes[iC];
+
+		const int balance = C.Height - B.Height;
+
+		// rotate C up
+		if (balance > 1)
+		{
+			const int iF = C.Child1;
+			const int iG = C.Child2;
+			Node& F = mNodes[iF];
+			Node& G = mNodes[iG];
+
+			C.Child1 = iA;
+			C.Parent = A.Parent;
+			A.Parent = iC;
+
+			if (C.Parent != ER_SCENE_BVH_NULL_NODE)
+			{
+				if (mNodes[C.Parent].Child1 == iA)
+					mNodes[C.Parent].Child1 = iC;
+				else
+					mNodes[C.Parent].Child2 = iC;
+			}
+			else
+				mRoot = iC;
+
+			if (F.Height > G.Height)
+			{
+				C.Child2 = iF;
+				A.Child2 = iG;
+				G.Parent = iA;
+				A.Box = Union(B.Box, G.Box);
+				C.Box = Union(A.Box, F.Box);
+				A.Height = 1 + std::max(B.Height, G.Height);
+				C.Height = 1 + std::max(A.Height, F.Height);
+			}
+			else
+			{
+				C.Child2 = iG;
+				A.Child2 = iF;
+				F.Parent = iA;
+				A.Box = Union(B.Box, F.Box);
+				C.Box = Union(A.Box, G.Box);
+				A.Height = 1 + std::max(B.Height, F.Height);
+				C.Height = 1 + std::max(A.Height, G.Height);
+			}
+			return iC;
+		}
+
+		// rotate B up
+		if (balance < -1)
+		{
+			const int iD = B.Child1;
+			const int iE = B.Child2;
+			Node& D = mNodes[iD];
+			Node& E = mNodes[iE];
+
+			B.Child1 = iA;
+			B.Parent = A.Parent;
+			A.Parent = iB;
+
+			if (B.Parent != ER_SCENE_BVH_NULL_NODE)
+			{
+				if (mNodes[B.Parent].Child1 == iA)
+					mNodes[B.Parent].Child1 = iB;
+				else
+					mNodes[B.Parent].Child2 = iB;
+			}
+			else
+				mRoot = iB;
+
+			if (D.Height > E.Height)
+			{
+				B.Child2 = iD;
+				A.Child1 = iE;
+				E.Parent = iA;
+				A.Box = Union(C.Box, E.Box);
+				B.Box = Union(A.Box, D.Box);
+				A.Height = 1 + std::max(C.Height, E.Height);
+				B.Height = 1 + std::max(A.Height, D.Height);
+			}
+			else
+			{
+				B.Child2 = iE;
+				A.Child1 = iD;
+				D.Parent = iA;
+				A.Box = Union(C.Box, D.Box);
+				B.Box = Union(A.Box, E.Box);
+				A.Height = 1 + std::max(C.Height, D.Height);
+				B.Height = 1 + std::max(A.Height, E.Height);
+			}
+			return iB;
+		}
+
+		return iA;
+	}
+
+	void ER_SceneBVH::QueryFrustum(const ER_Frustum& aFrustum, std::vector<ER_RenderingObject*>& aOutObjects) const
+	{
+		if (mRoot == ER_SCENE_BVH_NULL_NODE)
+			return;
+
+		int stack[ER_SCENE_BVH_MAX_STACK_DEPTH];
+		int stackSize = 0;
+		stack[stackSize++] = mRoot;
+		while (stackSize > 0)
+		{
+			const Node& node = mNodes[stack[--stackSize]];
+			if (ER_FrustumCuller::IsAABBCulled(aFrustum, node.Box))
+				continue;
+
+			if (node.IsLeaf())
+				aOutObjects.push_back(node.Object);
+			else
+			{
+				assert(stackSize + 2 <= ER_SCENE_BVH_MAX_STACK_DEPTH);
+				stack[stackSize++] = node.Child1;
+				stack[stackSize++] = node.Child2;
+			}
+		}
+	}
+
+	void ER_SceneBVH::QueryAABB(const ER_AABB& aAABB, std::vector<ER_RenderingObject*>& aOutObjects) const
+	{
+		if (mRoot == ER_SCENE_BVH_NULL_NODE)
+			return;
+
+		int stack[ER_SCENE_BVH_MAX_STACK_DEPTH];
+		int stackSize = 0;
+		stack[stackSize++] = mRoot;
+		while (stackSize > 0)
+		{
+			const Node& node = mNodes[stack[--stackSize]];
+			if (!Overlaps(node.Box, aAABB))
+				continue;
+
+			if (node.IsLeaf())
+				aOutObjects.push_back(node.Object);
+			else
+			{
+				assert(stackSize + 2 <= ER_SCENE_BVH_MAX_STACK_DEPTH);
+				stack[stackSize++] = node.Child1;
+				stack[stackSize++] = node.Child2;
+			}
+		}
+	}
+
+	ER_SceneRayHit ER_SceneBVH::RayCast(const ER_Ray& aRay, float aMaxDistance, const std::function<bool(ER_RenderingObject*)>& aFilter) const
+	{
+		ER_SceneRayHit closestHit;
+		closestHit.Distance = aMaxDistance;
+		if (mRoot == ER_SCENE_BVH_NULL_NODE)
+			return ER_SceneRayHit();
+
+		const float origin[3] = { aRay.Position().x, aRay.Position().y, aRay.Position().z };
+		const float direction[3] = { aRay.Direction().x, aRay.Direction().y, aRay.Direction().z };
+
+		int stack[ER_SCENE_BVH_MAX_STACK_DEPTH];
+		int stackSize = 0;
+		stack[stackSize++] = mRoot;
+		while (stackSize > 0)
+		{
+			const Node& node = mNodes[stack[--stackSize]];
+
+			// nodes are only skipped by the entry distance: the exit distance of a box that contains the origin can still be the closest
+			float enter, exit;
+			if (!IntersectRayAABB(origin, direction, node.Box, closestHit.Distance, enter, exit))
+				continue;
+
+			if (!node.IsLeaf())
+			{
+				assert(stackSize + 2 <= ER_SCENE_BVH_MAX_STACK_DEPTH);
+				stack[stackSize++] = node.Child1;
+				stack[stackSize++] = node.Child2;
+				continue;
+			}
+
+			ER_RenderingObject* object = node.Object;
+			if (aFilter && !aFilter(object))
+				continue;
+
+			// narrow phase against the exact (not enlarged) boxes
+			if (object->IsInstanced())
+			{
+				for (int instanceIndex = 0; instanceIndex < static_cast<int>(object->GetInstanceCount()); instanceIndex++)
+				{
+					if (IntersectRayAABB(origin, direction, object->GetInstanceAABB(instanceIndex), closestHit.Distance, enter, exit) &&
+						GetRayHitDistance(enter, exit) < closestHit.Distance)
+					{
+						closestHit.Object = object;
+						closestHit.InstanceIndex = instanceIndex;
+						closestHit.Distance = GetRayHitDistance(enter, exit);
+					}
+				}
+			}
+			else if (IntersectRayAABB(origin, direction, object->GetGlobalAABB(), closestHit.Distance, enter, exit) &&
+				GetRayHitDistance(enter, exit) < closestHit.Distance)
+			{
+				closestHit.Object = object;
+				closestHit.InstanceIndex = -1;
+				closestHit.Distance = GetRayHitDistance(enter, exit);
+			}
+		}
+
+		return closestHit.Object ? closestHit : ER_SceneRayHit();
+	}
+
+	bool ER_SceneBVH::RunTests()
+	{
+		UINT passedCount = 0;
+		UINT failedCount = 0;
+		auto check = [&](bool aCondition, const std::string& aName)
+		{
+			if (aCondition)
+				passedCount++;
+			else
+			{
+				failedCount++;
+				ER_OUTPUT_LOG(ER_Utility::ToWideString("[ER Logger][ER_SceneBVH] Test FAILED: " + aName + "\n").c_str());
+			}
+		};
+
+		const UINT count = 1000;
+		const float volumeSize = 200.0f;
+		const float maxExtent = 5.0f;
+
+		// objects are never dereferenced by the queries, so we only need unique addresses
+		std::vector<UINT8> objectsStorage(count);
+		auto getObject = [&](UINT aIndex) { return reinterpret_cast<ER_RenderingObject*>(&objectsStorage[aIndex]); };
+		auto getIndex = [&](ER_RenderingObject* aObject) { return static_cast<UINT>(reinterpret_cast<UINT8*>(aObject) - objectsStorage.data()); };
+		auto createRandomAABB = [&](float aExtent)
+		{
+			const XMFLOAT3 center = XMFLOAT3(ER_Utility::RandomFloat(-volumeSize, volumeSize), ER_Utility::RandomFloat(-volumeSize * 0.1f, volumeSize * 0.1f),
+				ER_Utility::RandomFloat(-volumeSize, volumeSize));
+			return ER_AABB(XMFLOAT3(center.x - aExtent, center.y - aExtent, center.z - aExtent), XMFLOAT3(center.x + aExtent, center.y + aExtent, center.z + aExtent));
+		};
+
+		ER_SceneBVH bvh;
+		std::vector<ER_AABB> aabbs(count);
+		std::vector<int> proxies(count, ER_SCENE_BVH_NULL_NODE);
+		for (UINT i = 0; i < count; i++)
+		{
+			aabbs[i] = createRandomAABB(ER_Utility::RandomFloat(0.1f, maxExtent));
+			proxies[i] = bvh.CreateProxy(getObject(i), aabbs[i]);
+		}
+		check(bvh.GetProxiesCount() == count, "all proxies are created");
+
+		// parent links, heights and boxes of every reachable node; every live proxy is reached exactly once
+		auto validateTree = [&](const std::string& aStepName)
+		{
+			std::vector<UINT> reachedCount(count, 0);
+			bool isValid = true;
+			if (bvh.mRoot != ER_SCENE_BVH_NULL_NODE)
+			{
+				isValid = bvh.mNodes[bvh.mRoot].Parent == ER_SCENE_BVH_NULL_NODE;
+				std::vector<int> stack(1, bvh.mRoot);
+				while (!stack.empty() && isValid)
+				{
+					const int index = stack.back();
+					stack.pop_back();
+					const Node& node = bvh.mNodes[index];
+					if (node.IsLeaf())
+					{
+						const UINT objectIndex = getIndex(node.Object);
+						isValid = node.Height == 0 && objectIndex < count && proxies[objectIndex] == index && Contains(node.Box, aabbs[objectIndex]);
+						if (isValid)
+							reachedCount[objectIndex]++;
+						continue;
+					}
+
+					const Node& child1 = bvh.mNodes[node.Child1];
+					const Node& child2 = bvh.mNodes[node.Child2];
+					isValid = child1.Parent == index && child2.Parent == index && node.Height == 1 + std::max(child1.Height, child2.Height) &&
+						Contains(node.Box, child1.Box) && Contains(node.Box, child2.Box);
+					stack.push_back(node.Child1);
+					stack.push_back(node.Child2);
+				}
+			}
+			for (UINT i = 0; i < count && isValid; i++)
+				isValid = reachedCount[i] == ((proxies[i] == ER_SCENE_BVH_NULL_NODE) ? 0u : 1u);
+
+			check(isValid, "tree is valid " + aStepName);
+		};
+
+		// leaves are enlarged (and not shrunk after small moves), so the queries are conservative: nothing visible is missed,
+		// and every extra result is within two margins from the query (boxes keep their size in this test)
+		auto compareQueries = [&](const std::string& aStepName)
+		{
+			std::vector<ER_RenderingObject*> results;
+			std::vector<UINT> resultCount(count);
+			bool isFrustumValid = true;
+			bool isAABBValid = true;
+			for (int queryIndex = 0; queryIndex < 20; queryIndex++)
+			{
+				const XMFLOAT3 eye = XMFLOAT3(ER_Utility::RandomFloat(-volumeSize, volumeSize), ER_Utility::RandomFloat(0.0f, 20.0f), ER_Utility::RandomFloat(-volumeSize, volumeSize));
+				const XMFLOAT3 target = XMFLOAT3(ER_Utility::RandomFloat(-volumeSize, volumeSize), 0.0f, ER_Utility::RandomFloat(-volumeSize, volumeSize));
+				const XMMATRIX view = XMMatrixLookAtRH(XMLoadFloat3(&eye), XMLoadFloat3(&target), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+				const ER_Frustum frustum(XMMatrixMultiply(view, XMMatrixPerspectiveFovRH(XM_PIDIV4, 16.0f / 9.0f, 0.5f, ER_Utility::RandomFloat(50.0f, 300.0f))));
+
+				results.clear();
+				bvh.QueryFrustum(frustum, results);
+				std::fill(resultCount.begin(), resultCount.end(), 0);
+				for (ER_RenderingObject* object : results)
+					resultCount[getIndex(object)]++;
+				for (UINT i = 0; i < count && isFrustumValid; i++)
+				{
+					if (proxies[i] == ER_SCENE_BVH_NULL_NODE)
+						isFrustumValid = resultCount[i] == 0;
+					else if (!ER_FrustumCuller::IsAABBCulled(frustum, aabbs[i]))
+						isFrustumValid = resultCount[i] == 1;
+					else
+						isFrustumValid = resultCount[i] == 0 || (resultCount[i] == 1 && !ER_FrustumCuller::IsAABBCulled(frustum, Enlarge(aabbs[i], 2.0f * ER_SCENE_BVH_AABB_MARGIN)));
+				}
+
+				const ER_AABB queryAABB = createRandomAABB(ER_Utility::RandomFloat(1.0f, 50.0f));
+				results.clear();
+				bvh.QueryAABB(queryAABB, results);
+				std::fill(resultCount.begin(), resultCount.end(), 0);
+				for (ER_RenderingObject* object : results)
+					resultCount[getIndex(object)]++;
+				for (UINT i = 0; i < count && isAABBValid; i++)
+				{
+					if (proxies[i] == ER_SCENE_BVH_NULL_NODE)
+						isAABBValid = resultCount[i] == 0;
+					else if (Overlaps(queryAABB, aabbs[i]))
+						isAABBValid = resultCount[i] == 1;
+					else
+						isAABBValid = resultCount[i] == 0 || (resultCount[i] == 1 && Overlaps(queryAABB, Enlarge(aabbs[i], 2.0f * ER_SCENE_BVH_AABB_MARGIN)));
+				}
+			}
+			check(isFrustumValid, "frustum queries match brute force " + aStepName);
+			check(isAABBValid, "AABB queries match brute force " + aStepName);
+		};
+
+		validateTree("(after creation)");
+		compareQueries("(after creation)");
+
+		// small moves (inside of the margin or refit) and big moves (re-insertion)
+		for (UINT i = 0; i < count; i++)
+		{
+			const bool isBigMove = (i % 3) == 0;
+			const XMFLOAT3 offset = isBigMove ? XMFLOAT3(ER_Utility::RandomFloat(-volumeSize, volumeSize), 0.0f, ER_Utility::RandomFloat(-volumeSize, volumeSize)) :
+				XMFLOAT3(ER_Utility::RandomFloat(-0.3f, 0.3f), ER_Utility::RandomFloat(-0.3f, 0.3f), ER_Utility::RandomFloat(-0.3f, 0.3f));
+			aabbs[i] = ER_AABB(XMFLOAT3(aabbs[i].first.x + offset.x, aabbs[i].first.y + offset.y, aabbs[i].first.z + offset.z),
+				XMFLOAT3(aabbs[i].second.x + offset.x, aabbs[i].second.y + offset.y, aabbs[i].second.z + offset.z));
+			bvh.MoveProxy(proxies[i], aabbs[i]);
+		}
+		validateTree("(after moves)");
+		compareQueries("(after moves)");
+
+		// destroy every other proxy, then reuse the freed nodes
+		for (UINT i = 0; i < count; i += 2)
+		{
+			bvh.DestroyProxy(proxies[i]);
+			proxies[i] = ER_SCENE_BVH_NULL_NODE;
+		}
+		check(bvh.GetProxiesCount() == count / 2, "destroyed proxies are not counted");
+		validateTree("(after destruction)");
+		compareQueries("(after destruction)");
+
+		const size_t nodesCount = bvh.mNodes.size();
+		for (UINT i = 0; i < count; i += 4)
+		{
+			aabbs[i] = createRandomAABB(ER_Utility::RandomFloat(0.1f, maxExtent));
+			proxies[i] = bvh.CreateProxy(getObject(i), aabbs[i]);
+		}
+		check(bvh.mNodes.size() == nodesCount, "freed nodes are reused");
+		validateTree("(after re-creation)");
+		compareQueries("(after re-creation)");
+
+		// balanced (logarithmic) height for random boxes
+		check(bvh.GetHeight() <= 4 * static_cast<int>(ceilf(log2f(static_cast<float>(bvh.GetProxiesCount())))), "tree height is logarithmic");
+
+		bvh.Clear();
+		std::vector<ER_RenderingObject*> results;
+		bvh.QueryAABB(createRandomAABB(volumeSize), results);
+		check(bvh.GetProxiesCount() == 0 && bvh.GetHeight() == 0 && results.empty(), "cleared tree is empty");
+
+		const std::string message = "[ER Logger][ER_SceneBVH] Tests: " + std::to_string(passedCount) + " passed, " + std::to_string(failedCount) + " failed\n";
+		ER_OUTPUT_LOG(ER_Utility::ToWideString(message).c_str());
+		return failedCount == 0;
+	}
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include "Common.h"
+
+#include <functional>
+
+#define ER_SCENE_BVH_NULL_NODE -1
+#define ER_SCENE_BVH_AABB_MARGIN 0.1f // leaves are enlarged by this (in world units), so that small moves do not touch the tree
+#define ER_SCENE_BVH_MAX_STACK_DEPTH 256 // traversal stack of the queries
+
+namespace EveryRay_Core
+{
+	class ER_RenderingObject;
+	class ER_Frustum;
+	class ER_Ray;
+
+	struct ER_SceneRayHit
+	{
+		ER_RenderingObject* Object = nullptr;
+		int InstanceIndex = -1; // for instanced objects
+		float Distance = FLT_MAX;
+	};
+
+	// Dynamic bounding volume hierarchy over the world AABBs of the scene objects (one leaf per object, instanced objects
+	// use the bounds of all their instances). Leaves are inserted by the surface area cost and the tree is kept balanced with
+	// rotations, so queries are logarithmic in the amount of objects.
+	// Moved objects: nothing happens while the new AABB fits into the enlarged leaf, a small move refits the leaf and its ancestors,
+	// a big move (the new AABB does not overlap the old one) re-inserts the leaf.
+	class ER_SceneBVH
+	{
+	public:
+		ER_SceneBVH();
+		~ER_SceneBVH();
+
+		int CreateProxy(ER_RenderingObject* aObject, const ER_AABB& aAABB);
+		void DestroyProxy(int aProxy);
+		// Returns true if the tree was changed
+		bool MoveProxy(int aProxy, const ER_AABB& aAABB);
+		void Clear();
+
+		// Results are appended to aOutObjects (not cleared here)
+		void QueryFrustum(const ER_Frustum& aFrustum, std::vector<ER_RenderingObject*>& aOutObjects) const;
+		void QueryAABB(const ER_AABB& aAABB, std::vector<ER_RenderingObject*>& aOutObjects) const;
+
+		// Closest object (or instance) hit by the ray; objects rejected by aFilter are skipped.
+		// The ray is tested against the AABBs: if it starts inside of one, the exit distance is used, so that the objects
+		// inside of a big enclosing one (i.e., a building) can still be picked.
+		ER_SceneRayHit RayCast(const ER_Ray& aRay, float aMaxDistance = FLT_MAX, const std::function<bool(ER_RenderingObject*)>& aFilter = nullptr) const;
+
+		UINT GetProxiesCount() const { return mProxiesCount; }
+		int GetHeight() const { return (mRoot == ER_SCENE_BVH_NULL_NODE) ? 0 : mNodes[mRoot].Height; }
+
+		// Compares the frustum and AABB queries with brute force over random boxes (after creating, moving and destroying proxies)
+		// and validates the tree (parent links, heights and boxes). Results are written to the log.
+		static bool RunTests();
+	private:
+		struct Node
+		{
+			ER_AABB Box; // enlarged by ER_SCENE_BVH_AABB_MARGIN for leaves
+			ER_RenderingObject* Object = nullptr; // leaves only
+			int Parent = ER_SCENE_BVH_NULL_NODE; // next free node, if the node is in the free list
+			int Child1 = ER_SCENE_BVH_NULL_NODE;
+			int Child2 = ER_SCENE_BVH_NULL_NODE;
+			int Height = -1; // 0 - leaf, -1 - free
+
+			bool IsLeaf() const { return Child1 == ER_SCENE_BVH_NULL_NODE; }
+		};
+
+		int AllocateNode();
+		void FreeNode(int aNode);
+		void InsertLeaf(int aLeaf);
+		void RemoveLeaf(int aLeaf);
+		void RefitAncestors(int aNode, bool aBalance);
+		int Balance(int aNode);
+
+		std::vector<Node> mNodes;
+		int mRoot = ER_SCENE_BVH_NULL_NODE;
+		int mFreeList = ER_SCENE_BVH_NULL_NODE;
+		UINT mProxiesCount = 0;
+	};
+}
@@ -0,0 +1,199 @@
+#include "stdafx.h"
+#include <fstream>
+
+#include "ER_SceneCooker.h"
+#include "ER_Utility.h"
+#include "ER_CoreException.h"
+
+namespace EveryRay_Core
+{
+	std::string ER_SceneCooker::GetCookedScenePath(const std::string& scenePath)
+	{
+		size_t extensionPos = scenePath.find_last_of('.');
+		return ((extensionPos == std::string::npos) ? scenePath : scenePath.substr(0, extensionPos)) + ER_COOKED_SCENE_EXTENSION;
+	}
+
+	bool ER_SceneCooker::CookScene(const std::string& scenePath)
+	{
+		std::vector<char> sceneText;
+		ER_Utility::LoadBinaryFile(ER_Utility::ToWideString(scenePath), sceneText);
+		if (sceneText.empty())
+			return false;
+
+		Json::Reader reader;
+		Json::Value root;
+		if (!reader.parse(sceneText.data(), sceneText.data() + sceneText.size(), root))
+		{
+			std::string message = "[ER Logger][ER_SceneCooker] Could not parse scene: " + scenePath + ": " + reader.getFormattedErrorMessages() + "\n";
+			ER_OUTPUT_LOG(ER_Utility::ToWideString(message).c_str());
+			return false;
+		}
+
+		return WriteCookedScene(GetCookedScenePath(scenePath), root, ER_Utility::HashFNV1a(sceneText.data(), sceneText.size()));
+	}
+
+	bool ER_SceneCooker::WriteCookedScene(const std::string& cookedScenePath, const Json::Value& root, UINT64 sourceHash)
+	{
+		const Json::Value& renderingObjects = root["rendering_objects"];
+
+		ER_CookedSceneHeader header;
+		header.SourceHash = sourceHash;
+		header.ObjectCount = renderingObjects.size();
+
+		std::vector<ER_CookedSceneObjectEntry> entries(header.ObjectCount);
+		std::vector<XMFLOAT4X4> instances;
+		for (Json::Value::ArrayIndex i = 0; i != renderingObjects.size(); i++)
+		{
+			const std::string name = renderingObjects[i]["name"].asString();
+			entries[i].NameHash = ER_Utility::HashFNV1a(name.data(), name.size());
+			entries[i].FirstInstance = instances.size();
+
+			if (!renderingObjects[i].isMember("instances_transforms"))
+				continue;
+
+			const Json::Value& instancesTransforms = renderingObjects[i]["instances_transforms"];
+			entries[i].HasInstancesTransforms = 1;
+			entries[i].InstanceCount = instancesTransforms.size();
+			for (Json::Value::ArrayIndex instance = 0; instance != instancesTransforms.size(); instance++)
+			{
+				const Json::Value& transform = instancesTransforms[instance]["transform"];
+				if (transform.size() != 16)
+					throw ER_CoreException(("Can't cook scene! Instance transform of the object is not a 4x4 matrix: " + name).c_str());
+
+				float matrix[16];
+				for (Json::Value::ArrayIndex matC = 0; matC != 16; matC++)
+					matrix[matC] = transform[matC].asFloat();
+
+				XMFLOAT4X4 worldTransform(matrix);
+				XMStoreFloat4x4(&worldTransform, XMMatrixTranspose(XMLoadFloat4x4(&worldTransform)));
+				instances.push_back(worldTransform);
+			}
+		}
+		header.TotalInstanceCount = static_cast<UINT32>(instances.size());
+
+		// the settings are what the runtime parses: the same *.json, but without the (already cooked) instance arrays
+		std::string settingsText;
+		{
+			Json::Value settings = root;
+			if (settings.isMember("rendering_objects"))
+			{
+				Json::Value& settingsObjects = settings["rendering_objects"];
+				for (Json::Value::ArrayIndex i = 0; i != settingsObjects.size(); i++)
+					settingsObjects[i].removeMember("instances_transforms");
+			}
+
+			Json::StreamWriterBuilder builder;
+			builder["indentation"] = "";
+			settingsText = Json::writeString(builder, settings);
+		}
+
+		const UINT64 tableEnd = sizeof(ER_CookedSceneHeader) + sizeof(ER_CookedSceneObjectEntry) * entries.size();
+		header.SettingsOffset = tableEnd;
+		header.SettingsSize = settingsText.size();
+		header.InstanceBlockOffset = ER_BitmaskAlign(static_cast<UINT>(header.SettingsOffset + header.SettingsSize), 16);
+
+		// written into a temp file and then renamed, so that a failed write does not leave a truncated cooked scene
+		const std::string tempPath = cookedScenePath + ".tmp";
+		{
+			std::ofstream file(tempPath.c_str(), std::ios::binary | std::ios::trunc);
+			if (!file.is_open())
+			{
+				std::string message = "[ER Logger][ER_SceneCooker] Could not open file for writing: " + tempPath + "\n";
+				ER_OUTPUT_LOG(ER_Utility::ToWideString(message).c_str());
+				return false;
+			}
+
+			const char padding[16] = {};
+			file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			if (!entries.empty())
+				file.write(reinterpret_cast<const char*>(entries.data()), sizeof(ER_CookedSceneObjectEntry) * entries.size());
+			file.write(settingsText.data(), static_cast<std::streamsize>(settingsText.size()));
+			file.write(padding, static_cast<std::streamsize>(header.InstanceBlockOffset - header.SettingsOffset - header.SettingsSize));
+			if (!instances.empty())
+				file.write(reinterpret_cast<const char*>(instances.data()), sizeof(XMFLOAT4X4) * instances.size());
+			file.close();
+
+			if (file.fail())
+			{
+				DeleteFileA(tempPath.c_str());
+				std::string message = "[ER Logger][ER_SceneCooker] Could not write cooked scene: " + tempPath + "\n";
+				ER_OUTPUT_LOG(ER_Utility::ToWideString(message).c_str());
+				return false;
+			}
+		}
+
+		if (!MoveFileExA(tempPath.c_str(), cookedScenePath.c_str(), MOVEFILE_REPLACE_EXISTING))
+		{
+			DeleteFileA(tempPath.c_str());
+			std::string message = "[ER Logger][ER_SceneCooker] Could not replace cooked scene: " + cookedScenePath + "\n";
+			ER_OUTPUT_LOG(ER_Utility::ToWideString(message).c_str());
+			return false;
+		}
+
+		std::string message = "[ER Logger][ER_SceneCooker] Cooked scene: " + cookedScenePath + " (" + std::to_string(header.ObjectCount) + " objects, " +
+			std::to_string(header.TotalInstanceCount) + " instance transforms)\n";
+		ER_OUTPUT_LOG(ER_Utility::ToWideString(message).c_str());
+		return true;
+	}
+
+	bool ER_CookedScene::Open(const std::string& cookedScenePath, UINT64 expectedSourceHash)
+	{
+		Close();
+		if (!mFile.Open(ER_Utility::ToWideString(cookedScenePath)))
+			return false;
+
+		const UINT8* data = mFile.GetData();
+		const UINT64 size = mFile.GetSize();
+		if (size < sizeof(ER_CookedSceneHeader))
+		{
+			Close();
+			return false;
+		}
+
+		// offsets and counts come from the file: each block is checked against the previous one, so that corrupted values cannot wrap around
+		const ER_CookedSceneHeader* header = reinterpret_cast<const ER_CookedSceneHeader*>(data);
+		if (header->Magic != ER_COOKED_SCENE_MAGIC || header->Version != ER_COOKED_SCENE_VERSION || header->SourceHash != expectedSourceHash ||
+			header->ObjectCount > (size - sizeof(ER_CookedSceneHeader)) / sizeof(ER_CookedSceneObjectEntry))
+		{
+			Close();
+			return false;
+		}
+		const UINT64 tableEnd = sizeof(ER_CookedSceneHeader) + sizeof(ER_CookedSceneObjectEntry) * static_cast<UINT64>(header->ObjectCount);
+		if (!ER_Utility::IsRangeInFile(header->SettingsOffset, header->SettingsSize, tableEnd, size) ||
+			!ER_Utility::IsRangeInFile(header->InstanceBlockOffset, sizeof(XMFLOAT4X4) * static_cast<UINT64>(header->TotalInstanceCount), header->SettingsOffset + header->SettingsSize, size))
+		{
+			Close();
+			return false;
+		}
+
+		mHeader = header;
+		mObjects = reinterpret_cast<const ER_CookedSceneObjectEntry*>(data + sizeof(ER_CookedSceneHeader));
+		mInstances = reinterpret_cast<const XMFLOAT4X4*>(data + header->InstanceBlockOffset);
+		return true;
+	}
+
+	bool ER_CookedScene::ParseSettings(Json::Value& root) const
+	{
+		if (!IsOpen())
+			return false;
+
+		const char* settings = reinterpret_cast<const char*>(mFile.GetData() + mHeader->SettingsOffset);
+		Json::Reader reader;
+		return reader.parse(settings, settings + mHeader->SettingsSize, root);
+	}
+
+	const XMFLOAT4X4* ER_CookedScene::GetInstancesTransforms(UINT objectIndex, const std::string& objectName, UINT& instanceCount) const
+	{
+		instanceCount = 0;
+		if (!IsOpen() || objectIndex >= mHeader->ObjectCount)
+			return nullptr;
+
+		const ER_CookedSceneObjectEntry& entry = mObjects[objectIndex];
+		if (!entry.HasInstancesTransforms || entry.NameHash != ER_Utility::HashFNV1a(objectName.data(), objectName.size()) ||
+			entry.FirstInstance > mHeader->TotalInstanceCount || entry.InstanceCount > mHeader->TotalInstanceCount - entry.FirstInstance)
+			return nullptr;
+
+		instanceCount = entry.InstanceCount;
+		return mInstances + entry.FirstInstance;
+	}
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include "Common.h"
+#include "ER_MappedFile.h"
+
+#include "..\JsonCpp\include\json\json.h"
+
+#define ER_COOKED_SCENE_MAGIC 0x4E435245 // "ERCN"
+#define ER_COOKED_SCENE_VERSION 2
+#define ER_COOKED_SCENE_EXTENSION ".erscene"
+
+namespace EveryRay_Core
+{
+	// Binary ("cooked") version of the level's *.json file:
+	// [header] [object table: one entry per "rendering_objects" element] [settings: the *.json without "instances_transforms"] [contiguous float4x4 instance blocks (16-byte aligned)]
+	// The runtime only parses the settings (the instance arrays are most of the *.json), matrices are stored in the engine's layout
+	// (already transposed), so they can be copied into ER_RenderingObject directly.
+	struct ER_CookedSceneHeader
+	{
+		UINT32 Magic = ER_COOKED_SCENE_MAGIC;
+		UINT32 Version = ER_COOKED_SCENE_VERSION;
+		UINT64 SourceHash = 0; // hash of the *.json file, which this file was cooked from (if they do not match, the cooked file is outdated)
+		UINT32 ObjectCount = 0;
+		UINT32 TotalInstanceCount = 0;
+		UINT64 SettingsOffset = 0; // in bytes, from the start of the file
+		UINT64 SettingsSize = 0; // compact json text (not null-terminated)
+		UINT64 InstanceBlockOffset = 0;
+	};
+
+	struct ER_CookedSceneObjectEntry
+	{
+		UINT64 NameHash = 0;
+		UINT32 HasInstancesTransforms = 0; // 0 if the object has no "instances_transforms" field (i.e., not instanced or placed procedurally)
+		UINT32 InstanceCount = 0;
+		UINT64 FirstInstance = 0; // index of the first matrix in the instance block
+	};
+
+	class ER_SceneCooker
+	{
+	public:
+		static std::string GetCookedScenePath(const std::string& scenePath);
+
+		// Offline path: reads the level's *.json and writes the cooked file next to it.
+		static bool CookScene(const std::string& scenePath);
+		// Writes the cooked file for an already parsed level (sourceHash - ER_Utility::HashFNV1a() of the *.json text).
+		static bool WriteCookedScene(const std::string& cookedScenePath, const Json::Value& root, UINT64 sourceHash);
+	private:
+		ER_SceneCooker();
+	};
+
+	// Memory-mapped cooked scene (only valid while it is open)
+	class ER_CookedScene
+	{
+	public:
+		// Fails if the file does not exist, has a wrong version or was cooked from a different *.json
+		bool Open(const std::string& cookedScenePath, UINT64 expectedSourceHash);
+		void Close() { mFile.Close(); mHeader = nullptr; mObjects = nullptr; mInstances = nullptr; }
+		bool IsOpen() const { return mHeader != nullptr; }
+
+		UINT GetObjectCount() const { return IsOpen() ? mHeader->ObjectCount : 0; }
+		// The *.json without the "instances_transforms" arrays of the rendering objects
+		bool ParseSettings(Json::Value& root) const;
+
+		// Returns nullptr if the object has no instance transforms in the cooked file
+		const XMFLOAT4X4* GetInstancesTransforms(UINT objectIndex, const std::string& objectName, UINT& instanceCount) const;
+	private:
+		ER_MappedFile mFile;
+		const ER_CookedSceneHeader* mHeader = nullptr;
+		const ER_CookedSceneObjectEntry* mObjects = nullptr;
+		const XMFLOAT4X4* mInstances = nullptr;
+	};
+}
@@ -23,6 +23,10 @@
 static const std::string psoNameNonInstanced = "ER_RHI_GPUPipelineStateObject: ShadowMapMaterial";
 static const std::string psoNameInstanced = "ER_RHI_GPUPipelineStateObject: ShadowMapMaterial w/ Instancing";
 
+// Shadow casters between the light and a cascade still cast into it (ER_SHADOW_RS disables depth clipping, so their depth gets clamped to the near plane).
+// That is why we push the near plane of the caster culling volume towards the light by this distance.
+static const float casterCullingNearPlaneExtrusion = 10000.0f;
+
 namespace EveryRay_Core
 {
 	ER_ShadowMapper::ER_ShadowMapper(ER_Core& pCore, ER_Camera& camera, ER_DirectionalLight& dirLight, ShadowQuality pQuality, bool isCascaded)
@@ -55,6 +59,7 @@ namespace EveryRay_Core
 			mShadowMaps[i]->CreateGPUTextureResource(rhi, mResolution, mResolution, 1u, ER_FORMAT_D16_UNORM, ER_BIND_DEPTH_STENCIL | ER_BIND_SHADER_RESOURCE);
 
 			mCameraCascadesFrustums.push_back(XMMatrixIdentity());
+			mCasterCullingFrustums.push_back(XMMatrixIdentity());
 			(isCascaded) ? mCameraCascadesFrustums[i].SetMatrix(mCamera.GetCustomViewProjectionMatrixForCascade(i)) : mCameraCascadesFrustums[i].SetMatrix(mCamera.ProjectionMatrix());
 
 			mLightProjectors.push_back(new ER_Projector(pCore));
@@ -91,6 +96,8 @@ namespace EveryRay_Core
 			mLightProjectors[i]->SetProjectionMatrix(GetProjectionBoundingSphere(i));
 			mLightProjectors[i]->SetViewMatrix(mLightProjectorCenteredPositions[i], mDirectionalLight.Direction(), mDirectionalLight.Up());
 			mLightProjectors[i]->Update();
+
+			mCasterCullingFrustums[i].SetMatrix(XMMatrixMultiply(mLightProjectors[i]->ViewMatrix(), GetProjectionBoundingSphere(i, casterCullingNearPlaneExtrusion)));
 		}
 	}
 
@@ -143,6 +150,12 @@ namespace EveryRay_Core
 		return mLightProjectors.at(cascadeIndex)->ProjectionMatrix();
 	}
 
+	const ER_Frustum& ER_ShadowMapper::GetCasterCullingFrustum(int cascadeIndex /*= 0*/) const
+	{
+		assert(cascadeIndex < NUM_SHADOW_CASCADES);
+		return mCasterCullingFrustums.at(cascadeIndex);
+	}
+
 	ER_RHI_GPUTexture* ER_ShadowMapper::GetShadowTexture(int cascadeIndex) const
 	{
 		assert(cascadeIndex < NUM_SHADOW_CASCADES);
@@ -228,7 +241,7 @@ namespace EveryRay_Core
 		XMMATRIX projectionMatrix = XMMatrixOrthographicRH(maxX - minX, maxY - minY, -delta, maxZ - minZ);
 		return projectionMatrix;
 	}
-	XMMATRIX ER_ShadowMapper::GetProjectionBoundingSphere(int index)
+	XMMATRIX ER_ShadowMapper::GetProjectionBoundingSphere(int index, float nearPlaneExtrusion)
 	{
 		// Create a bounding sphere around the camera frustum for 360 rotation
 		float nearV = mCamera.GetCameraNearShadowCascadeDistance(index);
@@ -261,7 +274,7 @@ namespace EveryRay_Core
 				mCamera.Position().z + mCamera.Direction().z * 0.5f * mCamera.GetCameraFarShadowCascadeDistance(index)
 			);
 
-		XMMATRIX projectionMatrix = XMMatrixOrthographicRH(sphereRadius, sphereRadius, -sphereRadius, sphereRadius);
+		XMMATRIX projectionMatrix = XMMatrixOrthographicRH(sphereRadius, sphereRadius, -sphereRadius - nearPlaneExtrusion, sphereRadius);
 		return projectionMatrix;
 	}
 
@@ -292,11 +305,12 @@ namespace EveryRay_Core
 			{
 				ER_RenderingObject* renderingObject = renderingObjectInfo->second;
 				const std::string& psoName = renderingObject->IsInstanced() ? psoNameInstanced : psoNameNonInstanced;
+				ER_RHI_PSO_HANDLE& psoHandle = renderingObject->IsInstanced() ? mPSOHandleInstanced : mPSOHandleNonInstanced;
 				auto materialInfo = renderingObject->GetMaterials().find(materialName);
-				if (materialInfo != renderingObject->GetMaterials().end())
+				if (materialInfo != renderingObject->GetMaterials().end() && renderingObject->IsInShadowCascade(i))
 				{
 					ER_Material* material = materialInfo->second;
-					if (!rhi->IsPSOReady(psoName))
+					if (psoHandle == ER_RHI_INVALID_PSO_HANDLE)
 					{
 						rhi->InitializePSO(psoName);
 						rhi->SetRasterizerState(ER_SHADOW_RS);
@@ -306,16 +320,16 @@ namespace EveryRay_Core
 						rhi->SetRenderTargetFormats({}, mShadowMaps[i]);
 						rhi->SetRootSignatureToPSO(psoName, mRootSignature);
 						rhi->SetTopologyTypeToPSO(psoName, ER_RHI_PRIMITIVE_TYPE::ER_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-						rhi->FinalizePSO(psoName);
+						psoHandle = rhi->FinalizePSO(psoName);
 					}
-					rhi->SetPSO(psoName);
-					for (int meshIndex = 0; meshIndex < renderingObject->GetMeshCount(); meshIndex++)
+					rhi->SetPSO(psoHandle);
+					//drawing the lowest LOD (instances are culled against the cascade, not the main camera);
+					//texture data only exists for the meshes of the main LOD, so extra meshes of the lowest LOD are not drawn
+					const int meshCount = std::min(renderingObject->GetMeshCount(0), renderingObject->GetMeshCount(renderingObject->GetLODCount() - 1));
+					for (int meshIndex = 0; meshIndex < meshCount; meshIndex++)
 					{
 						static_cast<ER_ShadowMapMaterial*>(material)->PrepareForRendering(materialSystems, renderingObject, meshIndex, i, mRootSignature);
-						if (!renderingObject->IsInstanced())
-							renderingObject->DrawLOD(materialName, true, meshIndex, renderingObject->GetLODCount() - 1); //drawing highest LOD
-						else
-							renderingObject->Draw(materialName, true, meshIndex);
+						renderingObject->DrawShadowCascade(materialName, meshIndex, i);
 					}
 				}
 			}
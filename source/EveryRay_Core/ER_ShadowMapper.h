@@ -31,6 +31,8 @@ namespace EveryRay_Core
 		void StopRenderingToShadowMap(int cascadeIndex = 0);
 		XMMATRIX GetViewMatrix(int cascadeIndex = 0) const;
 		XMMATRIX GetProjectionMatrix(int cascadeIndex = 0) const;
+		// Light-space volume of a cascade extruded towards the light (for CPU culling of shadow casters)
+		const ER_Frustum& GetCasterCullingFrustum(int cascadeIndex = 0) const;
 		ER_RHI_GPUTexture* GetShadowTexture(int cascadeIndex = 0) const;
 		UINT GetResolution() const { return mResolution; }
 		void ApplyTransform();
@@ -38,16 +40,19 @@ namespace EveryRay_Core
 
 	private:
 		XMMATRIX GetLightProjectionMatrixInFrustum(int index, ER_Frustum& cameraFrustum, ER_DirectionalLight& light);
-		XMMATRIX GetProjectionBoundingSphere(int index);
+		XMMATRIX GetProjectionBoundingSphere(int index, float nearPlaneExtrusion = 0.0f);
 
 		ER_Camera& mCamera;
 		ER_DirectionalLight& mDirectionalLight;
 
 		ER_RHI_GPURootSignature* mRootSignature = nullptr;
+		ER_RHI_PSO_HANDLE mPSOHandleNonInstanced = ER_RHI_INVALID_PSO_HANDLE;
+		ER_RHI_PSO_HANDLE mPSOHandleInstanced = ER_RHI_INVALID_PSO_HANDLE;
 
 		std::vector<ER_RHI_GPUTexture*> mShadowMaps;
 		std::vector<ER_Projector*> mLightProjectors;
 		std::vector<ER_Frustum> mCameraCascadesFrustums;
+		std::vector<ER_Frustum> mCasterCullingFrustums;
 		std::vector<XMFLOAT3> mLightProjectorCenteredPositions;
 
 		ER_RHI_RASTERIZER_STATE mOriginalRS;
@@ -0,0 +1,572 @@
+#include "stdafx.h"
+
+#include "ER_SphericalHarmonics.h"
+#include "ER_JobSystem.h"
+#include "ER_Utility.h"
+
+#include "DirectXSH.h"
+
+namespace EveryRay_Core
+{
+	// Cubemap face basis (D3D): direction = U * s + V * t + W, where s, t in [-1; 1] are texel centers along the row and the column
+	static const XMFLOAT3 ER_SHCubemapFacesU[6] = { { 0, 0, -1 }, { 0, 0, 1 }, { 1, 0, 0 }, { 1, 0, 0 }, { 1, 0, 0 }, { -1, 0, 0 } };
+	static const XMFLOAT3 ER_SHCubemapFacesV[6] = { { 0, -1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 }, { 0, -1, 0 }, { 0, -1, 0 } };
+	static const XMFLOAT3 ER_SHCubemapFacesW[6] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+
+	// Cosine lobe convolution per band (l = 0..3)
+	static const float ER_SHCosineLobe[ER_SH_MAX_ORDER + 1] = { XM_PI, 2.0f * XM_PI / 3.0f, XM_PI / 4.0f, 0.0f };
+
+	static inline UINT GetBand(UINT coefficientIndex)
+	{
+		return static_cast<UINT>(sqrtf(static_cast<float>(coefficientIndex)) + 0.0001f);
+	}
+
+	static inline float HorizontalSum(__m128 v)
+	{
+		__m128 shuffled = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1));
+		__m128 sums = _mm_add_ps(v, shuffled);
+		shuffled = _mm_movehl_ps(shuffled, sums);
+		return _mm_cvtss_f32(_mm_add_ss(sums, shuffled));
+	}
+
+	// Same basis (constants and signs) as sh_eval_basis_1/2/3() of DirectXSH.cpp, for ER_SH_BATCH_WIDTH unit directions at once
+	static inline void EvalBasisBatch(UINT order, __m128 x, __m128 y, __m128 z, __m128* outBasis)
+	{
+		outBasis[0] = _mm_set1_ps(0.282094791773878140f);
+		outBasis[1] = _mm_mul_ps(_mm_set1_ps(-0.488602511902919920f), y);
+		outBasis[2] = _mm_mul_ps(_mm_set1_ps(0.488602511902919920f), z);
+		outBasis[3] = _mm_mul_ps(_mm_set1_ps(-0.488602511902919920f), x);
+		if (order < 2)
+			return;
+
+		const __m128 z2 = _mm_mul_ps(z, z);
+		const __m128 s2 = _mm_add_ps(_mm_mul_ps(x, y), _mm_mul_ps(y, x));
+		const __m128 c2 = _mm_sub_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y));
+		const __m128 p21 = _mm_mul_ps(_mm_set1_ps(-1.092548430592079200f), z);
+		outBasis[4] = _mm_mul_ps(_mm_set1_ps(0.546274215296039590f), s2);
+		outBasis[5] = _mm_mul_ps(p21, y);
+		outBasis[6] = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(0.946174695757560080f), z2), _mm_set1_ps(-0.315391565252520050f));
+		outBasis[7] = _mm_mul_ps(p21, x);
+		outBasis[8] = _mm_mul_ps(_mm_set1_ps(0.546274215296039590f), c2);
+		if (order < 3)
+			return;
+
+		const __m128 s3 = _mm_add_ps(_mm_mul_ps(x, s2), _mm_mul_ps(y, c2));
+		const __m128 c3 = _mm_sub_ps(_mm_mul_ps(x, c2), _mm_mul_ps(y, s2));
+		const __m128 p31 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(-2.285228997322328800f), z2), _mm_set1_ps(0.457045799464465770f));
+		const __m128 p32 = _mm_mul_ps(_mm_set1_ps(1.445305721320277100f), z);
+		outBasis[9] = _mm_mul_ps(_mm_set1_ps(-0.590043589926643520f), s3);
+		outBasis[10] = _mm_mul_ps(p32, s2);
+		outBasis[11] = _mm_mul_ps(p31, y);
+		outBasis[12] = _mm_mul_ps(z, _mm_add_ps(_mm_mul_ps(_mm_set1_ps(1.865881662950577000f), z2), _mm_set1_ps(-1.119528997770346200f)));
+		outBasis[13] = _mm_mul_ps(p31, x);
+		outBasis[14] = _mm_mul_ps(p32, c2);
+		outBasis[15] = _mm_mul_ps(_mm_set1_ps(-0.590043589926643520f), c3);
+	}
+
+	static bool IsCubemapValid(UINT order, const ER_SHCubemap& aCubemap)
+	{
+		if (order < 1 || order > ER_SH_MAX_ORDER || aCubemap.Size == 0)
+			return false;
+		for (int face = 0; face < 6; face++)
+		{
+			if (!aCubemap.Faces[face])
+				return false;
+		}
+		return true;
+	}
+
+	ER_SHCubemap::ER_SHCubemap(const XMFLOAT4* aFacesData, UINT aSize)
+		: Size(aSize)
+	{
+		for (int face = 0; face < 6; face++)
+			Faces[face] = aFacesData ? aFacesData + face * aSize * aSize : nullptr;
+	}
+
+	bool ER_SphericalHarmonics::ProjectCubemap(UINT order, const ER_SHCubemap& aCubemap, XMFLOAT3* outCoefficients)
+	{
+		assert(outCoefficients);
+		if (!IsCubemapValid(order, aCubemap))
+			return false;
+
+		const UINT coefficientsCount = GetCoefficientsCount(order);
+		const UINT size = aCubemap.Size;
+		const float invSize = 1.0f / static_cast<float>(size);
+
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 four = _mm_set1_ps(4.0f);
+		const __m128 laneIndices = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+
+		__m128 accumulatedR[ER_SH_MAX_COEF_COUNT];
+		__m128 accumulatedG[ER_SH_MAX_COEF_COUNT];
+		__m128 accumulatedB[ER_SH_MAX_COEF_COUNT];
+		for (UINT i = 0; i < coefficientsCount; i++)
+			accumulatedR[i] = accumulatedG[i] = accumulatedB[i] = zero;
+		__m128 accumulatedWeight = zero;
+
+		__m128 basis[ER_SH_MAX_COEF_COUNT];
+		XMFLOAT4 tailTexels[ER_SH_BATCH_WIDTH];
+
+		for (int face = 0; face < 6; face++)
+		{
+			const __m128 ux = _mm_set1_ps(ER_SHCubemapFacesU[face].x), uy = _mm_set1_ps(ER_SHCubemapFacesU[face].y), uz = _mm_set1_ps(ER_SHCubemapFacesU[face].z);
+			const __m128 vx = _mm_set1_ps(ER_SHCubemapFacesV[face].x), vy = _mm_set1_ps(ER_SHCubemapFacesV[face].y), vz = _mm_set1_ps(ER_SHCubemapFacesV[face].z);
+			const __m128 wx = _mm_set1_ps(ER_SHCubemapFacesW[face].x), wy = _mm_set1_ps(ER_SHCubemapFacesW[face].y), wz = _mm_set1_ps(ER_SHCubemapFacesW[face].z);
+
+			for (UINT row = 0; row < size; row++)
+			{
+				const XMFLOAT4* rowTexels = aCubemap.Faces[face] + row * size;
+				const __m128 t = _mm_set1_ps((2.0f * row + 1.0f) * invSize - 1.0f);
+				// t's part of the direction is the same for the whole row
+				const __m128 rowX = _mm_add_ps(_mm_mul_ps(vx, t), wx);
+				const __m128 rowY = _mm_add_ps(_mm_mul_ps(vy, t), wy);
+				const __m128 rowZ = _mm_add_ps(_mm_mul_ps(vz, t), wz);
+				const __m128 rowLengthSq = _mm_add_ps(one, _mm_mul_ps(t, t));
+
+				for (UINT column = 0; column < size; column += ER_SH_BATCH_WIDTH)
+				{
+					const UINT laneCount = std::min((UINT)ER_SH_BATCH_WIDTH, size - column);
+					const XMFLOAT4* texels = rowTexels + column;
+					if (laneCount < ER_SH_BATCH_WIDTH)
+					{
+						for (UINT lane = 0; lane < ER_SH_BATCH_WIDTH; lane++)
+							tailTexels[lane] = (lane < laneCount) ? texels[lane] : XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
+						texels = tailTexels;
+					}
+
+					// AoS texels -> SoA channels
+					__m128 r = _mm_loadu_ps(&texels[0].x);
+					__m128 g = _mm_loadu_ps(&texels[1].x);
+					__m128 b = _mm_loadu_ps(&texels[2].x);
+					__m128 a = _mm_loadu_ps(&texels[3].x);
+					_MM_TRANSPOSE4_PS(r, g, b, a);
+
+					const __m128 columnIndices = _mm_add_ps(_mm_set1_ps(static_cast<float>(column)), laneIndices);
+					const __m128 s = _mm_sub_ps(_mm_mul_ps(_mm_add_ps(_mm_add_ps(columnIndices, columnIndices), one), _mm_set1_ps(invSize)), one);
+
+					// |(s, t, 1)|^2 == |U * s + V * t + W|^2 for every face
+					const __m128 invLength = _mm_div_ps(one, _mm_sqrt_ps(_mm_add_ps(rowLengthSq, _mm_mul_ps(s, s))));
+					const __m128 x = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(ux, s), rowX), invLength);
+					const __m128 y = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(uy, s), rowY), invLength);
+					const __m128 z = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(uz, s), rowZ), invLength);
+
+					// differential solid angle of the texel: 4 / (1 + s^2 + t^2)^(3/2) (lanes past the row's end get 0)
+					__m128 weight = _mm_mul_ps(four, _mm_mul_ps(invLength, _mm_mul_ps(invLength, invLength)));
+					weight = _mm_and_ps(weight, _mm_cmplt_ps(laneIndices, _mm_set1_ps(static_cast<float>(laneCount))));
+					accumulatedWeight = _mm_add_ps(accumulatedWeight, weight);
+
+					r = _mm_mul_ps(r, weight);
+					g = _mm_mul_ps(g, weight);
+					b = _mm_mul_ps(b, weight);
+
+					EvalBasisBatch(order, x, y, z, basis);
+					for (UINT i = 0; i < coefficientsCount; i++)
+					{
+						accumulatedR[i] = _mm_add_ps(accumulatedR[i], _mm_mul_ps(basis[i], r));
+						accumulatedG[i] = _mm_add_ps(accumulatedG[i], _mm_mul_ps(basis[i], g));
+						accumulatedB[i] = _mm_add_ps(accumulatedB[i], _mm_mul_ps(basis[i], b));
+					}
+				}
+			}
+		}
+
+		const float normalization = (4.0f * XM_PI) / HorizontalSum(accumulatedWeight);
+		for (UINT i = 0; i < coefficientsCount; i++)
+		{
+			outCoefficients[i] = XMFLOAT3(
+				HorizontalSum(accumulatedR[i]) * normalization,
+				HorizontalSum(accumulatedG[i]) * normalization,
+				HorizontalSum(accumulatedB[i]) * normalization);
+		}
+		return true;
+	}
+
+	bool ER_SphericalHarmonics::ProjectCubemapReference(UINT order, const ER_SHCubemap& aCubemap, XMFLOAT3* outCoefficients)
+	{
+		assert(outCoefficients);
+		if (!IsCubemapValid(order, aCubemap))
+			return false;
+
+		const size_t dxOrder = order + 1;
+		const UINT coefficientsCount = GetCoefficientsCount(order);
+		const UINT size = aCubemap.Size;
+		const float invSize = 1.0f / static_cast<float>(size);
+
+		float resultR[ER_SH_MAX_COEF_COUNT] = {};
+		float resultG[ER_SH_MAX_COEF_COUNT] = {};
+		float resultB[ER_SH_MAX_COEF_COUNT] = {};
+		float basis[ER_SH_MAX_COEF_COUNT] = {};
+		float scaledBasis[ER_SH_MAX_COEF_COUNT] = {};
+		float totalWeight = 0.0f;
+
+		for (int face = 0; face < 6; face++)
+		{
+			for (UINT row = 0; row < size; row++)
+			{
+				const float t = (2.0f * row + 1.0f) * invSize - 1.0f;
+				for (UINT column = 0; column < size; column++)
+				{
+					const float s = (2.0f * column + 1.0f) * invSize - 1.0f;
+					XMVECTOR direction = XMVectorSet(
+						ER_SHCubemapFacesU[face].x * s + ER_SHCubemapFacesV[face].x * t + ER_SHCubemapFacesW[face].x,
+						ER_SHCubemapFacesU[face].y * s + ER_SHCubemapFacesV[face].y * t + ER_SHCubemapFacesW[face].y,
+						ER_SHCubemapFacesU[face].z * s + ER_SHCubemapFacesV[face].z * t + ER_SHCubemapFacesW[face].z, 0.0f);
+					direction = XMVector3Normalize(direction);
+
+					const float weight = 4.0f / ((1.0f + s * s + t * t) * sqrtf(1.0f + s * s + t * t));
+					totalWeight += weight;
+
+					XMSHEvalDirection(basis, dxOrder, direction);
+					const XMFLOAT4& texel = aCubemap.Faces[face][row * size + column];
+					XMSHAdd(resultR, dxOrder, resultR, XMSHScale(scaledBasis, dxOrder, basis, texel.x * weight));
+					XMSHAdd(resultG, dxOrder, resultG, XMSHScale(scaledBasis, dxOrder, basis, texel.y * weight));
+					XMSHAdd(resultB, dxOrder, resultB, XMSHScale(scaledBasis, dxOrder, basis, texel.z * weight));
+				}
+			}
+		}
+
+		const float normalization = (4.0f * XM_PI) / totalWeight;
+		for (UINT i = 0; i < coefficientsCount; i++)
+			outCoefficients[i] = XMFLOAT3(resultR[i] * normalization, resultG[i] * normalization, resultB[i] * normalization);
+		return true;
+	}
+
+	bool ER_SphericalHarmonics::ProjectCubemaps(ER_JobSystem* aJobSystem, UINT order, const ER_SHCubemap* aCubemaps, UINT aCount, XMFLOAT3* outCoefficients)
+	{
+		assert(aCubemaps && outCoefficients);
+
+		const UINT coefficientsCount = GetCoefficientsCount(order);
+		std::atomic<UINT> failedCount { 0 };
+		auto projectCubemaps = [&](UINT begin, UINT end)
+		{
+			for (UINT i = begin; i < end; i++)
+			{
+				if (!ProjectCubemap(order, aCubemaps[i], outCoefficients + i * coefficientsCount))
+					failedCount++;
+			}
+		};
+
+		if (aJobSystem)
+			aJobSystem->ParallelFor(aCount, 1, projectCubemaps);
+		else
+			projectCubemaps(0, aCount);
+
+		return failedCount == 0;
+	}
+
+	void ER_SphericalHarmonics::EvalDirection(UINT order, const XMFLOAT3& aDirection, float* outBasis)
+	{
+		assert(order >= 1 && order <= ER_SH_MAX_ORDER);
+		XMSHEvalDirection(outBasis, order + 1, XMVector3Normalize(XMLoadFloat3(&aDirection)));
+	}
+
+	XMFLOAT3 ER_SphericalHarmonics::EvalRadiance(UINT order, const XMFLOAT3* aCoefficients, const XMFLOAT3& aDirection)
+	{
+		float basis[ER_SH_MAX_COEF_COUNT];
+		EvalDirection(order, aDirection, basis);
+
+		XMFLOAT3 result = XMFLOAT3(0.0f, 0.0f, 0.0f);
+		for (UINT i = 0; i < GetCoefficientsCount(order); i++)
+		{
+			result.x += aCoefficients[i].x * basis[i];
+			result.y += aCoefficients[i].y * basis[i];
+			result.z += aCoefficients[i].z * basis[i];
+		}
+		return result;
+	}
+
+	XMFLOAT3 ER_SphericalHarmonics::EvalIrradiance(UINT order, const XMFLOAT3* aCoefficients, const XMFLOAT3& aNormal)
+	{
+		float basis[ER_SH_MAX_COEF_COUNT];
+		EvalDirection(order, aNormal, basis);
+
+		XMFLOAT3 result = XMFLOAT3(0.0f, 0.0f, 0.0f);
+		for (UINT i = 0; i < GetCoefficientsCount(order); i++)
+		{
+			const float lobeBasis = basis[i] * ER_SHCosineLobe[GetBand(i)] / XM_PI;
+			result.x += aCoefficients[i].x * lobeBasis;
+			result.y += aCoefficients[i].y * lobeBasis;
+			result.z += aCoefficients[i].z * lobeBasis;
+		}
+		return result;
+	}
+
+	void ER_SphericalHarmonics::Rotate(UINT order, FXMMATRIX aRotation, const XMFLOAT3* aCoefficients, XMFLOAT3* outCoefficients)
+	{
+		assert(order >= 1 && order <= ER_SH_MAX_ORDER);
+		const UINT coefficientsCount = GetCoefficientsCount(order);
+
+		float input[3][ER_SH_MAX_COEF_COUNT];
+		float output[3][ER_SH_MAX_COEF_COUNT];
+		for (UINT i = 0; i < coefficientsCount; i++)
+		{
+			input[0][i] = aCoefficients[i].x;
+			input[1][i] = aCoefficients[i].y;
+			input[2][i] = aCoefficients[i].z;
+		}
+		for (int channel = 0; channel < 3; channel++)
+			XMSHRotate(output[channel], order + 1, aRotation, input[channel]);
+		for (UINT i = 0; i < coefficientsCount; i++)
+			outCoefficients[i] = XMFLOAT3(output[0][i], output[1][i], output[2][i]);
+	}
+
+	void ER_SphericalHarmonics::ApplyWindowing(UINT order, XMFLOAT3* aCoefficients, float aWidth)
+	{
+		const float width = (aWidth > 0.0f) ? aWidth : static_cast<float>(order + 1);
+		for (UINT i = 0; i < GetCoefficientsCount(order); i++)
+		{
+			const float band = static_cast<float>(GetBand(i));
+			const float window = (band < width) ? 0.5f * (1.0f + cosf(XM_PI * band / width)) : 0.0f;
+			aCoefficients[i] = XMFLOAT3(aCoefficients[i].x * window, aCoefficients[i].y * window, aCoefficients[i].z * window);
+		}
+	}
+
+	void ER_SphericalHarmonics::ConvolveWithCosineLobe(UINT order, XMFLOAT3* aCoefficients)
+	{
+		assert(order <= ER_SH_MAX_ORDER);
+		for (UINT i = 0; i < GetCoefficientsCount(order); i++)
+		{
+			const float lobe = ER_SHCosineLobe[GetBand(i)];
+			aCoefficients[i] = XMFLOAT3(aCoefficients[i].x * lobe, aCoefficients[i].y * lobe, aCoefficients[i].z * lobe);
+		}
+	}
+
+	// Synthetic probe for tests and benchmarks: sky gradient + a random "sun" + a random ground color
+	static void FillTestCubemap(UINT size, XMFLOAT4* outTexels)
+	{
+		XMVECTOR sunDirection = XMVector3Normalize(XMVectorSet(ER_Utility::RandomFloat(-1.0f, 1.0f), ER_Utility::RandomFloat(0.1f, 1.0f), ER_Utility::RandomFloat(-1.0f, 1.0f), 0.0f));
+		XMFLOAT3 groundColor = XMFLOAT3(ER_Utility::RandomFloat(0.0f, 0.5f), ER_Utility::RandomFloat(0.0f, 0.5f), ER_Utility::RandomFloat(0.0f, 0.5f));
+
+		for (int face = 0; face < 6; face++)
+		{
+			for (UINT row = 0; row < size; row++)
+			{
+				const float t = (2.0f * row + 1.0f) / size - 1.0f;
+				for (UINT column = 0; column < size; column++)
+				{
+					const float s = (2.0f * column + 1.0f) / size - 1.0f;
+					XMVECTOR direction = XMVector3Normalize(XMVectorSet(
+						ER_SHCubemapFacesU[face].x * s + ER_SHCubemapFacesV[face].x * t + ER_SHCubemapFacesW[face].x,
+						ER_SHCubemapFacesU[face].y * s + ER_SHCubemapFacesV[face].y * t + ER_SHCubemapFacesW[face].y,
+						ER_SHCubemapFacesU[face].z * s + ER_SHCubemapFacesV[face].z * t + ER_SHCubemapFacesW[face].z, 0.0f));
+					const float up = XMVectorGetY(direction);
+					const float sun = powf(std::max(XMVectorGetX(XMVector3Dot(direction, sunDirection)), 0.0f), 32.0f) * 10.0f;
+					outTexels[(face * size + row) * size + column] = (up > 0.0f) ?
+						XMFLOAT4(0.2f + 0.3f * up + sun, 0.3f + 0.4f * up + sun, 0.5f + 0.5f * up + sun, 1.0f) :
+						XMFLOAT4(groundColor.x, groundColor.y, groundColor.z, 1.0f);
+				}
+			}
+		}
+	}
+
+	// Max. difference of the coefficients relative to the largest one (errors of the float sums grow with the values)
+	static float GetRelativeError(UINT aCount, const XMFLOAT3* aCoefficients, const XMFLOAT3* aExpectedCoefficients)
+	{
+		float maxError = 0.0f;
+		float maxValue = 1.0f;
+		for (UINT i = 0; i < aCount; i++)
+		{
+			maxError = std::max(maxError, fabs(aCoefficients[i].x - aExpectedCoefficients[i].x));
+			maxError = std::max(maxError, fabs(aCoefficients[i].y - aExpectedCoefficients[i].y));
+			maxError = std::max(maxError, fabs(aCoefficients[i].z - aExpectedCoefficients[i].z));
+			maxValue = std::max(maxValue, std::max(fabs(aExpectedCoefficients[i].x), std::max(fabs(aExpectedCoefficients[i].y), fabs(aExpectedCoefficients[i].z))));
+		}
+		return maxError / maxValue;
+	}
+
+	static bool IsNear(const XMFLOAT3& a, const XMFLOAT3& b, float aTolerance)
+	{
+		return fabs(a.x - b.x) <= aTolerance && fabs(a.y - b.y) <= aTolerance && fabs(a.z - b.z) <= aTolerance;
+	}
+
+	bool ER_SphericalHarmonics::RunTests(ER_JobSystem* aJobSystem)
+	{
+		UINT passedCount = 0;
+		UINT failedCount = 0;
+		auto check = [&](bool aCondition, const std::string& aName)
+		{
+			if (aCondition)
+				passedCount++;
+			else
+			{
+				failedCount++;
+				ER_OUTPUT_LOG(ER_Utility::ToWideString("[ER Logger][ER_SphericalHarmonics] Test FAILED: " + aName + "\n").c_str());
+			}
+		};
+
+		const float tolerance = 0.001f;
+		XMFLOAT3 coefficients[ER_SH_MAX_COEF_COUNT];
+		XMFLOAT3 referenceCoefficients[ER_SH_MAX_COEF_COUNT];
+
+		// invalid input is rejected
+		{
+			std::vector<XMFLOAT4> texels(6 * 4 * 4, XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f));
+			ER_SHCubemap missingFace(texels.data(), 4);
+			missingFace.Faces[3] = nullptr;
+			check(!ProjectCubemap(0, ER_SHCubemap(texels.data(), 4), coefficients) && !ProjectCubemap(ER_SH_MAX_ORDER + 1, ER_SHCubemap(texels.data(), 4), coefficients),
+				"orders outside of [1; ER_SH_MAX_ORDER] are rejected");
+			check(!ProjectCubemap(2, ER_SHCubemap(texels.data(), 0), coefficients) && !ProjectCubemap(2, missingFace, coefficients) && !ProjectCubemapReference(2, missingFace, coefficients),
+				"empty cubemaps are rejected");
+		}
+
+		// constant radiance: only the first coefficient (sqrt(4 * Pi) * radiance), the same radiance and irradiance in every direction
+		{
+			const XMFLOAT3 radiance = XMFLOAT3(0.5f, 1.0f, 2.0f);
+			const UINT size = 7; // not a multiple of ER_SH_BATCH_WIDTH (the tail of the rows)
+			std::vector<XMFLOAT4> texels(6 * size * size, XMFLOAT4(radiance.x, radiance.y, radiance.z, 1.0f));
+			for (UINT order = 1; order <= ER_SH_MAX_ORDER; order++)
+			{
+				const std::string orderName = " (order " + std::to_string(order) + ")";
+				const bool isProjected = ProjectCubemap(order, ER_SHCubemap(texels.data(), size), coefficients);
+				check(isProjected && ProjectCubemapReference(order, ER_SHCubemap(texels.data(), size), referenceCoefficients), "constant cubemap is projected" + orderName);
+				if (!isProjected)
+					continue;
+
+				const float dc = sqrtf(4.0f * XM_PI);
+				bool isOnlyDC = IsNear(coefficients[0], XMFLOAT3(radiance.x * dc, radiance.y * dc, radiance.z * dc), tolerance * radiance.z * dc);
+				for (UINT i = 1; i < GetCoefficientsCount(order); i++)
+					isOnlyDC = isOnlyDC && IsNear(coefficients[i], XMFLOAT3(0.0f, 0.0f, 0.0f), tolerance);
+				check(isOnlyDC, "constant cubemap has only the first coefficient" + orderName);
+				check(GetRelativeError(GetCoefficientsCount(order), coefficients, referenceCoefficients) < tolerance, "constant cubemap matches the reference" + orderName);
+
+				bool isConstant = true;
+				for (int i = 0; i < 16; i++)
+				{
+					const XMFLOAT3 direction = XMFLOAT3(ER_Utility::RandomFloat(-1.0f, 1.0f), ER_Utility::RandomFloat(-1.0f, 1.0f), ER_Utility::RandomFloat(-1.0f, 1.0f) + 1.5f);
+					isConstant = isConstant && IsNear(EvalRadiance(order, coefficients, direction), radiance, tolerance * radiance.z);
+					isConstant = isConstant && IsNear(EvalIrradiance(order, coefficients, direction), radiance, tolerance * radiance.z);
+				}
+				check(isConstant, "constant cubemap has the same radiance and irradiance in every direction" + orderName);
+			}
+		}
+
+		// synthetic probes: the SIMD path matches the reference, the job system does not change the results
+		{
+			const UINT probesCount = 8;
+			const UINT sizes[2] = { 32, 13 };
+			for (UINT size : sizes)
+			{
+				std::vector<XMFLOAT4> texels(probesCount * 6 * size * size);
+				std::vector<ER_SHCubemap> cubemaps(probesCount);
+				for (UINT probe = 0; probe < probesCount; probe++)
+				{
+					FillTestCubemap(size, &texels[probe * 6 * size * size]);
+					cubemaps[probe] = ER_SHCubemap(&texels[probe * 6 * size * size], size);
+				}
+
+				for (UINT order = 1; order <= ER_SH_MAX_ORDER; order++)
+				{
+					const std::string caseName = " (order " + std::to_string(order) + ", " + std::to_string(size) + "x" + std::to_string(size) + ")";
+					const UINT coefficientsCount = GetCoefficientsCount(order);
+
+					float maxError = 0.0f;
+					for (UINT probe = 0; probe < probesCount; probe++)
+					{
+						ProjectCubemap(order, cubemaps[probe], coefficients);
+						ProjectCubemapReference(order, cubemaps[probe], referenceCoefficients);
+						maxError = std::max(maxError, GetRelativeError(coefficientsCount, coefficients, referenceCoefficients));
+					}
+					check(maxError < tolerance, "SIMD projection matches the reference" + caseName);
+
+					std::vector<XMFLOAT3> batchCoefficients(probesCount * coefficientsCount);
+					bool isSame = ProjectCubemaps(aJobSystem, order, cubemaps.data(), probesCount, batchCoefficients.data());
+					for (UINT probe = 0; probe < probesCount && isSame; probe++)
+					{
+						ProjectCubemap(order, cubemaps[probe], coefficients);
+						isSame = memcmp(coefficients, &batchCoefficients[probe * coefficientsCount], coefficientsCount * sizeof(XMFLOAT3)) == 0;
+					}
+					check(isSame, "ProjectCubemaps() matches ProjectCubemap()" + caseName);
+				}
+			}
+		}
+
+		// rotation and cosine lobe convolution
+		{
+			const UINT size = 16;
+			std::vector<XMFLOAT4> texels(6 * size * size);
+			FillTestCubemap(size, texels.data());
+			ProjectCubemap(ER_SH_MAX_ORDER, ER_SHCubemap(texels.data(), size), coefficients);
+			const UINT coefficientsCount = GetCoefficientsCount(ER_SH_MAX_ORDER);
+
+			XMMATRIX rotation = XMMatrixRotationRollPitchYaw(0.3f, 1.1f, -0.7f);
+			XMFLOAT3 rotatedCoefficients[ER_SH_MAX_COEF_COUNT];
+			XMFLOAT3 restoredCoefficients[ER_SH_MAX_COEF_COUNT];
+			Rotate(ER_SH_MAX_ORDER, rotation, coefficients, rotatedCoefficients);
+			Rotate(ER_SH_MAX_ORDER, XMMatrixTranspose(rotation), rotatedCoefficients, restoredCoefficients);
+			check(GetRelativeError(coefficientsCount, restoredCoefficients, coefficients) < tolerance, "rotation and the inverse rotation give the same coefficients");
+
+			XMFLOAT3 convolvedCoefficients[ER_SH_MAX_COEF_COUNT];
+			memcpy(convolvedCoefficients, coefficients, coefficientsCount * sizeof(XMFLOAT3));
+			ConvolveWithCosineLobe(ER_SH_MAX_ORDER, convolvedCoefficients);
+			bool isConsistent = true;
+			for (int i = 0; i < 16; i++)
+			{
+				const XMFLOAT3 normal = XMFLOAT3(ER_Utility::RandomFloat(-1.0f, 1.0f), ER_Utility::RandomFloat(-1.0f, 1.0f), ER_Utility::RandomFloat(-1.0f, 1.0f) + 1.5f);
+				const XMFLOAT3 irradiance = EvalIrradiance(ER_SH_MAX_ORDER, coefficients, normal);
+				const XMFLOAT3 convolvedRadiance = EvalRadiance(ER_SH_MAX_ORDER, convolvedCoefficients, normal);
+				isConsistent = isConsistent && IsNear(irradiance, XMFLOAT3(convolvedRadiance.x / XM_PI, convolvedRadiance.y / XM_PI, convolvedRadiance.z / XM_PI), tolerance * 10.0f);
+			}
+			check(isConsistent, "EvalIrradiance() matches EvalRadiance() of the convolved coefficients");
+		}
+
+		std::string message = "[ER Logger][ER_SphericalHarmonics] Tests: " + std::to_string(passedCount) + " passed, " + std::to_string(failedCount) + " failed\n";
+		ER_OUTPUT_LOG(ER_Utility::ToWideString(message).c_str());
+		return failedCount == 0;
+	}
+
+	void ER_SphericalHarmonics::RunBenchmark(ER_JobSystem* aJobSystem)
+	{
+		const UINT size = 32; // == DIFFUSE_PROBE_SIZE
+		const UINT probesCount = 128;
+		const UINT referenceProbesCount = 16; // the reference path is slow
+
+		std::vector<XMFLOAT4> texels(probesCount * 6 * size * size);
+		std::vector<ER_SHCubemap> cubemaps(probesCount);
+		for (UINT probe = 0; probe < probesCount; probe++)
+		{
+			XMFLOAT4* probeTexels = &texels[probe * 6 * size * size];
+			FillTestCubemap(size, probeTexels);
+			cubemaps[probe] = ER_SHCubemap(probeTexels, size);
+		}
+
+		for (UINT order = 2; order <= ER_SH_MAX_ORDER; order++)
+		{
+			const UINT coefficientsCount = GetCoefficientsCount(order);
+			std::vector<XMFLOAT3> referenceCoefficients(referenceProbesCount * coefficientsCount);
+			std::vector<XMFLOAT3> coefficients(probesCount * coefficientsCount);
+
+			auto startReference = std::chrono::high_resolution_clock::now();
+			for (UINT probe = 0; probe < referenceProbesCount; probe++)
+				ProjectCubemapReference(order, cubemaps[probe], &referenceCoefficients[probe * coefficientsCount]);
+			auto endReference = std::chrono::high_resolution_clock::now();
+
+			auto startSIMD = std::chrono::high_resolution_clock::now();
+			ProjectCubemaps(nullptr, order, cubemaps.data(), probesCount, coefficients.data());
+			auto endSIMD = std::chrono::high_resolution_clock::now();
+
+			auto startParallel = std::chrono::high_resolution_clock::now();
+			ProjectCubemaps(aJobSystem, order, cubemaps.data(), probesCount, coefficients.data());
+			auto endParallel = std::chrono::high_resolution_clock::now();
+
+			float maxError = 0.0f;
+			for (UINT i = 0; i < referenceProbesCount * coefficientsCount; i++)
+			{
+				maxError = std::max(maxError, fabs(coefficients[i].x - referenceCoefficients[i].x));
+				maxError = std::max(maxError, fabs(coefficients[i].y - referenceCoefficients[i].y));
+				maxError = std::max(maxError, fabs(coefficients[i].z - referenceCoefficients[i].z));
+			}
+
+			std::chrono::duration<double> referenceTime = endReference - startReference;
+			std::chrono::duration<double> simdTime = endSIMD - startSIMD;
+			std::chrono::duration<double> parallelTime = endParallel - startParallel;
+			const UINT workersCount = aJobSystem ? aJobSystem->GetWorkerCount() : 0;
+
+			std::string message = "[ER Logger][ER_SphericalHarmonics] Benchmark for order " + std::to_string(order) + " (" + std::to_string(size) + "x" + std::to_string(size) + " cubemaps): reference " +
+				std::to_string(referenceProbesCount / std::max(referenceTime.count(), 0.000001)) + " probes/s, SIMD (width " + std::to_string(ER_SH_BATCH_WIDTH) + ") " +
+				std::to_string(probesCount / std::max(simdTime.count(), 0.000001)) + " probes/s, SIMD + job system (" + std::to_string(workersCount) + " workers) " +
+				std::to_string(probesCount / std::max(parallelTime.count(), 0.000001)) + " probes/s, max. error vs. reference " + std::to_string(maxError) + "\n";
+			ER_OUTPUT_LOG(ER_Utility::ToWideString(message).c_str());
+		}
+	}
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include "Common.h"
+
+#define ER_SH_MAX_ORDER 3 // highest band (l) of the CPU projection; (order + 1)^2 coefficients per channel
+#define ER_SH_MAX_COEF_COUNT ((ER_SH_MAX_ORDER + 1) * (ER_SH_MAX_ORDER + 1))
+#define ER_SH_BATCH_WIDTH 4 // texels per SIMD iteration (SSE)
+
+namespace EveryRay_Core
+{
+	class ER_JobSystem;
+
+	// Cubemap for the CPU projection: 6 faces (+X, -X, +Y, -Y, +Z, -Z) of Size * Size linear RGBA texels (rows from the top), as in D3D
+	struct ER_SHCubemap
+	{
+		UINT Size = 0;
+		const XMFLOAT4* Faces[6] = { nullptr };
+
+		ER_SHCubemap() {}
+		ER_SHCubemap(const XMFLOAT4* aFacesData, UINT aSize); // faces stored one after another (i.e., ER_RHI::ReadGPUTextureToCPU())
+	};
+
+	// CPU spherical harmonics for light probes (runs on any RHI and without a GPU, i.e., in offline bakes).
+	// Coefficients are RGB, in DirectXMath's basis and order (XMSHEvalDirection(), SHProjectCubeMap()), which Lighting.hlsli expects.
+	// NOTE: "order" is the highest band here (SPHERICAL_HARMONICS_ORDER), DirectXMath's "order" is the number of bands (order + 1).
+	class ER_SphericalHarmonics
+	{
+	public:
+		static UINT GetCoefficientsCount(UINT order) { return (order + 1) * (order + 1); }
+
+		// Projection with texel solid angle weighting; the SIMD path processes ER_SH_BATCH_WIDTH texels per iteration
+		static bool ProjectCubemap(UINT order, const ER_SHCubemap& aCubemap, XMFLOAT3* outCoefficients);
+		// Same as DirectX::SHProjectCubeMap() (one texel at a time with XMSHEvalDirection()); used to validate ProjectCubemap()
+		static bool ProjectCubemapReference(UINT order, const ER_SHCubemap& aCubemap, XMFLOAT3* outCoefficients);
+		// Many probes at once (in parallel on ER_JobSystem's workers, if any); outCoefficients has GetCoefficientsCount(order) entries per cubemap
+		static bool ProjectCubemaps(ER_JobSystem* aJobSystem, UINT order, const ER_SHCubemap* aCubemaps, UINT aCount, XMFLOAT3* outCoefficients);
+
+		static void EvalDirection(UINT order, const XMFLOAT3& aDirection, float* outBasis);
+		static XMFLOAT3 EvalRadiance(UINT order, const XMFLOAT3* aCoefficients, const XMFLOAT3& aDirection);
+		// Diffuse irradiance (/ Pi) for the normal, same as GetDiffuseIrradianceFromSphericalHarmonics() in Lighting.hlsli
+		static XMFLOAT3 EvalIrradiance(UINT order, const XMFLOAT3* aCoefficients, const XMFLOAT3& aNormal);
+
+		static void Rotate(UINT order, FXMMATRIX aRotation, const XMFLOAT3* aCoefficients, XMFLOAT3* outCoefficients);
+		// Hanning window against ringing of high bands ("Stupid Spherical Harmonics (SH) Tricks", P.-P. Sloan); aWidth <= 0 - (order + 1)
+		static void ApplyWindowing(UINT order, XMFLOAT3* aCoefficients, float aWidth = 0.0f);
+		// Convolution with the clamped cosine lobe (radiance -> irradiance)
+		static void ConvolveWithCosineLobe(UINT order, XMFLOAT3* aCoefficients);
+
+		// Checks of the projections (constant and synthetic cubemaps vs. the reference), rotation and convolution (output in log). Returns false if something has failed.
+		static bool RunTests(ER_JobSystem* aJobSystem);
+		// CPU benchmark: probes per second of the reference, SIMD and SIMD + job system projections (+ max. error vs. the reference).
+		// Results are written to the log.
+		static void RunBenchmark(ER_JobSystem* aJobSystem);
+	};
+}
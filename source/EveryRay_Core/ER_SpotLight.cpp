@@ -0,0 +1,38 @@
+#include "stdafx.h"
+#include <algorithm>
+
+#include "ER_SpotLight.h"
+#include "ER_VectorHelper.h"
+
+namespace EveryRay_Core
+{
+	RTTI_DEFINITIONS(ER_SpotLight)
+
+	const float ER_SpotLight::DefaultInnerAngle = 20.0f;
+	const float ER_SpotLight::DefaultOuterAngle = 30.0f;
+
+	ER_SpotLight::ER_SpotLight(ER_Core& game)
+		: ER_PointLight(game), mDirection(ER_Vector3Helper::Forward), mInnerAngle(DefaultInnerAngle), mOuterAngle(DefaultOuterAngle)
+	{
+	}
+
+	ER_SpotLight::~ER_SpotLight()
+	{
+	}
+
+	XMVECTOR ER_SpotLight::DirectionVector() const
+	{
+		return XMLoadFloat3(&mDirection);
+	}
+
+	void ER_SpotLight::SetDirection(const XMFLOAT3& direction)
+	{
+		XMStoreFloat3(&mDirection, XMVector3Normalize(XMLoadFloat3(&direction)));
+	}
+
+	void ER_SpotLight::SetAngles(float innerAngle, float outerAngle)
+	{
+		mOuterAngle = std::max(std::min(outerAngle, 89.0f), 0.1f);
+		mInnerAngle = std::max(std::min(innerAngle, mOuterAngle), 0.0f);
+	}
+}
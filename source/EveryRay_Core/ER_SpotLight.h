@@ -0,0 +1,34 @@
+#pragma once
+
+#include "Common.h"
+#include "ER_PointLight.h"
+
+namespace EveryRay_Core
+{
+	// Point light with a cone (inner angle - full intensity, outer angle - no light, smooth falloff in between)
+	class ER_SpotLight : public ER_PointLight
+	{
+		RTTI_DECLARATIONS(ER_SpotLight, ER_PointLight)
+
+	public:
+		ER_SpotLight(ER_Core& game);
+		virtual ~ER_SpotLight();
+
+		const XMFLOAT3& Direction() const { return mDirection; }
+		XMVECTOR DirectionVector() const;
+		float InnerAngle() const { return mInnerAngle; }
+		float OuterAngle() const { return mOuterAngle; }
+
+		void SetDirection(const XMFLOAT3& direction);
+		// in degrees (half angles of the cone); inner is clamped to outer
+		void SetAngles(float innerAngle, float outerAngle);
+
+		static const float DefaultInnerAngle;
+		static const float DefaultOuterAngle;
+
+	protected:
+		XMFLOAT3 mDirection;
+		float mInnerAngle;
+		float mOuterAngle;
+	};
+}
@@ -16,6 +16,9 @@
 #include "ER_LightProbe.h"
 #include "ER_RenderableAABB.h"
 #include "ER_Camera.h"
+#include "ER_JobSystem.h"
+
+#include <algorithm>
 
 #define USE_RAYCASTING_FOR_ON_TERRAIN_PLACEMENT 0
 
@@ -103,6 +106,19 @@ namespace EveryRay_Core
 
 	ER_Terrain::~ER_Terrain()
 	{
+		if (mIsStreamingThreadsRunning)
+		{
+			{
+				std::lock_guard<std::mutex> lock(mStreamingMutex);
+				mIsStreamingThreadsRunning = false;
+			}
+			mStreamingCondition.notify_all();
+			for (auto& thread : mStreamingThreads)
+				thread.join();
+			mStreamingThreads.clear();
+		}
+		ReleaseStreamedResources(true);
+
 		DeletePointerCollection(mHeightMaps);
 		for (int i = 0; i < NUM_TEXTURE_SPLAT_CHANNELS; i++)
 			DeleteObject(mSplatChannelTextures[i]);
@@ -161,10 +177,14 @@ namespace EveryRay_Core
 		if (mNumTiles > MAX_TERRAIN_TILE_COUNT)
 			throw ER_CoreException("Number of tiles exceeds MAX_TERRAIN_TILE_COUNT!");
 
+		mIsStreaming = aScene->IsTerrainStreaming();
+
+		// in streaming mode tiles only get CPU/GPU data when they become resident
 		for (int i = 0; i < mNumTiles; i++)
-			mHeightMaps.push_back(new HeightMap(mWidth, mHeight));
+			mHeightMaps.push_back(new HeightMap(mWidth, mHeight, !mIsStreaming));
 
 		std::wstring path = mLevelPath + L"terrain\\";
+		mTerrainTexturesPath = path;
 		LoadTextures(path, 
 			path + aScene->GetTerrainSplatLayerTextureName(0),
 			path + aScene->GetTerrainSplatLayerTextureName(1),
@@ -172,6 +192,12 @@ namespace EveryRay_Core
 			path + aScene->GetTerrainSplatLayerTextureName(3)
 		); //not thread-safe
 
+		if (mIsStreaming)
+		{
+			InitializeStreaming(aScene, aScene->cameraPosition);
+			return;
+		}
+
 		for (int i = 0; i < mNumTiles; i++)
 		{
 			LoadTile(i, path); //not thread-safe
@@ -192,7 +218,7 @@ namespace EveryRay_Core
 		mTerrainTilesHeightmapsArrayTexture = rhi->CreateGPUTexture(L"ER_RHI_GPUTexture: Terrain Tiles Heightmaps Array");
 		mTerrainTilesHeightmapsArrayTexture->CreateGPUTextureResource(rhi, mTileResolution, mTileResolution, 1, ER_FORMAT_R16_UNORM, ER_BIND_SHADER_RESOURCE, 1, -1, mNumTiles);
 		
-		mTerrainTilesSplatmapsArrayTexture = rhi->CreateGPUTexture(L"ER_RHI_GPUTexture: Terraub Tiles Splatmaps Array");
+		mTerrainTilesSplatmapsArrayTexture = rhi->CreateGPUTexture(L"ER_RHI_GPUTexture: Terrain Tiles Splatmaps Array");
 		mTerrainTilesSplatmapsArrayTexture->CreateGPUTextureResource(rhi, mTileResolution, mTileResolution, 1, ER_FORMAT_R16G16B16A16_UNORM, ER_BIND_SHADER_RESOURCE, 1, -1, mNumTiles);
 		
 		for (int tileIndex = 0; tileIndex < mNumTiles; tileIndex++)
@@ -261,6 +287,9 @@ namespace EveryRay_Core
 			);
 		}
 
+		if (mIsStreaming)
+			return; // per-tile textures are loaded in MakeTileResident()
+
 		int numTilesSqrt = sqrt(mNumTiles);
 
 		for (int i = 0; i < numTilesSqrt; i++)
@@ -295,7 +324,7 @@ namespace EveryRay_Core
 		CreateTerrainTileDataGPU(tileX, tileY);
 	}
 
-	void ER_Terrain::LoadSplatmapPerTileGPU(int tileIndexX, int tileIndexY, const std::wstring& path)
+	void ER_Terrain::LoadSplatmapPerTileGPU(int tileIndexX, int tileIndexY, const std::wstring& path, bool generateMips)
 	{
 		ER_RHI* rhi = GetCore()->GetRHI();
 
@@ -305,6 +334,8 @@ namespace EveryRay_Core
 
 		mHeightMaps[tileIndex]->mSplatTexture = rhi->CreateGPUTexture(L"");
 		mHeightMaps[tileIndex]->mSplatTexture->CreateGPUTextureResource(rhi, path, true);
+		if (!generateMips)
+			return;
 		rhi->GenerateMipsWithTextureReplacement(&mHeightMaps[tileIndex]->mSplatTexture,
 			[this, tileIndex](ER_RHI_GPUTexture** aNewTextureWithMips)
 			{
@@ -364,12 +395,13 @@ namespace EveryRay_Core
 		mHeightMaps[tileIndex]->mTileUVOffset = XMFLOAT2(terrainTileSize - tileIndexX * terrainTileSize, tileIndexY * terrainTileSize);
 	}
 
-	// Create CPU tile data which is used for terrain debugging, collisions, placement of ER_RenderingObject(s) (no GPU tessellation pipeline)
-	void ER_Terrain::CreateTerrainTileDataCPU(int tileIndexX, int tileIndexY, const std::wstring& aPath)
+	// Load CPU tile data (heights, min/max quadtree for collisions, AABB) from the raw heightmap. Only touches this tile's HeightMap, so streaming threads can call it.
+	void ER_Terrain::LoadTerrainTileHeightsCPU(int tileIndexX, int tileIndexY, const std::wstring& aPath)
 	{
 		int tileIndex = tileIndexX * sqrt(mNumTiles) + tileIndexY;
 		assert(tileIndex < mHeightMaps.size());
-		ER_RHI* rhi = GetCore()->GetRHI();
+		HeightMap* tile = mHeightMaps[tileIndex];
+		assert(tile->mData);
 
 		int error, i, j, index;
 		FILE* filePtr;
@@ -410,14 +442,14 @@ namespace EveryRay_Core
 					index = (mWidth * j) + i;
 
 					// Store the height at this point in the height map array.
-					mHeightMaps[tileIndex]->mData[index].x = static_cast<float>(i * mTileScale + tileSize * (tileIndexX - 1));
-					mHeightMaps[tileIndex]->mData[index].y = static_cast<float>(rawImage[index]) / 200.0f;//TODO mTerrainNonTessellatedHeightScale;
-					mHeightMaps[tileIndex]->mData[index].z = static_cast<float>(j * mTileScale - tileSize * tileIndexY);
+					tile->mData[index].x = static_cast<float>(i * mTileScale + tileSize * (tileIndexX - 1));
+					tile->mData[index].y = static_cast<float>(rawImage[index]) / 200.0f;//TODO mTerrainNonTessellatedHeightScale;
+					tile->mData[index].z = static_cast<float>(j * mTileScale - tileSize * tileIndexY);
 
 					if (tileIndex > 0) //a way to fix the seams between tiles...
 					{
-						mHeightMaps[tileIndex]->mData[index].x -= static_cast<float>(tileIndexX) /** scale*/;
-						mHeightMaps[tileIndex]->mData[index].z += static_cast<float>(tileIndexY) /** scale*/;
+						tile->mData[index].x -= static_cast<float>(tileIndexX) /** scale*/;
+						tile->mData[index].z += static_cast<float>(tileIndexY) /** scale*/;
 					}
 
 				}
@@ -428,87 +460,68 @@ namespace EveryRay_Core
 			rawImage = 0;
 		}
 
-		// Generate CPU mesh (and its GPU vertex/index buffers) + calculate AABB of the tile
+		// Calculate AABB of the tile + acceleration structure for CPU queries
 		{
-			mHeightMaps[tileIndex]->mVertexCountNonTS = (mWidth - 1) * (mHeight - 1) * 6;
-			DebugTerrainVertexInput* vertices = new DebugTerrainVertexInput[mHeightMaps[tileIndex]->mVertexCountNonTS];
+			XMFLOAT3 minVertex = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+			XMFLOAT3 maxVertex = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+			for (int index = 0; index < static_cast<int>(mWidth * mHeight); index++)
+			{
+				const auto& point = tile->mData[index];
+
+				minVertex.x = std::min(minVertex.x, point.x);
+				minVertex.y = std::min(minVertex.y, point.y);
+				minVertex.z = std::min(minVertex.z, point.z);
 
-			mHeightMaps[tileIndex]->mIndexCountNonTS = mHeightMaps[tileIndex]->mVertexCountNonTS;
-			unsigned long* indices = new unsigned long[mHeightMaps[tileIndex]->mIndexCountNonTS];
+				maxVertex.x = std::max(maxVertex.x, point.x);
+				maxVertex.y = std::max(maxVertex.y, point.y);
+				maxVertex.z = std::max(maxVertex.z, point.z);
+			}
+			tile->mAABB = { minVertex, maxVertex };
 
+			tile->BuildMinMaxQuadtree(static_cast<float>(mTileScale));
+		}
+	}
+
+	// Create CPU tile data which is used for terrain debugging, collisions, placement of ER_RenderingObject(s) (no GPU tessellation pipeline)
+	void ER_Terrain::CreateTerrainTileDataCPU(int tileIndexX, int tileIndexY, const std::wstring& aPath)
+	{
+		int tileIndex = tileIndexX * sqrt(mNumTiles) + tileIndexY;
+		assert(tileIndex < mHeightMaps.size());
+		ER_RHI* rhi = GetCore()->GetRHI();
+
+		LoadTerrainTileHeightsCPU(tileIndexX, tileIndexY, aPath);
+
+		// Generate GPU vertex/index buffers of the CPU mesh (two triangles per quad: upper left, upper right, bottom left, bottom left, upper right, bottom right)
+		{
+			HeightMap* tile = mHeightMaps[tileIndex];
+			tile->mVertexCountNonTS = mWidth * mHeight;
+			DebugTerrainVertexInput* vertices = new DebugTerrainVertexInput[tile->mVertexCountNonTS];
+			for (int i = 0; i < tile->mVertexCountNonTS; i++)
+				vertices[i].Position = XMFLOAT4(tile->mData[i].x, tile->mData[i].y, tile->mData[i].z, 1.0f);
+
+			tile->mIndexCountNonTS = (mWidth - 1) * (mHeight - 1) * 6;
+			unsigned long* indices = new unsigned long[tile->mIndexCountNonTS];
 			int index = 0;
-			int index1, index2, index3, index4;
-			// Load the vertex and index array with the terrain data.
 			for (int j = 0; j < ((int)mHeight - 1); j++)
 			{
 				for (int i = 0; i < ((int)mWidth - 1); i++)
 				{
-					index1 = (mHeight * j) + i;					// Bottom left.	
-					index2 = (mHeight * j) + (i + 1);			// Bottom right.
-					index3 = (mHeight * (j + 1)) + i;			// Upper left.	
-					index4 = (mHeight * (j + 1)) + (i + 1);		// Upper right.	
-
-					// Upper left.
-					vertices[index].Position = XMFLOAT4(mHeightMaps[tileIndex]->mData[index3].x, mHeightMaps[tileIndex]->mData[index3].y, mHeightMaps[tileIndex]->mData[index3].z, 1.0f);
-					indices[index] = index;
-					index++;
-
-					// Upper right.
-					vertices[index].Position = XMFLOAT4(mHeightMaps[tileIndex]->mData[index4].x, mHeightMaps[tileIndex]->mData[index4].y, mHeightMaps[tileIndex]->mData[index4].z, 1.0f);
-					indices[index] = index;
-					index++;
-
-					// Bottom left.
-					vertices[index].Position = XMFLOAT4(mHeightMaps[tileIndex]->mData[index1].x, mHeightMaps[tileIndex]->mData[index1].y, mHeightMaps[tileIndex]->mData[index1].z, 1.0f);
-					indices[index] = index;
-					index++;
-
-					// Bottom left.
-					vertices[index].Position = XMFLOAT4(mHeightMaps[tileIndex]->mData[index1].x, mHeightMaps[tileIndex]->mData[index1].y, mHeightMaps[tileIndex]->mData[index1].z, 1.0f);
-					indices[index] = index;
-					index++;
-
-					// Upper right.
-					vertices[index].Position = XMFLOAT4(mHeightMaps[tileIndex]->mData[index4].x, mHeightMaps[tileIndex]->mData[index4].y, mHeightMaps[tileIndex]->mData[index4].z, 1.0f);
-					indices[index] = index;
-					index++;
-
-					// Bottom right.
-					vertices[index].Position = XMFLOAT4(mHeightMaps[tileIndex]->mData[index2].x, mHeightMaps[tileIndex]->mData[index2].y, mHeightMaps[tileIndex]->mData[index2].z, 1.0f);
-					indices[index] = index;
-					index++;
+					indices[index++] = (mWidth * (j + 1)) + i;		// Upper left.
+					indices[index++] = (mWidth * (j + 1)) + (i + 1);	// Upper right.
+					indices[index++] = (mWidth * j) + i;				// Bottom left.
+					indices[index++] = (mWidth * j) + i;				// Bottom left.
+					indices[index++] = (mWidth * (j + 1)) + (i + 1);	// Upper right.
+					indices[index++] = (mWidth * j) + (i + 1);		// Bottom right.
 				}
 			}
 
-			mHeightMaps[tileIndex]->mVertexBufferNonTS = rhi->CreateGPUBuffer("ER_RHI_GPUBuffer: Terrain Tile (non-TS) - Vertex Buffer, tile index: " + std::to_string(tileIndex));
-			mHeightMaps[tileIndex]->mVertexBufferNonTS->CreateGPUBufferResource(rhi, vertices, mHeightMaps[tileIndex]->mVertexCountNonTS, sizeof(DebugTerrainVertexInput), false, ER_BIND_VERTEX_BUFFER);
-
-			XMFLOAT3 minVertex = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
-			XMFLOAT3 maxVertex = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
-
-			// copy vertices to tile data + calculate AABB
-			for (int i = 0; i < mHeightMaps[tileIndex]->mVertexCountNonTS; i++)
-			{
-				mHeightMaps[tileIndex]->mVertexList[i].x = vertices[i].Position.x;
-				mHeightMaps[tileIndex]->mVertexList[i].y = vertices[i].Position.y;
-				mHeightMaps[tileIndex]->mVertexList[i].z = vertices[i].Position.z;
-
-				//Get the smallest vertex 
-				minVertex.x = std::min(minVertex.x, vertices[i].Position.x);    // Find smallest x value in model
-				minVertex.y = std::min(minVertex.y, vertices[i].Position.y);    // Find smallest y value in model
-				minVertex.z = std::min(minVertex.z, vertices[i].Position.z);    // Find smallest z value in model
-
-				//Get the largest vertex 
-				maxVertex.x = std::max(maxVertex.x, vertices[i].Position.x);    // Find largest x value in model
-				maxVertex.y = std::max(maxVertex.y, vertices[i].Position.y);    // Find largest y value in model
-				maxVertex.z = std::max(maxVertex.z, vertices[i].Position.z);    // Find largest z value in model
-			}
-			mHeightMaps[tileIndex]->mAABB = { minVertex, maxVertex };
+			tile->mVertexBufferNonTS = rhi->CreateGPUBuffer("ER_RHI_GPUBuffer: Terrain Tile (non-TS) - Vertex Buffer, tile index: " + std::to_string(tileIndex));
+			tile->mVertexBufferNonTS->CreateGPUBufferResource(rhi, vertices, tile->mVertexCountNonTS, sizeof(DebugTerrainVertexInput), false, ER_BIND_VERTEX_BUFFER);
 
 			DeleteObjects(vertices);
 
-			mHeightMaps[tileIndex]->mIndexBufferNonTS = rhi->CreateGPUBuffer("ER_RHI_GPUBuffer: Terrain Tile (non-TS) - Index Buffer, tile index: " + std::to_string(tileIndex));
-			mHeightMaps[tileIndex]->mIndexBufferNonTS->CreateGPUBufferResource(rhi, indices, mHeightMaps[tileIndex]->mIndexCountNonTS, sizeof(unsigned long), false, ER_BIND_INDEX_BUFFER);
+			tile->mIndexBufferNonTS = rhi->CreateGPUBuffer("ER_RHI_GPUBuffer: Terrain Tile (non-TS) - Index Buffer, tile index: " + std::to_string(tileIndex));
+			tile->mIndexBufferNonTS->CreateGPUBufferResource(rhi, indices, tile->mIndexCountNonTS, sizeof(unsigned long), false, ER_BIND_INDEX_BUFFER);
 
 			DeleteObjects(indices);
 
@@ -517,6 +530,458 @@ namespace EveryRay_Core
 		}
 	}
 
+	// Tile streaming: tiles are loaded (heightmaps on background threads, textures on the main thread) and evicted by the distance to the camera, 
+	// while the memory of resident + loading tiles stays within the budget from the scene ("terrain_streaming_budget_mb").
+	// Heightmaps/splatmaps arrays (for the placement pass) only have slices for the max resident tiles, which are assigned from a free list.
+	void ER_Terrain::InitializeStreaming(ER_Scene* aScene, const XMFLOAT3& startPosition)
+	{
+		ER_RHI* rhi = GetCore()->GetRHI();
+
+		const int numTilesSqrt = sqrt(mNumTiles);
+		const float tileSize = mTileResolution * mTileScale;
+		for (int tileIndex = 0; tileIndex < mNumTiles; tileIndex++)
+		{
+			const int tileX = tileIndex / numTilesSqrt;
+			const int tileY = tileIndex - numTilesSqrt * tileX;
+			mHeightMaps[tileIndex]->mTileRectXZ = XMFLOAT4(tileSize * (tileX - 1), -tileSize * tileY, tileSize * tileX, -tileSize * tileY + tileSize);
+			mHeightMaps[tileIndex]->mStreamingState = TILE_UNLOADED;
+		}
+
+		mStreamingDistance = (aScene->GetTerrainStreamingDistance() > 0.0f) ? aScene->GetTerrainStreamingDistance() : tileSize;
+		mStreamingBudgetBytes = static_cast<UINT64>(aScene->GetTerrainStreamingBudgetMB() * 1024.0 * 1024.0);
+		mMaxResidentTiles = static_cast<int>(std::min(mStreamingBudgetBytes / GetTileResidentSizeInBytes(), static_cast<UINT64>(mNumTiles)));
+		if (mMaxResidentTiles == 0)
+		{
+			ER_OUTPUT_LOG(L"[ER Logger][ER_Terrain] Terrain streaming budget is smaller than one tile, streaming with 1 resident tile...\n");
+			mMaxResidentTiles = 1;
+		}
+
+		// free slices have an empty AABB, so the placement pass never picks them
+		TerrainTileDataGPU emptyTileData;
+		emptyTileData.UVoffsetTileSize = XMFLOAT4(0.0, 0.0, tileSize, tileSize);
+		emptyTileData.AABBMinPoint = XMFLOAT4(FLT_MAX, FLT_MAX, FLT_MAX, 1.0);
+		emptyTileData.AABBMaxPoint = XMFLOAT4(-FLT_MAX, -FLT_MAX, -FLT_MAX, 1.0);
+		mTerrainTilesDataCPU.assign(mMaxResidentTiles, emptyTileData);
+		for (int slice = mMaxResidentTiles - 1; slice >= 0; slice--)
+			mFreeTileSlices.push_back(slice);
+
+		mTerrainTilesDataGPU = rhi->CreateGPUBuffer("ER_RHI_GPUBuffer: Terrain Tiles Data Buffer");
+		mTerrainTilesDataGPU->CreateGPUBufferResource(rhi, mTerrainTilesDataCPU.data(), mMaxResidentTiles, sizeof(TerrainTileDataGPU), true, ER_BIND_SHADER_RESOURCE, 0, ER_RESOURCE_MISC_BUFFER_STRUCTURED);
+
+		mTerrainTilesHeightmapsArrayTexture = rhi->CreateGPUTexture(L"ER_RHI_GPUTexture: Terrain Tiles Heightmaps Array");
+		mTerrainTilesHeightmapsArrayTexture->CreateGPUTextureResource(rhi, mTileResolution, mTileResolution, 1, ER_FORMAT_R16_UNORM, ER_BIND_SHADER_RESOURCE, 1, -1, mMaxResidentTiles);
+
+		mTerrainTilesSplatmapsArrayTexture = rhi->CreateGPUTexture(L"ER_RHI_GPUTexture: Terrain Tiles Splatmaps Array");
+		mTerrainTilesSplatmapsArrayTexture->CreateGPUTextureResource(rhi, mTileResolution, mTileResolution, 1, ER_FORMAT_R16G16B16A16_UNORM, ER_BIND_SHADER_RESOURCE, 1, -1, mMaxResidentTiles);
+
+		mIsStreamingThreadsRunning = true;
+		for (int i = 0; i < NUM_TERRAIN_STREAMING_THREADS; i++)
+			mStreamingThreads.emplace_back(&ER_Terrain::StreamingThreadLoop, this);
+
+		// startup: only load the tiles around the start position (heightmaps in parallel on streaming threads)
+		RequestTilesAround(startPosition);
+		{
+			std::unique_lock<std::mutex> lock(mStreamingMutex);
+			mStreamingLoadedCondition.wait(lock, [this]() { return static_cast<int>(mStreamingLoadedTiles.size()) == mLoadingTilesCount; });
+		}
+		ProcessLoadedTiles(mLoadingTilesCount, true);
+		rhi->UpdateBuffer(mTerrainTilesDataGPU, mTerrainTilesDataCPU.data(), sizeof(TerrainTileDataGPU) * mMaxResidentTiles);
+		mIsTilesDataDirty = false;
+
+		std::string message = "[ER Logger][ER_Terrain] Terrain streaming: " + std::to_string(mResidentTilesCount) + "/" + std::to_string(mNumTiles) +
+			" tiles loaded on startup, max resident tiles: " + std::to_string(mMaxResidentTiles) + " (" + std::to_string(GetTileResidentSizeInBytes() / 1024) + " KB per tile)\n";
+		ER_OUTPUT_LOG(ER_Utility::ToWideString(message).c_str());
+	}
+
+	void ER_Terrain::UpdateStreaming(const XMFLOAT3& cameraPosition)
+	{
+		mStreamingFrameIndex++;
+		ReleaseStreamedResources(false);
+
+		ProcessLoadedTiles(MAX_TERRAIN_STREAMING_UPLOADS_PER_FRAME, false);
+		RequestTilesAround(cameraPosition);
+
+		if (mIsTilesDataDirty)
+		{
+			GetCore()->GetRHI()->UpdateBuffer(mTerrainTilesDataGPU, mTerrainTilesDataCPU.data(), sizeof(TerrainTileDataGPU) * mMaxResidentTiles);
+			mIsTilesDataDirty = false;
+		}
+	}
+
+	void ER_Terrain::RequestTilesAround(const XMFLOAT3& position)
+	{
+		mStreamingTileDistances.resize(mNumTiles);
+		mStreamingSortedTiles.resize(mNumTiles);
+		for (int i = 0; i < mNumTiles; i++)
+		{
+			mStreamingTileDistances[i] = GetDistanceToTile(i, position);
+			mStreamingSortedTiles[i] = i;
+		}
+		std::sort(mStreamingSortedTiles.begin(), mStreamingSortedTiles.end(), [this](int a, int b) { return mStreamingTileDistances[a] < mStreamingTileDistances[b]; });
+
+		// evict far tiles
+		for (int i = 0; i < mNumTiles; i++)
+		{
+			if (mHeightMaps[i]->mStreamingState == TILE_RESIDENT && mStreamingTileDistances[i] > mStreamingDistance * TERRAIN_STREAMING_EVICTION_DISTANCE_FACTOR)
+				EvictTile(i);
+		}
+
+		// request the nearest tiles (if the budget is full, the farthest resident tile makes room for a nearer one)
+		for (int sortedIndex = 0; sortedIndex < mNumTiles; sortedIndex++)
+		{
+			const int tileIndex = mStreamingSortedTiles[sortedIndex];
+			if (mStreamingTileDistances[tileIndex] > mStreamingDistance)
+				break;
+			if (mHeightMaps[tileIndex]->mStreamingState != TILE_UNLOADED)
+				continue;
+
+			if (mFreeTileSlices.empty())
+			{
+				for (int farIndex = mNumTiles - 1; farIndex > sortedIndex; farIndex--)
+				{
+					if (mHeightMaps[mStreamingSortedTiles[farIndex]]->mStreamingState == TILE_RESIDENT)
+					{
+						EvictTile(mStreamingSortedTiles[farIndex]);
+						break;
+					}
+				}
+				if (mFreeTileSlices.empty())
+					break; // budget is full of nearer tiles
+			}
+
+			RequestTileLoad(tileIndex);
+		}
+	}
+
+	void ER_Terrain::RequestTileLoad(int tileIndex)
+	{
+		HeightMap* tile = mHeightMaps[tileIndex];
+		assert(tile->mStreamingState == TILE_UNLOADED);
+		assert(!mFreeTileSlices.empty());
+
+		// the slice is reserved on request, so resident + loading tiles never exceed the budget
+		tile->mArraySlice = mFreeTileSlices.back();
+		mFreeTileSlices.pop_back();
+		tile->AllocateCPUData();
+		tile->mStreamingState = TILE_LOADING;
+		mLoadingTilesCount++;
+
+		{
+			std::lock_guard<std::mutex> lock(mStreamingMutex);
+			mStreamingRequests.push_back(tileIndex);
+		}
+		mStreamingCondition.notify_one();
+	}
+
+	void ER_Terrain::StreamingThreadLoop()
+	{
+		const int numTilesSqrt = sqrt(mNumTiles);
+		while (true)
+		{
+			int tileIndex = -1;
+			{
+				std::unique_lock<std::mutex> lock(mStreamingMutex);
+				mStreamingCondition.wait(lock, [this]() { return !mIsStreamingThreadsRunning || !mStreamingRequests.empty(); });
+				if (!mIsStreamingThreadsRunning)
+					return;
+				tileIndex = mStreamingRequests.front();
+				mStreamingRequests.pop_front();
+			}
+
+			const int tileX = tileIndex / numTilesSqrt;
+			const int tileY = tileIndex - numTilesSqrt * tileX;
+			try
+			{
+				LoadTerrainTileHeightsCPU(tileX, tileY, mTerrainTexturesPath + L"terrainHeight_x" + std::to_wstring(tileX) + L"_y" + std::to_wstring(tileY) + L".r16");
+				mHeightMaps[tileIndex]->mStreamingState = TILE_LOADED_CPU;
+			}
+			catch (const std::exception&)
+			{
+				mHeightMaps[tileIndex]->mStreamingState = TILE_FAILED; // rethrown on the main thread in MakeTileResident()
+			}
+
+			{
+				std::lock_guard<std::mutex> lock(mStreamingMutex);
+				mStreamingLoadedTiles.push_back(tileIndex);
+			}
+			mStreamingLoadedCondition.notify_all();
+		}
+	}
+
+	void ER_Terrain::ProcessLoadedTiles(int maxCount, bool isLoading)
+	{
+		for (int processed = 0; processed < maxCount; processed++)
+		{
+			int tileIndex = -1;
+			{
+				std::lock_guard<std::mutex> lock(mStreamingMutex);
+				if (mStreamingLoadedTiles.empty())
+					return;
+				tileIndex = mStreamingLoadedTiles.front();
+				mStreamingLoadedTiles.pop_front();
+			}
+			MakeTileResident(tileIndex, isLoading);
+		}
+	}
+
+	// Main thread part of tile loading: GPU textures, patches, array slices
+	void ER_Terrain::MakeTileResident(int tileIndex, bool isLoading)
+	{
+		ER_RHI* rhi = GetCore()->GetRHI();
+		HeightMap* tile = mHeightMaps[tileIndex];
+
+		if (tile->mStreamingState == TILE_FAILED)
+		{
+			std::string message = "Can not load the terrain's heightmap RAW of the streamed tile #" + std::to_string(tileIndex) + "!";
+			throw ER_CoreException(message.c_str());
+		}
+		assert(tile->mStreamingState == TILE_LOADED_CPU);
+
+		const int numTilesSqrt = sqrt(mNumTiles);
+		const int tileX = tileIndex / numTilesSqrt;
+		const int tileY = tileIndex - numTilesSqrt * tileX;
+		const std::wstring tileName = L"_x" + std::to_wstring(tileX) + L"_y" + std::to_wstring(tileY) + L".png";
+
+		// mips with texture replacement are only processed at the end of the scene loading (DX12), so tiles streamed later stay without mips
+		LoadSplatmapPerTileGPU(tileX, tileY, mTerrainTexturesPath + L"terrainSplat" + tileName, isLoading);
+		LoadHeightmapPerTileGPU(tileX, tileY, mTerrainTexturesPath + L"terrainHeight" + tileName);
+		CreateTerrainTileDataGPU(tileX, tileY);
+
+		//MipSlice + ArraySlice * MipLevels; => 0 + slice * 1 = slice
+		rhi->CopyGPUTextureSubresourceRegion(mTerrainTilesHeightmapsArrayTexture, tile->mArraySlice, 0, 0, 0, tile->mHeightTexture, 0);
+		rhi->CopyGPUTextureSubresourceRegion(mTerrainTilesSplatmapsArrayTexture, tile->mArraySlice, 0, 0, 0, tile->mSplatTexture, 0);
+
+		const float tileSize = mTileResolution * mTileScale;
+		TerrainTileDataGPU& tileData = mTerrainTilesDataCPU[tile->mArraySlice];
+		tileData.UVoffsetTileSize = XMFLOAT4(tile->mTileUVOffset.x, tile->mTileUVOffset.y, tileSize, tileSize);
+		tileData.AABBMinPoint = XMFLOAT4(tile->mAABB.first.x, tile->mAABB.first.y, tile->mAABB.first.z, 1.0);
+		tileData.AABBMaxPoint = XMFLOAT4(tile->mAABB.second.x, tile->mAABB.second.y, tile->mAABB.second.z, 1.0);
+		mIsTilesDataDirty = true;
+
+		if (!tile->mDebugGizmoAABB)
+		{
+			tile->mDebugGizmoAABB = new ER_RenderableAABB(*GetCore(), XMFLOAT4(0.0, 0.0, 1.0, 1.0));
+			tile->mDebugGizmoAABB->InitializeGeometry({ tile->mAABB.first, tile->mAABB.second });
+		}
+
+		tile->mStreamingState = TILE_RESIDENT;
+		mResidentTilesCount++;
+		mLoadingTilesCount--;
+	}
+
+	void ER_Terrain::EvictTile(int tileIndex)
+	{
+		HeightMap* tile = mHeightMaps[tileIndex];
+		assert(tile->mStreamingState == TILE_RESIDENT);
+
+		// the GPU might still use them in the frames in flight
+		mStreamingPendingReleases.push_back(std::make_pair(static_cast<ER_RHI_GPUResource*>(tile->mSplatTexture), mStreamingFrameIndex));
+		mStreamingPendingReleases.push_back(std::make_pair(static_cast<ER_RHI_GPUResource*>(tile->mHeightTexture), mStreamingFrameIndex));
+		mStreamingPendingReleases.push_back(std::make_pair(static_cast<ER_RHI_GPUResource*>(tile->mVertexBufferTS), mStreamingFrameIndex));
+		tile->mSplatTexture = nullptr;
+		tile->mHeightTexture = nullptr;
+		tile->mVertexBufferTS = nullptr;
+		tile->ReleaseCPUData();
+
+		mTerrainTilesDataCPU[tile->mArraySlice].AABBMinPoint = XMFLOAT4(FLT_MAX, FLT_MAX, FLT_MAX, 1.0);
+		mTerrainTilesDataCPU[tile->mArraySlice].AABBMaxPoint = XMFLOAT4(-FLT_MAX, -FLT_MAX, -FLT_MAX, 1.0);
+		mIsTilesDataDirty = true;
+		mFreeTileSlices.push_back(tile->mArraySlice);
+		tile->mArraySlice = -1;
+
+		tile->mStreamingState = TILE_UNLOADED;
+		mResidentTilesCount--;
+	}
+
+	void ER_Terrain::ReleaseStreamedResources(bool all)
+	{
+		for (size_t i = 0; i < mStreamingPendingReleases.size();)
+		{
+			if (all || mStreamingFrameIndex - mStreamingPendingReleases[i].second >= TERRAIN_STREAMING_RELEASE_DELAY_FRAMES)
+			{
+				DeleteObject(mStreamingPendingReleases[i].first);
+				mStreamingPendingReleases[i] = mStreamingPendingReleases.back();
+				mStreamingPendingReleases.pop_back();
+			}
+			else
+				i++;
+		}
+	}
+
+	// XZ distance from the position to the tile's rectangle (0 - inside)
+	float ER_Terrain::GetDistanceToTile(int tileIndex, const XMFLOAT3& position)
+	{
+		const XMFLOAT4& rect = mHeightMaps[tileIndex]->mTileRectXZ;
+		float dx = std::max(std::max(rect.x - position.x, position.x - rect.z), 0.0f);
+		float dz = std::max(std::max(rect.y - position.z, position.z - rect.w), 0.0f);
+		return sqrt(dx * dx + dz * dz);
+	}
+
+	// Estimated memory of one resident tile (CPU heights/min-max quadtree + GPU textures and array slices)
+	UINT64 ER_Terrain::GetTileResidentSizeInBytes()
+	{
+		const UINT64 texelsCount = static_cast<UINT64>(mTileResolution) * mTileResolution;
+		const UINT64 cpuSize = texelsCount * 3 * sizeof(float) + static_cast<UINT64>(mTileResolution - 1) * (mTileResolution - 1) * 4 / 3 * sizeof(XMFLOAT2);
+		const UINT64 gpuSize = texelsCount * 2 /*height, R16*/ + texelsCount * 4 * 4 / 3 /*splat, RGBA8 + mips*/ + texelsCount * (2 + 8) /*array slices*/;
+		return cpuSize + gpuSize;
+	}
+
+	// O(1): the tile is found from the tiles grid (tiles are slightly shifted to fix the seams, so the neighbours are checked too)
+	HeightMap* ER_Terrain::FindTileAtPosition(float x, float z)
+	{
+		if (mNumTiles == 0)
+			return nullptr;
+
+		const int numTilesSqrt = sqrt(mNumTiles);
+		const float tileSize = static_cast<float>(mTileResolution * mTileScale);
+		const int tileX = static_cast<int>(floor(x / tileSize)) + 1;
+		const int tileY = static_cast<int>(floor(-z / tileSize)) + 1;
+		for (int offset = 0; offset < 9; offset++)
+		{
+			const int neighbourX = tileX + ((offset + 4) % 9) % 3 - 1; // the first offset is the center
+			const int neighbourY = tileY + ((offset + 4) % 9) / 3 - 1;
+			if (neighbourX < 0 || neighbourY < 0 || neighbourX >= numTilesSqrt || neighbourY >= numTilesSqrt)
+				continue;
+
+			HeightMap* tile = mHeightMaps[neighbourX * numTilesSqrt + neighbourY];
+			if (tile->IsResident() && tile->ContainsXZ(x, z))
+				return tile;
+		}
+		return nullptr;
+	}
+
+	float ER_Terrain::GetHeightAtPosition(float x, float z)
+	{
+		HeightMap* tile = FindTileAtPosition(x, z);
+		return tile ? tile->FindHeightFromPosition(x, z) : -1.0f;
+	}
+
+	void ER_Terrain::GetHeightsAtPositions(const XMFLOAT4* positions, float* outHeights, int positionsCount)
+	{
+		assert(positions && outHeights);
+
+		ER_JobSystem* jobSystem = (ER_JobSystem*)GetCore()->GetServices().FindService(ER_JobSystem::TypeIdClass());
+		if (!jobSystem || positionsCount <= TERRAIN_HEIGHT_QUERIES_BATCH_SIZE)
+		{
+			for (int i = 0; i < positionsCount; i++)
+				outHeights[i] = GetHeightAtPosition(positions[i].x, positions[i].z);
+			return;
+		}
+
+		jobSystem->ParallelFor(positionsCount, TERRAIN_HEIGHT_QUERIES_BATCH_SIZE, [this, positions, outHeights](UINT begin, UINT end)
+		{
+			for (UINT i = begin; i < end; i++)
+				outHeights[i] = GetHeightAtPosition(positions[i].x, positions[i].z);
+		});
+	}
+
+	bool ER_Terrain::RayCast(const XMFLOAT3& origin, const XMFLOAT3& direction, XMFLOAT3& hitPoint, float maxDistance)
+	{
+		float closest = maxDistance;
+		bool isHit = false;
+		for (int i = 0; i < mNumTiles; i++)
+		{
+			float distance = 0.0f;
+			if (mHeightMaps[i]->IsResident() && mHeightMaps[i]->RayCast(origin, direction, distance, closest))
+			{
+				closest = distance;
+				isHit = true;
+			}
+		}
+
+		if (isHit)
+			hitPoint = XMFLOAT3(origin.x + direction.x * closest, origin.y + direction.y * closest, origin.z + direction.z * closest);
+		return isHit;
+	}
+
+	// Compares the old per-triangle scan of a tile with the grid lookups (single and batched) and checks that they agree
+	void ER_Terrain::RunHeightQueriesBenchmark()
+	{
+		if (!mLoaded)
+			return;
+
+		std::vector<HeightMap*> residentTiles;
+		for (auto tile : mHeightMaps)
+		{
+			if (tile->IsResident())
+				residentTiles.push_back(tile);
+		}
+		if (residentTiles.empty())
+			return;
+
+		const int queriesCount = 100000;
+		const int scanQueriesCount = 64; // triangles scan is O(tile size), so only a few queries
+		std::vector<XMFLOAT4> positions(queriesCount);
+		std::vector<float> heights(queriesCount);
+		for (int i = 0; i < queriesCount; i++)
+		{
+			HeightMap* tile = residentTiles[i % residentTiles.size()];
+			positions[i] = XMFLOAT4(ER_Utility::RandomFloat(tile->mAABB.first.x, tile->mAABB.second.x), 0.0f, ER_Utility::RandomFloat(tile->mAABB.first.z, tile->mAABB.second.z), 1.0f);
+		}
+
+		float maxError = 0.0f;
+		auto startScan = std::chrono::high_resolution_clock::now();
+		for (int i = 0; i < scanQueriesCount; i++)
+		{
+			HeightMap* tile = FindTileAtPosition(positions[i].x, positions[i].z);
+			if (!tile)
+				continue;
+
+			float height = -1.0f;
+			float normal[3];
+			for (int j = 0; j < (int)mHeight - 1 && height < 0.0f; j++)
+			{
+				for (int k = 0; k < (int)mWidth - 1; k++)
+				{
+					float upperLeft[3] = { tile->mData[mWidth * (j + 1) + k].x, tile->mData[mWidth * (j + 1) + k].y, tile->mData[mWidth * (j + 1) + k].z };
+					float upperRight[3] = { tile->mData[mWidth * (j + 1) + k + 1].x, tile->mData[mWidth * (j + 1) + k + 1].y, tile->mData[mWidth * (j + 1) + k + 1].z };
+					float bottomLeft[3] = { tile->mData[mWidth * j + k].x, tile->mData[mWidth * j + k].y, tile->mData[mWidth * j + k].z };
+					float bottomRight[3] = { tile->mData[mWidth * j + k + 1].x, tile->mData[mWidth * j + k + 1].y, tile->mData[mWidth * j + k + 1].z };
+					if (tile->GetHeightFromTriangle(positions[i].x, positions[i].z, upperLeft, upperRight, bottomLeft, normal, height) ||
+						tile->GetHeightFromTriangle(positions[i].x, positions[i].z, bottomLeft, upperRight, bottomRight, normal, height))
+						break;
+				}
+			}
+			if (height >= 0.0f)
+				maxError = std::max(maxError, fabs(height - tile->FindHeightFromPosition(positions[i].x, positions[i].z)));
+		}
+		auto endScan = std::chrono::high_resolution_clock::now();
+
+		auto startGrid = std::chrono::high_resolution_clock::now();
+		for (int i = 0; i < queriesCount; i++)
+			heights[i] = GetHeightAtPosition(positions[i].x, positions[i].z);
+		auto endGrid = std::chrono::high_resolution_clock::now();
+
+		auto startBatch = std::chrono::high_resolution_clock::now();
+		GetHeightsAtPositions(positions.data(), heights.data(), queriesCount);
+		auto endBatch = std::chrono::high_resolution_clock::now();
+
+		int raysHits = 0;
+		const int raysCount = 1000;
+		auto startRays = std::chrono::high_resolution_clock::now();
+		for (int i = 0; i < raysCount; i++)
+		{
+			XMFLOAT3 hitPoint;
+			XMFLOAT3 origin = XMFLOAT3(positions[i].x, heights[i] + 100.0f, positions[i].z);
+			XMVECTOR direction = XMVector3Normalize(XMVectorSet(ER_Utility::RandomFloat(-1.0f, 1.0f), -1.0f, ER_Utility::RandomFloat(-1.0f, 1.0f), 0.0f));
+			XMFLOAT3 directionF;
+			XMStoreFloat3(&directionF, direction);
+			if (RayCast(origin, directionF, hitPoint))
+				raysHits++;
+		}
+		auto endRays = std::chrono::high_resolution_clock::now();
+
+		std::chrono::duration<double, std::micro> scanTime = (endScan - startScan) / scanQueriesCount;
+		std::chrono::duration<double, std::micro> gridTime = (endGrid - startGrid) / queriesCount;
+		std::chrono::duration<double, std::micro> batchTime = (endBatch - startBatch) / queriesCount;
+		std::chrono::duration<double, std::micro> raysTime = (endRays - startRays) / raysCount;
+
+		std::string message = "[ER Logger][ER_Terrain] Height queries benchmark (per query): triangles scan " + std::to_string(scanTime.count()) + "us, grid " +
+			std::to_string(gridTime.count()) + "us, batched " + std::to_string(batchTime.count()) + "us (" + std::to_string(queriesCount) + " queries), max error " +
+			std::to_string(maxError) + "; ray casts " + std::to_string(raysTime.count()) + "us (" + std::to_string(raysHits) + "/" + std::to_string(raysCount) + " hits)\n";
+		ER_OUTPUT_LOG(ER_Utility::ToWideString(message).c_str());
+	}
+
 	void ER_Terrain::Draw(TerrainRenderPass aPass, const std::vector<ER_RHI_GPUTexture*>& aRenderTargets, ER_RHI_GPUTexture* aDepthTarget, ER_ShadowMapper* worldShadowMapper, ER_LightProbesManager* probeManager, int shadowMapCascade)
 	{
 		if (!mEnabled || !mLoaded)
@@ -570,16 +1035,28 @@ namespace EveryRay_Core
 			return;
 
 		for (int i = 0; i < mHeightMaps.size(); i++)
-			mHeightMaps[i]->mDebugGizmoAABB->Draw(aRenderTarget, aDepth, rs);
+		{
+			if (mHeightMaps[i]->IsResident())
+				mHeightMaps[i]->mDebugGizmoAABB->Draw(aRenderTarget, aDepth, rs);
+		}
 	}
 
 	void ER_Terrain::Update(const ER_CoreTime& gameTime)
 	{
 		ER_Camera* camera = (ER_Camera*)(mCore->GetServices().FindService(ER_Camera::TypeIdClass()));
 
+		if (mIsStreaming && mLoaded)
+			UpdateStreaming(camera->Position());
+
 		int visibleTiles = 0;
 		for (int i = 0; i < mHeightMaps.size(); i++)
 		{
+			if (!mHeightMaps[i]->IsResident())
+			{
+				mHeightMaps[i]->mIsCulled = true;
+				continue;
+			}
+
 			if (!mHeightMaps[i]->PerformCPUFrustumCulling(mDoCPUFrustumCulling ? camera : nullptr))
 				visibleTiles++;
 		}
@@ -589,6 +1066,15 @@ namespace EveryRay_Core
 			
 			std::string cullText = "Visible tiles: " + std::to_string(visibleTiles) + "/" + std::to_string(mHeightMaps.size());
 			ImGui::Text(cullText.c_str());
+			if (mIsStreaming)
+			{
+				std::string streamingText = "Streaming: resident tiles " + std::to_string(mResidentTilesCount) + "/" + std::to_string(mMaxResidentTiles) +
+					" (max), loading " + std::to_string(mLoadingTilesCount) + ", budget " +
+					std::to_string(static_cast<int>((mResidentTilesCount + mLoadingTilesCount) * GetTileResidentSizeInBytes() / (1024 * 1024))) + "/" +
+					std::to_string(static_cast<int>(mStreamingBudgetBytes / (1024 * 1024))) + " MB";
+				ImGui::Text(streamingText.c_str());
+				ImGui::SliderFloat("Streaming distance", &mStreamingDistance, 0.0f, 4.0f * mTileResolution * mTileScale);
+			}
 			ImGui::Checkbox("Enabled", &mEnabled);
 			ImGui::Checkbox("CPU frustum culling", &mDoCPUFrustumCulling);
 			ImGui::Checkbox("Debug tiles AABBs", &mDrawDebugAABBs);
@@ -599,6 +1085,8 @@ namespace EveryRay_Core
 			ImGui::SliderFloat("Dynamic LOD distance factor", &mTessellationDistanceFactor, 0.0001f, 0.1f);
 			ImGui::SliderFloat("Tessellated terrain height scale", &mTerrainTessellatedHeightScale, 0.0f, 1000.0f);
 			ImGui::SliderFloat("Placement height delta", &mPlacementHeightDelta, 0.0f, 10.0f);
+			if (ImGui::Button("Run CPU height queries benchmark"))
+				RunHeightQueriesBenchmark();
 			ImGui::End();
 		}
 	}
@@ -607,6 +1095,9 @@ namespace EveryRay_Core
 	{
 		if (aPass == TerrainRenderPass::TERRAIN_SHADOW)
 			assert(shadowMapCascade != -1);
+
+		if (!mHeightMaps[tileIndex]->IsResident())
+			return;
 		
 		//for shadow mapping pass we dont want to cull with main camera frustum
 		if (mHeightMaps[tileIndex]->IsCulled() && (aPass == TerrainRenderPass::TERRAIN_FORWARD || aPass == TerrainRenderPass::TERRAIN_GBUFFER))
@@ -681,7 +1172,7 @@ namespace EveryRay_Core
 				rhi->SetConstantBuffers(ER_PIXEL,				{ mTerrainConstantBuffer.Buffer() }, 0, rootSig, TERRAIN_PASS_ROOT_DESCRIPTOR_TABLE_CBV_INDEX);
 			}
 
-			std::vector<ER_RHI_GPUResource*> resources(19);
+			ER_RHI_GPUResource* resources[19] = {};
 			resources[0] = mHeightMaps[tileIndex]->mSplatTexture;
 			resources[1] = mSplatChannelTextures[0];
 			resources[2] = mSplatChannelTextures[1];
@@ -732,44 +1223,218 @@ namespace EveryRay_Core
 	}
 
 
+	// Heights are on a regular grid, so the cell (and its triangle) is found directly from the position
 	float HeightMap::FindHeightFromPosition(float x, float z)
 	{
-		int index = 0;
-		float vertex1[3] = { 0.0, 0.0, 0.0 };
-		float vertex2[3] = { 0.0, 0.0, 0.0 }; 
-		float vertex3[3] = { 0.0, 0.0, 0.0 }; 
-		float normals[3] = { 0.0, 0.0, 0.0 }; 
-		float height = 0.0f;
-		bool isFound = false;
-
-		int index1 = 0;
-		int index2 = 0;
-		int index3 = 0;
-
-		for (int i = 0; i < mVertexCountNonTS / 3; i++)
+		if (!mData || !ContainsXZ(x, z))
+			return -1.0f;
+
+		const float gridX = (x - mGridOrigin.x) / mGridSpacing;
+		const float gridZ = (z - mGridOrigin.y) / mGridSpacing;
+		const int cellX = std::min(static_cast<int>(gridX), mWidth - 2);
+		const int cellZ = std::min(static_cast<int>(gridZ), mHeight - 2);
+		const float fx = gridX - cellX;
+		const float fz = gridZ - cellZ;
+
+		const float bottomLeft = mData[mWidth * cellZ + cellX].y;
+		const float bottomRight = mData[mWidth * cellZ + cellX + 1].y;
+		const float upperLeft = mData[mWidth * (cellZ + 1) + cellX].y;
+		const float upperRight = mData[mWidth * (cellZ + 1) + cellX + 1].y;
+
+		// same triangulation as the mesh: (upper left, upper right, bottom left) and (bottom left, upper right, bottom right)
+		if (fz >= fx)
+			return bottomLeft + fz * (upperLeft - bottomLeft) + fx * (upperRight - upperLeft);
+		else
+			return bottomLeft + fx * (bottomRight - bottomLeft) + fz * (upperRight - bottomRight);
+	}
+
+	bool HeightMap::ContainsXZ(float x, float z)
+	{
+		return x >= mGridOrigin.x && x <= mGridOrigin.x + (mWidth - 1) * mGridSpacing &&
+			z >= mGridOrigin.y && z <= mGridOrigin.y + (mHeight - 1) * mGridSpacing;
+	}
+
+	void HeightMap::BuildMinMaxQuadtree(float gridSpacing)
+	{
+		assert(mData);
+		mGridOrigin = XMFLOAT2(mData[0].x, mData[0].z);
+		mGridSpacing = gridSpacing;
+
+		mMinMaxHeights.clear();
+		mMinMaxLevelSizes.clear();
+
+		// level 0: per grid cell
+		int size = mWidth - 1;
+		assert(mWidth == mHeight);
+		mMinMaxLevelSizes.push_back(size);
+		mMinMaxHeights.push_back(std::vector<XMFLOAT2>(size * size));
+		for (int j = 0; j < size; j++)
 		{
-			index = i * 3;
-
-			vertex1[0] = mVertexList[index].x;
-			vertex1[1] = mVertexList[index].y;
-			vertex1[2] = mVertexList[index].z;
-			index++;
-
-			vertex2[0] = mVertexList[index].x;
-			vertex2[1] = mVertexList[index].y;
-			vertex2[2] = mVertexList[index].z;
-			index++;
-
-			vertex3[0] = mVertexList[index].x;
-			vertex3[1] = mVertexList[index].y;
-			vertex3[2] = mVertexList[index].z;
-
-			// Check to see if this is the polygon we are looking for.
-			isFound = GetHeightFromTriangle(x, z, vertex1, vertex2, vertex3, normals, height);
-			if (isFound)
-				return height;
+			for (int i = 0; i < size; i++)
+			{
+				const float h0 = mData[mWidth * j + i].y;
+				const float h1 = mData[mWidth * j + i + 1].y;
+				const float h2 = mData[mWidth * (j + 1) + i].y;
+				const float h3 = mData[mWidth * (j + 1) + i + 1].y;
+				mMinMaxHeights[0][size * j + i] = XMFLOAT2(std::min(std::min(h0, h1), std::min(h2, h3)), std::max(std::max(h0, h1), std::max(h2, h3)));
+			}
+		}
+
+		// upper levels: 2x2 nodes of the previous level (odd sizes are rounded up)
+		while (size > 1)
+		{
+			const int prevSize = size;
+			const std::vector<XMFLOAT2>& prevLevel = mMinMaxHeights.back();
+			size = (size + 1) / 2;
+
+			std::vector<XMFLOAT2> level(size * size, XMFLOAT2(FLT_MAX, -FLT_MAX));
+			for (int j = 0; j < prevSize; j++)
+			{
+				for (int i = 0; i < prevSize; i++)
+				{
+					XMFLOAT2& node = level[size * (j / 2) + i / 2];
+					node.x = std::min(node.x, prevLevel[prevSize * j + i].x);
+					node.y = std::max(node.y, prevLevel[prevSize * j + i].y);
+				}
+			}
+			mMinMaxLevelSizes.push_back(size);
+			mMinMaxHeights.push_back(std::move(level));
 		}
-		return -1.0f;
+	}
+
+	// Ray vs. node's box (XZ from the grid, Y from the min/max heights); tNear is the entry distance
+	bool HeightMap::RayIntersectsNode(int level, int nodeX, int nodeZ, const XMFLOAT3& origin, const XMFLOAT3& invDirection, float& tNear)
+	{
+		const int cellsCount = mMinMaxLevelSizes[0];
+		const XMFLOAT2& minMax = mMinMaxHeights[level][mMinMaxLevelSizes[level] * nodeZ + nodeX];
+
+		const float boxMin[3] = { mGridOrigin.x + (nodeX << level) * mGridSpacing, minMax.x, mGridOrigin.y + (nodeZ << level) * mGridSpacing };
+		const float boxMax[3] = { mGridOrigin.x + std::min((nodeX + 1) << level, cellsCount) * mGridSpacing, minMax.y, mGridOrigin.y + std::min((nodeZ + 1) << level, cellsCount) * mGridSpacing };
+		const float rayOrigin[3] = { origin.x, origin.y, origin.z };
+		const float rayInvDirection[3] = { invDirection.x, invDirection.y, invDirection.z };
+
+		float tMin = 0.0f;
+		float tMax = FLT_MAX;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			float t0 = (boxMin[axis] - rayOrigin[axis]) * rayInvDirection[axis];
+			float t1 = (boxMax[axis] - rayOrigin[axis]) * rayInvDirection[axis];
+			if (t0 > t1)
+				std::swap(t0, t1);
+			tMin = std::max(tMin, t0);
+			tMax = std::min(tMax, t1);
+			if (tMin > tMax)
+				return false;
+		}
+		tNear = tMin;
+		return true;
+	}
+
+	// Ray vs. two triangles of the grid cell (Moller-Trumbore)
+	bool HeightMap::RayIntersectsCell(int cellX, int cellZ, const XMFLOAT3& origin, const XMFLOAT3& direction, float& distance)
+	{
+		const float EPSILON = 0.00001f;
+
+		const XMVECTOR bottomLeft = XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(&mData[mWidth * cellZ + cellX]));
+		const XMVECTOR bottomRight = XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(&mData[mWidth * cellZ + cellX + 1]));
+		const XMVECTOR upperLeft = XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(&mData[mWidth * (cellZ + 1) + cellX]));
+		const XMVECTOR upperRight = XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(&mData[mWidth * (cellZ + 1) + cellX + 1]));
+		const XMVECTOR triangles[2][3] = { { upperLeft, upperRight, bottomLeft }, { bottomLeft, upperRight, bottomRight } };
+
+		const XMVECTOR originVector = XMLoadFloat3(&origin);
+		const XMVECTOR directionVector = XMLoadFloat3(&direction);
+
+		bool isHit = false;
+		for (int i = 0; i < 2; i++)
+		{
+			XMVECTOR edge1 = XMVectorSubtract(triangles[i][1], triangles[i][0]);
+			XMVECTOR edge2 = XMVectorSubtract(triangles[i][2], triangles[i][0]);
+			XMVECTOR h = XMVector3Cross(directionVector, edge2);
+			float a = XMVectorGetX(XMVector3Dot(edge1, h));
+			if (a > -EPSILON && a < EPSILON)
+				continue; // This ray is parallel to this triangle.
+
+			float f = 1.0f / a;
+			XMVECTOR s = XMVectorSubtract(originVector, triangles[i][0]);
+			float u = f * XMVectorGetX(XMVector3Dot(s, h));
+			if (u < 0.0f || u > 1.0f)
+				continue;
+
+			XMVECTOR q = XMVector3Cross(s, edge1);
+			float v = f * XMVectorGetX(XMVector3Dot(directionVector, q));
+			if (v < 0.0f || u + v > 1.0f)
+				continue;
+
+			float t = f * XMVectorGetX(XMVector3Dot(edge2, q));
+			if (t > EPSILON && t < distance)
+			{
+				distance = t;
+				isHit = true;
+			}
+		}
+		return isHit;
+	}
+
+	// Front-to-back traversal of the min/max quadtree: only nodes whose height range is crossed by the ray are visited
+	bool HeightMap::RayCast(const XMFLOAT3& origin, const XMFLOAT3& direction, float& distance, float maxDistance)
+	{
+		if (!mData || mMinMaxHeights.empty())
+			return false;
+
+		const XMFLOAT3 invDirection = XMFLOAT3(
+			direction.x != 0.0f ? 1.0f / direction.x : FLT_MAX,
+			direction.y != 0.0f ? 1.0f / direction.y : FLT_MAX,
+			direction.z != 0.0f ? 1.0f / direction.z : FLT_MAX);
+
+		struct Node { int level, x, z; float tNear; };
+		Node stack[4 * 32];
+		int stackSize = 0;
+
+		float closest = maxDistance;
+		float tNear = 0.0f;
+		const int rootLevel = static_cast<int>(mMinMaxHeights.size()) - 1;
+		if (RayIntersectsNode(rootLevel, 0, 0, origin, invDirection, tNear) && tNear < closest)
+			stack[stackSize++] = { rootLevel, 0, 0, tNear };
+
+		bool isHit = false;
+		while (stackSize > 0)
+		{
+			const Node node = stack[--stackSize];
+			if (node.tNear >= closest)
+				continue;
+
+			if (node.level == 0)
+			{
+				if (RayIntersectsCell(node.x, node.z, origin, direction, closest))
+					isHit = true;
+				continue;
+			}
+
+			// push the children far to near, so the nearest one is processed first
+			Node children[4];
+			int childrenCount = 0;
+			const int childLevel = node.level - 1;
+			const int childLevelSize = mMinMaxLevelSizes[childLevel];
+			for (int j = 0; j < 2; j++)
+			{
+				for (int i = 0; i < 2; i++)
+				{
+					const int childX = node.x * 2 + i;
+					const int childZ = node.z * 2 + j;
+					if (childX >= childLevelSize || childZ >= childLevelSize)
+						continue;
+					if (RayIntersectsNode(childLevel, childX, childZ, origin, invDirection, tNear) && tNear < closest)
+						children[childrenCount++] = { childLevel, childX, childZ, tNear };
+				}
+			}
+			std::sort(children, children + childrenCount, [](const Node& a, const Node& b) { return a.tNear > b.tNear; });
+			for (int i = 0; i < childrenCount; i++)
+				stack[stackSize++] = children[i];
+		}
+
+		if (isHit)
+			distance = closest;
+		return isHit;
 	}
 
 	bool HeightMap::PerformCPUFrustumCulling(ER_Camera* camera)
@@ -1044,7 +1709,7 @@ namespace EveryRay_Core
 		rhi->SetPSO(mTerrainPlacementPassPSOName, true);
 		mPlaceOnTerrainConstantBuffer.Data.HeightScale = mTerrainTessellatedHeightScale;
 		mPlaceOnTerrainConstantBuffer.Data.SplatChannel = splatChannel == TerrainSplatChannels::NONE ? -1.0f : static_cast<float>(splatChannel);
-		mPlaceOnTerrainConstantBuffer.Data.TerrainTileCount = static_cast<int>(mNumTiles);
+		mPlaceOnTerrainConstantBuffer.Data.TerrainTileCount = static_cast<int>(mIsStreaming ? mMaxResidentTiles : mNumTiles); // when streaming, tiles data is stored per array slice
 		mPlaceOnTerrainConstantBuffer.Data.PlacementHeightDelta = mPlacementHeightDelta;
 		mPlaceOnTerrainConstantBuffer.ApplyChanges(rhi);
 		rhi->SetConstantBuffers(ER_COMPUTE, { mPlaceOnTerrainConstantBuffer.Buffer() }, 0,
@@ -1086,10 +1751,25 @@ namespace EveryRay_Core
 		rhi->EndBufferRead(outputBuffer);
 	}
 
-	HeightMap::HeightMap(int width, int height)
+	HeightMap::HeightMap(int width, int height, bool allocateCPUData)
+		: mWidth(width), mHeight(height)
+	{
+		if (allocateCPUData)
+			AllocateCPUData();
+	}
+
+	void HeightMap::AllocateCPUData()
 	{
-		mData = new MapData[width * height];
-		mVertexList = new Vertex[(width - 1) * (height - 1) * 6];
+		if (!mData)
+			mData = new MapData[mWidth * mHeight];
+	}
+
+	void HeightMap::ReleaseCPUData()
+	{
+		DeleteObjects(mData);
+		mMinMaxHeights.clear();
+		mMinMaxLevelSizes.clear();
+		mVertexCountNonTS = 0;
 	}
 
 	HeightMap::~HeightMap()
@@ -1099,7 +1779,6 @@ namespace EveryRay_Core
 		DeleteObject(mIndexBufferNonTS);
 		DeleteObject(mSplatTexture);
 		DeleteObject(mHeightTexture);
-		DeleteObjects(mVertexList);
 		DeleteObjects(mData);
 		DeleteObject(mDebugGizmoAABB);
 	}
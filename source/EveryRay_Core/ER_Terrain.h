@@ -4,11 +4,23 @@
 #include "ER_GenericEvent.h"
 #include "RHI/ER_RHI.h"
 
+#include <atomic>
+#include <deque>
+#include <condition_variable>
+
 #define NUM_THREADS_PER_TERRAIN_SIDE 4
 #define NUM_TERRAIN_PATCHES_PER_TILE 8
 #define NUM_TEXTURE_SPLAT_CHANNELS 4
 #define MAX_TERRAIN_TILE_COUNT 64
 
+// Tile streaming ("terrain_streaming" in the scene)
+#define NUM_TERRAIN_STREAMING_THREADS 2 // background I/O threads for heightmaps
+#define MAX_TERRAIN_STREAMING_UPLOADS_PER_FRAME 2 // how many loaded tiles can become resident (GPU textures, array slices) per frame
+#define TERRAIN_STREAMING_EVICTION_DISTANCE_FACTOR 1.25f // tiles are evicted a bit further than they are loaded (to avoid reloading on the border)
+#define TERRAIN_STREAMING_RELEASE_DELAY_FRAMES 3 // GPU resources of evicted tiles are released later (the GPU might still use them)
+
+#define TERRAIN_HEIGHT_QUERIES_BATCH_SIZE 1024 // batched CPU height queries are split into jobs of this size
+
 namespace EveryRay_Core 
 {
 	static char* DisplayedSplatChannnelNames[5] = {
@@ -42,6 +54,15 @@ namespace EveryRay_Core
 		NONE = 4
 	};
 
+	enum TerrainTileStreamingState
+	{
+		TILE_UNLOADED = 0,
+		TILE_LOADING, // CPU data is being loaded on a streaming thread
+		TILE_LOADED_CPU, // waiting for the main thread to create GPU resources
+		TILE_RESIDENT,
+		TILE_FAILED
+	};
+
 	enum TerrainRenderPass
 	{
 		TERRAIN_GBUFFER,
@@ -93,22 +114,24 @@ namespace EveryRay_Core
 			float x, y, z;
 		};
 
-		struct Vertex {
-			float x, y, z;
-		};
-
 	public:
 		bool GetHeightFromTriangle(float x, float z, float v0[3], float v1[3], float v2[3], float normal[3], float& height);
 		bool RayIntersectsTriangle(float x, float z, float v0[3], float v1[3], float v2[3], float normals[3], float& height);
-		float FindHeightFromPosition(float x, float z);
+		float FindHeightFromPosition(float x, float z); // O(1) (grid indexing into mData); -1.0 if outside of the tile
+		bool RayCast(const XMFLOAT3& origin, const XMFLOAT3& direction, float& distance, float maxDistance = FLT_MAX); // O(log n) (min/max heights quadtree)
+		bool ContainsXZ(float x, float z);
 		bool PerformCPUFrustumCulling(ER_Camera* camera);
 		bool IsCulled() { return mIsCulled; }
 		bool IsColliding(const XMFLOAT4& position, bool onlyXZCheck = false);
+		bool IsResident() { return mStreamingState == TILE_RESIDENT; }
 
-		HeightMap(int width, int height);
+		HeightMap(int width, int height, bool allocateCPUData = true);
 		~HeightMap();
 
-		Vertex* mVertexList = nullptr;
+		void AllocateCPUData();
+		void ReleaseCPUData();
+		void BuildMinMaxQuadtree(float gridSpacing); // after mData is loaded
+
 		MapData* mData = nullptr;
 
 		ER_RHI_GPUTexture* mSplatTexture = nullptr;
@@ -127,7 +150,26 @@ namespace EveryRay_Core
 		ER_RHI_GPUBuffer* mIndexBufferNonTS = nullptr;
 		int mIndexCountNonTS = 0; //not used in GPU tessellated terrain
 
+		XMFLOAT4 mTileRectXZ = XMFLOAT4(0.0, 0.0, 0.0, 0.0); // x,y - min, z,w - max (world space; known before the tile is loaded)
+		int mArraySlice = -1; // slice in the terrain's heightmaps/splatmaps arrays
+		std::atomic<int> mStreamingState { TILE_RESIDENT };
+
 		bool mIsCulled = false;
+	private:
+		bool RayIntersectsCell(int cellX, int cellZ, const XMFLOAT3& origin, const XMFLOAT3& direction, float& distance);
+		bool RayIntersectsNode(int level, int nodeX, int nodeZ, const XMFLOAT3& origin, const XMFLOAT3& invDirection, float& tNear);
+
+		int mWidth = 0;
+		int mHeight = 0;
+
+		// Regular grid of mData: x = origin.x + i * spacing, z = origin.y + j * spacing
+		XMFLOAT2 mGridOrigin = XMFLOAT2(0.0, 0.0);
+		float mGridSpacing = 1.0f;
+
+		// Min/max heights quadtree over the grid cells: [level][z * size + x] (x - min height, y - max height);
+		// level 0 is (width - 1) x (height - 1) cells, the last level is the root (1 x 1)
+		std::vector<std::vector<XMFLOAT2>> mMinMaxHeights;
+		std::vector<int> mMinMaxLevelSizes;
 	};
 
 	class ER_Terrain : public ER_CoreComponent
@@ -155,6 +197,12 @@ namespace EveryRay_Core
 		void SetTessellationFactorDynamic(float factor) { mTessellationFactorDynamic = factor; }
 		void SetTerrainHeightScale(float scale) { mTerrainTessellatedHeightScale = scale; }
 		HeightMap* GetHeightmap(int index) { return mHeightMaps.at(index); }
+		
+		// CPU terrain queries (non-tessellated heights; only resident tiles when streaming)
+		float GetHeightAtPosition(float x, float z); // -1.0 if there is no tile at the position
+		void GetHeightsAtPositions(const XMFLOAT4* positions, float* outHeights, int positionsCount); // batched, in parallel on the job system
+		bool RayCast(const XMFLOAT3& origin, const XMFLOAT3& direction, XMFLOAT3& hitPoint, float maxDistance = FLT_MAX);
+		void RunHeightQueriesBenchmark();
 		void PlaceOnTerrain(ER_RHI_GPUBuffer* outputBuffer, ER_RHI_GPUBuffer* inputBuffer, XMFLOAT4* positions, int positionsCount,
 			TerrainSplatChannels splatChannel = TerrainSplatChannels::NONE,	XMFLOAT4* terrainVertices = nullptr, int terrainVertexCount = 0);
 		void ReadbackPlacedPositions(ER_RHI_GPUBuffer* outputBuffer, ER_RHI_GPUBuffer* inputBuffer, XMFLOAT4* positions, int positionsCount);
@@ -163,17 +211,32 @@ namespace EveryRay_Core
 		void SetEnabled(bool val) { mEnabled = val; }
 		bool IsEnabled() { return mEnabled; }
 		bool IsLoaded() { return mLoaded; }
+		bool IsStreaming() { return mIsStreaming; }
 
 		using Delegate_ReadbackPlacedPositions = std::function<void(ER_Terrain* aTerrain)>;
 		ER_GenericEvent<Delegate_ReadbackPlacedPositions>* ReadbackPlacedPositionsOnInitEvent = new ER_GenericEvent<Delegate_ReadbackPlacedPositions>();
 		ER_GenericEvent<Delegate_ReadbackPlacedPositions>* ReadbackPlacedPositionsOnUpdateEvent = new ER_GenericEvent<Delegate_ReadbackPlacedPositions>();
 	private:
 		void LoadTile(int threadIndex, const std::wstring& path);
+		void LoadTerrainTileHeightsCPU(int tileIndexX, int tileIndexY, const std::wstring& aPath); //thread-safe (no RHI calls)
 		void CreateTerrainTileDataCPU(int tileIndexX, int tileIndexY, const std::wstring& aPath);
 		void CreateTerrainTileDataGPU(int tileIndexX, int tileIndexY);
 		void LoadTextures(const std::wstring& aTexturesPath, const std::wstring& splatLayer0Path, const std::wstring& splatLayer1Path,	const std::wstring& splatLayer2Path, const std::wstring& splatLayer3Path);
-		void LoadSplatmapPerTileGPU(int tileIndexX, int tileIndexY, const std::wstring& path);
+		void LoadSplatmapPerTileGPU(int tileIndexX, int tileIndexY, const std::wstring& path, bool generateMips = true);
 		void LoadHeightmapPerTileGPU(int tileIndexX, int tileIndexY, const std::wstring& path);
+		void InitializeStreaming(ER_Scene* aScene, const XMFLOAT3& startPosition);
+		void UpdateStreaming(const XMFLOAT3& cameraPosition);
+		void StreamingThreadLoop();
+		void RequestTilesAround(const XMFLOAT3& position);
+		void ProcessLoadedTiles(int maxCount, bool isLoading);
+		void RequestTileLoad(int tileIndex);
+		void MakeTileResident(int tileIndex, bool isLoading);
+		void EvictTile(int tileIndex);
+		void ReleaseStreamedResources(bool all);
+		float GetDistanceToTile(int tileIndex, const XMFLOAT3& position);
+		HeightMap* FindTileAtPosition(float x, float z);
+		UINT64 GetTileResidentSizeInBytes();
+
 		void DrawTessellated(TerrainRenderPass aPass, const std::vector<ER_RHI_GPUTexture*>& aRenderTargets, ER_RHI_GPUTexture* aDepthTarget, int i, ER_ShadowMapper* worldShadowMapper = nullptr, ER_LightProbesManager* probeManager = nullptr, int shadowMapCascade = -1);
 
 		ER_DirectionalLight& mDirectionalLight;
@@ -214,6 +277,29 @@ namespace EveryRay_Core
 
 		std::wstring mLevelPath;
 
+		// tile streaming
+		std::vector<std::thread> mStreamingThreads;
+		std::deque<int> mStreamingRequests; // tiles to load on streaming threads
+		std::deque<int> mStreamingLoadedTiles; // tiles loaded on the CPU (waiting for MakeTileResident())
+		std::mutex mStreamingMutex;
+		std::condition_variable mStreamingCondition; // new requests (or shutdown) for streaming threads
+		std::condition_variable mStreamingLoadedCondition; // new loaded tiles for the main thread
+		bool mIsStreamingThreadsRunning = false;
+		std::vector<int> mFreeTileSlices; // free slices of the heightmaps/splatmaps arrays
+		std::vector<TerrainTileDataGPU> mTerrainTilesDataCPU; // per array slice (uploaded to mTerrainTilesDataGPU when dirty)
+		std::vector<std::pair<ER_RHI_GPUResource*, UINT64>> mStreamingPendingReleases; // resources of evicted tiles + frame of eviction
+		std::vector<int> mStreamingSortedTiles; // temp (tiles sorted by distance to the camera)
+		std::vector<float> mStreamingTileDistances; // temp
+		std::wstring mTerrainTexturesPath;
+		UINT64 mStreamingBudgetBytes = 0;
+		UINT64 mStreamingFrameIndex = 0;
+		float mStreamingDistance = 0.0f;
+		int mMaxResidentTiles = 0;
+		int mResidentTilesCount = 0;
+		int mLoadingTilesCount = 0; // requested or loaded, but not resident yet
+		bool mIsStreaming = false;
+		bool mIsTilesDataDirty = false;
+
 		UINT mWidth = 0;
 		UINT mHeight = 0;
 
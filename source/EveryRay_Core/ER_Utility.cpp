@@ -12,6 +12,8 @@ namespace EveryRay_Core
 	bool ER_Utility::IsLightEditor = false;
 	bool ER_Utility::IsFoliageEditor = false;
 	bool ER_Utility::IsMainCameraCPUFrustumCulling = true;
+	bool ER_Utility::IsMainCameraGPUCulling = false;
+	bool ER_Utility::IsShadowCastersCPUCulling = true;
 	float ER_Utility::DistancesLOD[MAX_LOD] = { 100.0f, 240.0f, 400.0f };
 
 	std::string ER_Utility::CurrentDirectory()
@@ -114,6 +116,21 @@ namespace EveryRay_Core
 		}
 	}
 
+	void ER_Utility::CreateDirectories(const std::string& directory)
+	{
+		std::string fullPath(directory);
+		std::replace(fullPath.begin(), fullPath.end(), '/', '\\');
+
+		std::string::size_type slashIndex = fullPath.find('\\');
+		while (slashIndex != std::string::npos)
+		{
+			if (slashIndex > 0 && fullPath[slashIndex - 1] != ':') // skip drive letters
+				CreateDirectoryA(fullPath.substr(0, slashIndex).c_str(), nullptr);
+			slashIndex = fullPath.find('\\', slashIndex + 1);
+		}
+		CreateDirectoryA(fullPath.c_str(), nullptr);
+	}
+
 	void ER_Utility::LoadBinaryFile(const std::wstring& filename, std::vector<char>& data)
 	{
 		std::ifstream file(filename.c_str(), std::ios::binary);
@@ -167,4 +184,20 @@ namespace EveryRay_Core
 		float r = random * diff;
 		return a + r;
 	}
+	UINT64 ER_Utility::HashFNV1a(const void* data, size_t size, UINT64 seed)
+	{
+		const UINT8* bytes = static_cast<const UINT8*>(data);
+		UINT64 hash = seed;
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	bool ER_Utility::IsRangeInFile(UINT64 offset, UINT64 size, UINT64 begin, UINT64 fileSize)
+	{
+		return begin <= fileSize && offset >= begin && offset <= fileSize && size <= fileSize - offset;
+	}
 }
\ No newline at end of file
@@ -19,16 +19,21 @@ namespace EveryRay_Core
 		static void GetFileName(const std::string& inputPath, std::string& filename);
 		static void GetDirectory(const std::string& inputPath, std::string& directory);
 		static void GetFileNameAndDirectory(const std::string& inputPath, std::string& directory, std::string& filename);
+		static void CreateDirectories(const std::string& directory); // creates all missing directories of the path
 		static void LoadBinaryFile(const std::wstring& filename, std::vector<char>& data);
 		static void ToWideString(const std::string& source, std::wstring& dest);
 		static std::wstring ToWideString(const std::string& source);
 		static void PathJoin(std::wstring& dest, const std::wstring& sourceDirectory, const std::wstring& sourceFile);
 		static void GetPathExtension(const std::wstring& source, std::wstring& dest);
 		static float RandomFloat(float a, float b);
+		static UINT64 HashFNV1a(const void* data, size_t size, UINT64 seed = 14695981039346656037ull); // 64-bit FNV-1a (seed can be a previous hash to chain data)
+		static bool IsRangeInFile(UINT64 offset, UINT64 size, UINT64 begin, UINT64 fileSize); // [offset; offset + size) is inside of [begin; fileSize), without overflowing on corrupted offsets and sizes
 		static bool IsEditorMode;
 		static bool IsLightEditor;
 		static bool IsFoliageEditor;
 		static bool IsMainCameraCPUFrustumCulling;
+		static bool IsMainCameraGPUCulling; // instanced objects only (ER_GPUInstanceCuller)
+		static bool IsShadowCastersCPUCulling;
 		static float DistancesLOD[MAX_LOD];
 	private:
 		ER_Utility();
@@ -73,7 +73,7 @@ namespace EveryRay_Core
 		assert(neededSystems.mShadowMapper);
 		assert(neededSystems.mDirectionalLight);
 
-		int shadowCascadeIndex = 1;
+		int shadowCascadeIndex = VOXELIZATION_MAT_SHADOW_CASCADE_INDEX;
 		mConstantBuffer.Data.World = XMMatrixTranspose(aObj->GetTransformationMatrix());
 		mConstantBuffer.Data.ViewProjection = XMMatrixTranspose(camera->ViewMatrix() * camera->ProjectionMatrix());
 		mConstantBuffer.Data.ShadowMatrix = XMMatrixTranspose(neededSystems.mShadowMapper->GetViewMatrix(shadowCascadeIndex) * neededSystems.mShadowMapper->GetProjectionMatrix(shadowCascadeIndex) * XMLoadFloat4x4(&ER_MatrixHelper::GetProjectionShadowMatrix()));
@@ -4,6 +4,7 @@
 #define VOXELIZATION_MAT_ROOT_DESCRIPTOR_TABLE_SRV_INDEX 0
 #define VOXELIZATION_MAT_ROOT_DESCRIPTOR_TABLE_UAV_INDEX 1
 #define VOXELIZATION_MAT_ROOT_DESCRIPTOR_TABLE_CBV_INDEX 2
+#define VOXELIZATION_MAT_SHADOW_CASCADE_INDEX 1 // voxels are shadowed with this cascade of ER_ShadowMapper
 
 namespace EveryRay_Core
 {
@@ -7,12 +7,6 @@
 
 #include "DirectXSH.h"
 
-#define DX11_MAX_BOUND_RENDER_TARGETS_VIEWS 8
-#define DX11_MAX_BOUND_SHADER_RESOURCE_VIEWS 64 
-#define DX11_MAX_BOUND_UNORDERED_ACCESS_VIEWS 8 
-#define DX11_MAX_BOUND_CONSTANT_BUFFERS 8 
-#define DX11_MAX_BOUND_SAMPLERS 8 
-
 namespace EveryRay_Core
 {
 	ER_RHI_DX11::ER_RHI_DX11()
@@ -67,6 +61,11 @@ namespace EveryRay_Core
 		ReleaseObject(DepthOnlyWriteComparisonGreaterEqualDS);
 		ReleaseObject(DepthOnlyWriteComparisonAlwaysDS);
 
+		ReleaseObject(mUploadRingCB.Buffer);
+		ReleaseObject(mUploadRingVB.Buffer);
+
+		DeleteObject(mShaderCache);
+
 		if (mDirect3DDeviceContext)
 			mDirect3DDeviceContext->ClearState();
 
@@ -224,6 +223,10 @@ namespace EveryRay_Core
 		CreateRasterizerStates();
 		CreateDepthStencilStates();
 		CreateBlendStates();
+		CreateUploadRings();
+
+		if (!mShaderCache)
+			mShaderCache = new ER_RHI_ShaderCache("DX11", ER_RHI_DX11_GPUShader::CompileBytecode);
 
 		return true;
 	}
@@ -413,6 +416,14 @@ namespace EveryRay_Core
 		mDirect3DDeviceContext->DrawIndexedInstanced(IndexCountPerInstance, InstanceCount, StartIndexLocation, BaseVertexLocation, StartInstanceLocation);
 	}
 
+	void ER_RHI_DX11::DrawIndexedInstancedIndirect(ER_RHI_GPUBuffer* aArgsBuffer, UINT aArgsOffset)
+	{
+		assert(aArgsBuffer);
+		assert(aArgsOffset + sizeof(ER_RHI_DRAW_INDEXED_INSTANCED_ARGS) <= static_cast<UINT>(aArgsBuffer->GetSize()));
+
+		mDirect3DDeviceContext->DrawIndexedInstancedIndirect(static_cast<ID3D11Buffer*>(aArgsBuffer->GetBuffer()), aArgsOffset);
+	}
+
 	void ER_RHI_DX11::Dispatch(UINT ThreadGroupCountX, UINT ThreadGroupCountY, UINT ThreadGroupCountZ)
 	{
 		mDirect3DDeviceContext->Dispatch(ThreadGroupCountX, ThreadGroupCountY, ThreadGroupCountZ);
@@ -432,6 +443,9 @@ namespace EveryRay_Core
 		HRESULT hr = mSwapChain->Present(0, 0);
 		if (FAILED(hr))
 			throw ER_CoreException("ER_RHI_DX11: IDXGISwapChain::Present() failed.", hr);
+
+		EndUploadRingsFrame();
+		PublishBindingStats();
 	}
 
 	bool ER_RHI_DX11::ProjectCubemapToSH(ER_RHI_GPUTexture* aTexture, UINT order, float* resultR, float* resultG, float* resultB)
@@ -444,6 +458,46 @@ namespace EveryRay_Core
 		return !(FAILED(DirectX::SHProjectCubeMap(mDirect3DDeviceContext, order, tex->GetTexture2D(), resultR, resultG, resultB)));
 	}
 
+	bool ER_RHI_DX11::ReadGPUTextureToCPU(ER_RHI_GPUTexture* aTexture, UINT aMip, std::vector<XMFLOAT4>& aOutTexels)
+	{
+		assert(aTexture);
+
+		ER_RHI_DX11_GPUTexture* tex = static_cast<ER_RHI_DX11_GPUTexture*>(aTexture);
+		assert(tex);
+
+		DirectX::ScratchImage capturedImage;
+		if (FAILED(DirectX::CaptureTexture(mDirect3DDevice, mDirect3DDeviceContext, tex->GetTexture2D(), capturedImage)))
+			return false;
+
+		const DirectX::TexMetadata& metadata = capturedImage.GetMetadata();
+		if (aMip >= metadata.mipLevels)
+			return false;
+
+		const DirectX::ScratchImage* image = &capturedImage;
+		DirectX::ScratchImage convertedImage;
+		if (metadata.format != DXGI_FORMAT_R32G32B32A32_FLOAT)
+		{
+			if (FAILED(DirectX::Convert(capturedImage.GetImages(), capturedImage.GetImageCount(), metadata, DXGI_FORMAT_R32G32B32A32_FLOAT,
+				DirectX::TEX_FILTER_DEFAULT, DirectX::TEX_THRESHOLD_DEFAULT, convertedImage)))
+				return false;
+			image = &convertedImage;
+		}
+
+		const size_t width = std::max<size_t>(metadata.width >> aMip, 1);
+		const size_t height = std::max<size_t>(metadata.height >> aMip, 1);
+		aOutTexels.resize(width * height * metadata.arraySize);
+		for (size_t item = 0; item < metadata.arraySize; item++)
+		{
+			const DirectX::Image* slice = image->GetImage(aMip, item, 0);
+			if (!slice)
+				return false;
+
+			for (size_t y = 0; y < height; y++)
+				memcpy(&aOutTexels[(item * height + y) * width], slice->pixels + y * slice->rowPitch, width * sizeof(XMFLOAT4));
+		}
+		return true;
+	}
+
 	void ER_RHI_DX11::SaveGPUTextureToFile(ER_RHI_GPUTexture* aTexture, const std::wstring& aPathName)
 	{
 		assert(aTexture);
@@ -469,9 +523,10 @@ namespace EveryRay_Core
 	void ER_RHI_DX11::SetMainRenderTargets(int cmdListIndex)
 	{
 		mDirect3DDeviceContext->OMSetRenderTargets(1, &mMainRenderTargetView, NULL);
+		mStateCache.InvalidateShaderResources(); // the runtime unbinds SRVs of new outputs
 	}
 
-	void ER_RHI_DX11::SetRenderTargets(const std::vector<ER_RHI_GPUTexture*>& aRenderTargets, ER_RHI_GPUTexture* aDepthTarget /*= nullptr*/, ER_RHI_GPUTexture* aUAV /*= nullptr*/, int rtvArrayIndex)
+	void ER_RHI_DX11::SetRenderTargets(ER_RHI_Span<ER_RHI_GPUTexture*> aRenderTargets, ER_RHI_GPUTexture* aDepthTarget /*= nullptr*/, ER_RHI_GPUTexture* aUAV /*= nullptr*/, int rtvArrayIndex)
 	{
 		if (!aUAV)
 		{
@@ -515,6 +570,7 @@ namespace EveryRay_Core
 			else
 				mDirect3DDeviceContext->OMSetRenderTargetsAndUnorderedAccessViews(0, nullRTVs, NULL, 0, 1, UAVs, NULL);
 		}
+		mStateCache.InvalidateShaderResources(); // the runtime unbinds SRVs of new outputs
 	}
 
 	void ER_RHI_DX11::SetDepthTarget(ER_RHI_GPUTexture* aDepthTarget)
@@ -526,51 +582,78 @@ namespace EveryRay_Core
 		assert(dsv);
 
 		mDirect3DDeviceContext->OMSetRenderTargets(1, nullRTVs, dsv);
+		mStateCache.InvalidateShaderResources(); // the runtime unbinds SRVs of new outputs
 	}
 
 	void ER_RHI_DX11::SetDepthStencilState(ER_RHI_DEPTH_STENCIL_STATE aDS, UINT stencilRef)
 	{
+		ID3D11DepthStencilState* state = nullptr;
 		if (aDS == ER_DISABLED)
+			stencilRef = 0xffffffff;
+		else
 		{
-			mDirect3DDeviceContext->OMSetDepthStencilState(nullptr, 0xffffffff);
-			return;
+			auto it = mDepthStates.find(aDS);
+			if (it == mDepthStates.end())
+				throw ER_CoreException("ER_RHI_DX11: DepthStencil state is not found.");
+			state = it->second;
 		}
 
-		auto it = mDepthStates.find(aDS);
-		if (it != mDepthStates.end())
-			mDirect3DDeviceContext->OMSetDepthStencilState(it->second, stencilRef);
-		else
-			throw ER_CoreException("ER_RHI_DX11: DepthStencil state is not found.");
+		if (mStateCache.DepthStencilState.Matches(state, stencilRef))
+		{
+			OnBind(true);
+			return;
+		}
+		mStateCache.DepthStencilState.Set(state, stencilRef);
+		mDirect3DDeviceContext->OMSetDepthStencilState(state, stencilRef);
+		OnBind(false);
 	}
 
 	void ER_RHI_DX11::SetBlendState(ER_RHI_BLEND_STATE aBS, const float BlendFactor[4], UINT SampleMask)
 	{
+		ID3D11BlendState* state = nullptr;
 		if (aBS == ER_RHI_BLEND_STATE::ER_NO_BLEND)
 		{
-			mDirect3DDeviceContext->OMSetBlendState(nullptr, NULL, 0xffffffff);
-			return;
+			BlendFactor = nullptr;
+			SampleMask = 0xffffffff;
 		}
-
-		auto it = mBlendStates.find(aBS);
-		if (it != mBlendStates.end())
+		else
 		{
+			auto it = mBlendStates.find(aBS);
+			if (it == mBlendStates.end())
+				throw ER_CoreException("ER_RHI_DX11: Blend state is not found.");
 			mCurrentBS = aBS;
-			mDirect3DDeviceContext->OMSetBlendState(it->second, BlendFactor, SampleMask);
+			state = it->second;
 		}
-		else
-			throw ER_CoreException("ER_RHI_DX11: Blend state is not found.");
+
+		// nullptr blend factor is (1, 1, 1, 1) in D3D11
+		const float defaultBlendFactor[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+		const float* blendFactor = BlendFactor ? BlendFactor : defaultBlendFactor;
+		if (mStateCache.BlendState.Matches(state, SampleMask) && memcmp(mStateCache.BlendFactor, blendFactor, sizeof(mStateCache.BlendFactor)) == 0)
+		{
+			OnBind(true);
+			return;
+		}
+		mStateCache.BlendState.Set(state, SampleMask);
+		memcpy(mStateCache.BlendFactor, blendFactor, sizeof(mStateCache.BlendFactor));
+		mDirect3DDeviceContext->OMSetBlendState(state, BlendFactor, SampleMask);
+		OnBind(false);
 	}
 
 	void ER_RHI_DX11::SetRasterizerState(ER_RHI_RASTERIZER_STATE aRS)
 	{
 		auto it = mRasterizerStates.find(aRS);
-		if (it != mRasterizerStates.end())
+		if (it == mRasterizerStates.end())
+			throw ER_CoreException("ER_RHI_DX11: Rasterizer state is not found.");
+
+		mCurrentRS = aRS;
+		if (mStateCache.RasterizerState.Matches(it->second))
 		{
-			mCurrentRS = aRS;
-			mDirect3DDeviceContext->RSSetState(it->second);
+			OnBind(true);
+			return;
 		}
-		else
-			throw ER_CoreException("ER_RHI_DX11: Rasterizer state is not found.");
+		mStateCache.RasterizerState.Set(it->second);
+		mDirect3DDeviceContext->RSSetState(it->second);
+		OnBind(false);
 	}
 
 	void ER_RHI_DX11::SetViewport(const ER_RHI_Viewport& aViewport)
@@ -594,7 +677,7 @@ namespace EveryRay_Core
 		mDirect3DDeviceContext->RSSetScissorRects(1, &currentRect);
 	}
 
-	void ER_RHI_DX11::SetShaderResources(ER_RHI_SHADER_TYPE aShaderType, const std::vector<ER_RHI_GPUResource*>& aSRVs, UINT startSlot,
+	void ER_RHI_DX11::SetShaderResources(ER_RHI_SHADER_TYPE aShaderType, ER_RHI_Span<ER_RHI_GPUResource*> aSRVs, UINT startSlot,
 		ER_RHI_GPURootSignature* rs, int rootParamIndex, bool isComputeRS, bool skipAutomaticTransition)
 	{
 		assert(aSRVs.size() > 0);
@@ -613,30 +696,42 @@ namespace EveryRay_Core
 			}
 		}
 
+		// only the changed range goes to the context
+		assert(startSlot + srCount <= DX11_MAX_BOUND_SHADER_RESOURCE_VIEWS);
+		UINT first = 0, last = 0;
+		if (!FilterSlots(&mStateCache.SRVs[aShaderType][startSlot], reinterpret_cast<const void* const*>(SRs), nullptr, nullptr, srCount, first, last))
+		{
+			OnBind(true);
+			return;
+		}
+		const UINT slot = startSlot + first;
+		const UINT count = last - first + 1;
+
 		switch (aShaderType)
 		{
 		case ER_RHI_SHADER_TYPE::ER_VERTEX:
-			mDirect3DDeviceContext->VSSetShaderResources(startSlot, srCount, SRs);
+			mDirect3DDeviceContext->VSSetShaderResources(slot, count, SRs + first);
 			break;
 		case ER_RHI_SHADER_TYPE::ER_GEOMETRY:
-			mDirect3DDeviceContext->GSSetShaderResources(startSlot, srCount, SRs);
+			mDirect3DDeviceContext->GSSetShaderResources(slot, count, SRs + first);
 			break;
 		case ER_RHI_SHADER_TYPE::ER_TESSELLATION_HULL:
-			mDirect3DDeviceContext->HSSetShaderResources(startSlot, srCount, SRs);
+			mDirect3DDeviceContext->HSSetShaderResources(slot, count, SRs + first);
 			break;
 		case ER_RHI_SHADER_TYPE::ER_TESSELLATION_DOMAIN:
-			mDirect3DDeviceContext->DSSetShaderResources(startSlot, srCount, SRs);
+			mDirect3DDeviceContext->DSSetShaderResources(slot, count, SRs + first);
 			break;
 		case ER_RHI_SHADER_TYPE::ER_PIXEL:
-			mDirect3DDeviceContext->PSSetShaderResources(startSlot, srCount, SRs);
+			mDirect3DDeviceContext->PSSetShaderResources(slot, count, SRs + first);
 			break;
 		case ER_RHI_SHADER_TYPE::ER_COMPUTE:
-			mDirect3DDeviceContext->CSSetShaderResources(startSlot, srCount, SRs);
+			mDirect3DDeviceContext->CSSetShaderResources(slot, count, SRs + first);
 			break;
 		}
+		OnBind(false);
 	}
 
-	void ER_RHI_DX11::SetUnorderedAccessResources(ER_RHI_SHADER_TYPE aShaderType, const std::vector<ER_RHI_GPUResource*>& aUAVs, UINT startSlot,
+	void ER_RHI_DX11::SetUnorderedAccessResources(ER_RHI_SHADER_TYPE aShaderType, ER_RHI_Span<ER_RHI_GPUResource*> aUAVs, UINT startSlot,
 		ER_RHI_GPURootSignature* rs, int rootParamIndex, bool isComputeRS, bool skipAutomaticTransition)
 	{
 		assert(aUAVs.size() > 0);
@@ -670,42 +765,99 @@ namespace EveryRay_Core
 			mDirect3DDeviceContext->CSSetUnorderedAccessViews(startSlot, uavCount, UAVs, NULL);
 			break;
 		}
+		mStateCache.InvalidateShaderResources(); // the runtime unbinds SRVs of new outputs
+		OnBind(false);
 	}
 
-	void ER_RHI_DX11::SetConstantBuffers(ER_RHI_SHADER_TYPE aShaderType, const std::vector<ER_RHI_GPUBuffer*>& aCBs, UINT startSlot,
+	void ER_RHI_DX11::SetConstantBuffers(ER_RHI_SHADER_TYPE aShaderType, ER_RHI_Span<ER_RHI_GPUBuffer*> aCBs, UINT startSlot,
 		ER_RHI_GPURootSignature* rs, int rootParamIndex, bool isComputeRS)
 	{
 		assert(aCBs.size() > 0);
 		assert(aCBs.size() <= DX11_MAX_BOUND_CONSTANT_BUFFERS);
 
 		ID3D11Buffer* CBs[DX11_MAX_BOUND_CONSTANT_BUFFERS] = {};
+		UINT firstConstants[DX11_MAX_BOUND_CONSTANT_BUFFERS] = {};
+		UINT numConstants[DX11_MAX_BOUND_CONSTANT_BUFFERS] = {};
+		bool isUsingUploadRing = false;
 		UINT cbsCount = static_cast<UINT>(aCBs.size());
 		for (UINT i = 0; i < cbsCount; i++)
 		{
 			assert(aCBs[i]);
-			CBs[i] = static_cast<ID3D11Buffer*>(aCBs[i]->GetBuffer());
+			ER_RHI_DX11_GPUBuffer* buffer = static_cast<ER_RHI_DX11_GPUBuffer*>(aCBs[i]);
+			// the buffer was updated in one of the previous frames: its ring allocation is gone, so upload the last data again
+			if (mUploadRingCB.Buffer && buffer->IsUploadRingConstantBuffer() && !buffer->HasUploadRingAllocation(mUploadRingFrameIndex) && !buffer->GetUploadRingShadowData().empty())
+				UploadConstantBufferFromShadowData(buffer);
+
+			// constants are counted in 16-byte registers and ranges must be multiples of 16 registers
+			numConstants[i] = static_cast<UINT>(ER_BitmaskAlign(buffer->GetSize(), ER_RHI_UPLOAD_RING_CB_ALIGNMENT)) / 16;
+			if (buffer->HasUploadRingAllocation(mUploadRingFrameIndex))
+			{
+				CBs[i] = mUploadRingCB.Buffer;
+				firstConstants[i] = static_cast<UINT>(buffer->GetUploadRingOffset() / 16);
+				isUsingUploadRing = true;
+			}
+			else
+				CBs[i] = static_cast<ID3D11Buffer*>(buffer->GetBuffer());
 			assert(CBs[i]);
 		}
 
+		// ring allocations change with every update, so the offsets are a part of the binding
+		assert(startSlot + cbsCount <= DX11_MAX_BOUND_CONSTANT_BUFFERS);
+		UINT first = 0, last = 0;
+		if (!FilterSlots(&mStateCache.CBs[aShaderType][startSlot], reinterpret_cast<const void* const*>(CBs), firstConstants, isUsingUploadRing ? numConstants : nullptr, cbsCount, first, last))
+		{
+			OnBind(true);
+			return;
+		}
+		OnBind(false);
+		const UINT slot = startSlot + first;
+		const UINT count = last - first + 1;
+
+		if (isUsingUploadRing)
+		{
+			switch (aShaderType)
+			{
+			case ER_RHI_SHADER_TYPE::ER_VERTEX:
+				mDirect3DDeviceContext->VSSetConstantBuffers1(slot, count, CBs + first, firstConstants + first, numConstants + first);
+				break;
+			case ER_RHI_SHADER_TYPE::ER_GEOMETRY:
+				mDirect3DDeviceContext->GSSetConstantBuffers1(slot, count, CBs + first, firstConstants + first, numConstants + first);
+				break;
+			case ER_RHI_SHADER_TYPE::ER_TESSELLATION_HULL:
+				mDirect3DDeviceContext->HSSetConstantBuffers1(slot, count, CBs + first, firstConstants + first, numConstants + first);
+				break;
+			case ER_RHI_SHADER_TYPE::ER_TESSELLATION_DOMAIN:
+				mDirect3DDeviceContext->DSSetConstantBuffers1(slot, count, CBs + first, firstConstants + first, numConstants + first);
+				break;
+			case ER_RHI_SHADER_TYPE::ER_PIXEL:
+				mDirect3DDeviceContext->PSSetConstantBuffers1(slot, count, CBs + first, firstConstants + first, numConstants + first);
+				break;
+			case ER_RHI_SHADER_TYPE::ER_COMPUTE:
+				mDirect3DDeviceContext->CSSetConstantBuffers1(slot, count, CBs + first, firstConstants + first, numConstants + first);
+				break;
+			}
+			return;
+		}
+
 		switch (aShaderType)
 		{
 		case ER_RHI_SHADER_TYPE::ER_VERTEX:
-			mDirect3DDeviceContext->VSSetConstantBuffers(startSlot, cbsCount, CBs);
+			mDirect3DDeviceContext->VSSetConstantBuffers(slot, count, CBs + first);
 			break;
 		case ER_RHI_SHADER_TYPE::ER_GEOMETRY:
-			mDirect3DDeviceContext->GSSetConstantBuffers(startSlot, cbsCount, CBs);
+			mDirect3DDeviceContext->GSSetConstantBuffers(slot, count, CBs + first);
 			break;
 		case ER_RHI_SHADER_TYPE::ER_TESSELLATION_HULL:
-			mDirect3DDeviceContext->HSSetConstantBuffers(startSlot, cbsCount, CBs);
+			mDirect3DDeviceContext->HSSetConstantBuffers(slot, count, CBs + first);
 			break;
 		case ER_RHI_SHADER_TYPE::ER_TESSELLATION_DOMAIN:
-			mDirect3DDeviceContext->DSSetConstantBuffers(startSlot, cbsCount, CBs);
+			mDirect3DDeviceContext->DSSetConstantBuffers(slot, count, CBs + first);
 			break;
 		case ER_RHI_SHADER_TYPE::ER_PIXEL:
-			mDirect3DDeviceContext->PSSetConstantBuffers(startSlot, cbsCount, CBs);
+			mDirect3DDeviceContext->PSSetConstantBuffers(slot, count, CBs + first);
 			break;
 		case ER_RHI_SHADER_TYPE::ER_COMPUTE:
-			mDirect3DDeviceContext->CSSetConstantBuffers(startSlot, cbsCount, CBs);
+			mDirect3DDeviceContext->CSSetConstantBuffers(slot, count, CBs + first);
 			break;
 		}
 	}
@@ -714,6 +866,15 @@ namespace EveryRay_Core
 	{
 		assert(aShader);
 
+		ER_RHI_DX11_BoundSlot& boundShader = mStateCache.Shaders[aShader->mShaderType];
+		if (boundShader.Matches(aShader->GetShaderObject()))
+		{
+			OnBind(true);
+			return;
+		}
+		boundShader.Set(aShader->GetShaderObject());
+		OnBind(false);
+
 		switch (aShader->mShaderType)
 		{
 		case ER_RHI_SHADER_TYPE::ER_VERTEX:
@@ -761,7 +922,7 @@ namespace EveryRay_Core
 		}
 	}
 
-	void ER_RHI_DX11::SetSamplers(ER_RHI_SHADER_TYPE aShaderType, const std::vector<ER_RHI_SAMPLER_STATE>& aSamplers, UINT startSlot, ER_RHI_GPURootSignature* rs)
+	void ER_RHI_DX11::SetSamplers(ER_RHI_SHADER_TYPE aShaderType, ER_RHI_Span<ER_RHI_SAMPLER_STATE> aSamplers, UINT startSlot, ER_RHI_GPURootSignature* rs)
 	{
 		assert(aSamplers.size() > 0);
 		assert(aSamplers.size() <= DX11_MAX_BOUND_SAMPLERS);
@@ -777,25 +938,36 @@ namespace EveryRay_Core
 				SS[i] = it->second;
 		}
 
+		assert(startSlot + ssCount <= DX11_MAX_BOUND_SAMPLERS);
+		UINT first = 0, last = 0;
+		if (!FilterSlots(&mStateCache.Samplers[aShaderType][startSlot], reinterpret_cast<const void* const*>(SS), nullptr, nullptr, ssCount, first, last))
+		{
+			OnBind(true);
+			return;
+		}
+		OnBind(false);
+		const UINT slot = startSlot + first;
+		const UINT count = last - first + 1;
+
 		switch (aShaderType)
 		{
 		case ER_RHI_SHADER_TYPE::ER_VERTEX:
-			mDirect3DDeviceContext->VSSetSamplers(startSlot, ssCount, SS);
+			mDirect3DDeviceContext->VSSetSamplers(slot, count, SS + first);
 			break;
 		case ER_RHI_SHADER_TYPE::ER_GEOMETRY:
-			mDirect3DDeviceContext->GSSetSamplers(startSlot, ssCount, SS);
+			mDirect3DDeviceContext->GSSetSamplers(slot, count, SS + first);
 			break;
 		case ER_RHI_SHADER_TYPE::ER_TESSELLATION_HULL:
-			mDirect3DDeviceContext->HSSetSamplers(startSlot, ssCount, SS);
+			mDirect3DDeviceContext->HSSetSamplers(slot, count, SS + first);
 			break;
 		case ER_RHI_SHADER_TYPE::ER_TESSELLATION_DOMAIN:
-			mDirect3DDeviceContext->DSSetSamplers(startSlot, ssCount, SS);
+			mDirect3DDeviceContext->DSSetSamplers(slot, count, SS + first);
 			break;
 		case ER_RHI_SHADER_TYPE::ER_PIXEL:
-			mDirect3DDeviceContext->PSSetSamplers(startSlot, ssCount, SS);
+			mDirect3DDeviceContext->PSSetSamplers(slot, count, SS + first);
 			break;
 		case ER_RHI_SHADER_TYPE::ER_COMPUTE:
-			mDirect3DDeviceContext->CSSetSamplers(startSlot, ssCount, SS);
+			mDirect3DDeviceContext->CSSetSamplers(slot, count, SS + first);
 			break;
 		}
 	}
@@ -804,13 +976,37 @@ namespace EveryRay_Core
 	{
 		ER_RHI_DX11_InputLayout* aDX11_IL = static_cast<ER_RHI_DX11_InputLayout*>(aIL);
 		assert(aDX11_IL);
+		if (!aDX11_IL->mInputLayout && aDX11_IL->mPendingBytecode)
+		{
+			mShaderCache->Wait(*aDX11_IL->mPendingBytecode);
+			if (!aDX11_IL->mPendingBytecode->IsValid())
+				throw ER_CoreException(aDX11_IL->mPendingBytecode->GetErrors().c_str());
+
+			const std::vector<char>& bytecode = aDX11_IL->mPendingBytecode->GetBytecode();
+			CreateInputLayout(aDX11_IL, aDX11_IL->mInputElementDescriptions, aDX11_IL->mInputElementDescriptionCount, bytecode.data(), static_cast<UINT>(bytecode.size()));
+			aDX11_IL->mPendingBytecode.reset();
+		}
 		assert(aDX11_IL->mInputLayout);
+		if (mStateCache.InputLayout.Matches(aDX11_IL->mInputLayout))
+		{
+			OnBind(true);
+			return;
+		}
+		mStateCache.InputLayout.Set(aDX11_IL->mInputLayout);
 		mDirect3DDeviceContext->IASetInputLayout(aDX11_IL->mInputLayout);
+		OnBind(false);
 	}
 
 	void ER_RHI_DX11::SetEmptyInputLayout()
 	{
+		if (mStateCache.InputLayout.Matches(nullptr))
+		{
+			OnBind(true);
+			return;
+		}
+		mStateCache.InputLayout.Set(nullptr);
 		mDirect3DDeviceContext->IASetInputLayout(nullptr);
+		OnBind(false);
 	}
 
 	void ER_RHI_DX11::SetIndexBuffer(ER_RHI_GPUBuffer* aBuffer, UINT offset /*= 0*/)
@@ -818,38 +1014,55 @@ namespace EveryRay_Core
 		assert(aBuffer);
 		ID3D11Buffer* buf = static_cast<ID3D11Buffer*>(aBuffer->GetBuffer());
 		assert(buf);
-		mDirect3DDeviceContext->IASetIndexBuffer(buf, GetFormat(aBuffer->GetFormatRhi()), offset);
+		const DXGI_FORMAT format = GetFormat(aBuffer->GetFormatRhi());
+		if (mStateCache.IndexBuffer.Matches(buf, offset, static_cast<UINT>(format)))
+		{
+			OnBind(true);
+			return;
+		}
+		mStateCache.IndexBuffer.Set(buf, offset, static_cast<UINT>(format));
+		mDirect3DDeviceContext->IASetIndexBuffer(buf, format, offset);
+		OnBind(false);
 	}
 
-	void ER_RHI_DX11::SetVertexBuffers(const std::vector<ER_RHI_GPUBuffer*>& aVertexBuffers)
+	void ER_RHI_DX11::SetVertexBuffers(ER_RHI_Span<ER_RHI_GPUBuffer*> aVertexBuffers)
 	{
 		assert(aVertexBuffers.size() > 0 && aVertexBuffers.size() <= ER_RHI_MAX_BOUND_VERTEX_BUFFERS);
-		if (aVertexBuffers.size() == 1)
+
+		// [0] - vertex buffer, [1] - instance buffer (optional)
+		ID3D11Buffer* bufferPointers[ER_RHI_MAX_BOUND_VERTEX_BUFFERS] = {};
+		UINT strides[ER_RHI_MAX_BOUND_VERTEX_BUFFERS] = {};
+		UINT offsets[ER_RHI_MAX_BOUND_VERTEX_BUFFERS] = {};
+		const UINT buffersCount = static_cast<UINT>(aVertexBuffers.size());
+		for (UINT i = 0; i < buffersCount; i++)
 		{
-			UINT stride = aVertexBuffers[0]->GetStride();
-			UINT offset = 0;
-			assert(aVertexBuffers[0]);
-			ID3D11Buffer* bufferPointers[1] = { static_cast<ID3D11Buffer*>(aVertexBuffers[0]->GetBuffer()) };
-			assert(bufferPointers[0]);
-			mDirect3DDeviceContext->IASetVertexBuffers(0, 1, bufferPointers, &stride, &offset);
+			assert(aVertexBuffers[i]);
+			strides[i] = aVertexBuffers[i]->GetStride();
+			bufferPointers[i] = GetVertexBufferBinding(aVertexBuffers[i], offsets[i]);
+			assert(bufferPointers[i]);
 		}
-		else //+ instance buffer
+
+		UINT first = 0, last = 0;
+		if (!FilterSlots(mStateCache.VertexBuffers, reinterpret_cast<const void* const*>(bufferPointers), offsets, strides, buffersCount, first, last))
 		{
-			UINT strides[2] = { aVertexBuffers[0]->GetStride(), aVertexBuffers[1]->GetStride() };
-			UINT offsets[2] = { 0, 0 };
-
-			assert(aVertexBuffers[0]);
-			assert(aVertexBuffers[1]);
-			ID3D11Buffer* bufferPointers[2] = { static_cast<ID3D11Buffer*>(aVertexBuffers[0]->GetBuffer()), static_cast<ID3D11Buffer*>(aVertexBuffers[1]->GetBuffer()) };
-			assert(bufferPointers[0]);
-			assert(bufferPointers[1]);
-			mDirect3DDeviceContext->IASetVertexBuffers(0, 2, bufferPointers, strides, offsets);
+			OnBind(true);
+			return;
 		}
+		mDirect3DDeviceContext->IASetVertexBuffers(first, last - first + 1, bufferPointers + first, strides + first, offsets + first);
+		OnBind(false);
 	}
 
 	void ER_RHI_DX11::SetTopologyType(ER_RHI_PRIMITIVE_TYPE aType)
 	{
-		mDirect3DDeviceContext->IASetPrimitiveTopology(GetTopologyType(aType));
+		const D3D11_PRIMITIVE_TOPOLOGY topology = GetTopologyType(aType);
+		if (mStateCache.Topology.Matches(nullptr, 0, static_cast<UINT>(topology)))
+		{
+			OnBind(true);
+			return;
+		}
+		mStateCache.Topology.Set(nullptr, 0, static_cast<UINT>(topology));
+		mDirect3DDeviceContext->IASetPrimitiveTopology(topology);
+		OnBind(false);
 	}
 
 	ER_RHI_PRIMITIVE_TYPE ER_RHI_DX11::GetCurrentTopologyType()
@@ -863,6 +1076,7 @@ namespace EveryRay_Core
 	{
 		ID3D11RenderTargetView* nullRTVs[1] = { NULL };
 		mDirect3DDeviceContext->OMSetRenderTargets(1, nullRTVs, nullptr);
+		mStateCache.InvalidateShaderResources(); // SRVs that were rejected while their resources were outputs can be bound now
 	}
 
 	void ER_RHI_DX11::UnbindResourcesFromShader(ER_RHI_SHADER_TYPE aShaderType, bool unbindShader)
@@ -874,6 +1088,10 @@ namespace EveryRay_Core
 		ID3D11SamplerState* nullSSs[DX11_MAX_BOUND_SAMPLERS] = { NULL };
 		ID3D11UnorderedAccessView* nullUAV[DX11_MAX_BOUND_UNORDERED_ACCESS_VIEWS] = { NULL };
 
+		mStateCache.InvalidateStage(aShaderType);
+		if (aShaderType == ER_RHI_SHADER_TYPE::ER_COMPUTE)
+			mStateCache.InvalidateShaderResources(); // SRVs that were rejected while their resources were UAVs can be bound now
+
 		switch (aShaderType)
 		{
 		case ER_RHI_SHADER_TYPE::ER_VERTEX:
@@ -940,11 +1158,145 @@ namespace EveryRay_Core
 		ER_RHI_DX11_GPUBuffer* buffer = static_cast<ER_RHI_DX11_GPUBuffer*>(aBuffer);
 		assert(buffer);
 
+		if (mUploadRingCB.Buffer && buffer->IsUploadRingConstantBuffer())
+		{
+			buffer->SetUploadRingShadowData(aData, dataSize);
+			UploadConstantBufferFromShadowData(buffer);
+			return;
+		}
+
+		buffer->ResetUploadRingAllocation();
+		buffer->ClearUploadRingShadowData();
+		UpdateBufferDirect(buffer, aData, dataSize);
+	}
+
+	void ER_RHI_DX11::UpdateBufferTransient(ER_RHI_GPUBuffer* aBuffer, void* aData, int dataSize)
+	{
+		assert(aBuffer->GetSize() >= dataSize);
+
+		UINT64 offset = 0;
+		if (AllocateFromUploadRing(mUploadRingVB, aData, dataSize, dataSize, 16, offset))
+			aBuffer->SetUploadRingAllocation(mUploadRingFrameIndex, offset, dataSize);
+		else
+			UpdateBuffer(aBuffer, aData, dataSize);
+	}
+
+	void ER_RHI_DX11::UpdateBufferDirect(ER_RHI_DX11_GPUBuffer* aBuffer, const void* aData, int dataSize)
+	{
 		D3D11_MAPPED_SUBRESOURCE mappedResource;
 		ZeroMemory(&mappedResource, sizeof(D3D11_MAPPED_SUBRESOURCE));
-		buffer->Map(this, D3D11_MAP_WRITE_DISCARD, &mappedResource);
+		aBuffer->Map(this, D3D11_MAP_WRITE_DISCARD, &mappedResource);
 		memcpy(mappedResource.pData, aData, dataSize);
-		buffer->Unmap(this);
+		aBuffer->Unmap(this);
+	}
+
+	void ER_RHI_DX11::UploadConstantBufferFromShadowData(ER_RHI_DX11_GPUBuffer* aBuffer)
+	{
+		std::vector<unsigned char>& data = aBuffer->GetUploadRingShadowData();
+
+		UINT64 offset = 0;
+		if (AllocateFromUploadRing(mUploadRingCB, data.data(), data.size(), ER_BitmaskAlign(aBuffer->GetSize(), ER_RHI_UPLOAD_RING_CB_ALIGNMENT), ER_RHI_UPLOAD_RING_CB_ALIGNMENT, offset))
+			aBuffer->SetUploadRingAllocation(mUploadRingFrameIndex, offset, data.size());
+		else
+		{
+			aBuffer->ResetUploadRingAllocation();
+			UpdateBufferDirect(aBuffer, data.data(), static_cast<int>(data.size()));
+		}
+	}
+
+	ID3D11Buffer* ER_RHI_DX11::GetVertexBufferBinding(ER_RHI_GPUBuffer* aBuffer, UINT& outOffset)
+	{
+		if (mUploadRingVB.Buffer && aBuffer->HasUploadRingAllocation(mUploadRingFrameIndex))
+		{
+			outOffset = static_cast<UINT>(aBuffer->GetUploadRingOffset());
+			return mUploadRingVB.Buffer;
+		}
+
+		outOffset = 0;
+		return static_cast<ID3D11Buffer*>(aBuffer->GetBuffer());
+	}
+
+	bool ER_RHI_DX11::FilterSlots(ER_RHI_DX11_BoundSlot* aSlots, const void* const* aObjects, const UINT* aOffsets, const UINT* aExtras, UINT count, UINT& outFirst, UINT& outLast)
+	{
+		UINT first = count;
+		UINT last = 0;
+		for (UINT i = 0; i < count; i++)
+		{
+			if (aSlots[i].Matches(aObjects[i], aOffsets ? aOffsets[i] : 0, aExtras ? aExtras[i] : 0))
+				continue;
+			if (first == count)
+				first = i;
+			last = i;
+		}
+		if (first == count)
+			return false;
+
+		for (UINT i = first; i <= last; i++)
+			aSlots[i].Set(aObjects[i], aOffsets ? aOffsets[i] : 0, aExtras ? aExtras[i] : 0);
+		outFirst = first;
+		outLast = last;
+		return true;
+	}
+
+	void ER_RHI_DX11::CreateUploadRings()
+	{
+		D3D11_BUFFER_DESC ringDesc;
+		ZeroMemory(&ringDesc, sizeof(ringDesc));
+		ringDesc.ByteWidth = ER_RHI_UPLOAD_RING_SIZE;
+		ringDesc.Usage = D3D11_USAGE_DYNAMIC;
+		ringDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+		// vertex buffers can always be mapped with NO_OVERWRITE
+		ringDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+		HRESULT hr;
+		if (FAILED(hr = mDirect3DDevice->CreateBuffer(&ringDesc, nullptr, &mUploadRingVB.Buffer)))
+			throw ER_CoreException("ER_RHI_DX11: Failed to create the upload ring (vertex buffers).", hr);
+		mUploadRingVB.Allocator.Initialize(ER_RHI_UPLOAD_RING_SIZE);
+
+		// constant buffers need D3D11.1 offsetting and NO_OVERWRITE on dynamic constant buffers (driver-dependent on Win7, always there on Win8+)
+		D3D11_FEATURE_DATA_D3D11_OPTIONS options;
+		ZeroMemory(&options, sizeof(options));
+		if (SUCCEEDED(mDirect3DDevice->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options))) &&
+			options.ConstantBufferOffsetting && options.MapNoOverwriteOnDynamicConstantBuffer)
+		{
+			ringDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+			if (FAILED(hr = mDirect3DDevice->CreateBuffer(&ringDesc, nullptr, &mUploadRingCB.Buffer)))
+				throw ER_CoreException("ER_RHI_DX11: Failed to create the upload ring (constant buffers).", hr);
+			mUploadRingCB.Allocator.Initialize(ER_RHI_UPLOAD_RING_SIZE);
+		}
+		else
+			ER_OUTPUT_LOG(ER_Utility::ToWideString("[ER Logger][ER_RHI_DX11] Constant buffer offsetting is not supported, constant buffers will not use the upload ring\n").c_str());
+	}
+
+	bool ER_RHI_DX11::AllocateFromUploadRing(ER_RHI_DX11_UploadRing& aRing, const void* aData, UINT64 aDataSize, UINT64 aAllocationSize, UINT64 aAlignment, UINT64& outOffset)
+	{
+		assert(aDataSize <= aAllocationSize);
+		if (!aRing.Buffer || !aRing.Allocator.Allocate(aAllocationSize, aAlignment, outOffset))
+			return false;
+
+		D3D11_MAPPED_SUBRESOURCE mappedResource;
+		HRESULT hr;
+		if (FAILED(hr = mDirect3DDeviceContext->Map(aRing.Buffer, 0, aRing.IsDiscardedThisFrame ? D3D11_MAP_WRITE_NO_OVERWRITE : D3D11_MAP_WRITE_DISCARD, 0, &mappedResource)))
+			throw ER_CoreException("ER_RHI_DX11: Failed to map the upload ring.", hr);
+		aRing.IsDiscardedThisFrame = true;
+
+		memcpy(static_cast<unsigned char*>(mappedResource.pData) + outOffset, aData, static_cast<size_t>(aDataSize));
+		mDirect3DDeviceContext->Unmap(aRing.Buffer, 0);
+		return true;
+	}
+
+	void ER_RHI_DX11::EndUploadRingsFrame()
+	{
+		ER_RHI_UploadRingStats frameStats;
+		if (mUploadRingCB.Buffer)
+			mUploadRingCB.Allocator.EndFrame(frameStats);
+		if (mUploadRingVB.Buffer)
+			mUploadRingVB.Allocator.EndFrame(frameStats);
+		mUploadRingCB.IsDiscardedThisFrame = false;
+		mUploadRingVB.IsDiscardedThisFrame = false;
+
+		if (PublishUploadRingStats(frameStats))
+			ER_OUTPUT_LOG(ER_Utility::ToWideString("[ER Logger][ER_RHI_DX11] Upload ring overflowed, consider increasing ER_RHI_UPLOAD_RING_SIZE\n").c_str());
 	}
 
 	void ER_RHI_DX11::InitImGui()
@@ -960,6 +1312,7 @@ namespace EveryRay_Core
 	void ER_RHI_DX11::RenderDrawDataImGui(int cmdListIndex)
 	{
 		ImGui_ImplDX11_RenderDrawData(ImGui::GetDrawData());
+		mStateCache.Invalidate(); // the backend sets (and restores) the state directly on the context
 	}
 
 	void ER_RHI_DX11::ShutdownImGui()
@@ -1,11 +1,19 @@
 #pragma once
 #include "..\ER_RHI.h"
+#include "..\ER_RHI_ShaderCache.h"
 
 #include <d3d11_1.h>
 #include <D3DCompiler.h>
 
 #include "imgui_impl_dx11.h"
 
+#define DX11_MAX_BOUND_RENDER_TARGETS_VIEWS 8
+#define DX11_MAX_BOUND_SHADER_RESOURCE_VIEWS 64 
+#define DX11_MAX_BOUND_UNORDERED_ACCESS_VIEWS 8 
+#define DX11_MAX_BOUND_CONSTANT_BUFFERS 8 
+#define DX11_MAX_BOUND_SAMPLERS 8 
+#define DX11_SHADER_STAGES_COUNT 6 // see ER_RHI_SHADER_TYPE
+
 namespace EveryRay_Core
 {
 	class ER_RHI_DX11_InputLayout : public ER_RHI_InputLayout
@@ -17,8 +25,81 @@ namespace EveryRay_Core
 			ReleaseObject(mInputLayout);
 		};
 		ID3D11InputLayout* mInputLayout = nullptr;
+		ER_RHI_ShaderCacheEntryPtr mPendingBytecode; // bytecode of the vertex shader (still compiling) to create mInputLayout from in SetInputLayout()
 	};
 
+	// DX11 can't map a buffer persistently, so every allocation maps the ring with NO_OVERWRITE (DISCARD for the first one in a frame, which renames the memory)
+	struct ER_RHI_DX11_UploadRing
+	{
+		ID3D11Buffer* Buffer = nullptr;
+		ER_RHI_UploadRingAllocator Allocator;
+		bool IsDiscardedThisFrame = false;
+	};
+
+	// One binding point of the immediate context as the RHI last set it
+	struct ER_RHI_DX11_BoundSlot
+	{
+		const void* Object = nullptr; // D3D11 object (view, buffer, state, shader)
+		UINT Offset = 0; // i.e., first constant (upload ring CBs), vertex/index buffer offset, stencil ref, sample mask
+		UINT Extra = 0; // i.e., constants count, stride, index format, topology
+		bool IsKnown = false; // false - the next bind always goes to the context
+
+		bool Matches(const void* aObject, UINT aOffset = 0, UINT aExtra = 0) const { return IsKnown && Object == aObject && Offset == aOffset && Extra == aExtra; }
+		void Set(const void* aObject, UINT aOffset = 0, UINT aExtra = 0) { Object = aObject; Offset = aOffset; Extra = aExtra; IsKnown = true; }
+	};
+
+	// Shadow copy of the immediate context's state: binds that would set the same values again are dropped (see ER_RHI::GetBindingStats()).
+	// Slots are invalidated when the runtime can change them behind our back, i.e., SRVs get unbound when their resources are bound as outputs.
+	struct ER_RHI_DX11_StateCache
+	{
+		ER_RHI_DX11_BoundSlot Shaders[DX11_SHADER_STAGES_COUNT];
+		ER_RHI_DX11_BoundSlot SRVs[DX11_SHADER_STAGES_COUNT][DX11_MAX_BOUND_SHADER_RESOURCE_VIEWS];
+		ER_RHI_DX11_BoundSlot CBs[DX11_SHADER_STAGES_COUNT][DX11_MAX_BOUND_CONSTANT_BUFFERS];
+		ER_RHI_DX11_BoundSlot Samplers[DX11_SHADER_STAGES_COUNT][DX11_MAX_BOUND_SAMPLERS];
+		ER_RHI_DX11_BoundSlot VertexBuffers[ER_RHI_MAX_BOUND_VERTEX_BUFFERS];
+		ER_RHI_DX11_BoundSlot IndexBuffer;
+		ER_RHI_DX11_BoundSlot InputLayout;
+		ER_RHI_DX11_BoundSlot Topology;
+		ER_RHI_DX11_BoundSlot RasterizerState;
+		ER_RHI_DX11_BoundSlot DepthStencilState;
+		ER_RHI_DX11_BoundSlot BlendState;
+		float BlendFactor[4] = {};
+
+		void InvalidateShaderResources()
+		{
+			for (int stage = 0; stage < DX11_SHADER_STAGES_COUNT; stage++)
+				for (int slot = 0; slot < DX11_MAX_BOUND_SHADER_RESOURCE_VIEWS; slot++)
+					SRVs[stage][slot].IsKnown = false;
+		}
+
+		void InvalidateStage(ER_RHI_SHADER_TYPE aShaderType)
+		{
+			Shaders[aShaderType].IsKnown = false;
+			for (int slot = 0; slot < DX11_MAX_BOUND_SHADER_RESOURCE_VIEWS; slot++)
+				SRVs[aShaderType][slot].IsKnown = false;
+			for (int slot = 0; slot < DX11_MAX_BOUND_CONSTANT_BUFFERS; slot++)
+				CBs[aShaderType][slot].IsKnown = false;
+			for (int slot = 0; slot < DX11_MAX_BOUND_SAMPLERS; slot++)
+				Samplers[aShaderType][slot].IsKnown = false;
+		}
+
+		void Invalidate()
+		{
+			for (int stage = 0; stage < DX11_SHADER_STAGES_COUNT; stage++)
+				InvalidateStage(static_cast<ER_RHI_SHADER_TYPE>(stage));
+			for (int slot = 0; slot < ER_RHI_MAX_BOUND_VERTEX_BUFFERS; slot++)
+				VertexBuffers[slot].IsKnown = false;
+			IndexBuffer.IsKnown = false;
+			InputLayout.IsKnown = false;
+			Topology.IsKnown = false;
+			RasterizerState.IsKnown = false;
+			DepthStencilState.IsKnown = false;
+			BlendState.IsKnown = false;
+		}
+	};
+
+	class ER_RHI_DX11_GPUBuffer;
+
 	class ER_RHI_DX11: public ER_RHI
 	{
 	public:
@@ -65,6 +146,7 @@ namespace EveryRay_Core
 		virtual void DrawIndexed(UINT IndexCount) override;
 		virtual void DrawInstanced(UINT VertexCountPerInstance, UINT InstanceCount, UINT StartVertexLocation, UINT StartInstanceLocation) override;
 		virtual void DrawIndexedInstanced(UINT IndexCountPerInstance, UINT InstanceCount, UINT StartIndexLocation, INT BaseVertexLocation, UINT StartInstanceLocation) override;
+		virtual void DrawIndexedInstancedIndirect(ER_RHI_GPUBuffer* aArgsBuffer, UINT aArgsOffset) override;
 		//TODO DrawIndirect
 
 		virtual void Dispatch(UINT ThreadGroupCountX, UINT ThreadGroupCountY, UINT ThreadGroupCountZ) override;
@@ -75,19 +157,21 @@ namespace EveryRay_Core
 
 		virtual void GenerateMips(ER_RHI_GPUTexture* aTexture, ER_RHI_GPUTexture* aSRGBTexture = nullptr) override;
 		virtual void GenerateMipsWithTextureReplacement(ER_RHI_GPUTexture** aTexture, std::function<void(ER_RHI_GPUTexture**)> aReplacementCallback) override {}; //not supported on DX11
+		virtual ER_RHI_GPUTexture* GenerateMipsIntoNewTexture(ER_RHI_GPUTexture* aTexture) override { return nullptr; }; //WIC loaders generate mips on DX11
 		virtual void ReplaceOriginalTexturesWithMipped() override {}; //not supported on DX11
 
 		virtual void PresentGraphics() override;
 		virtual void PresentCompute() override {}; //not supported on DX11
 		
 		virtual bool ProjectCubemapToSH(ER_RHI_GPUTexture* aTexture, UINT order, float* resultR, float* resultG, float* resultB) override;
+		virtual bool ReadGPUTextureToCPU(ER_RHI_GPUTexture* aTexture, UINT aMip, std::vector<XMFLOAT4>& aOutTexels) override;
 		
 		virtual void SaveGPUTextureToFile(ER_RHI_GPUTexture* aTexture, const std::wstring& aPathName) override;
 
 		virtual void SetMainRenderTargets(int cmdListIndex = 0) override;
-		virtual void SetRenderTargets(const std::vector<ER_RHI_GPUTexture*>& aRenderTargets, ER_RHI_GPUTexture* aDepthTarget = nullptr, ER_RHI_GPUTexture* aUAV = nullptr, int rtvArrayIndex = -1) override;
+		virtual void SetRenderTargets(ER_RHI_Span<ER_RHI_GPUTexture*> aRenderTargets, ER_RHI_GPUTexture* aDepthTarget = nullptr, ER_RHI_GPUTexture* aUAV = nullptr, int rtvArrayIndex = -1) override;
 		virtual void SetDepthTarget(ER_RHI_GPUTexture* aDepthTarget) override;
-		virtual void SetRenderTargetFormats(const std::vector<ER_RHI_GPUTexture*>& aRenderTargets, ER_RHI_GPUTexture* aDepthTarget = nullptr) override {}; //not supported on DX11
+		virtual void SetRenderTargetFormats(ER_RHI_Span<ER_RHI_GPUTexture*> aRenderTargets, ER_RHI_GPUTexture* aDepthTarget = nullptr) override {}; //not supported on DX11
 		virtual void SetMainRenderTargetFormats() override {}; //not supported on DX11
 
 		virtual void SetDepthStencilState(ER_RHI_DEPTH_STENCIL_STATE aDS, UINT stencilRef = 0xffffffff) override;
@@ -97,13 +181,13 @@ namespace EveryRay_Core
 		virtual void SetViewport(const ER_RHI_Viewport& aViewport) override;
 		virtual void SetRect(const ER_RHI_Rect& rect) override;
 
-		virtual void SetShaderResources(ER_RHI_SHADER_TYPE aShaderType, const std::vector<ER_RHI_GPUResource*>& aSRVs, UINT startSlot = 0,
+		virtual void SetShaderResources(ER_RHI_SHADER_TYPE aShaderType, ER_RHI_Span<ER_RHI_GPUResource*> aSRVs, UINT startSlot = 0,
 			ER_RHI_GPURootSignature* rs = nullptr, int rootParamIndex = -1, bool isComputeRS = false, bool skipAutomaticTransition = false) override;
-		virtual void SetUnorderedAccessResources(ER_RHI_SHADER_TYPE aShaderType, const std::vector<ER_RHI_GPUResource*>& aUAVs, UINT startSlot = 0,
+		virtual void SetUnorderedAccessResources(ER_RHI_SHADER_TYPE aShaderType, ER_RHI_Span<ER_RHI_GPUResource*> aUAVs, UINT startSlot = 0,
 			ER_RHI_GPURootSignature* rs = nullptr, int rootParamIndex = -1, bool isComputeRS = false, bool skipAutomaticTransition = false) override;
-		virtual void SetConstantBuffers(ER_RHI_SHADER_TYPE aShaderType, const std::vector<ER_RHI_GPUBuffer*>& aCBs, UINT startSlot = 0,
+		virtual void SetConstantBuffers(ER_RHI_SHADER_TYPE aShaderType, ER_RHI_Span<ER_RHI_GPUBuffer*> aCBs, UINT startSlot = 0,
 			ER_RHI_GPURootSignature* rs = nullptr, int rootParamIndex = -1, bool isComputeRS = false) override;
-		virtual void SetSamplers(ER_RHI_SHADER_TYPE aShaderType, const std::vector<ER_RHI_SAMPLER_STATE>& aSamplers, UINT startSlot = 0, ER_RHI_GPURootSignature* rs = nullptr) override;
+		virtual void SetSamplers(ER_RHI_SHADER_TYPE aShaderType, ER_RHI_Span<ER_RHI_SAMPLER_STATE> aSamplers, UINT startSlot = 0, ER_RHI_GPURootSignature* rs = nullptr) override;
 		
 		virtual void SetRootSignature(ER_RHI_GPURootSignature* rs, bool isCompute = false) override {}; //not supported on DX11
 
@@ -111,7 +195,7 @@ namespace EveryRay_Core
 		virtual void SetInputLayout(ER_RHI_InputLayout* aIL) override;
 		virtual void SetEmptyInputLayout() override;
 		virtual void SetIndexBuffer(ER_RHI_GPUBuffer* aBuffer, UINT offset = 0) override;
-		virtual void SetVertexBuffers(const std::vector<ER_RHI_GPUBuffer*>& aVertexBuffers) override;
+		virtual void SetVertexBuffers(ER_RHI_Span<ER_RHI_GPUBuffer*> aVertexBuffers) override;
 
 		virtual void SetTopologyType(ER_RHI_PRIMITIVE_TYPE aType) override;
 		virtual ER_RHI_PRIMITIVE_TYPE GetCurrentTopologyType() override;
@@ -119,22 +203,25 @@ namespace EveryRay_Core
 		virtual void SetGPUDescriptorHeap(ER_RHI_DESCRIPTOR_HEAP_TYPE aType, bool aReset) override {}; //not supported on DX11
 		virtual void SetGPUDescriptorHeapImGui(int cmdListIndex) override {}; //not supported on DX11
 
-		virtual void TransitionResources(const std::vector<ER_RHI_GPUResource*>& aResources, const std::vector<ER_RHI_RESOURCE_STATE>& aStates, int cmdListIndex = 0, bool isCopyQueue = false, int subresourceIndex = -1) override {}; //not supported on DX11
-		virtual void TransitionResources(const std::vector<ER_RHI_GPUResource*>& aResources, ER_RHI_RESOURCE_STATE aState, int cmdListIndex = 0, bool isCopyQueue = false, int subresourceIndex = -1) override {}; //not supported on DX11
+		virtual void TransitionResources(ER_RHI_Span<ER_RHI_GPUResource*> aResources, ER_RHI_Span<ER_RHI_RESOURCE_STATE> aStates, int cmdListIndex = 0, bool isCopyQueue = false, int subresourceIndex = -1) override {}; //not supported on DX11
+		virtual void TransitionResources(ER_RHI_Span<ER_RHI_GPUResource*> aResources, ER_RHI_RESOURCE_STATE aState, int cmdListIndex = 0, bool isCopyQueue = false, int subresourceIndex = -1) override {}; //not supported on DX11
 		virtual void TransitionMainRenderTargetToPresent(int cmdListIndex = 0) override {}; //not supported on DX11
 
 		virtual bool IsPSOReady(const std::string& aName, bool isCompute = false) override { return false; } //not supported on DX11
 		virtual void InitializePSO(const std::string& aName, bool isCompute = false) override {}; //not supported on DX11
 		virtual void SetRootSignatureToPSO(const std::string& aName, ER_RHI_GPURootSignature* rs, bool isCompute = false) override {}; //not supported on DX11
 		virtual void SetTopologyTypeToPSO(const std::string& aName, ER_RHI_PRIMITIVE_TYPE aType) override {}; //not supported on DX11
-		virtual void FinalizePSO(const std::string& aName, bool isCompute = false) override {}; //not supported on DX11
+		virtual ER_RHI_PSO_HANDLE FinalizePSO(const std::string& aName, bool isCompute = false) override { return ER_RHI_INVALID_PSO_HANDLE; }; //not supported on DX11
+		virtual ER_RHI_PSO_HANDLE GetPSOHandle(const std::string& aName, bool isCompute = false) override { return ER_RHI_INVALID_PSO_HANDLE; }; //not supported on DX11
 		virtual void SetPSO(const std::string& aName, bool isCompute = false) override {}; //not supported on DX11
+		virtual void SetPSO(ER_RHI_PSO_HANDLE aHandle, bool isCompute = false) override {}; //not supported on DX11
 		virtual void UnsetPSO()override {}; //not supported on DX11
 
 		virtual void UnbindRenderTargets() override;
 		virtual void UnbindResourcesFromShader(ER_RHI_SHADER_TYPE aShaderType, bool unbindShader = true) override;
 
 		virtual void UpdateBuffer(ER_RHI_GPUBuffer* aBuffer, void* aData, int dataSize, bool updateForAllBackBuffers = false) override;
+		virtual void UpdateBufferTransient(ER_RHI_GPUBuffer* aBuffer, void* aData, int dataSize) override;
 		
 		virtual bool IsHardwareRaytracingSupported() override { return false; }
 		
@@ -161,6 +248,7 @@ namespace EveryRay_Core
 		DXGI_FORMAT GetFormat(ER_RHI_FORMAT aFormat);
 
 		ER_GRAPHICS_API GetAPI() { return mAPI; }
+		virtual ER_RHI_ShaderCache* GetShaderCache() override { return mShaderCache; }
 	private:
 		D3D11_PRIMITIVE_TOPOLOGY GetTopologyType(ER_RHI_PRIMITIVE_TYPE aType);
 		ER_RHI_PRIMITIVE_TYPE GetTopologyType(D3D11_PRIMITIVE_TOPOLOGY aType);
@@ -170,6 +258,16 @@ namespace EveryRay_Core
 		void CreateRasterizerStates();
 		void CreateDepthStencilStates();
 
+		void CreateUploadRings();
+		bool AllocateFromUploadRing(ER_RHI_DX11_UploadRing& aRing, const void* aData, UINT64 aDataSize, UINT64 aAllocationSize, UINT64 aAlignment, UINT64& outOffset);
+		void UploadConstantBufferFromShadowData(ER_RHI_DX11_GPUBuffer* aBuffer); // to the ring or to the buffer's own memory on overflow
+		void UpdateBufferDirect(ER_RHI_DX11_GPUBuffer* aBuffer, const void* aData, int dataSize);
+		void EndUploadRingsFrame();
+		ID3D11Buffer* GetVertexBufferBinding(ER_RHI_GPUBuffer* aBuffer, UINT& outOffset); // own memory or the upload ring (with offset)
+
+		// compares [0, count) with the cache's slots starting at startSlot; returns false if all of them match, otherwise the changed range and updates the cache
+		bool FilterSlots(ER_RHI_DX11_BoundSlot* aSlots, const void* const* aObjects, const UINT* aOffsets, const UINT* aExtras, UINT count, UINT& outFirst, UINT& outLast);
+
 		D3D_FEATURE_LEVEL mFeatureLevel = D3D_FEATURE_LEVEL_11_1;
 		ID3D11Device1* mDirect3DDevice = nullptr;
 		ID3D11DeviceContext1* mDirect3DDeviceContext = nullptr;
@@ -230,5 +328,12 @@ namespace EveryRay_Core
 		ER_RHI_Viewport mMainViewport;
 
 		bool mIsContextReadingBuffer = false;
+
+		ER_RHI_DX11_UploadRing mUploadRingCB; // bound with XXSetConstantBuffers1() (D3D11.1 constant buffer offsetting)
+		ER_RHI_DX11_UploadRing mUploadRingVB; // instance data
+
+		ER_RHI_ShaderCache* mShaderCache = nullptr;
+
+		ER_RHI_DX11_StateCache mStateCache;
 	};
 }
\ No newline at end of file
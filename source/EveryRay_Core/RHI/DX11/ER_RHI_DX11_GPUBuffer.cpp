@@ -30,6 +30,7 @@ namespace EveryRay_Core
 		mFormat = aRHIDX11->GetFormat(format);
 		mStride = byteStride;
 		mByteSize = objectsCount * byteStride;
+		mIsUploadRingConstantBuffer = isDynamic && (bindFlags & ER_BIND_CONSTANT_BUFFER);
 
 		D3D11_BUFFER_DESC buf_desc;
 		buf_desc.ByteWidth = objectsCount * byteStride;
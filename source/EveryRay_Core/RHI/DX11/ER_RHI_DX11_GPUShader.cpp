@@ -32,63 +32,101 @@ namespace EveryRay_Core
 		mShaderType = type;
 
 		assert(aRHI);
-		ER_RHI_DX11* aDX11RHI = static_cast<ER_RHI_DX11*>(aRHI);
-		assert(aDX11RHI);
+		mRHI = static_cast<ER_RHI_DX11*>(aRHI);
+		assert(mRHI && mRHI->GetShaderCache());
 
 		assert(!shaderEntry.empty());
 
-		std::string compilerErrorMessage = "ER_RHI_DX11: Failed to compile blob from shader: " + path + " with shader entry: " + shaderEntry;
-		std::string createErrorMessage = "ER_RHI_DX11: Failed to create shader from blob: " + path;
-
-		ID3DBlob* blob = nullptr;
+		ER_RHI_ShaderCompileRequest request;
+		request.Path = path;
+		request.Entry = shaderEntry;
 		switch (mShaderType)
 		{
 		case ER_VERTEX:
-			if (FAILED(CompileBlob(ER_Utility::GetFilePath(ER_Utility::ToWideString(path)).c_str(), shaderEntry.c_str(), vertexShaderModel.c_str(), &blob)))
-				throw ER_CoreException(compilerErrorMessage.c_str());
-			if (FAILED(aDX11RHI->GetDevice()->CreateVertexShader(blob->GetBufferPointer(), blob->GetBufferSize(), NULL, &mVS)))
-				throw ER_CoreException(createErrorMessage.c_str());
+			request.Profile = vertexShaderModel;
 			break;
 		case ER_PIXEL:
-			if (FAILED(CompileBlob(ER_Utility::GetFilePath(ER_Utility::ToWideString(path)).c_str(), shaderEntry.c_str(), pixelShaderModel.c_str(), &blob)))
-				throw ER_CoreException(compilerErrorMessage.c_str());
-			if (FAILED(aDX11RHI->GetDevice()->CreatePixelShader(blob->GetBufferPointer(), blob->GetBufferSize(), NULL, &mPS)))
-				throw ER_CoreException(createErrorMessage.c_str());
+			request.Profile = pixelShaderModel;
 			break;
 		case ER_COMPUTE:
-			if (FAILED(CompileBlob(ER_Utility::GetFilePath(ER_Utility::ToWideString(path)).c_str(), shaderEntry.c_str(), computeShaderModel.c_str(), &blob)))
-				throw ER_CoreException(compilerErrorMessage.c_str());
-			if (FAILED(aDX11RHI->GetDevice()->CreateComputeShader(blob->GetBufferPointer(), blob->GetBufferSize(), NULL, &mCS)))
-				throw ER_CoreException(createErrorMessage.c_str());
+			request.Profile = computeShaderModel;
 			break;
 		case ER_GEOMETRY:
-			if (FAILED(CompileBlob(ER_Utility::GetFilePath(ER_Utility::ToWideString(path)).c_str(), shaderEntry.c_str(), geometryShaderModel.c_str(), &blob)))
-				throw ER_CoreException(compilerErrorMessage.c_str());
-			if (FAILED(aDX11RHI->GetDevice()->CreateGeometryShader(blob->GetBufferPointer(), blob->GetBufferSize(), NULL, &mGS)))
-				throw ER_CoreException(createErrorMessage.c_str());
+			request.Profile = geometryShaderModel;
 			break;
 		case ER_TESSELLATION_HULL:
-			if (FAILED(CompileBlob(ER_Utility::GetFilePath(ER_Utility::ToWideString(path)).c_str(), shaderEntry.c_str(), hullShaderModel.c_str(), &blob)))
-				throw ER_CoreException(compilerErrorMessage.c_str());
-			if (FAILED(aDX11RHI->GetDevice()->CreateHullShader(blob->GetBufferPointer(), blob->GetBufferSize(), NULL, &mHS)))
-				throw ER_CoreException(createErrorMessage.c_str());
+			request.Profile = hullShaderModel;
 			break;
 		case ER_TESSELLATION_DOMAIN:
-			if (FAILED(CompileBlob(ER_Utility::GetFilePath(ER_Utility::ToWideString(path)).c_str(), shaderEntry.c_str(), domainShaderModel.c_str(), &blob)))
-				throw ER_CoreException(compilerErrorMessage.c_str());
-			if (FAILED(aDX11RHI->GetDevice()->CreateDomainShader(blob->GetBufferPointer(), blob->GetBufferSize(), NULL, &mDS)))
-				throw ER_CoreException(createErrorMessage.c_str());
+			request.Profile = domainShaderModel;
 			break;
 		}
+		request.Defines.push_back(std::make_pair("EXAMPLE_DEFINE", "1"));
+		request.Flags = D3DCOMPILE_ENABLE_STRICTNESS;
+#if defined( DEBUG ) || defined( _DEBUG )
+		request.Flags |= D3DCOMPILE_DEBUG;
+#endif
+
+		// compilation runs on the job system, the shader object (and the input layout) are created on the first use
+		mPendingBytecode = mRHI->GetShaderCache()->Request(request);
 
 		if (aIL && mShaderType == ER_VERTEX)
-			aDX11RHI->CreateInputLayout(aIL, aIL->mInputElementDescriptions, aIL->mInputElementDescriptionCount, blob->GetBufferPointer(), static_cast<UINT>(blob->GetBufferSize()));
+		{
+			ER_RHI_DX11_InputLayout* aDX11_IL = static_cast<ER_RHI_DX11_InputLayout*>(aIL);
+			ReleaseObject(aDX11_IL->mInputLayout);
+			aDX11_IL->mPendingBytecode = mPendingBytecode;
+		}
+	}
+
+	void ER_RHI_DX11_GPUShader::Resolve()
+	{
+		if (!mPendingBytecode)
+			return;
+
+		mRHI->GetShaderCache()->Wait(*mPendingBytecode);
+		if (!mPendingBytecode->IsValid())
+			throw ER_CoreException(mPendingBytecode->GetErrors().c_str());
 
-		blob->Release();
+		const std::vector<char>& bytecode = mPendingBytecode->GetBytecode();
+		const std::string createErrorMessage = "ER_RHI_DX11: Failed to create shader from blob";
+		HRESULT hr = S_OK;
+		switch (mShaderType)
+		{
+		case ER_VERTEX:
+			ReleaseObject(mVS);
+			hr = mRHI->GetDevice()->CreateVertexShader(bytecode.data(), bytecode.size(), NULL, &mVS);
+			break;
+		case ER_PIXEL:
+			ReleaseObject(mPS);
+			hr = mRHI->GetDevice()->CreatePixelShader(bytecode.data(), bytecode.size(), NULL, &mPS);
+			break;
+		case ER_COMPUTE:
+			ReleaseObject(mCS);
+			hr = mRHI->GetDevice()->CreateComputeShader(bytecode.data(), bytecode.size(), NULL, &mCS);
+			break;
+		case ER_GEOMETRY:
+			ReleaseObject(mGS);
+			hr = mRHI->GetDevice()->CreateGeometryShader(bytecode.data(), bytecode.size(), NULL, &mGS);
+			break;
+		case ER_TESSELLATION_HULL:
+			ReleaseObject(mHS);
+			hr = mRHI->GetDevice()->CreateHullShader(bytecode.data(), bytecode.size(), NULL, &mHS);
+			break;
+		case ER_TESSELLATION_DOMAIN:
+			ReleaseObject(mDS);
+			hr = mRHI->GetDevice()->CreateDomainShader(bytecode.data(), bytecode.size(), NULL, &mDS);
+			break;
+		}
+		if (FAILED(hr))
+			throw ER_CoreException(createErrorMessage.c_str());
+
+		mPendingBytecode.reset();
 	}
 
 	void* ER_RHI_DX11_GPUShader::GetShaderObject()
 	{
+		Resolve();
+
 		switch (mShaderType)
 		{
 		case ER_VERTEX:
@@ -106,45 +144,33 @@ namespace EveryRay_Core
 		}
 	}
 
-	HRESULT ER_RHI_DX11_GPUShader::CompileBlob(_In_ LPCWSTR srcFile, _In_ LPCSTR entryPoint, _In_ LPCSTR profile, _Outptr_ ID3DBlob** blob)
+	bool ER_RHI_DX11_GPUShader::CompileBytecode(const ER_RHI_ShaderCompileRequest& aRequest, std::vector<char>& outBytecode, std::string& outErrors)
 	{
-		if (!srcFile || !entryPoint || !profile || !blob)
-			return E_INVALIDARG;
-
-		*blob = nullptr;
-
-		UINT flags = D3DCOMPILE_ENABLE_STRICTNESS;
-#if defined( DEBUG ) || defined( _DEBUG )
-		flags |= D3DCOMPILE_DEBUG;
-#endif
-
-		const D3D_SHADER_MACRO defines[] =
-		{
-			"EXAMPLE_DEFINE", "1",
-			NULL, NULL
-		};
+		std::vector<D3D_SHADER_MACRO> defines;
+		for (auto& define : aRequest.Defines)
+			defines.push_back({ define.first.c_str(), define.second.c_str() });
+		defines.push_back({ NULL, NULL });
 
 		ID3DBlob* shaderBlob = nullptr;
 		ID3DBlob* errorBlob = nullptr;
-		HRESULT hr = D3DCompileFromFile(srcFile, defines, D3D_COMPILE_STANDARD_FILE_INCLUDE,
-			entryPoint, profile,
-			flags, 0, &shaderBlob, &errorBlob);
+		HRESULT hr = D3DCompileFromFile(ER_Utility::GetFilePath(ER_Utility::ToWideString(aRequest.Path)).c_str(), defines.data(), D3D_COMPILE_STANDARD_FILE_INCLUDE,
+			aRequest.Entry.c_str(), aRequest.Profile.c_str(),
+			aRequest.Flags, 0, &shaderBlob, &errorBlob);
+		if (errorBlob)
+		{
+			outErrors.assign(static_cast<const char*>(errorBlob->GetBufferPointer()), errorBlob->GetBufferSize());
+			OutputDebugStringA(outErrors.c_str());
+			errorBlob->Release();
+		}
 		if (FAILED(hr))
 		{
-			if (errorBlob)
-			{
-				OutputDebugStringA((char*)errorBlob->GetBufferPointer());
-				errorBlob->Release();
-			}
-
-			if (shaderBlob)
-				shaderBlob->Release();
-
-			return hr;
+			ReleaseObject(shaderBlob);
+			return false;
 		}
 
-		*blob = shaderBlob;
-
-		return hr;
+		const char* data = static_cast<const char*>(shaderBlob->GetBufferPointer());
+		outBytecode.assign(data, data + shaderBlob->GetBufferSize());
+		shaderBlob->Release();
+		return true;
 	}
 }
\ No newline at end of file
@@ -12,8 +12,13 @@ namespace EveryRay_Core
 		virtual void CompileShader(ER_RHI* aRHI, const std::string& path, const std::string& shaderEntry, ER_RHI_SHADER_TYPE type, ER_RHI_InputLayout* aIL = nullptr) override;
 		virtual void* GetShaderObject() override;
 
+		// ER_RHI_ShaderCompileFunc of ER_RHI_DX11's shader cache (runs on the job system's threads)
+		static bool CompileBytecode(const ER_RHI_ShaderCompileRequest& aRequest, std::vector<char>& outBytecode, std::string& outErrors);
 	private:
-		HRESULT CompileBlob(_In_ LPCWSTR srcFile, _In_ LPCSTR entryPoint, _In_ LPCSTR profile, _Outptr_ ID3DBlob** blob);
+		void Resolve(); // waits for the bytecode and creates the shader object
+
+		ER_RHI_DX11* mRHI = nullptr;
+		ER_RHI_ShaderCacheEntryPtr mPendingBytecode;
 
 		ID3D11VertexShader* mVS = nullptr;
 		ID3D11GeometryShader* mGS = nullptr;
@@ -10,38 +10,55 @@ namespace EveryRay_Core
 	}
 
 	ER_RHI_DX11_GPUTexture::~ER_RHI_DX11_GPUTexture()
+	{
+		ReleaseResources();
+	}
+
+	// Also called before loading a texture into an existing object (i.e., a light probe's cubemap replaced by its baked file), so nothing is leaked
+	void ER_RHI_DX11_GPUTexture::ReleaseResources()
 	{
 		ReleaseObject(mSRV);
 		ReleaseObject(mTexture2D);
 		ReleaseObject(mTexture3D);
 
-		if (mIsLoadedFromFile)
-			return;
-
-		if (mIsDepthStencil)
+		if (!mIsLoadedFromFile)
 		{
-			ReleaseObject(mDSV);
-			ReleaseObject(mDSV_ReadOnly);
-		}
+			if (mIsDepthStencil)
+			{
+				ReleaseObject(mDSV);
+				ReleaseObject(mDSV_ReadOnly);
+			}
 
-		if (mBindFlags & D3D11_BIND_RENDER_TARGET)
-		{
-			for (UINT i = 0; i < mArraySize * mMipLevels; i++)
+			if (mBindFlags & D3D11_BIND_RENDER_TARGET)
 			{
-				ReleaseObject(mRTVs[i]);
+				for (UINT i = 0; i < mArraySize * mMipLevels; i++)
+				{
+					ReleaseObject(mRTVs[i]);
+				}
 			}
-		}
-		if (mBindFlags & D3D11_BIND_UNORDERED_ACCESS)
-		{
-			for (UINT i = 0; i < mMipLevels; i++)
+			if (mBindFlags & D3D11_BIND_UNORDERED_ACCESS)
 			{
-				ReleaseObject(mUAVs[i]);
+				for (UINT i = 0; i < mMipLevels; i++)
+				{
+					ReleaseObject(mUAVs[i]);
+				}
 			}
 		}
+		if (mRTVs)
+		{
+			free(mRTVs);
+			mRTVs = nullptr;
+		}
+		if (mUAVs)
+		{
+			free(mUAVs);
+			mUAVs = nullptr;
+		}
 
 		mMipLevels = 0;
 		mBindFlags = 0;
 		mArraySize = 0;
+		mIsDepthStencil = false;
 	}
 
 	void ER_RHI_DX11_GPUTexture::CreateGPUTextureResource(ER_RHI* aRHI, UINT width, UINT height, UINT samples, ER_RHI_FORMAT format, ER_RHI_BIND_FLAG bindFlags /*= ER_BIND_SHADER_RESOURCE | ER_BIND_RENDER_TARGET*/, int mip /*= 1*/, int depth /*= -1*/, int arraySize /*= 1*/, bool isCubemap /*= false*/, int cubemapArraySize /*= -1*/)
@@ -339,6 +356,7 @@ namespace EveryRay_Core
 		ID3D11DeviceContext1* context = aRHIDX11->GetContext();
 		assert(context);
 
+		ReleaseResources();
 		mIsLoadedFromFile = true;
 
 		std::wstring originalPath = aPath;
@@ -411,6 +429,42 @@ namespace EveryRay_Core
 		resourceTex->Release();
 	}
 
+	// DDS: no context is passed to the loader (no mips autogen), so it only uses the device and can be called from multiple threads
+	// WIC: mips are generated with the immediate context, so main thread only
+	void ER_RHI_DX11_GPUTexture::CreateGPUTextureResource(ER_RHI* aRHI, const UINT8* aData, UINT64 aDataSize, bool* statusFlag)
+	{
+		assert(aRHI && aData);
+		ER_RHI_DX11* aRHIDX11 = static_cast<ER_RHI_DX11*>(aRHI);
+		ID3D11Device* device = aRHIDX11->GetDevice();
+		assert(device);
+
+		ReleaseResources();
+		mIsLoadedFromFile = true;
+
+		const bool isDDS = aDataSize >= 4 && memcmp(aData, "DDS ", 4) == 0;
+		ID3D11Resource* resourceTex = NULL;
+		HRESULT hr = isDDS ?
+			DirectX::CreateDDSTextureFromMemory(device, aData, static_cast<size_t>(aDataSize), &resourceTex, &mSRV) :
+			DirectX::CreateWICTextureFromMemory(device, aRHIDX11->GetContext(), aData, static_cast<size_t>(aDataSize), &resourceTex, &mSRV);
+		if (FAILED(hr))
+		{
+			ER_OUTPUT_LOG(L"[ER Logger][ER_RHI_DX11_GPUTexture] Failed to load texture from memory. \n");
+			if (statusFlag)
+				*statusFlag = false;
+			return;
+		}
+
+		if (FAILED(resourceTex->QueryInterface(IID_ID3D11Texture2D, (void**)&mTexture2D)))
+		{
+			resourceTex->Release();
+			throw EveryRay_Core::ER_CoreException("ER_RHI_DX11: Could not cast loaded texture resource to Texture2D. Maybe wrong dimension?");
+		}
+		if (statusFlag)
+			*statusFlag = true;
+
+		resourceTex->Release();
+	}
+
 	void ER_RHI_DX11_GPUTexture::LoadFallbackTexture(ER_RHI* aRHI, ID3D11Resource** texture, ID3D11ShaderResourceView** textureView)
 	{
 		assert(aRHI);
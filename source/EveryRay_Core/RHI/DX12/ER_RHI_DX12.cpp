@@ -33,6 +33,11 @@ namespace EveryRay_Core
 
 		ResetReplacementMippedTexturesPool();
 
+		mGraphicsPSONames.clear();
+		mComputePSONames.clear();
+		DeleteObject(mPSOCache);
+		DeleteObject(mShaderCache);
+
 		DeleteObject(mDescriptorHeapManager);
 	}
 
@@ -263,6 +268,11 @@ namespace EveryRay_Core
 		CreateDepthStencilStates();
 		CreateBlendStates();
 
+		DeleteObject(mPSOCache);
+		mPSOCache = new ER_RHI_DX12_PSOCache(mDevice.Get());
+		if (!mShaderCache)
+			mShaderCache = new ER_RHI_ShaderCache("DX12", ER_RHI_DX12_GPUShader::CompileBytecode);
+
 		ResetDescriptorManager();
 
 		//clear uav state and rs
@@ -317,6 +327,8 @@ namespace EveryRay_Core
 			}
 		}
 
+		CreateUploadRing();
+
 		return true;
 	}
 
@@ -432,6 +444,8 @@ namespace EveryRay_Core
 			std::string message = "ER_RHI_DX12:: Could not Reset() command list (graphics) " + std::to_string(index);
 			throw ER_CoreException(message.c_str());
 		}
+		mCurrentSetPipelineState = nullptr;
+		mStateCache.Invalidate();
 	}
 
 	void ER_RHI_DX12::EndGraphicsCommandList(int index)
@@ -748,6 +762,33 @@ namespace EveryRay_Core
 		mCommandListGraphics[mCurrentGraphicsCommandListIndex]->DrawIndexedInstanced(IndexCountPerInstance, InstanceCount, StartIndexLocation, BaseVertexLocation, StartInstanceLocation);
 	}
 
+	void ER_RHI_DX12::DrawIndexedInstancedIndirect(ER_RHI_GPUBuffer* aArgsBuffer, UINT aArgsOffset)
+	{
+		assert(mCurrentGraphicsCommandListIndex > -1);
+		assert(aArgsBuffer);
+		assert(aArgsOffset + sizeof(ER_RHI_DRAW_INDEXED_INSTANCED_ARGS) <= static_cast<UINT>(aArgsBuffer->GetSize()));
+
+		if (!mDrawIndexedIndirectCommandSignature)
+		{
+			D3D12_INDIRECT_ARGUMENT_DESC argumentDesc = {};
+			argumentDesc.Type = D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED;
+
+			D3D12_COMMAND_SIGNATURE_DESC signatureDesc = {};
+			signatureDesc.ByteStride = sizeof(D3D12_DRAW_INDEXED_ARGUMENTS);
+			signatureDesc.NumArgumentDescs = 1;
+			signatureDesc.pArgumentDescs = &argumentDesc;
+			if (FAILED(mDevice->CreateCommandSignature(&signatureDesc, nullptr, IID_PPV_ARGS(&mDrawIndexedIndirectCommandSignature))))
+				throw ER_CoreException("ER_RHI_DX12: Could not create a command signature for indirect indexed draws");
+		}
+
+		ER_RHI_DX12_GPUBuffer* argsBuffer = static_cast<ER_RHI_DX12_GPUBuffer*>(aArgsBuffer);
+		if (argsBuffer->GetCurrentState() != ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_INDIRECT_ARGUMENT)
+			TransitionResources({ static_cast<ER_RHI_GPUResource*>(aArgsBuffer) }, { ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_INDIRECT_ARGUMENT }, mCurrentGraphicsCommandListIndex);
+
+		mCommandListGraphics[mCurrentGraphicsCommandListIndex]->ExecuteIndirect(mDrawIndexedIndirectCommandSignature.Get(), 1,
+			static_cast<ID3D12Resource*>(argsBuffer->GetResource()), aArgsOffset, nullptr, 0);
+	}
+
 	void ER_RHI_DX12::Dispatch(UINT ThreadGroupCountX, UINT ThreadGroupCountY, UINT ThreadGroupCountZ)
 	{
 		assert(mCurrentGraphicsCommandListIndex > -1);
@@ -859,7 +900,20 @@ namespace EveryRay_Core
 		if (mGenerateMipsWithReplacementCurrentTextureIndexInPool > DX12_MAX_GENERATE_MIPS_TEXTURES_IN_POOL)
 			throw ER_CoreException("ER_RHI_DX12:: There is no space left in the temp texture pool for mip generation! Bump DX12_MAX_GENERATE_MIPS_TEXTURES_IN_POOL.");
 
-		ER_RHI_DX12_GPUTexture* dx12Texture = static_cast<ER_RHI_DX12_GPUTexture*>(*aTexture);
+		assert(!mGenerateMipsWithReplacementReadyTexturesPool[mGenerateMipsWithReplacementCurrentTextureIndexInPool]);
+		mGenerateMipsWithReplacementReadyTexturesPool[mGenerateMipsWithReplacementCurrentTextureIndexInPool] = GenerateMipsIntoNewTexture(*aTexture);
+
+		mGenerateMipsWithReplacementCallbacks[mGenerateMipsWithReplacementCurrentTextureIndexInPool] = aReplacementCallback;
+		mGenerateMipsWithReplacementCurrentTextureIndexInPool++;
+		// we delete the original textures and replace them with mipped in ReplaceOriginalTexturesWithMipped() (we can't delete before flushing the gfx queue)
+	}
+
+	ER_RHI_GPUTexture* ER_RHI_DX12::GenerateMipsIntoNewTexture(ER_RHI_GPUTexture* aTexture)
+	{
+		if (aTexture->GetMips() > 1) //probably the texture already has mips
+			return nullptr;
+
+		ER_RHI_DX12_GPUTexture* dx12Texture = static_cast<ER_RHI_DX12_GPUTexture*>(aTexture);
 		assert(dx12Texture);
 
 		bool isSRGB = IsFormatSRGB(dx12Texture->GetFormat());
@@ -869,22 +923,19 @@ namespace EveryRay_Core
 		else
 			newFormat = ChangeFormatToUncompressed(dx12Texture->GetFormat());
 
-		// create new texture with empty mips from the pool
+		// create new texture with empty mips
 		std::wstring name = dx12Texture->GetDebugName() + L" + mip maps";
-		assert(!mGenerateMipsWithReplacementReadyTexturesPool[mGenerateMipsWithReplacementCurrentTextureIndexInPool]);
-		mGenerateMipsWithReplacementReadyTexturesPool[mGenerateMipsWithReplacementCurrentTextureIndexInPool] = CreateGPUTexture(name);
-		static_cast<ER_RHI_DX12_GPUTexture*>(mGenerateMipsWithReplacementReadyTexturesPool[mGenerateMipsWithReplacementCurrentTextureIndexInPool])->CreateSimpleGPUTexture2DResource(this, dx12Texture->GetWidth(), dx12Texture->GetHeight(), newFormat,
+		ER_RHI_GPUTexture* mippedTexture = CreateGPUTexture(name);
+		static_cast<ER_RHI_DX12_GPUTexture*>(mippedTexture)->CreateSimpleGPUTexture2DResource(this, dx12Texture->GetWidth(), dx12Texture->GetHeight(), newFormat,
 			ER_RHI_BIND_FLAG::ER_BIND_SHADER_RESOURCE | ER_RHI_BIND_FLAG::ER_BIND_UNORDERED_ACCESS, dx12Texture->GetCalculatedMipCount());
 
 		// copy from main texture to 0 mip of new texture (if srgb, then the shader will write into mip 0)
 		if (!isSRGB)
-			CopyGPUTextureSubresourceRegion(mGenerateMipsWithReplacementReadyTexturesPool[mGenerateMipsWithReplacementCurrentTextureIndexInPool], 0, 0, 0, 0, *aTexture, 0);
+			CopyGPUTextureSubresourceRegion(mippedTexture, 0, 0, 0, 0, aTexture, 0);
 		// generate the mip chain in the new texture (read from original texture in the compute shader if sRGB)
-		GenerateMips(mGenerateMipsWithReplacementReadyTexturesPool[mGenerateMipsWithReplacementCurrentTextureIndexInPool], isSRGB ? *aTexture : nullptr);
+		GenerateMips(mippedTexture, isSRGB ? aTexture : nullptr);
 
-		mGenerateMipsWithReplacementCallbacks[mGenerateMipsWithReplacementCurrentTextureIndexInPool] = aReplacementCallback;
-		mGenerateMipsWithReplacementCurrentTextureIndexInPool++;
-		// we delete the original textures and replace them with mipped in ReplaceOriginalTexturesWithMipped() (we can't delete before flushing the gfx queue)
+		return mippedTexture;
 	}
 
 	// Running the callbacks from all systems/objects that requested to generate mips with replacement instead of their original non-mip textures
@@ -929,6 +980,10 @@ namespace EveryRay_Core
 			// Set the fence value for the next frame.
 			mFenceValuesGraphics[mBackBufferIndex] = currentFenceValue + 1;
 
+			// GPU is done with the frame that used this back buffer, so is its segment of the upload ring
+			EndUploadRingFrame();
+			PublishBindingStats();
+
 			if (!mDXGIFactory->IsCurrent())
 			{
 				if (FAILED(CreateDXGIFactory2(mDXGIFactoryFlags, IID_PPV_ARGS(mDXGIFactory.ReleaseAndGetAddressOf()))))
@@ -955,6 +1010,113 @@ namespace EveryRay_Core
 		return false;
 	}
 
+	// Synchronous (like DirectX::CaptureTexture() on DX11): the copy into a readback buffer is recorded into the current graphics command list,
+	// which is submitted and waited for. The list is reopened afterwards with the same descriptor heap, so call this between passes.
+	bool ER_RHI_DX12::ReadGPUTextureToCPU(ER_RHI_GPUTexture* aTexture, UINT aMip, std::vector<XMFLOAT4>& aOutTexels)
+	{
+		assert(aTexture);
+
+		ER_RHI_DX12_GPUTexture* tex = static_cast<ER_RHI_DX12_GPUTexture*>(aTexture);
+		assert(tex);
+
+		ID3D12Resource* resource = static_cast<ID3D12Resource*>(tex->GetResource());
+		if (!resource)
+			return false;
+
+		const D3D12_RESOURCE_DESC desc = resource->GetDesc();
+		if (desc.Dimension != D3D12_RESOURCE_DIMENSION_TEXTURE2D || desc.SampleDesc.Count > 1 || aMip >= desc.MipLevels)
+			return false;
+
+		// footprints of the mip in every array slice (i.e., cubemap faces), one after another in the readback buffer
+		const UINT arraySize = desc.DepthOrArraySize;
+		std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> footprints(arraySize);
+		std::vector<UINT> rowsCounts(arraySize);
+		UINT64 readbackSize = 0;
+		for (UINT item = 0; item < arraySize; item++)
+		{
+			UINT64 rowSize = 0;
+			UINT64 subresourceSize = 0;
+			mDevice->GetCopyableFootprints(&desc, D3D12CalcSubresource(aMip, item, 0, desc.MipLevels, arraySize), 1, readbackSize, &footprints[item], &rowsCounts[item], &rowSize, &subresourceSize);
+			readbackSize = ER_DivideByMultiple(readbackSize + subresourceSize, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT) * D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT;
+		}
+
+		ComPtr<ID3D12Resource> readbackBuffer;
+		if (FAILED(mDevice->CreateCommittedResource(&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_READBACK), D3D12_HEAP_FLAG_NONE, &CD3DX12_RESOURCE_DESC::Buffer(readbackSize),
+			D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&readbackBuffer))))
+			return false;
+
+		const bool isCommandListOpen = mCurrentGraphicsCommandListIndex > -1;
+		const int cmdListIndex = isCommandListOpen ? mCurrentGraphicsCommandListIndex : 0;
+		if (!isCommandListOpen)
+		{
+			WaitForGpuOnGraphicsFence(); // the allocator of the list can still be in use by the GPU
+			BeginGraphicsCommandList(cmdListIndex);
+		}
+
+		const ER_RHI_RESOURCE_STATE oldState = tex->GetCurrentState();
+		TransitionResources({ static_cast<ER_RHI_GPUResource*>(aTexture) }, ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_COPY_SOURCE, cmdListIndex);
+		for (UINT item = 0; item < arraySize; item++)
+		{
+			CD3DX12_TEXTURE_COPY_LOCATION destination(readbackBuffer.Get(), footprints[item]);
+			CD3DX12_TEXTURE_COPY_LOCATION source(resource, D3D12CalcSubresource(aMip, item, 0, desc.MipLevels, arraySize));
+			mCommandListGraphics[cmdListIndex]->CopyTextureRegion(&destination, 0, 0, 0, &source, nullptr);
+		}
+		TransitionResources({ static_cast<ER_RHI_GPUResource*>(aTexture) }, oldState, cmdListIndex);
+
+		EndGraphicsCommandList(cmdListIndex);
+		ExecuteCommandLists(cmdListIndex);
+		WaitForGpuOnGraphicsFence();
+
+		if (isCommandListOpen)
+		{
+			BeginGraphicsCommandList(cmdListIndex);
+			SetGPUDescriptorHeap(ER_RHI_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, false);
+		}
+
+		UINT8* readbackData = nullptr;
+		CD3DX12_RANGE readRange(0, static_cast<SIZE_T>(readbackSize));
+		if (FAILED(readbackBuffer->Map(0, &readRange, reinterpret_cast<void**>(&readbackData))))
+			return false;
+
+		const size_t width = footprints[0].Footprint.Width;
+		const size_t height = footprints[0].Footprint.Height;
+		aOutTexels.resize(width * height * arraySize);
+
+		bool isConverted = true;
+		for (UINT item = 0; item < arraySize && isConverted; item++)
+		{
+			DirectX::Image slice = {};
+			slice.width = width;
+			slice.height = height;
+			slice.format = desc.Format;
+			slice.rowPitch = footprints[item].Footprint.RowPitch;
+			slice.slicePitch = slice.rowPitch * rowsCounts[item];
+			slice.pixels = readbackData + footprints[item].Offset;
+
+			const DirectX::Image* image = &slice;
+			DirectX::ScratchImage convertedImage;
+			if (desc.Format != DXGI_FORMAT_R32G32B32A32_FLOAT)
+			{
+				HRESULT hr = DirectX::IsCompressed(desc.Format) ?
+					DirectX::Decompress(slice, DXGI_FORMAT_R32G32B32A32_FLOAT, convertedImage) :
+					DirectX::Convert(slice, DXGI_FORMAT_R32G32B32A32_FLOAT, DirectX::TEX_FILTER_DEFAULT, DirectX::TEX_THRESHOLD_DEFAULT, convertedImage);
+				isConverted = SUCCEEDED(hr) && convertedImage.GetImage(0, 0, 0);
+				if (isConverted)
+					image = convertedImage.GetImage(0, 0, 0);
+			}
+
+			if (isConverted)
+			{
+				for (size_t y = 0; y < height; y++)
+					memcpy(&aOutTexels[(item * height + y) * width], image->pixels + y * image->rowPitch, width * sizeof(XMFLOAT4));
+			}
+		}
+
+		CD3DX12_RANGE writtenRange(0, 0);
+		readbackBuffer->Unmap(0, &writtenRange);
+		return isConverted;
+	}
+
 	void ER_RHI_DX12::SaveGPUTextureToFile(ER_RHI_GPUTexture* aTexture, const std::wstring& aPathName)
 	{
 		//TODO
@@ -965,7 +1127,7 @@ namespace EveryRay_Core
 		mCommandListGraphics[cmdListIndex]->OMSetRenderTargets(1, &GetMainRenderTargetView(), false, &GetMainDepthStencilView());
 	}
 
-	void ER_RHI_DX12::SetRenderTargets(const std::vector<ER_RHI_GPUTexture*>& aRenderTargets, ER_RHI_GPUTexture* aDepthTarget /*= nullptr*/, ER_RHI_GPUTexture* aUAV /*= nullptr*/, int rtvArrayIndex)
+	void ER_RHI_DX12::SetRenderTargets(ER_RHI_Span<ER_RHI_GPUTexture*> aRenderTargets, ER_RHI_GPUTexture* aDepthTarget /*= nullptr*/, ER_RHI_GPUTexture* aUAV /*= nullptr*/, int rtvArrayIndex)
 	{
 		assert(mCurrentGraphicsCommandListIndex > -1);
 		if (!aUAV)
@@ -978,7 +1140,8 @@ namespace EveryRay_Core
 
 			D3D12_CPU_DESCRIPTOR_HANDLE rtvHandles[DX12_MAX_BOUND_RENDER_TARGETS_VIEWS] = {};
 			UINT rtCount = static_cast<UINT>(aRenderTargets.size());
-			std::vector<ER_RHI_GPUResource*> resources(rtCount);
+			ER_RHI_GPUResource* resources[DX12_MAX_BOUND_RENDER_TARGETS_VIEWS + 1] = {}; // + depth
+			ER_RHI_RESOURCE_STATE transitions[DX12_MAX_BOUND_RENDER_TARGETS_VIEWS + 1] = {};
 			for (UINT i = 0; i < rtCount; i++)
 			{
 				assert(aRenderTargets[i]);
@@ -988,24 +1151,21 @@ namespace EveryRay_Core
 					rtvHandles[i] = static_cast<ER_RHI_DX12_GPUTexture*>(aRenderTargets[i])->GetRTVHandle().GetCPUHandle();
 
 				resources[i] = static_cast<ER_RHI_GPUResource*>(aRenderTargets[i]);
+				transitions[i] = ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_RENDER_TARGET;
 			}
 
 			if (aDepthTarget)
 			{
 				D3D12_CPU_DESCRIPTOR_HANDLE dsvHandle = static_cast<ER_RHI_DX12_GPUTexture*>(aDepthTarget)->GetDSVHandle().GetCPUHandle();
 
-				std::vector<ER_RHI_RESOURCE_STATE> transitions(rtCount);
-				for (UINT i = 0; i < rtCount; i++)
-					transitions[i] = ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_RENDER_TARGET;
-
-				resources.push_back(static_cast<ER_RHI_GPUResource*>(aDepthTarget));
-				transitions.push_back(ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_DEPTH_WRITE);
-				TransitionResources(resources, transitions);
+				resources[rtCount] = static_cast<ER_RHI_GPUResource*>(aDepthTarget);
+				transitions[rtCount] = ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_DEPTH_WRITE;
+				TransitionResources(ER_RHI_Span<ER_RHI_GPUResource*>(resources, rtCount + 1), ER_RHI_Span<ER_RHI_RESOURCE_STATE>(transitions, rtCount + 1));
 				mCommandListGraphics[mCurrentGraphicsCommandListIndex]->OMSetRenderTargets(rtCount, rtvHandles, FALSE, &dsvHandle);
 			}
 			else
 			{
-				TransitionResources(resources, ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_RENDER_TARGET);
+				TransitionResources(ER_RHI_Span<ER_RHI_GPUResource*>(resources, rtCount), ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_RENDER_TARGET);
 				mCommandListGraphics[mCurrentGraphicsCommandListIndex]->OMSetRenderTargets(rtCount, rtvHandles, FALSE, NULL);
 			}
 
@@ -1028,20 +1188,21 @@ namespace EveryRay_Core
 		mCommandListGraphics[mCurrentGraphicsCommandListIndex]->OMSetRenderTargets(0, nullptr, FALSE, &dsvHandle);
 	}
 
-	void ER_RHI_DX12::SetRenderTargetFormats(const std::vector<ER_RHI_GPUTexture*>& aRenderTargets, ER_RHI_GPUTexture* aDepthTarget /*= nullptr*/)
+	void ER_RHI_DX12::SetRenderTargetFormats(ER_RHI_Span<ER_RHI_GPUTexture*> aRenderTargets, ER_RHI_GPUTexture* aDepthTarget /*= nullptr*/)
 	{
 		if (mCurrentPSOState == ER_RHI_DX12_PSO_STATE::COMPUTE)
 			return;
 
 		assert(mCurrentPSOState == ER_RHI_DX12_PSO_STATE::GRAPHICS);
 
-		ER_RHI_DX12_GraphicsPSO& pso = mGraphicsPSONames.at(mCurrentGraphicsPSOName);
+		assert(mCurrentGraphicsPSO);
+		ER_RHI_DX12_GraphicsPSO& pso = *mCurrentGraphicsPSO;
 		int rtCount = static_cast<int>(aRenderTargets.size());
-		assert(rtCount <= 8);
+		assert(rtCount <= DX12_MAX_BOUND_RENDER_TARGETS_VIEWS);
 
-		std::vector<DXGI_FORMAT> formats;
+		DXGI_FORMAT formats[DX12_MAX_BOUND_RENDER_TARGETS_VIEWS] = {};
 		for (int i = 0; i < rtCount; i++)
-			formats.push_back(static_cast<ER_RHI_DX12_GPUTexture*>(aRenderTargets[i])->GetFormat());
+			formats[i] = static_cast<ER_RHI_DX12_GPUTexture*>(aRenderTargets[i])->GetFormat();
 		pso.SetRenderTargetFormats(rtCount, rtCount > 0 ? &formats[0] : nullptr, aDepthTarget ? static_cast<ER_RHI_DX12_GPUTexture*>(aDepthTarget)->GetFormat() : DXGI_FORMAT_UNKNOWN);
 	}
 
@@ -1049,7 +1210,8 @@ namespace EveryRay_Core
 	{
 		assert(mCurrentPSOState == ER_RHI_DX12_PSO_STATE::GRAPHICS);
 
-		ER_RHI_DX12_GraphicsPSO& pso = mGraphicsPSONames.at(mCurrentGraphicsPSOName);
+		assert(mCurrentGraphicsPSO);
+		ER_RHI_DX12_GraphicsPSO& pso = *mCurrentGraphicsPSO;
 		pso.SetRenderTargetFormats(1, &mMainRTBufferFormat, mMainDepthBufferFormat);
 	}
 
@@ -1064,7 +1226,8 @@ namespace EveryRay_Core
 		if (it != mDepthStates.end())
 		{
 			mCurrentDS = aDS;
-			ER_RHI_DX12_GraphicsPSO& pso = mGraphicsPSONames.at(mCurrentGraphicsPSOName);
+			assert(mCurrentGraphicsPSO);
+			ER_RHI_DX12_GraphicsPSO& pso = *mCurrentGraphicsPSO;
 			pso.SetDepthStencilState(it->second);
 		}
 		else
@@ -1082,7 +1245,8 @@ namespace EveryRay_Core
 		if (it != mBlendStates.end())
 		{
 			mCurrentBS = aBS;
-			ER_RHI_DX12_GraphicsPSO& pso = mGraphicsPSONames.at(mCurrentGraphicsPSOName);
+			assert(mCurrentGraphicsPSO);
+			ER_RHI_DX12_GraphicsPSO& pso = *mCurrentGraphicsPSO;
 			pso.SetBlendState(it->second);
 		}
 		else
@@ -1100,7 +1264,8 @@ namespace EveryRay_Core
 		if (it != mRasterizerStates.end())
 		{
 			mCurrentRS = aRS;
-			ER_RHI_DX12_GraphicsPSO& pso = mGraphicsPSONames.at(mCurrentGraphicsPSOName);
+			assert(mCurrentGraphicsPSO);
+			ER_RHI_DX12_GraphicsPSO& pso = *mCurrentGraphicsPSO;
 			pso.SetRasterizerState(it->second);
 		}
 		else
@@ -1146,7 +1311,8 @@ namespace EveryRay_Core
 
 		if (mCurrentPSOState == ER_RHI_DX12_PSO_STATE::GRAPHICS)
 		{
-			ER_RHI_DX12_GraphicsPSO& pso = mGraphicsPSONames.at(mCurrentGraphicsPSOName);
+			assert(mCurrentGraphicsPSO);
+			ER_RHI_DX12_GraphicsPSO& pso = *mCurrentGraphicsPSO;
 
 			switch (aShader->mShaderType)
 			{
@@ -1169,12 +1335,13 @@ namespace EveryRay_Core
 		}
 		else
 		{
-			ER_RHI_DX12_ComputePSO& pso = mComputePSONames.at(mCurrentComputePSOName);
+			assert(mCurrentComputePSO);
+			ER_RHI_DX12_ComputePSO& pso = *mCurrentComputePSO;
 			pso.SetComputeShader(blob->GetBufferPointer(), blob->GetBufferSize());
 		}
 	}
 
-	void ER_RHI_DX12::SetShaderResources(ER_RHI_SHADER_TYPE aShaderType, const std::vector<ER_RHI_GPUResource*>& aSRVs, UINT startSlot /*= 0*/,
+	void ER_RHI_DX12::SetShaderResources(ER_RHI_SHADER_TYPE aShaderType, ER_RHI_Span<ER_RHI_GPUResource*> aSRVs, UINT startSlot /*= 0*/,
 		ER_RHI_GPURootSignature* rs, int rootParamIndex, bool isComputeRS, bool skipAutomaticTransition)
 	{
 		int srvCount = static_cast<int>(aSRVs.size());
@@ -1185,25 +1352,33 @@ namespace EveryRay_Core
 		assert(mDescriptorHeapManager);
 		assert(mCurrentGraphicsCommandListIndex > -1);
 
-		ER_RHI_DX12_GPUDescriptorHeap* gpuDescriptorHeap = mDescriptorHeapManager->GetGPUHeap(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
-		ER_RHI_DX12_DescriptorHandle& srvHandle = gpuDescriptorHeap->GetHandleBlock(srvCount);
+		ER_RHI_DX12_DescriptorHandle* srcHandles[DX12_MAX_BOUND_SHADER_RESOURCE_VIEWS] = {};
+		UINT64 keys[DX12_MAX_BOUND_SHADER_RESOURCE_VIEWS] = {};
 		for (int i = 0; i < srvCount; i++)
 		{
 			if (aSRVs[i])
 			{
 				if (aSRVs[i]->IsBuffer())
-					gpuDescriptorHeap->AddToHandle(mDevice.Get(), srvHandle, static_cast<ER_RHI_DX12_GPUBuffer*>(aSRVs[i])->GetSRVDescriptorHandle());
+					srcHandles[i] = &static_cast<ER_RHI_DX12_GPUBuffer*>(aSRVs[i])->GetSRVDescriptorHandle();
 				else
-					gpuDescriptorHeap->AddToHandle(mDevice.Get(), srvHandle, static_cast<ER_RHI_DX12_GPUTexture*>(aSRVs[i])->GetSRVHandle());
+					srcHandles[i] = &static_cast<ER_RHI_DX12_GPUTexture*>(aSRVs[i])->GetSRVHandle();
 			}
 			else
-				gpuDescriptorHeap->AddToHandle(mDevice.Get(), srvHandle, sNullSRV2DHandle);
-
+				srcHandles[i] = &sNullSRV2DHandle;
+			keys[i] = srcHandles[i]->GetCPUHandle().ptr;
 		}
 
 		if (!skipAutomaticTransition)
 			TransitionResources(aSRVs, aShaderType == ER_RHI_SHADER_TYPE::ER_PIXEL ? ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_PIXEL_SHADER_RESOURCE : ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, mCurrentGraphicsCommandListIndex);
 
+		if (FilterDescriptorTable(isComputeRS, rootParamIndex, keys, srvCount))
+			return;
+
+		ER_RHI_DX12_GPUDescriptorHeap* gpuDescriptorHeap = mDescriptorHeapManager->GetGPUHeap(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+		ER_RHI_DX12_DescriptorHandle& srvHandle = gpuDescriptorHeap->GetHandleBlock(srvCount);
+		for (int i = 0; i < srvCount; i++)
+			gpuDescriptorHeap->AddToHandle(mDevice.Get(), srvHandle, *srcHandles[i]);
+
 		if (!isComputeRS)
 			mCommandListGraphics[mCurrentGraphicsCommandListIndex]->SetGraphicsRootDescriptorTable(rootParamIndex, srvHandle.GetGPUHandle());
 		else
@@ -1212,7 +1387,7 @@ namespace EveryRay_Core
 		//TODO compute queue
 	}
 
-	void ER_RHI_DX12::SetUnorderedAccessResources(ER_RHI_SHADER_TYPE aShaderType, const std::vector<ER_RHI_GPUResource*>& aUAVs, UINT startSlot /*= 0*/,
+	void ER_RHI_DX12::SetUnorderedAccessResources(ER_RHI_SHADER_TYPE aShaderType, ER_RHI_Span<ER_RHI_GPUResource*> aUAVs, UINT startSlot /*= 0*/,
 		ER_RHI_GPURootSignature* rs, int rootParamIndex, bool isComputeRS, bool skipAutomaticTransition)
 	{
 		int uavCount = static_cast<int>(aUAVs.size());
@@ -1223,20 +1398,29 @@ namespace EveryRay_Core
 		assert(mDescriptorHeapManager);
 		assert(mCurrentGraphicsCommandListIndex > -1);
 
-		ER_RHI_DX12_GPUDescriptorHeap* gpuDescriptorHeap = mDescriptorHeapManager->GetGPUHeap(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
-		ER_RHI_DX12_DescriptorHandle& uavHandle = gpuDescriptorHeap->GetHandleBlock(uavCount);
+		ER_RHI_DX12_DescriptorHandle* srcHandles[DX12_MAX_BOUND_UNORDERED_ACCESS_VIEWS] = {};
+		UINT64 keys[DX12_MAX_BOUND_UNORDERED_ACCESS_VIEWS] = {};
 		for (int i = 0; i < uavCount; i++)
 		{
 			assert(aUAVs[i]);
 			if (aUAVs[i]->IsBuffer())
-				gpuDescriptorHeap->AddToHandle(mDevice.Get(), uavHandle, static_cast<ER_RHI_DX12_GPUBuffer*>(aUAVs[i])->GetUAVDescriptorHandle());
+				srcHandles[i] = &static_cast<ER_RHI_DX12_GPUBuffer*>(aUAVs[i])->GetUAVDescriptorHandle();
 			else
-				gpuDescriptorHeap->AddToHandle(mDevice.Get(), uavHandle, static_cast<ER_RHI_DX12_GPUTexture*>(aUAVs[i])->GetUAVHandle(startSlot));
+				srcHandles[i] = &static_cast<ER_RHI_DX12_GPUTexture*>(aUAVs[i])->GetUAVHandle(startSlot);
+			keys[i] = srcHandles[i]->GetCPUHandle().ptr;
 		}
 
 		if (!skipAutomaticTransition)
 			TransitionResources(aUAVs, ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_UNORDERED_ACCESS, mCurrentGraphicsCommandListIndex);
 
+		if (FilterDescriptorTable(isComputeRS, rootParamIndex, keys, uavCount))
+			return;
+
+		ER_RHI_DX12_GPUDescriptorHeap* gpuDescriptorHeap = mDescriptorHeapManager->GetGPUHeap(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+		ER_RHI_DX12_DescriptorHandle& uavHandle = gpuDescriptorHeap->GetHandleBlock(uavCount);
+		for (int i = 0; i < uavCount; i++)
+			gpuDescriptorHeap->AddToHandle(mDevice.Get(), uavHandle, *srcHandles[i]);
+
 		if (!isComputeRS)
 			mCommandListGraphics[mCurrentGraphicsCommandListIndex]->SetGraphicsRootDescriptorTable(rootParamIndex, uavHandle.GetGPUHandle());
 		else
@@ -1245,7 +1429,7 @@ namespace EveryRay_Core
 		//TODO compute queue
 	}
 
-	void ER_RHI_DX12::SetConstantBuffers(ER_RHI_SHADER_TYPE aShaderType, const std::vector<ER_RHI_GPUBuffer*>& aCBs, UINT startSlot /*= 0*/,
+	void ER_RHI_DX12::SetConstantBuffers(ER_RHI_SHADER_TYPE aShaderType, ER_RHI_Span<ER_RHI_GPUBuffer*> aCBs, UINT startSlot /*= 0*/,
 		ER_RHI_GPURootSignature* rs, int rootParamIndex, bool isComputeRS)
 	{
 		int cbvCount = static_cast<int>(aCBs.size());
@@ -1256,12 +1440,39 @@ namespace EveryRay_Core
 		assert(mDescriptorHeapManager);
 		assert(mCurrentGraphicsCommandListIndex > -1);
 
+		// ring allocations change with every update, so the table is keyed by (CBV location, size) or by (buffer's descriptor, 0)
+		D3D12_CONSTANT_BUFFER_VIEW_DESC cbvDescs[DX12_MAX_BOUND_CONSTANT_BUFFERS] = {};
+		UINT64 keys[DX12_MAX_BOUND_CONSTANT_BUFFERS * 2] = {};
+		for (int i = 0; i < cbvCount; i++)
+		{
+			assert(aCBs[i]);
+			ER_RHI_DX12_GPUBuffer* buffer = static_cast<ER_RHI_DX12_GPUBuffer*>(aCBs[i]);
+			// the buffer was updated in one of the previous frames: its ring allocation is gone, so upload the last data again
+			if (mUploadRing && buffer->IsUploadRingConstantBuffer() && !buffer->HasUploadRingAllocation(mUploadRingFrameIndex) && !buffer->GetUploadRingShadowData().empty())
+				UploadConstantBufferFromShadowData(buffer);
+
+			if (buffer->HasUploadRingAllocation(mUploadRingFrameIndex))
+			{
+				cbvDescs[i].BufferLocation = mUploadRing->GetGPUVirtualAddress() + buffer->GetUploadRingOffset();
+				cbvDescs[i].SizeInBytes = static_cast<UINT>(buffer->GetUploadRingSize());
+				keys[i * 2] = cbvDescs[i].BufferLocation;
+				keys[i * 2 + 1] = cbvDescs[i].SizeInBytes;
+			}
+			else
+				keys[i * 2] = buffer->GetCBVDescriptorHandle().GetCPUHandle().ptr;
+		}
+
+		if (FilterDescriptorTable(isComputeRS, rootParamIndex, keys, cbvCount * 2))
+			return;
+
 		ER_RHI_DX12_GPUDescriptorHeap* gpuDescriptorHeap = mDescriptorHeapManager->GetGPUHeap(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
 		ER_RHI_DX12_DescriptorHandle& cbvHandle = gpuDescriptorHeap->GetHandleBlock(cbvCount);
 		for (int i = 0; i < cbvCount; i++)
 		{
-			assert(aCBs[i]);
-			gpuDescriptorHeap->AddToHandle(mDevice.Get(), cbvHandle, static_cast<ER_RHI_DX12_GPUBuffer*>(aCBs[i])->GetCBVDescriptorHandle());
+			if (cbvDescs[i].SizeInBytes > 0)
+				gpuDescriptorHeap->AddCBVToHandle(mDevice.Get(), cbvHandle, cbvDescs[i]);
+			else
+				gpuDescriptorHeap->AddToHandle(mDevice.Get(), cbvHandle, static_cast<ER_RHI_DX12_GPUBuffer*>(aCBs[i])->GetCBVDescriptorHandle());
 		}
 
 		if (!isComputeRS)
@@ -1272,7 +1483,7 @@ namespace EveryRay_Core
 		//TODO compute queue
 	}
 
-	void ER_RHI_DX12::SetSamplers(ER_RHI_SHADER_TYPE aShaderType, const std::vector<ER_RHI_SAMPLER_STATE>& aSamplers, UINT startSlot /*= 0*/, ER_RHI_GPURootSignature* rs)
+	void ER_RHI_DX12::SetSamplers(ER_RHI_SHADER_TYPE aShaderType, ER_RHI_Span<ER_RHI_SAMPLER_STATE> aSamplers, UINT startSlot /*= 0*/, ER_RHI_GPURootSignature* rs)
 	{
 		//assert(rs);
 		//assert(rs->GetStaticSamplersCount() == aSamplers.size()); // we can do better checks (compare samplers), but thats ok for now
@@ -1285,7 +1496,8 @@ namespace EveryRay_Core
 		assert(mCurrentPSOState == ER_RHI_DX12_PSO_STATE::GRAPHICS);
 		assert(aIL);
 
-		ER_RHI_DX12_GraphicsPSO& pso = mGraphicsPSONames.at(mCurrentGraphicsPSOName);
+		assert(mCurrentGraphicsPSO);
+		ER_RHI_DX12_GraphicsPSO& pso = *mCurrentGraphicsPSO;
 		pso.SetInputLayout(this, aIL->mInputElementDescriptionCount, aIL->mInputElementDescriptions);
 	}
 
@@ -1303,55 +1515,79 @@ namespace EveryRay_Core
 		assert(buf);
 
 		D3D12_INDEX_BUFFER_VIEW view = buf->GetIndexBufferView();
+		if (mStateCache.IsIndexBufferKnown && memcmp(&mStateCache.IndexBuffer, &view, sizeof(view)) == 0)
+		{
+			OnBind(true);
+			return;
+		}
+		mStateCache.IndexBuffer = view;
+		mStateCache.IsIndexBufferKnown = true;
 		mCommandListGraphics[mCurrentGraphicsCommandListIndex]->IASetIndexBuffer(&view);
+		OnBind(false);
 	}
 
-	void ER_RHI_DX12::SetVertexBuffers(const std::vector<ER_RHI_GPUBuffer*>& aVertexBuffers)
+	void ER_RHI_DX12::SetVertexBuffers(ER_RHI_Span<ER_RHI_GPUBuffer*> aVertexBuffers)
 	{
 		assert(mCurrentGraphicsCommandListIndex > -1);
 
+		// [0] - vertex buffer, [1] - instance buffer (optional)
 		assert(aVertexBuffers.size() > 0 && aVertexBuffers.size() <= ER_RHI_MAX_BOUND_VERTEX_BUFFERS);
-		if (aVertexBuffers.size() == 1)
+		const UINT buffersCount = static_cast<UINT>(aVertexBuffers.size());
+		D3D12_VERTEX_BUFFER_VIEW views[ER_RHI_MAX_BOUND_VERTEX_BUFFERS] = {};
+		for (UINT i = 0; i < buffersCount; i++)
 		{
-			assert(aVertexBuffers[0]);
-
-			ER_RHI_DX12_GPUBuffer* buffer = static_cast<ER_RHI_DX12_GPUBuffer*>(aVertexBuffers[0]);
+			assert(aVertexBuffers[i]);
+			ER_RHI_DX12_GPUBuffer* buffer = static_cast<ER_RHI_DX12_GPUBuffer*>(aVertexBuffers[i]);
 			assert(buffer);
-
-			D3D12_VERTEX_BUFFER_VIEW view = buffer->GetVertexBufferView();
-			mCommandListGraphics[mCurrentGraphicsCommandListIndex]->IASetVertexBuffers(0, 1, &view);
+			views[i] = GetVertexBufferView(buffer);
 		}
-		else //+ instance buffer
-		{
-			UINT strides[2] = { aVertexBuffers[0]->GetStride(), aVertexBuffers[1]->GetStride() };
-			UINT offsets[2] = { 0, 0 };
-
-			assert(aVertexBuffers[0]);
-			assert(aVertexBuffers[1]);
-			ER_RHI_DX12_GPUBuffer* vertexBuffer = static_cast<ER_RHI_DX12_GPUBuffer*>(aVertexBuffers[0]);
-			ER_RHI_DX12_GPUBuffer* instanceBuffer = static_cast<ER_RHI_DX12_GPUBuffer*>(aVertexBuffers[1]);
-			assert(vertexBuffer);
-			assert(instanceBuffer);
 
-			D3D12_VERTEX_BUFFER_VIEW views[2] = { vertexBuffer->GetVertexBufferView(), instanceBuffer->GetVertexBufferView() };
-			mCommandListGraphics[mCurrentGraphicsCommandListIndex]->IASetVertexBuffers(0, 2, views);
+		if (mStateCache.VertexBuffersCount == buffersCount && memcmp(mStateCache.VertexBuffers, views, sizeof(D3D12_VERTEX_BUFFER_VIEW) * buffersCount) == 0)
+		{
+			OnBind(true);
+			return;
 		}
+		memcpy(mStateCache.VertexBuffers, views, sizeof(D3D12_VERTEX_BUFFER_VIEW) * buffersCount);
+		mStateCache.VertexBuffersCount = buffersCount;
+		mCommandListGraphics[mCurrentGraphicsCommandListIndex]->IASetVertexBuffers(0, buffersCount, views);
+		OnBind(false);
 	}
 
 	void ER_RHI_DX12::SetTopologyType(ER_RHI_PRIMITIVE_TYPE aType)
 	{
 		assert(mCurrentGraphicsCommandListIndex > -1);
-		mCommandListGraphics[mCurrentGraphicsCommandListIndex]->IASetPrimitiveTopology(GetTopology(aType));
+
+		const D3D12_PRIMITIVE_TOPOLOGY topology = GetTopology(aType);
+		if (mStateCache.Topology == topology)
+		{
+			OnBind(true);
+			return;
+		}
+		mStateCache.Topology = topology;
+		mCommandListGraphics[mCurrentGraphicsCommandListIndex]->IASetPrimitiveTopology(topology);
+		OnBind(false);
 	}
 
 	void ER_RHI_DX12::SetRootSignature(ER_RHI_GPURootSignature* rs, bool isCompute)
 	{
 		assert(rs);
 		assert(mCurrentGraphicsCommandListIndex > -1);
+
+		ID3D12RootSignature* signature = static_cast<ER_RHI_DX12_GPURootSignature*>(rs)->GetSignature();
+		ID3D12RootSignature*& boundSignature = mStateCache.RootSignatures[isCompute ? 1 : 0];
+		if (boundSignature == signature)
+		{
+			OnBind(true);
+			return;
+		}
+		boundSignature = signature;
+		mStateCache.InvalidateTables(isCompute); // root arguments are reset by a new root signature
+		OnBind(false);
+
 		if (!isCompute)
-			mCommandListGraphics[mCurrentGraphicsCommandListIndex]->SetGraphicsRootSignature(static_cast<ER_RHI_DX12_GPURootSignature*>(rs)->GetSignature());
+			mCommandListGraphics[mCurrentGraphicsCommandListIndex]->SetGraphicsRootSignature(signature);
 		else
-			mCommandListGraphics[mCurrentGraphicsCommandListIndex]->SetComputeRootSignature(static_cast<ER_RHI_DX12_GPURootSignature*>(rs)->GetSignature());
+			mCommandListGraphics[mCurrentGraphicsCommandListIndex]->SetComputeRootSignature(signature);
 
 		//TODO compute queue
 	}
@@ -1362,8 +1598,8 @@ namespace EveryRay_Core
 			return;
 
 		assert(mCurrentPSOState == ER_RHI_DX12_PSO_STATE::GRAPHICS);
-		assert(mCurrentGraphicsPSOName == aName);
-		mGraphicsPSONames.at(aName).SetPrimitiveTopologyType(GetTopologyType(aType));
+		assert(mCurrentGraphicsPSO && mCurrentGraphicsPSO->GetName() == aName);
+		mCurrentGraphicsPSO->SetPrimitiveTopologyType(GetTopologyType(aType));
 	}
 
 	ER_RHI_PRIMITIVE_TYPE ER_RHI_DX12::GetCurrentTopologyType()
@@ -1381,6 +1617,10 @@ namespace EveryRay_Core
 		if (aReset)
 			gpuDescriptorHeap->Reset();
 
+		// bound tables point to the previous heap (or to the reset blocks)
+		mStateCache.InvalidateTables(false);
+		mStateCache.InvalidateTables(true);
+
 		ID3D12DescriptorHeap* ppHeaps[] = { gpuDescriptorHeap->GetHeap() };
 		mCommandListGraphics[mCurrentGraphicsCommandListIndex]->SetDescriptorHeaps(_countof(ppHeaps), ppHeaps);
 	}
@@ -1389,6 +1629,8 @@ namespace EveryRay_Core
 	{
 		ID3D12DescriptorHeap* ppHeaps[] = { mImGuiDescriptorHeap.Get() };
 		mCommandListGraphics[cmdListIndex]->SetDescriptorHeaps(_countof(ppHeaps), ppHeaps);
+		mStateCache.InvalidateTables(false);
+		mStateCache.InvalidateTables(true);
 	}
 
 	bool ER_RHI_DX12::IsPSOReady(const std::string& aName, bool isCompute)
@@ -1415,14 +1657,12 @@ namespace EveryRay_Core
 	{
 		if (isCompute)
 		{
-			mComputePSONames.insert(std::make_pair(aName, ER_RHI_DX12_ComputePSO(aName)));
-			mCurrentComputePSOName = aName;
+			mCurrentComputePSO = &mComputePSONames.insert(std::make_pair(aName, ER_RHI_DX12_ComputePSO(aName))).first->second;
 			mCurrentPSOState = ER_RHI_DX12_PSO_STATE::COMPUTE;
 		}
 		else
 		{
-			mGraphicsPSONames.insert(std::make_pair(aName, ER_RHI_DX12_GraphicsPSO(aName)));
-			mCurrentGraphicsPSOName = aName;
+			mCurrentGraphicsPSO = &mGraphicsPSONames.insert(std::make_pair(aName, ER_RHI_DX12_GraphicsPSO(aName))).first->second;
 			mCurrentPSOState = ER_RHI_DX12_PSO_STATE::GRAPHICS;
 			SetRasterizerState(ER_RHI_RASTERIZER_STATE::ER_BACK_CULLING); // set default RS to all gfx PSO on init
 		}
@@ -1436,28 +1676,89 @@ namespace EveryRay_Core
 
 		if (!isCompute)
 		{
-			assert(mCurrentGraphicsPSOName == aName);
-			mGraphicsPSONames.at(aName).SetRootSignature(*rsDX12);
+			assert(mCurrentGraphicsPSO && mCurrentGraphicsPSO->GetName() == aName);
+			mCurrentGraphicsPSO->SetRootSignature(*rsDX12);
 		}
 		else
 		{
-			assert(mCurrentComputePSOName == aName);
-			mComputePSONames.at(aName).SetRootSignature(*rsDX12);
+			assert(mCurrentComputePSO && mCurrentComputePSO->GetName() == aName);
+			mCurrentComputePSO->SetRootSignature(*rsDX12);
 		}
 	}
 
-	void ER_RHI_DX12::FinalizePSO(const std::string& aName, bool isCompute /*= false*/)
+	ER_RHI_PSO_HANDLE ER_RHI_DX12::FinalizePSO(const std::string& aName, bool isCompute /*= false*/)
 	{
+		assert(mPSOCache);
+		ER_RHI_DX12_PSO* pso = nullptr;
+		ER_RHI_DX12_PSOHandleEntry entry;
 		if (!isCompute)
 		{
-			assert(mCurrentGraphicsPSOName == aName);
-			mGraphicsPSONames.at(aName).Finalize(mDevice.Get());
+			assert(mCurrentGraphicsPSO && mCurrentGraphicsPSO->GetName() == aName);
+			mCurrentGraphicsPSO->Finalize(mPSOCache);
+			pso = entry.GraphicsPSO = mCurrentGraphicsPSO;
 		}
 		else
 		{
-			assert(mCurrentComputePSOName == aName);
-			mComputePSONames.at(aName).Finalize(mDevice.Get());
+			assert(mCurrentComputePSO && mCurrentComputePSO->GetName() == aName);
+			mCurrentComputePSO->Finalize(mPSOCache);
+			pso = entry.ComputePSO = mCurrentComputePSO;
 		}
+
+		// re-finalized PSOs keep their handle
+		if (pso->GetHandle() == ER_RHI_INVALID_PSO_HANDLE)
+		{
+			pso->SetHandle(static_cast<ER_RHI_PSO_HANDLE>(mPSOHandles.size()));
+			mPSOHandles.push_back(entry);
+		}
+		return pso->GetHandle();
+	}
+
+	ER_RHI_PSO_HANDLE ER_RHI_DX12::GetPSOHandle(const std::string& aName, bool isCompute /*= false*/)
+	{
+		if (!isCompute)
+		{
+			auto it = mGraphicsPSONames.find(aName);
+			return it != mGraphicsPSONames.end() ? it->second.GetHandle() : ER_RHI_INVALID_PSO_HANDLE;
+		}
+		else
+		{
+			auto it = mComputePSONames.find(aName);
+			return it != mComputePSONames.end() ? it->second.GetHandle() : ER_RHI_INVALID_PSO_HANDLE;
+		}
+	}
+
+	void ER_RHI_DX12::BindGraphicsPSO(ER_RHI_DX12_GraphicsPSO& aPSO)
+	{
+		mCurrentGraphicsPSO = &aPSO;
+		mCurrentPSOState = ER_RHI_DX12_PSO_STATE::GRAPHICS;
+
+		ID3D12PipelineState* pipelineState = aPSO.GetPipelineStateObject();
+		if (pipelineState == mCurrentSetPipelineState)
+		{
+			OnBind(true);
+			return;
+		}
+
+		mCommandListGraphics[mCurrentGraphicsCommandListIndex]->SetPipelineState(pipelineState);
+		mCurrentSetPipelineState = pipelineState;
+		OnBind(false);
+	}
+
+	void ER_RHI_DX12::BindComputePSO(ER_RHI_DX12_ComputePSO& aPSO)
+	{
+		mCurrentComputePSO = &aPSO;
+		mCurrentPSOState = ER_RHI_DX12_PSO_STATE::COMPUTE;
+
+		ID3D12PipelineState* pipelineState = aPSO.GetPipelineStateObject();
+		if (pipelineState == mCurrentSetPipelineState)
+		{
+			OnBind(true);
+			return;
+		}
+
+		mCommandListGraphics[mCurrentGraphicsCommandListIndex]->SetPipelineState(pipelineState);
+		mCurrentSetPipelineState = pipelineState;
+		OnBind(false);
 	}
 
 	void ER_RHI_DX12::SetPSO(const std::string& aName, bool isCompute)
@@ -1475,20 +1776,7 @@ namespace EveryRay_Core
 		{
 			auto it = mGraphicsPSONames.find(aName);
 			if (it != mGraphicsPSONames.end())
-			{
-				if (mCurrentGraphicsPSOName == aName && mCurrentSetGraphicsPSOName == aName)
-				{
-					mCurrentPSOState = ER_RHI_DX12_PSO_STATE::GRAPHICS;
-					return;
-				}
-				else
-				{
-					mCommandListGraphics[mCurrentGraphicsCommandListIndex]->SetPipelineState(it->second.GetPipelineStateObject());
-					mCurrentGraphicsPSOName = it->first;
-					mCurrentSetGraphicsPSOName = mCurrentGraphicsPSOName;
-					mCurrentPSOState = ER_RHI_DX12_PSO_STATE::GRAPHICS;
-				}
-			}
+				BindGraphicsPSO(it->second);
 			else
 				resetPSO(aName, isCompute);
 		}
@@ -1496,36 +1784,55 @@ namespace EveryRay_Core
 		{
 			auto it = mComputePSONames.find(aName);
 			if (it != mComputePSONames.end())
-			{
-				if (mCurrentComputePSOName == aName && mCurrentSetComputePSOName == aName)
-				{
-					mCurrentPSOState = ER_RHI_DX12_PSO_STATE::COMPUTE;
-					return;
-				}
-				{
-					mCommandListGraphics[mCurrentGraphicsCommandListIndex]->SetPipelineState(it->second.GetPipelineStateObject());
-					mCurrentComputePSOName = it->first;
-					mCurrentSetComputePSOName = mCurrentComputePSOName;
-					mCurrentPSOState = ER_RHI_DX12_PSO_STATE::COMPUTE;
-				}
-			}
+				BindComputePSO(it->second);
 			else
 				resetPSO(aName, isCompute);
 		}
 	}
 
+	void ER_RHI_DX12::SetPSO(ER_RHI_PSO_HANDLE aHandle, bool isCompute)
+	{
+		assert(mCurrentGraphicsCommandListIndex > -1);
+		if (aHandle >= static_cast<ER_RHI_PSO_HANDLE>(mPSOHandles.size()))
+			throw ER_CoreException("ER_RHI_DX12: Invalid PSO handle");
+
+		const ER_RHI_DX12_PSOHandleEntry& entry = mPSOHandles[aHandle];
+		if (!isCompute)
+		{
+			assert(entry.GraphicsPSO);
+			BindGraphicsPSO(*entry.GraphicsPSO);
+		}
+		else
+		{
+			assert(entry.ComputePSO);
+			BindComputePSO(*entry.ComputePSO);
+		}
+	}
+
 	void ER_RHI_DX12::UnsetPSO()
 	{
 		mCurrentPSOState = ER_RHI_DX12_PSO_STATE::UNSET;
-		mCurrentSetGraphicsPSOName = "";
-		mCurrentSetComputePSOName = "";
+		mCurrentSetPipelineState = nullptr;
+	}
+
+	void ER_RHI_DX12::FlushBarriers(CD3DX12_RESOURCE_BARRIER* aBarriers, UINT& aCount, int cmdListIndex, bool isCopyQueue)
+	{
+		if (aCount == 0)
+			return;
+
+		if (!isCopyQueue)
+			mCommandListGraphics[cmdListIndex]->ResourceBarrier(aCount, aBarriers);
+		else
+			mCommandListCopy->ResourceBarrier(aCount, aBarriers);
+		aCount = 0;
 	}
 
-	void ER_RHI_DX12::TransitionResources(const std::vector<ER_RHI_GPUResource*>& aResources, const std::vector<ER_RHI_RESOURCE_STATE>& aStates, int cmdListIndex, bool isCopyQueue, int subresourceIndex)
+	void ER_RHI_DX12::TransitionResources(ER_RHI_Span<ER_RHI_GPUResource*> aResources, ER_RHI_Span<ER_RHI_RESOURCE_STATE> aStates, int cmdListIndex, bool isCopyQueue, int subresourceIndex)
 	{
 		int size = static_cast<int>(aResources.size());
 		assert(size > 0 && size == aStates.size());
-		std::vector<CD3DX12_RESOURCE_BARRIER> barriers;
+		CD3DX12_RESOURCE_BARRIER barriers[DX12_MAX_BATCHED_RESOURCE_BARRIERS];
+		UINT barriersCount = 0;
 
 		for (int i = 0; i < size; i++)
 		{
@@ -1535,26 +1842,23 @@ namespace EveryRay_Core
 
 			if (aResources[i] && aResources[i]->GetCurrentState() != aStates[i])
 			{
-				barriers.emplace_back(CD3DX12_RESOURCE_BARRIER::Transition(static_cast<ID3D12Resource*>(aResources[i]->GetResource()), GetState(aResources[i]->GetCurrentState()), GetState(aStates[i]),
-					subresourceIndex < 0 ? D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES : subresourceIndex)
-				);
+				if (barriersCount == DX12_MAX_BATCHED_RESOURCE_BARRIERS)
+					FlushBarriers(barriers, barriersCount, cmdListIndex, isCopyQueue);
+
+				barriers[barriersCount++] = CD3DX12_RESOURCE_BARRIER::Transition(static_cast<ID3D12Resource*>(aResources[i]->GetResource()), GetState(aResources[i]->GetCurrentState()), GetState(aStates[i]),
+					subresourceIndex < 0 ? D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES : subresourceIndex);
 				aResources[i]->SetCurrentState(aStates[i]);
 			}
 		}
 
-		if (barriers.size() > 0)
-		{
-			if (!isCopyQueue)
-				mCommandListGraphics[cmdListIndex]->ResourceBarrier(static_cast<UINT>(barriers.size()), barriers.data());
-			else
-				mCommandListCopy->ResourceBarrier(static_cast<UINT>(barriers.size()), barriers.data());
-		}
+		FlushBarriers(barriers, barriersCount, cmdListIndex, isCopyQueue);
 	}
 
-	void ER_RHI_DX12::TransitionResources(const std::vector<ER_RHI_GPUResource*>& aResources, ER_RHI_RESOURCE_STATE aState, int cmdListIndex /*= 0*/, bool isCopyQueue, int subresourceIndex)
+	void ER_RHI_DX12::TransitionResources(ER_RHI_Span<ER_RHI_GPUResource*> aResources, ER_RHI_RESOURCE_STATE aState, int cmdListIndex /*= 0*/, bool isCopyQueue, int subresourceIndex)
 	{
 		int size = static_cast<int>(aResources.size());
-		std::vector<CD3DX12_RESOURCE_BARRIER> barriers;
+		CD3DX12_RESOURCE_BARRIER barriers[DX12_MAX_BATCHED_RESOURCE_BARRIERS];
+		UINT barriersCount = 0;
 
 		for (int i = 0; i < size; i++)
 		{
@@ -1565,22 +1869,18 @@ namespace EveryRay_Core
 				aResources[i]->GetCurrentState() == ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE)
 				continue;
 
-			if (aResources[i] && aResources[i]->GetCurrentState() != aState)
+			if (aResources[i]->GetCurrentState() != aState)
 			{
-				barriers.emplace_back(CD3DX12_RESOURCE_BARRIER::Transition(static_cast<ID3D12Resource*>(aResources[i]->GetResource()), GetState(aResources[i]->GetCurrentState()), GetState(aState),
-					subresourceIndex < 0 ? D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES : subresourceIndex)
-				);
+				if (barriersCount == DX12_MAX_BATCHED_RESOURCE_BARRIERS)
+					FlushBarriers(barriers, barriersCount, cmdListIndex, isCopyQueue);
+
+				barriers[barriersCount++] = CD3DX12_RESOURCE_BARRIER::Transition(static_cast<ID3D12Resource*>(aResources[i]->GetResource()), GetState(aResources[i]->GetCurrentState()), GetState(aState),
+					subresourceIndex < 0 ? D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES : subresourceIndex);
 				aResources[i]->SetCurrentState(aState);
 			}
 		}
 
-		if (barriers.size() > 0)
-		{
-			if (!isCopyQueue)
-				mCommandListGraphics[cmdListIndex]->ResourceBarrier(static_cast<UINT>(barriers.size()), barriers.data());
-			else
-				mCommandListCopy->ResourceBarrier(static_cast<UINT>(barriers.size()), barriers.data());
-		}
+		FlushBarriers(barriers, barriersCount, cmdListIndex, isCopyQueue);
 	}
 
 	void ER_RHI_DX12::TransitionMainRenderTargetToPresent(int cmdListIndex)
@@ -1602,9 +1902,111 @@ namespace EveryRay_Core
 		ER_RHI_DX12_GPUBuffer* buffer = static_cast<ER_RHI_DX12_GPUBuffer*>(aBuffer);
 		assert(buffer);
 
+		if (mUploadRing && buffer->IsUploadRingConstantBuffer())
+		{
+			buffer->SetUploadRingShadowData(aData, dataSize);
+			UploadConstantBufferFromShadowData(buffer); // also covers updateForAllBackBuffers: the shadow is re-uploaded in every frame it is bound in
+			return;
+		}
+
+		buffer->ResetUploadRingAllocation();
+		buffer->ClearUploadRingShadowData();
 		buffer->Update(this, aData, dataSize, updateForAllBackBuffers);
 	}
 
+	void ER_RHI_DX12::UpdateBufferTransient(ER_RHI_GPUBuffer* aBuffer, void* aData, int dataSize)
+	{
+		assert(aBuffer->GetSize() >= dataSize);
+
+		UINT64 offset = 0;
+		if (AllocateFromUploadRing(aData, dataSize, dataSize, 16, offset))
+			aBuffer->SetUploadRingAllocation(mUploadRingFrameIndex, offset, dataSize);
+		else
+			UpdateBuffer(aBuffer, aData, dataSize, true);
+	}
+
+	void ER_RHI_DX12::UploadConstantBufferFromShadowData(ER_RHI_DX12_GPUBuffer* aBuffer)
+	{
+		std::vector<unsigned char>& data = aBuffer->GetUploadRingShadowData();
+
+		// CBVs must be 256-byte aligned and sized (GPU buffer's size is already aligned)
+		UINT64 size = ER_BitmaskAlign(aBuffer->GetSize(), D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
+		UINT64 offset = 0;
+		if (AllocateFromUploadRing(data.data(), data.size(), size, D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT, offset))
+			aBuffer->SetUploadRingAllocation(mUploadRingFrameIndex, offset, size);
+		else
+		{
+			aBuffer->ResetUploadRingAllocation();
+			aBuffer->Update(this, data.data(), static_cast<int>(data.size()));
+		}
+	}
+
+	D3D12_VERTEX_BUFFER_VIEW ER_RHI_DX12::GetVertexBufferView(ER_RHI_DX12_GPUBuffer* aBuffer)
+	{
+		if (!mUploadRing || !aBuffer->HasUploadRingAllocation(mUploadRingFrameIndex))
+			return aBuffer->GetVertexBufferView();
+
+		D3D12_VERTEX_BUFFER_VIEW view;
+		view.BufferLocation = mUploadRing->GetGPUVirtualAddress() + aBuffer->GetUploadRingOffset();
+		view.StrideInBytes = aBuffer->GetStride();
+		view.SizeInBytes = static_cast<UINT>(aBuffer->GetUploadRingSize());
+		return view;
+	}
+
+	bool ER_RHI_DX12::FilterDescriptorTable(bool isCompute, int rootParamIndex, const UINT64* aKeys, UINT aKeysCount)
+	{
+		ER_RHI_DX12_BoundTable* table = mStateCache.GetTable(isCompute, rootParamIndex);
+		if (table && table->Matches(aKeys, aKeysCount))
+		{
+			OnBind(true);
+			return true;
+		}
+
+		if (table)
+			table->Set(aKeys, aKeysCount);
+		OnBind(false);
+		return false;
+	}
+
+	void ER_RHI_DX12::CreateUploadRing()
+	{
+		const UINT64 ringSize = static_cast<UINT64>(ER_RHI_UPLOAD_RING_SIZE) * DX12_MAX_BACK_BUFFER_COUNT;
+		if (FAILED(mDevice->CreateCommittedResource(&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD), D3D12_HEAP_FLAG_NONE, &CD3DX12_RESOURCE_DESC::Buffer(ringSize),
+			D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&mUploadRing))))
+			throw ER_CoreException("ER_RHI_DX12: Failed to create committed resource of the upload ring.");
+		mUploadRing->SetName(L"ER_RHI_DX12: Upload Ring");
+
+		// stays mapped until the resource is released (upload heaps are write-combined, we never read from it)
+		CD3DX12_RANGE readRange(0, 0);
+		if (FAILED(mUploadRing->Map(0, &readRange, reinterpret_cast<void**>(&mUploadRingMappedData))))
+			throw ER_CoreException("ER_RHI_DX12: Failed to map the upload ring.");
+
+		mUploadRingAllocator.Initialize(ER_RHI_UPLOAD_RING_SIZE);
+		mUploadRingSegmentIndex = mBackBufferIndex;
+	}
+
+	bool ER_RHI_DX12::AllocateFromUploadRing(const void* aData, UINT64 aDataSize, UINT64 aAllocationSize, UINT64 aAlignment, UINT64& outOffset)
+	{
+		assert(aDataSize <= aAllocationSize);
+		if (!mUploadRing || !mUploadRingAllocator.Allocate(aAllocationSize, aAlignment, outOffset))
+			return false;
+
+		// offsets are absolute (segment base is 256-byte aligned), so they stay valid if the back buffer index is reset mid-frame
+		outOffset += static_cast<UINT64>(mUploadRingSegmentIndex) * ER_RHI_UPLOAD_RING_SIZE;
+		memcpy(mUploadRingMappedData + outOffset, aData, static_cast<size_t>(aDataSize));
+		return true;
+	}
+
+	void ER_RHI_DX12::EndUploadRingFrame()
+	{
+		ER_RHI_UploadRingStats frameStats;
+		mUploadRingAllocator.EndFrame(frameStats);
+		mUploadRingSegmentIndex = mBackBufferIndex;
+
+		if (PublishUploadRingStats(frameStats))
+			ER_OUTPUT_LOG(ER_Utility::ToWideString("[ER Logger][ER_RHI_DX12] Upload ring overflowed, consider increasing ER_RHI_UPLOAD_RING_SIZE\n").c_str());
+	}
+
 	void ER_RHI_DX12::InitImGui()
 	{
 		D3D12_DESCRIPTOR_HEAP_DESC desc = {};
@@ -1626,6 +2028,10 @@ namespace EveryRay_Core
 	void ER_RHI_DX12::RenderDrawDataImGui(int cmdListIndex)
 	{
 		ImGui_ImplDX12_RenderDrawData(ImGui::GetDrawData(), mCommandListGraphics[cmdListIndex].Get());
+
+		// the backend sets its own PSO, root signature and buffers directly on the command list
+		mCurrentSetPipelineState = nullptr;
+		mStateCache.Invalidate();
 	}
 
 	void ER_RHI_DX12::ShutdownImGui()
@@ -1,5 +1,6 @@
 #pragma once
 #include "..\ER_RHI.h"
+#include "..\ER_RHI_ShaderCache.h"
 
 #include <d3d12.h>
 #include <dxgi1_6.h>
@@ -19,6 +20,7 @@
 #define DX12_MAX_BOUND_CONSTANT_BUFFERS 8 
 #define DX12_MAX_BOUND_SAMPLERS 8 
 #define DX12_MAX_BOUND_ROOT_PARAMS 8 
+#define DX12_MAX_BATCHED_RESOURCE_BARRIERS 16 // TransitionResources() flushes in batches of this size
 #define DX12_MAX_BACK_BUFFER_COUNT 2
 
 #define DX12_MAX_GENERATE_MIPS_TEXTURES_IN_POOL 2048 // max # of textures pending for GenerateMipsWithTextureReplacement();
@@ -32,11 +34,55 @@ namespace EveryRay_Core
 		COMPUTE
 	};
 
+	class ER_RHI_DX12_PSOCache;
 	class ER_RHI_DX12_GraphicsPSO;
 	class ER_RHI_DX12_ComputePSO;
 	class ER_RHI_DX12_GPURootSignature;
 	class ER_RHI_DX12_GPUDescriptorHeapManager;
 	class ER_RHI_DX12_DescriptorHandle;
+	class ER_RHI_DX12_GPUBuffer;
+
+	// Descriptors of one root descriptor table as the RHI last set it (keys are CPU descriptor handles or CBV locations)
+	struct ER_RHI_DX12_BoundTable
+	{
+		UINT64 Keys[DX12_MAX_BOUND_SHADER_RESOURCE_VIEWS];
+		UINT KeysCount = 0;
+		bool IsKnown = false;
+
+		bool Matches(const UINT64* aKeys, UINT aKeysCount) const { return IsKnown && KeysCount == aKeysCount && memcmp(Keys, aKeys, sizeof(UINT64) * aKeysCount) == 0; }
+		void Set(const UINT64* aKeys, UINT aKeysCount) { memcpy(Keys, aKeys, sizeof(UINT64) * aKeysCount); KeysCount = aKeysCount; IsKnown = true; }
+	};
+
+	// Shadow copy of the current graphics command list's bindings: binds that would set the same values again are dropped (see ER_RHI::GetBindingStats()).
+	// Filtered descriptor tables are not copied to the GPU heap again. Resources still go through TransitionResources(), because their states can change between the binds.
+	struct ER_RHI_DX12_StateCache
+	{
+		ID3D12RootSignature* RootSignatures[2] = {}; // graphics, compute
+		ER_RHI_DX12_BoundTable Tables[2][DX12_MAX_BOUND_ROOT_PARAMS];
+		D3D12_VERTEX_BUFFER_VIEW VertexBuffers[ER_RHI_MAX_BOUND_VERTEX_BUFFERS] = {};
+		UINT VertexBuffersCount = 0;
+		D3D12_INDEX_BUFFER_VIEW IndexBuffer = {};
+		bool IsIndexBufferKnown = false;
+		D3D12_PRIMITIVE_TOPOLOGY Topology = D3D_PRIMITIVE_TOPOLOGY_UNDEFINED; // undefined - unknown
+
+		ER_RHI_DX12_BoundTable* GetTable(bool isCompute, int rootParamIndex) { return rootParamIndex < DX12_MAX_BOUND_ROOT_PARAMS ? &Tables[isCompute ? 1 : 0][rootParamIndex] : nullptr; }
+
+		void InvalidateTables(bool isCompute)
+		{
+			for (int i = 0; i < DX12_MAX_BOUND_ROOT_PARAMS; i++)
+				Tables[isCompute ? 1 : 0][i].IsKnown = false;
+		}
+
+		void Invalidate()
+		{
+			RootSignatures[0] = RootSignatures[1] = nullptr;
+			InvalidateTables(false);
+			InvalidateTables(true);
+			VertexBuffersCount = 0;
+			IsIndexBufferKnown = false;
+			Topology = D3D_PRIMITIVE_TOPOLOGY_UNDEFINED;
+		}
+	};
 
 	class ER_RHI_DX12: public ER_RHI
 	{
@@ -83,6 +129,7 @@ namespace EveryRay_Core
 		virtual void DrawIndexed(UINT IndexCount) override;
 		virtual void DrawInstanced(UINT VertexCountPerInstance, UINT InstanceCount, UINT StartVertexLocation, UINT StartInstanceLocation) override;
 		virtual void DrawIndexedInstanced(UINT IndexCountPerInstance, UINT InstanceCount, UINT StartIndexLocation, INT BaseVertexLocation, UINT StartInstanceLocation) override;
+		virtual void DrawIndexedInstancedIndirect(ER_RHI_GPUBuffer* aArgsBuffer, UINT aArgsOffset) override;
 		//TODO DrawIndirect
 
 		virtual void Dispatch(UINT ThreadGroupCountX, UINT ThreadGroupCountY, UINT ThreadGroupCountZ) override;
@@ -93,19 +140,21 @@ namespace EveryRay_Core
 
 		virtual void GenerateMips(ER_RHI_GPUTexture* aTexture, ER_RHI_GPUTexture* aSRGBTexture = nullptr) override;
 		virtual void GenerateMipsWithTextureReplacement(ER_RHI_GPUTexture** aTexture, std::function<void(ER_RHI_GPUTexture**)> aReplacementCallback) override;
+		virtual ER_RHI_GPUTexture* GenerateMipsIntoNewTexture(ER_RHI_GPUTexture* aTexture) override;
 		virtual void ReplaceOriginalTexturesWithMipped() override;
 
 		virtual void PresentGraphics() override;
 		virtual void PresentCompute() override;
 		
 		virtual bool ProjectCubemapToSH(ER_RHI_GPUTexture* aTexture, UINT order, float* resultR, float* resultG, float* resultB) override;
+		virtual bool ReadGPUTextureToCPU(ER_RHI_GPUTexture* aTexture, UINT aMip, std::vector<XMFLOAT4>& aOutTexels) override;
 		
 		virtual void SaveGPUTextureToFile(ER_RHI_GPUTexture* aTexture, const std::wstring& aPathName) override;
 
 		virtual void SetMainRenderTargets(int cmdListIndex = 0) override;
-		virtual void SetRenderTargets(const std::vector<ER_RHI_GPUTexture*>& aRenderTargets, ER_RHI_GPUTexture* aDepthTarget = nullptr, ER_RHI_GPUTexture* aUAV = nullptr, int rtvArrayIndex = -1) override;
+		virtual void SetRenderTargets(ER_RHI_Span<ER_RHI_GPUTexture*> aRenderTargets, ER_RHI_GPUTexture* aDepthTarget = nullptr, ER_RHI_GPUTexture* aUAV = nullptr, int rtvArrayIndex = -1) override;
 		virtual void SetDepthTarget(ER_RHI_GPUTexture* aDepthTarget) override;
-		virtual void SetRenderTargetFormats(const std::vector<ER_RHI_GPUTexture*>& aRenderTargets, ER_RHI_GPUTexture* aDepthTarget = nullptr) override;
+		virtual void SetRenderTargetFormats(ER_RHI_Span<ER_RHI_GPUTexture*> aRenderTargets, ER_RHI_GPUTexture* aDepthTarget = nullptr) override;
 		virtual void SetMainRenderTargetFormats() override;
 
 		virtual void SetDepthStencilState(ER_RHI_DEPTH_STENCIL_STATE aDS, UINT stencilRef = 0xffffffff) override;
@@ -120,20 +169,20 @@ namespace EveryRay_Core
 		
 		virtual void SetShader(ER_RHI_GPUShader* aShader) override;
 		
-		virtual void SetShaderResources(ER_RHI_SHADER_TYPE aShaderType, const std::vector<ER_RHI_GPUResource*>& aSRVs, UINT startSlot = 0, 
+		virtual void SetShaderResources(ER_RHI_SHADER_TYPE aShaderType, ER_RHI_Span<ER_RHI_GPUResource*> aSRVs, UINT startSlot = 0, 
 			ER_RHI_GPURootSignature* rs = nullptr, int rootParamIndex = -1, bool isComputeRS = false, bool skipAutomaticTransition = false) override;
-		virtual void SetUnorderedAccessResources(ER_RHI_SHADER_TYPE aShaderType, const std::vector<ER_RHI_GPUResource*>& aUAVs, UINT startSlot = 0,
+		virtual void SetUnorderedAccessResources(ER_RHI_SHADER_TYPE aShaderType, ER_RHI_Span<ER_RHI_GPUResource*> aUAVs, UINT startSlot = 0,
 			ER_RHI_GPURootSignature* rs = nullptr, int rootParamIndex = -1, bool isComputeRS = false, bool skipAutomaticTransition = false) override;
-		virtual void SetConstantBuffers(ER_RHI_SHADER_TYPE aShaderType, const std::vector<ER_RHI_GPUBuffer*>& aCBs, UINT startSlot = 0,
+		virtual void SetConstantBuffers(ER_RHI_SHADER_TYPE aShaderType, ER_RHI_Span<ER_RHI_GPUBuffer*> aCBs, UINT startSlot = 0,
 			ER_RHI_GPURootSignature* rs = nullptr, int rootParamIndex = -1, bool isComputeRS = false) override;
-		virtual void SetSamplers(ER_RHI_SHADER_TYPE aShaderType, const std::vector<ER_RHI_SAMPLER_STATE>& aSamplers, UINT startSlot = 0, ER_RHI_GPURootSignature* rs = nullptr) override;
+		virtual void SetSamplers(ER_RHI_SHADER_TYPE aShaderType, ER_RHI_Span<ER_RHI_SAMPLER_STATE> aSamplers, UINT startSlot = 0, ER_RHI_GPURootSignature* rs = nullptr) override;
 		
 		virtual void SetRootSignature(ER_RHI_GPURootSignature* rs, bool isCompute = false) override;
 		
 		virtual void SetInputLayout(ER_RHI_InputLayout* aIL) override;
 		virtual void SetEmptyInputLayout() override;
 		virtual void SetIndexBuffer(ER_RHI_GPUBuffer* aBuffer, UINT offset = 0) override;
-		virtual void SetVertexBuffers(const std::vector<ER_RHI_GPUBuffer*>& aVertexBuffers) override;
+		virtual void SetVertexBuffers(ER_RHI_Span<ER_RHI_GPUBuffer*> aVertexBuffers) override;
 
 		virtual void SetTopologyType(ER_RHI_PRIMITIVE_TYPE aType) override;
 		virtual ER_RHI_PRIMITIVE_TYPE GetCurrentTopologyType() override;
@@ -141,22 +190,25 @@ namespace EveryRay_Core
 		virtual void SetGPUDescriptorHeap(ER_RHI_DESCRIPTOR_HEAP_TYPE aType, bool aReset) override;
 		virtual void SetGPUDescriptorHeapImGui(int cmdListIndex = 0) override;
 
-		virtual void TransitionResources(const std::vector<ER_RHI_GPUResource*>& aResources, const std::vector<ER_RHI_RESOURCE_STATE>& aStates, int cmdListIndex = 0, bool isCopyQueue = false, int subresourceIndex = -1) override;
-		virtual void TransitionResources(const std::vector<ER_RHI_GPUResource*>& aResources, ER_RHI_RESOURCE_STATE aState, int cmdListIndex = 0, bool isCopyQueue = false, int subresourceIndex = -1) override;
+		virtual void TransitionResources(ER_RHI_Span<ER_RHI_GPUResource*> aResources, ER_RHI_Span<ER_RHI_RESOURCE_STATE> aStates, int cmdListIndex = 0, bool isCopyQueue = false, int subresourceIndex = -1) override;
+		virtual void TransitionResources(ER_RHI_Span<ER_RHI_GPUResource*> aResources, ER_RHI_RESOURCE_STATE aState, int cmdListIndex = 0, bool isCopyQueue = false, int subresourceIndex = -1) override;
 		virtual void TransitionMainRenderTargetToPresent(int cmdListIndex = 0) override;
 
 		virtual bool IsPSOReady(const std::string& aName, bool isCompute = false) override;
 		virtual void InitializePSO(const std::string& aName, bool isCompute = false) override;
 		virtual void SetRootSignatureToPSO(const std::string& aName, ER_RHI_GPURootSignature* rs, bool isCompute = false) override;
 		virtual void SetTopologyTypeToPSO(const std::string& aName, ER_RHI_PRIMITIVE_TYPE aType) override;
-		virtual void FinalizePSO(const std::string& aName, bool isCompute = false) override;
+		virtual ER_RHI_PSO_HANDLE FinalizePSO(const std::string& aName, bool isCompute = false) override;
+		virtual ER_RHI_PSO_HANDLE GetPSOHandle(const std::string& aName, bool isCompute = false) override;
 		virtual void SetPSO(const std::string& aName, bool isCompute = false) override;
+		virtual void SetPSO(ER_RHI_PSO_HANDLE aHandle, bool isCompute = false) override;
 		virtual void UnsetPSO() override;
 
 		virtual void UnbindRenderTargets() override;
 		virtual void UnbindResourcesFromShader(ER_RHI_SHADER_TYPE aShaderType, bool unbindShader = true) override {}; //Not needed on DX12
 
 		virtual void UpdateBuffer(ER_RHI_GPUBuffer* aBuffer, void* aData, int dataSize, bool updateForAllBackBuffers = false) override;
+		virtual void UpdateBufferTransient(ER_RHI_GPUBuffer* aBuffer, void* aData, int dataSize) override;
 		
 		virtual bool IsHardwareRaytracingSupported() override { return mIsRaytracingTierAvailable; }
 
@@ -192,6 +244,7 @@ namespace EveryRay_Core
 		D3D12_DESCRIPTOR_RANGE_TYPE GetDescriptorRangeType(ER_RHI_DESCRIPTOR_RANGE_TYPE aDesc);
 
 		ER_GRAPHICS_API GetAPI() { return mAPI; }
+		virtual ER_RHI_ShaderCache* GetShaderCache() override { return mShaderCache; }
 		static int mBackBufferIndex;
 	private:
 		inline CD3DX12_CPU_DESCRIPTOR_HANDLE GetMainRenderTargetView() const { return CD3DX12_CPU_DESCRIPTOR_HANDLE(mRTVDescriptorHeap->GetCPUDescriptorHandleForHeapStart(), static_cast<INT>(mBackBufferIndex), mRTVDescriptorSize); }
@@ -207,12 +260,25 @@ namespace EveryRay_Core
 		DXGI_FORMAT ChangeFormatToUncompressed(DXGI_FORMAT aFormat);
 		bool IsFormatSRGB(DXGI_FORMAT aFormat);
 
+		void BindGraphicsPSO(ER_RHI_DX12_GraphicsPSO& aPSO);
+		void BindComputePSO(ER_RHI_DX12_ComputePSO& aPSO);
+
 		void CreateMainRenderTargetAndDepth(int width, int height);
 		void CreateSamplerStates();
 		void CreateBlendStates();
 		void CreateRasterizerStates();
 		void CreateDepthStencilStates();
 
+		void CreateUploadRing();
+		bool AllocateFromUploadRing(const void* aData, UINT64 aDataSize, UINT64 aAllocationSize, UINT64 aAlignment, UINT64& outOffset);
+		void UploadConstantBufferFromShadowData(ER_RHI_DX12_GPUBuffer* aBuffer); // to the ring or to the buffer's own memory on overflow
+		D3D12_VERTEX_BUFFER_VIEW GetVertexBufferView(ER_RHI_DX12_GPUBuffer* aBuffer); // own memory or the upload ring
+
+		// returns true if the same descriptors are already bound to the table (counts the bind), otherwise remembers them
+		bool FilterDescriptorTable(bool isCompute, int rootParamIndex, const UINT64* aKeys, UINT aKeysCount);
+		void FlushBarriers(CD3DX12_RESOURCE_BARRIER* aBarriers, UINT& aCount, int cmdListIndex, bool isCopyQueue);
+		void EndUploadRingFrame();
+
 		D3D_FEATURE_LEVEL mFeatureLevel = D3D_FEATURE_LEVEL_12_1;
 		
 		ComPtr<IDXGIFactory4> mDXGIFactory;
@@ -230,6 +296,8 @@ namespace EveryRay_Core
 
 		ComPtr<ID3D12DescriptorHeap> mImGuiDescriptorHeap;
 
+		ComPtr<ID3D12CommandSignature> mDrawIndexedIndirectCommandSignature; // created on the first DrawIndexedInstancedIndirect()
+
 		// graphics
 		ComPtr<ID3D12CommandQueue> mCommandQueueGraphics;
 		ComPtr<ID3D12GraphicsCommandList> mCommandListGraphics[ER_RHI_MAX_GRAPHICS_COMMAND_LISTS];
@@ -262,13 +330,22 @@ namespace EveryRay_Core
 		std::map<ER_RHI_RASTERIZER_STATE, D3D12_RASTERIZER_DESC> mRasterizerStates;
 		std::map<ER_RHI_DEPTH_STENCIL_STATE, D3D12_DEPTH_STENCIL_DESC> mDepthStates;
 
+		// PSOs are only looked up by name when they are built or by systems without a handle; nodes of std::map are stable, so handles and current PSOs are pointers
 		std::map<std::string, ER_RHI_DX12_GraphicsPSO> mGraphicsPSONames;
 		std::map<std::string, ER_RHI_DX12_ComputePSO> mComputePSONames;
-		std::string mCurrentGraphicsPSOName;
-		std::string mCurrentComputePSOName;
-		std::string mCurrentSetGraphicsPSOName; //which was set to command list already
-		std::string mCurrentSetComputePSOName; //which was set to command list already
+		struct ER_RHI_DX12_PSOHandleEntry
+		{
+			ER_RHI_DX12_GraphicsPSO* GraphicsPSO = nullptr;
+			ER_RHI_DX12_ComputePSO* ComputePSO = nullptr;
+		};
+		std::vector<ER_RHI_DX12_PSOHandleEntry> mPSOHandles; // index - ER_RHI_PSO_HANDLE
+		ER_RHI_DX12_GraphicsPSO* mCurrentGraphicsPSO = nullptr;
+		ER_RHI_DX12_ComputePSO* mCurrentComputePSO = nullptr;
+		ID3D12PipelineState* mCurrentSetPipelineState = nullptr; //which was set to command list already (can be shared by PSOs of different systems)
 		ER_RHI_DX12_PSO_STATE mCurrentPSOState = ER_RHI_DX12_PSO_STATE::UNSET;
+		ER_RHI_DX12_PSOCache* mPSOCache = nullptr;
+		ER_RHI_ShaderCache* mShaderCache = nullptr;
+		ER_RHI_DX12_StateCache mStateCache;
 
 		ER_RHI_DX12_GPUDescriptorHeapManager* mDescriptorHeapManager = nullptr;
 
@@ -277,6 +354,12 @@ namespace EveryRay_Core
 		bool mIsRaytracingTierAvailable = false;
 		bool mIsContextReadingBuffer = false;
 
+		// upload ring: one persistently mapped segment per back buffer, a segment is reused after the fence of its back buffer is reached (see PresentGraphics())
+		ComPtr<ID3D12Resource> mUploadRing;
+		unsigned char* mUploadRingMappedData = nullptr;
+		ER_RHI_UploadRingAllocator mUploadRingAllocator;
+		int mUploadRingSegmentIndex = 0;
+
 		ER_RHI_GPURootSignature* mClearUAV2DRS = nullptr;
 		ER_RHI_GPUShader* mClearUAV2DCS = nullptr;
 		std::string mClearUAV2DPSOName = "ER_RHI_GPUPipelineStateObject: Clear UAV 2D";
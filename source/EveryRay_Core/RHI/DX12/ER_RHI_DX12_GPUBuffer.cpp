@@ -25,6 +25,7 @@ namespace EveryRay_Core
 		assert(device);
 		mIsDynamic = isDynamic;
 		mBindFlags = bindFlags;
+		mIsUploadRingConstantBuffer = isDynamic && (bindFlags & ER_RHI_BIND_FLAG::ER_BIND_CONSTANT_BUFFER);
 		if (bindFlags & ER_RHI_BIND_FLAG::ER_BIND_CONSTANT_BUFFER)
 			assert(isDynamic);
 
@@ -56,6 +56,14 @@ namespace EveryRay_Core
 			destCPUHandle.GetCPUHandle().ptr += mDescriptorSize;
 		}
 
+		// creates the view in place (i.e., for upload ring allocations that have no CPU handle to copy from)
+		void AddCBVToHandle(ID3D12Device* device, ER_RHI_DX12_DescriptorHandle& destCPUHandle, const D3D12_CONSTANT_BUFFER_VIEW_DESC& cbvDesc)
+		{
+			assert(mHeapType == D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+			device->CreateConstantBufferView(&cbvDesc, destCPUHandle.GetCPUHandle());
+			destCPUHandle.GetCPUHandle().ptr += mDescriptorSize;
+		}
+
 	protected:
 		ComPtr<ID3D12DescriptorHeap> mDescriptorHeap;
 		D3D12_DESCRIPTOR_HEAP_TYPE mHeapType;
@@ -3,8 +3,200 @@
 #include "..\..\ER_Utility.h"
 #include "..\..\ER_CoreException.h"
 
+#include <iomanip>
+
 namespace EveryRay_Core
 {
+	namespace
+	{
+		UINT64 HashShaderBytecode(const D3D12_SHADER_BYTECODE& aBytecode, UINT64 aSeed)
+		{
+			UINT64 size = static_cast<UINT64>(aBytecode.BytecodeLength);
+			UINT64 hash = ER_Utility::HashFNV1a(&size, sizeof(size), aSeed);
+			if (aBytecode.pShaderBytecode && aBytecode.BytecodeLength > 0)
+				hash = ER_Utility::HashFNV1a(aBytecode.pShaderBytecode, aBytecode.BytecodeLength, hash);
+			return hash;
+		}
+
+		template<typename T>
+		UINT64 HashValue(const T& aValue, UINT64 aSeed)
+		{
+			return ER_Utility::HashFNV1a(&aValue, sizeof(T), aSeed);
+		}
+	}
+
+	ER_RHI_DX12_PSOCache::ER_RHI_DX12_PSOCache(ID3D12Device* aDevice) : mDevice(aDevice)
+	{
+		assert(aDevice);
+		LoadPipelineLibrary();
+	}
+
+	ER_RHI_DX12_PSOCache::~ER_RHI_DX12_PSOCache()
+	{
+		SavePipelineLibrary();
+
+		std::string message = "[ER Logger][ER_RHI_DX12_PSOCache] Pipelines: " + std::to_string(mPSOs.size()) +
+			", loaded from the library: " + std::to_string(mLibraryHitsCount) +
+			", deduplicated: " + std::to_string(mDeduplicatedCount) + "\n";
+		ER_OUTPUT_LOG(ER_Utility::ToWideString(message).c_str());
+
+		mPSOs.clear();
+		mLibrary.Reset();
+		mLibraryData.clear();
+	}
+
+	std::wstring ER_RHI_DX12_PSOCache::GetLibraryKey(UINT64 aHash)
+	{
+		std::wostringstream key;
+		key << std::hex << std::setw(16) << std::setfill(L'0') << aHash;
+		return key.str();
+	}
+
+	void ER_RHI_DX12_PSOCache::LoadPipelineLibrary()
+	{
+		if (FAILED(mDevice->QueryInterface(IID_PPV_ARGS(&mDevice1))))
+		{
+			ER_OUTPUT_LOG(L"[ER Logger][ER_RHI_DX12_PSOCache] ID3D12Device1 is not supported, pipelines will not be cached on disk\n");
+			return;
+		}
+
+		std::ifstream file(ER_Utility::GetFilePath(std::string(ER_RHI_DX12_PIPELINE_LIBRARY_PATH)).c_str(), std::ios::binary | std::ios::ate);
+		if (file.is_open())
+		{
+			std::streamsize size = file.tellg();
+			if (size > 0)
+			{
+				mLibraryData.resize(static_cast<size_t>(size));
+				file.seekg(0, std::ios::beg);
+				if (!file.read(mLibraryData.data(), size))
+					mLibraryData.clear();
+			}
+		}
+
+		if (!mLibraryData.empty())
+		{
+			// fails if the blob was written by another driver/adapter or is corrupted: start with an empty library then
+			HRESULT hr = mDevice1->CreatePipelineLibrary(mLibraryData.data(), mLibraryData.size(), IID_PPV_ARGS(&mLibrary));
+			if (SUCCEEDED(hr))
+			{
+				ER_OUTPUT_LOG(L"[ER Logger][ER_RHI_DX12_PSOCache] Loaded pipeline library from disk\n");
+				return;
+			}
+
+			ER_OUTPUT_LOG(L"[ER Logger][ER_RHI_DX12_PSOCache] Pipeline library on disk is incompatible or corrupted, recreating it\n");
+			mLibraryData.clear();
+			mIsLibraryDirty = true;
+		}
+
+		if (FAILED(mDevice1->CreatePipelineLibrary(nullptr, 0, IID_PPV_ARGS(&mLibrary))))
+		{
+			ER_OUTPUT_LOG(L"[ER Logger][ER_RHI_DX12_PSOCache] Pipeline libraries are not supported, pipelines will not be cached on disk\n");
+			mLibrary.Reset();
+			mIsLibraryDirty = false;
+		}
+	}
+
+	void ER_RHI_DX12_PSOCache::SavePipelineLibrary()
+	{
+		if (!mLibrary || !mIsLibraryDirty)
+			return;
+
+		SIZE_T size = mLibrary->GetSerializedSize();
+		if (size == 0)
+			return;
+
+		std::vector<char> data(size);
+		if (FAILED(mLibrary->Serialize(data.data(), size)))
+		{
+			ER_OUTPUT_LOG(L"[ER Logger][ER_RHI_DX12_PSOCache] Failed serializing pipeline library\n");
+			return;
+		}
+
+		const std::string path = ER_Utility::GetFilePath(std::string(ER_RHI_DX12_PIPELINE_LIBRARY_PATH));
+		std::string directory;
+		ER_Utility::GetDirectory(path, directory);
+		ER_Utility::CreateDirectories(directory);
+
+		std::ofstream file(path.c_str(), std::ios::binary | std::ios::trunc);
+		if (!file.is_open() || !file.write(data.data(), size))
+		{
+			ER_OUTPUT_LOG(L"[ER Logger][ER_RHI_DX12_PSOCache] Failed writing pipeline library to disk\n");
+			return;
+		}
+
+		mIsLibraryDirty = false;
+		ER_OUTPUT_LOG(L"[ER Logger][ER_RHI_DX12_PSOCache] Saved pipeline library to disk\n");
+	}
+
+	void ER_RHI_DX12_PSOCache::StoreInLibrary(const std::wstring& aKey, ID3D12PipelineState* aPSO)
+	{
+		if (!mLibrary)
+			return;
+
+		// E_INVALIDARG if the key is already stored (i.e. hash collision of 2 different descriptions): the pipeline just won't be cached
+		if (SUCCEEDED(mLibrary->StorePipeline(aKey.c_str(), aPSO)))
+			mIsLibraryDirty = true;
+	}
+
+	ID3D12PipelineState* ER_RHI_DX12_PSOCache::GetOrCreateGraphicsPSO(UINT64 aHash, const D3D12_GRAPHICS_PIPELINE_STATE_DESC& aDesc, const std::string& aName)
+	{
+		auto it = mPSOs.find(aHash);
+		if (it != mPSOs.end())
+		{
+			mDeduplicatedCount++;
+			return it->second.Get();
+		}
+
+		ComPtr<ID3D12PipelineState> pso;
+		const std::wstring key = GetLibraryKey(aHash);
+		if (mLibrary && SUCCEEDED(mLibrary->LoadGraphicsPipeline(key.c_str(), &aDesc, IID_PPV_ARGS(&pso))))
+			mLibraryHitsCount++;
+		else
+		{
+			pso.Reset();
+			if (FAILED(mDevice->CreateGraphicsPipelineState(&aDesc, IID_PPV_ARGS(&pso))))
+			{
+				std::string message = "ER_RHI_DX12: Failed creating graphics PSO: ";
+				message += aName;
+				throw ER_CoreException(message.c_str());
+			}
+			StoreInLibrary(key, pso.Get());
+		}
+		pso->SetName(ER_Utility::ToWideString(aName).c_str());
+
+		mPSOs.emplace(aHash, pso);
+		return pso.Get();
+	}
+
+	ID3D12PipelineState* ER_RHI_DX12_PSOCache::GetOrCreateComputePSO(UINT64 aHash, const D3D12_COMPUTE_PIPELINE_STATE_DESC& aDesc, const std::string& aName)
+	{
+		auto it = mPSOs.find(aHash);
+		if (it != mPSOs.end())
+		{
+			mDeduplicatedCount++;
+			return it->second.Get();
+		}
+
+		ComPtr<ID3D12PipelineState> pso;
+		const std::wstring key = GetLibraryKey(aHash);
+		if (mLibrary && SUCCEEDED(mLibrary->LoadComputePipeline(key.c_str(), &aDesc, IID_PPV_ARGS(&pso))))
+			mLibraryHitsCount++;
+		else
+		{
+			pso.Reset();
+			if (FAILED(mDevice->CreateComputePipelineState(&aDesc, IID_PPV_ARGS(&pso))))
+			{
+				std::string message = "ER_RHI_DX12: Failed creating compute PSO: ";
+				message += aName;
+				throw ER_CoreException(message.c_str());
+			}
+			StoreInLibrary(key, pso.Get());
+		}
+		pso->SetName(ER_Utility::ToWideString(aName).c_str());
+
+		mPSOs.emplace(aHash, pso);
+		return pso.Get();
+	}
 
 	ER_RHI_DX12_PSO::~ER_RHI_DX12_PSO()
 	{
@@ -52,29 +244,85 @@ namespace EveryRay_Core
 		mPSODesc.IBStripCutValue = IBProps;
 	}
 
-	void ER_RHI_DX12_GraphicsPSO::Finalize(ID3D12Device* device)
+	UINT64 ER_RHI_DX12_GraphicsPSO::ComputeHash() const
+	{
+		// fields are hashed one by one: the descs have padding, and pointers (bytecode, semantic names) must be hashed by content
+		UINT64 hash = mRootSignature->GetHash();
+		hash = HashShaderBytecode(mPSODesc.VS, hash);
+		hash = HashShaderBytecode(mPSODesc.PS, hash);
+		hash = HashShaderBytecode(mPSODesc.GS, hash);
+		hash = HashShaderBytecode(mPSODesc.HS, hash);
+		hash = HashShaderBytecode(mPSODesc.DS, hash);
+
+		hash = HashValue(mPSODesc.BlendState.AlphaToCoverageEnable, hash);
+		hash = HashValue(mPSODesc.BlendState.IndependentBlendEnable, hash);
+		const UINT blendTargetsCount = mPSODesc.BlendState.IndependentBlendEnable ? 8 : 1;
+		for (UINT i = 0; i < blendTargetsCount; i++)
+		{
+			const D3D12_RENDER_TARGET_BLEND_DESC& rt = mPSODesc.BlendState.RenderTarget[i];
+			hash = HashValue(rt.BlendEnable, hash);
+			hash = HashValue(rt.LogicOpEnable, hash);
+			hash = HashValue(rt.SrcBlend, hash);
+			hash = HashValue(rt.DestBlend, hash);
+			hash = HashValue(rt.BlendOp, hash);
+			hash = HashValue(rt.SrcBlendAlpha, hash);
+			hash = HashValue(rt.DestBlendAlpha, hash);
+			hash = HashValue(rt.BlendOpAlpha, hash);
+			hash = HashValue(rt.LogicOp, hash);
+			hash = HashValue(rt.RenderTargetWriteMask, hash);
+		}
+
+		hash = HashValue(mPSODesc.RasterizerState, hash); // no padding (4-byte fields only)
+
+		const D3D12_DEPTH_STENCIL_DESC& ds = mPSODesc.DepthStencilState;
+		hash = HashValue(ds.DepthEnable, hash);
+		hash = HashValue(ds.DepthWriteMask, hash);
+		hash = HashValue(ds.DepthFunc, hash);
+		hash = HashValue(ds.StencilEnable, hash);
+		hash = HashValue(ds.StencilReadMask, hash);
+		hash = HashValue(ds.StencilWriteMask, hash);
+		hash = HashValue(ds.FrontFace, hash);
+		hash = HashValue(ds.BackFace, hash);
+
+		hash = HashValue(mPSODesc.SampleMask, hash);
+		hash = HashValue(mPSODesc.SampleDesc, hash);
+		hash = HashValue(mPSODesc.IBStripCutValue, hash);
+		hash = HashValue(mPSODesc.PrimitiveTopologyType, hash);
+		hash = HashValue(mPSODesc.NumRenderTargets, hash);
+		for (UINT i = 0; i < mPSODesc.NumRenderTargets; i++)
+			hash = HashValue(mPSODesc.RTVFormats[i], hash);
+		hash = HashValue(mPSODesc.DSVFormat, hash);
+
+		hash = HashValue(mPSODesc.InputLayout.NumElements, hash);
+		const D3D12_INPUT_ELEMENT_DESC* elements = mInputLayouts.get();
+		for (UINT i = 0; elements && i < mPSODesc.InputLayout.NumElements; i++)
+		{
+			hash = ER_Utility::HashFNV1a(elements[i].SemanticName, strlen(elements[i].SemanticName), hash);
+			hash = HashValue(elements[i].SemanticIndex, hash);
+			hash = HashValue(elements[i].Format, hash);
+			hash = HashValue(elements[i].InputSlot, hash);
+			hash = HashValue(elements[i].AlignedByteOffset, hash);
+			hash = HashValue(elements[i].InputSlotClass, hash);
+			hash = HashValue(elements[i].InstanceDataStepRate, hash);
+		}
+		return hash;
+	}
+
+	void ER_RHI_DX12_GraphicsPSO::Finalize(ER_RHI_DX12_PSOCache* aCache)
 	{
+		assert(aCache);
 		mPSODesc.pRootSignature = mRootSignature->GetSignature();
 		assert(mPSODesc.pRootSignature != nullptr);
 
 		mPSODesc.InputLayout.pInputElementDescs = mInputLayouts.get();
 
-		HRESULT hr;
-		if (FAILED(hr = device->CreateGraphicsPipelineState(&mPSODesc, IID_PPV_ARGS(&mPSO))))
-		{
-			std::string message = "ER_RHI_DX12: Failed creating graphics PSO: ";
-			message += mName;
-			throw ER_CoreException(message.c_str());
-		}
-		else
-		{
-			std::string message = "[ER_Logger] ER_RHI_DX12: Finished creating graphics PSO: ";
-			message += mName;
-			message += '\n';
-			ER_OUTPUT_LOG(ER_Utility::ToWideString(message).c_str());
+		mHash = ComputeHash();
+		mPSO = aCache->GetOrCreateGraphicsPSO(mHash, mPSODesc, mName);
 
-			mPSO->SetName(ER_Utility::ToWideString(mName).c_str());
-		}
+		std::string message = "[ER_Logger] ER_RHI_DX12: Finished creating graphics PSO: ";
+		message += mName;
+		message += '\n';
+		ER_OUTPUT_LOG(ER_Utility::ToWideString(message).c_str());
 	}
 
 	void ER_RHI_DX12_GraphicsPSO::SetRenderTargetFormats(UINT NumRTVs, const DXGI_FORMAT* RTVFormats, DXGI_FORMAT DSVFormat)
@@ -130,27 +378,25 @@ namespace EveryRay_Core
 		mPSODesc.NodeMask = 1;
 	}
 
-	void ER_RHI_DX12_ComputePSO::Finalize(ID3D12Device* device)
+	UINT64 ER_RHI_DX12_ComputePSO::ComputeHash() const
 	{
+		UINT64 hash = mRootSignature->GetHash();
+		return HashShaderBytecode(mPSODesc.CS, hash);
+	}
+
+	void ER_RHI_DX12_ComputePSO::Finalize(ER_RHI_DX12_PSOCache* aCache)
+	{
+		assert(aCache);
 		mPSODesc.pRootSignature = mRootSignature->GetSignature();
 		assert(mPSODesc.pRootSignature != nullptr);
-		
-		HRESULT hr;
-		if (FAILED(hr = device->CreateComputePipelineState(&mPSODesc, IID_PPV_ARGS(&mPSO))))
-		{
-			std::string message = "ER_RHI_DX12: Failed creating compute PSO: ";
-			message += mName;
-			throw ER_CoreException(message.c_str());
-		}
-		else
-		{
-			std::string message = "[ER_Logger] ER_RHI_DX12: Finished creating compute PSO: ";
-			message += mName;
-			message += '\n';
-			ER_OUTPUT_LOG(ER_Utility::ToWideString(message).c_str());
-			
-			mPSO->SetName(ER_Utility::ToWideString(mName).c_str());
-		}
+
+		mHash = ComputeHash();
+		mPSO = aCache->GetOrCreateComputePSO(mHash, mPSODesc, mName);
+
+		std::string message = "[ER_Logger] ER_RHI_DX12: Finished creating compute PSO: ";
+		message += mName;
+		message += '\n';
+		ER_OUTPUT_LOG(ER_Utility::ToWideString(message).c_str());
 	}
 
 }
\ No newline at end of file
@@ -2,9 +2,48 @@
 
 #include "ER_RHI_DX12.h"
 
+#define ER_RHI_DX12_PIPELINE_LIBRARY_PATH "content\\cache\\pipelines\\ER_PipelineLibrary_DX12.bin"
+
 namespace EveryRay_Core
 {
 	class ER_RHI_DX12_GPURootSignature;
+
+	// Driver PSOs keyed by the 64-bit hash of their whole description (root signature, shaders, states, formats, topology, input layout):
+	// identical pipelines of different systems share one object. Created PSOs are stored in the driver's pipeline library,
+	// which is serialized to disk on shutdown, so warm starts load them instead of compiling.
+	class ER_RHI_DX12_PSOCache
+	{
+	public:
+		ER_RHI_DX12_PSOCache(ID3D12Device* aDevice);
+		~ER_RHI_DX12_PSOCache();
+
+		ID3D12PipelineState* GetOrCreateGraphicsPSO(UINT64 aHash, const D3D12_GRAPHICS_PIPELINE_STATE_DESC& aDesc, const std::string& aName);
+		ID3D12PipelineState* GetOrCreateComputePSO(UINT64 aHash, const D3D12_COMPUTE_PIPELINE_STATE_DESC& aDesc, const std::string& aName);
+
+		void SavePipelineLibrary(); // only if new pipelines were stored since the load
+
+		UINT GetPSOCount() const { return static_cast<UINT>(mPSOs.size()); }
+		UINT GetLibraryHitsCount() const { return mLibraryHitsCount; }
+		UINT GetDeduplicatedCount() const { return mDeduplicatedCount; }
+	private:
+		ER_RHI_DX12_PSOCache(const ER_RHI_DX12_PSOCache& rhs);
+		ER_RHI_DX12_PSOCache& operator=(const ER_RHI_DX12_PSOCache& rhs);
+
+		void LoadPipelineLibrary();
+		void StoreInLibrary(const std::wstring& aKey, ID3D12PipelineState* aPSO);
+		static std::wstring GetLibraryKey(UINT64 aHash);
+
+		ComPtr<ID3D12Device> mDevice;
+		ComPtr<ID3D12Device1> mDevice1; // pipeline libraries need it (Windows 10 Anniversary Update+)
+		ComPtr<ID3D12PipelineLibrary> mLibrary;
+		std::vector<char> mLibraryData; // must outlive mLibrary
+		bool mIsLibraryDirty = false;
+
+		std::unordered_map<UINT64, ComPtr<ID3D12PipelineState>> mPSOs;
+		UINT mLibraryHitsCount = 0;
+		UINT mDeduplicatedCount = 0;
+	};
+
 	class ER_RHI_DX12_PSO
 	{
 	public:
@@ -23,11 +62,17 @@ namespace EveryRay_Core
 		}
 
 		ID3D12PipelineState* GetPipelineStateObject() const { return mPSO.Get(); }
+		UINT64 GetHash() const { return mHash; }
+		const std::string& GetName() const { return mName; }
 
+		ER_RHI_PSO_HANDLE GetHandle() const { return mHandle; }
+		void SetHandle(ER_RHI_PSO_HANDLE aHandle) { mHandle = aHandle; }
 	protected:
 		const ER_RHI_DX12_GPURootSignature* mRootSignature;
-		ComPtr<ID3D12PipelineState> mPSO;
+		ComPtr<ID3D12PipelineState> mPSO; // owned by ER_RHI_DX12_PSOCache (shared with PSOs of the same description)
 		std::string mName;
+		UINT64 mHash = 0;
+		ER_RHI_PSO_HANDLE mHandle = ER_RHI_INVALID_PSO_HANDLE;
 	};
 
 	class ER_RHI_DX12_GraphicsPSO : public ER_RHI_DX12_PSO
@@ -56,8 +101,10 @@ namespace EveryRay_Core
 		void SetHullShader(const D3D12_SHADER_BYTECODE& Binary) { mPSODesc.HS = Binary; }
 		void SetDomainShader(const D3D12_SHADER_BYTECODE& Binary) { mPSODesc.DS = Binary; }
 
-		void Finalize(ID3D12Device* device);
+		void Finalize(ER_RHI_DX12_PSOCache* aCache);
 	private:
+		UINT64 ComputeHash() const;
+
 		D3D12_GRAPHICS_PIPELINE_STATE_DESC mPSODesc;
 		std::shared_ptr<const D3D12_INPUT_ELEMENT_DESC> mInputLayouts;
 	};
@@ -70,9 +117,11 @@ namespace EveryRay_Core
 		void SetComputeShader(const void* Binary, size_t Size) { mPSODesc.CS = CD3DX12_SHADER_BYTECODE(const_cast<void*>(Binary), Size); }
 		void SetComputeShader(const D3D12_SHADER_BYTECODE& Binary) { mPSODesc.CS = Binary; }
 
-		void Finalize(ID3D12Device* device);
+		void Finalize(ER_RHI_DX12_PSOCache* aCache);
 
 	private:
+		UINT64 ComputeHash() const;
+
 		D3D12_COMPUTE_PIPELINE_STATE_DESC mPSODesc;
 	};
 }
\ No newline at end of file
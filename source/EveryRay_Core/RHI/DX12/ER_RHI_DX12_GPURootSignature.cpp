@@ -172,6 +172,7 @@ namespace EveryRay_Core
 		}
 
 		mSignature->SetName(ER_Utility::ToWideString(name).c_str());
+		mHash = ER_Utility::HashFNV1a(pOutBlob->GetBufferPointer(), pOutBlob->GetBufferSize());
 		mIsFinalized = true;
 
 		if (pOutBlob)
@@ -155,12 +155,14 @@ namespace EveryRay_Core
 		void Finalize(ID3D12Device* device, const std::string& name, D3D12_ROOT_SIGNATURE_FLAGS Flags = D3D12_ROOT_SIGNATURE_FLAG_NONE);
 
 		ID3D12RootSignature* GetSignature() const { return mSignature.Get(); }
+		UINT64 GetHash() const { return mHash; } // of the serialized description (stable between runs, used in PSO hashes)
 	protected:
 		std::unique_ptr<ER_RHI_DX12_GPURootParameter[]> mRootParameters;
 		std::unique_ptr<D3D12_STATIC_SAMPLER_DESC[]> mStaticSamplers;
 		ComPtr<ID3D12RootSignature> mSignature;
 
 		bool mIsFinalized;
+		UINT64 mHash = 0;
 		UINT mNumParameters;
 		UINT mNumSamplers;
 		UINT mNumInitializedStaticSamplers;
@@ -25,87 +25,97 @@ namespace EveryRay_Core
 		mShaderType = type;
 
 		assert(aRHI);
-		ER_RHI_DX12* aDX12RHI = static_cast<ER_RHI_DX12*>(aRHI);
-		assert(aDX12RHI);
+		mRHI = static_cast<ER_RHI_DX12*>(aRHI);
+		assert(mRHI && mRHI->GetShaderCache());
 
 		assert(!shaderEntry.empty());
 
-		std::string compilerErrorMessage = "ER_RHI_DX12: Failed to compile blob from shader: " + path + " with shader entry: " + shaderEntry;
-
+		ER_RHI_ShaderCompileRequest request;
+		request.Path = path;
+		request.Entry = shaderEntry;
 		switch (mShaderType)
 		{
 		case ER_VERTEX:
-			if (FAILED(CompileBlob(ER_Utility::GetFilePath(ER_Utility::ToWideString(path)).c_str(), shaderEntry.c_str(), vertexShaderModel.c_str(), &mShaderBlob)))
-				throw ER_CoreException(compilerErrorMessage.c_str());
+			request.Profile = vertexShaderModel;
 			break;
 		case ER_PIXEL:
-			if (FAILED(CompileBlob(ER_Utility::GetFilePath(ER_Utility::ToWideString(path)).c_str(), shaderEntry.c_str(), pixelShaderModel.c_str(), &mShaderBlob)))
-				throw ER_CoreException(compilerErrorMessage.c_str());
+			request.Profile = pixelShaderModel;
 			break;
 		case ER_COMPUTE:
-			if (FAILED(CompileBlob(ER_Utility::GetFilePath(ER_Utility::ToWideString(path)).c_str(), shaderEntry.c_str(), computeShaderModel.c_str(), &mShaderBlob)))
-				throw ER_CoreException(compilerErrorMessage.c_str());
+			request.Profile = computeShaderModel;
 			break;
 		case ER_GEOMETRY:
-			if (FAILED(CompileBlob(ER_Utility::GetFilePath(ER_Utility::ToWideString(path)).c_str(), shaderEntry.c_str(), geometryShaderModel.c_str(), &mShaderBlob)))
-				throw ER_CoreException(compilerErrorMessage.c_str());
+			request.Profile = geometryShaderModel;
 			break;
 		case ER_TESSELLATION_HULL:
-			if (FAILED(CompileBlob(ER_Utility::GetFilePath(ER_Utility::ToWideString(path)).c_str(), shaderEntry.c_str(), hullShaderModel.c_str(), &mShaderBlob)))
-				throw ER_CoreException(compilerErrorMessage.c_str());
+			request.Profile = hullShaderModel;
 			break;
 		case ER_TESSELLATION_DOMAIN:
-			if (FAILED(CompileBlob(ER_Utility::GetFilePath(ER_Utility::ToWideString(path)).c_str(), shaderEntry.c_str(), domainShaderModel.c_str(), &mShaderBlob)))
-				throw ER_CoreException(compilerErrorMessage.c_str());
+			request.Profile = domainShaderModel;
 			break;
 		}
+		request.Defines.push_back(std::make_pair("ER_PLATFORM_DX12", "1"));
+		request.Flags = D3DCOMPILE_ENABLE_STRICTNESS;
+		request.Flags |= D3DCOMPILE_ALL_RESOURCES_BOUND;
+#if defined( DEBUG ) || defined( _DEBUG )
+		request.Flags |= D3DCOMPILE_DEBUG;
+#endif
+
+		// compilation runs on the job system, the blob is needed only when the PSO is finalized
+		mPendingBytecode = mRHI->GetShaderCache()->Request(request);
+	}
+
+	void ER_RHI_DX12_GPUShader::Resolve()
+	{
+		if (!mPendingBytecode)
+			return;
+
+		mRHI->GetShaderCache()->Wait(*mPendingBytecode);
+		if (!mPendingBytecode->IsValid())
+			throw ER_CoreException(mPendingBytecode->GetErrors().c_str());
+
+		const std::vector<char>& bytecode = mPendingBytecode->GetBytecode();
+		ReleaseObject(mShaderBlob);
+		if (FAILED(D3DCreateBlob(bytecode.size(), &mShaderBlob)))
+			throw ER_CoreException("ER_RHI_DX12: Failed to create blob for shader bytecode");
+		memcpy(mShaderBlob->GetBufferPointer(), bytecode.data(), bytecode.size());
+
+		mPendingBytecode.reset();
 	}
 
 	void* ER_RHI_DX12_GPUShader::GetShaderObject()
 	{
+		Resolve();
 		return mShaderBlob;
 	}
 
-	HRESULT ER_RHI_DX12_GPUShader::CompileBlob(_In_ LPCWSTR srcFile, _In_ LPCSTR entryPoint, _In_ LPCSTR profile, _Outptr_ ID3DBlob** blob)
+	bool ER_RHI_DX12_GPUShader::CompileBytecode(const ER_RHI_ShaderCompileRequest& aRequest, std::vector<char>& outBytecode, std::string& outErrors)
 	{
-		if (!srcFile || !entryPoint || !profile || !blob)
-			return E_INVALIDARG;
-
-		*blob = nullptr;
-
-		UINT flags = D3DCOMPILE_ENABLE_STRICTNESS;
-		flags |= D3DCOMPILE_ALL_RESOURCES_BOUND;
-#if defined( DEBUG ) || defined( _DEBUG )
-		flags |= D3DCOMPILE_DEBUG;
-#endif
-
-		const D3D_SHADER_MACRO defines[] =
-		{
-			"ER_PLATFORM_DX12", "1",
-			NULL, NULL
-		};
+		std::vector<D3D_SHADER_MACRO> defines;
+		for (auto& define : aRequest.Defines)
+			defines.push_back({ define.first.c_str(), define.second.c_str() });
+		defines.push_back({ NULL, NULL });
 
 		ID3DBlob* shaderBlob = nullptr;
 		ID3DBlob* errorBlob = nullptr;
-		HRESULT hr = D3DCompileFromFile(srcFile, defines, D3D_COMPILE_STANDARD_FILE_INCLUDE,
-			entryPoint, profile,
-			flags, 0, &shaderBlob, &errorBlob);
+		HRESULT hr = D3DCompileFromFile(ER_Utility::GetFilePath(ER_Utility::ToWideString(aRequest.Path)).c_str(), defines.data(), D3D_COMPILE_STANDARD_FILE_INCLUDE,
+			aRequest.Entry.c_str(), aRequest.Profile.c_str(),
+			aRequest.Flags, 0, &shaderBlob, &errorBlob);
+		if (errorBlob)
+		{
+			outErrors.assign(static_cast<const char*>(errorBlob->GetBufferPointer()), errorBlob->GetBufferSize());
+			OutputDebugStringA(outErrors.c_str());
+			errorBlob->Release();
+		}
 		if (FAILED(hr))
 		{
-			if (errorBlob)
-			{
-				OutputDebugStringA((char*)errorBlob->GetBufferPointer());
-				errorBlob->Release();
-			}
-
-			if (shaderBlob)
-				shaderBlob->Release();
-
-			return hr;
+			ReleaseObject(shaderBlob);
+			return false;
 		}
 
-		*blob = shaderBlob;
-
-		return hr;
+		const char* data = static_cast<const char*>(shaderBlob->GetBufferPointer());
+		outBytecode.assign(data, data + shaderBlob->GetBufferSize());
+		shaderBlob->Release();
+		return true;
 	}
 }
\ No newline at end of file
@@ -340,57 +340,7 @@ namespace EveryRay_Core
 				return;
 			}
 
-			// Create the GPU upload buffer and update subresources
-			const UINT64 uploadBufferSize = GetRequiredIntermediateSize(mResource.Get(), 0, static_cast<UINT>(subresources.size()));
-			if (FAILED(device->CreateCommittedResource(&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD), D3D12_HEAP_FLAG_NONE, &CD3DX12_RESOURCE_DESC::Buffer(uploadBufferSize), D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&mResourceUpload))))
-				throw ER_CoreException("ER_RHI_DX12: Could not create a committed resource for the GPU texture resource (upload)");
-
-			{
-				int cmdIndex = aRHIDX12->GetCurrentGraphicsCommandListIndex();
-				auto commandList = aRHIDX12->GetGraphicsCommandList(cmdIndex);
-				UpdateSubresources(commandList, mResource.Get(), mResourceUpload.Get(), 0, 0, static_cast<UINT>(subresources.size()), subresources.data());
-
-				auto barrier = CD3DX12_RESOURCE_BARRIER::Transition(mResource.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-				commandList->ResourceBarrier(1, &barrier);
-
-				mCurrentResourceState = ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
-			}
-
-			mSRVHandle = descriptorHeapManager->CreateCPUHandle(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
-			D3D12_RESOURCE_DESC desc = mResource->GetDesc();
-			D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-			srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-			srvDesc.Format = desc.Format;
-			if (isCubemap)
-			{
-				srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURECUBE;
-				srvDesc.TextureCube.MipLevels = desc.MipLevels;
-			}
-			else if (desc.Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE2D)
-			{
-				if (desc.DepthOrArraySize > 1)
-				{
-					srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
-					srvDesc.Texture2DArray.MipLevels = desc.MipLevels;
-					srvDesc.Texture2DArray.ArraySize = desc.DepthOrArraySize;
-				}
-				else
-				{
-					srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-					srvDesc.Texture2D.MipLevels = desc.MipLevels;
-				}
-			}
-			else if (desc.Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE3D)
-			{
-				srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE3D;
-				srvDesc.Texture3D.MipLevels = desc.MipLevels;
-			}
-			device->CreateShaderResourceView(mResource.Get(), &srvDesc, mSRVHandle.GetCPUHandle());
-			
-			mMipLevels = desc.MipLevels;
-			mFormat = desc.Format;
-			mWidth = static_cast<UINT>(desc.Width);
-			mHeight = static_cast<UINT>(desc.Height);
+			UploadDDSSubresources(aRHIDX12, subresources, isCubemap);
 
 			if (statusFlag)
 				*statusFlag = true;
@@ -408,35 +358,7 @@ namespace EveryRay_Core
 
 				return;
 			}
-			// Create the GPU upload buffer and update subresources
-			const UINT64 uploadBufferSize = GetRequiredIntermediateSize(mResource.Get(), 0, 1);
-			if (FAILED(device->CreateCommittedResource(&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD), D3D12_HEAP_FLAG_NONE, &CD3DX12_RESOURCE_DESC::Buffer(uploadBufferSize), D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&mResourceUpload))))
-				throw ER_CoreException("ER_RHI_DX12: Could not create a committed resource for the GPU texture resource (upload)");
-
-			{
-				int cmdIndex = aRHIDX12->GetCurrentGraphicsCommandListIndex();
-				auto commandList = aRHIDX12->GetGraphicsCommandList(cmdIndex);
-				UpdateSubresources(commandList, mResource.Get(), mResourceUpload.Get(), 0, 0, 1, &subresource);
-
-				auto barrier = CD3DX12_RESOURCE_BARRIER::Transition(mResource.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-				commandList->ResourceBarrier(1, &barrier);
-
-				mCurrentResourceState = ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
-			}
-
-			mSRVHandle = descriptorHeapManager->CreateCPUHandle(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
-			D3D12_RESOURCE_DESC desc = mResource->GetDesc();
-			D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-			srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-			srvDesc.Format = desc.Format;
-			srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-			srvDesc.Texture2D.MipLevels = 1;
-			device->CreateShaderResourceView(mResource.Get(), &srvDesc, mSRVHandle.GetCPUHandle());
-			
-			mMipLevels = desc.MipLevels;
-			mFormat = desc.Format;
-			mWidth = static_cast<UINT>(desc.Width);
-			mHeight = static_cast<UINT>(desc.Height);
+			UploadWICSubresource(aRHIDX12, subresource);
 
 			if (statusFlag)
 				*statusFlag = true;
@@ -577,6 +499,150 @@ namespace EveryRay_Core
 		return 1 + static_cast<UINT>(floor(log2(std::max(mWidth, mHeight))));
 	}
 
+	// Upload of the loaded DDS subresources + SRV (on the current graphics command list)
+	void ER_RHI_DX12_GPUTexture::UploadDDSSubresources(ER_RHI_DX12* aRHIDX12, const std::vector<D3D12_SUBRESOURCE_DATA>& subresources, bool isCubemap)
+	{
+		ID3D12Device* device = aRHIDX12->GetDevice();
+		ER_RHI_DX12_GPUDescriptorHeapManager* descriptorHeapManager = aRHIDX12->GetDescriptorHeapManager();
+		assert(device && descriptorHeapManager);
+
+		// Create the GPU upload buffer and update subresources
+		const UINT64 uploadBufferSize = GetRequiredIntermediateSize(mResource.Get(), 0, static_cast<UINT>(subresources.size()));
+		if (FAILED(device->CreateCommittedResource(&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD), D3D12_HEAP_FLAG_NONE, &CD3DX12_RESOURCE_DESC::Buffer(uploadBufferSize), D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&mResourceUpload))))
+			throw ER_CoreException("ER_RHI_DX12: Could not create a committed resource for the GPU texture resource (upload)");
+
+		{
+			int cmdIndex = aRHIDX12->GetCurrentGraphicsCommandListIndex();
+			auto commandList = aRHIDX12->GetGraphicsCommandList(cmdIndex);
+			UpdateSubresources(commandList, mResource.Get(), mResourceUpload.Get(), 0, 0, static_cast<UINT>(subresources.size()), subresources.data());
+
+			auto barrier = CD3DX12_RESOURCE_BARRIER::Transition(mResource.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+			commandList->ResourceBarrier(1, &barrier);
+
+			mCurrentResourceState = ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
+		}
+
+		if (!mSRVHandle.IsValid()) // reloads into the same texture (i.e., a light probe's cubemap) rewrite the existing descriptor
+			mSRVHandle = descriptorHeapManager->CreateCPUHandle(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+		D3D12_RESOURCE_DESC desc = mResource->GetDesc();
+		D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+		srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+		srvDesc.Format = desc.Format;
+		if (isCubemap)
+		{
+			srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURECUBE;
+			srvDesc.TextureCube.MipLevels = desc.MipLevels;
+		}
+		else if (desc.Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE2D)
+		{
+			if (desc.DepthOrArraySize > 1)
+			{
+				srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
+				srvDesc.Texture2DArray.MipLevels = desc.MipLevels;
+				srvDesc.Texture2DArray.ArraySize = desc.DepthOrArraySize;
+			}
+			else
+			{
+				srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+				srvDesc.Texture2D.MipLevels = desc.MipLevels;
+			}
+		}
+		else if (desc.Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE3D)
+		{
+			srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE3D;
+			srvDesc.Texture3D.MipLevels = desc.MipLevels;
+		}
+		device->CreateShaderResourceView(mResource.Get(), &srvDesc, mSRVHandle.GetCPUHandle());
+		
+		mMipLevels = desc.MipLevels;
+		mFormat = desc.Format;
+		mWidth = static_cast<UINT>(desc.Width);
+		mHeight = static_cast<UINT>(desc.Height);
+	}
+
+	// Records the upload into the current graphics command list (main thread only); WIC images are loaded without mips (see GenerateMipsIntoNewTexture())
+	void ER_RHI_DX12_GPUTexture::CreateGPUTextureResource(ER_RHI* aRHI, const UINT8* aData, UINT64 aDataSize, bool* statusFlag)
+	{
+		assert(aRHI && aData);
+		ER_RHI_DX12* aRHIDX12 = static_cast<ER_RHI_DX12*>(aRHI);
+		ID3D12Device* device = aRHIDX12->GetDevice();
+		assert(device);
+
+		mIsLoadedFromFile = true;
+		mCurrentResourceState = ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_COPY_DEST;
+
+		const bool isDDS = aDataSize >= 4 && memcmp(aData, "DDS ", 4) == 0;
+		if (isDDS)
+		{
+			std::vector<D3D12_SUBRESOURCE_DATA> subresources;
+			bool isCubemap = false;
+			if (FAILED(DirectX::LoadDDSTextureFromMemory(device, aData, static_cast<size_t>(aDataSize), &mResource, subresources, 0, nullptr, &isCubemap)))
+			{
+				ER_OUTPUT_LOG(L"[ER Logger][ER_RHI_DX12_GPUTexture] Failed to load DDS texture from memory. \n");
+				if (statusFlag)
+					*statusFlag = false;
+				return;
+			}
+
+			UploadDDSSubresources(aRHIDX12, subresources, isCubemap);
+		}
+		else
+		{
+			std::unique_ptr<uint8_t[]> decodedData;
+			D3D12_SUBRESOURCE_DATA subresource;
+			if (FAILED(DirectX::LoadWICTextureFromMemory(device, aData, static_cast<size_t>(aDataSize), &mResource, decodedData, subresource)))
+			{
+				ER_OUTPUT_LOG(L"[ER Logger][ER_RHI_DX12_GPUTexture] Failed to load WIC texture from memory. \n");
+				if (statusFlag)
+					*statusFlag = false;
+				return;
+			}
+
+			UploadWICSubresource(aRHIDX12, subresource);
+		}
+
+		if (statusFlag)
+			*statusFlag = true;
+	}
+
+	void ER_RHI_DX12_GPUTexture::UploadWICSubresource(ER_RHI_DX12* aRHIDX12, const D3D12_SUBRESOURCE_DATA& subresource)
+	{
+		ID3D12Device* device = aRHIDX12->GetDevice();
+		ER_RHI_DX12_GPUDescriptorHeapManager* descriptorHeapManager = aRHIDX12->GetDescriptorHeapManager();
+		assert(descriptorHeapManager);
+
+		// Create the GPU upload buffer and update subresources
+		const UINT64 uploadBufferSize = GetRequiredIntermediateSize(mResource.Get(), 0, 1);
+		if (FAILED(device->CreateCommittedResource(&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD), D3D12_HEAP_FLAG_NONE, &CD3DX12_RESOURCE_DESC::Buffer(uploadBufferSize), D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&mResourceUpload))))
+			throw ER_CoreException("ER_RHI_DX12: Could not create a committed resource for the GPU texture resource (upload)");
+
+		{
+			int cmdIndex = aRHIDX12->GetCurrentGraphicsCommandListIndex();
+			auto commandList = aRHIDX12->GetGraphicsCommandList(cmdIndex);
+			UpdateSubresources(commandList, mResource.Get(), mResourceUpload.Get(), 0, 0, 1, &subresource);
+
+			auto barrier = CD3DX12_RESOURCE_BARRIER::Transition(mResource.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+			commandList->ResourceBarrier(1, &barrier);
+
+			mCurrentResourceState = ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
+		}
+
+		if (!mSRVHandle.IsValid()) // reloads into the same texture (i.e., a light probe's cubemap) rewrite the existing descriptor
+			mSRVHandle = descriptorHeapManager->CreateCPUHandle(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+		D3D12_RESOURCE_DESC desc = mResource->GetDesc();
+		D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+		srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+		srvDesc.Format = desc.Format;
+		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+		srvDesc.Texture2D.MipLevels = 1;
+		device->CreateShaderResourceView(mResource.Get(), &srvDesc, mSRVHandle.GetCPUHandle());
+
+		mMipLevels = desc.MipLevels;
+		mFormat = desc.Format;
+		mWidth = static_cast<UINT>(desc.Width);
+		mHeight = static_cast<UINT>(desc.Height);
+	}
+
 	void ER_RHI_DX12_GPUTexture::LoadFallbackTexture(ER_RHI* aRHI)
 	{
 		assert(aRHI);
@@ -1,19 +1,29 @@
 #pragma once
 #include "..\Common.h"
 
+#include <array>
+#include <initializer_list>
+
 #define ER_RHI_MAX_GRAPHICS_COMMAND_LISTS 8
 #define ER_RHI_MAX_COMPUTE_COMMAND_LISTS 2
 #define ER_RHI_MAX_BOUND_VERTEX_BUFFERS 2 //we only support 1 vertex buffer + 1 instance buffer
+#define ER_RHI_UPLOAD_RING_SIZE (8 * 1024 * 1024) // bytes per frame (per back buffer on DX12), tune with ER_RHI::GetUploadRingStats()
+#define ER_RHI_UPLOAD_RING_CB_ALIGNMENT 256 // constant buffers are bound from the ring by offset (256 bytes on D3D12, 16 constants on D3D11.1)
 
 namespace EveryRay_Core
 {
 	static const int DefaultFrameRate = 60;
+
+	// Integer handle of a finalized PSO (see ER_RHI::FinalizePSO()), cheaper to set every frame than a name
+	typedef UINT ER_RHI_PSO_HANDLE;
+	static const ER_RHI_PSO_HANDLE ER_RHI_INVALID_PSO_HANDLE = 0xFFFFFFFF;
 	static inline void AbstractRHIMethodAssert() { assert(("You called an abstract method from ER_RHI", 0)); }
 
 	enum ER_GRAPHICS_API
 	{
 		DX11,
-		DX12
+		DX12,
+		NULL_RHI // headless (no graphics API), see ER_RHI_Null
 	};
 
 	enum ER_RHI_SHADER_TYPE
@@ -237,6 +247,109 @@ namespace EveryRay_Core
 		LONG bottom;
 	};
 
+	// Arguments of DrawIndexedInstancedIndirect() (same layout as D3D11_DRAW_INDEXED_INSTANCED_INDIRECT_ARGS and D3D12_DRAW_INDEXED_ARGUMENTS)
+	struct ER_RHI_DRAW_INDEXED_INSTANCED_ARGS
+	{
+		UINT IndexCountPerInstance;
+		UINT InstanceCount;
+		UINT StartIndexLocation;
+		INT BaseVertexLocation;
+		UINT StartInstanceLocation;
+	};
+
+	// Non-owning view of the elements passed to the binding calls (valid only for the duration of the call, never store it).
+	// Can be made from a braced list (i.e., { vb, instanceBuffer }, which lives on the stack), a C array, std::array or std::vector without a heap allocation.
+	template<typename T>
+	class ER_RHI_Span
+	{
+	public:
+		ER_RHI_Span() {}
+		ER_RHI_Span(const T* aData, size_t aSize) : mData(aData), mSize(aSize) {}
+		ER_RHI_Span(std::initializer_list<T> aList) : mData(aList.begin()), mSize(aList.size()) {}
+		ER_RHI_Span(const std::vector<T>& aVector) : mData(aVector.data()), mSize(aVector.size()) {}
+		template<size_t N> ER_RHI_Span(const T(&aArray)[N]) : mData(aArray), mSize(N) {}
+		template<size_t N> ER_RHI_Span(const std::array<T, N>& aArray) : mData(aArray.data()), mSize(N) {}
+
+		const T& operator[](size_t index) const { assert(index < mSize); return mData[index]; }
+		const T* data() const { return mData; }
+		size_t size() const { return mSize; }
+		bool empty() const { return mSize == 0; }
+		const T* begin() const { return mData; }
+		const T* end() const { return mData + mSize; }
+	private:
+		const T* mData = nullptr;
+		size_t mSize = 0;
+	};
+
+	// Per-frame statistics of the binding calls (see ER_RHI::GetBindingStats()): backends keep a shadow copy of the bound state
+	// and drop the binds that would set the same values again
+	struct ER_RHI_BindingStats
+	{
+		UINT IssuedBindsCount = 0; // calls that reached the graphics API
+		UINT FilteredBindsCount = 0; // redundant calls that were dropped
+	};
+
+	// Per-frame statistics of the upload ring (see ER_RHI::GetUploadRingStats())
+	struct ER_RHI_UploadRingStats
+	{
+		UINT64 CapacityBytes = 0; // per frame
+		UINT64 AllocatedBytes = 0; // last frame
+		UINT64 PeakAllocatedBytes = 0; // max. of all frames
+		UINT AllocationsCount = 0; // last frame
+		UINT OverflowsCount = 0; // last frame: uploads that did not fit and fell back to the buffer's own memory
+	};
+
+	// Linear sub-allocator of one frame of the upload ring (memory is owned by the RHI implementation)
+	class ER_RHI_UploadRingAllocator
+	{
+	public:
+		void Initialize(UINT64 aCapacity)
+		{
+			mCapacity = aCapacity;
+			mOffset = 0;
+			mAllocatedBytes = 0;
+			mAllocationsCount = 0;
+			mOverflowsCount = 0;
+		}
+
+		// false - overflow (the caller falls back to its own memory)
+		bool Allocate(UINT64 aSize, UINT64 aAlignment, UINT64& outOffset)
+		{
+			assert(aAlignment > 0 && (aAlignment & (aAlignment - 1)) == 0);
+			UINT64 offset = (mOffset + aAlignment - 1) & ~(aAlignment - 1);
+			if (offset + aSize > mCapacity)
+			{
+				mOverflowsCount++;
+				return false;
+			}
+
+			outOffset = offset;
+			mOffset = offset + aSize;
+			mAllocatedBytes += aSize;
+			mAllocationsCount++;
+			return true;
+		}
+
+		// adds this frame's numbers to outStats (several rings can be reported together) and starts a new frame
+		void EndFrame(ER_RHI_UploadRingStats& outStats)
+		{
+			outStats.CapacityBytes += mCapacity;
+			outStats.AllocatedBytes += mAllocatedBytes;
+			outStats.AllocationsCount += mAllocationsCount;
+			outStats.OverflowsCount += mOverflowsCount;
+			Initialize(mCapacity);
+		}
+
+		UINT64 GetCapacity() const { return mCapacity; }
+		bool HasOverflowed() const { return mOverflowsCount > 0; }
+	private:
+		UINT64 mCapacity = 0;
+		UINT64 mOffset = 0;
+		UINT64 mAllocatedBytes = 0;
+		UINT mAllocationsCount = 0;
+		UINT mOverflowsCount = 0;
+	};
+
 	class ER_RHI_InputLayout
 	{
 	public:
@@ -259,6 +372,7 @@ namespace EveryRay_Core
 	class ER_RHI_GPUTexture;
 	class ER_RHI_GPUBuffer;
 	class ER_RHI_GPUShader;
+	class ER_RHI_ShaderCache;
 
 	class ER_RHI
 	{
@@ -305,13 +419,16 @@ namespace EveryRay_Core
 		virtual void DrawIndexed(UINT IndexCount) = 0;
 		virtual void DrawInstanced(UINT VertexCountPerInstance, UINT InstanceCount, UINT StartVertexLocation, UINT StartInstanceLocation) = 0;
 		virtual void DrawIndexedInstanced(UINT IndexCountPerInstance, UINT InstanceCount, UINT StartIndexLocation, INT BaseVertexLocation, UINT StartInstanceLocation) = 0;
-		//TODO DrawIndirect
+		// aArgsBuffer holds ER_RHI_DRAW_INDEXED_INSTANCED_ARGS (i.e., written by a compute shader); it must be created with ER_RESOURCE_MISC_DRAWINDIRECT_ARGS
+		virtual void DrawIndexedInstancedIndirect(ER_RHI_GPUBuffer* aArgsBuffer, UINT aArgsOffset) = 0;
 
 		virtual void Dispatch(UINT ThreadGroupCountX, UINT ThreadGroupCountY, UINT ThreadGroupCountZ) = 0;
 		//TODO DispatchIndirect
 
 		virtual void GenerateMips(ER_RHI_GPUTexture* aTexture, ER_RHI_GPUTexture* aSRGBTexture = nullptr) = 0;
 		virtual void GenerateMipsWithTextureReplacement(ER_RHI_GPUTexture** aTexture, std::function<void(ER_RHI_GPUTexture**)> aReplacementCallback) = 0;
+		// Same as above but returns the new texture right away (nullptr if the backend does not need it); the original can be deleted only after the GPU is done with the copy
+		virtual ER_RHI_GPUTexture* GenerateMipsIntoNewTexture(ER_RHI_GPUTexture* aTexture) = 0;
 		virtual void ReplaceOriginalTexturesWithMipped() = 0;
 
 		virtual void ExecuteCommandLists(int commandListIndex = 0, bool isCompute = false) = 0;
@@ -321,13 +438,15 @@ namespace EveryRay_Core
 		virtual void PresentCompute() = 0;
 
 		virtual bool ProjectCubemapToSH(ER_RHI_GPUTexture* aTexture, UINT order, float* resultR, float* resultG, float* resultB) = 0; //WARNING: only works on DX11 for now
+		// Linear RGBA texels of one mip of all array slices (i.e., cubemap faces), slice after slice; WARNING: only works on DX11 for now
+		virtual bool ReadGPUTextureToCPU(ER_RHI_GPUTexture* aTexture, UINT aMip, std::vector<XMFLOAT4>& aOutTexels) = 0;
 
 		virtual void SaveGPUTextureToFile(ER_RHI_GPUTexture* aTexture, const std::wstring& aPathName) = 0; //WARNING: only works on DX11 for now
 
 		virtual void SetMainRenderTargets(int cmdListIndex = 0) = 0;
-		virtual void SetRenderTargets(const std::vector<ER_RHI_GPUTexture*>& aRenderTargets, ER_RHI_GPUTexture* aDepthTarget = nullptr, ER_RHI_GPUTexture* aUAV = nullptr, int rtvArrayIndex = -1) = 0;
+		virtual void SetRenderTargets(ER_RHI_Span<ER_RHI_GPUTexture*> aRenderTargets, ER_RHI_GPUTexture* aDepthTarget = nullptr, ER_RHI_GPUTexture* aUAV = nullptr, int rtvArrayIndex = -1) = 0;
 		virtual void SetDepthTarget(ER_RHI_GPUTexture* aDepthTarget) = 0;
-		virtual void SetRenderTargetFormats(const std::vector<ER_RHI_GPUTexture*>& aRenderTargets, ER_RHI_GPUTexture* aDepthTarget = nullptr) = 0;
+		virtual void SetRenderTargetFormats(ER_RHI_Span<ER_RHI_GPUTexture*> aRenderTargets, ER_RHI_GPUTexture* aDepthTarget = nullptr) = 0;
 		virtual void SetMainRenderTargetFormats() = 0;
 
 		virtual void SetDepthStencilState(ER_RHI_DEPTH_STENCIL_STATE aDS, UINT stencilRef = 0xffffffff) = 0;
@@ -347,18 +466,18 @@ namespace EveryRay_Core
 
 		virtual void SetShader(ER_RHI_GPUShader* aShader) = 0;
 		
-		virtual void SetShaderResources(ER_RHI_SHADER_TYPE aShaderType, const std::vector<ER_RHI_GPUResource*>& aSRVs, UINT startSlot = 0,
+		virtual void SetShaderResources(ER_RHI_SHADER_TYPE aShaderType, ER_RHI_Span<ER_RHI_GPUResource*> aSRVs, UINT startSlot = 0,
 			ER_RHI_GPURootSignature* rs = nullptr, int rootParamIndex = -1, bool isComputeRS = false, bool skipAutomaticTransition = false) = 0;
-		virtual void SetUnorderedAccessResources(ER_RHI_SHADER_TYPE aShaderType, const std::vector<ER_RHI_GPUResource*>& aUAVs, UINT startSlot = 0,
+		virtual void SetUnorderedAccessResources(ER_RHI_SHADER_TYPE aShaderType, ER_RHI_Span<ER_RHI_GPUResource*> aUAVs, UINT startSlot = 0,
 			ER_RHI_GPURootSignature* rs = nullptr, int rootParamIndex = -1, bool isComputeRS = false, bool skipAutomaticTransition = false) = 0;
-		virtual void SetConstantBuffers(ER_RHI_SHADER_TYPE aShaderType, const std::vector<ER_RHI_GPUBuffer*>& aCBs, UINT startSlot = 0,
+		virtual void SetConstantBuffers(ER_RHI_SHADER_TYPE aShaderType, ER_RHI_Span<ER_RHI_GPUBuffer*> aCBs, UINT startSlot = 0,
 			ER_RHI_GPURootSignature* rs = nullptr, int rootParamIndex = -1, bool isComputeRS = false) = 0;
-		virtual void SetSamplers(ER_RHI_SHADER_TYPE aShaderType, const std::vector<ER_RHI_SAMPLER_STATE>& aSamplers, UINT startSlot = 0, ER_RHI_GPURootSignature* rs = nullptr) = 0;
+		virtual void SetSamplers(ER_RHI_SHADER_TYPE aShaderType, ER_RHI_Span<ER_RHI_SAMPLER_STATE> aSamplers, UINT startSlot = 0, ER_RHI_GPURootSignature* rs = nullptr) = 0;
 		
 		virtual void SetRootSignature(ER_RHI_GPURootSignature* rs, bool isCompute = false) = 0;
 		
 		virtual void SetIndexBuffer(ER_RHI_GPUBuffer* aBuffer, UINT offset = 0) = 0;
-		virtual void SetVertexBuffers(const std::vector<ER_RHI_GPUBuffer*>& aVertexBuffers) = 0;
+		virtual void SetVertexBuffers(ER_RHI_Span<ER_RHI_GPUBuffer*> aVertexBuffers) = 0;
 		virtual void SetInputLayout(ER_RHI_InputLayout* aIL) = 0;
 		virtual void SetEmptyInputLayout() = 0;
 
@@ -368,22 +487,35 @@ namespace EveryRay_Core
 		virtual void SetGPUDescriptorHeap(ER_RHI_DESCRIPTOR_HEAP_TYPE aType, bool aReset) = 0;
 		virtual void SetGPUDescriptorHeapImGui(int cmdListIndex) = 0;
 
-		virtual void TransitionResources(const std::vector<ER_RHI_GPUResource*>& aResources, const std::vector<ER_RHI_RESOURCE_STATE>& aStates, int cmdListIndex = 0, bool isCopyQueue = false, int subresourceIndex = -1) = 0;
-		virtual void TransitionResources(const std::vector<ER_RHI_GPUResource*>& aResources, ER_RHI_RESOURCE_STATE aState, int cmdListIndex = 0, bool isCopyQueue = false, int subresourceIndex = -1) = 0;
+		virtual void TransitionResources(ER_RHI_Span<ER_RHI_GPUResource*> aResources, ER_RHI_Span<ER_RHI_RESOURCE_STATE> aStates, int cmdListIndex = 0, bool isCopyQueue = false, int subresourceIndex = -1) = 0;
+		virtual void TransitionResources(ER_RHI_Span<ER_RHI_GPUResource*> aResources, ER_RHI_RESOURCE_STATE aState, int cmdListIndex = 0, bool isCopyQueue = false, int subresourceIndex = -1) = 0;
 		virtual void TransitionMainRenderTargetToPresent(int cmdListIndex = 0) = 0;
 
 		virtual bool IsPSOReady(const std::string& aName, bool isCompute = false) = 0;
 		virtual void InitializePSO(const std::string& aName, bool isCompute = false) = 0;
 		virtual void SetRootSignatureToPSO(const std::string& aName, ER_RHI_GPURootSignature* rs, bool isCompute = false) = 0;
 		virtual void SetTopologyTypeToPSO(const std::string& aName, ER_RHI_PRIMITIVE_TYPE aType) = 0;
-		virtual void FinalizePSO(const std::string& aName, bool isCompute = false) = 0;
+		// returns the handle of the PSO (or ER_RHI_INVALID_PSO_HANDLE if the API has no PSOs, i.e. DX11: then the states are set while "building" the PSO every time)
+		virtual ER_RHI_PSO_HANDLE FinalizePSO(const std::string& aName, bool isCompute = false) = 0;
+		virtual ER_RHI_PSO_HANDLE GetPSOHandle(const std::string& aName, bool isCompute = false) = 0;
 		virtual void SetPSO(const std::string& aName, bool isCompute = false) = 0;
+		virtual void SetPSO(ER_RHI_PSO_HANDLE aHandle, bool isCompute = false) = 0;
 		virtual void UnsetPSO() = 0;
 
 		virtual void UnbindRenderTargets() = 0;
 		virtual void UnbindResourcesFromShader(ER_RHI_SHADER_TYPE aShaderType, bool unbindShader = true) = 0;
 
+		// Dynamic constant buffers (ER_RHI_GPUConstantBuffer) are sub-allocated from the upload ring and bound by offset: call it before SetConstantBuffers()
 		virtual void UpdateBuffer(ER_RHI_GPUBuffer* aBuffer, void* aData, int dataSize, bool updateForAllBackBuffers = false) = 0;
+		// Upload of a dynamic vertex buffer (i.e., instance data) through the upload ring: the buffer is bound from the ring until the end of the frame.
+		// No CPU copy is kept, so it is only for data that is rewritten every frame it is drawn in (otherwise use UpdateBuffer()). Falls back to UpdateBuffer() if the ring is full.
+		virtual void UpdateBufferTransient(ER_RHI_GPUBuffer* aBuffer, void* aData, int dataSize) = 0;
+		const ER_RHI_UploadRingStats& GetUploadRingStats() const { return mUploadRingStats; }
+		UINT64 GetUploadRingFrameIndex() const { return mUploadRingFrameIndex; }
+		const ER_RHI_BindingStats& GetBindingStats() const { return mBindingStats; } // of the last finished frame
+
+		// Bytecode cache of the backend's ER_RHI_GPUShader (nullptr if the backend does not compile shaders)
+		virtual ER_RHI_ShaderCache* GetShaderCache() { return nullptr; }
 
 		virtual bool IsHardwareRaytracingSupported() = 0;
 
@@ -426,6 +558,41 @@ namespace EveryRay_Core
 		const int mPrepareGraphicsCommandListIndex = ER_RHI_MAX_GRAPHICS_COMMAND_LISTS - 1; // command list for prepare commands (on init)
 		int mCurrentGraphicsCommandListIndex = -1;
 		int mCurrentComputeCommandListIndex = -1;
+
+		// backends call it once per frame (after EndFrame() of their rings), returns true on the first overflow (to log it once)
+		bool PublishUploadRingStats(const ER_RHI_UploadRingStats& aFrameStats)
+		{
+			UINT64 peak = std::max(mUploadRingStats.PeakAllocatedBytes, aFrameStats.AllocatedBytes);
+			mUploadRingStats = aFrameStats;
+			mUploadRingStats.PeakAllocatedBytes = peak;
+			mUploadRingFrameIndex++;
+
+			bool isFirstOverflow = aFrameStats.OverflowsCount > 0 && !mIsUploadRingOverflowLogged;
+			if (isFirstOverflow)
+				mIsUploadRingOverflowLogged = true;
+			return isFirstOverflow;
+		}
+
+		ER_RHI_UploadRingStats mUploadRingStats; // of the last finished frame
+		UINT64 mUploadRingFrameIndex = 0; // ring allocations are only valid in the frame they were made in
+		bool mIsUploadRingOverflowLogged = false;
+
+		// backends report every binding call (after comparing it with their shadow state) and publish the counters once per frame
+		void OnBind(bool isFiltered)
+		{
+			if (isFiltered)
+				mFrameBindingStats.FilteredBindsCount++;
+			else
+				mFrameBindingStats.IssuedBindsCount++;
+		}
+		void PublishBindingStats()
+		{
+			mBindingStats = mFrameBindingStats;
+			mFrameBindingStats = ER_RHI_BindingStats();
+		}
+
+		ER_RHI_BindingStats mBindingStats; // of the last finished frame
+		ER_RHI_BindingStats mFrameBindingStats;
 	};
 
 	class ER_RHI_GPURootSignature
@@ -473,6 +640,7 @@ namespace EveryRay_Core
 			int mip = 1, int depth = -1, int arraySize = 1, bool isCubemap = false, int cubemapArraySize = -1) { AbstractRHIMethodAssert();	}
 		virtual void CreateGPUTextureResource(ER_RHI* aRHI, const std::string& aPath, bool isFullPath = false, bool is3D = false, bool skipFallback = false, bool* statusFlag = nullptr, bool isSilent = false) { AbstractRHIMethodAssert(); }
 		virtual void CreateGPUTextureResource(ER_RHI* aRHI, const std::wstring& aPath, bool isFullPath = false, bool is3D = false, bool skipFallback = false, bool* statusFlag = nullptr, bool isSilent = false) { AbstractRHIMethodAssert(); }
+		virtual void CreateGPUTextureResource(ER_RHI* aRHI, const UINT8* aData, UINT64 aDataSize, bool* statusFlag = nullptr) { AbstractRHIMethodAssert(); } // DDS or WIC (png, jpg, etc.) file in memory (i.e., from a packed archive or a streaming read), no fallback
 
 		virtual void* GetRTV(void* aEmpty = nullptr) { AbstractRHIMethodAssert(); return nullptr; }
 		virtual void* GetRTV(int index) { AbstractRHIMethodAssert(); return nullptr; }
@@ -508,6 +676,31 @@ namespace EveryRay_Core
 
 		virtual void* GetSRV() { AbstractRHIMethodAssert(); return nullptr; }
 		virtual void* GetUAV() { AbstractRHIMethodAssert(); return nullptr; }
+
+		// Upload ring: where the buffer's data lives in the current frame (see ER_RHI::UpdateBuffer() and ER_RHI::UpdateBufferTransient())
+		bool HasUploadRingAllocation(UINT64 aFrameIndex) const { return mUploadRingFrameIndex == aFrameIndex; }
+		UINT64 GetUploadRingOffset() const { return mUploadRingOffset; }
+		UINT64 GetUploadRingSize() const { return mUploadRingSize; }
+		void SetUploadRingAllocation(UINT64 aFrameIndex, UINT64 aOffset, UINT64 aSize) { mUploadRingFrameIndex = aFrameIndex; mUploadRingOffset = aOffset; mUploadRingSize = aSize; }
+		void ResetUploadRingAllocation() { mUploadRingFrameIndex = UINT64_MAX; }
+
+		// CPU copy of the last ring upload of a dynamic constant buffer: it is re-uploaded from it if it is bound in a later frame without an update
+		bool IsUploadRingConstantBuffer() const { return mIsUploadRingConstantBuffer; }
+		void SetUploadRingShadowData(const void* aData, int aSize)
+		{
+			mUploadRingShadowData.resize(aSize);
+			if (aSize > 0)
+				memcpy(mUploadRingShadowData.data(), aData, aSize);
+		}
+		void ClearUploadRingShadowData() { mUploadRingShadowData.clear(); }
+		std::vector<unsigned char>& GetUploadRingShadowData() { return mUploadRingShadowData; }
+	protected:
+		bool mIsUploadRingConstantBuffer = false;
+	private:
+		UINT64 mUploadRingFrameIndex = UINT64_MAX;
+		UINT64 mUploadRingOffset = 0;
+		UINT64 mUploadRingSize = 0;
+		std::vector<unsigned char> mUploadRingShadowData;
 	};
 
 	class ER_RHI_GPUShader
@@ -0,0 +1,305 @@
+#include "ER_RHI_ShaderCache.h"
+#include "..\ER_JobSystem.h"
+#include "..\ER_Utility.h"
+#include "..\ER_CoreException.h"
+
+#include <iomanip>
+
+namespace EveryRay_Core
+{
+	namespace
+	{
+		const UINT ShaderCacheFileMagic = 0x43535245; // "ERSC"
+
+		struct ShaderCacheFileHeader
+		{
+			UINT Magic;
+			UINT Version;
+			UINT64 Key;
+			UINT64 BytecodeSize;
+			UINT64 BytecodeHash;
+		};
+
+		UINT64 HashString(const std::string& aString, UINT64 aSeed)
+		{
+			UINT64 size = static_cast<UINT64>(aString.size());
+			UINT64 hash = ER_Utility::HashFNV1a(&size, sizeof(size), aSeed);
+			return aString.empty() ? hash : ER_Utility::HashFNV1a(aString.data(), aString.size(), hash);
+		}
+
+		// returns the name of an #include "name" directive (system includes with <> are not resolved)
+		bool ParseInclude(const std::string& aLine, std::string& outName)
+		{
+			size_t pos = aLine.find_first_not_of(" \t");
+			if (pos == std::string::npos || aLine[pos] != '#')
+				return false;
+			pos = aLine.find_first_not_of(" \t", pos + 1);
+			if (pos == std::string::npos || aLine.compare(pos, 7, "include") != 0)
+				return false;
+			size_t begin = aLine.find('"', pos + 7);
+			if (begin == std::string::npos)
+				return false;
+			size_t end = aLine.find('"', begin + 1);
+			if (end == std::string::npos)
+				return false;
+
+			outName = aLine.substr(begin + 1, end - begin - 1);
+			return !outName.empty();
+		}
+	}
+
+	ER_RHI_ShaderCache::ER_RHI_ShaderCache(const std::string& aBackendName, const ER_RHI_ShaderCompileFunc& aCompileFunc)
+		: mBackendName(aBackendName), mCompileFunc(aCompileFunc)
+	{
+		assert(mCompileFunc);
+	}
+
+	ER_RHI_ShaderCache::~ER_RHI_ShaderCache()
+	{
+		WaitForAll();
+		mEntries.clear();
+	}
+
+	void ER_RHI_ShaderCache::SetJobSystem(ER_JobSystem* aJobSystem)
+	{
+		WaitForAll();
+		mJobSystem = aJobSystem;
+	}
+
+	UINT64 ER_RHI_ShaderCache::HashSourceWithIncludes(const std::string& aPath, std::vector<std::string>& aVisited)
+	{
+		auto it = mSourceHashes.find(aPath);
+		if (it != mSourceHashes.end())
+			return it->second;
+
+		if (std::find(aVisited.begin(), aVisited.end(), aPath) != aVisited.end())
+			return 0; // include cycle (guarded by #pragma once/#ifndef in the shader)
+		aVisited.push_back(aPath);
+
+		std::ifstream file(ER_Utility::GetFilePath(aPath).c_str(), std::ios::binary);
+		if (!file.is_open())
+		{
+			std::string message = "ER_RHI_ShaderCache: Failed to find shader source: " + aPath;
+			throw ER_CoreException(message.c_str());
+		}
+		std::string source((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+		UINT64 hash = ER_Utility::HashFNV1a(source.data(), source.size());
+
+		// includes are resolved relatively to the including file (as D3D_COMPILE_STANDARD_FILE_INCLUDE does)
+		const size_t separator = aPath.find_last_of("\\/");
+		const std::string directory = (separator == std::string::npos) ? "" : aPath.substr(0, separator + 1);
+
+		std::istringstream lines(source);
+		std::string line, includeName;
+		while (std::getline(lines, line))
+		{
+			if (!ParseInclude(line, includeName))
+				continue;
+			const UINT64 includeHash = HashSourceWithIncludes(directory + includeName, aVisited);
+			hash = HashString(includeName, hash);
+			hash = ER_Utility::HashFNV1a(&includeHash, sizeof(includeHash), hash);
+		}
+
+		mSourceHashes.emplace(aPath, hash);
+		return hash;
+	}
+
+	UINT64 ER_RHI_ShaderCache::ComputeKey(const ER_RHI_ShaderCompileRequest& aRequest)
+	{
+		std::vector<std::string> visited;
+		UINT64 sourceHash = HashSourceWithIncludes(aRequest.Path, visited);
+
+		const UINT version = ER_RHI_SHADER_CACHE_FILE_VERSION;
+		UINT64 key = ER_Utility::HashFNV1a(&version, sizeof(version));
+		key = HashString(mBackendName, key);
+		key = ER_Utility::HashFNV1a(&sourceHash, sizeof(sourceHash), key);
+		key = HashString(aRequest.Entry, key);
+		key = HashString(aRequest.Profile, key);
+		for (auto& define : aRequest.Defines)
+		{
+			key = HashString(define.first, key);
+			key = HashString(define.second, key);
+		}
+		key = ER_Utility::HashFNV1a(&aRequest.Flags, sizeof(aRequest.Flags), key);
+		return key;
+	}
+
+	ER_RHI_ShaderCacheEntryPtr ER_RHI_ShaderCache::Request(const ER_RHI_ShaderCompileRequest& aRequest)
+	{
+		ER_RHI_ShaderCacheEntryPtr entry;
+		{
+			// the entry is inserted before its work starts, so that the concurrent requests of the same key are coalesced into it
+			std::lock_guard<std::mutex> lock(mMutex);
+			mStats.RequestsCount++;
+
+			const UINT64 key = ComputeKey(aRequest);
+			auto it = mEntries.find(key);
+			if (it != mEntries.end())
+			{
+				if (it->second->IsReady())
+					mStats.MemoryHitsCount++;
+				else
+					mStats.CoalescedCount++;
+				return it->second;
+			}
+
+			entry = std::make_shared<ER_RHI_ShaderCacheEntry>();
+			entry->mKey = key;
+			entry->mPendingJobs = 1;
+			mEntries.emplace(key, entry);
+		}
+
+		if (mJobSystem)
+			mJobSystem->Execute([this, entry, aRequest]() { Process(*entry, aRequest); }, mPendingJobs);
+		else
+			Process(*entry, aRequest);
+
+		return entry;
+	}
+
+	void ER_RHI_ShaderCache::Process(ER_RHI_ShaderCacheEntry& aEntry, const ER_RHI_ShaderCompileRequest& aRequest)
+	{
+		if (LoadFromDisk(aEntry.mKey, aEntry.mBytecode))
+			mDiskHitsCount++;
+		else
+		{
+			auto startTime = std::chrono::high_resolution_clock::now();
+			aEntry.mBytecode.clear();
+			if (mCompileFunc(aRequest, aEntry.mBytecode, aEntry.mErrors) && !aEntry.mBytecode.empty())
+			{
+				mCompiledCount++;
+				SaveToDisk(aEntry.mKey, aEntry.mBytecode);
+			}
+			else
+			{
+				mFailedCount++;
+				aEntry.mBytecode.clear();
+				aEntry.mErrors = "ER_RHI_ShaderCache: Failed to compile shader: " + aRequest.Path + " with shader entry: " + aRequest.Entry + "\n" + aEntry.mErrors;
+			}
+			mCompileTimeNs += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - startTime).count();
+		}
+
+		aEntry.mPendingJobs.fetch_sub(1); // publishes the results
+	}
+
+	void ER_RHI_ShaderCache::Wait(ER_RHI_ShaderCacheEntry& aEntry)
+	{
+		if (aEntry.IsReady())
+			return;
+
+		auto startTime = std::chrono::high_resolution_clock::now();
+		if (mJobSystem)
+			mJobSystem->Wait(aEntry.mPendingJobs);
+		else
+		{
+			// coalesced into an entry that another thread is processing inline
+			while (!aEntry.IsReady())
+				std::this_thread::yield();
+		}
+
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStats.WaitTimeSeconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+	}
+
+	void ER_RHI_ShaderCache::WaitForAll()
+	{
+		if (!mJobSystem || mPendingJobs == 0)
+			return;
+
+		auto startTime = std::chrono::high_resolution_clock::now();
+		mJobSystem->Wait(mPendingJobs);
+
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStats.WaitTimeSeconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+	}
+
+	ER_RHI_ShaderCacheStats ER_RHI_ShaderCache::GetStats()
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStats.DiskHitsCount = mDiskHitsCount;
+		mStats.CompiledCount = mCompiledCount;
+		mStats.FailedCount = mFailedCount;
+		mStats.CompileTimeSeconds = static_cast<double>(mCompileTimeNs) * 1e-9;
+		return mStats;
+	}
+
+	void ER_RHI_ShaderCache::Reset()
+	{
+		WaitForAll();
+
+		std::lock_guard<std::mutex> lock(mMutex);
+		mEntries.clear();
+		mSourceHashes.clear();
+
+		mStats = ER_RHI_ShaderCacheStats();
+		mDiskHitsCount = 0;
+		mCompiledCount = 0;
+		mFailedCount = 0;
+		mCompileTimeNs = 0;
+	}
+
+	std::string ER_RHI_ShaderCache::GetCachePath(UINT64 aKey) const
+	{
+		std::ostringstream name;
+		name << ER_RHI_SHADER_CACHE_DIRECTORY << std::hex << std::setw(16) << std::setfill('0') << aKey << ".cso";
+		return ER_Utility::GetFilePath(name.str());
+	}
+
+	bool ER_RHI_ShaderCache::LoadFromDisk(UINT64 aKey, std::vector<char>& outBytecode)
+	{
+		std::ifstream file(GetCachePath(aKey).c_str(), std::ios::binary);
+		if (!file.is_open())
+			return false;
+
+		ShaderCacheFileHeader header = {};
+		if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+			return false;
+		if (header.Magic != ShaderCacheFileMagic || header.Version != ER_RHI_SHADER_CACHE_FILE_VERSION || header.Key != aKey || header.BytecodeSize == 0)
+			return false;
+
+		outBytecode.resize(static_cast<size_t>(header.BytecodeSize));
+		if (!file.read(outBytecode.data(), outBytecode.size()) ||
+			ER_Utility::HashFNV1a(outBytecode.data(), outBytecode.size()) != header.BytecodeHash) // truncated or corrupted: recompile
+		{
+			outBytecode.clear();
+			return false;
+		}
+		return true;
+	}
+
+	void ER_RHI_ShaderCache::SaveToDisk(UINT64 aKey, const std::vector<char>& aBytecode)
+	{
+		ShaderCacheFileHeader header = {};
+		header.Magic = ShaderCacheFileMagic;
+		header.Version = ER_RHI_SHADER_CACHE_FILE_VERSION;
+		header.Key = aKey;
+		header.BytecodeSize = aBytecode.size();
+		header.BytecodeHash = ER_Utility::HashFNV1a(aBytecode.data(), aBytecode.size());
+
+		const std::string cachePath = GetCachePath(aKey);
+		std::string directory;
+		ER_Utility::GetDirectory(cachePath, directory);
+		ER_Utility::CreateDirectories(directory);
+
+		// other processes (i.e., DX11 and DX12 runtimes) can write the same key, so we write into a unique temp file and then rename it
+		std::stringstream tempPath;
+		tempPath << cachePath << "." << std::this_thread::get_id() << ".tmp";
+		{
+			std::ofstream file(tempPath.str().c_str(), std::ios::binary | std::ios::trunc);
+			if (!file.is_open())
+				return;
+			file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			file.write(aBytecode.data(), aBytecode.size());
+			if (file.fail())
+			{
+				file.close();
+				DeleteFileA(tempPath.str().c_str());
+				return;
+			}
+		}
+
+		if (!MoveFileExA(tempPath.str().c_str(), cachePath.c_str(), MOVEFILE_REPLACE_EXISTING))
+			DeleteFileA(tempPath.str().c_str());
+	}
+}
@@ -0,0 +1,107 @@
+#pragma once
+#include "ER_RHI.h"
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+
+#define ER_RHI_SHADER_CACHE_DIRECTORY "content\\cache\\shaders\\"
+#define ER_RHI_SHADER_CACHE_FILE_VERSION 1
+
+namespace EveryRay_Core
+{
+	class ER_JobSystem;
+
+	struct ER_RHI_ShaderCompileRequest
+	{
+		std::string Path;
+		std::string Entry;
+		std::string Profile; // i.e., "vs_5_0"
+		std::vector<std::pair<std::string, std::string>> Defines;
+		UINT Flags = 0; // D3DCOMPILE_*
+	};
+
+	// Compiles one request into bytecode (called from the job system's threads); returns false and fills outErrors on failure
+	typedef std::function<bool(const ER_RHI_ShaderCompileRequest& aRequest, std::vector<char>& outBytecode, std::string& outErrors)> ER_RHI_ShaderCompileFunc;
+
+	struct ER_RHI_ShaderCacheStats
+	{
+		UINT RequestsCount = 0;
+		UINT MemoryHitsCount = 0; // same key was already compiled/loaded in this session
+		UINT CoalescedCount = 0; // same key was still in flight
+		UINT DiskHitsCount = 0;
+		UINT CompiledCount = 0;
+		UINT FailedCount = 0;
+		double CompileTimeSeconds = 0.0; // summed over all threads
+		double WaitTimeSeconds = 0.0; // calling thread blocked on results
+	};
+
+	// One compiled (or still compiling) shader; shared by all requests with the same key
+	class ER_RHI_ShaderCacheEntry
+	{
+	public:
+		bool IsReady() const { return mPendingJobs == 0; }
+		const std::vector<char>& GetBytecode() const { assert(IsReady()); return mBytecode; }
+		const std::string& GetErrors() const { assert(IsReady()); return mErrors; }
+		bool IsValid() const { assert(IsReady()); return !mBytecode.empty(); }
+	private:
+		friend class ER_RHI_ShaderCache;
+
+		std::atomic<int> mPendingJobs { 0 }; // ER_JobCounter
+		std::vector<char> mBytecode;
+		std::string mErrors;
+		UINT64 mKey = 0;
+	};
+	typedef std::shared_ptr<ER_RHI_ShaderCacheEntry> ER_RHI_ShaderCacheEntryPtr;
+
+	// Content-addressed cache of shader bytecode. The key is a 64-bit hash of the source file and all its transitive #includes
+	// (by content), the entry point, the profile, the defines, the flags and the backend name.
+	// Lookup order: entries of this session (in flight ones are coalesced) -> ER_RHI_SHADER_CACHE_DIRECTORY -> compilation.
+	// Request() is thread-safe (i.e., materials are created on the scene loading threads): lookups/inserts, hashes of sources and stats
+	// are under mMutex, disk reads and compilations run outside of it.
+	// Disk reads and compilations run on ER_JobSystem when it is set (SetJobSystem()), otherwise inline on the calling thread
+	// (i.e., RHI's own shaders that are compiled before the core services exist).
+	class ER_RHI_ShaderCache
+	{
+	public:
+		ER_RHI_ShaderCache(const std::string& aBackendName, const ER_RHI_ShaderCompileFunc& aCompileFunc);
+		~ER_RHI_ShaderCache();
+
+		// Returns immediately (unless there is no job system), use Wait() before reading the entry
+		ER_RHI_ShaderCacheEntryPtr Request(const ER_RHI_ShaderCompileRequest& aRequest);
+		void Wait(ER_RHI_ShaderCacheEntry& aEntry); // calling thread helps the job system while waiting
+		void WaitForAll();
+
+		void SetJobSystem(ER_JobSystem* aJobSystem); // waits for the scheduled work before switching
+		ER_RHI_ShaderCacheStats GetStats();
+		void Reset(); // drops the entries and the hashes of sources (i.e., on a level load, so edited shaders are picked up) and resets the stats
+	private:
+		ER_RHI_ShaderCache(const ER_RHI_ShaderCache& rhs);
+		ER_RHI_ShaderCache& operator=(const ER_RHI_ShaderCache& rhs);
+
+		UINT64 ComputeKey(const ER_RHI_ShaderCompileRequest& aRequest); // under mMutex
+
+		void Process(ER_RHI_ShaderCacheEntry& aEntry, const ER_RHI_ShaderCompileRequest& aRequest);
+		bool LoadFromDisk(UINT64 aKey, std::vector<char>& outBytecode);
+		void SaveToDisk(UINT64 aKey, const std::vector<char>& aBytecode);
+		std::string GetCachePath(UINT64 aKey) const;
+
+		// hash of the file's content and (recursively) of its #include "..." files; memoized per session (under mMutex)
+		UINT64 HashSourceWithIncludes(const std::string& aPath, std::vector<std::string>& aVisited);
+
+		std::string mBackendName;
+		ER_RHI_ShaderCompileFunc mCompileFunc;
+		ER_JobSystem* mJobSystem = nullptr;
+
+		std::mutex mMutex; // mEntries, mSourceHashes, mStats
+		std::unordered_map<UINT64, ER_RHI_ShaderCacheEntryPtr> mEntries;
+		std::unordered_map<std::string, UINT64> mSourceHashes;
+		std::atomic<int> mPendingJobs { 0 }; // ER_JobCounter of all entries
+
+		ER_RHI_ShaderCacheStats mStats;
+		std::atomic<UINT> mDiskHitsCount { 0 };
+		std::atomic<UINT> mCompiledCount { 0 };
+		std::atomic<UINT> mFailedCount { 0 };
+		std::atomic<INT64> mCompileTimeNs { 0 };
+	};
+}
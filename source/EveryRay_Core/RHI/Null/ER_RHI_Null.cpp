@@ -0,0 +1,629 @@
+#include "ER_RHI_Null.h"
+#include "ER_RHI_Null_GPUBuffer.h"
+#include "ER_RHI_Null_GPUTexture.h"
+#include "ER_RHI_Null_GPUShader.h"
+#include "..\..\ER_CoreException.h"
+#include "..\..\ER_Utility.h"
+
+namespace EveryRay_Core
+{
+	void ER_RHI_Null_CommandCounters::Add(const ER_RHI_Null_CommandCounters& aOther)
+	{
+		DrawCalls += aOther.DrawCalls;
+		DrawnInstances += aOther.DrawnInstances;
+		DrawnVertices += aOther.DrawnVertices;
+		Dispatches += aOther.Dispatches;
+		PSOChanges += aOther.PSOChanges;
+		ShaderChanges += aOther.ShaderChanges;
+		StateChanges += aOther.StateChanges;
+		RedundantStateChanges += aOther.RedundantStateChanges;
+		RenderTargetChanges += aOther.RenderTargetChanges;
+		ResourceBindCalls += aOther.ResourceBindCalls;
+		BoundResources += aOther.BoundResources;
+		VertexBufferChanges += aOther.VertexBufferChanges;
+		IndexBufferChanges += aOther.IndexBufferChanges;
+		BufferUpdates += aOther.BufferUpdates;
+		UploadedBytes += aOther.UploadedBytes;
+		Copies += aOther.Copies;
+		Clears += aOther.Clears;
+		Transitions += aOther.Transitions;
+		ExecutedCommandLists += aOther.ExecutedCommandLists;
+	}
+
+	void ER_RHI_Null_GPURootSignature::InitDescriptorTable(ER_RHI* rhi, int rootParamIndex, const std::vector<ER_RHI_DESCRIPTOR_RANGE_TYPE>& ranges, const std::vector<UINT>& registerIndices,
+		const std::vector<UINT>& descriptorCounters, ER_RHI_SHADER_VISIBILITY visibility)
+	{
+		assert(rootParamIndex >= 0 && rootParamIndex < static_cast<int>(mRootParams.size()));
+		assert(ranges.size() == descriptorCounters.size());
+
+		RootParameter& param = mRootParams[rootParamIndex];
+		for (int i = 0; i < static_cast<int>(ranges.size()); i++)
+		{
+			switch (ranges[i])
+			{
+			case ER_RHI_DESCRIPTOR_RANGE_TYPE_CBV:
+				param.CBVs += descriptorCounters[i];
+				break;
+			case ER_RHI_DESCRIPTOR_RANGE_TYPE_SRV:
+				param.SRVs += descriptorCounters[i];
+				break;
+			case ER_RHI_DESCRIPTOR_RANGE_TYPE_UAV:
+				param.UAVs += descriptorCounters[i];
+				break;
+			}
+		}
+	}
+
+	ER_RHI_Null::ER_RHI_Null()
+	{
+	}
+
+	ER_RHI_Null::~ER_RHI_Null()
+	{
+		if (mAllocations.LiveBuffers > 0 || mAllocations.LiveTextures > 0)
+		{
+			std::string message = "[ER Logger][ER_RHI_Null] Destroyed with live resources: " + std::to_string(mAllocations.LiveBuffers.load()) + " buffers (" +
+				std::to_string(mAllocations.LiveBufferBytes.load()) + " bytes), " + std::to_string(mAllocations.LiveTextures.load()) + " textures (" +
+				std::to_string(mAllocations.LiveTextureBytes.load()) + " bytes)\n";
+			ER_OUTPUT_LOG(ER_Utility::ToWideString(message).c_str());
+		}
+	}
+
+	bool ER_RHI_Null::Initialize(HWND windowHandle, UINT width, UINT height, bool isFullscreen, bool isReset)
+	{
+		mAPI = ER_GRAPHICS_API::NULL_RHI;
+		assert(width > 0 && height > 0);
+
+		mWindowHandle = windowHandle;
+		mIsFullScreen = isFullscreen;
+
+		mCurrentViewport.TopLeftX = 0.0f;
+		mCurrentViewport.TopLeftY = 0.0f;
+		mCurrentViewport.Width = static_cast<float>(width);
+		mCurrentViewport.Height = static_cast<float>(height);
+		mCurrentRect = { 0, 0, static_cast<LONG>(width), static_cast<LONG>(height) };
+
+		ResetRHI(width, height, isFullscreen);
+		return true;
+	}
+
+	void ER_RHI_Null::ResetRHI(int width, int height, bool isFullscreen)
+	{
+		mCurrentRS = ER_RHI_RASTERIZER_STATE::ER_BACK_CULLING;
+		mCurrentBS = ER_RHI_BLEND_STATE::ER_NO_BLEND;
+		mCurrentDS = ER_RHI_DEPTH_STENCIL_STATE::ER_DEPTH_ONLY_WRITE_COMPARISON_LESS_EQUAL;
+		mCurrentTopologyType = ER_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+
+		mCurrentPSO = nullptr;
+		mCurrentRootSignature = nullptr;
+		mCurrentComputeRootSignature = nullptr;
+		mCurrentInputLayout = nullptr;
+		mCurrentIndexBuffer = nullptr;
+		for (int i = 0; i < ER_RHI_MAX_BOUND_VERTEX_BUFFERS; i++)
+			mCurrentVertexBuffers[i] = nullptr;
+		for (int i = 0; i <= ER_RHI_SHADER_TYPE::ER_COMPUTE; i++)
+			mCurrentShaders[i] = nullptr;
+	}
+
+	ER_RHI_GPUShader* ER_RHI_Null::CreateGPUShader()
+	{
+		return new ER_RHI_Null_GPUShader();
+	}
+
+	ER_RHI_GPUBuffer* ER_RHI_Null::CreateGPUBuffer(const std::string& aDebugName)
+	{
+		return new ER_RHI_Null_GPUBuffer(aDebugName);
+	}
+
+	ER_RHI_GPUTexture* ER_RHI_Null::CreateGPUTexture(const std::wstring& aDebugName)
+	{
+		return new ER_RHI_Null_GPUTexture(aDebugName);
+	}
+
+	ER_RHI_GPURootSignature* ER_RHI_Null::CreateRootSignature(UINT NumRootParams, UINT NumStaticSamplers)
+	{
+		return new ER_RHI_Null_GPURootSignature(NumRootParams, NumStaticSamplers);
+	}
+
+	ER_RHI_InputLayout* ER_RHI_Null::CreateInputLayout(ER_RHI_INPUT_ELEMENT_DESC* inputElementDescriptions, UINT inputElementDescriptionCount)
+	{
+		return new ER_RHI_InputLayout(inputElementDescriptions, inputElementDescriptionCount);
+	}
+
+	void ER_RHI_Null::CreateTexture(ER_RHI_GPUTexture* aOutTexture, UINT width, UINT height, UINT samples, ER_RHI_FORMAT format, ER_RHI_BIND_FLAG bindFlags, int mip, int depth, int arraySize, bool isCubemap, int cubemapArraySize)
+	{
+		assert(aOutTexture);
+		aOutTexture->CreateGPUTextureResource(this, width, height, samples, format, bindFlags, mip, depth, arraySize, isCubemap, cubemapArraySize);
+	}
+
+	void ER_RHI_Null::CreateTexture(ER_RHI_GPUTexture* aOutTexture, const std::string& aPath, bool isFullPath)
+	{
+		assert(aOutTexture);
+		aOutTexture->CreateGPUTextureResource(this, aPath, isFullPath);
+	}
+
+	void ER_RHI_Null::CreateTexture(ER_RHI_GPUTexture* aOutTexture, const std::wstring& aPath, bool isFullPath)
+	{
+		assert(aOutTexture);
+		aOutTexture->CreateGPUTextureResource(this, aPath, isFullPath);
+	}
+
+	void ER_RHI_Null::CreateBuffer(ER_RHI_GPUBuffer* aOutBuffer, void* aData, UINT objectsCount, UINT byteStride, bool isDynamic, ER_RHI_BIND_FLAG bindFlags, UINT cpuAccessFlags, ER_RHI_RESOURCE_MISC_FLAG miscFlags, ER_RHI_FORMAT format)
+	{
+		assert(aOutBuffer);
+		aOutBuffer->CreateGPUBufferResource(this, aData, objectsCount, byteStride, isDynamic, bindFlags, cpuAccessFlags, miscFlags, format);
+	}
+
+	void ER_RHI_Null::CopyBuffer(ER_RHI_GPUBuffer* aDestBuffer, ER_RHI_GPUBuffer* aSrcBuffer, int cmdListIndex, bool isInCopyQueue)
+	{
+		assert(aDestBuffer && aSrcBuffer);
+		assert(aDestBuffer->GetSize() >= aSrcBuffer->GetSize());
+
+		ER_RHI_Null_GPUBuffer* srcBuffer = static_cast<ER_RHI_Null_GPUBuffer*>(aSrcBuffer);
+		if (srcBuffer->HasCPUData())
+			static_cast<ER_RHI_Null_GPUBuffer*>(aDestBuffer)->Update(srcBuffer->GetCPUData(), aSrcBuffer->GetSize());
+
+		mFrameCounters.Copies++;
+	}
+
+	void ER_RHI_Null::BeginBufferRead(ER_RHI_GPUBuffer* aBuffer, void** output)
+	{
+		assert(aBuffer && output);
+		*output = static_cast<ER_RHI_Null_GPUBuffer*>(aBuffer)->GetCPUData();
+	}
+
+	// Nothing is rendered on the null RHI, so 2D textures (and cubemaps) read back as black texels of their size: CPU consumers still run
+	bool ER_RHI_Null::ReadGPUTextureToCPU(ER_RHI_GPUTexture* aTexture, UINT aMip, std::vector<XMFLOAT4>& aOutTexels)
+	{
+		assert(aTexture);
+
+		ER_RHI_Null_GPUTexture* tex = static_cast<ER_RHI_Null_GPUTexture*>(aTexture);
+		if (aMip >= tex->GetMips() || static_cast<int>(tex->GetDepth()) > 1)
+			return false;
+
+		const size_t width = std::max(1u, tex->GetWidth() >> aMip);
+		const size_t height = std::max(1u, tex->GetHeight() >> aMip);
+		aOutTexels.assign(width * height * tex->GetArraySize(), XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f));
+
+		mFrameCounters.Copies++;
+		return true;
+	}
+
+	void ER_RHI_Null::OnDraw(UINT64 aVertices, UINT aInstances)
+	{
+		assert(aVertices > 0);
+		mFrameCounters.DrawCalls++;
+		mFrameCounters.DrawnInstances += aInstances;
+		mFrameCounters.DrawnVertices += aVertices * aInstances;
+	}
+
+	void ER_RHI_Null::Draw(UINT VertexCount)
+	{
+		OnDraw(VertexCount, 1);
+	}
+
+	void ER_RHI_Null::DrawIndexed(UINT IndexCount)
+	{
+		OnDraw(IndexCount, 1);
+	}
+
+	void ER_RHI_Null::DrawInstanced(UINT VertexCountPerInstance, UINT InstanceCount, UINT StartVertexLocation, UINT StartInstanceLocation)
+	{
+		OnDraw(VertexCountPerInstance, InstanceCount);
+	}
+
+	void ER_RHI_Null::DrawIndexedInstanced(UINT IndexCountPerInstance, UINT InstanceCount, UINT StartIndexLocation, INT BaseVertexLocation, UINT StartInstanceLocation)
+	{
+		OnDraw(IndexCountPerInstance, InstanceCount);
+	}
+
+	void ER_RHI_Null::DrawIndexedInstancedIndirect(ER_RHI_GPUBuffer* aArgsBuffer, UINT aArgsOffset)
+	{
+		assert(aArgsBuffer);
+		assert(aArgsOffset + sizeof(ER_RHI_DRAW_INDEXED_INSTANCED_ARGS) <= static_cast<UINT>(aArgsBuffer->GetSize()));
+
+		// arguments are only known if they were written on the CPU (compute shaders do not run here)
+		ER_RHI_Null_GPUBuffer* argsBuffer = static_cast<ER_RHI_Null_GPUBuffer*>(aArgsBuffer);
+		if (argsBuffer->HasCPUData())
+		{
+			const ER_RHI_DRAW_INDEXED_INSTANCED_ARGS* args = reinterpret_cast<const ER_RHI_DRAW_INDEXED_INSTANCED_ARGS*>(static_cast<const UINT8*>(argsBuffer->GetCPUData()) + aArgsOffset);
+			OnDraw(args->IndexCountPerInstance, args->InstanceCount);
+		}
+		else
+			OnDraw(0, 0);
+	}
+
+	void ER_RHI_Null::Dispatch(UINT ThreadGroupCountX, UINT ThreadGroupCountY, UINT ThreadGroupCountZ)
+	{
+		assert(ThreadGroupCountX > 0 && ThreadGroupCountY > 0 && ThreadGroupCountZ > 0);
+		mFrameCounters.Dispatches++;
+	}
+
+	void ER_RHI_Null::PresentGraphics()
+	{
+		mLastFrameCounters = mFrameCounters;
+		mTotalCounters.Add(mFrameCounters);
+		mFrameCounters = ER_RHI_Null_CommandCounters();
+		mPresentedFrames++;
+		mUploadRingFrameIndex++;
+		PublishBindingStats();
+	}
+
+	// nothing is recorded, so redundant calls are reported as filtered (what a backend with a shadow state would drop)
+	void ER_RHI_Null::OnStateChange(bool isRedundant)
+	{
+		if (isRedundant)
+			mFrameCounters.RedundantStateChanges++;
+		else
+			mFrameCounters.StateChanges++;
+		OnBind(isRedundant);
+	}
+
+	void ER_RHI_Null::SetDepthStencilState(ER_RHI_DEPTH_STENCIL_STATE aDS, UINT stencilRef)
+	{
+		OnStateChange(aDS == mCurrentDS);
+		mCurrentDS = aDS;
+	}
+
+	void ER_RHI_Null::SetBlendState(ER_RHI_BLEND_STATE aBS, const float BlendFactor[4], UINT SampleMask)
+	{
+		OnStateChange(aBS == mCurrentBS);
+		mCurrentBS = aBS;
+	}
+
+	void ER_RHI_Null::SetRasterizerState(ER_RHI_RASTERIZER_STATE aRS)
+	{
+		OnStateChange(aRS == mCurrentRS);
+		mCurrentRS = aRS;
+	}
+
+	void ER_RHI_Null::SetViewport(const ER_RHI_Viewport& aViewport)
+	{
+		OnStateChange(memcmp(&aViewport, &mCurrentViewport, sizeof(ER_RHI_Viewport)) == 0);
+		mCurrentViewport = aViewport;
+	}
+
+	void ER_RHI_Null::SetRect(const ER_RHI_Rect& rect)
+	{
+		OnStateChange(memcmp(&rect, &mCurrentRect, sizeof(ER_RHI_Rect)) == 0);
+		mCurrentRect = rect;
+	}
+
+	void ER_RHI_Null::SetTopologyType(ER_RHI_PRIMITIVE_TYPE aType)
+	{
+		OnStateChange(aType == mCurrentTopologyType);
+		mCurrentTopologyType = aType;
+	}
+
+	void ER_RHI_Null::SetInputLayout(ER_RHI_InputLayout* aIL)
+	{
+		assert(aIL);
+		OnStateChange(aIL == mCurrentInputLayout);
+		mCurrentInputLayout = aIL;
+	}
+
+	void ER_RHI_Null::SetEmptyInputLayout()
+	{
+		OnStateChange(!mCurrentInputLayout);
+		mCurrentInputLayout = nullptr;
+	}
+
+	void ER_RHI_Null::SetRootSignature(ER_RHI_GPURootSignature* rs, bool isCompute)
+	{
+		assert(rs);
+		ER_RHI_GPURootSignature*& currentRS = isCompute ? mCurrentComputeRootSignature : mCurrentRootSignature;
+		OnStateChange(rs == currentRS);
+		currentRS = rs;
+	}
+
+	void ER_RHI_Null::SetShader(ER_RHI_GPUShader* aShader)
+	{
+		assert(aShader);
+		if (mCurrentShaders[aShader->mShaderType] != aShader)
+			mFrameCounters.ShaderChanges++;
+		OnBind(mCurrentShaders[aShader->mShaderType] == aShader);
+		mCurrentShaders[aShader->mShaderType] = aShader;
+	}
+
+	void ER_RHI_Null::SetShaderResources(ER_RHI_SHADER_TYPE aShaderType, ER_RHI_Span<ER_RHI_GPUResource*> aSRVs, UINT startSlot, ER_RHI_GPURootSignature* rs, int rootParamIndex, bool isComputeRS, bool skipAutomaticTransition)
+	{
+		assert(aSRVs.size() > 0);
+		mFrameCounters.ResourceBindCalls++;
+		OnBind(false);
+		mFrameCounters.BoundResources += aSRVs.size();
+	}
+
+	void ER_RHI_Null::SetUnorderedAccessResources(ER_RHI_SHADER_TYPE aShaderType, ER_RHI_Span<ER_RHI_GPUResource*> aUAVs, UINT startSlot, ER_RHI_GPURootSignature* rs, int rootParamIndex, bool isComputeRS, bool skipAutomaticTransition)
+	{
+		assert(aUAVs.size() > 0);
+		mFrameCounters.ResourceBindCalls++;
+		OnBind(false);
+		mFrameCounters.BoundResources += aUAVs.size();
+	}
+
+	void ER_RHI_Null::SetConstantBuffers(ER_RHI_SHADER_TYPE aShaderType, ER_RHI_Span<ER_RHI_GPUBuffer*> aCBs, UINT startSlot, ER_RHI_GPURootSignature* rs, int rootParamIndex, bool isComputeRS)
+	{
+		assert(aCBs.size() > 0);
+		mFrameCounters.ResourceBindCalls++;
+		OnBind(false);
+		mFrameCounters.BoundResources += aCBs.size();
+	}
+
+	void ER_RHI_Null::SetSamplers(ER_RHI_SHADER_TYPE aShaderType, ER_RHI_Span<ER_RHI_SAMPLER_STATE> aSamplers, UINT startSlot, ER_RHI_GPURootSignature* rs)
+	{
+		assert(aSamplers.size() > 0);
+		mFrameCounters.ResourceBindCalls++;
+		OnBind(false);
+		mFrameCounters.BoundResources += aSamplers.size();
+	}
+
+	void ER_RHI_Null::SetIndexBuffer(ER_RHI_GPUBuffer* aBuffer, UINT offset)
+	{
+		assert(aBuffer);
+		if (aBuffer != mCurrentIndexBuffer)
+			mFrameCounters.IndexBufferChanges++;
+		OnBind(aBuffer == mCurrentIndexBuffer);
+		mCurrentIndexBuffer = aBuffer;
+	}
+
+	void ER_RHI_Null::SetVertexBuffers(ER_RHI_Span<ER_RHI_GPUBuffer*> aVertexBuffers)
+	{
+		assert(aVertexBuffers.size() > 0 && aVertexBuffers.size() <= ER_RHI_MAX_BOUND_VERTEX_BUFFERS);
+
+		bool isChanged = false;
+		for (int i = 0; i < ER_RHI_MAX_BOUND_VERTEX_BUFFERS; i++)
+		{
+			ER_RHI_GPUBuffer* buffer = (i < static_cast<int>(aVertexBuffers.size())) ? aVertexBuffers[i] : nullptr;
+			isChanged |= (buffer != mCurrentVertexBuffers[i]);
+			mCurrentVertexBuffers[i] = buffer;
+		}
+		if (isChanged)
+			mFrameCounters.VertexBufferChanges++;
+		OnBind(!isChanged);
+	}
+
+	void ER_RHI_Null::TransitionResources(ER_RHI_Span<ER_RHI_GPUResource*> aResources, ER_RHI_Span<ER_RHI_RESOURCE_STATE> aStates, int cmdListIndex, bool isCopyQueue, int subresourceIndex)
+	{
+		assert(aResources.size() == aStates.size());
+		for (int i = 0; i < static_cast<int>(aResources.size()); i++)
+		{
+			if (aResources[i]->GetCurrentState() == aStates[i])
+				continue;
+			aResources[i]->SetCurrentState(aStates[i]);
+			mFrameCounters.Transitions++;
+		}
+	}
+
+	void ER_RHI_Null::TransitionResources(ER_RHI_Span<ER_RHI_GPUResource*> aResources, ER_RHI_RESOURCE_STATE aState, int cmdListIndex, bool isCopyQueue, int subresourceIndex)
+	{
+		for (ER_RHI_GPUResource* resource : aResources)
+		{
+			if (resource->GetCurrentState() == aState)
+				continue;
+			resource->SetCurrentState(aState);
+			mFrameCounters.Transitions++;
+		}
+	}
+
+	bool ER_RHI_Null::IsPSOReady(const std::string& aName, bool isCompute)
+	{
+		auto it = mPSOs.find(aName);
+		return it != mPSOs.end() && it->second.IsFinalized;
+	}
+
+	void ER_RHI_Null::InitializePSO(const std::string& aName, bool isCompute)
+	{
+		PSO& pso = mPSOs[aName];
+		ER_RHI_PSO_HANDLE handle = pso.Handle;
+		pso = PSO();
+		pso.IsCompute = isCompute;
+		pso.Handle = handle;
+	}
+
+	void ER_RHI_Null::SetRootSignatureToPSO(const std::string& aName, ER_RHI_GPURootSignature* rs, bool isCompute)
+	{
+		auto it = mPSOs.find(aName);
+		if (it == mPSOs.end())
+			throw ER_CoreException("ER_RHI_Null: Could not find PSO to set the root signature to. Call InitializePSO() first.");
+		it->second.RootSignature = rs;
+	}
+
+	void ER_RHI_Null::SetTopologyTypeToPSO(const std::string& aName, ER_RHI_PRIMITIVE_TYPE aType)
+	{
+		auto it = mPSOs.find(aName);
+		if (it == mPSOs.end())
+			throw ER_CoreException("ER_RHI_Null: Could not find PSO to set the topology to. Call InitializePSO() first.");
+		it->second.Topology = aType;
+	}
+
+	ER_RHI_PSO_HANDLE ER_RHI_Null::FinalizePSO(const std::string& aName, bool isCompute)
+	{
+		auto it = mPSOs.find(aName);
+		if (it == mPSOs.end())
+			throw ER_CoreException("ER_RHI_Null: Could not find PSO to finalize. Call InitializePSO() first.");
+		assert(it->second.IsCompute == isCompute);
+		it->second.IsFinalized = true;
+		if (it->second.Handle == ER_RHI_INVALID_PSO_HANDLE)
+		{
+			it->second.Handle = static_cast<ER_RHI_PSO_HANDLE>(mPSOHandles.size());
+			mPSOHandles.push_back(&it->second);
+		}
+		return it->second.Handle;
+	}
+
+	ER_RHI_PSO_HANDLE ER_RHI_Null::GetPSOHandle(const std::string& aName, bool isCompute)
+	{
+		auto it = mPSOs.find(aName);
+		return (it != mPSOs.end() && it->second.IsFinalized) ? it->second.Handle : ER_RHI_INVALID_PSO_HANDLE;
+	}
+
+	void ER_RHI_Null::SetPSO(const std::string& aName, bool isCompute)
+	{
+		auto it = mPSOs.find(aName);
+		if (it == mPSOs.end() || !it->second.IsFinalized)
+		{
+			std::string message = "ER_RHI_Null: Could not set PSO (not found or not finalized): " + aName;
+			throw ER_CoreException(message.c_str());
+		}
+
+		if (mCurrentPSO != &it->second)
+			mFrameCounters.PSOChanges++;
+		mCurrentPSO = &it->second;
+	}
+
+	void ER_RHI_Null::SetPSO(ER_RHI_PSO_HANDLE aHandle, bool isCompute)
+	{
+		if (aHandle >= mPSOHandles.size() || !mPSOHandles[aHandle]->IsFinalized)
+			throw ER_CoreException("ER_RHI_Null: Could not set PSO (invalid handle or not finalized)");
+		assert(mPSOHandles[aHandle]->IsCompute == isCompute);
+
+		if (mCurrentPSO != mPSOHandles[aHandle])
+			mFrameCounters.PSOChanges++;
+		mCurrentPSO = mPSOHandles[aHandle];
+	}
+
+	void ER_RHI_Null::UpdateBuffer(ER_RHI_GPUBuffer* aBuffer, void* aData, int dataSize, bool updateForAllBackBuffers)
+	{
+		assert(aBuffer);
+		assert(aBuffer->GetSize() >= dataSize);
+
+		static_cast<ER_RHI_Null_GPUBuffer*>(aBuffer)->Update(aData, dataSize);
+		mFrameCounters.BufferUpdates++;
+		mFrameCounters.UploadedBytes += dataSize;
+	}
+
+	void ER_RHI_Null::UpdateBufferTransient(ER_RHI_GPUBuffer* aBuffer, void* aData, int dataSize)
+	{
+		UpdateBuffer(aBuffer, aData, dataSize);
+	}
+
+	void ER_RHI_Null::InitImGui()
+	{
+		// no renderer backend, but ImGui::NewFrame() still requires a built font atlas
+		ImGuiIO& io = ImGui::GetIO();
+		unsigned char* pixels = nullptr;
+		int width = 0, height = 0;
+		io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+	}
+
+	void ER_RHI_Null::UpdatePeakBytes()
+	{
+		UINT64 bytes = mAllocations.LiveBufferBytes + mAllocations.LiveTextureBytes;
+		UINT64 peak = mAllocations.PeakBytes;
+		while (bytes > peak && !mAllocations.PeakBytes.compare_exchange_weak(peak, bytes)) {}
+	}
+
+	void ER_RHI_Null::OnBufferCreated(UINT64 aBytes)
+	{
+		mAllocations.LiveBuffers++;
+		mAllocations.CreatedBuffers++;
+		mAllocations.LiveBufferBytes += aBytes;
+		UpdatePeakBytes();
+	}
+
+	void ER_RHI_Null::OnBufferDestroyed(UINT64 aBytes)
+	{
+		assert(mAllocations.LiveBuffers > 0 && mAllocations.LiveBufferBytes >= aBytes);
+		mAllocations.LiveBuffers--;
+		mAllocations.LiveBufferBytes -= aBytes;
+	}
+
+	void ER_RHI_Null::OnTextureCreated(UINT64 aBytes)
+	{
+		mAllocations.LiveTextures++;
+		mAllocations.CreatedTextures++;
+		mAllocations.LiveTextureBytes += aBytes;
+		UpdatePeakBytes();
+	}
+
+	void ER_RHI_Null::OnTextureDestroyed(UINT64 aBytes)
+	{
+		assert(mAllocations.LiveTextures > 0 && mAllocations.LiveTextureBytes >= aBytes);
+		mAllocations.LiveTextures--;
+		mAllocations.LiveTextureBytes -= aBytes;
+	}
+
+	void ER_RHI_Null::ResetCounters()
+	{
+		mFrameCounters = ER_RHI_Null_CommandCounters();
+		mLastFrameCounters = ER_RHI_Null_CommandCounters();
+		mTotalCounters = ER_RHI_Null_CommandCounters();
+		mPresentedFrames = 0;
+	}
+
+	void ER_RHI_Null::LogStatistics()
+	{
+		const double frames = static_cast<double>(std::max<UINT64>(1, mPresentedFrames));
+		const ER_RHI_Null_CommandCounters& c = mTotalCounters;
+		auto perFrame = [frames](UINT64 value) { return std::to_string(static_cast<UINT64>(static_cast<double>(value) / frames + 0.5)); };
+
+		std::string message = "[ER Logger][ER_RHI_Null] Statistics over " + std::to_string(mPresentedFrames) + " frames (average per frame):\n" +
+			"    draw calls: " + perFrame(c.DrawCalls) + ", instances: " + perFrame(c.DrawnInstances) + ", vertices: " + perFrame(c.DrawnVertices) + ", dispatches: " + perFrame(c.Dispatches) + "\n" +
+			"    PSO changes: " + perFrame(c.PSOChanges) + ", shader changes: " + perFrame(c.ShaderChanges) + ", state changes: " + perFrame(c.StateChanges) +
+			" (+" + perFrame(c.RedundantStateChanges) + " redundant), render target changes: " + perFrame(c.RenderTargetChanges) + "\n" +
+			"    resource bind calls: " + perFrame(c.ResourceBindCalls) + " (" + perFrame(c.BoundResources) + " resources), vertex/index buffer changes: " +
+			perFrame(c.VertexBufferChanges) + "/" + perFrame(c.IndexBufferChanges) + "\n" +
+			"    buffer updates: " + perFrame(c.BufferUpdates) + " (" + perFrame(c.UploadedBytes) + " bytes), copies: " + perFrame(c.Copies) + ", clears: " + perFrame(c.Clears) +
+			", transitions: " + perFrame(c.Transitions) + "\n" +
+			"    live buffers: " + std::to_string(mAllocations.LiveBuffers.load()) + " (" + std::to_string(mAllocations.LiveBufferBytes.load() / (1024 * 1024)) + " MB), live textures: " +
+			std::to_string(mAllocations.LiveTextures.load()) + " (" + std::to_string(mAllocations.LiveTextureBytes.load() / (1024 * 1024)) + " MB), peak: " +
+			std::to_string(mAllocations.PeakBytes.load() / (1024 * 1024)) + " MB, PSOs: " + std::to_string(mPSOs.size()) + ", shaders: " + std::to_string(mAllocations.CreatedShaders.load()) + "\n";
+		ER_OUTPUT_LOG(ER_Utility::ToWideString(message).c_str());
+	}
+
+	UINT ER_RHI_Null::GetFormatSize(ER_RHI_FORMAT aFormat)
+	{
+		switch (aFormat)
+		{
+		case ER_FORMAT_R32G32B32A32_TYPELESS:
+		case ER_FORMAT_R32G32B32A32_FLOAT:
+		case ER_FORMAT_R32G32B32A32_UINT:
+			return 16;
+		case ER_FORMAT_R32G32B32_TYPELESS:
+		case ER_FORMAT_R32G32B32_FLOAT:
+		case ER_FORMAT_R32G32B32_UINT:
+			return 12;
+		case ER_FORMAT_R16G16B16A16_TYPELESS:
+		case ER_FORMAT_R16G16B16A16_FLOAT:
+		case ER_FORMAT_R16G16B16A16_UNORM:
+		case ER_FORMAT_R16G16B16A16_UINT:
+		case ER_FORMAT_R32G32_TYPELESS:
+		case ER_FORMAT_R32G32_FLOAT:
+		case ER_FORMAT_R32G32_UINT:
+			return 8;
+		case ER_FORMAT_R10G10B10A2_TYPELESS:
+		case ER_FORMAT_R10G10B10A2_UNORM:
+		case ER_FORMAT_R10G10B10A2_UINT:
+		case ER_FORMAT_R11G11B10_FLOAT:
+		case ER_FORMAT_R8G8B8A8_TYPELESS:
+		case ER_FORMAT_R8G8B8A8_UNORM:
+		case ER_FORMAT_R8G8B8A8_UNORM_sRGB:
+		case ER_FORMAT_R8G8B8A8_UINT:
+		case ER_FORMAT_R16G16_TYPELESS:
+		case ER_FORMAT_R16G16_FLOAT:
+		case ER_FORMAT_R16G16_UNORM:
+		case ER_FORMAT_R16G16_UINT:
+		case ER_FORMAT_R32_TYPELESS:
+		case ER_FORMAT_D32_FLOAT:
+		case ER_FORMAT_R32_FLOAT:
+		case ER_FORMAT_R32_UINT:
+		case ER_FORMAT_D24_UNORM_S8_UINT:
+			return 4;
+		case ER_FORMAT_R8G8_TYPELESS:
+		case ER_FORMAT_R8G8_UNORM:
+		case ER_FORMAT_R8G8_UINT:
+		case ER_FORMAT_D16_UNORM:
+		case ER_FORMAT_R16_TYPELESS:
+		case ER_FORMAT_R16_FLOAT:
+		case ER_FORMAT_R16_UNORM:
+		case ER_FORMAT_R16_UINT:
+			return 2;
+		case ER_FORMAT_R8_TYPELESS:
+		case ER_FORMAT_R8_UNORM:
+		case ER_FORMAT_R8_UINT:
+			return 1;
+		default:
+			return 4;
+		}
+	}
+}
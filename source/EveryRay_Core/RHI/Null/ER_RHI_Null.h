@@ -0,0 +1,268 @@
+#pragma once
+#include "..\ER_RHI.h"
+
+#include <atomic>
+
+namespace EveryRay_Core
+{
+	// Counters of the commands that were recorded into the null RHI (per frame and accumulated)
+	struct ER_RHI_Null_CommandCounters
+	{
+		UINT64 DrawCalls = 0;
+		UINT64 DrawnInstances = 0;
+		UINT64 DrawnVertices = 0; // vertices or indices (* instances)
+		UINT64 Dispatches = 0;
+		UINT64 PSOChanges = 0;
+		UINT64 ShaderChanges = 0;
+		UINT64 StateChanges = 0; // blend, rasterizer, depth-stencil, topology, input layout, viewport, rect, root signature
+		UINT64 RedundantStateChanges = 0; // Set*() calls of the above with the already bound value
+		UINT64 RenderTargetChanges = 0;
+		UINT64 ResourceBindCalls = 0; // SRVs, UAVs, CBs, samplers
+		UINT64 BoundResources = 0;
+		UINT64 VertexBufferChanges = 0;
+		UINT64 IndexBufferChanges = 0;
+		UINT64 BufferUpdates = 0;
+		UINT64 UploadedBytes = 0;
+		UINT64 Copies = 0;
+		UINT64 Clears = 0;
+		UINT64 Transitions = 0;
+		UINT64 ExecutedCommandLists = 0;
+
+		void Add(const ER_RHI_Null_CommandCounters& aOther);
+	};
+
+	// Live GPU allocations of the null RHI (resources are never backed by a real device, only their sizes are tracked)
+	struct ER_RHI_Null_AllocationCounters
+	{
+		std::atomic<UINT64> LiveBuffers { 0 };
+		std::atomic<UINT64> LiveBufferBytes { 0 };
+		std::atomic<UINT64> LiveTextures { 0 };
+		std::atomic<UINT64> LiveTextureBytes { 0 };
+		std::atomic<UINT64> PeakBytes { 0 };
+		std::atomic<UINT64> CreatedBuffers { 0 };
+		std::atomic<UINT64> CreatedTextures { 0 };
+		std::atomic<UINT64> CreatedShaders { 0 };
+	};
+
+	class ER_RHI_Null_GPURootSignature : public ER_RHI_GPURootSignature
+	{
+	public:
+		ER_RHI_Null_GPURootSignature(UINT NumRootParams = 0, UINT NumStaticSamplers = 0)
+			: ER_RHI_GPURootSignature(NumRootParams, NumStaticSamplers), mRootParams(NumRootParams), mStaticSamplersCount(NumStaticSamplers) {}
+		virtual ~ER_RHI_Null_GPURootSignature() {}
+
+		virtual void InitConstant(ER_RHI* rhi, UINT index, UINT regIndex, UINT numDWORDs, ER_RHI_SHADER_VISIBILITY visibility = ER_RHI_SHADER_VISIBILITY_ALL) override {}
+		virtual void InitStaticSampler(ER_RHI* rhi, UINT regIndex, const ER_RHI_SAMPLER_STATE& sampler, ER_RHI_SHADER_VISIBILITY visibility = ER_RHI_SHADER_VISIBILITY_ALL) override {}
+		virtual void InitDescriptorTable(ER_RHI* rhi, int rootParamIndex, const std::vector<ER_RHI_DESCRIPTOR_RANGE_TYPE>& ranges, const std::vector<UINT>& registerIndices,
+			const std::vector<UINT>& descriptorCounters, ER_RHI_SHADER_VISIBILITY visibility = ER_RHI_SHADER_VISIBILITY_ALL) override;
+		virtual void Finalize(ER_RHI* rhi, const std::string& name, bool needsInputAssembler = false) override { mName = name; }
+
+		virtual int GetStaticSamplersCount() override { return mStaticSamplersCount; }
+		virtual int GetRootParameterCount() override { return static_cast<int>(mRootParams.size()); }
+		virtual int GetRootParameterCBVCount(int paramIndex) override { return mRootParams[paramIndex].CBVs; }
+		virtual int GetRootParameterSRVCount(int paramIndex) override { return mRootParams[paramIndex].SRVs; }
+		virtual int GetRootParameterUAVCount(int paramIndex) override { return mRootParams[paramIndex].UAVs; }
+	private:
+		struct RootParameter
+		{
+			int CBVs = 0;
+			int SRVs = 0;
+			int UAVs = 0;
+		};
+		std::vector<RootParameter> mRootParams;
+		int mStaticSamplersCount = 0;
+		std::string mName;
+	};
+
+	// Headless RHI without any graphics API behind it: it keeps the resource bookkeeping (sizes, mips, PSO registrations)
+	// and counts the recorded commands, so that scenes can be replayed on machines without a GPU (i.e., to measure
+	// draw calls, state changes and CPU frame time). GPU readbacks return zeroed memory.
+	class ER_RHI_Null : public ER_RHI
+	{
+	public:
+		ER_RHI_Null();
+		virtual ~ER_RHI_Null();
+
+		virtual bool Initialize(HWND windowHandle, UINT width, UINT height, bool isFullscreen, bool isReset = false) override;
+
+		virtual void BeginGraphicsCommandList(int index = 0) override { mCurrentGraphicsCommandListIndex = index; }
+		virtual void EndGraphicsCommandList(int index = 0) override {}
+
+		virtual void BeginComputeCommandList(int index = 0) override { mCurrentComputeCommandListIndex = index; }
+		virtual void EndComputeCommandList(int index = 0) override {}
+
+		virtual void BeginCopyCommandList(int index = 0) override {}
+		virtual void EndCopyCommandList(int index = 0) override {}
+
+		virtual void ClearMainRenderTarget(float colors[4]) override { mFrameCounters.Clears++; }
+		virtual void ClearMainDepthStencilTarget(float depth, UINT stencil = 0) override { mFrameCounters.Clears++; }
+		virtual void ClearRenderTarget(ER_RHI_GPUTexture* aRenderTarget, float colors[4], int rtvArrayIndex = -1) override { assert(aRenderTarget); mFrameCounters.Clears++; }
+		virtual void ClearDepthStencilTarget(ER_RHI_GPUTexture* aDepthTarget, float depth, UINT stencil = 0) override { assert(aDepthTarget); mFrameCounters.Clears++; }
+		virtual void ClearUAV(ER_RHI_GPUResource* aRenderTarget, float colors[4]) override { assert(aRenderTarget); mFrameCounters.Clears++; }
+
+		virtual ER_RHI_GPUShader* CreateGPUShader() override;
+		virtual ER_RHI_GPUBuffer* CreateGPUBuffer(const std::string& aDebugName) override;
+		virtual ER_RHI_GPUTexture* CreateGPUTexture(const std::wstring& aDebugName) override;
+		virtual ER_RHI_GPURootSignature* CreateRootSignature(UINT NumRootParams = 0, UINT NumStaticSamplers = 0) override;
+		virtual ER_RHI_InputLayout* CreateInputLayout(ER_RHI_INPUT_ELEMENT_DESC* inputElementDescriptions, UINT inputElementDescriptionCount) override;
+
+		virtual void CreateTexture(ER_RHI_GPUTexture* aOutTexture, UINT width, UINT height, UINT samples, ER_RHI_FORMAT format, ER_RHI_BIND_FLAG bindFlags = ER_BIND_NONE,
+			int mip = 1, int depth = -1, int arraySize = 1, bool isCubemap = false, int cubemapArraySize = -1) override;
+		virtual void CreateTexture(ER_RHI_GPUTexture* aOutTexture, const std::string& aPath, bool isFullPath = false) override;
+		virtual void CreateTexture(ER_RHI_GPUTexture* aOutTexture, const std::wstring& aPath, bool isFullPath = false) override;
+
+		virtual void CreateBuffer(ER_RHI_GPUBuffer* aOutBuffer, void* aData, UINT objectsCount, UINT byteStride, bool isDynamic = false, ER_RHI_BIND_FLAG bindFlags = ER_BIND_NONE, UINT cpuAccessFlags = 0, ER_RHI_RESOURCE_MISC_FLAG miscFlags = ER_RESOURCE_MISC_NONE, ER_RHI_FORMAT format = ER_FORMAT_UNKNOWN) override;
+		virtual void CopyBuffer(ER_RHI_GPUBuffer* aDestBuffer, ER_RHI_GPUBuffer* aSrcBuffer, int cmdListIndex, bool isInCopyQueue = false) override;
+		virtual void BeginBufferRead(ER_RHI_GPUBuffer* aBuffer, void** output) override;
+		virtual void EndBufferRead(ER_RHI_GPUBuffer* aBuffer) override {}
+
+		virtual void CopyGPUTextureSubresourceRegion(ER_RHI_GPUResource* aDestBuffer, UINT DstSubresource, UINT DstX, UINT DstY, UINT DstZ, ER_RHI_GPUResource* aSrcBuffer, UINT SrcSubresource, bool isInCopyQueueOrSkipTransitions = false) override { mFrameCounters.Copies++; }
+
+		virtual void Draw(UINT VertexCount) override;
+		virtual void DrawIndexed(UINT IndexCount) override;
+		virtual void DrawInstanced(UINT VertexCountPerInstance, UINT InstanceCount, UINT StartVertexLocation, UINT StartInstanceLocation) override;
+		virtual void DrawIndexedInstanced(UINT IndexCountPerInstance, UINT InstanceCount, UINT StartIndexLocation, INT BaseVertexLocation, UINT StartInstanceLocation) override;
+		virtual void DrawIndexedInstancedIndirect(ER_RHI_GPUBuffer* aArgsBuffer, UINT aArgsOffset) override;
+
+		virtual void Dispatch(UINT ThreadGroupCountX, UINT ThreadGroupCountY, UINT ThreadGroupCountZ) override;
+
+		virtual void GenerateMips(ER_RHI_GPUTexture* aTexture, ER_RHI_GPUTexture* aSRGBTexture = nullptr) override {}
+		virtual void GenerateMipsWithTextureReplacement(ER_RHI_GPUTexture** aTexture, std::function<void(ER_RHI_GPUTexture**)> aReplacementCallback) override {} // textures are created with their final mip count
+		virtual ER_RHI_GPUTexture* GenerateMipsIntoNewTexture(ER_RHI_GPUTexture* aTexture) override { return nullptr; }
+		virtual void ReplaceOriginalTexturesWithMipped() override {}
+
+		virtual void ExecuteCommandLists(int commandListIndex = 0, bool isCompute = false) override { mFrameCounters.ExecutedCommandLists++; }
+		virtual void ExecuteCopyCommandList() override { mFrameCounters.ExecutedCommandLists++; }
+
+		virtual void PresentGraphics() override;
+		virtual void PresentCompute() override {}
+
+		virtual bool ProjectCubemapToSH(ER_RHI_GPUTexture* aTexture, UINT order, float* resultR, float* resultG, float* resultB) override { return false; }
+		virtual bool ReadGPUTextureToCPU(ER_RHI_GPUTexture* aTexture, UINT aMip, std::vector<XMFLOAT4>& aOutTexels) override;
+		virtual void SaveGPUTextureToFile(ER_RHI_GPUTexture* aTexture, const std::wstring& aPathName) override {}
+
+		virtual void SetMainRenderTargets(int cmdListIndex = 0) override { mFrameCounters.RenderTargetChanges++; }
+		virtual void SetRenderTargets(ER_RHI_Span<ER_RHI_GPUTexture*> aRenderTargets, ER_RHI_GPUTexture* aDepthTarget = nullptr, ER_RHI_GPUTexture* aUAV = nullptr, int rtvArrayIndex = -1) override { mFrameCounters.RenderTargetChanges++; }
+		virtual void SetDepthTarget(ER_RHI_GPUTexture* aDepthTarget) override { mFrameCounters.RenderTargetChanges++; }
+		virtual void SetRenderTargetFormats(ER_RHI_Span<ER_RHI_GPUTexture*> aRenderTargets, ER_RHI_GPUTexture* aDepthTarget = nullptr) override {}
+		virtual void SetMainRenderTargetFormats() override {}
+
+		virtual void SetDepthStencilState(ER_RHI_DEPTH_STENCIL_STATE aDS, UINT stencilRef = 0xffffffff) override;
+		virtual void SetBlendState(ER_RHI_BLEND_STATE aBS, const float BlendFactor[4] = nullptr, UINT SampleMask = 0xffffffff) override;
+		virtual void SetRasterizerState(ER_RHI_RASTERIZER_STATE aRS) override;
+
+		virtual void SetViewport(const ER_RHI_Viewport& aViewport) override;
+		virtual void SetRect(const ER_RHI_Rect& rect) override;
+
+		virtual void SetShaderResources(ER_RHI_SHADER_TYPE aShaderType, ER_RHI_Span<ER_RHI_GPUResource*> aSRVs, UINT startSlot = 0,
+			ER_RHI_GPURootSignature* rs = nullptr, int rootParamIndex = -1, bool isComputeRS = false, bool skipAutomaticTransition = false) override;
+		virtual void SetUnorderedAccessResources(ER_RHI_SHADER_TYPE aShaderType, ER_RHI_Span<ER_RHI_GPUResource*> aUAVs, UINT startSlot = 0,
+			ER_RHI_GPURootSignature* rs = nullptr, int rootParamIndex = -1, bool isComputeRS = false, bool skipAutomaticTransition = false) override;
+		virtual void SetConstantBuffers(ER_RHI_SHADER_TYPE aShaderType, ER_RHI_Span<ER_RHI_GPUBuffer*> aCBs, UINT startSlot = 0,
+			ER_RHI_GPURootSignature* rs = nullptr, int rootParamIndex = -1, bool isComputeRS = false) override;
+		virtual void SetSamplers(ER_RHI_SHADER_TYPE aShaderType, ER_RHI_Span<ER_RHI_SAMPLER_STATE> aSamplers, UINT startSlot = 0, ER_RHI_GPURootSignature* rs = nullptr) override;
+
+		virtual void SetRootSignature(ER_RHI_GPURootSignature* rs, bool isCompute = false) override;
+
+		virtual void SetShader(ER_RHI_GPUShader* aShader) override;
+		virtual void SetInputLayout(ER_RHI_InputLayout* aIL) override;
+		virtual void SetEmptyInputLayout() override;
+		virtual void SetIndexBuffer(ER_RHI_GPUBuffer* aBuffer, UINT offset = 0) override;
+		virtual void SetVertexBuffers(ER_RHI_Span<ER_RHI_GPUBuffer*> aVertexBuffers) override;
+
+		virtual void SetTopologyType(ER_RHI_PRIMITIVE_TYPE aType) override;
+		virtual ER_RHI_PRIMITIVE_TYPE GetCurrentTopologyType() override { return mCurrentTopologyType; }
+
+		virtual void SetGPUDescriptorHeap(ER_RHI_DESCRIPTOR_HEAP_TYPE aType, bool aReset) override {}
+		virtual void SetGPUDescriptorHeapImGui(int cmdListIndex) override {}
+
+		virtual void TransitionResources(ER_RHI_Span<ER_RHI_GPUResource*> aResources, ER_RHI_Span<ER_RHI_RESOURCE_STATE> aStates, int cmdListIndex = 0, bool isCopyQueue = false, int subresourceIndex = -1) override;
+		virtual void TransitionResources(ER_RHI_Span<ER_RHI_GPUResource*> aResources, ER_RHI_RESOURCE_STATE aState, int cmdListIndex = 0, bool isCopyQueue = false, int subresourceIndex = -1) override;
+		virtual void TransitionMainRenderTargetToPresent(int cmdListIndex = 0) override { mFrameCounters.Transitions++; }
+
+		virtual bool IsPSOReady(const std::string& aName, bool isCompute = false) override;
+		virtual void InitializePSO(const std::string& aName, bool isCompute = false) override;
+		virtual void SetRootSignatureToPSO(const std::string& aName, ER_RHI_GPURootSignature* rs, bool isCompute = false) override;
+		virtual void SetTopologyTypeToPSO(const std::string& aName, ER_RHI_PRIMITIVE_TYPE aType) override;
+		virtual ER_RHI_PSO_HANDLE FinalizePSO(const std::string& aName, bool isCompute = false) override;
+		virtual ER_RHI_PSO_HANDLE GetPSOHandle(const std::string& aName, bool isCompute = false) override;
+		virtual void SetPSO(const std::string& aName, bool isCompute = false) override;
+		virtual void SetPSO(ER_RHI_PSO_HANDLE aHandle, bool isCompute = false) override;
+		virtual void UnsetPSO() override { mCurrentPSO = nullptr; }
+
+		virtual void UnbindRenderTargets() override { mFrameCounters.RenderTargetChanges++; }
+		virtual void UnbindResourcesFromShader(ER_RHI_SHADER_TYPE aShaderType, bool unbindShader = true) override {}
+
+		virtual void UpdateBuffer(ER_RHI_GPUBuffer* aBuffer, void* aData, int dataSize, bool updateForAllBackBuffers = false) override;
+		virtual void UpdateBufferTransient(ER_RHI_GPUBuffer* aBuffer, void* aData, int dataSize) override; // no upload ring, same as UpdateBuffer()
+
+		virtual bool IsHardwareRaytracingSupported() override { return false; }
+
+		virtual void InitImGui() override;
+		virtual void StartNewImGuiFrame() override {}
+		virtual void RenderDrawDataImGui(int cmdListIndex = 0) override {}
+		virtual void ShutdownImGui() override {}
+
+		virtual void OnWindowSizeChanged(int width, int height) override {}
+
+		virtual void WaitForGpuOnGraphicsFence() override {}
+		virtual void WaitForGpuOnComputeFence() override {}
+		virtual void WaitForGpuOnCopyFence() override {}
+
+		virtual void ResetReplacementMippedTexturesPool() override {}
+		virtual void ResetDescriptorManager() override {}
+		virtual void ResetRHI(int width, int height, bool isFullscreen) override;
+
+		virtual void BeginEventTag(const std::string& aName, bool isComputeQueue = false) override {}
+		virtual void EndEventTag(bool isComputeQueue = false) override {}
+
+		// Bookkeeping (called by the null GPU resources)
+		void OnBufferCreated(UINT64 aBytes);
+		void OnBufferDestroyed(UINT64 aBytes);
+		void OnTextureCreated(UINT64 aBytes);
+		void OnTextureDestroyed(UINT64 aBytes);
+		void OnShaderCreated() { mAllocations.CreatedShaders++; }
+
+		static UINT GetFormatSize(ER_RHI_FORMAT aFormat); // bytes per texel
+
+		const ER_RHI_Null_CommandCounters& GetLastFrameCounters() const { return mLastFrameCounters; }
+		const ER_RHI_Null_CommandCounters& GetTotalCounters() const { return mTotalCounters; }
+		const ER_RHI_Null_AllocationCounters& GetAllocationCounters() const { return mAllocations; }
+		UINT64 GetPresentedFrames() const { return mPresentedFrames; }
+		UINT GetPSOCount() const { return static_cast<UINT>(mPSOs.size()); }
+		void ResetCounters();
+
+		void LogStatistics();
+	private:
+		struct PSO
+		{
+			ER_RHI_GPURootSignature* RootSignature = nullptr;
+			ER_RHI_PRIMITIVE_TYPE Topology = ER_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+			bool IsCompute = false;
+			bool IsFinalized = false;
+			ER_RHI_PSO_HANDLE Handle = ER_RHI_INVALID_PSO_HANDLE; // kept when the PSO is initialized again
+		};
+
+		void OnStateChange(bool isRedundant);
+		void OnDraw(UINT64 aVertices, UINT aInstances);
+		void UpdatePeakBytes();
+
+		std::unordered_map<std::string, PSO> mPSOs;
+		std::vector<PSO*> mPSOHandles; // handle -> PSO (elements of unordered_map are not moved on rehash)
+		const PSO* mCurrentPSO = nullptr;
+
+		ER_RHI_GPUShader* mCurrentShaders[ER_RHI_SHADER_TYPE::ER_COMPUTE + 1] = {};
+		ER_RHI_GPURootSignature* mCurrentRootSignature = nullptr;
+		ER_RHI_GPURootSignature* mCurrentComputeRootSignature = nullptr;
+		ER_RHI_InputLayout* mCurrentInputLayout = nullptr;
+		ER_RHI_GPUBuffer* mCurrentIndexBuffer = nullptr;
+		ER_RHI_GPUBuffer* mCurrentVertexBuffers[ER_RHI_MAX_BOUND_VERTEX_BUFFERS] = {};
+		ER_RHI_PRIMITIVE_TYPE mCurrentTopologyType = ER_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+
+		ER_RHI_Null_CommandCounters mFrameCounters;
+		ER_RHI_Null_CommandCounters mLastFrameCounters;
+		ER_RHI_Null_CommandCounters mTotalCounters;
+		ER_RHI_Null_AllocationCounters mAllocations;
+		UINT64 mPresentedFrames = 0;
+	};
+}
@@ -0,0 +1,50 @@
+#include "ER_RHI_Null_GPUBuffer.h"
+
+namespace EveryRay_Core
+{
+	ER_RHI_Null_GPUBuffer::ER_RHI_Null_GPUBuffer(const std::string& aDebugName)
+		: mDebugName(aDebugName)
+	{
+	}
+
+	ER_RHI_Null_GPUBuffer::~ER_RHI_Null_GPUBuffer()
+	{
+		if (mRHI)
+			mRHI->OnBufferDestroyed(static_cast<UINT64>(mByteSize));
+	}
+
+	void ER_RHI_Null_GPUBuffer::CreateGPUBufferResource(ER_RHI* aRHI, void* aData, UINT objectsCount, UINT byteStride, bool isDynamic, ER_RHI_BIND_FLAG bindFlags, UINT cpuAccessFlags, ER_RHI_RESOURCE_MISC_FLAG miscFlags, ER_RHI_FORMAT format)
+	{
+		assert(aRHI);
+		assert(!mRHI); // buffers are created once
+
+		mRHI = static_cast<ER_RHI_Null*>(aRHI);
+		mStride = byteStride;
+		mByteSize = static_cast<int>(objectsCount * byteStride);
+		mFormat = format;
+		mBindFlags = bindFlags;
+
+		if (isDynamic || cpuAccessFlags != 0)
+		{
+			mCPUData.resize(mByteSize, 0);
+			if (aData)
+				memcpy(mCPUData.data(), aData, mByteSize);
+		}
+
+		mRHI->OnBufferCreated(static_cast<UINT64>(mByteSize));
+	}
+
+	void ER_RHI_Null_GPUBuffer::Update(void* aData, int dataSize)
+	{
+		assert(dataSize <= mByteSize);
+		if (!mCPUData.empty() && aData)
+			memcpy(mCPUData.data(), aData, dataSize);
+	}
+
+	void* ER_RHI_Null_GPUBuffer::GetCPUData()
+	{
+		if (mCPUData.empty())
+			mCPUData.resize(mByteSize, 0);
+		return mCPUData.data();
+	}
+}
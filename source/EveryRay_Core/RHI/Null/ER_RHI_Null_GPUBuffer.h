@@ -0,0 +1,40 @@
+#pragma once
+#include "ER_RHI_Null.h"
+
+namespace EveryRay_Core
+{
+	class ER_RHI_Null_GPUBuffer : public ER_RHI_GPUBuffer
+	{
+	public:
+		ER_RHI_Null_GPUBuffer(const std::string& aDebugName);
+		virtual ~ER_RHI_Null_GPUBuffer();
+
+		virtual void CreateGPUBufferResource(ER_RHI* aRHI, void* aData, UINT objectsCount, UINT byteStride, bool isDynamic = false, ER_RHI_BIND_FLAG bindFlags = ER_BIND_NONE, UINT cpuAccessFlags = 0, ER_RHI_RESOURCE_MISC_FLAG miscFlags = ER_RESOURCE_MISC_NONE, ER_RHI_FORMAT format = ER_FORMAT_UNKNOWN) override;
+		virtual void* GetBuffer() override { return this; }
+		virtual void* GetSRV() override { return (mBindFlags & ER_BIND_SHADER_RESOURCE) ? this : nullptr; }
+		virtual void* GetUAV() override { return (mBindFlags & ER_BIND_UNORDERED_ACCESS) ? this : nullptr; }
+		virtual int GetSize() override { return mByteSize; }
+		virtual UINT GetStride() override { return mStride; }
+		virtual ER_RHI_FORMAT GetFormatRhi() override { return mFormat; }
+		virtual void* GetResource() override { return this; }
+
+		virtual ER_RHI_RESOURCE_STATE GetCurrentState() override { return mCurrentState; }
+		virtual void SetCurrentState(ER_RHI_RESOURCE_STATE aState) override { mCurrentState = aState; }
+
+		inline virtual bool IsBuffer() override { return true; }
+
+		// CPU copy of the contents (only for dynamic and CPU-accessible buffers, which can be updated or read back)
+		void Update(void* aData, int dataSize);
+		void* GetCPUData();
+		bool HasCPUData() const { return !mCPUData.empty(); }
+	private:
+		std::string mDebugName;
+		std::vector<unsigned char> mCPUData;
+		ER_RHI_Null* mRHI = nullptr;
+		ER_RHI_RESOURCE_STATE mCurrentState = ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_COMMON;
+		ER_RHI_FORMAT mFormat = ER_FORMAT_UNKNOWN;
+		ER_RHI_BIND_FLAG mBindFlags = ER_BIND_NONE;
+		UINT mStride = 0;
+		int mByteSize = 0;
+	};
+}
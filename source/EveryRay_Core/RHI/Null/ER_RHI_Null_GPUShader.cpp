@@ -0,0 +1,34 @@
+#include "ER_RHI_Null_GPUShader.h"
+#include "..\..\ER_Utility.h"
+#include "..\..\ER_CoreException.h"
+
+namespace EveryRay_Core
+{
+	ER_RHI_Null_GPUShader::ER_RHI_Null_GPUShader()
+	{
+	}
+
+	ER_RHI_Null_GPUShader::~ER_RHI_Null_GPUShader()
+	{
+	}
+
+	void ER_RHI_Null_GPUShader::CompileShader(ER_RHI* aRHI, const std::string& path, const std::string& shaderEntry, ER_RHI_SHADER_TYPE type, ER_RHI_InputLayout* aIL)
+	{
+		mShaderType = type;
+
+		assert(aRHI);
+		assert(!shaderEntry.empty());
+
+		mPath = path;
+		mEntry = shaderEntry;
+
+		std::ifstream file(ER_Utility::GetFilePath(path).c_str(), std::ios::binary);
+		if (!file.is_open())
+		{
+			std::string message = "ER_RHI_Null: Failed to find shader: " + path + " with shader entry: " + shaderEntry;
+			throw ER_CoreException(message.c_str());
+		}
+
+		static_cast<ER_RHI_Null*>(aRHI)->OnShaderCreated();
+	}
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include "ER_RHI_Null.h"
+
+namespace EveryRay_Core
+{
+	// Nothing gets compiled: the shader only remembers its source (for debugging) and checks that the file exists
+	class ER_RHI_Null_GPUShader : public ER_RHI_GPUShader
+	{
+	public:
+		ER_RHI_Null_GPUShader();
+		virtual ~ER_RHI_Null_GPUShader();
+
+		virtual void CompileShader(ER_RHI* aRHI, const std::string& path, const std::string& shaderEntry, ER_RHI_SHADER_TYPE type, ER_RHI_InputLayout* aIL = nullptr) override;
+		virtual void* GetShaderObject() override { return this; }
+
+		const std::string& GetPath() const { return mPath; }
+		const std::string& GetEntry() const { return mEntry; }
+	private:
+		std::string mPath;
+		std::string mEntry;
+	};
+}
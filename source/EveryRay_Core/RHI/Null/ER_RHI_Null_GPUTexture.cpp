@@ -0,0 +1,178 @@
+#include "ER_RHI_Null_GPUTexture.h"
+#include "..\..\ER_Utility.h"
+#include "..\..\ER_CoreException.h"
+
+namespace EveryRay_Core
+{
+	ER_RHI_Null_GPUTexture::ER_RHI_Null_GPUTexture(const std::wstring& aDebugName)
+		: mDebugName(aDebugName)
+	{
+	}
+
+	ER_RHI_Null_GPUTexture::~ER_RHI_Null_GPUTexture()
+	{
+		Release();
+	}
+
+	void ER_RHI_Null_GPUTexture::Release()
+	{
+		if (mRHI)
+			mRHI->OnTextureDestroyed(mByteSize);
+		mRHI = nullptr;
+		mByteSize = 0;
+	}
+
+	void ER_RHI_Null_GPUTexture::CreateGPUTextureResource(ER_RHI* aRHI, UINT width, UINT height, UINT samples, ER_RHI_FORMAT format, ER_RHI_BIND_FLAG bindFlags, int mip, int depth, int arraySize, bool isCubemap, int cubemapArraySize)
+	{
+		assert(aRHI);
+		assert(width > 0 && height > 0);
+		Release();
+
+		mIsLoadedFromFile = false;
+		mWidth = width;
+		mHeight = height;
+		mDepth = depth;
+		mFormat = format;
+		mBindFlags = bindFlags;
+		mIsCubemap = isCubemap;
+		mArraySize = isCubemap ? 6 * static_cast<UINT>(cubemapArraySize > 0 ? cubemapArraySize : 1) : static_cast<UINT>(arraySize > 0 ? arraySize : 1);
+		mMipLevels = (mip > 0) ? static_cast<UINT>(mip) : GetCalculatedMipCount();
+
+		const UINT64 texelSize = ER_RHI_Null::GetFormatSize(format) * static_cast<UINT64>(samples > 0 ? samples : 1);
+		for (UINT i = 0; i < mMipLevels; i++)
+		{
+			UINT64 mipWidth = std::max(1u, mWidth >> i);
+			UINT64 mipHeight = std::max(1u, mHeight >> i);
+			UINT64 mipDepth = (depth > 0) ? std::max(1u, static_cast<UINT>(depth) >> i) : 1;
+			mByteSize += mipWidth * mipHeight * mipDepth * texelSize;
+		}
+		mByteSize *= mArraySize;
+
+		mRHI = static_cast<ER_RHI_Null*>(aRHI);
+		mRHI->OnTextureCreated(mByteSize);
+	}
+
+	void ER_RHI_Null_GPUTexture::CreateGPUTextureResource(ER_RHI* aRHI, const std::string& aPath, bool isFullPath, bool is3D, bool skipFallback, bool* statusFlag, bool isSilent)
+	{
+		CreateGPUTextureResource(aRHI, ER_Utility::ToWideString(aPath), isFullPath, is3D, skipFallback, statusFlag, isSilent);
+	}
+
+	void ER_RHI_Null_GPUTexture::CreateGPUTextureResource(ER_RHI* aRHI, const std::wstring& aPath, bool isFullPath, bool is3D, bool skipFallback, bool* statusFlag, bool isSilent)
+	{
+		assert(aRHI);
+		Release();
+
+		mIsLoadedFromFile = true;
+		mFormat = ER_FORMAT_R8G8B8A8_UNORM;
+		mBindFlags = ER_BIND_SHADER_RESOURCE;
+		mWidth = mHeight = 1;
+		mDepth = 1;
+		mArraySize = 1;
+		mMipLevels = 1;
+
+		const std::wstring path = isFullPath ? aPath : ER_Utility::GetFilePath(aPath);
+		std::ifstream file(path.c_str(), std::ios::binary | std::ios::ate);
+		if (!file.is_open())
+		{
+			std::wstring msg = L"[ER Logger][ER_RHI_Null_GPUTexture] Failed to load texture from disk: " + path + L". Loading fallback texture instead unless forced not to. \n";
+			if (!isSilent)
+				ER_OUTPUT_LOG(msg.c_str());
+			if (statusFlag)
+				*statusFlag = false;
+			if (skipFallback)
+				return;
+			mByteSize = 4; // 1x1 fallback
+		}
+		else
+		{
+			// the contents are never decoded: DDS is uploaded as is (size of the file), others are decompressed to RGBA8 (dimensions are not known without decoding)
+			mByteSize = static_cast<UINT64>(file.tellg());
+			if (!ReadDDSHeader(path) && mByteSize > 0)
+				mByteSize *= 4;
+			if (statusFlag)
+				*statusFlag = true;
+		}
+
+		mRHI = static_cast<ER_RHI_Null*>(aRHI);
+		mRHI->OnTextureCreated(mByteSize);
+	}
+
+	void ER_RHI_Null_GPUTexture::CreateGPUTextureResource(ER_RHI* aRHI, const UINT8* aData, UINT64 aDataSize, bool* statusFlag)
+	{
+		assert(aRHI && aData);
+		Release();
+
+		mIsLoadedFromFile = true;
+		mFormat = ER_FORMAT_R8G8B8A8_UNORM;
+		mBindFlags = ER_BIND_SHADER_RESOURCE;
+
+		const bool isDDS = aDataSize >= 4 && memcmp(aData, "DDS ", 4) == 0;
+		if (isDDS)
+		{
+			UINT header[32] = {};
+			const bool isValid = aDataSize >= sizeof(header);
+			if (isValid)
+				memcpy(header, aData, sizeof(header));
+			if (!isValid || !ParseDDSHeader(header))
+			{
+				ER_OUTPUT_LOG(L"[ER Logger][ER_RHI_Null_GPUTexture] Failed to load DDS texture from memory. \n");
+				if (statusFlag)
+					*statusFlag = false;
+				return;
+			}
+			mByteSize = aDataSize;
+		}
+		else
+		{
+			// same as for WIC files on disk: not decoded, decompressed to RGBA8
+			mWidth = mHeight = 1;
+			mDepth = 1;
+			mArraySize = 1;
+			mMipLevels = 1;
+			mByteSize = aDataSize * 4;
+		}
+		if (statusFlag)
+			*statusFlag = true;
+
+		mRHI = static_cast<ER_RHI_Null*>(aRHI);
+		mRHI->OnTextureCreated(mByteSize);
+	}
+
+	bool ER_RHI_Null_GPUTexture::ReadDDSHeader(const std::wstring& aPath)
+	{
+		UINT header[32] = {};
+		std::ifstream file(aPath.c_str(), std::ios::binary);
+		if (!file.read(reinterpret_cast<char*>(header), sizeof(header)))
+			return false;
+		return ParseDDSHeader(header);
+	}
+
+	bool ER_RHI_Null_GPUTexture::ParseDDSHeader(const UINT* header)
+	{
+		// "DDS " + DDS_HEADER: dwSize, dwFlags, dwHeight, dwWidth, dwPitchOrLinearSize, dwDepth, dwMipMapCount, dwReserved1[11], ddspf (32 bytes), dwCaps, dwCaps2, ...
+		const UINT ddsMagic = 0x20534444;
+		const UINT ddsCaps2Cubemap = 0x200;
+		if (header[0] != ddsMagic)
+			return false;
+
+		mHeight = std::max(1u, header[3]);
+		mWidth = std::max(1u, header[4]);
+		mDepth = std::max(1u, header[6]);
+		mMipLevels = std::max(1u, header[7]);
+		mIsCubemap = (header[28] & ddsCaps2Cubemap) != 0;
+		mArraySize = mIsCubemap ? 6 : 1;
+		return true;
+	}
+
+	UINT ER_RHI_Null_GPUTexture::GetCalculatedMipCount()
+	{
+		UINT mipCount = 1;
+		UINT size = std::max(mWidth, mHeight);
+		while (size > 1)
+		{
+			size >>= 1;
+			mipCount++;
+		}
+		return mipCount;
+	}
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include "ER_RHI_Null.h"
+
+namespace EveryRay_Core
+{
+	class ER_RHI_Null_GPUTexture : public ER_RHI_GPUTexture
+	{
+	public:
+		ER_RHI_Null_GPUTexture(const std::wstring& aDebugName);
+		virtual ~ER_RHI_Null_GPUTexture();
+
+		virtual void CreateGPUTextureResource(ER_RHI* aRHI, UINT width, UINT height, UINT samples, ER_RHI_FORMAT format, ER_RHI_BIND_FLAG bindFlags = ER_BIND_NONE,
+			int mip = 1, int depth = -1, int arraySize = 1, bool isCubemap = false, int cubemapArraySize = -1) override;
+		virtual void CreateGPUTextureResource(ER_RHI* aRHI, const std::string& aPath, bool isFullPath = false, bool is3D = false, bool skipFallback = false, bool* statusFlag = nullptr, bool isSilent = false) override;
+		virtual void CreateGPUTextureResource(ER_RHI* aRHI, const std::wstring& aPath, bool isFullPath = false, bool is3D = false, bool skipFallback = false, bool* statusFlag = nullptr, bool isSilent = false) override;
+		virtual void CreateGPUTextureResource(ER_RHI* aRHI, const UINT8* aData, UINT64 aDataSize, bool* statusFlag = nullptr) override;
+
+		// views are not real objects on the null RHI, so the texture itself is returned as a non-null handle when the view exists
+		virtual void* GetRTV(void* aEmpty = nullptr) override { return (mBindFlags & ER_BIND_RENDER_TARGET) ? this : nullptr; }
+		virtual void* GetRTV(int index) override { return (mBindFlags & ER_BIND_RENDER_TARGET) ? this : nullptr; }
+		virtual void* GetDSV() override { return (mBindFlags & ER_BIND_DEPTH_STENCIL) ? this : nullptr; }
+		virtual void* GetSRV() override { return (mBindFlags & ER_BIND_SHADER_RESOURCE) ? this : nullptr; }
+		virtual void* GetUAV() override { return (mBindFlags & ER_BIND_UNORDERED_ACCESS) ? this : nullptr; }
+		virtual void* GetResource() override { return this; }
+
+		virtual UINT GetMips() override { return mMipLevels; }
+		virtual UINT GetCalculatedMipCount() override;
+		virtual UINT GetWidth() override { return mWidth; }
+		virtual UINT GetHeight() override { return mHeight; }
+		virtual UINT GetDepth() override { return mDepth; }
+		UINT GetArraySize() const { return mArraySize; }
+
+		virtual ER_RHI_RESOURCE_STATE GetCurrentState() override { return mCurrentState; }
+		virtual void SetCurrentState(ER_RHI_RESOURCE_STATE aState) override { mCurrentState = aState; }
+
+		inline virtual bool IsBuffer() override { return false; }
+
+		bool IsLoadedFromFile() { return mIsLoadedFromFile; }
+		UINT64 GetByteSize() const { return mByteSize; }
+	private:
+		bool ReadDDSHeader(const std::wstring& aPath);
+		bool ParseDDSHeader(const UINT* header); // first 32 DWORDs of a DDS file
+		void Release();
+
+		std::wstring mDebugName;
+		ER_RHI_Null* mRHI = nullptr;
+		ER_RHI_RESOURCE_STATE mCurrentState = ER_RHI_RESOURCE_STATE::ER_RESOURCE_STATE_COMMON;
+		ER_RHI_FORMAT mFormat = ER_FORMAT_UNKNOWN;
+		UINT mBindFlags = 0;
+		UINT mMipLevels = 0;
+		UINT mWidth = 0;
+		UINT mHeight = 0;
+		UINT mDepth = 0;
+		UINT mArraySize = 0;
+		UINT64 mByteSize = 0;
+		bool mIsCubemap = false;
+		bool mIsLoadedFromFile = false;
+	};
+}
@@ -5,8 +5,10 @@
 
 #include "..\EveryRay_Core\ER_RuntimeCore.h"
 #include "..\EveryRay_Core\ER_CoreException.h"
+#include "..\EveryRay_Core\ER_SceneCooker.h"
 #include "..\EveryRay_Core\RHI\ER_RHI.h"
 #include "..\EveryRay_Core\RHI\DX12\ER_RHI_DX12.h"
+#include "..\EveryRay_Core\RHI\Null\ER_RHI_Null.h"
 
 #if defined(DEBUG) || defined(_DEBUG)
 #define _CRTDBG_MAP_ALLOC
@@ -22,6 +24,36 @@ int WINAPI WinMain(HINSTANCE instance, HINSTANCE previousInstance, LPSTR command
 	//_CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF|_CRTDBG_LEAK_CHECK_DF);
 	//#endif
 
+	// offline scene cooking (no window/RHI): -cook_scene <path to level's *.json>
+	const std::string cookSceneArgument = "-cook_scene ";
+	const std::string arguments = commandLine ? commandLine : "";
+	if (arguments.compare(0, cookSceneArgument.size(), cookSceneArgument) == 0)
+		return ER_SceneCooker::CookScene(arguments.substr(cookSceneArgument.size())) ? 0 : 1;
+
+	// headless scene replay (null RHI, hidden window, report in the log and in content\cache\profiler\, non-zero exit code if the engine's tests fail): -headless <scene name> [frames]
+	const std::string headlessArgument = "-headless ";
+	if (arguments.compare(0, headlessArgument.size(), headlessArgument) == 0)
+	{
+		std::istringstream headlessArguments(arguments.substr(headlessArgument.size()));
+		std::string sceneName;
+		int frames = 0;
+		headlessArguments >> sceneName >> frames;
+		if (sceneName.empty())
+			return 1;
+
+		std::unique_ptr<ER_RuntimeCore> game(new ER_RuntimeCore(new ER_RHI_Null(), instance, L"EveryRay Headless Window Class", L"EveryRay - Rendering Engine | Headless", SW_HIDE, false));
+		game->SetHeadlessReplay(sceneName, frames > 0 ? static_cast<UINT>(frames) : HEADLESS_REPLAY_DEFAULT_FRAMES);
+		try {
+			game->Run();
+		}
+		catch (ER_CoreException ex)
+		{
+			ER_OUTPUT_LOG(ex.whatw().c_str());
+			return 1;
+		}
+		return game->HasHeadlessReplayPassed() ? 0 : 1;
+	}
+
 #if defined(DEBUG) || defined(_DEBUG)
 	std::unique_ptr<ER_RuntimeCore> game(new ER_RuntimeCore(new ER_RHI_DX12(), instance, L"EveryRay Main Window Class", L"EveryRay - Rendering Engine | Win64 DX12 (Debug)", showCommand, false));
 #else